@@ -32,13 +32,13 @@
 namespace xls {
 namespace verilog {
 
-absl::StatusOr<ModuleGeneratorResult> ToCombinationalModuleText(
-    Function* func, bool use_system_verilog) {
+absl::StatusOr<ModuleSignature> AddCombinationalModule(
+    Function* func, bool use_system_verilog, VerilogFile* file) {
   XLS_VLOG(2) << "Generating combinational module for function:";
   XLS_VLOG_LINES(2, func->DumpIr());
 
-  VerilogFile f;
-  ModuleBuilder mb(func->name(), &f, /*use_system_verilog=*/use_system_verilog);
+  ModuleBuilder mb(func->name(), file,
+                   /*use_system_verilog=*/use_system_verilog);
 
   // Build the module signature.
   ModuleSignatureBuilder sig_builder(mb.module()->name());
@@ -111,6 +111,14 @@ absl::StatusOr<ModuleGeneratorResult> ToCombinationalModuleText(
     XLS_RETURN_IF_ERROR(mb.AddOutputPort("out", func->return_value()->GetType(),
                                          node_exprs.at(func->return_value())));
   }
+  return signature;
+}
+
+absl::StatusOr<ModuleGeneratorResult> ToCombinationalModuleText(
+    Function* func, bool use_system_verilog) {
+  VerilogFile f;
+  XLS_ASSIGN_OR_RETURN(ModuleSignature signature,
+                       AddCombinationalModule(func, use_system_verilog, &f));
   std::string text = f.Emit();
 
   XLS_VLOG(2) << "Verilog output:";
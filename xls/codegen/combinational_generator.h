@@ -32,6 +32,12 @@ namespace verilog {
 absl::StatusOr<ModuleGeneratorResult> ToCombinationalModuleText(
     Function* func, bool use_system_verilog = true);
 
+// Adds a combinational module implementing the given function to the given
+// VerilogFile and returns the signature of the module. This enables emitting
+// the module text into an arbitrary VastSink (e.g., streaming it to a file).
+absl::StatusOr<ModuleSignature> AddCombinationalModule(
+    Function* func, bool use_system_verilog, VerilogFile* file);
+
 }  // namespace verilog
 }  // namespace xls
 
@@ -119,7 +119,8 @@ class PipelineGenerator {
             file,
             /*use_system_verilog=*/options.use_system_verilog()) {}
 
-  absl::StatusOr<ModuleGeneratorResult> Run() {
+  // Adds the module to the VerilogFile and returns its signature.
+  absl::StatusOr<ModuleSignature> Run() {
     clk_ = mb_.AddInputPort("clk", /*bit_count=*/1);
 
     if (options_.reset().has_value()) {
@@ -406,10 +407,7 @@ class PipelineGenerator {
       }
     }
 
-    std::string text = file_->Emit();
-    XLS_ASSIGN_OR_RETURN(ModuleSignature signature,
-                         BuildSignature(/*latency=*/stage));
-    return ModuleGeneratorResult{text, signature};
+    return BuildSignature(/*latency=*/stage);
   }
 
   // Builds and returns a module signature for the given latency.
@@ -556,22 +554,32 @@ class PipelineGenerator {
 
 }  // namespace
 
-absl::StatusOr<ModuleGeneratorResult> ToPipelineModuleText(
+absl::StatusOr<ModuleSignature> AddPipelineModule(
     const PipelineSchedule& schedule, Function* func,
-    const PipelineOptions& options) {
+    const PipelineOptions& options, VerilogFile* file) {
   XLS_VLOG(2) << "Generating pipelined module for function:";
   XLS_VLOG_LINES(2, func->DumpIr());
   XLS_VLOG_LINES(2, schedule.ToString());
 
-  VerilogFile file;
-  PipelineGenerator generator(func, schedule, options, &file);
-  XLS_ASSIGN_OR_RETURN(ModuleGeneratorResult result, generator.Run());
+  PipelineGenerator generator(func, schedule, options, file);
+  XLS_ASSIGN_OR_RETURN(ModuleSignature signature, generator.Run());
 
   XLS_VLOG(2) << "Signature:";
-  XLS_VLOG_LINES(2, result.signature.ToString());
+  XLS_VLOG_LINES(2, signature.ToString());
+  return signature;
+}
+
+absl::StatusOr<ModuleGeneratorResult> ToPipelineModuleText(
+    const PipelineSchedule& schedule, Function* func,
+    const PipelineOptions& options) {
+  VerilogFile file;
+  XLS_ASSIGN_OR_RETURN(ModuleSignature signature,
+                       AddPipelineModule(schedule, func, options, &file));
+  std::string text = file.Emit();
+
   XLS_VLOG(2) << "Verilog output:";
-  XLS_VLOG_LINES(2, result.verilog_text);
-  return result;
+  XLS_VLOG_LINES(2, text);
+  return ModuleGeneratorResult{text, signature};
 }
 
 }  // namespace verilog
@@ -98,6 +98,14 @@ absl::StatusOr<ModuleGeneratorResult> ToPipelineModuleText(
     const PipelineSchedule& schedule, Function* func,
     const PipelineOptions& options = PipelineOptions());
 
+// Adds a pipelined module implementing the given function with the given
+// schedule to the given VerilogFile and returns the signature of the module.
+// This enables emitting the module text into an arbitrary VastSink (e.g.,
+// streaming it to a file).
+absl::StatusOr<ModuleSignature> AddPipelineModule(
+    const PipelineSchedule& schedule, Function* func,
+    const PipelineOptions& options, VerilogFile* file);
+
 }  // namespace verilog
 }  // namespace xls
 
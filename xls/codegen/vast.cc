@@ -14,14 +14,12 @@
 
 #include "xls/codegen/vast.h"
 
+#include "absl/strings/str_split.h"
 #include "absl/flags/flag.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
-#include "absl/strings/str_join.h"
-#include "absl/strings/str_replace.h"
 #include "absl/strings/strip.h"
-#include "xls/common/indent.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/common/visitor.h"
@@ -30,8 +28,6 @@
 namespace xls {
 namespace verilog {
 
-using absl::StrJoin;
-
 std::string SanitizeIdentifier(absl::string_view name) {
   if (name.empty()) {
     return "_";
@@ -60,25 +56,64 @@ std::string ToString(Direction direction) {
   }
 }
 
-std::string MacroRef::Emit() { return absl::StrCat("`", name_); }
+std::string VastNode::Emit() {
+  std::string result;
+  StringSink sink(&result);
+  EmitTo(&sink);
+  return result;
+}
+
+namespace {
 
-std::string Include::Emit() {
-  return absl::StrFormat("`include \"%s\"", path_);
+// Emits the given expressions separated by 'separator'.
+void EmitJoined(absl::Span<Expression* const> expressions,
+                absl::string_view separator, VastSink* sink) {
+  for (int64 i = 0; i < expressions.size(); ++i) {
+    if (i != 0) {
+      sink->Append(separator);
+    }
+    expressions[i]->EmitTo(sink);
+  }
 }
 
-std::string VerilogFile::Emit() {
-  auto file_member_str = [](const FileMember& member) -> std::string {
-    return absl::visit(
-        Visitor{[](Include* m) -> std::string { return m->Emit(); },
-                [](Module* m) -> std::string { return m->Emit(); }},
-        member);
-  };
+// Emits the given expression, wrapped in parentheses if 'wrap' is true.
+void EmitMaybeParenWrapped(Expression* e, bool wrap, VastSink* sink) {
+  if (wrap) {
+    sink->Append("(");
+    e->EmitTo(sink);
+    sink->Append(")");
+  } else {
+    e->EmitTo(sink);
+  }
+}
+
+}  // namespace
 
-  std::string out;
+void MacroRef::EmitTo(VastSink* sink) {
+  sink->Append("`");
+  sink->Append(name_);
+}
+
+void Include::EmitTo(VastSink* sink) {
+  sink->Append("`include \"");
+  sink->Append(path_);
+  sink->Append("\"");
+}
+
+void VerilogFile::EmitTo(VastSink* sink) {
   for (const FileMember& member : members_) {
-    absl::StrAppend(&out, file_member_str(member), "\n");
+    absl::visit(Visitor{[&](Include* m) { m->EmitTo(sink); },
+                        [&](Module* m) { m->EmitTo(sink); }},
+                member);
+    sink->Append("\n");
   }
-  return out;
+}
+
+std::string VerilogFile::Emit() {
+  std::string result;
+  StringSink sink(&result);
+  EmitTo(&sink);
+  return result;
 }
 
 LocalParamItemRef* LocalParam::AddItem(absl::string_view name,
@@ -97,19 +132,31 @@ std::string CaseArm::GetLabelString() {
       label_);
 }
 
-std::string StatementBlock::Emit() {
+void CaseArm::EmitTo(VastSink* sink) {
+  absl::visit(Visitor{[&](Expression* named) { named->EmitTo(sink); },
+                      [&](DefaultSentinel) { sink->Append("default"); }},
+              label_);
+  sink->Append(": ");
+  statements_->EmitTo(sink);
+}
+
+void StatementBlock::EmitTo(VastSink* sink) {
   // TODO(meheff): We can probably be smarter about optionally emitting the
   // begin/end.
   if (statements_.empty()) {
-    return "begin end";
-  }
-  std::string result = "begin\n";
-  std::vector<std::string> lines;
-  for (const auto& statement : statements_) {
-    lines.push_back(statement->Emit());
+    sink->Append("begin end");
+    return;
+  }
+  sink->Append("begin\n");
+  sink->IncreaseIndent();
+  for (int64 i = 0; i < statements_.size(); ++i) {
+    if (i != 0) {
+      sink->Append("\n");
+    }
+    statements_[i]->EmitTo(sink);
   }
-  absl::StrAppend(&result, Indent(absl::StrJoin(lines, "\n")), "\nend");
-  return result;
+  sink->DecreaseIndent();
+  sink->Append("\nend");
 }
 
 Port Port::FromProto(const PortProto& proto, VerilogFile* f) {
@@ -189,28 +236,30 @@ LogicRef* VerilogFunction::return_value_ref() {
   return file_->Make<LogicRef>(return_value_def_);
 }
 
-std::string VerilogFunction::Emit() {
-  std::vector<std::string> lines;
+void VerilogFunction::EmitTo(VastSink* sink) {
+  sink->Append("function automatic ");
+  return_value_def_->EmitNoSemiTo(sink);
+  sink->Append(" (");
+  for (int64 i = 0; i < argument_defs_.size(); ++i) {
+    sink->Append(i == 0 ? "input " : ", input ");
+    argument_defs_[i]->EmitNoSemiTo(sink);
+  }
+  sink->Append(");\n");
+  sink->IncreaseIndent();
   for (RegDef* reg_def : block_reg_defs_) {
-    lines.push_back(reg_def->Emit());
+    reg_def->EmitTo(sink);
+    sink->Append("\n");
   }
-  lines.push_back(statement_block_->Emit());
-  return absl::StrCat(
-      absl::StrFormat(
-          "function automatic %s (%s);\n", return_value_def_->EmitNoSemi(),
-          absl::StrJoin(argument_defs_, ", ",
-                        [](std::string* out, RegDef* d) {
-                          absl::StrAppend(out, "input ", d->EmitNoSemi());
-                        })),
-      Indent(absl::StrJoin(lines, "\n")), "\nendfunction");
+  statement_block_->EmitTo(sink);
+  sink->DecreaseIndent();
+  sink->Append("\nendfunction");
 }
 
-std::string VerilogFunctionCall::Emit() {
-  return absl::StrFormat(
-      "%s(%s)", func_->name(),
-      absl::StrJoin(args_, ", ", [](std::string* out, Expression* e) {
-        absl::StrAppend(out, e->Emit());
-      }));
+void VerilogFunctionCall::EmitTo(VastSink* sink) {
+  sink->Append(func_->name());
+  sink->Append("(");
+  EmitJoined(args_, ", ", sink);
+  sink->Append(")");
 }
 
 LogicRef* Module::AddPortAsExpression(Direction direction,
@@ -331,7 +380,9 @@ LogicRef* Expression::AsLogicRefOrDie() {
   return static_cast<LogicRef*>(this);
 }
 
-std::string XSentinel::Emit() { return absl::StrFormat("%d'dx", width_); }
+void XSentinel::EmitTo(VastSink* sink) {
+  sink->Append(absl::StrFormat("%d'dx", width_));
+}
 
 std::string ToString(const RegInit& init) {
   return absl::visit(Visitor{[](Expression* e) { return e->Emit(); },
@@ -341,16 +392,18 @@ std::string ToString(const RegInit& init) {
                      init);
 }
 
-// For the given expression returns a string " [e - 1:0]". As a special case if
-// 'e' is the literal 1, then returns the empty string.
-static std::string WidthToString(Expression* e) {
+// For the given expression emits " [e - 1:0]". As a special case if 'e' is the
+// literal 1, then emits nothing.
+static void EmitWidth(Expression* e, VastSink* sink) {
   if (e->IsLiteral()) {
     uint64 value = e->AsLiteralOrDie()->bits().ToUint64().value();
     // Elide the width if it is one.
     // TODO(https://github.com/google/xls/issues/43): Avoid this special case
     // and perform the equivalent logic at a higher abstraction level than VAST.
-    return value == 1 ? ""
-                      : absl::StrFormat(" [%s:0]", absl::StrCat(value - 1));
+    if (value != 1) {
+      sink->Append(absl::StrFormat(" [%d:0]", value - 1));
+    }
+    return;
   }
   Literal literal(UBits(1, 32), FormatPreference::kDefault,
                   /*emit_bit_count=*/false);
@@ -358,83 +411,99 @@ static std::string WidthToString(Expression* e) {
   // precedence values in one place but we don't have a VerilogFile.
   const int64 kBinarySubPrecedence = 9;
   BinaryInfix b(e, "-", &literal, /*precedence=*/kBinarySubPrecedence);
-  return absl::StrFormat(" [%s:0]", b.Emit());
+  sink->Append(" [");
+  b.EmitTo(sink);
+  sink->Append(":0]");
 }
 
-std::string WireDef::Emit() {
-  return absl::StrFormat("wire%s%s %s;", is_signed() ? " signed " : "",
-                         WidthToString(width()), name());
+// Emits " = init" if the register initialization value is not uninitialized.
+static void EmitRegInit(const RegInit& init, VastSink* sink) {
+  if (!absl::holds_alternative<UninitializedSentinel>(init)) {
+    sink->Append(" = ");
+    absl::get<Expression*>(init)->EmitTo(sink);
+  }
 }
 
-std::string RegDef::Emit() {
-  std::string result =
-      absl::StrFormat("reg%s%s %s", is_signed() ? " signed " : "",
-                      WidthToString(width()), name());
-  if (!absl::holds_alternative<UninitializedSentinel>(init_)) {
-    absl::StrAppend(&result, " = ", ToString(init_));
-  }
-  absl::StrAppend(&result, ";");
+void Def::EmitTo(VastSink* sink) {
+  EmitNoSemiTo(sink);
+  sink->Append(";");
+}
+
+std::string Def::EmitNoSemi() {
+  std::string result;
+  StringSink sink(&result);
+  EmitNoSemiTo(&sink);
   return result;
 }
 
-// Returns a string appropriate for defining the array bounds of a unpacked
-// array reg declaration. The string is a sequence of sizes (e.g.,
-// "[0:41][0:122]" or "[42][123]" depending upon whether the bounds are defined
-// with ranges or sizes) with the first size corresponding to the outer most
-// dimension of the array.
-static std::string UnpackedArrayBoundsToString(
-    absl::Span<const UnpackedArrayBound> bounds) {
+void WireDef::EmitNoSemiTo(VastSink* sink) {
+  sink->Append(is_signed() ? "wire signed " : "wire");
+  EmitWidth(width(), sink);
+  sink->Append(" ");
+  sink->Append(name());
+}
+
+void RegDef::EmitNoSemiTo(VastSink* sink) {
+  sink->Append(is_signed() ? "reg signed " : "reg");
+  EmitWidth(width(), sink);
+  sink->Append(" ");
+  sink->Append(name());
+  EmitRegInit(init_, sink);
+}
+
+// Emits the array bounds of a unpacked array reg declaration. The bounds are a
+// sequence of sizes (e.g., "[0:41][0:122]" or "[42][123]" depending upon
+// whether the bounds are defined with ranges or sizes) with the first size
+// corresponding to the outer most dimension of the array.
+static void EmitUnpackedArrayBounds(absl::Span<const UnpackedArrayBound> bounds,
+                                    VastSink* sink) {
   XLS_CHECK_GE(bounds.size(), 1);
-  std::string result;
   for (const UnpackedArrayBound& bound : bounds) {
-    absl::visit(Visitor{[&](Expression* size) {
-                          absl::StrAppendFormat(&result, "[%s]", size->Emit());
-                        },
+    sink->Append("[");
+    absl::visit(Visitor{[&](Expression* size) { size->EmitTo(sink); },
                         [&](std::pair<Expression*, Expression*> pair) {
-                          absl::StrAppendFormat(&result, "[%s:%s]",
-                                                pair.first->Emit(),
-                                                pair.second->Emit());
+                          pair.first->EmitTo(sink);
+                          sink->Append(":");
+                          pair.second->EmitTo(sink);
                         }},
                 bound);
+    sink->Append("]");
   }
-  return result;
 }
 
-std::string UnpackedArrayRegDef::Emit() {
-  std::string result =
-      absl::StrFormat("reg%s %s%s", WidthToString(width()), name(),
-                      UnpackedArrayBoundsToString(bounds()));
-  if (!absl::holds_alternative<UninitializedSentinel>(init_)) {
-    absl::StrAppend(&result, " = ", ToString(init_));
-  }
-  absl::StrAppend(&result, ";");
-  return result;
+void UnpackedArrayRegDef::EmitNoSemiTo(VastSink* sink) {
+  sink->Append("reg");
+  EmitWidth(width(), sink);
+  sink->Append(" ");
+  sink->Append(name());
+  EmitUnpackedArrayBounds(bounds(), sink);
+  EmitRegInit(init_, sink);
 }
 
-std::string UnpackedArrayWireDef::Emit() {
-  std::string result =
-      absl::StrFormat("wire%s %s%s", WidthToString(width()), name(),
-                      UnpackedArrayBoundsToString(bounds()));
-  absl::StrAppend(&result, ";");
-  return result;
+void UnpackedArrayWireDef::EmitNoSemiTo(VastSink* sink) {
+  sink->Append("wire");
+  EmitWidth(width(), sink);
+  sink->Append(" ");
+  sink->Append(name());
+  EmitUnpackedArrayBounds(bounds(), sink);
 }
 
 namespace {
 
 // "Match" statement for emitting a ModuleMember.
-std::string EmitModuleMember(const ModuleMember& member) {
-  return absl::visit(Visitor{[](Def* d) { return d->Emit(); },
-                             [](LocalParam* p) { return p->Emit(); },
-                             [](Parameter* p) { return p->Emit(); },
-                             [](Instantiation* i) { return i->Emit(); },
-                             [](ContinuousAssignment* c) { return c->Emit(); },
-                             [](Comment* c) { return c->Emit(); },
-                             [](BlankLine* b) { return b->Emit(); },
-                             [](StructuredProcedure* sp) { return sp->Emit(); },
-                             [](AlwaysFlop* af) { return af->Emit(); },
-                             [](VerilogFunction* f) { return f->Emit(); },
-                             [](ModuleSection* s) { return s->Emit(); }},
-                     member);
+void EmitModuleMember(const ModuleMember& member, VastSink* sink) {
+  absl::visit(Visitor{[&](Def* d) { d->EmitTo(sink); },
+                      [&](LocalParam* p) { p->EmitTo(sink); },
+                      [&](Parameter* p) { p->EmitTo(sink); },
+                      [&](Instantiation* i) { i->EmitTo(sink); },
+                      [&](ContinuousAssignment* c) { c->EmitTo(sink); },
+                      [&](Comment* c) { c->EmitTo(sink); },
+                      [&](BlankLine* b) { b->EmitTo(sink); },
+                      [&](StructuredProcedure* sp) { sp->EmitTo(sink); },
+                      [&](AlwaysFlop* af) { af->EmitTo(sink); },
+                      [&](VerilogFunction* f) { f->EmitTo(sink); },
+                      [&](ModuleSection* s) { s->EmitTo(sink); }},
+              member);
 }
 
 }  // namespace
@@ -454,86 +523,97 @@ std::vector<ModuleMember> ModuleSection::GatherMembers() const {
   return all_members;
 }
 
-std::string ModuleSection::Emit() const {
-  std::vector<std::string> elements;
+void ModuleSection::EmitTo(VastSink* sink) {
+  bool first = true;
   for (const ModuleMember& member : GatherMembers()) {
-    elements.push_back(EmitModuleMember(member));
+    if (!first) {
+      sink->Append("\n");
+    }
+    first = false;
+    EmitModuleMember(member, sink);
   }
-  return absl::StrJoin(elements, "\n");
 }
 
-std::string ContinuousAssignment::Emit() {
-  return absl::StrFormat("assign %s = %s;", lhs_->Emit(), rhs_->Emit());
+void ContinuousAssignment::EmitTo(VastSink* sink) {
+  sink->Append("assign ");
+  lhs_->EmitTo(sink);
+  sink->Append(" = ");
+  rhs_->EmitTo(sink);
+  sink->Append(";");
 }
 
-std::string Comment::Emit() {
-  return absl::StrCat("// ", absl::StrReplaceAll(text_, {{"\n", "\n// "}}));
+void Comment::EmitTo(VastSink* sink) {
+  bool first = true;
+  for (absl::string_view line : absl::StrSplit(text_, '\n')) {
+    sink->Append(first ? "// " : "\n// ");
+    sink->Append(line);
+    first = false;
+  }
 }
 
-std::string SystemTaskCall::Emit() {
+void SystemTaskCall::EmitTo(VastSink* sink) {
+  sink->Append("$");
+  sink->Append(name_);
   if (args_.has_value()) {
-    return absl::StrFormat(
-        "$%s(%s);", name_,
-        absl::StrJoin(*args_, ", ", [](std::string* out, Expression* e) {
-          absl::StrAppend(out, e->Emit());
-        }));
-  } else {
-    return absl::StrFormat("$%s;", name_);
+    sink->Append("(");
+    EmitJoined(*args_, ", ", sink);
+    sink->Append(")");
   }
+  sink->Append(";");
 }
 
-std::string SystemFunctionCall::Emit() {
+void SystemFunctionCall::EmitTo(VastSink* sink) {
+  sink->Append("$");
+  sink->Append(name_);
   if (args_.has_value()) {
-    return absl::StrFormat(
-        "$%s(%s)", name_,
-        absl::StrJoin(*args_, ", ", [](std::string* out, Expression* e) {
-          absl::StrAppend(out, e->Emit());
-        }));
-  } else {
-    return absl::StrFormat("$%s", name_);
+    sink->Append("(");
+    EmitJoined(*args_, ", ", sink);
+    sink->Append(")");
   }
 }
 
-std::string Module::Emit() {
-  std::string result = absl::StrCat("module ", name_);
+void Module::EmitTo(VastSink* sink) {
+  sink->Append("module ");
+  sink->Append(name_);
   if (ports_.empty()) {
-    absl::StrAppend(&result, ";\n");
+    sink->Append(";\n");
   } else {
-    absl::StrAppend(&result, "(\n  ");
-    absl::StrAppend(
-        &result,
-        absl::StrJoin(ports_, ",\n  ", [](std::string* out, const Port& port) {
-          absl::StrAppendFormat(out, "%s %s", ToString(port.direction),
-                                port.wire->EmitNoSemi());
-        }));
-    absl::StrAppend(&result, "\n);\n");
-  }
-  absl::StrAppend(&result, Indent(top_.Emit()), "\n");
-  absl::StrAppend(&result, "endmodule");
-  return result;
+    sink->Append("(");
+    for (int64 i = 0; i < ports_.size(); ++i) {
+      sink->Append(i == 0 ? "\n  " : ",\n  ");
+      sink->Append(ToString(ports_[i].direction));
+      sink->Append(" ");
+      ports_[i].wire->EmitNoSemiTo(sink);
+    }
+    sink->Append("\n);\n");
+  }
+  sink->IncreaseIndent();
+  top_.EmitTo(sink);
+  sink->DecreaseIndent();
+  sink->Append("\nendmodule");
 }
 
-std::string Literal::Emit() {
+void Literal::EmitTo(VastSink* sink) {
   if (format_ == FormatPreference::kDefault) {
     XLS_CHECK_LE(bits_.bit_count(), 32);
-    return absl::StrFormat("%s", bits_.ToString(FormatPreference::kDecimal));
+    sink->Append(bits_.ToString(FormatPreference::kDecimal));
+    return;
   }
   if (format_ == FormatPreference::kDecimal) {
-    std::string prefix;
     if (emit_bit_count_) {
-      prefix = absl::StrFormat("%d'd", bits_.bit_count());
+      sink->Append(absl::StrFormat("%d'd", bits_.bit_count()));
     }
-    return absl::StrFormat("%s%s", prefix,
-                           bits_.ToString(FormatPreference::kDecimal));
+    sink->Append(bits_.ToString(FormatPreference::kDecimal));
+    return;
   }
   if (format_ == FormatPreference::kBinary) {
-    return absl::StrFormat(
-        "%d'b%s", bits_.bit_count(),
-        bits_.ToRawDigits(format_, /*emit_leading_zeros=*/true));
+    sink->Append(absl::StrFormat("%d'b", bits_.bit_count()));
+    sink->Append(bits_.ToRawDigits(format_, /*emit_leading_zeros=*/true));
+    return;
   }
   XLS_CHECK_EQ(format_, FormatPreference::kHex);
-  return absl::StrFormat(
-      "%d'h%s", bits_.bit_count(),
+  sink->Append(absl::StrFormat("%d'h", bits_.bit_count()));
+  sink->Append(
       bits_.ToRawDigits(FormatPreference::kHex, /*emit_leading_zeros=*/true));
 }
 
@@ -545,9 +625,13 @@ bool Literal::IsLiteralWithValue(int64 target) const {
 }
 
 // TODO(meheff): Escape string.
-std::string QuotedString::Emit() { return absl::StrFormat("\"%s\"", str_); }
+void QuotedString::EmitTo(VastSink* sink) {
+  sink->Append("\"");
+  sink->Append(str_);
+  sink->Append("\"");
+}
 
-std::string Slice::Emit() {
+void Slice::EmitTo(VastSink* sink) {
   if (subject_->IsScalarReg()) {
     // If subject is scalar (no width given in declaration) then avoid slicing
     // as this is invalid Verilog. The only valid hi/lo values are zero.
@@ -555,109 +639,118 @@ std::string Slice::Emit() {
     // and perform the equivalent logic at a higher abstraction level than VAST.
     XLS_CHECK(hi_->IsLiteralWithValue(0)) << hi_->Emit();
     XLS_CHECK(lo_->IsLiteralWithValue(0)) << lo_->Emit();
-    return subject_->Emit();
+    subject_->EmitTo(sink);
+    return;
   }
-  return absl::StrFormat("%s[%s:%s]", subject_->Emit(), hi_->Emit(),
-                         lo_->Emit());
+  subject_->EmitTo(sink);
+  sink->Append("[");
+  hi_->EmitTo(sink);
+  sink->Append(":");
+  lo_->EmitTo(sink);
+  sink->Append("]");
 }
 
-std::string DynamicSlice::Emit() {
-  return absl::StrFormat("%s[%s +: %s]", subject_->Emit(), start_->Emit(),
-                         width_->Emit());
+void DynamicSlice::EmitTo(VastSink* sink) {
+  subject_->EmitTo(sink);
+  sink->Append("[");
+  start_->EmitTo(sink);
+  sink->Append(" +: ");
+  width_->EmitTo(sink);
+  sink->Append("]");
 }
 
-std::string Index::Emit() {
+void Index::EmitTo(VastSink* sink) {
   if (subject_->IsScalarReg()) {
     // If subject is scalar (no width given in declaration) then avoid indexing
     // as this is invalid Verilog. The only valid index values are zero.
     // TODO(https://github.com/google/xls/issues/43): Avoid this special case
     // and perform the equivalent logic at a higher abstraction level than VAST.
     XLS_CHECK(index_->IsLiteralWithValue(0)) << index_->Emit();
-    return subject_->Emit();
+    subject_->EmitTo(sink);
+    return;
   }
-  return absl::StrFormat("%s[%s]", subject_->Emit(), index_->Emit());
+  subject_->EmitTo(sink);
+  sink->Append("[");
+  index_->EmitTo(sink);
+  sink->Append("]");
 }
 
-// Returns the given string wrappend in parentheses.
-static std::string ParenWrap(absl::string_view s) {
-  return absl::StrFormat("(%s)", s);
-}
-
-std::string Ternary::Emit() {
-  auto maybe_paren_wrap = [this](Expression* e) {
-    if (e->precedence() <= precedence()) {
-      return ParenWrap(e->Emit());
-    }
-    return e->Emit();
+void Ternary::EmitTo(VastSink* sink) {
+  auto maybe_paren_wrap = [&](Expression* e) {
+    EmitMaybeParenWrapped(e, e->precedence() <= precedence(), sink);
   };
-  return absl::StrFormat("%s ? %s : %s", maybe_paren_wrap(test_),
-                         maybe_paren_wrap(consequent_),
-                         maybe_paren_wrap(alternate_));
+  maybe_paren_wrap(test_);
+  sink->Append(" ? ");
+  maybe_paren_wrap(consequent_);
+  sink->Append(" : ");
+  maybe_paren_wrap(alternate_);
 }
 
-std::string Parameter::Emit() {
-  return absl::StrFormat("parameter %s = %s;", name_, rhs_->Emit());
+void Parameter::EmitTo(VastSink* sink) {
+  sink->Append("parameter ");
+  sink->Append(name_);
+  sink->Append(" = ");
+  rhs_->EmitTo(sink);
+  sink->Append(";");
 }
 
-std::string LocalParamItem::Emit() {
-  return absl::StrFormat("%s = %s", name_, rhs_->Emit());
+void LocalParamItem::EmitTo(VastSink* sink) {
+  sink->Append(name_);
+  sink->Append(" = ");
+  rhs_->EmitTo(sink);
 }
 
-std::string LocalParam::Emit() {
-  std::string result = "localparam";
+void LocalParam::EmitTo(VastSink* sink) {
+  sink->Append("localparam");
   if (items_.size() == 1) {
-    absl::StrAppend(&result, " ", items_[0]->Emit(), ";");
-    return result;
+    sink->Append(" ");
+    items_[0]->EmitTo(sink);
+    sink->Append(";");
+    return;
   }
-  auto append_item = [](std::string* out, LocalParamItem* item) {
-    absl::StrAppend(out, item->Emit());
-  };
-  absl::StrAppend(&result, "\n  ", absl::StrJoin(items_, ",\n  ", append_item),
-                  ";");
-  return result;
+  for (int64 i = 0; i < items_.size(); ++i) {
+    sink->Append(i == 0 ? "\n  " : ",\n  ");
+    items_[i]->EmitTo(sink);
+  }
+  sink->Append(";");
 }
 
-std::string BinaryInfix::Emit() {
+void BinaryInfix::EmitTo(VastSink* sink) {
   // Equal precedence operators are evaluated left-to-right so LHS only needs to
   // be wrapped if its precedence is strictly less than this operators. The
   // RHS, however, must be wrapped if its less than or equal precedence.
-  std::string lhs_string = lhs_->precedence() < precedence()
-                               ? ParenWrap(lhs_->Emit())
-                               : lhs_->Emit();
-  std::string rhs_string = rhs_->precedence() <= precedence()
-                               ? ParenWrap(rhs_->Emit())
-                               : rhs_->Emit();
-  return absl::StrFormat("%s %s %s", lhs_string, op_, rhs_string);
+  EmitMaybeParenWrapped(lhs_, lhs_->precedence() < precedence(), sink);
+  sink->Append(" ");
+  sink->Append(op_);
+  sink->Append(" ");
+  EmitMaybeParenWrapped(rhs_, rhs_->precedence() <= precedence(), sink);
 }
 
-std::string Concat::Emit() {
-  std::string arg_string = absl::StrFormat(
-      "{%s}", absl::StrJoin(args_, ", ", [](std::string* out, Expression* e) {
-        absl::StrAppend(out, e->Emit());
-      }));
-
+void Concat::EmitTo(VastSink* sink) {
   if (replication_.has_value()) {
-    return absl::StrFormat("{%s%s}", (*replication_)->Emit(), arg_string);
-  } else {
-    return arg_string;
+    sink->Append("{");
+    (*replication_)->EmitTo(sink);
+  }
+  sink->Append("{");
+  EmitJoined(args_, ", ", sink);
+  sink->Append("}");
+  if (replication_.has_value()) {
+    sink->Append("}");
   }
 }
 
-std::string ArrayAssignmentPattern::Emit() {
-  return absl::StrFormat(
-      "'{%s}", absl::StrJoin(args_, ", ", [](std::string* out, Expression* e) {
-        absl::StrAppend(out, e->Emit());
-      }));
+void ArrayAssignmentPattern::EmitTo(VastSink* sink) {
+  sink->Append("'{");
+  EmitJoined(args_, ", ", sink);
+  sink->Append("}");
 }
 
-std::string Unary::Emit() {
+void Unary::EmitTo(VastSink* sink) {
   // Nested unary ops should be wrapped in parentheses as this is required by
   // some consumers of Verilog.
-  return absl::StrFormat(
-      "%s%s", op_,
-      ((arg_->precedence() < precedence()) || arg_->IsUnary())
-          ? ParenWrap(arg_->Emit())
-          : arg_->Emit());
+  sink->Append(op_);
+  EmitMaybeParenWrapped(
+      arg_, (arg_->precedence() < precedence()) || arg_->IsUnary(), sink);
 }
 
 StatementBlock* Case::AddCaseArm(CaseLabel label) {
@@ -665,16 +758,17 @@ StatementBlock* Case::AddCaseArm(CaseLabel label) {
   return arms_.back()->statements();
 }
 
-std::string Case::Emit() {
-  std::string result = absl::StrFormat("case (%s)\n", subject_->Emit());
-  for (auto& arm : arms_) {
-    absl::StrAppend(&result,
-                    Indent(absl::StrFormat("%s: %s", arm->GetLabelString(),
-                                           arm->statements()->Emit())),
-                    "\n");
+void Case::EmitTo(VastSink* sink) {
+  sink->Append("case (");
+  subject_->EmitTo(sink);
+  sink->Append(")\n");
+  for (CaseArm* arm : arms_) {
+    sink->IncreaseIndent();
+    arm->EmitTo(sink);
+    sink->DecreaseIndent();
+    sink->Append("\n");
   }
-  absl::StrAppend(&result, "endcase");
-  return result;
+  sink->Append("endcase");
 }
 
 Conditional::Conditional(VerilogFile* f, Expression* condition)
@@ -690,70 +784,91 @@ StatementBlock* Conditional::AddAlternate(Expression* condition) {
   return alternates_.back().second;
 }
 
-std::string Conditional::Emit() {
-  std::string result;
-  absl::StrAppendFormat(&result, "if (%s) %s", condition_->Emit(),
-                        consequent()->Emit());
+void Conditional::EmitTo(VastSink* sink) {
+  sink->Append("if (");
+  condition_->EmitTo(sink);
+  sink->Append(") ");
+  consequent()->EmitTo(sink);
   for (auto& alternate : alternates_) {
-    absl::StrAppend(&result, " else ");
+    sink->Append(" else ");
     if (alternate.first != nullptr) {
-      absl::StrAppendFormat(&result, "if (%s) ", alternate.first->Emit());
+      sink->Append("if (");
+      alternate.first->EmitTo(sink);
+      sink->Append(") ");
     }
-    absl::StrAppend(&result, alternate.second->Emit());
+    alternate.second->EmitTo(sink);
   }
-  return result;
 }
 
 WhileStatement::WhileStatement(VerilogFile* f, Expression* condition)
     : condition_(condition), statements_(f->Make<StatementBlock>(f)) {}
 
-std::string WhileStatement::Emit() {
-  return absl::StrFormat("while (%s) %s", condition_->Emit(),
-                         statements()->Emit());
+void WhileStatement::EmitTo(VastSink* sink) {
+  sink->Append("while (");
+  condition_->EmitTo(sink);
+  sink->Append(") ");
+  statements()->EmitTo(sink);
 }
 
-std::string RepeatStatement::Emit() {
-  return absl::StrFormat("repeat (%s) %s;", repeat_count_->Emit(),
-                         statement_->Emit());
+void RepeatStatement::EmitTo(VastSink* sink) {
+  sink->Append("repeat (");
+  repeat_count_->EmitTo(sink);
+  sink->Append(") ");
+  statement_->EmitTo(sink);
+  sink->Append(";");
 }
 
-std::string EventControl::Emit() {
-  return absl::StrFormat("@(%s);", event_expression_->Emit());
+void EventControl::EmitTo(VastSink* sink) {
+  sink->Append("@(");
+  event_expression_->EmitTo(sink);
+  sink->Append(");");
 }
 
-std::string PosEdge::Emit() {
-  return absl::StrFormat("posedge %s", expression_->Emit());
+void PosEdge::EmitTo(VastSink* sink) {
+  sink->Append("posedge ");
+  expression_->EmitTo(sink);
 }
 
-std::string NegEdge::Emit() {
-  return absl::StrFormat("negedge %s", expression_->Emit());
+void NegEdge::EmitTo(VastSink* sink) {
+  sink->Append("negedge ");
+  expression_->EmitTo(sink);
 }
 
-std::string DelayStatement::Emit() {
-  std::string delay_str = delay_->precedence() < Expression::kMaxPrecedence
-                              ? ParenWrap(delay_->Emit())
-                              : delay_->Emit();
+void DelayStatement::EmitTo(VastSink* sink) {
+  sink->Append("#");
+  EmitMaybeParenWrapped(
+      delay_, delay_->precedence() < Expression::kMaxPrecedence, sink);
   if (delayed_statement_) {
-    return absl::StrFormat("#%s %s", delay_str, delayed_statement_->Emit());
+    sink->Append(" ");
+    delayed_statement_->EmitTo(sink);
   } else {
-    return absl::StrFormat("#%s;", delay_str);
+    sink->Append(";");
   }
 }
 
-std::string WaitStatement::Emit() {
-  return absl::StrFormat("wait(%s);", event_->Emit());
+void WaitStatement::EmitTo(VastSink* sink) {
+  sink->Append("wait(");
+  event_->EmitTo(sink);
+  sink->Append(");");
 }
 
-std::string Forever::Emit() {
-  return absl::StrCat("forever ", statement_->Emit());
+void Forever::EmitTo(VastSink* sink) {
+  sink->Append("forever ");
+  statement_->EmitTo(sink);
 }
 
-std::string BlockingAssignment::Emit() {
-  return absl::StrFormat("%s = %s;", lhs_->Emit(), rhs_->Emit());
+void BlockingAssignment::EmitTo(VastSink* sink) {
+  lhs_->EmitTo(sink);
+  sink->Append(" = ");
+  rhs_->EmitTo(sink);
+  sink->Append(";");
 }
 
-std::string NonblockingAssignment::Emit() {
-  return absl::StrFormat("%s <= %s;", lhs_->Emit(), rhs_->Emit());
+void NonblockingAssignment::EmitTo(VastSink* sink) {
+  lhs_->EmitTo(sink);
+  sink->Append(" <= ");
+  rhs_->EmitTo(sink);
+  sink->Append(";");
 }
 
 StructuredProcedure::StructuredProcedure(VerilogFile* f)
@@ -761,34 +876,38 @@ StructuredProcedure::StructuredProcedure(VerilogFile* f)
 
 namespace {
 
-std::string EmitSensitivityListElement(const SensitivityListElement& element) {
-  return absl::visit(
-      Visitor{[](ImplicitEventExpression e) -> std::string { return "*"; },
-              [](PosEdge* p) -> std::string { return p->Emit(); },
-              [](NegEdge* n) -> std::string { return n->Emit(); }},
-      element);
+void EmitSensitivityListElement(const SensitivityListElement& element,
+                                VastSink* sink) {
+  absl::visit(Visitor{[&](ImplicitEventExpression e) { sink->Append("*"); },
+                      [&](PosEdge* p) { p->EmitTo(sink); },
+                      [&](NegEdge* n) { n->EmitTo(sink); }},
+              element);
 }
 
 }  // namespace
 
-std::string AlwaysBase::Emit() {
-  return absl::StrFormat(
-      "%s @ (%s) %s", name(),
-      absl::StrJoin(sensitivity_list_, " or ",
-                    [](std::string* out, const SensitivityListElement& e) {
-                      absl::StrAppend(out, EmitSensitivityListElement(e));
-                    }),
-      statements_->Emit());
+void AlwaysBase::EmitTo(VastSink* sink) {
+  sink->Append(name());
+  sink->Append(" @ (");
+  for (int64 i = 0; i < sensitivity_list_.size(); ++i) {
+    if (i != 0) {
+      sink->Append(" or ");
+    }
+    EmitSensitivityListElement(sensitivity_list_[i], sink);
+  }
+  sink->Append(") ");
+  statements_->EmitTo(sink);
 }
 
-std::string AlwaysComb::Emit() {
-  return absl::StrFormat("%s %s", name(), statements_->Emit());
+void AlwaysComb::EmitTo(VastSink* sink) {
+  sink->Append(name());
+  sink->Append(" ");
+  statements_->EmitTo(sink);
 }
 
-std::string Initial::Emit() {
-  std::string result = "initial ";
-  absl::StrAppend(&result, statements_->Emit());
-  return result;
+void Initial::EmitTo(VastSink* sink) {
+  sink->Append("initial ");
+  statements_->EmitTo(sink);
 }
 
 AlwaysFlop::AlwaysFlop(VerilogFile* file, LogicRef* clk,
@@ -826,37 +945,41 @@ void AlwaysFlop::AddRegister(LogicRef* reg, Expression* reg_next,
   assignment_block_->Add<NonblockingAssignment>(reg, reg_next);
 }
 
-std::string AlwaysFlop::Emit() {
-  std::string result;
-  std::string sensitivity_list = absl::StrCat("posedge ", clk_->Emit());
+void AlwaysFlop::EmitTo(VastSink* sink) {
+  sink->Append("always @ (posedge ");
+  clk_->EmitTo(sink);
   if (rst_.has_value() && rst_->asynchronous) {
-    absl::StrAppendFormat(&sensitivity_list, " or %s %s",
-                          (rst_->active_low ? "negedge" : "posedge"),
-                          rst_->signal->Emit());
+    sink->Append(rst_->active_low ? " or negedge " : " or posedge ");
+    rst_->signal->EmitTo(sink);
   }
-  absl::StrAppendFormat(&result, "always @ (%s) %s", sensitivity_list,
-                        top_block_->Emit());
-  return result;
+  sink->Append(") ");
+  top_block_->EmitTo(sink);
 }
 
-std::string Instantiation::Emit() {
-  std::string result = absl::StrCat(module_name_, " ");
-  auto append_connection = [](std::string* out, const Connection& parameter) {
-    absl::StrAppendFormat(out, ".%s(%s)", parameter.port_name,
-                          parameter.expression->Emit());
+void Instantiation::EmitTo(VastSink* sink) {
+  auto emit_connections = [&](absl::Span<const Connection> connections) {
+    for (int64 i = 0; i < connections.size(); ++i) {
+      sink->Append(i == 0 ? "\n  ." : ",\n  .");
+      sink->Append(connections[i].port_name);
+      sink->Append("(");
+      connections[i].expression->EmitTo(sink);
+      sink->Append(")");
+    }
   };
+  sink->Append(module_name_);
+  sink->Append(" ");
   if (!parameters_.empty()) {
-    absl::StrAppend(&result, "#(\n  ");
-    absl::StrAppend(&result,
-                    absl::StrJoin(parameters_, ",\n  ", append_connection),
-                    "\n) ");
-  }
-  absl::StrAppend(&result, instance_name_);
-  absl::StrAppend(&result, " (\n  ");
-  absl::StrAppend(
-      &result, absl::StrJoin(connections_, ",\n  ", append_connection), "\n)");
-  absl::StrAppend(&result, ";");
-  return result;
+    sink->Append("#(");
+    emit_connections(parameters_);
+    sink->Append("\n) ");
+  }
+  sink->Append(instance_name_);
+  sink->Append(" (");
+  if (connections_.empty()) {
+    sink->Append("\n  ");
+  }
+  emit_connections(connections_);
+  sink->Append("\n);");
 }
 
 }  // namespace verilog
@@ -27,10 +27,10 @@
 #include "absl/algorithm/container.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
-#include "absl/strings/strip.h"
 #include "absl/types/optional.h"
 #include "absl/types/variant.h"
 #include "xls/codegen/module_signature.pb.h"
+#include "xls/codegen/vast_sink.h"
 #include "xls/common/logging/logging.h"
 #include "xls/ir/bits.h"
 
@@ -55,6 +55,14 @@ std::string SanitizeIdentifier(absl::string_view name);
 class VastNode {
  public:
   virtual ~VastNode() = default;
+
+  // Emits the Verilog text of the node into the given sink. The text of nested
+  // nodes is streamed directly into the sink rather than being composed from
+  // intermediate strings.
+  virtual void EmitTo(VastSink* sink) = 0;
+
+  // Returns the emitted Verilog text of the node as a string.
+  std::string Emit();
 };
 
 // Trait used for named entities.
@@ -72,8 +80,6 @@ class NamedTrait : public VastNode {
 class Statement : public VastNode {
  public:
   ~Statement() override = default;
-
-  virtual std::string Emit() = 0;
 };
 
 // Defines a named reg/wire of a given width.
@@ -84,10 +90,13 @@ class Def : public Statement {
 
   std::string GetName() const { return name_; }
 
-  std::string EmitNoSemi() {
-    std::string result = Emit();
-    return std::string(absl::StripSuffix(result, ";"));
-  }
+  // Emits the definition followed by a semicolon.
+  void EmitTo(VastSink* sink) override;
+
+  // Emits the definition without the trailing semicolon (e.g., for use in a
+  // port list).
+  virtual void EmitNoSemiTo(VastSink* sink) = 0;
+  std::string EmitNoSemi();
 
   const std::string& name() const { return name_; }
 
@@ -120,7 +129,7 @@ class WireDef : public Def {
                    bool is_signed = false)
       : Def(name, width, is_signed) {}
 
-  std::string Emit() override;
+  void EmitNoSemiTo(VastSink* sink) override;
 };
 
 // Register definition.
@@ -130,7 +139,7 @@ class RegDef : public Def {
          RegInit init = UninitializedSentinel(), bool is_signed = false)
       : Def(name, width, is_signed), init_(init) {}
 
-  std::string Emit() override;
+  void EmitNoSemiTo(VastSink* sink) override;
 
  protected:
   RegInit init_;
@@ -158,7 +167,7 @@ class UnpackedArrayRegDef : public RegDef {
       : RegDef(name, element_width, init),
         bounds_(bounds.begin(), bounds.end()) {}
 
-  std::string Emit() override;
+  void EmitNoSemiTo(VastSink* sink) override;
 
   absl::Span<const UnpackedArrayBound> bounds() const { return bounds_; }
 
@@ -177,7 +186,7 @@ class UnpackedArrayWireDef : public WireDef {
                        absl::Span<const UnpackedArrayBound> bounds)
       : WireDef(name, element_width), bounds_(bounds.begin(), bounds.end()) {}
 
-  std::string Emit() override;
+  void EmitNoSemiTo(VastSink* sink) override;
 
   absl::Span<const UnpackedArrayBound> bounds() const { return bounds_; }
 
@@ -201,7 +210,7 @@ class DelayStatement : public Statement {
                           Statement* delayed_statement = nullptr)
       : delay_(delay), delayed_statement_(delayed_statement) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   Expression* delay_;
@@ -213,7 +222,7 @@ class WaitStatement : public Statement {
  public:
   explicit WaitStatement(Expression* event) : event_(event) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   Expression* event_;
@@ -224,7 +233,7 @@ class Forever : public Statement {
  public:
   explicit Forever(Statement* statement) : statement_(statement) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   Statement* statement_;
@@ -236,7 +245,7 @@ class BlockingAssignment : public Statement {
   BlockingAssignment(Expression* lhs, Expression* rhs)
       : lhs_(XLS_DIE_IF_NULL(lhs)), rhs_(rhs) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   Expression* lhs_;
@@ -249,7 +258,7 @@ class NonblockingAssignment : public Statement {
   NonblockingAssignment(Expression* lhs, Expression* rhs)
       : lhs_(XLS_DIE_IF_NULL(lhs)), rhs_(rhs) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   Expression* lhs_;
@@ -268,7 +277,7 @@ class StatementBlock : public VastNode {
   template <typename T, typename... Args>
   inline T* Add(Args&&... args);
 
-  std::string Emit();
+  void EmitTo(VastSink* sink) override;
   VerilogFile* parent() const { return parent_; }
 
  private:
@@ -290,6 +299,9 @@ class CaseArm : public VastNode {
   std::string GetLabelString();
   StatementBlock* statements() { return statements_; }
 
+  // Emits the arm as "label: statements".
+  void EmitTo(VastSink* sink) override;
+
  private:
   CaseLabel label_;
   StatementBlock* statements_;
@@ -303,7 +315,7 @@ class Case : public Statement {
 
   StatementBlock* AddCaseArm(CaseLabel label);
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   VerilogFile* parent_;
@@ -324,7 +336,7 @@ class Conditional : public Statement {
   // if a final alternate ("else") clause has been previously added.
   StatementBlock* AddAlternate(Expression* condition = nullptr);
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   VerilogFile* parent_;
@@ -342,7 +354,7 @@ class WhileStatement : public Statement {
  public:
   WhileStatement(VerilogFile* f, Expression* condition);
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
   StatementBlock* statements() { return statements_; }
 
@@ -357,7 +369,7 @@ class RepeatStatement : public Statement {
   RepeatStatement(Expression* repeat_count, Statement* statement)
       : repeat_count_(repeat_count), statement_(statement) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   Expression* repeat_count_;
@@ -371,7 +383,7 @@ class EventControl : public Statement {
   explicit EventControl(Expression* event_expression)
       : event_expression_(event_expression) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   Expression* event_expression_;
@@ -431,8 +443,6 @@ class Expression : public VastNode {
   static constexpr int64 kMaxPrecedence = 13;
   static constexpr int64 kMinPrecedence = -1;
   virtual int64 precedence() const { return kMaxPrecedence; }
-
-  virtual std::string Emit() = 0;
 };
 
 // Represents an X value.
@@ -440,7 +450,7 @@ class XSentinel : public Expression {
  public:
   explicit XSentinel(int64 width) : width_(width) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   int64 width_;
@@ -461,7 +471,7 @@ class PosEdge : public Expression {
  public:
   explicit PosEdge(Expression* expression) : expression_(expression) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   Expression* expression_;
@@ -472,7 +482,7 @@ class NegEdge : public Expression {
  public:
   explicit NegEdge(Expression* expression) : expression_(expression) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   Expression* expression_;
@@ -496,7 +506,7 @@ class Instantiation : public VastNode {
         parameters_(parameters.begin(), parameters.end()),
         connections_(connections.begin(), connections.end()) {}
 
-  std::string Emit();
+  void EmitTo(VastSink* sink) override;
 
  private:
   std::string module_name_;
@@ -510,7 +520,7 @@ class MacroRef : public Expression {
  public:
   explicit MacroRef(std::string name) : name_(name) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   std::string name_;
@@ -522,7 +532,7 @@ class Parameter : public NamedTrait {
   explicit Parameter(absl::string_view name, Expression* rhs)
       : name_(name), rhs_(rhs) {}
 
-  std::string Emit();
+  void EmitTo(VastSink* sink) override;
   std::string GetName() const override { return name_; }
 
  private:
@@ -538,7 +548,7 @@ class LocalParamItem : public NamedTrait {
 
   std::string GetName() const override { return name_; }
 
-  std::string Emit();
+  void EmitTo(VastSink* sink) override;
 
  private:
   std::string name_;
@@ -550,7 +560,7 @@ class LocalParamItemRef : public Expression {
  public:
   explicit LocalParamItemRef(LocalParamItem* item) : item_(item) {}
 
-  std::string Emit() override { return item_->GetName(); }
+  void EmitTo(VastSink* sink) override { sink->Append(item_->GetName()); }
 
  private:
   LocalParamItem* item_;
@@ -562,7 +572,7 @@ class LocalParam : public VastNode {
   explicit LocalParam(VerilogFile* f) : parent_(f) {}
   LocalParamItemRef* AddItem(absl::string_view name, Expression* value);
 
-  std::string Emit();
+  void EmitTo(VastSink* sink) override;
 
  private:
   VerilogFile* parent_;
@@ -574,7 +584,9 @@ class ParameterRef : public Expression {
  public:
   explicit ParameterRef(Parameter* parameter) : parameter_(parameter) {}
 
-  std::string Emit() override { return parameter_->GetName(); }
+  void EmitTo(VastSink* sink) override {
+    sink->Append(parameter_->GetName());
+  }
 
  private:
   Parameter* parameter_;
@@ -601,7 +613,7 @@ class LogicRef : public IndexableExpression {
 
   bool IsLogicRef() const override { return true; }
 
-  std::string Emit() override { return def_->name(); }
+  void EmitTo(VastSink* sink) override { sink->Append(def_->name()); }
 
   bool IsScalarReg() const override {
     return def_->width()->IsLiteralWithValue(1) && !def_->IsArrayDef();
@@ -664,7 +676,7 @@ class Unary : public Operator {
 
   bool IsUnary() const override { return true; }
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   std::string op_;
@@ -692,7 +704,7 @@ class AlwaysFlop : public VastNode {
   void AddRegister(LogicRef* reg, Expression* reg_next,
                    Expression* reset_value = nullptr);
 
-  std::string Emit();
+  void EmitTo(VastSink* sink) override;
 
  private:
   VerilogFile* file_;
@@ -712,7 +724,6 @@ class AlwaysFlop : public VastNode {
 class StructuredProcedure : public VastNode {
  public:
   explicit StructuredProcedure(VerilogFile* f);
-  virtual std::string Emit() = 0;
 
   StatementBlock* statements() { return statements_; }
 
@@ -735,7 +746,7 @@ class AlwaysBase : public StructuredProcedure {
              absl::Span<const SensitivityListElement> sensitivity_list)
       : StructuredProcedure(f),
         sensitivity_list_(sensitivity_list.begin(), sensitivity_list.end()) {}
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  protected:
   virtual std::string name() const = 0;
@@ -758,7 +769,7 @@ class Always : public AlwaysBase {
 class AlwaysComb : public AlwaysBase {
  public:
   explicit AlwaysComb(VerilogFile* f) : AlwaysBase(f, {}) {}
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  protected:
   std::string name() const override { return "always_comb"; }
@@ -779,7 +790,7 @@ class AlwaysFf : public AlwaysBase {
 class Initial : public StructuredProcedure {
  public:
   explicit Initial(VerilogFile* f) : StructuredProcedure(f) {}
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 };
 
 class Concat : public Expression {
@@ -791,7 +802,7 @@ class Concat : public Expression {
   Concat(Expression* replication, absl::Span<Expression* const> args)
       : args_(args.begin(), args.end()), replication_(replication) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   std::vector<Expression*> args_;
@@ -804,7 +815,7 @@ class ArrayAssignmentPattern : public IndexableExpression {
   explicit ArrayAssignmentPattern(absl::Span<Expression* const> args)
       : args_(args.begin(), args.end()) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   std::vector<Expression*> args_;
@@ -819,7 +830,7 @@ class BinaryInfix : public Operator {
         lhs_(XLS_DIE_IF_NULL(lhs)),
         rhs_(XLS_DIE_IF_NULL(rhs)) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   std::string op_;
@@ -836,7 +847,7 @@ class Literal : public Expression {
     XLS_CHECK(emit_bit_count_ || bits.bit_count() == 32);
   }
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
   const Bits& bits() const { return bits_; }
 
@@ -857,7 +868,7 @@ class QuotedString : public Expression {
  public:
   explicit QuotedString(absl::string_view str) : str_(str) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   std::string str_;
@@ -865,7 +876,7 @@ class QuotedString : public Expression {
 
 class XLiteral : public Expression {
  public:
-  std::string Emit() override { return "'X"; }
+  void EmitTo(VastSink* sink) override { sink->Append("'X"); }
 };
 
 // Represents a Verilog slice expression; e.g.
@@ -876,7 +887,7 @@ class Slice : public Expression {
   Slice(IndexableExpression* subject, Expression* hi, Expression* lo)
       : subject_(subject), hi_(hi), lo_(lo) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   IndexableExpression* subject_;
@@ -893,7 +904,7 @@ class DynamicSlice : public Expression {
                Expression* width)
       : subject_(subject), start_(start), width_(width) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   IndexableExpression* subject_;
@@ -909,7 +920,7 @@ class Index : public IndexableExpression {
   Index(IndexableExpression* subject, Expression* index)
       : subject_(subject), index_(index) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   IndexableExpression* subject_;
@@ -924,7 +935,7 @@ class Ternary : public Expression {
   Ternary(Expression* test, Expression* consequent, Expression* alternate)
       : test_(test), consequent_(consequent), alternate_(alternate) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
   int64 precedence() const override { return 0; }
 
  private:
@@ -944,7 +955,7 @@ class ContinuousAssignment : public VastNode {
   ContinuousAssignment(Expression* lhs, Expression* rhs)
       : lhs_(lhs), rhs_(rhs) {}
 
-  std::string Emit();
+  void EmitTo(VastSink* sink) override;
 
  private:
   Expression* lhs_;
@@ -953,7 +964,7 @@ class ContinuousAssignment : public VastNode {
 
 class BlankLine : public Statement {
  public:
-  std::string Emit() override { return ""; }
+  void EmitTo(VastSink* sink) override {}
 };
 
 // Places a comment in statement position (we can think of comments as
@@ -962,7 +973,7 @@ class Comment : public Statement {
  public:
   explicit Comment(absl::string_view text) : text_(text) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   std::string text_;
@@ -980,7 +991,7 @@ class SystemTaskCall : public Statement {
     args_ = std::vector<Expression*>(args.begin(), args.end());
   }
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   std::string name_;
@@ -999,7 +1010,7 @@ class SystemFunctionCall : public Expression {
     args_ = std::vector<Expression*>(args.begin(), args.end());
   }
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   std::string name_;
@@ -1077,7 +1088,7 @@ class VerilogFunction : public VastNode {
   // Returns the name of the function.
   std::string name() { return name_; }
 
-  std::string Emit();
+  void EmitTo(VastSink* sink) override;
 
  private:
   std::string name_;
@@ -1105,7 +1116,7 @@ class VerilogFunctionCall : public Expression {
   VerilogFunctionCall(VerilogFunction* func, absl::Span<Expression* const> args)
       : func_(func), args_(args.begin(), args.end()) {}
 
-  std::string Emit() override;
+  void EmitTo(VastSink* sink) override;
 
  private:
   VerilogFunction* func_;
@@ -1138,7 +1149,7 @@ class ModuleSection : public VastNode {
  public:
   explicit ModuleSection(VerilogFile* file) : file_(file) {}
 
-  std::string Emit() const;
+  void EmitTo(VastSink* sink) override;
 
   // Constructs and adds a module member of type T to the section. Ownership is
   // maintained by the parent VerilogFile. Templatized on T in order to return a
@@ -1244,7 +1255,7 @@ class Module : public VastNode {
 
   ParameterRef* AddParameter(absl::string_view name, Expression* rhs);
 
-  std::string Emit();
+  void EmitTo(VastSink* sink) override;
 
   VerilogFile* parent() const { return parent_; }
 
@@ -1261,8 +1272,6 @@ class Module : public VastNode {
   const std::string& name() const { return name_; }
 
  private:
-  std::string Emit(ModuleMember* member);
-
   VerilogFile* parent_;
   std::string name_;
   std::vector<Port> ports_;
@@ -1275,7 +1284,7 @@ class Include : public VastNode {
  public:
   explicit Include(absl::string_view path) : path_(path) {}
 
-  std::string Emit();
+  void EmitTo(VastSink* sink) override;
 
  private:
   std::string path_;
@@ -1308,6 +1317,10 @@ class VerilogFile {
     return ptr;
   }
 
+  // Emits the Verilog text of the file into the given sink.
+  void EmitTo(VastSink* sink);
+
+  // Returns the emitted Verilog text of the file as a string.
   std::string Emit();
 
   verilog::Slice* Slice(IndexableExpression* subject, Expression* hi,
@@ -0,0 +1,100 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/codegen/vast_sink.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+
+namespace xls {
+namespace verilog {
+namespace {
+
+constexpr char kSpaces[] = "                                ";
+constexpr int64 kSpacesLength = sizeof(kSpaces) - 1;
+
+}  // namespace
+
+void VastSink::Append(absl::string_view text) {
+  while (!text.empty()) {
+    size_t newline = text.find('\n');
+    absl::string_view line =
+        newline == absl::string_view::npos ? text : text.substr(0, newline);
+    if (!line.empty()) {
+      if (at_line_start_) {
+        for (int64 remaining = indent_; remaining > 0;
+             remaining -= kSpacesLength) {
+          Write(absl::string_view(kSpaces, std::min(remaining, kSpacesLength)));
+        }
+        at_line_start_ = false;
+      }
+      Write(line);
+      empty_regions_ = 0;
+    }
+    if (newline == absl::string_view::npos) {
+      return;
+    }
+    if (empty_regions_ == 0) {
+      Write("\n");
+      at_line_start_ = true;
+    }
+    text.remove_prefix(newline + 1);
+  }
+}
+
+FileDescriptorSink::FileDescriptorSink(int fd, int64 buffer_size)
+    : fd_(fd), buffer_size_(buffer_size) {
+  XLS_CHECK_GT(buffer_size_, 0);
+  buffer_.reserve(buffer_size_);
+}
+
+FileDescriptorSink::~FileDescriptorSink() { WriteBuffer(); }
+
+void FileDescriptorSink::Write(absl::string_view text) {
+  if (buffer_.size() + text.size() > buffer_size_) {
+    WriteBuffer();
+  }
+  buffer_.append(text.data(), text.size());
+}
+
+void FileDescriptorSink::WriteBuffer() {
+  absl::string_view remaining = buffer_;
+  while (status_.ok() && !remaining.empty()) {
+    ssize_t written = write(fd_, remaining.data(), remaining.size());
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      status_ = absl::InternalError(absl::StrFormat(
+          "Failed to write to file descriptor %d: %s", fd_, strerror(errno)));
+      break;
+    }
+    remaining.remove_prefix(written);
+  }
+  buffer_.clear();
+}
+
+absl::Status FileDescriptorSink::Flush() {
+  WriteBuffer();
+  return status_;
+}
+
+}  // namespace verilog
+}  // namespace xls
@@ -0,0 +1,118 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Output sinks into which VAST nodes emit Verilog text.
+
+#ifndef XLS_CODEGEN_VAST_SINK_H_
+#define XLS_CODEGEN_VAST_SINK_H_
+
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "xls/common/integral_types.h"
+
+namespace xls {
+namespace verilog {
+
+// Abstract destination for emitted Verilog text. The sink tracks the current
+// indentation level and prefixes every non-empty line with it as the line is
+// written, so nested constructs are emitted in a single pass without building
+// and re-indenting intermediate strings. Indentation follows the conventions of
+// xls::Indent: empty lines are not indented to avoid trailing white space, and
+// empty lines at the start of an indented region are dropped.
+class VastSink {
+ public:
+  virtual ~VastSink() = default;
+
+  // Appends the given text which may contain newlines.
+  void Append(absl::string_view text);
+
+  // Begins (ends) a region in which lines are indented by two more spaces. A
+  // region should begin at the start of a line.
+  void IncreaseIndent() {
+    indent_ += 2;
+    ++empty_regions_;
+  }
+  void DecreaseIndent() {
+    indent_ -= 2;
+    if (empty_regions_ > 0) {
+      --empty_regions_;
+    }
+  }
+
+  // Writes any buffered text to the underlying output. Returns an error if
+  // writing to the output failed at any point.
+  virtual absl::Status Flush() { return absl::OkStatus(); }
+
+ protected:
+  // Writes the given (already indented) text to the underlying output.
+  virtual void Write(absl::string_view text) = 0;
+
+ private:
+  int64 indent_ = 0;
+
+  // Whether the next character appended begins a new line.
+  bool at_line_start_ = true;
+
+  // The number of innermost open indented regions into which no text has been
+  // appended yet. Newlines are dropped while this is non-zero.
+  int64 empty_regions_ = 0;
+};
+
+// A sink which appends the text to a string.
+class StringSink : public VastSink {
+ public:
+  explicit StringSink(std::string* out) : out_(out) {}
+
+ protected:
+  void Write(absl::string_view text) override {
+    out_->append(text.data(), text.size());
+  }
+
+ private:
+  std::string* out_;
+};
+
+// A sink which writes the text to a file descriptor, buffering writes into
+// chunks of 'buffer_size' bytes. The file descriptor is not owned by the sink.
+// Write errors are sticky and are returned by Flush.
+class FileDescriptorSink : public VastSink {
+ public:
+  static constexpr int64 kDefaultBufferSize = 64 * 1024;
+
+  explicit FileDescriptorSink(int fd, int64 buffer_size = kDefaultBufferSize);
+
+  // Flushes the buffer. Errors are dropped; call Flush() to observe them.
+  ~FileDescriptorSink() override;
+
+  absl::Status Flush() override;
+
+ protected:
+  void Write(absl::string_view text) override;
+
+ private:
+  // Writes the contents of the buffer to the file descriptor and clears it.
+  void WriteBuffer();
+
+  int fd_;
+  int64 buffer_size_;
+  std::string buffer_;
+  absl::Status status_;
+};
+
+}  // namespace verilog
+}  // namespace xls
+
+#endif  // XLS_CODEGEN_VAST_SINK_H_
@@ -0,0 +1,103 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/codegen/vast_sink.h"
+
+#include <fcntl.h>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/temp_file.h"
+#include "xls/common/status/matchers.h"
+
+namespace xls {
+namespace verilog {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+using ::testing::HasSubstr;
+
+TEST(VastSinkTest, StringSink) {
+  std::string out;
+  StringSink sink(&out);
+  sink.Append("foo");
+  sink.Append("");
+  sink.Append("bar\nbaz");
+  EXPECT_EQ(out, "foobar\nbaz");
+}
+
+TEST(VastSinkTest, Indentation) {
+  std::string out;
+  StringSink sink(&out);
+  sink.Append("begin\n");
+  sink.IncreaseIndent();
+  // Empty lines at the start of an indented region are dropped.
+  sink.Append("\n");
+  sink.Append("foo;\n");
+  // Other empty lines are kept but not indented.
+  sink.Append("\n");
+  // Indentation is applied when the first text of a line is appended so a
+  // change of indentation at the end of a line affects the next line.
+  sink.IncreaseIndent();
+  sink.Append("bar ");
+  sink.DecreaseIndent();
+  sink.Append("baz;");
+  sink.DecreaseIndent();
+  sink.Append("\nend");
+  EXPECT_EQ(out, "begin\n  foo;\n\n    bar baz;\nend");
+}
+
+TEST(VastSinkTest, DeepIndentation) {
+  std::string out;
+  StringSink sink(&out);
+  for (int64 i = 0; i < 40; ++i) {
+    sink.IncreaseIndent();
+  }
+  sink.Append("x");
+  EXPECT_EQ(out, std::string(80, ' ') + "x");
+}
+
+TEST(VastSinkTest, FileDescriptorSink) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempFile temp_file, TempFile::Create());
+  int fd = open(temp_file.path().c_str(), O_WRONLY | O_TRUNC);
+  ASSERT_GE(fd, 0);
+  std::string expected;
+  {
+    // A small buffer exercises writes which span several buffer flushes.
+    FileDescriptorSink sink(fd, /*buffer_size=*/7);
+    sink.IncreaseIndent();
+    for (int64 i = 0; i < 100; ++i) {
+      sink.Append("line ");
+      sink.Append(std::to_string(i));
+      sink.Append("\n");
+      expected += "  line " + std::to_string(i) + "\n";
+    }
+    XLS_EXPECT_OK(sink.Flush());
+  }
+  close(fd);
+  EXPECT_THAT(GetFileContents(temp_file.path()), IsOkAndHolds(expected));
+}
+
+TEST(VastSinkTest, FileDescriptorSinkWriteError) {
+  FileDescriptorSink sink(/*fd=*/-1);
+  sink.Append("foo");
+  EXPECT_THAT(sink.Flush(), StatusIs(absl::StatusCode::kInternal,
+                                     HasSubstr("Failed to write")));
+}
+
+}  // namespace
+}  // namespace verilog
+}  // namespace xls
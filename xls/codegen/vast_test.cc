@@ -776,6 +776,54 @@ TEST(VastTest, VerilogFunctionWithRegDefs) {
 endmodule)");
 }
 
+TEST(VastTest, BlankLinesAndNestedIndentation) {
+  VerilogFile f;
+  Module* m = f.AddModule("top");
+  // Blank lines at the start of an indented block are dropped.
+  m->top()->Add<ModuleSection>(&f)->Add<BlankLine>();
+  m->Add<BlankLine>();
+  LogicRef* a = m->AddReg("a", 8);
+  LogicRef* b = m->AddWire("b", 8);
+  AlwaysComb* ac = m->Add<AlwaysComb>(&f);
+  ac->statements()->Add<BlankLine>();
+  Case* case_statement = ac->statements()->Add<Case>(&f, b);
+  case_statement->AddCaseArm(f.Literal(1, 8))
+      ->Add<BlockingAssignment>(a, f.Literal(2, 8));
+  StatementBlock* default_arm = case_statement->AddCaseArm(DefaultSentinel());
+  default_arm->Add<Comment>("two\nlines");
+  default_arm->Add<BlankLine>();
+  default_arm->Add<BlockingAssignment>(a, b);
+  m->Add<BlankLine>();
+  m->Add<BlankLine>();
+
+  const std::string expected = R"(module top;
+  reg [7:0] a;
+  wire [7:0] b;
+  always_comb begin
+    case (b)
+      8'h01: begin
+        a = 8'h02;
+      end
+      default: begin
+        // two
+        // lines
+
+        a = b;
+      end
+    endcase
+  end
+
+
+endmodule
+)";
+  EXPECT_EQ(f.Emit(), expected);
+
+  std::string streamed;
+  StringSink sink(&streamed);
+  f.EmitTo(&sink);
+  EXPECT_EQ(streamed, expected);
+}
+
 }  // namespace
 }  // namespace verilog
 }  // namespace xls
@@ -0,0 +1,105 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/common/file/memory_mapped_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "xls/common/file/filesystem.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/error_code_to_status.h"
+#include "xls/common/status/status_macros.h"
+
+namespace xls {
+namespace {
+
+// Returns a Status error based on the errno value. The error message includes
+// the filename.
+absl::Status ErrNoToStatusWithFilename(int errno_value,
+                                       const std::filesystem::path& file_name) {
+  xabsl::StatusBuilder builder = ErrnoToStatus(errno_value);
+  builder << file_name.string();
+  return std::move(builder);
+}
+
+}  // namespace
+
+/* static */ absl::StatusOr<MemoryMappedFile> MemoryMappedFile::Open(
+    const std::filesystem::path& file_name) {
+  int fd = open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return ErrNoToStatusWithFilename(errno, file_name);
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    int fstat_errno = errno;
+    close(fd);
+    return ErrNoToStatusWithFilename(fstat_errno, file_name);
+  }
+
+  MemoryMappedFile file;
+  if (!S_ISREG(file_stat.st_mode) || file_stat.st_size == 0) {
+    close(fd);
+    XLS_ASSIGN_OR_RETURN(file.buffer_, GetFileContents(file_name));
+    return std::move(file);
+  }
+
+  void* mapping =
+      mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping remains valid after the file descriptor is closed.
+  int mmap_errno = errno;
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return ErrNoToStatusWithFilename(mmap_errno, file_name);
+  }
+  file.mapping_ = mapping;
+  file.mapping_size_ = file_stat.st_size;
+  return std::move(file);
+}
+
+MemoryMappedFile::~MemoryMappedFile() { Unmap(); }
+
+MemoryMappedFile::MemoryMappedFile(MemoryMappedFile&& other)
+    : mapping_(other.mapping_),
+      mapping_size_(other.mapping_size_),
+      buffer_(std::move(other.buffer_)) {
+  other.mapping_ = nullptr;
+  other.mapping_size_ = 0;
+}
+
+MemoryMappedFile& MemoryMappedFile::operator=(MemoryMappedFile&& other) {
+  if (this != &other) {
+    Unmap();
+    mapping_ = other.mapping_;
+    mapping_size_ = other.mapping_size_;
+    buffer_ = std::move(other.buffer_);
+    other.mapping_ = nullptr;
+    other.mapping_size_ = 0;
+  }
+  return *this;
+}
+
+void MemoryMappedFile::Unmap() {
+  if (mapping_ != nullptr) {
+    XLS_CHECK_EQ(munmap(mapping_, mapping_size_), 0);
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+  }
+}
+
+}  // namespace xls
@@ -0,0 +1,67 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_COMMON_FILE_MEMORY_MAPPED_FILE_H_
+#define XLS_COMMON_FILE_MEMORY_MAPPED_FILE_H_
+
+#include <filesystem>
+#include <string>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace xls {
+
+// The read-only contents of a file, mapped into memory. The file is unmapped
+// when the object goes out of scope. Files which cannot be mapped, such as
+// pipes (e.g., /dev/stdin) or empty files, are read into memory instead.
+class MemoryMappedFile {
+ public:
+  static absl::StatusOr<MemoryMappedFile> Open(
+      const std::filesystem::path& file_name);
+
+  ~MemoryMappedFile();
+
+  // MemoryMappedFile is movable but not copyable.
+  MemoryMappedFile(MemoryMappedFile&& other);
+  MemoryMappedFile& operator=(MemoryMappedFile&& other);
+  MemoryMappedFile(const MemoryMappedFile&) = delete;
+  MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+  // Returns the contents of the file. The view is valid for the lifetime of
+  // this object.
+  absl::string_view contents() const {
+    return mapping_ == nullptr
+               ? absl::string_view(buffer_)
+               : absl::string_view(static_cast<const char*>(mapping_),
+                                   mapping_size_);
+  }
+
+  // Returns whether the contents are mapped rather than read into memory.
+  bool is_mapped() const { return mapping_ != nullptr; }
+
+ private:
+  MemoryMappedFile() = default;
+  void Unmap();
+
+  void* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+
+  // Holds the contents of files which are not mapped.
+  std::string buffer_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_COMMON_FILE_MEMORY_MAPPED_FILE_H_
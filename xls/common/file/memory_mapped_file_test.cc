@@ -0,0 +1,55 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/common/file/memory_mapped_file.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "xls/common/file/temp_file.h"
+#include "xls/common/status/matchers.h"
+
+namespace xls {
+namespace {
+
+using status_testing::StatusIs;
+
+TEST(MemoryMappedFileTest, MapsContents) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempFile temp_file,
+                           TempFile::CreateWithContent("hello\nworld\n"));
+  XLS_ASSERT_OK_AND_ASSIGN(MemoryMappedFile file,
+                           MemoryMappedFile::Open(temp_file.path()));
+  EXPECT_TRUE(file.is_mapped());
+  EXPECT_EQ(file.contents(), "hello\nworld\n");
+
+  // Moving the file keeps the mapping alive.
+  MemoryMappedFile moved = std::move(file);
+  EXPECT_EQ(moved.contents(), "hello\nworld\n");
+}
+
+TEST(MemoryMappedFileTest, EmptyFile) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempFile temp_file, TempFile::Create());
+  XLS_ASSERT_OK_AND_ASSIGN(MemoryMappedFile file,
+                           MemoryMappedFile::Open(temp_file.path()));
+  EXPECT_FALSE(file.is_mapped());
+  EXPECT_EQ(file.contents(), "");
+}
+
+TEST(MemoryMappedFileTest, NonexistentFile) {
+  EXPECT_THAT(MemoryMappedFile::Open("/this/file/does/not/exist"),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+}  // namespace
+}  // namespace xls
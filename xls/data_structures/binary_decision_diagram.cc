@@ -14,6 +14,7 @@
 
 #include "xls/data_structures/binary_decision_diagram.h"
 
+#include <algorithm>
 #include <limits>
 
 #include "absl/status/status.h"
@@ -26,40 +27,70 @@
 
 namespace xls {
 
-BinaryDecisionDiagram::BinaryDecisionDiagram() {
-  // Leaf node 0.
-  nodes_.push_back(BddNode(BddVariable(-1), BddNodeIndex(-1), BddNodeIndex(-1),
-                           /*m=*/0));
-  // Leaf node 1.
+namespace {
+
+// Initial number of entries in the if-then-else cache.
+constexpr int64 kInitialIteCacheSize = 1024;
+
+int32 SaturatingAdd(int32 a, int32 b) {
+  return std::min(static_cast<int64>(a) + b,
+                  static_cast<int64>(std::numeric_limits<int32>::max()));
+}
+
+}  // namespace
+
+BinaryDecisionDiagram::BinaryDecisionDiagram(int64 max_ite_cache_size)
+    : max_ite_cache_size_(max_ite_cache_size) {
+  XLS_CHECK_GT(max_ite_cache_size, 0);
+  XLS_CHECK_EQ(max_ite_cache_size & (max_ite_cache_size - 1), 0)
+      << "If-then-else cache size must be a power of two";
+  // The single leaf node is one; zero is its complement.
   nodes_.push_back(BddNode(BddVariable(-1), BddNodeIndex(-1), BddNodeIndex(-1),
-                           /*m=*/1));
+                           /*m=*/1, /*cm=*/0));
+  peak_node_count_ = 1;
+  ite_cache_.resize(std::min(kInitialIteCacheSize, max_ite_cache_size_));
 }
 
 BddNodeIndex BinaryDecisionDiagram::GetOrCreateNode(BddVariable var,
                                                     BddNodeIndex high,
                                                     BddNodeIndex low) {
+  if (low == high) {
+    return low;
+  }
+  // Keep the high child uncomplemented by complementing the node instead.
+  if (IsComplemented(high)) {
+    return Not(GetOrCreateNode(var, Not(high), Not(low)));
+  }
   NodeKey key = std::make_tuple(var, high, low);
   auto it = node_map_.find(key);
   if (it != node_map_.end()) {
     return it->second;
   }
-  if (low == high) {
-    return low;
+  // Compute the number of minterms that the new node will have, saturating at
+  // INT32_MAX.
+  BddNode node(var, high, low,
+               SaturatingAdd(minterm_count(high), minterm_count(low)),
+               SaturatingAdd(minterm_count(Not(high)), minterm_count(Not(low))));
+  int32 slot;
+  if (free_nodes_.empty()) {
+    slot = nodes_.size();
+    nodes_.push_back(node);
+  } else {
+    slot = free_nodes_.back();
+    free_nodes_.pop_back();
+    nodes_[slot] = node;
+  }
+  peak_node_count_ = std::max(peak_node_count_, size());
+  if (size() > ite_cache_.size() && ite_cache_.size() < max_ite_cache_size_) {
+    GrowIteCache();
   }
-  // Compute the number of minterms that the new node will have. Use int64s to
-  // avoid overflowing and saturate at INT32_MAX.
-  int32 minterms =
-      std::min(static_cast<int64>(GetNode(low).minterm_count) +
-                   GetNode(high).minterm_count,
-               static_cast<int64>(std::numeric_limits<int32>::max()));
-  nodes_.emplace_back(var, high, low, minterms);
-  BddNodeIndex node_index = BddNodeIndex(nodes_.size() - 1);
+  BddNodeIndex node_index = BddNodeIndex(slot << 1);
   node_map_[key] = node_index;
   return node_index;
 }
 
 BddNodeIndex BinaryDecisionDiagram::Restrict(BddNodeIndex expr, BddVariable var,
-                                             bool value) {
+                                             bool value) const {
   if (expr == zero() || expr == one()) {
     return expr;
   }
@@ -67,11 +98,31 @@ BddNodeIndex BinaryDecisionDiagram::Restrict(BddNodeIndex expr, BddVariable var,
   const BddNode& node = GetNode(expr);
   XLS_CHECK_LE(var, node.variable);
   if (node.variable == var) {
-    return value ? node.high : node.low;
+    BddNodeIndex child = value ? node.high : node.low;
+    return IsComplemented(expr) ? Not(child) : child;
   }
   return expr;
 }
 
+BinaryDecisionDiagram::IteCacheEntry& BinaryDecisionDiagram::GetIteCacheEntry(
+    BddNodeIndex cond, BddNodeIndex if_true, BddNodeIndex if_false) {
+  uint64 hash = static_cast<uint64>(cond.value()) * 0x9E3779B97F4A7C15ULL ^
+                static_cast<uint64>(if_true.value()) * 0xC2B2AE3D27D4EB4FULL ^
+                static_cast<uint64>(if_false.value()) * 0x165667B19E3779F9ULL;
+  hash ^= hash >> 29;
+  return ite_cache_[hash & (ite_cache_.size() - 1)];
+}
+
+void BinaryDecisionDiagram::GrowIteCache() {
+  std::vector<IteCacheEntry> old_cache(ite_cache_.size() * 2);
+  std::swap(old_cache, ite_cache_);
+  for (const IteCacheEntry& entry : old_cache) {
+    if (entry.cond.value() >= 0) {
+      GetIteCacheEntry(entry.cond, entry.if_true, entry.if_false) = entry;
+    }
+  }
+}
+
 BddNodeIndex BinaryDecisionDiagram::IfThenElse(BddNodeIndex cond,
                                                BddNodeIndex if_true,
                                                BddNodeIndex if_false) {
@@ -81,16 +132,49 @@ BddNodeIndex BinaryDecisionDiagram::IfThenElse(BddNodeIndex cond,
   if (cond == zero()) {
     return if_false;
   }
-  if (if_true == one() && if_false == zero()) {
-    return cond;
+  // Within the branches the value of the condition is known.
+  if (if_true == cond) {
+    if_true = one();
+  } else if (if_true == Not(cond)) {
+    if_true = zero();
+  }
+  if (if_false == cond) {
+    if_false = zero();
+  } else if (if_false == Not(cond)) {
+    if_false = one();
   }
   if (if_true == if_false) {
     return if_true;
   }
-  auto key = std::make_tuple(cond, if_true, if_false);
-  auto it = ite_map_.find(key);
-  if (it != ite_map_.end()) {
-    return it->second;
+  if (if_true == one() && if_false == zero()) {
+    return cond;
+  }
+  if (if_true == zero() && if_false == one()) {
+    return Not(cond);
+  }
+
+  // Normalize the expression so equivalent expressions share a cache entry:
+  // the condition and the if-true value are made uncomplemented by swapping
+  // the branches and complementing the result respectively.
+  if (IsComplemented(cond)) {
+    cond = Not(cond);
+    std::swap(if_true, if_false);
+  }
+  bool complement_result = false;
+  if (IsComplemented(if_true)) {
+    if_true = Not(if_true);
+    if_false = Not(if_false);
+    complement_result = true;
+  }
+
+  ++ite_cache_lookups_;
+  {
+    const IteCacheEntry& entry = GetIteCacheEntry(cond, if_true, if_false);
+    if (entry.cond == cond && entry.if_true == if_true &&
+        entry.if_false == if_false) {
+      ++ite_cache_hits_;
+      return complement_result ? Not(entry.result) : entry.result;
+    }
   }
 
   // The expression is non-trivial and has not been computed before. Recursively
@@ -120,33 +204,112 @@ BddNodeIndex BinaryDecisionDiagram::IfThenElse(BddNodeIndex cond,
                                            Restrict(if_true, min_var, false),
                                            Restrict(if_false, min_var, false));
 
-  if (true_cofactor == false_cofactor) {
-    ite_map_[key] = true_cofactor;
-    return true_cofactor;
-  }
   BddNodeIndex expr = GetOrCreateNode(min_var, true_cofactor, false_cofactor);
-  ite_map_[key] = expr;
-  return expr;
+  // The recursive calls may have grown the cache so look up the entry again.
+  IteCacheEntry& entry = GetIteCacheEntry(cond, if_true, if_false);
+  entry.cond = cond;
+  entry.if_true = if_true;
+  entry.if_false = if_false;
+  entry.result = expr;
+  return complement_result ? Not(expr) : expr;
 }
 
 BddNodeIndex BinaryDecisionDiagram::NewVariable() {
   BddVariable var = next_var_;
   ++next_var_;
-  return GetOrCreateNode(var, one(), zero());
-}
-
-BddNodeIndex BinaryDecisionDiagram::Not(BddNodeIndex expr) {
-  return IfThenElse(expr, zero(), one());
+  BddNodeIndex node = GetOrCreateNode(var, one(), zero());
+  variable_base_nodes_.push_back(node);
+  return node;
 }
 
 BddNodeIndex BinaryDecisionDiagram::Or(BddNodeIndex a, BddNodeIndex b) {
+  // Order the operands so commuted expressions share a cache entry.
+  if (a > b) {
+    std::swap(a, b);
+  }
   return IfThenElse(a, one(), b);
 }
 
 BddNodeIndex BinaryDecisionDiagram::And(BddNodeIndex a, BddNodeIndex b) {
+  if (a > b) {
+    std::swap(a, b);
+  }
   return IfThenElse(a, b, zero());
 }
 
+void BinaryDecisionDiagram::GarbageCollect(
+    absl::Span<const BddNodeIndex> roots) {
+  std::vector<bool> live(nodes_.size(), false);
+  std::vector<int32> worklist;
+  auto mark = [&](BddNodeIndex expr) {
+    int32 slot = expr.value() >> 1;
+    if (!live[slot]) {
+      live[slot] = true;
+      worklist.push_back(slot);
+    }
+  };
+  mark(one());
+  for (BddNodeIndex root : roots) {
+    mark(root);
+  }
+  for (BddNodeIndex base_node : variable_base_nodes_) {
+    mark(base_node);
+  }
+  while (!worklist.empty()) {
+    const BddNode& node = nodes_[worklist.back()];
+    worklist.pop_back();
+    if (node.variable.value() >= 0) {
+      mark(node.high);
+      mark(node.low);
+    }
+  }
+
+  // Freed nodes are marked with a negative variable.
+  int64 freed_count = 0;
+  for (int32 slot = 1; slot < nodes_.size(); ++slot) {
+    BddNode& node = nodes_[slot];
+    if (live[slot] || node.variable.value() < 0) {
+      continue;
+    }
+    node_map_.erase(std::make_tuple(node.variable, node.high, node.low));
+    node.variable = BddVariable(-1);
+    free_nodes_.push_back(slot);
+    ++freed_count;
+  }
+  auto is_freed = [&](BddNodeIndex expr) {
+    return nodes_[expr.value() >> 1].variable.value() < 0 &&
+           expr != one() && expr != zero();
+  };
+  for (IteCacheEntry& entry : ite_cache_) {
+    if (entry.cond.value() >= 0 &&
+        (is_freed(entry.cond) || is_freed(entry.if_true) ||
+         is_freed(entry.if_false) || is_freed(entry.result))) {
+      entry.cond = BddNodeIndex(-1);
+    }
+  }
+  ++gc_count_;
+  gc_freed_node_count_ += freed_count;
+  XLS_VLOG(2) << absl::StreamFormat(
+      "BDD garbage collection freed %d nodes, %d remain", freed_count, size());
+}
+
+BddStats BinaryDecisionDiagram::GetStats() const {
+  BddStats stats;
+  stats.node_count = size();
+  stats.peak_node_count = peak_node_count_;
+  stats.memory_bytes =
+      nodes_.capacity() * sizeof(BddNode) +
+      free_nodes_.capacity() * sizeof(int32) +
+      node_map_.capacity() * (sizeof(NodeKey) + sizeof(BddNodeIndex)) +
+      ite_cache_.capacity() * sizeof(IteCacheEntry);
+  stats.ite_cache_size = ite_cache_.size();
+  stats.ite_cache_lookups = ite_cache_lookups_;
+  stats.ite_cache_hits = ite_cache_hits_;
+  stats.gc_count = gc_count_;
+  stats.gc_freed_node_count = gc_freed_node_count_;
+  return stats;
+}
+
 absl::StatusOr<bool> BinaryDecisionDiagram::Evaluate(
     BddNodeIndex expr,
     const absl::flat_hash_map<BddNodeIndex, bool>& variable_values) const {
@@ -172,8 +335,8 @@ absl::StatusOr<bool> BinaryDecisionDiagram::Evaluate(
           absl::StrFormat("Missing value for BDD variable %d (node index %d)",
                           GetNode(result).variable.value(), var_node.value()));
     }
-    result = variable_values.at(var_node) ? GetNode(result).high
-                                          : GetNode(result).low;
+    result = Restrict(result, GetNode(result).variable,
+                      variable_values.at(var_node));
   }
   XLS_VLOG(2) << "  result = " << (result == one() ? true : false);
   return result == one();
@@ -204,11 +367,11 @@ void BinaryDecisionDiagram::ToStringDnfHelper(BddNodeIndex expr,
     return;
   }
 
-  const BddNode& node = GetNode(expr);
-  terms->push_back(absl::StrCat("x", node.variable.value()));
-  ToStringDnfHelper(node.high, minterms_to_emit, terms, str);
-  terms->back() = absl::StrCat("!x", node.variable.value());
-  ToStringDnfHelper(node.low, minterms_to_emit, terms, str);
+  BddVariable var = GetNode(expr).variable;
+  terms->push_back(absl::StrCat("x", var.value()));
+  ToStringDnfHelper(Restrict(expr, var, true), minterms_to_emit, terms, str);
+  terms->back() = absl::StrCat("!x", var.value());
+  ToStringDnfHelper(Restrict(expr, var, false), minterms_to_emit, terms, str);
   terms->pop_back();
 }
 
@@ -15,8 +15,11 @@
 #ifndef XLS_DATA_STRUCTURES_BINARY_DECISION_DIAGRAM_H_
 #define XLS_DATA_STRUCTURES_BINARY_DECISION_DIAGRAM_H_
 
+#include <vector>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "xls/common/integral_types.h"
 #include "xls/common/strong_int.h"
 
@@ -30,19 +33,36 @@ namespace xls {
 //   K.S. Brace, R.L. Rudell, and R.E. Bryant,
 //   "Efficient Implementation of a BDD package"
 //   https://ieeexplore.ieee.org/document/114826
+//
+// As described there, edges may be complemented so an expression and its
+// inverse share all their nodes and Not is a constant-time operation, and
+// if-then-else results are memoized in a fixed-size lossy cache (the "computed
+// table") rather than an unbounded map. Nodes no longer needed can be freed
+// with GarbageCollect.
 
 // For efficiency variables and nodes are referred to by indices into vector
-// data members in the BDD.
+// data members in the BDD. A BddNodeIndex refers to an expression: the low bit
+// indicates whether the expression is the complement of the node whose index
+// is held in the remaining bits.
 DEFINE_STRONG_INT_TYPE(BddVariable, int32);
 DEFINE_STRONG_INT_TYPE(BddNodeIndex, int32);
 
 // A node in the BDD. The node is associated with a single variable and has
 // children corresponding to when the variable is true (high) and when it is
-// false (low).
+// false (low). The high child is never complemented.
 struct BddNode {
-  BddNode() : variable(0), high(0), low(0), minterm_count(0) {}
-  BddNode(BddVariable v, BddNodeIndex h, BddNodeIndex l, int32 m)
-      : variable(v), high(h), low(l), minterm_count(m) {}
+  BddNode()
+      : variable(0),
+        high(0),
+        low(0),
+        minterm_count(0),
+        complement_minterm_count(0) {}
+  BddNode(BddVariable v, BddNodeIndex h, BddNodeIndex l, int32 m, int32 cm)
+      : variable(v),
+        high(h),
+        low(l),
+        minterm_count(m),
+        complement_minterm_count(cm) {}
 
   BddVariable variable;
   BddNodeIndex high;
@@ -52,28 +72,60 @@ struct BddNode {
   // sum-of-products form of the boolean function, or equivalently a path to the
   // leaf node '1' from the BDD node. Saturates at INT32_MAX.
   int32 minterm_count;
+
+  // Number of minterms in the complement of the expression (paths to the leaf
+  // node '0'). Saturates at INT32_MAX.
+  int32 complement_minterm_count;
+};
+
+// Counters describing the size and behavior of a BDD.
+struct BddStats {
+  // Number of nodes currently in the BDD, and the most there have been.
+  int64 node_count = 0;
+  int64 peak_node_count = 0;
+
+  // Approximate number of bytes allocated for nodes, the node lookup table
+  // and the if-then-else cache.
+  int64 memory_bytes = 0;
+
+  // Number of entries in the if-then-else cache, and the number of lookups in
+  // it and how many of those found a result.
+  int64 ite_cache_size = 0;
+  int64 ite_cache_lookups = 0;
+  int64 ite_cache_hits = 0;
+
+  // Number of garbage collections, and the total number of nodes they freed.
+  int64 gc_count = 0;
+  int64 gc_freed_node_count = 0;
 };
 
 class BinaryDecisionDiagram {
  public:
   // Creates an empty BDD. Initialize the BDD contains only the nodes
-  // corresponding to zero and one.
-  BinaryDecisionDiagram();
+  // corresponding to zero and one. The if-then-else cache grows with the
+  // number of nodes up to 'max_ite_cache_size' entries, which must be a power
+  // of two.
+  explicit BinaryDecisionDiagram(
+      int64 max_ite_cache_size = kDefaultMaxIteCacheSize);
+
+  static constexpr int64 kDefaultMaxIteCacheSize = int64{1} << 20;
 
   // Adds a new variable to the BDD and returns the node corresponding the
   // variable's value.
   BddNodeIndex NewVariable();
 
   // Returns the inverse of the given expression.
-  BddNodeIndex Not(BddNodeIndex expr);
+  BddNodeIndex Not(BddNodeIndex expr) const {
+    return BddNodeIndex(expr.value() ^ 1);
+  }
 
   // Returns the OR/AND of the given expressions.
   BddNodeIndex And(BddNodeIndex a, BddNodeIndex b);
   BddNodeIndex Or(BddNodeIndex a, BddNodeIndex b);
 
   // Returns the leaf node corresponding to zero or one.
-  BddNodeIndex zero() const { return BddNodeIndex(0); }
-  BddNodeIndex one() const { return BddNodeIndex(1); }
+  BddNodeIndex zero() const { return BddNodeIndex(1); }
+  BddNodeIndex one() const { return BddNodeIndex(0); }
 
   // Evaluates the given expression with the given variable values. The keys in
   // the map are the *node* indices of the respective variable (value returned
@@ -83,20 +135,26 @@ class BinaryDecisionDiagram {
       BddNodeIndex expr,
       const absl::flat_hash_map<BddNodeIndex, bool>& variable_values) const;
 
-  // Returns the BDD node with the given index.
+  // Returns the BDD node of the given expression. If the expression is
+  // complemented, the node (and its children) are those of the uncomplemented
+  // expression.
   const BddNode& GetNode(BddNodeIndex node_index) const {
-    return nodes_.at(node_index.value());
+    return nodes_.at(node_index.value() >> 1);
   }
 
+  // Returns true if the given expression is the complement of its node.
+  static bool IsComplemented(BddNodeIndex expr) { return expr.value() & 1; }
+
   // Returns the number of nodes in the graph.
-  int64 size() const { return nodes_.size(); }
+  int64 size() const { return nodes_.size() - free_nodes_.size(); }
 
   // Returns the number of variables in the graph.
   int64 variable_count() const { return next_var_.value(); }
 
   // Returns the number of minterms in the given expression.
   int64 minterm_count(BddNodeIndex expr) const {
-    return GetNode(expr).minterm_count;
+    return IsComplemented(expr) ? GetNode(expr).complement_minterm_count
+                                : GetNode(expr).minterm_count;
   }
 
   // Returns the given expression in disjunctive normal form (sum of products).
@@ -108,10 +166,28 @@ class BinaryDecisionDiagram {
   // variable. The expression of a base node is exactly equal to the value of
   // the variable.
   bool IsVariableBaseNode(BddNodeIndex expr) const {
-    return GetNode(expr).high == one() && GetNode(expr).low == zero();
+    return !IsComplemented(expr) && GetNode(expr).high == one() &&
+           GetNode(expr).low == zero();
   }
 
+  // Frees all nodes which are not part of the given expressions or of the
+  // variables' base nodes. The remaining expressions keep their indices; the
+  // indices of freed nodes are reused for nodes created later, so any
+  // expression not included in 'roots' must not be used afterwards.
+  void GarbageCollect(absl::Span<const BddNodeIndex> roots);
+
+  // Returns counters describing the BDD.
+  BddStats GetStats() const;
+
  private:
+  // An entry in the if-then-else cache. An empty entry has a negative 'cond'.
+  struct IteCacheEntry {
+    BddNodeIndex cond = BddNodeIndex(-1);
+    BddNodeIndex if_true;
+    BddNodeIndex if_false;
+    BddNodeIndex result;
+  };
+
   // Helper for constructing a DNF string respresentation.
   void ToStringDnfHelper(BddNodeIndex expr, int64* minterms_to_emit,
                          std::vector<std::string>* terms,
@@ -124,23 +200,36 @@ class BinaryDecisionDiagram {
 
   // Returns the node equal to given expression with the given variable
   // set to the given value.
-  BddNodeIndex Restrict(BddNodeIndex expr, BddVariable var, bool value);
+  BddNodeIndex Restrict(BddNodeIndex expr, BddVariable var, bool value) const;
 
   // Returns the node corresponding to the given if-then-else expression.
   BddNodeIndex IfThenElse(BddNodeIndex cond, BddNodeIndex if_true,
                           BddNodeIndex if_false);
 
+  // Returns the cache entry slot for the given if-then-else expression.
+  IteCacheEntry& GetIteCacheEntry(BddNodeIndex cond, BddNodeIndex if_true,
+                                  BddNodeIndex if_false);
+
+  // Doubles the size of the if-then-else cache, keeping its entries.
+  void GrowIteCache();
+
   // Returns the node corresponding to the value of the given variable.
   BddNodeIndex GetVariableBaseNode(BddVariable variable) const {
-    return node_map_.at({variable, one(), zero()});
+    return variable_base_nodes_.at(variable.value());
   }
 
   // The numeric id to use for the next created variable. Increments with each
   // call to NewVariable which
   BddVariable next_var_ = BddVariable(0);
 
-  // The vector of all the nodes in the BDD.
+  // The vector of all the nodes in the BDD, and the indices of those which
+  // have been freed by garbage collection and may be reused.
   std::vector<BddNode> nodes_;
+  std::vector<int32> free_nodes_;
+  int64 peak_node_count_ = 0;
+
+  // The base node of each variable, indexed by variable.
+  std::vector<BddNodeIndex> variable_base_nodes_;
 
   // A map from BDD node content (variable id, high child, low child) to the
   // index of the respective node. This map is used to ensure that no duplicate
@@ -148,11 +237,16 @@ class BinaryDecisionDiagram {
   using NodeKey = std::tuple<BddVariable, BddNodeIndex, BddNodeIndex>;
   absl::flat_hash_map<NodeKey, BddNodeIndex> node_map_;
 
-  // A map from if-then-else expression to the node corresponding to that
-  // expression. The key elements are (condition, if-true, if-false). This map
-  // enables fast lookup for expressions.
-  using IteKey = std::tuple<BddNodeIndex, BddNodeIndex, BddNodeIndex>;
-  absl::flat_hash_map<IteKey, BddNodeIndex> ite_map_;
+  // A direct-mapped cache from if-then-else expression to the node
+  // corresponding to that expression. On a collision the older entry is
+  // overwritten, so the cache bounds the memory spent on memoization.
+  std::vector<IteCacheEntry> ite_cache_;
+  int64 max_ite_cache_size_;
+  int64 ite_cache_lookups_ = 0;
+  int64 ite_cache_hits_ = 0;
+
+  int64 gc_count_ = 0;
+  int64 gc_freed_node_count_ = 0;
 };
 
 }  // namespace xls
@@ -306,5 +306,103 @@ TEST(BinaryDecisionDiagramTest, ThreeVariableExhaustive) {
   }
 }
 
+TEST(BinaryDecisionDiagramTest, ComplementEdges) {
+  BinaryDecisionDiagram bdd;
+  BddNodeIndex x0 = bdd.NewVariable();
+  BddNodeIndex x1 = bdd.NewVariable();
+  BddNodeIndex x0_and_x1 = bdd.And(x0, x1);
+
+  // Negation shares all nodes with the negated expression.
+  int64 before_size = bdd.size();
+  BddNodeIndex nand = bdd.Not(x0_and_x1);
+  EXPECT_EQ(bdd.size(), before_size);
+  EXPECT_EQ(bdd.Not(nand), x0_and_x1);
+  EXPECT_EQ(bdd.Not(bdd.zero()), bdd.one());
+  EXPECT_EQ(nand, bdd.Or(bdd.Not(x0), bdd.Not(x1)));
+  EXPECT_EQ(bdd.size(), before_size);
+
+  EXPECT_EQ(bdd.minterm_count(x0_and_x1), 1);
+  EXPECT_EQ(bdd.minterm_count(nand), 2);
+  EXPECT_EQ(bdd.ToStringDnf(nand), "x0.!x1 + !x0");
+  for (bool v0 : {false, true}) {
+    for (bool v1 : {false, true}) {
+      EXPECT_THAT(bdd.Evaluate(nand, {{x0, v0}, {x1, v1}}),
+                  IsOkAndHolds(!(v0 && v1)));
+    }
+  }
+}
+
+TEST(BinaryDecisionDiagramTest, GarbageCollect) {
+  BinaryDecisionDiagram bdd;
+  std::vector<BddNodeIndex> variables;
+  for (int64 i = 0; i < 16; ++i) {
+    variables.push_back(bdd.NewVariable());
+  }
+  auto make_parity = [&]() {
+    BddNodeIndex parity = bdd.zero();
+    for (BddNodeIndex variable : variables) {
+      parity = bdd.Or(bdd.And(parity, bdd.Not(variable)),
+                      bdd.And(bdd.Not(parity), variable));
+    }
+    return parity;
+  };
+  BddNodeIndex x0_or_x1 = bdd.Or(variables[0], variables[1]);
+  make_parity();
+  int64 size_with_parity = bdd.size();
+
+  bdd.GarbageCollect({x0_or_x1});
+  EXPECT_LT(bdd.size(), size_with_parity);
+  EXPECT_EQ(bdd.GetStats().gc_count, 1);
+  EXPECT_EQ(bdd.GetStats().gc_freed_node_count, size_with_parity - bdd.size());
+  EXPECT_EQ(bdd.GetStats().peak_node_count, size_with_parity);
+
+  // The root and the variables are still usable.
+  EXPECT_EQ(bdd.Or(variables[1], variables[0]), x0_or_x1);
+  EXPECT_THAT(bdd.Evaluate(x0_or_x1, {{variables[0], false},
+                                      {variables[1], false}}),
+              IsOkAndHolds(false));
+  EXPECT_THAT(bdd.Evaluate(variables[7], {{variables[7], true}}),
+              IsOkAndHolds(true));
+
+  // Rebuilding the expression reuses the freed nodes.
+  int64 allocated_bytes = bdd.GetStats().memory_bytes;
+  BddNodeIndex parity = make_parity();
+  EXPECT_EQ(bdd.size(), size_with_parity);
+  EXPECT_EQ(bdd.GetStats().memory_bytes, allocated_bytes);
+  absl::flat_hash_map<BddNodeIndex, bool> values;
+  for (int64 i = 0; i < variables.size(); ++i) {
+    values[variables[i]] = i % 3 == 0;
+  }
+  EXPECT_THAT(bdd.Evaluate(parity, values), IsOkAndHolds(false));
+  values[variables[1]] = true;
+  EXPECT_THAT(bdd.Evaluate(parity, values), IsOkAndHolds(true));
+}
+
+TEST(BinaryDecisionDiagramTest, SmallIteCache) {
+  // A cache with a single entry has few hits but gives the same results.
+  BinaryDecisionDiagram bdd(/*max_ite_cache_size=*/1);
+  BinaryDecisionDiagram reference_bdd;
+  std::vector<BddNodeIndex> vars;
+  std::vector<BddNodeIndex> reference_vars;
+  for (int64 i = 0; i < 8; ++i) {
+    vars.push_back(bdd.NewVariable());
+    reference_vars.push_back(reference_bdd.NewVariable());
+  }
+  BddNodeIndex expr = bdd.zero();
+  BddNodeIndex reference_expr = reference_bdd.zero();
+  for (int64 i = 0; i < 8; i += 2) {
+    expr = bdd.Or(expr, bdd.And(vars[i], bdd.Not(vars[i + 1])));
+    reference_expr = reference_bdd.Or(
+        reference_expr,
+        reference_bdd.And(reference_vars[i],
+                          reference_bdd.Not(reference_vars[i + 1])));
+  }
+  EXPECT_EQ(bdd.GetStats().ite_cache_size, 1);
+  EXPECT_EQ(bdd.size(), reference_bdd.size());
+  EXPECT_EQ(bdd.minterm_count(expr), reference_bdd.minterm_count(reference_expr));
+  EXPECT_EQ(bdd.ToStringDnf(expr), reference_bdd.ToStringDnf(reference_expr));
+  EXPECT_GT(reference_bdd.GetStats().ite_cache_hits, 0);
+}
+
 }  // namespace
 }  // namespace xls
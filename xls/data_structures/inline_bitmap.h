@@ -15,6 +15,8 @@
 #ifndef XLS_DATA_STRUCTURES_INLINE_BITMAP_H_
 #define XLS_DATA_STRUCTURES_INLINE_BITMAP_H_
 
+#include <utility>
+
 #include "absl/base/casts.h"
 #include "absl/container/inlined_vector.h"
 #include "xls/common/bits_util.h"
@@ -24,7 +26,9 @@
 
 namespace xls {
 
-// A bitmap that has 64-bits of inline storage by default.
+// A bitmap that has 128 bits of inline storage, so bitmaps of up to 128 bits
+// require no heap allocation. The bits of the last word beyond bit_count() are
+// always zero.
 class InlineBitmap {
  public:
   static InlineBitmap FromWord(uint64 word, int64 bit_count, bool fill) {
@@ -40,6 +44,9 @@ class InlineBitmap {
         data_(CeilOfRatio(bit_count, kWordBits),
               fill ? -1ULL : 0ULL) {
     XLS_DCHECK_GE(bit_count, 0);
+    if (fill && bit_count != 0) {
+      MaskLastWord();
+    }
   }
 
   bool operator==(const InlineBitmap& other) const {
@@ -58,6 +65,16 @@ class InlineBitmap {
   }
   bool operator!=(const InlineBitmap& other) const { return !(*this == other); }
 
+  template <typename H>
+  friend H AbslHashValue(H h, const InlineBitmap& bitmap) {
+    h = H::combine(std::move(h), bitmap.bit_count_);
+    for (int64 wordno = 0; wordno < bitmap.word_count(); ++wordno) {
+      h = H::combine(std::move(h),
+                     bitmap.data_[wordno] & bitmap.MaskForWord(wordno));
+    }
+    return h;
+  }
+
   int64 bit_count() const { return bit_count_; }
   bool IsAllOnes() const {
     for (int64 wordno = 0; wordno < word_count(); ++wordno) {
@@ -106,6 +123,14 @@ class InlineBitmap {
     return data_[wordno];
   }
 
+  // Sets the 64-bit word "wordno". Bits beyond bit_count() are discarded.
+  void SetWord(int64 wordno, uint64 value) {
+    XLS_DCHECK_LT(wordno, word_count());
+    data_[wordno] = value & MaskForWord(wordno);
+  }
+
+  int64 word_count() const { return data_.size(); }
+
   // Sets a byte in the data underlying the bitmap.
   //
   // Setting byte i as {b_7, b_6, b_5, ..., b_0} sets the bit at i*8 to b_0, the
@@ -136,7 +161,6 @@ class InlineBitmap {
  private:
   static constexpr int64 kWordBits = 64;
   static constexpr int64 kWordBytes = 8;
-  int64 word_count() const { return data_.size(); }
 
   void MaskLastWord() {
     int64 last_wordno = word_count() - 1;
@@ -151,7 +175,7 @@ class InlineBitmap {
   }
 
   int64 bit_count_;
-  absl::InlinedVector<uint64, 1> data_;
+  absl::InlinedVector<uint64, 2> data_;
 };
 
 }  // namespace xls
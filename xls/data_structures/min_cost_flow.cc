@@ -0,0 +1,415 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/data_structures/min_cost_flow.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+
+namespace xls {
+namespace min_cost_flow {
+
+NodeId Network::AddNode(int64 supply) {
+  supplies_.push_back(supply);
+  return NodeId(supplies_.size() - 1);
+}
+
+ArcId Network::AddArc(NodeId source, NodeId target, int64 cost,
+                      int64 capacity) {
+  XLS_CHECK_LT(static_cast<int64>(source), node_count());
+  XLS_CHECK_LT(static_cast<int64>(target), node_count());
+  XLS_CHECK_GE(capacity, 0);
+  arcs_.push_back(Arc{source, target, cost, capacity});
+  return ArcId(arcs_.size() - 1);
+}
+
+namespace {
+
+// Implementation of the primal network simplex method. The network is extended
+// with an artificial root node and an artificial arc between the root and
+// every node, which form the initial spanning tree. The spanning tree is kept
+// strongly feasible (positive flow can be sent from every node to the root
+// along the tree) which prevents cycling on degenerate pivots.
+//
+// Internally the potentials 'pi_' follow the convention that the reduced cost
+// of arc (u, v) is 'cost + pi[u] - pi[v]'; the exported potentials are
+// negated.
+class NetworkSimplex {
+ public:
+  explicit NetworkSimplex(const Network& network);
+
+  absl::StatusOr<Flow> Solve();
+
+ private:
+  // The state of an arc. Non-tree arcs are at their lower (zero) or upper
+  // (capacity) bound of flow. The values are chosen such that an arc may enter
+  // the tree if state * reduced_cost < 0.
+  enum State : int8 { kUpper = -1, kTree = 0, kLower = 1 };
+
+  // Direction of the tree arc connecting a node to its parent.
+  enum Direction : int8 {
+    // The arc extends from the node to its parent.
+    kUp = 1,
+    // The arc extends from the parent to the node.
+    kDown = -1
+  };
+
+  static constexpr int64 kInfinity = std::numeric_limits<int64>::max();
+
+  int64 ReducedCost(int64 arc) const {
+    return cost_[arc] + pi_[source_[arc]] - pi_[target_[arc]];
+  }
+
+  // Returns the amount by which the flow along the arc may be increased.
+  int64 Headroom(int64 arc) const {
+    return capacity_[arc] == kUnboundedCapacity ? kInfinity
+                                                : capacity_[arc] - flow_[arc];
+  }
+
+  // Selects a non-tree arc whose reduced cost is improving and returns it, or
+  // returns -1 if the flow is optimal. Arcs are scanned in blocks starting
+  // where the previous search left off; the most improving arc of the first
+  // block containing any improving arc is chosen.
+  int64 FindEnteringArc();
+
+  // Adds the given arc to the spanning tree, pushes flow around the resulting
+  // cycle and removes the arc which limits the flow from the tree.
+  absl::Status Pivot(int64 in_arc);
+
+  void AddChild(int64 parent, int64 child);
+  void RemoveChild(int64 child);
+
+  // The number of nodes and arcs of the network. The artificial root and arcs
+  // are numbered after them.
+  int64 node_count_;
+  int64 arc_count_;
+  int64 root_;
+
+  // Arc data indexed by arc number.
+  std::vector<int64> source_;
+  std::vector<int64> target_;
+  std::vector<int64> cost_;
+  std::vector<int64> capacity_;
+  std::vector<int64> flow_;
+  std::vector<int8> state_;
+
+  // Spanning tree data indexed by node number. 'pred_' is the tree arc
+  // connecting the node to its parent. Children are kept in a doubly linked
+  // list so that subtrees can be moved in time proportional to their size.
+  std::vector<int64> parent_;
+  std::vector<int64> pred_;
+  std::vector<int8> pred_direction_;
+  std::vector<int64> depth_;
+  std::vector<int64> pi_;
+  std::vector<int64> first_child_;
+  std::vector<int64> next_sibling_;
+  std::vector<int64> prev_sibling_;
+
+  int64 block_size_;
+  int64 next_arc_ = 0;
+
+  // Scratch space for Pivot.
+  std::vector<int64> path_;
+  std::vector<int64> stack_;
+};
+
+NetworkSimplex::NetworkSimplex(const Network& network)
+    : node_count_(network.node_count()),
+      arc_count_(network.arc_count()),
+      root_(network.node_count()) {
+  const int64 total_nodes = node_count_ + 1;
+  const int64 total_arcs = arc_count_ + node_count_;
+  source_.reserve(total_arcs);
+  target_.reserve(total_arcs);
+  cost_.reserve(total_arcs);
+  capacity_.reserve(total_arcs);
+  int64 max_cost = 0;
+  for (int64 i = 0; i < arc_count_; ++i) {
+    const Arc& arc = network.arc(ArcId(i));
+    source_.push_back(static_cast<int64>(arc.source));
+    target_.push_back(static_cast<int64>(arc.target));
+    cost_.push_back(arc.cost);
+    capacity_.push_back(arc.capacity);
+    max_cost = std::max(max_cost, std::abs(arc.cost));
+  }
+  flow_.assign(total_arcs, 0);
+  state_.assign(total_arcs, kLower);
+
+  parent_.assign(total_nodes, -1);
+  pred_.assign(total_nodes, -1);
+  pred_direction_.assign(total_nodes, kUp);
+  depth_.assign(total_nodes, 0);
+  pi_.assign(total_nodes, 0);
+  first_child_.assign(total_nodes, -1);
+  next_sibling_.assign(total_nodes, -1);
+  prev_sibling_.assign(total_nodes, -1);
+
+  // The artificial arcs are more expensive than any path of network arcs so
+  // they carry no flow in an optimal solution if a feasible flow exists.
+  const int64 artificial_cost = (max_cost + 1) * total_nodes;
+  for (int64 u = 0; u < node_count_; ++u) {
+    const int64 arc = arc_count_ + u;
+    const int64 supply = network.supply(NodeId(u));
+    cost_.push_back(artificial_cost);
+    capacity_.push_back(kUnboundedCapacity);
+    state_[arc] = kTree;
+    parent_[u] = root_;
+    pred_[u] = arc;
+    depth_[u] = 1;
+    AddChild(root_, u);
+    // Arcs with zero flow must point toward the root for the tree to be
+    // strongly feasible.
+    if (supply >= 0) {
+      source_.push_back(u);
+      target_.push_back(root_);
+      flow_[arc] = supply;
+      pred_direction_[u] = kUp;
+      pi_[u] = -artificial_cost;
+    } else {
+      source_.push_back(root_);
+      target_.push_back(u);
+      flow_[arc] = -supply;
+      pred_direction_[u] = kDown;
+      pi_[u] = artificial_cost;
+    }
+  }
+
+  block_size_ = std::max<int64>(
+      10, static_cast<int64>(std::ceil(std::sqrt(total_arcs))));
+}
+
+void NetworkSimplex::AddChild(int64 parent, int64 child) {
+  prev_sibling_[child] = -1;
+  next_sibling_[child] = first_child_[parent];
+  if (first_child_[parent] != -1) {
+    prev_sibling_[first_child_[parent]] = child;
+  }
+  first_child_[parent] = child;
+}
+
+void NetworkSimplex::RemoveChild(int64 child) {
+  if (prev_sibling_[child] == -1) {
+    first_child_[parent_[child]] = next_sibling_[child];
+  } else {
+    next_sibling_[prev_sibling_[child]] = next_sibling_[child];
+  }
+  if (next_sibling_[child] != -1) {
+    prev_sibling_[next_sibling_[child]] = prev_sibling_[child];
+  }
+}
+
+int64 NetworkSimplex::FindEnteringArc() {
+  const int64 total_arcs = source_.size();
+  int64 best_arc = -1;
+  int64 best_value = 0;
+  int64 remaining_in_block = block_size_;
+  for (int64 i = 0; i < total_arcs; ++i) {
+    int64 arc = next_arc_ + i;
+    if (arc >= total_arcs) {
+      arc -= total_arcs;
+    }
+    const int64 value = state_[arc] * ReducedCost(arc);
+    if (value < best_value) {
+      best_value = value;
+      best_arc = arc;
+    }
+    if (--remaining_in_block == 0) {
+      if (best_arc != -1) {
+        next_arc_ = arc + 1 == total_arcs ? 0 : arc + 1;
+        return best_arc;
+      }
+      remaining_in_block = block_size_;
+    }
+  }
+  return best_arc;
+}
+
+absl::Status NetworkSimplex::Pivot(int64 in_arc) {
+  // Flow is pushed around the cycle formed by the entering arc and the tree
+  // paths from its end points to their nearest common ancestor 'join': along
+  // the entering arc from 'first' to 'second', up the tree from 'second' to
+  // 'join' and down the tree from 'join' to 'first'.
+  int64 first = source_[in_arc];
+  int64 second = target_[in_arc];
+  if (state_[in_arc] == kUpper) {
+    std::swap(first, second);
+  }
+  int64 u = source_[in_arc];
+  int64 v = target_[in_arc];
+  while (u != v) {
+    if (depth_[u] >= depth_[v]) {
+      u = parent_[u];
+    } else {
+      v = parent_[v];
+    }
+  }
+  const int64 join = u;
+
+  // Find the arc limiting the flow around the cycle. Ties are broken in favor
+  // of the last limiting arc in the direction of the cycle starting at 'join',
+  // which keeps the tree strongly feasible.
+  int64 delta = capacity_[in_arc] == kUnboundedCapacity ? kInfinity
+                                                          : capacity_[in_arc];
+  int64 out_node = -1;
+  bool out_on_first_side = false;
+  for (int64 w = first; w != join; w = parent_[w]) {
+    const int64 arc = pred_[w];
+    const int64 residual =
+        pred_direction_[w] == kDown ? Headroom(arc) : flow_[arc];
+    if (residual < delta) {
+      delta = residual;
+      out_node = w;
+      out_on_first_side = true;
+    }
+  }
+  for (int64 w = second; w != join; w = parent_[w]) {
+    const int64 arc = pred_[w];
+    const int64 residual =
+        pred_direction_[w] == kUp ? Headroom(arc) : flow_[arc];
+    if (residual <= delta) {
+      delta = residual;
+      out_node = w;
+      out_on_first_side = false;
+    }
+  }
+  if (delta == kInfinity) {
+    return absl::InvalidArgumentError(
+        "Min cost flow is unbounded: network contains a negative cost cycle "
+        "of uncapacitated arcs");
+  }
+
+  if (delta > 0) {
+    const int64 value = state_[in_arc] * delta;
+    flow_[in_arc] += value;
+    for (int64 w = source_[in_arc]; w != join; w = parent_[w]) {
+      flow_[pred_[w]] -= pred_direction_[w] * value;
+    }
+    for (int64 w = target_[in_arc]; w != join; w = parent_[w]) {
+      flow_[pred_[w]] += pred_direction_[w] * value;
+    }
+  }
+
+  if (out_node == -1) {
+    // The entering arc itself limits the flow and moves to its other bound.
+    state_[in_arc] = -state_[in_arc];
+    return absl::OkStatus();
+  }
+  const int64 out_arc = pred_[out_node];
+  state_[in_arc] = kTree;
+  state_[out_arc] = flow_[out_arc] == 0 ? kLower : kUpper;
+
+  // Removing the leaving arc splits off the subtree rooted at 'out_node' which
+  // contains the end point 'in_node' of the entering arc. Re-hang the subtree
+  // from 'in_node' by reversing the tree path from 'in_node' to 'out_node' and
+  // attach it to the other end point of the entering arc.
+  const int64 in_node = out_on_first_side ? first : second;
+  const int64 attach_node = out_on_first_side ? second : first;
+  path_.clear();
+  for (int64 w = in_node;; w = parent_[w]) {
+    path_.push_back(w);
+    if (w == out_node) {
+      break;
+    }
+  }
+  for (int64 w : path_) {
+    RemoveChild(w);
+  }
+  int64 new_parent = attach_node;
+  int64 new_pred = in_arc;
+  int8 new_direction = source_[in_arc] == in_node ? kUp : kDown;
+  for (int64 w : path_) {
+    const int64 old_pred = pred_[w];
+    const int8 old_direction = pred_direction_[w];
+    parent_[w] = new_parent;
+    pred_[w] = new_pred;
+    pred_direction_[w] = new_direction;
+    AddChild(new_parent, w);
+    new_parent = w;
+    new_pred = old_pred;
+    new_direction = -old_direction;
+  }
+
+  // The reduced cost of the entering arc must become zero. Shift the
+  // potentials of the moved subtree accordingly and update depths.
+  const int64 new_pi = source_[in_arc] == in_node
+                           ? pi_[attach_node] - cost_[in_arc]
+                           : pi_[attach_node] + cost_[in_arc];
+  const int64 sigma = new_pi - pi_[in_node];
+  stack_.assign({in_node});
+  while (!stack_.empty()) {
+    const int64 w = stack_.back();
+    stack_.pop_back();
+    pi_[w] += sigma;
+    depth_[w] = depth_[parent_[w]] + 1;
+    for (int64 c = first_child_[w]; c != -1; c = next_sibling_[c]) {
+      stack_.push_back(c);
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<Flow> NetworkSimplex::Solve() {
+  int64 pivots = 0;
+  for (int64 in_arc = FindEnteringArc(); in_arc != -1;
+       in_arc = FindEnteringArc()) {
+    XLS_RETURN_IF_ERROR(Pivot(in_arc));
+    ++pivots;
+  }
+  XLS_VLOG(3) << absl::StreamFormat(
+      "Network simplex: %d nodes, %d arcs, %d pivots", node_count_, arc_count_,
+      pivots);
+
+  for (int64 arc = arc_count_; arc < source_.size(); ++arc) {
+    if (flow_[arc] != 0) {
+      return absl::InvalidArgumentError(
+          "Min cost flow is infeasible: supplies cannot be routed to demands");
+    }
+  }
+
+  Flow result;
+  result.cost = 0;
+  result.arc_flows.assign(flow_.begin(), flow_.begin() + arc_count_);
+  for (int64 arc = 0; arc < arc_count_; ++arc) {
+    result.cost += cost_[arc] * flow_[arc];
+  }
+  result.potentials.reserve(node_count_);
+  for (int64 u = 0; u < node_count_; ++u) {
+    result.potentials.push_back(-pi_[u]);
+  }
+  return result;
+}
+
+}  // namespace
+
+absl::StatusOr<Flow> SolveMinCostFlow(const Network& network) {
+  int64 total_supply = 0;
+  for (int64 u = 0; u < network.node_count(); ++u) {
+    total_supply += network.supply(NodeId(u));
+  }
+  if (total_supply != 0) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Total supply of min cost flow network must be zero, is %d",
+        total_supply));
+  }
+  return NetworkSimplex(network).Solve();
+}
+
+}  // namespace min_cost_flow
+}  // namespace xls
@@ -0,0 +1,109 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_DATA_STRUCTURES_MIN_COST_FLOW_H_
+#define XLS_DATA_STRUCTURES_MIN_COST_FLOW_H_
+
+#include <limits>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "xls/common/integral_types.h"
+#include "xls/common/strong_int.h"
+
+namespace xls {
+namespace min_cost_flow {
+
+DEFINE_STRONG_INT_TYPE(NodeId, int32);
+DEFINE_STRONG_INT_TYPE(ArcId, int32);
+
+// Capacity of an arc which may carry any amount of flow.
+constexpr int64 kUnboundedCapacity = std::numeric_limits<int64>::max();
+
+// A directed arc in a flow network.
+struct Arc {
+  NodeId source;
+  NodeId target;
+
+  // The cost per unit of flow along the arc.
+  int64 cost;
+
+  // The maximum flow along the arc, or kUnboundedCapacity.
+  int64 capacity;
+};
+
+// A flow network in which each node has a supply (positive) or demand
+// (negative) of flow. Parallel arcs and cycles are allowed.
+class Network {
+ public:
+  // Adds a node with the given supply and returns its unique id. Node ids are
+  // numbered sequentially from zero.
+  NodeId AddNode(int64 supply = 0);
+
+  // Adds an arc from 'source' to 'target' with the given cost per unit flow
+  // and capacity. Arc ids are numbered sequentially from zero.
+  ArcId AddArc(NodeId source, NodeId target, int64 cost,
+               int64 capacity = kUnboundedCapacity);
+
+  void set_supply(NodeId node, int64 supply) {
+    supplies_[static_cast<int64>(node)] = supply;
+  }
+  int64 supply(NodeId node) const {
+    return supplies_[static_cast<int64>(node)];
+  }
+
+  const Arc& arc(ArcId id) const { return arcs_[static_cast<int64>(id)]; }
+
+  int64 node_count() const { return supplies_.size(); }
+  int64 arc_count() const { return arcs_.size(); }
+
+ private:
+  std::vector<int64> supplies_;
+  std::vector<Arc> arcs_;
+};
+
+// A minimum cost flow of a network along with optimal node potentials (the
+// solution of the dual problem).
+struct Flow {
+  // The total cost of the flow.
+  int64 cost;
+
+  // The flow along each arc, indexed by ArcId.
+  std::vector<int64> arc_flows;
+
+  // The potential of each node, indexed by NodeId. For every arc (u, v) the
+  // reduced cost 'cost - potential[u] + potential[v]' is non-negative if the
+  // flow along the arc is below capacity and non-positive if the flow is
+  // above zero. If all arcs are uncapacitated, the potentials are an optimal
+  // solution of the dual linear program:
+  //
+  //   maximize sum(supply[v] * potential[v])
+  //   subject to potential[u] - potential[v] <= cost(u, v) for each arc (u, v)
+  //
+  // so a min cost flow solver is also a solver for systems of difference
+  // constraints with a linear objective.
+  std::vector<int64> potentials;
+};
+
+// Computes a flow satisfying the supply and demand of every node with minimum
+// total cost using the primal network simplex method with block search
+// pivoting. Returns an error if the total supply is not equal to the total
+// demand, if no feasible flow exists, or if the cost is unbounded (the network
+// contains a negative cost cycle of uncapacitated arcs).
+absl::StatusOr<Flow> SolveMinCostFlow(const Network& network);
+
+}  // namespace min_cost_flow
+}  // namespace xls
+
+#endif  // XLS_DATA_STRUCTURES_MIN_COST_FLOW_H_
@@ -0,0 +1,200 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/data_structures/min_cost_flow.h"
+
+#include <random>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "xls/common/status/matchers.h"
+
+namespace xls {
+namespace min_cost_flow {
+namespace {
+
+using status_testing::StatusIs;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+// Verifies that 'flow' is a feasible flow of the network which satisfies the
+// optimality conditions with respect to its potentials.
+void ExpectOptimalFlow(const Network& network, const Flow& flow) {
+  ASSERT_EQ(flow.arc_flows.size(), network.arc_count());
+  ASSERT_EQ(flow.potentials.size(), network.node_count());
+  std::vector<int64> net_outflow(network.node_count(), 0);
+  int64 cost = 0;
+  for (int64 i = 0; i < network.arc_count(); ++i) {
+    const Arc& arc = network.arc(ArcId(i));
+    const int64 arc_flow = flow.arc_flows[i];
+    EXPECT_GE(arc_flow, 0);
+    EXPECT_LE(arc_flow, arc.capacity);
+    net_outflow[static_cast<int64>(arc.source)] += arc_flow;
+    net_outflow[static_cast<int64>(arc.target)] -= arc_flow;
+    cost += arc.cost * arc_flow;
+
+    const int64 reduced_cost = arc.cost -
+                               flow.potentials[static_cast<int64>(arc.source)] +
+                               flow.potentials[static_cast<int64>(arc.target)];
+    if (arc_flow < arc.capacity) {
+      EXPECT_GE(reduced_cost, 0) << "arc " << i;
+    }
+    if (arc_flow > 0) {
+      EXPECT_LE(reduced_cost, 0) << "arc " << i;
+    }
+  }
+  for (int64 u = 0; u < network.node_count(); ++u) {
+    EXPECT_EQ(net_outflow[u], network.supply(NodeId(u))) << "node " << u;
+  }
+  EXPECT_EQ(cost, flow.cost);
+}
+
+TEST(MinCostFlowTest, EmptyNetwork) {
+  Network network;
+  XLS_ASSERT_OK_AND_ASSIGN(Flow flow, SolveMinCostFlow(network));
+  EXPECT_EQ(flow.cost, 0);
+}
+
+TEST(MinCostFlowTest, SingleArc) {
+  Network network;
+  NodeId s = network.AddNode(5);
+  NodeId t = network.AddNode(-5);
+  network.AddArc(s, t, 3);
+  XLS_ASSERT_OK_AND_ASSIGN(Flow flow, SolveMinCostFlow(network));
+  EXPECT_EQ(flow.cost, 15);
+  EXPECT_THAT(flow.arc_flows, ElementsAre(5));
+  ExpectOptimalFlow(network, flow);
+}
+
+TEST(MinCostFlowTest, CheapestPathIsSaturatedFirst) {
+  //      a
+  //  1 /   \ 1      cap(s->a) = 4
+  //   s     t
+  //  2 \   / 2
+  //      b
+  Network network;
+  NodeId s = network.AddNode(10);
+  NodeId a = network.AddNode();
+  NodeId b = network.AddNode();
+  NodeId t = network.AddNode(-10);
+  network.AddArc(s, a, 1, /*capacity=*/4);
+  network.AddArc(a, t, 1);
+  network.AddArc(s, b, 2);
+  network.AddArc(b, t, 2);
+  XLS_ASSERT_OK_AND_ASSIGN(Flow flow, SolveMinCostFlow(network));
+  EXPECT_EQ(flow.cost, 4 * 2 + 6 * 4);
+  EXPECT_THAT(flow.arc_flows, ElementsAre(4, 4, 6, 6));
+  ExpectOptimalFlow(network, flow);
+}
+
+TEST(MinCostFlowTest, NegativeCostCycleWithCapacity) {
+  Network network;
+  NodeId a = network.AddNode();
+  NodeId b = network.AddNode();
+  network.AddArc(a, b, -3, /*capacity=*/2);
+  network.AddArc(b, a, 1, /*capacity=*/5);
+  XLS_ASSERT_OK_AND_ASSIGN(Flow flow, SolveMinCostFlow(network));
+  EXPECT_EQ(flow.cost, -4);
+  EXPECT_THAT(flow.arc_flows, ElementsAre(2, 2));
+  ExpectOptimalFlow(network, flow);
+}
+
+TEST(MinCostFlowTest, UnbalancedSupply) {
+  Network network;
+  NodeId s = network.AddNode(5);
+  NodeId t = network.AddNode(-4);
+  network.AddArc(s, t, 1);
+  EXPECT_THAT(SolveMinCostFlow(network),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Total supply")));
+}
+
+TEST(MinCostFlowTest, Infeasible) {
+  Network network;
+  NodeId s = network.AddNode(5);
+  NodeId t = network.AddNode(-5);
+  network.AddArc(s, t, 1, /*capacity=*/3);
+  EXPECT_THAT(
+      SolveMinCostFlow(network),
+      StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("infeasible")));
+}
+
+TEST(MinCostFlowTest, Unbounded) {
+  Network network;
+  NodeId a = network.AddNode();
+  NodeId b = network.AddNode();
+  network.AddArc(a, b, -3);
+  network.AddArc(b, a, 1);
+  EXPECT_THAT(
+      SolveMinCostFlow(network),
+      StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("unbounded")));
+}
+
+TEST(MinCostFlowTest, DifferenceConstraints) {
+  // Minimize y - 2*x subject to y - x >= 1, x <= 3 and y <= 10, expressed
+  // relative to a reference node z (x and y stand for x - z and y - z). A
+  // constraint p[u] - p[v] <= c is an arc (u, v) of cost c and the supply of a
+  // node is its negated coefficient in the objective.
+  Network network;
+  NodeId z = network.AddNode(-1);
+  NodeId x = network.AddNode(2);
+  NodeId y = network.AddNode(-1);
+  network.AddArc(x, y, -1);  // x - y <= -1
+  network.AddArc(x, z, 3);   // x - z <= 3
+  network.AddArc(y, z, 10);  // y - z <= 10
+  XLS_ASSERT_OK_AND_ASSIGN(Flow flow, SolveMinCostFlow(network));
+  ExpectOptimalFlow(network, flow);
+  const int64 z_potential = flow.potentials[static_cast<int64>(z)];
+  EXPECT_EQ(flow.potentials[static_cast<int64>(x)] - z_potential, 3);
+  EXPECT_EQ(flow.potentials[static_cast<int64>(y)] - z_potential, 4);
+  // The optimal objective value is the negated cost of the flow.
+  EXPECT_EQ(flow.cost, 2);
+}
+
+TEST(MinCostFlowTest, RandomNetworks) {
+  std::mt19937 gen;
+  for (int64 node_count : {2, 5, 20, 100}) {
+    for (int64 trial = 0; trial < 10; ++trial) {
+      Network network;
+      std::uniform_int_distribution<int64> supply_dis(-10, 10);
+      std::vector<NodeId> nodes;
+      int64 total_supply = 0;
+      for (int64 i = 0; i < node_count; ++i) {
+        int64 supply = supply_dis(gen);
+        nodes.push_back(network.AddNode(supply));
+        total_supply += supply;
+      }
+      network.set_supply(nodes[0], network.supply(nodes[0]) - total_supply);
+
+      // An uncapacitated ring of expensive arcs guarantees feasibility.
+      for (int64 i = 0; i < node_count; ++i) {
+        network.AddArc(nodes[i], nodes[(i + 1) % node_count], 1000);
+      }
+      std::uniform_int_distribution<int64> node_dis(0, node_count - 1);
+      std::uniform_int_distribution<int64> cost_dis(-5, 20);
+      std::uniform_int_distribution<int64> capacity_dis(0, 15);
+      for (int64 i = 0; i < 4 * node_count; ++i) {
+        network.AddArc(nodes[node_dis(gen)], nodes[node_dis(gen)],
+                       cost_dis(gen), capacity_dis(gen));
+      }
+      XLS_ASSERT_OK_AND_ASSIGN(Flow flow, SolveMinCostFlow(network));
+      ExpectOptimalFlow(network, flow);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace min_cost_flow
+}  // namespace xls
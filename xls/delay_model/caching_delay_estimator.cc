@@ -0,0 +1,86 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/delay_model/caching_delay_estimator.h"
+
+#include <algorithm>
+
+#include "absl/strings/str_format.h"
+#include "xls/ir/nodes.h"
+#include "xls/ir/type.h"
+
+namespace xls {
+namespace {
+
+void AppendTypeSignature(Type* type,
+                         absl::InlinedVector<int64, 16>* signature) {
+  signature->push_back(static_cast<int64>(type->kind()));
+  signature->push_back(type->GetFlatBitCount());
+  signature->push_back(type->IsArray() ? type->AsArrayOrDie()->size() : 0);
+}
+
+}  // namespace
+
+/* static */ CachingDelayEstimator::Signature
+CachingDelayEstimator::GetSignature(Node* node) {
+  Signature signature;
+  bool operands_identical = std::all_of(
+      node->operands().begin(), node->operands().end(),
+      [&](Node* operand) { return operand == node->operand(0); });
+  bool has_literal_operand =
+      std::any_of(node->operands().begin(), node->operands().end(),
+                  [](Node* operand) { return operand->Is<Literal>(); });
+  signature.push_back(static_cast<int64>(node->op()));
+  signature.push_back(operands_identical | (has_literal_operand << 1));
+  AppendTypeSignature(node->GetType(), &signature);
+  for (Node* operand : node->operands()) {
+    AppendTypeSignature(operand->GetType(), &signature);
+  }
+  return signature;
+}
+
+absl::StatusOr<int64> CachingDelayEstimator::GetOperationDelayInPs(
+    Node* node) const {
+  if (node->id() < node_entries_.size()) {
+    const NodeEntry& entry = node_entries_[node->id()];
+    if (entry.node == node) {
+      ++hits_;
+      return *entry.delay;
+    }
+  } else {
+    node_entries_.resize(node->id() + 1);
+  }
+  auto [it, inserted] =
+      cache_.try_emplace(GetSignature(node), absl::StatusOr<int64>(0));
+  if (inserted) {
+    ++misses_;
+    it->second = delay_estimator_.GetOperationDelayInPs(node);
+  } else {
+    ++hits_;
+  }
+  node_entries_[node->id()] = NodeEntry{node, &it->second};
+  return it->second;
+}
+
+double CachingDelayEstimator::HitRate() const {
+  int64 calls = hits_ + misses_;
+  return calls == 0 ? 0.0 : static_cast<double>(hits_) / calls;
+}
+
+std::string CachingDelayEstimator::StatsToString() const {
+  return absl::StrFormat("%d hits, %d misses (%.1f%% hit rate), %d entries",
+                         hits_, misses_, 100.0 * HitRate(), cache_.size());
+}
+
+}  // namespace xls
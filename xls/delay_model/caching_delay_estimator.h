@@ -0,0 +1,88 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_DELAY_MODEL_CACHING_DELAY_ESTIMATOR_H_
+#define XLS_DELAY_MODEL_CACHING_DELAY_ESTIMATOR_H_
+
+#include <string>
+#include <vector>
+
+#include "absl/container/inlined_vector.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/status/statusor.h"
+#include "xls/common/integral_types.h"
+#include "xls/delay_model/delay_estimator.h"
+#include "xls/ir/node.h"
+
+namespace xls {
+
+// A delay estimator which memoizes the delays returned by another estimator.
+// Delays are keyed by the signature of the node: its op, the type shape (kind,
+// flat bit count and array size) of its result and of each of its operands, and
+// the specializations of the delay model (whether the operands are identical
+// and whether any operand is a literal). This is exactly the information the
+// generated delay models and logical effort estimation depend on, so nodes
+// with equal signatures share a single estimate, including nodes of different
+// functions. Errors are memoized as well.
+//
+// Each node's estimate is additionally memoized by node id, which makes
+// repeated queries for the same node much cheaper than computing its
+// signature. Nodes must therefore not be modified (e.g., have their operands
+// replaced) after their delay has been queried; create the estimator for the
+// duration of an analysis of an unchanging function, such as scheduling.
+//
+// The wrapped estimator must outlive this object. Not thread-safe.
+class CachingDelayEstimator : public DelayEstimator {
+ public:
+  explicit CachingDelayEstimator(const DelayEstimator& delay_estimator)
+      : delay_estimator_(delay_estimator) {}
+
+  absl::StatusOr<int64> GetOperationDelayInPs(Node* node) const override;
+
+  // Number of calls which were answered from the cache and which were passed
+  // to the wrapped estimator respectively.
+  int64 hits() const { return hits_; }
+  int64 misses() const { return misses_; }
+
+  // Returns the hit rate in [0, 1], or zero if there have been no calls.
+  double HitRate() const;
+
+  // Returns a short description of the cache statistics, e.g.:
+  //   "1234 hits, 56 misses (95.7% hit rate), 56 entries"
+  std::string StatsToString() const;
+
+ private:
+  using Signature = absl::InlinedVector<int64, 16>;
+
+  static Signature GetSignature(Node* node);
+
+  // The memoized delay of a node. 'node' distinguishes nodes of different
+  // packages which have the same id.
+  struct NodeEntry {
+    Node* node = nullptr;
+    const absl::StatusOr<int64>* delay = nullptr;
+  };
+
+  const DelayEstimator& delay_estimator_;
+  // Values are stable in a node_hash_map so NodeEntry can point at them.
+  mutable absl::node_hash_map<Signature, absl::StatusOr<int64>> cache_;
+  // Indexed by node id.
+  mutable std::vector<NodeEntry> node_entries_;
+  mutable int64 hits_ = 0;
+  mutable int64 misses_ = 0;
+};
+
+}  // namespace xls
+
+#endif  // XLS_DELAY_MODEL_CACHING_DELAY_ESTIMATOR_H_
@@ -0,0 +1,169 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/delay_model/caching_delay_estimator.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_test_base.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+
+// A test delay estimator whose delay depends on the op and the widths of the
+// operands and which counts the number of times it is called.
+class CountingDelayEstimator : public DelayEstimator {
+ public:
+  absl::StatusOr<int64> GetOperationDelayInPs(Node* node) const override {
+    ++calls_;
+    if (node->op() == Op::kUMul) {
+      return absl::UnimplementedError("No multiplies");
+    }
+    int64 delay = static_cast<int64>(node->op());
+    for (Node* operand : node->operands()) {
+      delay += operand->GetType()->GetFlatBitCount();
+    }
+    return delay;
+  }
+
+  int64 calls() const { return calls_; }
+
+ private:
+  mutable int64 calls_ = 0;
+};
+
+class CachingDelayEstimatorTest : public IrTestBase {};
+
+TEST_F(CachingDelayEstimatorTest, SameSignatureSharesEstimate) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(32));
+  BValue y = fb.Param("y", p->GetBitsType(32));
+  BValue z = fb.Param("z", p->GetBitsType(16));
+  BValue add0 = fb.Add(x, y);
+  BValue add1 = fb.Add(add0, x);
+  BValue add2 = fb.Add(z, z);
+  BValue sub = fb.Subtract(x, y);
+  XLS_ASSERT_OK(fb.Build().status());
+
+  CountingDelayEstimator counting;
+  CachingDelayEstimator caching(counting);
+  XLS_ASSERT_OK_AND_ASSIGN(int64 add0_delay,
+                           counting.GetOperationDelayInPs(add0.node()));
+  EXPECT_THAT(caching.GetOperationDelayInPs(add0.node()),
+              IsOkAndHolds(add0_delay));
+  EXPECT_THAT(caching.GetOperationDelayInPs(add0.node()),
+              IsOkAndHolds(add0_delay));
+  // Same op and types as add0.
+  EXPECT_THAT(caching.GetOperationDelayInPs(add1.node()),
+              IsOkAndHolds(add0_delay));
+  EXPECT_EQ(counting.calls(), 2);
+  EXPECT_EQ(caching.hits(), 2);
+  EXPECT_EQ(caching.misses(), 1);
+
+  // Different widths, and identical operands.
+  XLS_ASSERT_OK(caching.GetOperationDelayInPs(add2.node()).status());
+  // Different op.
+  XLS_ASSERT_OK(caching.GetOperationDelayInPs(sub.node()).status());
+  EXPECT_EQ(caching.misses(), 3);
+  EXPECT_DOUBLE_EQ(caching.HitRate(), 0.4);
+  EXPECT_EQ(caching.StatsToString(),
+            "2 hits, 3 misses (40.0% hit rate), 3 entries");
+}
+
+TEST_F(CachingDelayEstimatorTest, SpecializationsAreDistinguished) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(8));
+  BValue y = fb.Param("y", p->GetBitsType(8));
+  BValue add = fb.Add(x, y);
+  BValue add_identical = fb.Add(x, x);
+  BValue add_literal = fb.Add(x, fb.Literal(UBits(3, 8)));
+  XLS_ASSERT_OK(fb.Build().status());
+
+  CountingDelayEstimator counting;
+  CachingDelayEstimator caching(counting);
+  for (BValue node : {add, add_identical, add_literal}) {
+    XLS_ASSERT_OK(caching.GetOperationDelayInPs(node.node()).status());
+  }
+  EXPECT_EQ(caching.misses(), 3);
+  EXPECT_EQ(caching.hits(), 0);
+}
+
+TEST_F(CachingDelayEstimatorTest, ArrayShapesAreDistinguished) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  // Both arrays have 32 bits in total.
+  BValue a = fb.Param("a", p->GetArrayType(4, p->GetBitsType(8)));
+  BValue b = fb.Param("b", p->GetArrayType(2, p->GetBitsType(16)));
+  BValue i = fb.Param("i", p->GetBitsType(2));
+  BValue a_index = fb.ArrayIndex(a, i);
+  BValue b_index = fb.ArrayIndex(b, i);
+  XLS_ASSERT_OK(fb.Build().status());
+
+  CountingDelayEstimator counting;
+  CachingDelayEstimator caching(counting);
+  XLS_ASSERT_OK(caching.GetOperationDelayInPs(a_index.node()).status());
+  XLS_ASSERT_OK(caching.GetOperationDelayInPs(b_index.node()).status());
+  EXPECT_EQ(caching.misses(), 2);
+}
+
+TEST_F(CachingDelayEstimatorTest, NodesOfDifferentPackages) {
+  // The nodes of the two packages have the same ids but different types.
+  auto p0 = CreatePackage();
+  FunctionBuilder fb0(TestName(), p0.get());
+  BValue add0 = fb0.Add(fb0.Param("x", p0->GetBitsType(8)),
+                        fb0.Param("y", p0->GetBitsType(8)));
+  XLS_ASSERT_OK(fb0.Build().status());
+  auto p1 = CreatePackage();
+  FunctionBuilder fb1(TestName(), p1.get());
+  BValue add1 = fb1.Add(fb1.Param("x", p1->GetBitsType(16)),
+                        fb1.Param("y", p1->GetBitsType(16)));
+  XLS_ASSERT_OK(fb1.Build().status());
+  ASSERT_EQ(add0.node()->id(), add1.node()->id());
+
+  CountingDelayEstimator counting;
+  CachingDelayEstimator caching(counting);
+  EXPECT_THAT(caching.GetOperationDelayInPs(add0.node()),
+              IsOkAndHolds(static_cast<int64>(Op::kAdd) + 16));
+  EXPECT_THAT(caching.GetOperationDelayInPs(add1.node()),
+              IsOkAndHolds(static_cast<int64>(Op::kAdd) + 32));
+  EXPECT_THAT(caching.GetOperationDelayInPs(add0.node()),
+              IsOkAndHolds(static_cast<int64>(Op::kAdd) + 16));
+  EXPECT_EQ(counting.calls(), 2);
+}
+
+TEST_F(CachingDelayEstimatorTest, ErrorsAreCached) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(8));
+  BValue mul = fb.UMul(x, x);
+  XLS_ASSERT_OK(fb.Build().status());
+
+  CountingDelayEstimator counting;
+  CachingDelayEstimator caching(counting);
+  EXPECT_THAT(caching.GetOperationDelayInPs(mul.node()),
+              StatusIs(absl::StatusCode::kUnimplemented));
+  EXPECT_THAT(caching.GetOperationDelayInPs(mul.node()),
+              StatusIs(absl::StatusCode::kUnimplemented));
+  EXPECT_EQ(counting.calls(), 1);
+}
+
+}  // namespace
+}  // namespace xls
@@ -0,0 +1,494 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/delay_model/delay_characterization.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "google/protobuf/text_format.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_replace.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include "xls/codegen/module_signature.h"
+#include "xls/codegen/pipeline_generator.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/delay_model/delay_estimators.h"
+#include "xls/ir/function.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/op.h"
+#include "xls/ir/package.h"
+#include "xls/scheduling/pipeline_schedule.h"
+
+namespace xls {
+namespace {
+
+using delay_model::CharacterizationPoint;
+using delay_model::DelayCharacterizationSpec;
+using delay_model::Operation;
+using delay_model::SpecializationKind;
+using synthesis::CompileRequest;
+using synthesis::CompileResponse;
+using synthesis::SynthesisSweepResult;
+
+// Returns the op named as in the delay model (e.g., "kZeroExt").
+absl::StatusOr<Op> DelayModelNameToOp(absl::string_view name) {
+  if (!absl::StartsWith(name, "k")) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Invalid op name \"%s\", expected e.g. \"kAdd\"", name));
+  }
+  std::string lowered = absl::AsciiStrToLower(name.substr(1));
+  for (Op op : AllOps()) {
+    if (absl::StrReplaceAll(OpToString(op), {{"_", ""}}) == lowered) {
+      return op;
+    }
+  }
+  return absl::InvalidArgumentError(
+      absl::StrFormat("Unknown op \"%s\"", name));
+}
+
+std::string OperandType(const Operation::Operand& operand) {
+  if (operand.element_count() > 0) {
+    return absl::StrFormat("bits[%d][%d]", operand.bit_count(),
+                           operand.element_count());
+  }
+  return absl::StrFormat("bits[%d]", operand.bit_count());
+}
+
+// Returns a random value of the given operand type as IR literal text. The
+// values are deterministic so the generated IR is too.
+std::string RandomLiteralValue(const Operation::Operand& operand,
+                               std::mt19937_64* rng) {
+  auto bits_value = [&](int64 bit_count) {
+    std::string digits;
+    for (int64 i = 0; i < bit_count; i += 4) {
+      int64 digit_bits = std::min<int64>(4, bit_count - i);
+      int64 digit = (*rng)() & ((1 << digit_bits) - 1);
+      digits.insert(0, absl::StrFormat("%x", digit));
+    }
+    return absl::StrCat("0x", digits.empty() ? "0" : digits);
+  };
+  if (operand.element_count() == 0) {
+    return bits_value(operand.bit_count());
+  }
+  std::vector<std::string> elements;
+  for (int64 i = 0; i < operand.element_count(); ++i) {
+    elements.push_back(bits_value(operand.bit_count()));
+  }
+  return absl::StrCat("[", absl::StrJoin(elements, ", "), "]");
+}
+
+// Returns the attributes implied by the operation, e.g. the new_bit_count of
+// an extension which equals the result bit count.
+std::vector<std::pair<std::string, std::string>> ImpliedAttributes(
+    Op op, const Operation& operation) {
+  std::string bit_count = absl::StrCat(operation.bit_count());
+  switch (op) {
+    case Op::kZeroExt:
+    case Op::kSignExt:
+      return {{"new_bit_count", bit_count}};
+    case Op::kBitSlice:
+      return {{"start", "0"}, {"width", bit_count}};
+    case Op::kDynamicBitSlice:
+    case Op::kDecode:
+      return {{"width", bit_count}};
+    case Op::kOneHot:
+      return {{"lsb_prio", "true"}};
+    default:
+      return {};
+  }
+}
+
+// Returns the considered frequencies of the search in increasing order.
+std::vector<int64> SearchFrequencies(const FrequencySearchOptions& options) {
+  std::vector<int64> frequencies;
+  for (int64 hz = options.start_hz; hz <= options.limit_hz;
+       hz += options.step_hz) {
+    frequencies.push_back(hz);
+  }
+  return frequencies;
+}
+
+// Returns the first line of a checkpoint recorded with the given options.
+std::string CheckpointHeader(const FrequencySearchOptions& search) {
+  return absl::StrFormat("# start_hz: %d limit_hz: %d step_hz: %d\n",
+                         search.start_hz, search.limit_hz, search.step_hz);
+}
+
+std::string ToSingleLineText(const SynthesisSweepResult& result) {
+  google::protobuf::TextFormat::Printer printer;
+  printer.SetSingleLineMode(true);
+  std::string text;
+  XLS_CHECK(printer.PrintToString(result, &text));
+  return text;
+}
+
+}  // namespace
+
+absl::StatusOr<std::vector<CharacterizationPoint>> GetCharacterizationPoints(
+    const DelayCharacterizationSpec& spec) {
+  std::vector<CharacterizationPoint> points;
+  for (const delay_model::OpSweep& sweep : spec.op_sweeps()) {
+    XLS_RETURN_IF_ERROR(DelayModelNameToOp(sweep.op()).status());
+    std::vector<SpecializationKind> specializations;
+    for (int specialization : sweep.specializations()) {
+      specializations.push_back(
+          static_cast<SpecializationKind>(specialization));
+    }
+    if (specializations.empty()) {
+      specializations.push_back(delay_model::NO_SPECIALIZATION);
+    }
+    for (int64 bit_count : sweep.bit_counts()) {
+      for (SpecializationKind specialization : specializations) {
+        CharacterizationPoint point;
+        Operation* operation = point.mutable_operation();
+        operation->set_op(sweep.op());
+        operation->set_bit_count(bit_count);
+        for (int64 i = 0; i < sweep.operand_count(); ++i) {
+          operation->add_operands()->set_bit_count(bit_count);
+        }
+        operation->set_specialization(specialization);
+        points.push_back(std::move(point));
+      }
+    }
+  }
+  points.insert(points.end(), spec.points().begin(), spec.points().end());
+  return points;
+}
+
+absl::StatusOr<std::string> GenerateOpIr(const CharacterizationPoint& point) {
+  const Operation& operation = point.operation();
+  XLS_ASSIGN_OR_RETURN(Op op, DelayModelNameToOp(operation.op()));
+  int64 operand_count = operation.operands_size();
+  std::string output_type =
+      op == Op::kArray
+          ? absl::StrFormat("bits[%d][%d]", operation.bit_count(),
+                            operand_count)
+          : absl::StrFormat("bits[%d]", operation.bit_count());
+
+  std::vector<std::string> params;
+  std::vector<std::string> operands;
+  std::string body;
+  switch (operation.specialization()) {
+    case delay_model::OPERANDS_IDENTICAL:
+      XLS_RET_CHECK_GT(operand_count, 0) << operation.op();
+      params.push_back(
+          absl::StrCat("op0: ", OperandType(operation.operands(0))));
+      operands.assign(operand_count, "op0");
+      break;
+    case delay_model::HAS_LITERAL_OPERAND: {
+      XLS_RET_CHECK_GT(operand_count, 0) << operation.op();
+      // The last operand is the literal.
+      const Operation::Operand& literal = operation.operands(operand_count - 1);
+      std::mt19937_64 rng(0);
+      absl::StrAppendFormat(&body, "  literal.1: %s = literal(value=%s)\n",
+                            OperandType(literal),
+                            RandomLiteralValue(literal, &rng));
+      for (int64 i = 0; i < operand_count - 1; ++i) {
+        params.push_back(
+            absl::StrFormat("op%d: %s", i, OperandType(operation.operands(i))));
+        operands.push_back(absl::StrCat("op", i));
+      }
+      operands.push_back("literal.1");
+      break;
+    }
+    default:
+      for (int64 i = 0; i < operand_count; ++i) {
+        params.push_back(
+            absl::StrFormat("op%d: %s", i, OperandType(operation.operands(i))));
+        operands.push_back(absl::StrCat("op", i));
+      }
+      break;
+  }
+
+  std::vector<std::pair<std::string, std::string>> attributes;
+  for (const delay_model::OperationAttribute& attribute : point.attributes()) {
+    attributes.push_back({attribute.name(), attribute.value()});
+  }
+  for (const auto& implied : ImpliedAttributes(op, operation)) {
+    if (std::none_of(attributes.begin(), attributes.end(),
+                     [&](const auto& a) { return a.first == implied.first; })) {
+      attributes.push_back(implied);
+    }
+  }
+  for (const auto& [name, value] : attributes) {
+    operands.push_back(absl::StrCat(name, "=", value));
+  }
+
+  std::string op_name = OpToString(op);
+  std::string ir_text = absl::StrFormat(
+      "package %s_characterization\n\nfn main(%s) -> %s {\n%s  ret %s.2: %s = "
+      "%s(%s)\n}\n",
+      op_name, absl::StrJoin(params, ", "), output_type, body, op_name,
+      output_type, op_name, absl::StrJoin(operands, ", "));
+  // Verify the IR parses and verifies.
+  XLS_RETURN_IF_ERROR(Parser::ParsePackage(ir_text).status())
+      << "Invalid IR generated for operation " << operation.ShortDebugString()
+      << ":\n"
+      << ir_text;
+  return ir_text;
+}
+
+absl::StatusOr<CompileRequest> GenerateOpModule(absl::string_view ir_text) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                       Parser::ParsePackage(ir_text));
+  XLS_ASSIGN_OR_RETURN(Function * f, package->EntryFunction());
+  XLS_ASSIGN_OR_RETURN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(f, GetStandardDelayEstimator(),
+                            SchedulingOptions().pipeline_stages(1)));
+  verilog::PipelineOptions options;
+  options.module_name(kOpModuleName);
+  options.use_system_verilog(false);
+  XLS_ASSIGN_OR_RETURN(verilog::ModuleGeneratorResult result,
+                       verilog::ToPipelineModuleText(schedule, f, options));
+  CompileRequest request;
+  request.set_module_text(result.verilog_text);
+  *request.mutable_signature() = result.signature.proto();
+  request.set_top_module_name(kOpModuleName);
+  return request;
+}
+
+absl::StatusOr<SynthesisSweepResult> BisectFrequency(
+    const CompileRequest& request, const FrequencySearchOptions& options,
+    const CompileFunction& compile) {
+  XLS_RET_CHECK_GT(options.step_hz, 0);
+  std::vector<int64> frequencies = SearchFrequencies(options);
+  SynthesisSweepResult sweep_result;
+  sweep_result.set_module_text(request.module_text());
+  *sweep_result.mutable_signature() = request.signature();
+  sweep_result.set_top_module_name(request.top_module_name());
+  sweep_result.set_max_frequency_hz(0);
+
+  // Invariant: frequencies below 'start' meet timing and frequencies at or
+  // above 'limit' do not.
+  int64 start = 0;
+  int64 limit = frequencies.size();
+  while (start < limit) {
+    int64 index = start + (limit - start) / 2;
+    CompileRequest frequency_request = request;
+    frequency_request.set_target_frequency_hz(frequencies[index]);
+    XLS_ASSIGN_OR_RETURN(CompileResponse response, compile(frequency_request));
+    SynthesisSweepResult::SynthesisResult* result = sweep_result.add_results();
+    result->set_target_frequency_hz(frequencies[index]);
+    *result->mutable_response() = std::move(response);
+    if (result->response().slack_ps() >= 0) {
+      XLS_VLOG(2) << "  PASSED TIMING at " << frequencies[index] << "Hz";
+      sweep_result.set_max_frequency_hz(frequencies[index]);
+      start = index + 1;
+    } else {
+      XLS_VLOG(2) << "  FAILED TIMING at " << frequencies[index]
+                  << "Hz (slack " << result->response().slack_ps() << "ps)";
+      limit = index;
+    }
+  }
+  return sweep_result;
+}
+
+/* static */ absl::StatusOr<std::unique_ptr<CharacterizationCheckpoint>>
+CharacterizationCheckpoint::Open(const std::filesystem::path& path,
+                                 const FrequencySearchOptions& search) {
+  auto checkpoint = absl::WrapUnique(new CharacterizationCheckpoint(path));
+  std::string header = CheckpointHeader(search);
+  if (!FileExists(path).ok()) {
+    XLS_RETURN_IF_ERROR(SetFileContents(path, header));
+    return checkpoint;
+  }
+  XLS_ASSIGN_OR_RETURN(std::string contents, GetFileContents(path));
+  // Each result is appended with its terminating newline in a single write so
+  // an unterminated last line is an incomplete write. Drop it so that appended
+  // results start on a line of their own.
+  size_t complete_size = contents.rfind('\n') + 1;
+  if (complete_size != contents.size()) {
+    XLS_LOG(WARNING) << "Ignoring incomplete last line of checkpoint " << path;
+    contents.resize(complete_size);
+    XLS_RETURN_IF_ERROR(SetFileContents(path, contents));
+  }
+  if (contents.empty()) {
+    XLS_RETURN_IF_ERROR(SetFileContents(path, header));
+    return checkpoint;
+  }
+  if (!absl::StartsWith(contents, header)) {
+    std::string recorded = contents.substr(0, contents.find('\n'));
+    return absl::FailedPreconditionError(absl::StrFormat(
+        "Checkpoint %s was recorded with different search options (\"%s\", "
+        "expected \"%s\"); use a new checkpoint for these options",
+        path.string(), recorded, absl::StripSuffix(header, "\n")));
+  }
+  absl::MutexLock lock(&checkpoint->mutex_);
+  int64 line_number = 1;
+  for (absl::string_view line : absl::StrSplit(
+           absl::string_view(contents).substr(header.size()), '\n',
+           absl::SkipEmpty())) {
+    ++line_number;
+    auto result = absl::make_unique<SynthesisSweepResult>();
+    if (!google::protobuf::TextFormat::ParseFromString(std::string(line),
+                                                       result.get())) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Unable to parse line %d of checkpoint %s", line_number,
+          path.string()));
+    }
+    std::string module_text = result->module_text();
+    checkpoint->results_[module_text] = std::move(result);
+  }
+  return checkpoint;
+}
+
+const SynthesisSweepResult* CharacterizationCheckpoint::Find(
+    absl::string_view module_text) {
+  absl::MutexLock lock(&mutex_);
+  auto it = results_.find(module_text);
+  return it == results_.end() ? nullptr : it->second.get();
+}
+
+absl::Status CharacterizationCheckpoint::Record(
+    const SynthesisSweepResult& result) {
+  auto recorded = absl::make_unique<SynthesisSweepResult>(result);
+  for (auto& sweep_point : *recorded->mutable_results()) {
+    sweep_point.mutable_response()->clear_netlist();
+  }
+  std::string line = absl::StrCat(ToSingleLineText(*recorded), "\n");
+  absl::MutexLock lock(&mutex_);
+  XLS_RETURN_IF_ERROR(AppendStringToFile(path_, line));
+  std::string module_text = recorded->module_text();
+  results_[module_text] = std::move(recorded);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<delay_model::DelayModel> RunDelayCharacterization(
+    const DelayCharacterizationSpec& spec,
+    const CharacterizationOptions& options,
+    absl::Span<const CompileFunction> connections,
+    CharacterizationCheckpoint* checkpoint) {
+  XLS_RET_CHECK(!connections.empty());
+  XLS_ASSIGN_OR_RETURN(std::vector<CharacterizationPoint> points,
+                       GetCharacterizationPoints(spec));
+
+  // Generate the module of each point, sharing modules between points with
+  // identical Verilog.
+  std::vector<CompileRequest> modules;
+  absl::flat_hash_map<std::string, int64> module_index;
+  std::vector<int64> point_module;
+  for (const CharacterizationPoint& point : points) {
+    XLS_ASSIGN_OR_RETURN(std::string ir_text, GenerateOpIr(point));
+    XLS_ASSIGN_OR_RETURN(CompileRequest request, GenerateOpModule(ir_text));
+    auto [it, inserted] =
+        module_index.insert({request.module_text(), modules.size()});
+    if (inserted) {
+      modules.push_back(std::move(request));
+    }
+    point_module.push_back(it->second);
+  }
+
+  std::vector<absl::StatusOr<SynthesisSweepResult>> sweeps(
+      modules.size(), absl::UnknownError("Sweep not run"));
+  std::vector<int64> pending;
+  for (int64 i = 0; i < modules.size(); ++i) {
+    const SynthesisSweepResult* recorded =
+        checkpoint == nullptr ? nullptr
+                              : checkpoint->Find(modules[i].module_text());
+    if (recorded != nullptr) {
+      sweeps[i] = *recorded;
+    } else {
+      pending.push_back(i);
+    }
+  }
+  XLS_LOG(INFO) << absl::StreamFormat(
+      "%d points, %d distinct modules, %d to synthesize over %d connections",
+      points.size(), modules.size(), pending.size(), connections.size());
+
+  // Each thread owns one connection and takes the next pending module until
+  // none remain. Failed sweeps don't stop the others so that as much progress
+  // as possible is checkpointed.
+  std::atomic<int64> next_pending{0};
+  std::atomic<int64> completed{0};
+  auto worker = [&](const CompileFunction& compile) {
+    for (int64 i = next_pending++; i < pending.size(); i = next_pending++) {
+      int64 module = pending[i];
+      sweeps[module] =
+          BisectFrequency(modules[module], options.search, compile);
+      if (sweeps[module].ok() && checkpoint != nullptr) {
+        absl::Status recorded = checkpoint->Record(*sweeps[module]);
+        if (!recorded.ok()) {
+          sweeps[module] = recorded;
+        }
+      }
+      XLS_LOG(INFO) << absl::StreamFormat(
+          "Synthesized module %d of %d: %s", ++completed, pending.size(),
+          sweeps[module].ok()
+              ? absl::StrCat(sweeps[module]->max_frequency_hz(), "Hz")
+              : sweeps[module].status().ToString());
+    }
+  };
+  std::vector<std::thread> threads;
+  for (const CompileFunction& compile : connections) {
+    threads.emplace_back(worker, std::cref(compile));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  int64 failed_count = 0;
+  absl::Status first_error;
+  for (const absl::StatusOr<SynthesisSweepResult>& sweep : sweeps) {
+    if (!sweep.ok()) {
+      if (first_error.ok()) {
+        first_error = sweep.status();
+      }
+      ++failed_count;
+    }
+  }
+  if (!first_error.ok()) {
+    return absl::Status(
+        first_error.code(),
+        absl::StrFormat("%d of %d synthesis sweeps failed%s; first error: %s",
+                        failed_count, modules.size(),
+                        checkpoint == nullptr
+                            ? ""
+                            : " (completed sweeps are checkpointed)",
+                        first_error.message()));
+  }
+
+  delay_model::DelayModel model;
+  *model.mutable_op_models() = spec.op_models();
+  for (int64 i = 0; i < points.size(); ++i) {
+    const SynthesisSweepResult& sweep = *sweeps[point_module[i]];
+    if (sweep.max_frequency_hz() == 0) {
+      XLS_LOG(WARNING) << "No frequency met timing for operation, skipping: "
+                       << points[i].operation().ShortDebugString();
+      continue;
+    }
+    delay_model::DataPoint* data_point = model.add_data_points();
+    *data_point->mutable_operation() = points[i].operation();
+    data_point->set_delay(
+        std::llround(1e12 / static_cast<double>(sweep.max_frequency_hz())));
+    data_point->set_delay_offset(options.delay_offset_ps);
+  }
+  return model;
+}
+
+}  // namespace xls
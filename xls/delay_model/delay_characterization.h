@@ -0,0 +1,147 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Library for measuring the delay of single operations with a synthesis
+// service and collecting the measurements into a DelayModel. This is the C++
+// counterpart of op_module_generator.py and synthesis_utils.bisect_frequency
+// which additionally runs many synthesis requests concurrently and checkpoints
+// its progress so that an interrupted characterization can be resumed.
+
+#ifndef XLS_DELAY_MODEL_DELAY_CHARACTERIZATION_H_
+#define XLS_DELAY_MODEL_DELAY_CHARACTERIZATION_H_
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "xls/common/integral_types.h"
+#include "xls/delay_model/delay_characterization.pb.h"
+#include "xls/delay_model/delay_model.pb.h"
+#include "xls/synthesis/synthesis.pb.h"
+
+namespace xls {
+
+// The name of the top module of the generated op modules. The name is the same
+// for all modules so that identical operations yield identical Verilog.
+inline constexpr char kOpModuleName[] = "op_module";
+
+// Returns the points described by the spec: the points of the op sweeps
+// followed by the explicitly given points.
+absl::StatusOr<std::vector<delay_model::CharacterizationPoint>>
+GetCharacterizationPoints(const delay_model::DelayCharacterizationSpec& spec);
+
+// Returns the text of an IR package containing a function with a single
+// operation as described by 'point'. The parameters of the function are the
+// operands of the operation. See generate_ir_package in op_module_generator.py.
+absl::StatusOr<std::string> GenerateOpIr(
+    const delay_model::CharacterizationPoint& point);
+
+// Generates a single-stage pipelined Verilog module named kOpModuleName from
+// the given IR package text. The module text and signature are set in the
+// returned request; the target frequency is not.
+absl::StatusOr<synthesis::CompileRequest> GenerateOpModule(
+    absl::string_view ir_text);
+
+// Synthesizes the module of the request at the request's target frequency.
+using CompileFunction =
+    std::function<absl::StatusOr<synthesis::CompileResponse>(
+        const synthesis::CompileRequest&)>;
+
+struct FrequencySearchOptions {
+  // The lowest and highest (inclusive) frequencies to search and the step
+  // between the considered frequencies.
+  int64 start_hz = 0;
+  int64 limit_hz = 0;
+  int64 step_hz = 0;
+};
+
+// Binary searches for the highest considered frequency at which the module of
+// 'request' meets timing (non-negative slack). The max_frequency_hz of the
+// result is zero if no frequency meets timing. See bisect_frequency in
+// synthesis_utils.py.
+absl::StatusOr<synthesis::SynthesisSweepResult> BisectFrequency(
+    const synthesis::CompileRequest& request,
+    const FrequencySearchOptions& options, const CompileFunction& compile);
+
+// A file of completed sweep results, one text-format SynthesisSweepResult per
+// line. Results are appended as they complete so that at most the in-flight
+// sweeps are lost if the characterization is interrupted. Netlists are dropped
+// from the recorded results to keep the file small. The first line of the file
+// records the search options of the sweeps since a result is only valid for
+// the options it was searched with. Thread-safe.
+class CharacterizationCheckpoint {
+ public:
+  // Opens the checkpoint at 'path', loading the results already recorded in
+  // it. The file is created if it does not exist. A truncated last line (e.g.,
+  // from a killed process) is ignored. Returns an error if the checkpoint was
+  // recorded with search options other than 'search'.
+  static absl::StatusOr<std::unique_ptr<CharacterizationCheckpoint>> Open(
+      const std::filesystem::path& path, const FrequencySearchOptions& search);
+
+  // Returns the recorded result for the given module text, or nullptr if there
+  // is none.
+  const synthesis::SynthesisSweepResult* Find(absl::string_view module_text);
+
+  // Appends the result to the checkpoint file.
+  absl::Status Record(const synthesis::SynthesisSweepResult& result);
+
+  int64 size() {
+    absl::MutexLock lock(&mutex_);
+    return results_.size();
+  }
+
+ private:
+  explicit CharacterizationCheckpoint(std::filesystem::path path)
+      : path_(std::move(path)) {}
+
+  std::filesystem::path path_;
+  absl::Mutex mutex_;
+  // Recorded results keyed by module text. Values are heap-allocated so
+  // pointers returned by Find remain valid as results are added.
+  absl::flat_hash_map<std::string,
+                      std::unique_ptr<synthesis::SynthesisSweepResult>>
+      results_ ABSL_GUARDED_BY(mutex_);
+};
+
+struct CharacterizationOptions {
+  FrequencySearchOptions search;
+
+  // The delay_offset of each data point. See DataPoint in delay_model.proto.
+  int64 delay_offset_ps = 0;
+};
+
+// Measures the delay of each point of 'spec' and returns a DelayModel holding
+// the op models of the spec and the measured data points. Points which yield
+// identical Verilog are synthesized once. Each element of 'connections' is
+// used by its own thread so as many sweeps run concurrently as there are
+// connections. Sweeps already recorded in 'checkpoint' (if non-null) are not
+// rerun and completed sweeps are recorded in it. If a sweep fails, the other
+// sweeps still run to completion before the error is returned.
+absl::StatusOr<delay_model::DelayModel> RunDelayCharacterization(
+    const delay_model::DelayCharacterizationSpec& spec,
+    const CharacterizationOptions& options,
+    absl::Span<const CompileFunction> connections,
+    CharacterizationCheckpoint* checkpoint);
+
+}  // namespace xls
+
+#endif  // XLS_DELAY_MODEL_DELAY_CHARACTERIZATION_H_
@@ -0,0 +1,167 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "grpcpp/grpcpp.h"
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/delay_model/delay_characterization.h"
+#include "xls/delay_model/delay_characterization.pb.h"
+#include "xls/delay_model/delay_model.pb.h"
+#include "xls/synthesis/client_credentials.h"
+#include "xls/synthesis/synthesis.pb.h"
+#include "xls/synthesis/synthesis_service.grpc.pb.h"
+
+const char kUsage[] = R"(
+Measures the delay of the operations of a DelayCharacterizationSpec with XLS
+synthesis servers and writes the resulting DelayModel textproto. Each operation
+is generated as a single-stage pipelined Verilog module whose maximum frequency
+is found by binary search over compile requests. The searches for different
+operations run concurrently over --connections_per_server connections to each
+server. Completed searches are appended to the --checkpoint file and are not
+repeated when the tool is rerun with the same checkpoint. A checkpoint may only
+be resumed with the frequency search flags it was recorded with.
+
+Invocation:
+
+  delay_characterization_main --spec=spec.textproto \
+      --synthesis_servers=host0:10000,host1:10000 --connections_per_server=4 \
+      --checkpoint=/tmp/checkpoint --output_path=delay_model.textproto
+)";
+
+ABSL_FLAG(std::string, spec, "",
+          "Path of the DelayCharacterizationSpec textproto.");
+ABSL_FLAG(std::string, output_path, "",
+          "Path to write the DelayModel textproto to.");
+ABSL_FLAG(std::string, checkpoint, "",
+          "Path of the checkpoint file. If empty, no checkpoint is kept.");
+ABSL_FLAG(std::vector<std::string>, synthesis_servers, {"localhost:10000"},
+          "Comma-separated list of synthesis server addresses.");
+ABSL_FLAG(int64, connections_per_server, 1,
+          "Number of concurrent connections to each synthesis server.");
+ABSL_FLAG(int64, frequency_start_hz, 100'000'000,
+          "Lowest frequency to search.");
+ABSL_FLAG(int64, frequency_limit_hz, 10'000'000'000,
+          "Highest frequency (inclusive) to search.");
+ABSL_FLAG(int64, frequency_step_hz, 10'000'000,
+          "The step between the searched frequencies.");
+ABSL_FLAG(absl::Duration, compile_timeout, absl::Hours(1),
+          "Deadline of each compile request, including the time spent waiting "
+          "for the server to become available. A request which exceeds it "
+          "fails its sweep; the other sweeps still run and are checkpointed.");
+ABSL_FLAG(int64, delay_offset_ps, 0,
+          "The delay_offset of each data point, e.g. the clock-to-Q and setup "
+          "time of the flops surrounding the operation.");
+
+namespace xls {
+namespace {
+
+// Returns a function which compiles requests on a connection of its own to
+// the server at 'address'. Each request fails if it has not completed within
+// 'timeout'.
+CompileFunction ConnectToServer(const std::string& address,
+                                absl::Duration timeout) {
+  // A local subchannel pool keeps channels with identical arguments from
+  // sharing a connection.
+  ::grpc::ChannelArguments args;
+  args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+  std::shared_ptr<synthesis::SynthesisService::Stub> stub =
+      synthesis::SynthesisService::NewStub(::grpc::CreateCustomChannel(
+          address, synthesis::GetClientCredentials(), args));
+  return [stub, address, timeout](const synthesis::CompileRequest& request)
+             -> absl::StatusOr<synthesis::CompileResponse> {
+    ::grpc::ClientContext context;
+    // Wait for the server rather than failing if it is not up yet, but not
+    // past the deadline so that a dead server doesn't block forever.
+    context.set_wait_for_ready(true);
+    context.set_deadline(absl::ToChronoTime(absl::Now() + timeout));
+    synthesis::CompileResponse response;
+    ::grpc::Status status = stub->Compile(&context, request, &response);
+    if (!status.ok()) {
+      return absl::Status(static_cast<absl::StatusCode>(status.error_code()),
+                          absl::StrFormat("Compile request to %s failed: %s",
+                                          address, status.error_message()));
+    }
+    return response;
+  };
+}
+
+absl::Status RealMain() {
+  XLS_ASSIGN_OR_RETURN(
+      delay_model::DelayCharacterizationSpec spec,
+      ParseTextProtoFile<delay_model::DelayCharacterizationSpec>(
+          absl::GetFlag(FLAGS_spec)));
+
+  std::vector<CompileFunction> connections;
+  for (const std::string& address : absl::GetFlag(FLAGS_synthesis_servers)) {
+    for (int64 i = 0; i < absl::GetFlag(FLAGS_connections_per_server); ++i) {
+      connections.push_back(
+          ConnectToServer(address, absl::GetFlag(FLAGS_compile_timeout)));
+    }
+  }
+  if (connections.empty()) {
+    return absl::InvalidArgumentError("No synthesis server connections");
+  }
+
+  CharacterizationOptions options;
+  options.search.start_hz = absl::GetFlag(FLAGS_frequency_start_hz);
+  options.search.limit_hz = absl::GetFlag(FLAGS_frequency_limit_hz);
+  options.search.step_hz = absl::GetFlag(FLAGS_frequency_step_hz);
+  options.delay_offset_ps = absl::GetFlag(FLAGS_delay_offset_ps);
+
+  std::unique_ptr<CharacterizationCheckpoint> checkpoint;
+  if (!absl::GetFlag(FLAGS_checkpoint).empty()) {
+    XLS_ASSIGN_OR_RETURN(
+        checkpoint, CharacterizationCheckpoint::Open(
+                        absl::GetFlag(FLAGS_checkpoint), options.search));
+    XLS_LOG(INFO) << absl::StreamFormat(
+        "Loaded %d synthesis sweeps from checkpoint %s", checkpoint->size(),
+        absl::GetFlag(FLAGS_checkpoint));
+  }
+
+  XLS_ASSIGN_OR_RETURN(
+      delay_model::DelayModel model,
+      RunDelayCharacterization(spec, options, connections, checkpoint.get()));
+  return SetTextProtoFile(absl::GetFlag(FLAGS_output_path), model);
+}
+
+}  // namespace
+}  // namespace xls
+
+int main(int argc, char** argv) {
+  std::vector<absl::string_view> positional_arguments =
+      xls::InitXls(kUsage, argc, argv);
+  if (!positional_arguments.empty()) {
+    XLS_LOG(QFATAL) << "Unexpected positional arguments: "
+                    << positional_arguments.size();
+  }
+  if (absl::GetFlag(FLAGS_spec).empty() ||
+      absl::GetFlag(FLAGS_output_path).empty()) {
+    XLS_LOG(QFATAL) << "--spec and --output_path are required";
+  }
+
+  XLS_QCHECK_OK(xls::RealMain());
+  return EXIT_SUCCESS;
+}
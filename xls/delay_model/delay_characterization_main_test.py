@@ -0,0 +1,122 @@
+# Lint as: python3
+#
+# Copyright 2020 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Tests of delay_characterization_main against the dummy synthesis server."""
+
+import subprocess
+
+import portpicker
+
+from google.protobuf import text_format
+from absl.testing import absltest
+from xls.common import runfiles
+from xls.delay_model import delay_model_pb2
+
+CHARACTERIZATION_MAIN_PATH = runfiles.get_path(
+    'xls/delay_model/delay_characterization_main')
+SERVER_PATH = runfiles.get_path('xls/synthesis/dummy_synthesis_server_main')
+
+SPEC = """
+op_sweeps {
+  op: "kAdd"
+  bit_counts: [8, 16, 32]
+  operand_count: 2
+}
+points {
+  operation {
+    op: "kAdd"
+    bit_count: 16
+    operands { bit_count: 16 }
+    operands { bit_count: 16 }
+  }
+}
+op_models {
+  op: "kAdd"
+  estimator {
+    regression {
+      factors { source: RESULT_BIT_COUNT }
+    }
+  }
+}
+"""
+
+
+class DelayCharacterizationMainTest(absltest.TestCase):
+
+  def _start_server(self, args):
+    port = portpicker.pick_unused_port()
+    proc = subprocess.Popen([SERVER_PATH, f'--port={port}'] + args)
+    self.addCleanup(proc.wait)
+    self.addCleanup(proc.terminate)
+    return port
+
+  def _characterize(self, port, args):
+    spec_file = self.create_tempfile(content=SPEC)
+    output_file = self.create_tempfile()
+    subprocess.check_call([
+        CHARACTERIZATION_MAIN_PATH, f'--spec={spec_file.full_path}',
+        f'--output_path={output_file.full_path}',
+        f'--synthesis_servers=localhost:{port}',
+        '--frequency_start_hz=1000000000', '--frequency_limit_hz=4000000000',
+        '--frequency_step_hz=100000000'
+    ] + args)
+    return text_format.Parse(output_file.read_text(),
+                             delay_model_pb2.DelayModel())
+
+  def test_concurrent_connections(self):
+    port = self._start_server(['--max_frequency_ghz=2.0'])
+    model = self._characterize(port, ['--connections_per_server=3'])
+    self.assertLen(model.op_models, 1)
+    self.assertEqual([p.operation.bit_count for p in model.data_points],
+                     [8, 16, 32, 16])
+    for data_point in model.data_points:
+      self.assertEqual(data_point.delay, 500)
+
+  def test_resume_from_checkpoint(self):
+    checkpoint = self.create_tempfile()
+    port = self._start_server(['--max_frequency_ghz=2.0'])
+    model = self._characterize(port, [f'--checkpoint={checkpoint.full_path}'])
+    # A line with the search options followed by a line per sweep.
+    self.assertLen(checkpoint.read_text().splitlines(), 4)
+
+    # All sweeps are in the checkpoint so a server which only serves errors
+    # is never used.
+    error_port = self._start_server(['--serve_errors'])
+    resumed_model = self._characterize(
+        error_port, [f'--checkpoint={checkpoint.full_path}'])
+    self.assertEqual(resumed_model, model)
+
+  def test_checkpoint_of_other_search_options(self):
+    checkpoint = self.create_tempfile()
+    port = self._start_server(['--max_frequency_ghz=2.0'])
+    self._characterize(port, [f'--checkpoint={checkpoint.full_path}'])
+    contents = checkpoint.read_text()
+
+    with self.assertRaises(subprocess.CalledProcessError):
+      self._characterize(port, [
+          f'--checkpoint={checkpoint.full_path}',
+          '--frequency_step_hz=50000000'
+      ])
+    self.assertEqual(checkpoint.read_text(), contents)
+
+  def test_dead_server_times_out(self):
+    # Nothing listens on the port so requests wait until their deadline.
+    port = portpicker.pick_unused_port()
+    with self.assertRaises(subprocess.CalledProcessError):
+      self._characterize(port, ['--compile_timeout=1s'])
+
+
+if __name__ == '__main__':
+  absltest.main()
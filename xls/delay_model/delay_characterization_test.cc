@@ -0,0 +1,347 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/delay_model/delay_characterization.h"
+
+#include <atomic>
+#include <vector>
+
+#include "google/protobuf/text_format.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/match.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/temp_directory.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/matchers.h"
+
+namespace xls {
+namespace {
+
+using delay_model::CharacterizationPoint;
+using delay_model::DelayCharacterizationSpec;
+using delay_model::DelayModel;
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+using synthesis::CompileRequest;
+using synthesis::CompileResponse;
+using synthesis::SynthesisSweepResult;
+using ::testing::HasSubstr;
+
+CharacterizationPoint ParsePoint(const std::string& text) {
+  CharacterizationPoint point;
+  XLS_CHECK(google::protobuf::TextFormat::ParseFromString(text, &point));
+  return point;
+}
+
+// A fake synthesis service in which the delay of a module grows with the
+// widths of its ports. Counts the compile requests it receives.
+class FakeSynthesis {
+ public:
+  static int64 DelayPs(const CompileRequest& request) {
+    int64 delay = 100;
+    for (const verilog::PortProto& port : request.signature().data_ports()) {
+      delay += port.width();
+    }
+    return delay;
+  }
+
+  CompileFunction AsFunction() {
+    return [this](const CompileRequest& request)
+               -> absl::StatusOr<CompileResponse> {
+      ++compile_count_;
+      if (!fail_module_.empty() &&
+          absl::StrContains(request.module_text(), fail_module_)) {
+        return absl::UnavailableError("Synthesis server went away");
+      }
+      CompileResponse response;
+      response.set_slack_ps(int64{1'000'000'000'000} /
+                                request.target_frequency_hz() -
+                            DelayPs(request));
+      response.set_netlist("// NETLIST");
+      return response;
+    };
+  }
+
+  int64 compile_count() const { return compile_count_; }
+  void set_fail_module(std::string text) { fail_module_ = std::move(text); }
+
+ private:
+  std::atomic<int64> compile_count_{0};
+  std::string fail_module_;
+};
+
+CharacterizationOptions TestOptions() {
+  CharacterizationOptions options;
+  options.search.start_hz = 100'000'000;
+  options.search.limit_hz = 10'000'000'000;
+  options.search.step_hz = 100'000'000;
+  options.delay_offset_ps = 7;
+  return options;
+}
+
+DelayCharacterizationSpec TestSpec() {
+  DelayCharacterizationSpec spec;
+  XLS_CHECK(google::protobuf::TextFormat::ParseFromString(
+      R"(op_sweeps {
+           op: "kAdd"
+           bit_counts: [8, 16, 32]
+           operand_count: 2
+         }
+         op_sweeps {
+           op: "kUMul"
+           bit_counts: [8]
+           operand_count: 2
+           specializations: [NO_SPECIALIZATION, OPERANDS_IDENTICAL]
+         }
+         points {
+           operation {
+             op: "kAdd"
+             bit_count: 16
+             operands { bit_count: 16 }
+             operands { bit_count: 16 }
+           }
+         }
+         op_models { op: "kAdd" estimator { fixed: 42 } })",
+      &spec));
+  return spec;
+}
+
+TEST(DelayCharacterizationTest, GenerateOpIr) {
+  EXPECT_THAT(GenerateOpIr(ParsePoint(R"(operation {
+                                           op: "kAdd"
+                                           bit_count: 8
+                                           operands { bit_count: 8 }
+                                           operands { bit_count: 8 }
+                                         })")),
+              IsOkAndHolds(R"(package add_characterization
+
+fn main(op0: bits[8], op1: bits[8]) -> bits[8] {
+  ret add.2: bits[8] = add(op0, op1)
+}
+)"));
+  EXPECT_THAT(GenerateOpIr(ParsePoint(R"(operation {
+                                           op: "kZeroExt"
+                                           bit_count: 32
+                                           operands { bit_count: 8 }
+                                         })")),
+              IsOkAndHolds(HasSubstr(
+                  "ret zero_ext.2: bits[32] = zero_ext(op0, "
+                  "new_bit_count=32)")));
+  EXPECT_THAT(GenerateOpIr(ParsePoint(R"(operation {
+                                           op: "kUMul"
+                                           bit_count: 16
+                                           operands { bit_count: 16 }
+                                           operands { bit_count: 16 }
+                                           specialization: OPERANDS_IDENTICAL
+                                         })")),
+              IsOkAndHolds(HasSubstr(
+                  "fn main(op0: bits[16]) -> bits[16] {\n"
+                  "  ret umul.2: bits[16] = umul(op0, op0)")));
+  EXPECT_THAT(GenerateOpIr(ParsePoint(R"(operation {
+                                           op: "kShll"
+                                           bit_count: 16
+                                           operands { bit_count: 16 }
+                                           operands { bit_count: 4 }
+                                           specialization: HAS_LITERAL_OPERAND
+                                         })")),
+              IsOkAndHolds(HasSubstr("literal.1: bits[4] = literal(value=0x")));
+  EXPECT_THAT(GenerateOpIr(ParsePoint(R"(operation {
+                                           op: "kBitSlice"
+                                           bit_count: 4
+                                           operands { bit_count: 16 }
+                                         }
+                                         attributes {
+                                           name: "start"
+                                           value: "3"
+                                         })")),
+              IsOkAndHolds(HasSubstr("bit_slice(op0, start=3, width=4)")));
+  EXPECT_THAT(GenerateOpIr(ParsePoint(R"(operation { op: "kFrobnicate" })")),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unknown op \"kFrobnicate\"")));
+}
+
+TEST(DelayCharacterizationTest, BisectFrequency) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::string ir_text,
+                           GenerateOpIr(ParsePoint(R"(operation {
+                                                        op: "kAdd"
+                                                        bit_count: 8
+                                                        operands { bit_count: 8 }
+                                                        operands { bit_count: 8 }
+                                                      })")));
+  XLS_ASSERT_OK_AND_ASSIGN(CompileRequest request, GenerateOpModule(ir_text));
+  EXPECT_EQ(request.top_module_name(), kOpModuleName);
+  EXPECT_EQ(request.signature().module_name(), kOpModuleName);
+
+  FakeSynthesis synthesis;
+  CharacterizationOptions options = TestOptions();
+  XLS_ASSERT_OK_AND_ASSIGN(
+      SynthesisSweepResult result,
+      BisectFrequency(request, options.search, synthesis.AsFunction()));
+  // The highest frequency on the search grid whose period covers the delay.
+  int64 expected_hz = 1e12 / FakeSynthesis::DelayPs(request);
+  expected_hz -= expected_hz % options.search.step_hz;
+  EXPECT_EQ(result.max_frequency_hz(), expected_hz);
+  EXPECT_EQ(result.module_text(), request.module_text());
+  EXPECT_EQ(result.results_size(), synthesis.compile_count());
+  // The search is logarithmic in the number of considered frequencies.
+  EXPECT_LE(synthesis.compile_count(), 7);
+
+  // No frequency meets timing.
+  options.search.start_hz = 1e12 / FakeSynthesis::DelayPs(request) + 1;
+  XLS_ASSERT_OK_AND_ASSIGN(
+      result, BisectFrequency(request, options.search, synthesis.AsFunction()));
+  EXPECT_EQ(result.max_frequency_hz(), 0);
+}
+
+TEST(DelayCharacterizationTest, RunDedupesModules) {
+  FakeSynthesis synthesis;
+  std::vector<CompileFunction> connections(3, synthesis.AsFunction());
+  XLS_ASSERT_OK_AND_ASSIGN(
+      DelayModel model, RunDelayCharacterization(TestSpec(), TestOptions(),
+                                                 connections,
+                                                 /*checkpoint=*/nullptr));
+  ASSERT_EQ(model.op_models_size(), 1);
+  EXPECT_EQ(model.op_models(0).op(), "kAdd");
+  // Six points, of which the explicit 16-bit add duplicates a point of the
+  // sweep.
+  ASSERT_EQ(model.data_points_size(), 6);
+  EXPECT_EQ(model.data_points(0).operation().op(), "kAdd");
+  EXPECT_EQ(model.data_points(0).operation().bit_count(), 8);
+  EXPECT_EQ(model.data_points(4).operation().specialization(),
+            delay_model::OPERANDS_IDENTICAL);
+  EXPECT_EQ(model.data_points(1).delay(), model.data_points(5).delay());
+  for (const delay_model::DataPoint& data_point : model.data_points()) {
+    EXPECT_EQ(data_point.delay_offset(), 7);
+    EXPECT_GT(data_point.delay(), 100);
+  }
+  EXPECT_LT(model.data_points(0).delay(), model.data_points(2).delay());
+
+  // The duplicate point adds no synthesis runs.
+  DelayCharacterizationSpec deduped_spec = TestSpec();
+  deduped_spec.clear_points();
+  FakeSynthesis deduped_synthesis;
+  XLS_ASSERT_OK(RunDelayCharacterization(deduped_spec, TestOptions(),
+                                         {deduped_synthesis.AsFunction()},
+                                         /*checkpoint=*/nullptr)
+                    .status());
+  EXPECT_EQ(synthesis.compile_count(), deduped_synthesis.compile_count());
+}
+
+TEST(DelayCharacterizationTest, ResumeFromCheckpoint) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  std::filesystem::path path = temp_dir.path() / "checkpoint.textproto";
+
+  FakeSynthesis synthesis;
+  DelayModel model;
+  {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        auto checkpoint,
+        CharacterizationCheckpoint::Open(path, TestOptions().search));
+    std::vector<CompileFunction> connections(2, synthesis.AsFunction());
+    XLS_ASSERT_OK_AND_ASSIGN(
+        model, RunDelayCharacterization(TestSpec(), TestOptions(), connections,
+                                        checkpoint.get()));
+    EXPECT_EQ(checkpoint->size(), 5);
+  }
+  EXPECT_GT(synthesis.compile_count(), 0);
+  XLS_ASSERT_OK_AND_ASSIGN(std::string contents, GetFileContents(path));
+  EXPECT_FALSE(absl::StrContains(contents, "NETLIST"));
+
+  // Simulate a process killed while writing a result.
+  XLS_ASSERT_OK(AppendStringToFile(path, "module_text: \"module trunc"));
+
+  FakeSynthesis resumed_synthesis;
+  XLS_ASSERT_OK_AND_ASSIGN(
+      auto checkpoint,
+      CharacterizationCheckpoint::Open(path, TestOptions().search));
+  EXPECT_EQ(checkpoint->size(), 5);
+  XLS_ASSERT_OK_AND_ASSIGN(
+      DelayModel resumed_model,
+      RunDelayCharacterization(TestSpec(), TestOptions(),
+                               {resumed_synthesis.AsFunction()},
+                               checkpoint.get()));
+  EXPECT_EQ(resumed_synthesis.compile_count(), 0);
+  EXPECT_EQ(resumed_model.DebugString(), model.DebugString());
+  XLS_ASSERT_OK_AND_ASSIGN(std::string resumed_contents, GetFileContents(path));
+  EXPECT_EQ(resumed_contents, contents);
+}
+
+TEST(DelayCharacterizationTest, FailedSweepsAreRetried) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  std::filesystem::path path = temp_dir.path() / "checkpoint.textproto";
+  XLS_ASSERT_OK_AND_ASSIGN(
+      auto checkpoint,
+      CharacterizationCheckpoint::Open(path, TestOptions().search));
+
+  // Fail the sweeps of the multiplies.
+  FakeSynthesis synthesis;
+  synthesis.set_fail_module("umul");
+  std::vector<CompileFunction> connections(2, synthesis.AsFunction());
+  EXPECT_THAT(RunDelayCharacterization(TestSpec(), TestOptions(), connections,
+                                       checkpoint.get()),
+              StatusIs(absl::StatusCode::kUnavailable,
+                       HasSubstr("2 of 5 synthesis sweeps failed")));
+  EXPECT_EQ(checkpoint->size(), 3);
+
+  // Only the failed sweeps are run again.
+  FakeSynthesis retry_synthesis;
+  XLS_ASSERT_OK_AND_ASSIGN(
+      DelayModel model,
+      RunDelayCharacterization(TestSpec(), TestOptions(),
+                               {retry_synthesis.AsFunction()},
+                               checkpoint.get()));
+  EXPECT_EQ(model.data_points_size(), 6);
+  EXPECT_EQ(checkpoint->size(), 5);
+  EXPECT_GT(retry_synthesis.compile_count(), 0);
+  EXPECT_LE(retry_synthesis.compile_count(), 2 * 7);
+}
+
+TEST(DelayCharacterizationTest, CheckpointOfOtherSearchOptions) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  std::filesystem::path path = temp_dir.path() / "checkpoint.textproto";
+  {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        auto checkpoint,
+        CharacterizationCheckpoint::Open(path, TestOptions().search));
+    FakeSynthesis synthesis;
+    XLS_ASSERT_OK(RunDelayCharacterization(TestSpec(), TestOptions(),
+                                           {synthesis.AsFunction()},
+                                           checkpoint.get())
+                      .status());
+    EXPECT_EQ(checkpoint->size(), 5);
+  }
+
+  // The sweeps of a finer search would measure different delays so the
+  // recorded sweeps must not be reused.
+  CharacterizationOptions finer_options = TestOptions();
+  finer_options.search.step_hz = 10'000'000;
+  EXPECT_THAT(CharacterizationCheckpoint::Open(path, finer_options.search),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       HasSubstr("different search options")));
+  CharacterizationOptions higher_options = TestOptions();
+  higher_options.search.limit_hz = 20'000'000'000;
+  EXPECT_THAT(CharacterizationCheckpoint::Open(path, higher_options.search),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+
+  // The checkpoint is left intact and can still be resumed with its own
+  // options.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      auto checkpoint,
+      CharacterizationCheckpoint::Open(path, TestOptions().search));
+  EXPECT_EQ(checkpoint->size(), 5);
+}
+
+}  // namespace
+}  // namespace xls
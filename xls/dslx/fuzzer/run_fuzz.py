@@ -32,6 +32,7 @@ from xls.dslx.fuzzer import ast_generator
 from xls.dslx.fuzzer import sample
 from xls.dslx.fuzzer import sample_generator
 from xls.dslx.fuzzer import sample_runner
+from xls.dslx.fuzzer import sample_server
 
 SAMPLE_RUNNER_MAIN_PATH = runfiles.get_path(
     'xls/dslx/fuzzer/sample_runner_main')
@@ -70,7 +71,8 @@ def _write_ir_summaries(run_dir, summary_path):
 
 def run_sample(smp: sample.Sample,
                run_dir: Text,
-               summary_file: Optional[Text] = None):
+               summary_file: Optional[Text] = None,
+               server: Optional[sample_server.SampleServer] = None):
   """Runs the given sample in the given directory.
 
   Args:
@@ -78,6 +80,7 @@ def run_sample(smp: sample.Sample,
     run_dir: Directory to run the sample in. The directory should exist and be
       empty.
     summary_file: The (optional) file to append sample summary.
+    server: The (optional) sample server to run the IR of the sample in.
 
   Raises:
     sample_runner.SampleError: on any non-zero status from the sample runner.
@@ -104,7 +107,7 @@ def run_sample(smp: sample.Sample,
   start = time.time()
   logging.vlog(1, 'Starting to run sample')
   logging.vlog(2, smp.input_text)
-  runner = sample_runner.SampleRunner(run_dir)
+  runner = sample_runner.SampleRunner(run_dir, server)
   runner.run_from_files('sample.x', 'options.json', 'args.txt')
   logging.vlog(1, 'Completed running sample, elapsed: %0.2fs',
                time.time() - start)
@@ -38,6 +38,7 @@ from xls.dslx.fuzzer import ast_generator
 from xls.dslx.fuzzer import run_fuzz
 from xls.dslx.fuzzer import sample_generator
 from xls.dslx.fuzzer import sample_runner
+from xls.dslx.fuzzer import sample_server
 from xls.dslx.fuzzer.sample import Sample
 from xls.dslx.fuzzer.sample import SampleOptions
 
@@ -91,8 +92,13 @@ def do_worker_task(workerno: int,
                    crash_path: Text,
                    summary_path: Optional[Text] = None,
                    save_temps_path: Optional[Text] = None,
-                   minimize_ir: bool = True) -> None:
-  """Runs worker task, receiving commands from generator and executing them."""
+                   minimize_ir: bool = True,
+                   use_sample_server: bool = False) -> None:
+  """Runs worker task, receiving commands from generator and executing them.
+
+  If use_sample_server is true the IR of the samples is run in a sample server
+  owned by the worker rather than in a subprocess per operation.
+  """
   queue = queue or multiprocess.get_user_data()[workerno]
   crashers = 0
   calls = 0
@@ -108,6 +114,8 @@ def do_worker_task(workerno: int,
   summary_temp_file = tempfile.mkstemp(
       prefix='temp_summary_')[1] if summary_path else None
 
+  server = sample_server.SampleServer() if use_sample_server else None
+
   i = 0  # Silence pylint warning.
   for i in itertools.count():
     command, payload = queue.get()
@@ -124,7 +132,8 @@ def do_worker_task(workerno: int,
       run_dir = tempfile.mkdtemp(prefix='run_fuzz_')
 
     try:
-      run_fuzz.run_sample(sample, run_dir, summary_file=summary_temp_file)
+      run_fuzz.run_sample(
+          sample, run_dir, summary_file=summary_temp_file, server=server)
     except sample_runner.SampleError:
       crashers += 1
       record_crasher(workerno, sampleno, minimize_ir, sample, run_dir,
@@ -149,6 +158,9 @@ def do_worker_task(workerno: int,
           workerno, i / elapsed, calls / elapsed))
       sys.stdout.flush()
 
+  if server:
+    server.close()
+
   elapsed = (datetime.datetime.now() - start).total_seconds()
   print(
       '---- Worker {:3} finished! {:3} crashers; {:8.2f} samples/s; {:8.2f} calls/s'
@@ -87,6 +87,11 @@ flags.DEFINE_integer(
 flags.DEFINE_boolean(
     'use_system_verilog', True,
     'If true, emit SystemVerilog during codegen otherwise emit Verilog.')
+flags.DEFINE_boolean(
+    'use_sample_server', True,
+    'If true, each worker runs the IR of its samples (evaluation, '
+    'optimization, codegen and simulation) in a long-lived sample_server_main '
+    'process rather than in a subprocess per operation.')
 FLAGS = flags.FLAGS
 
 QUEUE_MAX_BACKLOG = 16
@@ -122,7 +127,7 @@ def main(argv):
 
     target = run_fuzz_multiprocess.do_worker_task
     args = (i, queue, FLAGS.crash_path, FLAGS.summary_path,
-            FLAGS.save_temps_path, FLAGS.minimize_ir)
+            FLAGS.save_temps_path, FLAGS.minimize_ir, FLAGS.use_sample_server)
 
     worker = multiprocess.Process(target=target, args=args)
 
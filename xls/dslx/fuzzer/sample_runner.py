@@ -29,11 +29,14 @@ from xls.common import revision
 from xls.common import runfiles
 from xls.common.xls_error import XlsError
 from xls.dslx import concrete_type as concrete_type_mod
+from xls.dslx import ir_converter
 from xls.dslx import parse_and_typecheck
 from xls.dslx import type_info as type_info_mod
 from xls.dslx import typecheck
 from xls.dslx.concrete_type import ConcreteType
 from xls.dslx.fuzzer import sample
+from xls.dslx.fuzzer import sample_server as sample_server_mod
+from xls.dslx.fuzzer import sample_server_pb2
 from xls.dslx.interpreter.interpreter import Interpreter
 from xls.dslx.interpreter.value import Value
 from xls.dslx.interpreter.value_parser import value_from_string
@@ -153,10 +156,17 @@ class SampleRunner:
   The runner operates in a single directory supplied at construction time and
   records all state, command invocations, and outputs to that directory to
   enable easier debugging and replay.
+
+  By default each operation runs as a separate subprocess. If a SampleServer is
+  given, the DSLX is converted to IR in this process and the IR operations run
+  in the server; the same files are written to the run directory.
   """
 
-  def __init__(self, run_dir: Text):
+  def __init__(self,
+               run_dir: Text,
+               server: Optional[sample_server_mod.SampleServer] = None):
     self._run_dir = run_dir
+    self._server = server
 
   def run(self, smp: sample.Sample):
     """Runs the given sample.
@@ -232,10 +242,18 @@ class SampleRunner:
 
         if not options.convert_to_ir:
           return
-        ir_filename = self._dslx_to_ir(input_filename)
+        if self._server:
+          ir_filename = self._convert_dslx_to_ir(input_filename, input_text)
+        else:
+          ir_filename = self._dslx_to_ir(input_filename)
       else:
         ir_filename = self._write_file('sample.ir', input_text)
 
+      if self._server:
+        self._run_ir_on_server(ir_filename, args_filename, options, results)
+        self._compare_results(results, args_batch)
+        return
+
       if args_filename is not None:
         # Unconditionally evaluate with the interpreter even if using the
         # JIT. This exercises the interpreter and serves as a reference.
@@ -318,6 +336,70 @@ class SampleRunner:
 
     return comp.stdout.decode('utf-8')
 
+  def _run_ir_on_server(self, ir_filename: Text, args_filename: Optional[Text],
+                        options: sample.SampleOptions,
+                        results: Dict[Text, Sequence[Value]]):
+    """Runs the IR operations of the sample in the sample server.
+
+    Adds the results of evaluation and simulation to 'results' and writes the
+    files the subprocess operations would write.
+
+    Args:
+      ir_filename: The filename of the IR of the sample.
+      args_filename: The optional filename of the serialized ArgsBatch.
+      options: The options of the sample.
+      results: Map of result Values to add to.
+
+    Raises:
+      SampleError: If an operation failed.
+    """
+    request = sample_server_pb2.SampleRequestProto(
+        ir_text=self._read_file(ir_filename),
+        optimize_ir=options.optimize_ir,
+        use_jit=options.use_jit,
+        codegen=options.codegen,
+        simulate=options.simulate,
+        simulator=options.simulator or '')
+    if args_filename is not None:
+      request.args.extend(line
+                          for line in self._read_file(args_filename).split('\n')
+                          if line.strip())
+    # As in _codegen, the options may override the delay model.
+    request.codegen_args.append('--delay_model=unit')
+    request.codegen_args.extend(options.codegen_args or ())
+    if options.simulate:
+      check_simulator.check_simulator(options.simulator)
+
+    start = time.time()
+    logging.vlog(1, 'Running IR in sample server')
+    try:
+      response = self._server.run(request)
+    except sample_server_mod.SampleServerError as e:
+      self._write_file('sample_server_main.stderr', e.stderr)
+      raise
+    logging.vlog(1, 'Running IR in sample server complete, elapsed %0.2fs',
+                 time.time() - start)
+
+    if response.opt_ir_text:
+      self._write_file('sample.opt.ir', response.opt_ir_text)
+    if response.verilog_text:
+      self._write_file('sample.v', response.verilog_text)
+      self._write_file('module_sig.textproto', response.signature_text)
+    # The results files written by the subprocess operations.
+    results_filenames = {
+        'evaluated unopt IR (interpreter)': 'sample.ir.results',
+        'evaluated unopt IR (JIT)': 'sample.ir.results',
+        'evaluated opt IR (interpreter)': 'sample.opt.ir.results',
+        'evaluated opt IR (JIT)': 'sample.opt.ir.results',
+        'simulated': 'sample.v.results',
+    }
+    for result in response.results:
+      results_text = '\n'.join(result.values)
+      self._write_file(results_filenames[result.name], results_text)
+      results[result.name] = self._parse_values(results_text)
+    if response.error:
+      raise SampleError(response.error)
+
   def _write_file(self, filename: Text, content: Text) -> Text:
     """Writes the given content into a named file in the run directory."""
     with open(os.path.join(self._run_dir, filename), 'w') as f:
@@ -425,6 +507,32 @@ class SampleRunner:
                                 (IR_CONVERTER_MAIN_PATH, dslx_filename))
     return self._write_file('sample.ir', ir_text)
 
+  def _convert_dslx_to_ir(self, dslx_filename: Text, dslx_text: Text) -> Text:
+    """Converts the DSLX to an IR file in this process.
+
+    The module is named after the file as in ir_converter_main so the IR is the
+    same as that of _dslx_to_ir.
+
+    Args:
+      dslx_filename: The filename of the DSLX in the run directory.
+      dslx_text: The DSLX text.
+
+    Returns:
+      The filename of the IR.
+    """
+    start = time.time()
+    name, _ = os.path.splitext(dslx_filename)
+    m, type_info = parse_and_typecheck.parse_text(
+        dslx_text,
+        name,
+        print_on_error=True,
+        f_import=None,
+        filename=os.path.join(self._run_dir, dslx_filename))
+    ir_text = ir_converter.convert_module(m, type_info)
+    logging.vlog(1, 'Converting DSLX to IR complete, elapsed %0.2fs',
+                 time.time() - start)
+    return self._write_file('sample.ir', ir_text)
+
   def _optimize_ir(self, ir_filename: Text) -> Text:
     """Optimizes the IR file and returns the resulting filename."""
     opt_ir_text = self._run_command('Optimizing IR',
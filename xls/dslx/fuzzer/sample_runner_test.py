@@ -26,6 +26,7 @@ from xls.dslx.concrete_type import BitsType
 from xls.dslx.concrete_type import TupleType
 from xls.dslx.fuzzer import sample
 from xls.dslx.fuzzer import sample_runner
+from xls.dslx.fuzzer import sample_server
 from xls.dslx.interpreter.value import Value
 
 
@@ -327,6 +328,56 @@ class SampleRunnerTest(test_base.TestCase):
         _read_file(sample_dir, 'exception.txt'),
         '.*opt_main.*returned non-zero exit status')
 
+  def test_sample_server(self):
+    with sample_server.SampleServer() as server:
+      sample_dir = self._make_sample_dir()
+      runner = sample_runner.SampleRunner(sample_dir, server)
+      dslx_text = 'fn main(x: u8, y: u8) -> u8 { x + y }'
+      runner.run(
+          sample.Sample(
+              dslx_text,
+              sample.SampleOptions(
+                  codegen=True, codegen_args=['--generator=combinational']),
+              [[Value.make_ubits(8, 42),
+                Value.make_ubits(8, 100)]]))
+      self.assertIn('package sample', _read_file(sample_dir, 'sample.ir'))
+      self.assertIn('package sample', _read_file(sample_dir, 'sample.opt.ir'))
+      self.assertSequenceEqual(
+          _split_nonempty_lines(sample_dir, 'sample.ir.results'),
+          ['bits[8]:0x8e'])
+      self.assertSequenceEqual(
+          _split_nonempty_lines(sample_dir, 'sample.opt.ir.results'),
+          ['bits[8]:0x8e'])
+      self.assertIn('endmodule', _read_file(sample_dir, 'sample.v'))
+      self.assertIn('combinational',
+                    _read_file(sample_dir, 'module_sig.textproto'))
+
+      # A failing sample does not stop the server from running the next one.
+      sample_dir = self._make_sample_dir()
+      runner = sample_runner.SampleRunner(sample_dir, server)
+      with self.assertRaises(sample_runner.SampleError):
+        runner.run(
+            sample.Sample('bogus ir string',
+                          sample.SampleOptions(input_is_dslx=False)))
+      self.assertIn('Parsing IR failed',
+                    _read_file(sample_dir, 'exception.txt'))
+
+      sample_dir = self._make_sample_dir()
+      runner = sample_runner.SampleRunner(sample_dir, server)
+      ir_text = """package foo
+
+      fn foo(x: bits[8], y: bits[8]) -> bits[8] {
+        ret add.1: bits[8] = add(x, y)
+      }
+      """
+      runner.run(
+          sample.Sample(ir_text, sample.SampleOptions(input_is_dslx=False),
+                        [[Value.make_ubits(8, 42),
+                          Value.make_ubits(8, 100)]]))
+      self.assertSequenceEqual(
+          _split_nonempty_lines(sample_dir, 'sample.opt.ir.results'),
+          ['bits[8]:0x8e'])
+
   def test_sign_convert_args_batch(self):
     dslx_text = 'fn main(y: s8) -> s8 { y }'
     filename = '/fake/test_module.x'
@@ -0,0 +1,402 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/dslx/fuzzer/sample_server.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "google/protobuf/text_format.h"
+#include "absl/flags/marshalling.h"
+#include "absl/status/status.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include "absl/types/span.h"
+#include "xls/codegen/combinational_generator.h"
+#include "xls/codegen/module_signature.h"
+#include "xls/codegen/pipeline_generator.h"
+#include "xls/common/integral_types.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/delay_model/delay_estimator.h"
+#include "xls/delay_model/delay_estimators.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/package.h"
+#include "xls/ir/value.h"
+#include "xls/jit/llvm_ir_jit.h"
+#include "xls/passes/passes.h"
+#include "xls/passes/standard_pipeline.h"
+#include "xls/scheduling/pipeline_schedule.h"
+#include "xls/scheduling/scheduling_pass.h"
+#include "xls/simulation/module_simulator.h"
+#include "xls/simulation/verilog_simulators.h"
+
+namespace xls {
+namespace {
+
+// The subset of the flags of codegen_main which the fuzzer passes as codegen
+// arguments, with the same defaults.
+struct CodegenArgs {
+  std::string generator = "pipeline";
+  int64 pipeline_stages = 0;
+  int64 clock_period_ps = 0;
+  std::string delay_model = "";
+  bool use_system_verilog = true;
+};
+
+absl::StatusOr<CodegenArgs> ParseCodegenArgs(
+    absl::Span<const std::string> args) {
+  CodegenArgs result;
+  for (const std::string& arg : args) {
+    absl::string_view flag = arg;
+    if (!absl::ConsumePrefix(&flag, "--")) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Invalid codegen argument: %s", arg));
+    }
+    std::vector<absl::string_view> name_value =
+        absl::StrSplit(flag, absl::MaxSplits('=', 1));
+    absl::string_view name = name_value[0];
+    absl::optional<std::string> value;
+    if (name_value.size() == 2) {
+      value = std::string(name_value[1]);
+    }
+    std::string error;
+    bool parsed;
+    if (name == "nouse_system_verilog" && !value.has_value()) {
+      result.use_system_verilog = false;
+      parsed = true;
+    } else if (name == "use_system_verilog") {
+      result.use_system_verilog = true;
+      parsed = !value.has_value() ||
+               absl::ParseFlag(*value, &result.use_system_verilog, &error);
+    } else if (!value.has_value()) {
+      parsed = false;
+    } else if (name == "generator") {
+      result.generator = *value;
+      parsed = true;
+    } else if (name == "delay_model") {
+      result.delay_model = *value;
+      parsed = true;
+    } else if (name == "pipeline_stages") {
+      parsed = absl::ParseFlag(*value, &result.pipeline_stages, &error);
+    } else if (name == "clock_period_ps") {
+      parsed = absl::ParseFlag(*value, &result.clock_period_ps, &error);
+    } else {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Unsupported codegen argument: %s", arg));
+    }
+    if (!parsed) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Invalid codegen argument: %s %s", arg, error));
+    }
+  }
+  return result;
+}
+
+// Parses each line of arguments of the request into a list of values.
+absl::StatusOr<std::vector<std::vector<Value>>> ParseArgsBatch(
+    const fuzzer::SampleRequestProto& request) {
+  std::vector<std::vector<Value>> args_batch;
+  for (const std::string& line : request.args()) {
+    std::vector<Value> args;
+    for (absl::string_view arg :
+         absl::StrSplit(line, ';', absl::SkipWhitespace())) {
+      XLS_ASSIGN_OR_RETURN(Value value, Parser::ParseTypedValue(arg));
+      args.push_back(std::move(value));
+    }
+    args_batch.push_back(std::move(args));
+  }
+  return args_batch;
+}
+
+// Evaluates the entry function of the package with each set of arguments and
+// adds the results to the response under the given name.
+absl::Status Evaluate(Package* package,
+                      absl::Span<const std::vector<Value>> args_batch,
+                      bool use_jit, absl::string_view name,
+                      fuzzer::SampleResponseProto* response) {
+  XLS_ASSIGN_OR_RETURN(Function * f, package->EntryFunction());
+  std::unique_ptr<LlvmIrJit> jit;
+  if (use_jit) {
+    XLS_ASSIGN_OR_RETURN(jit, LlvmIrJit::Create(f));
+  }
+  fuzzer::SampleResultsProto results;
+  results.set_name(std::string(name));
+  for (const std::vector<Value>& args : args_batch) {
+    Value result;
+    if (use_jit) {
+      XLS_ASSIGN_OR_RETURN(result, jit->Run(args));
+    } else {
+      XLS_ASSIGN_OR_RETURN(result, IrInterpreter::Run(f, args));
+    }
+    results.add_values(result.ToString(FormatPreference::kHex));
+  }
+  *response->add_results() = std::move(results);
+  return absl::OkStatus();
+}
+
+// Generates Verilog for the entry function of the package as codegen_main does
+// with the given arguments.
+absl::StatusOr<verilog::ModuleGeneratorResult> Codegen(
+    Package* package, const CodegenArgs& args) {
+  XLS_ASSIGN_OR_RETURN(Function * main, package->EntryFunction());
+  if (args.generator == "combinational") {
+    return verilog::ToCombinationalModuleText(main, args.use_system_verilog);
+  }
+  if (args.generator != "pipeline") {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Invalid value for --generator: %s. Expected "
+                        "'pipeline' or 'combinational'",
+                        args.generator));
+  }
+  if (args.pipeline_stages == 0 && args.clock_period_ps == 0) {
+    return absl::InvalidArgumentError(
+        "Must specify --pipeline_stages or --clock_period_ps (or both).");
+  }
+  SchedulingPassOptions sched_options;
+  if (args.pipeline_stages != 0) {
+    sched_options.scheduling_options.pipeline_stages(args.pipeline_stages);
+  }
+  if (args.clock_period_ps != 0) {
+    sched_options.scheduling_options.clock_period_ps(args.clock_period_ps);
+  }
+  XLS_ASSIGN_OR_RETURN(sched_options.delay_estimator,
+                       GetDelayEstimator(args.delay_model));
+  std::unique_ptr<SchedulingCompoundPass> scheduling_pipeline =
+      CreateStandardSchedulingPassPipeline();
+  SchedulingPassResults results;
+  SchedulingUnit scheduling_unit = {package, /*schedule=*/absl::nullopt};
+  XLS_RETURN_IF_ERROR(
+      scheduling_pipeline->Run(&scheduling_unit, sched_options, &results)
+          .status());
+  XLS_RET_CHECK(scheduling_unit.schedule.has_value());
+
+  verilog::PipelineOptions pipeline_options;
+  pipeline_options.use_system_verilog(args.use_system_verilog);
+  return verilog::ToPipelineModuleText(*scheduling_unit.schedule, main,
+                                       pipeline_options);
+}
+
+// Simulates the generated Verilog with each set of arguments and adds the
+// results to the response.
+absl::Status Simulate(const verilog::ModuleGeneratorResult& codegen_result,
+                      absl::Span<const std::vector<Value>> args_batch,
+                      absl::string_view simulator_name,
+                      fuzzer::SampleResponseProto* response) {
+  const verilog::VerilogSimulator* simulator;
+  if (simulator_name.empty()) {
+    simulator = &verilog::GetDefaultVerilogSimulator();
+  } else {
+    XLS_ASSIGN_OR_RETURN(simulator,
+                         verilog::GetVerilogSimulator(simulator_name));
+  }
+  verilog::ModuleSimulator module_simulator(
+      codegen_result.signature, codegen_result.verilog_text, simulator);
+  std::vector<absl::flat_hash_map<std::string, Value>> kwargs_batch;
+  for (const std::vector<Value>& args : args_batch) {
+    XLS_ASSIGN_OR_RETURN(auto kwargs, codegen_result.signature.ToKwargs(args));
+    kwargs_batch.push_back(std::move(kwargs));
+  }
+  XLS_ASSIGN_OR_RETURN(std::vector<Value> outputs,
+                       module_simulator.RunBatched(kwargs_batch));
+  fuzzer::SampleResultsProto* results = response->add_results();
+  results->set_name("simulated");
+  for (const Value& output : outputs) {
+    results->add_values(output.ToString(FormatPreference::kHex));
+  }
+  return absl::OkStatus();
+}
+
+// Runs the stages of the sample in the order of SampleRunner.run_from_files.
+// Sets 'stage' to the description of each stage before running it.
+absl::Status RunStages(const fuzzer::SampleRequestProto& request,
+                       std::string* stage,
+                       fuzzer::SampleResponseProto* response) {
+  *stage = "Parsing IR";
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                       Parser::ParsePackage(request.ir_text()));
+  XLS_ASSIGN_OR_RETURN(std::vector<std::vector<Value>> args_batch,
+                       ParseArgsBatch(request));
+  const bool evaluate = !args_batch.empty();
+
+  if (evaluate) {
+    // Unconditionally evaluate with the interpreter even if using the JIT.
+    // This exercises the interpreter and serves as a reference.
+    *stage = "Evaluating unoptimized IR with the interpreter";
+    XLS_RETURN_IF_ERROR(Evaluate(package.get(), args_batch, /*use_jit=*/false,
+                                 "evaluated unopt IR (interpreter)", response));
+    if (request.use_jit()) {
+      *stage = "Evaluating unoptimized IR with the JIT";
+      XLS_RETURN_IF_ERROR(Evaluate(package.get(), args_batch,
+                                   /*use_jit=*/true,
+                                   "evaluated unopt IR (JIT)", response));
+    }
+  }
+  if (!request.optimize_ir()) {
+    return absl::OkStatus();
+  }
+
+  *stage = "Optimizing IR";
+  PassResults pass_results;
+  XLS_RETURN_IF_ERROR(
+      CreateStandardPassPipeline()
+          ->Run(package.get(), PassOptions(), &pass_results)
+          .status());
+  response->set_opt_ir_text(package->DumpIr());
+  // Evaluate a package parsed from the optimized IR text as the subprocess
+  // stages do; this also exercises the printing and parsing of the IR.
+  *stage = "Parsing optimized IR";
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> opt_package,
+                       Parser::ParsePackage(response->opt_ir_text()));
+
+  if (evaluate) {
+    *stage = request.use_jit()
+                 ? "Evaluating optimized IR with the JIT"
+                 : "Evaluating optimized IR with the interpreter";
+    XLS_RETURN_IF_ERROR(Evaluate(opt_package.get(), args_batch,
+                                 request.use_jit(),
+                                 request.use_jit()
+                                     ? "evaluated opt IR (JIT)"
+                                     : "evaluated opt IR (interpreter)",
+                                 response));
+  }
+  if (!request.codegen()) {
+    return absl::OkStatus();
+  }
+
+  *stage = "Generating Verilog";
+  XLS_ASSIGN_OR_RETURN(
+      CodegenArgs codegen_args,
+      ParseCodegenArgs(std::vector<std::string>(request.codegen_args().begin(),
+                                                request.codegen_args().end())));
+  XLS_ASSIGN_OR_RETURN(verilog::ModuleGeneratorResult codegen_result,
+                       Codegen(opt_package.get(), codegen_args));
+  response->set_verilog_text(codegen_result.verilog_text);
+  std::string signature_text;
+  XLS_RET_CHECK(google::protobuf::TextFormat::PrintToString(
+      codegen_result.signature.proto(), &signature_text));
+  response->set_signature_text(signature_text);
+
+  if (request.simulate()) {
+    XLS_RET_CHECK(evaluate) << "Simulation requires arguments";
+    *stage = "Simulating Verilog";
+    XLS_RETURN_IF_ERROR(Simulate(codegen_result, args_batch,
+                                 request.simulator(), response));
+  }
+  return absl::OkStatus();
+}
+
+// Reads exactly 'size' bytes. Returns a NotFound error if 'fd' is at end of
+// file before the first byte.
+absl::Status ReadBytes(int fd, int64 size, char* buffer) {
+  int64 bytes_read = 0;
+  while (bytes_read < size) {
+    ssize_t result = read(fd, buffer + bytes_read, size - bytes_read);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result < 0) {
+      return absl::InternalError(
+          absl::StrFormat("Failed to read sample frame: errno %d", errno));
+    }
+    if (result == 0) {
+      if (bytes_read == 0) {
+        return absl::NotFoundError("End of file");
+      }
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Truncated sample frame: read %d of %d bytes",
+                          bytes_read, size));
+    }
+    bytes_read += result;
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::Status WriteFrame(int fd, absl::string_view bytes) {
+  XLS_RET_CHECK_LE(bytes.size(), std::numeric_limits<uint32>::max());
+  std::string frame(4, '\0');
+  for (int64 i = 0; i < 4; ++i) {
+    frame[i] = static_cast<char>((bytes.size() >> (8 * i)) & 0xff);
+  }
+  frame.append(bytes.data(), bytes.size());
+  int64 bytes_written = 0;
+  while (bytes_written < frame.size()) {
+    ssize_t result =
+        write(fd, frame.data() + bytes_written, frame.size() - bytes_written);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result < 0) {
+      return absl::InternalError(
+          absl::StrFormat("Failed to write sample frame: errno %d", errno));
+    }
+    bytes_written += result;
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::string> ReadFrame(int fd) {
+  char header[4];
+  XLS_RETURN_IF_ERROR(ReadBytes(fd, 4, header));
+  uint32 size = 0;
+  for (int64 i = 0; i < 4; ++i) {
+    size |= static_cast<uint32>(static_cast<uint8>(header[i])) << (8 * i);
+  }
+  std::string bytes(size, '\0');
+  absl::Status status = ReadBytes(fd, size, bytes.data());
+  if (absl::IsNotFound(status)) {
+    return absl::InvalidArgumentError("Truncated sample frame: missing body");
+  }
+  XLS_RETURN_IF_ERROR(status);
+  return bytes;
+}
+
+fuzzer::SampleResponseProto RunSample(
+    const fuzzer::SampleRequestProto& request) {
+  fuzzer::SampleResponseProto response;
+  std::string stage;
+  absl::Status status = RunStages(request, &stage, &response);
+  if (!status.ok()) {
+    response.set_error(absl::StrFormat("%s failed: %s", stage,
+                                       status.ToString()));
+  }
+  return response;
+}
+
+absl::Status ServeSamples(int in_fd, int out_fd) {
+  while (true) {
+    absl::StatusOr<std::string> frame = ReadFrame(in_fd);
+    if (absl::IsNotFound(frame.status())) {
+      return absl::OkStatus();
+    }
+    XLS_RETURN_IF_ERROR(frame.status());
+    fuzzer::SampleRequestProto request;
+    XLS_RET_CHECK(request.ParseFromString(frame.value()))
+        << "Invalid sample request";
+    XLS_RETURN_IF_ERROR(
+        WriteFrame(out_fd, RunSample(request).SerializeAsString()));
+  }
+}
+
+}  // namespace xls
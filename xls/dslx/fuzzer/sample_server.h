@@ -0,0 +1,49 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_DSLX_FUZZER_SAMPLE_SERVER_H_
+#define XLS_DSLX_FUZZER_SAMPLE_SERVER_H_
+
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "xls/dslx/fuzzer/sample_server.pb.h"
+
+namespace xls {
+
+// Runs the IR stages of a fuzzer sample in-process: evaluation of the
+// unoptimized IR with the interpreter (and the JIT), optimization, evaluation
+// of the optimized IR, code generation and simulation of the generated
+// Verilog. The stages and the names of the results match those of
+// SampleRunner in sample_runner.py which otherwise runs each stage as a
+// separate subprocess. If a stage fails the response holds the error and the
+// output of the earlier stages.
+fuzzer::SampleResponseProto RunSample(
+    const fuzzer::SampleRequestProto& request);
+
+// Serves samples read from 'in_fd' until end of file. Each request and response
+// is a serialized proto preceded by its size as a four-byte little-endian
+// integer. Returns an error if the framing is broken.
+absl::Status ServeSamples(int in_fd, int out_fd);
+
+// Writes and reads one size-prefixed message of the protocol of ServeSamples.
+// ReadFrame returns a NotFound error if 'fd' is at end of file.
+absl::Status WriteFrame(int fd, absl::string_view bytes);
+absl::StatusOr<std::string> ReadFrame(int fd);
+
+}  // namespace xls
+
+#endif  // XLS_DSLX_FUZZER_SAMPLE_SERVER_H_
@@ -0,0 +1,125 @@
+# Lint as: python3
+#
+# Copyright 2020 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Client of sample_server_main which runs the IR stages of fuzz samples."""
+
+import struct
+import subprocess
+import tempfile
+from typing import Optional
+
+from absl import logging
+
+from xls.common import runfiles
+from xls.common.xls_error import XlsError
+from xls.dslx.fuzzer import sample_server_pb2
+
+SAMPLE_SERVER_MAIN_PATH = runfiles.get_path(
+    'xls/dslx/fuzzer/sample_server_main')
+
+# Format of the size which precedes each message exchanged with the server.
+_SIZE_FORMAT = '<I'
+
+
+class SampleServerError(XlsError):
+  """Raised if the sample server process dies while running a sample.
+
+  The server is restarted for the next sample. The stderr of the server while
+  running the sample is held in 'stderr'.
+  """
+
+  def __init__(self, message: str, stderr: str):
+    super().__init__(message)
+    self.stderr = stderr
+
+
+class SampleServer:
+  """A long-lived sample_server_main process.
+
+  Running the IR stages of a sample in the server avoids starting a process for
+  each stage. A server runs one sample at a time; each fuzz worker owns one.
+  """
+
+  def __init__(self):
+    self._process: Optional[subprocess.Popen] = None
+    # The stderr of the process, which spans all the samples it runs.
+    self._stderr = tempfile.TemporaryFile(mode='w+')
+
+  def __enter__(self) -> 'SampleServer':
+    return self
+
+  def __exit__(self, *args):
+    self.close()
+
+  def _start(self):
+    logging.vlog(1, 'Starting sample server: %s', SAMPLE_SERVER_MAIN_PATH)
+    self._stderr.seek(0)
+    self._stderr.truncate()
+    self._process = subprocess.Popen(
+        (SAMPLE_SERVER_MAIN_PATH, '--logtostderr'),
+        stdin=subprocess.PIPE,
+        stdout=subprocess.PIPE,
+        stderr=self._stderr)
+
+  def _read(self, size: int) -> bytes:
+    data = self._process.stdout.read(size)
+    if len(data) != size:
+      raise EOFError('Sample server closed its output')
+    return data
+
+  def run(
+      self, request: sample_server_pb2.SampleRequestProto
+  ) -> sample_server_pb2.SampleResponseProto:
+    """Runs the sample of the request in the server and returns the response.
+
+    Args:
+      request: The sample to run.
+
+    Returns:
+      The response of the server. A failure of a stage is reported in the error
+      field of the response.
+
+    Raises:
+      SampleServerError: If the server dies while running the sample.
+    """
+    if self._process is None or self._process.poll() is not None:
+      self._start()
+    self._stderr.seek(0, 2)
+    stderr_offset = self._stderr.tell()
+    data = request.SerializeToString()
+    try:
+      self._process.stdin.write(struct.pack(_SIZE_FORMAT, len(data)) + data)
+      self._process.stdin.flush()
+      size, = struct.unpack(_SIZE_FORMAT,
+                            self._read(struct.calcsize(_SIZE_FORMAT)))
+      response = sample_server_pb2.SampleResponseProto.FromString(
+          self._read(size))
+    except (BrokenPipeError, EOFError):
+      returncode = self._process.wait()
+      self._process = None
+      self._stderr.seek(stderr_offset)
+      stderr = self._stderr.read()
+      raise SampleServerError(
+          f'Sample server exited with code {returncode} while running the '
+          f'sample:\n{stderr}', stderr)
+    return response
+
+  def close(self):
+    """Stops the server process."""
+    if self._process is not None:
+      self._process.stdin.close()
+      self._process.wait()
+      self._process = None
@@ -0,0 +1,45 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+
+#include "xls/common/init_xls.h"
+#include "xls/common/logging/logging.h"
+#include "xls/dslx/fuzzer/sample_server.h"
+
+const char kUsage[] = R"(
+Runs the IR stages of fuzzer samples (evaluation, optimization, codegen and
+simulation) in a single long-lived process. Reads SampleRequestProtos from
+stdin and writes a SampleResponseProto to stdout for each, every message
+preceded by its size as a four-byte little-endian integer. Exits at the end of
+stdin. Used by run_fuzz_multiprocess to avoid starting a subprocess per stage
+of every sample:
+
+   sample_server_main < requests > responses
+)";
+
+int main(int argc, char** argv) {
+  std::vector<absl::string_view> positional_arguments =
+      xls::InitXls(kUsage, argc, argv);
+  XLS_QCHECK(positional_arguments.empty()) << "Unexpected arguments.";
+
+  // Responses are written to a duplicate of stdout, and stdout itself is
+  // redirected to stderr so any incidental output cannot corrupt the stream.
+  int out_fd = dup(STDOUT_FILENO);
+  XLS_QCHECK_GE(out_fd, 0);
+  XLS_QCHECK_GE(dup2(STDERR_FILENO, STDOUT_FILENO), 0);
+
+  XLS_QCHECK_OK(xls::ServeSamples(STDIN_FILENO, out_fd));
+  return EXIT_SUCCESS;
+}
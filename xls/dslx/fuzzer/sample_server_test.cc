@@ -0,0 +1,198 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/dslx/fuzzer/sample_server.h"
+
+#include <unistd.h>
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "xls/common/status/matchers.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::testing::IsEmpty;
+using ::testing::Not;
+
+constexpr char kIrText[] = R"(
+package sample
+
+fn main(x: bits[8], y: bits[8]) -> bits[8] {
+  add.1: bits[8] = add(x, y)
+  literal.2: bits[8] = literal(value=0)
+  ret or.3: bits[8] = or(add.1, literal.2)
+}
+)";
+
+fuzzer::SampleRequestProto MakeRequest() {
+  fuzzer::SampleRequestProto request;
+  request.set_ir_text(kIrText);
+  request.add_args("bits[8]:1; bits[8]:2");
+  request.add_args("bits[8]:0xff; bits[8]:0x3");
+  return request;
+}
+
+std::vector<std::string> ResultNames(
+    const fuzzer::SampleResponseProto& response) {
+  std::vector<std::string> names;
+  for (const fuzzer::SampleResultsProto& results : response.results()) {
+    names.push_back(results.name());
+  }
+  return names;
+}
+
+TEST(SampleServerTest, EvaluateUnoptimized) {
+  fuzzer::SampleResponseProto response = RunSample(MakeRequest());
+  EXPECT_FALSE(response.has_error()) << response.error();
+  ASSERT_EQ(response.results_size(), 1);
+  EXPECT_EQ(response.results(0).name(), "evaluated unopt IR (interpreter)");
+  EXPECT_THAT(response.results(0).values(),
+              ElementsAre("bits[8]:0x3", "bits[8]:0x2"));
+  EXPECT_FALSE(response.has_opt_ir_text());
+}
+
+TEST(SampleServerTest, OptimizeAndEvaluateWithJit) {
+  fuzzer::SampleRequestProto request = MakeRequest();
+  request.set_use_jit(true);
+  request.set_optimize_ir(true);
+  fuzzer::SampleResponseProto response = RunSample(request);
+  EXPECT_FALSE(response.has_error()) << response.error();
+  EXPECT_THAT(ResultNames(response),
+              ElementsAre("evaluated unopt IR (interpreter)",
+                          "evaluated unopt IR (JIT)", "evaluated opt IR (JIT)"));
+  for (const fuzzer::SampleResultsProto& results : response.results()) {
+    EXPECT_THAT(results.values(), ElementsAre("bits[8]:0x3", "bits[8]:0x2"));
+  }
+  // The or with zero is optimized away.
+  EXPECT_THAT(response.opt_ir_text(), HasSubstr("add("));
+  EXPECT_THAT(response.opt_ir_text(), Not(HasSubstr("or(")));
+}
+
+TEST(SampleServerTest, Codegen) {
+  fuzzer::SampleRequestProto request = MakeRequest();
+  request.set_optimize_ir(true);
+  request.set_codegen(true);
+  request.add_codegen_args("--nouse_system_verilog");
+  request.add_codegen_args("--generator=pipeline");
+  request.add_codegen_args("--pipeline_stages=2");
+  request.add_codegen_args("--delay_model=unit");
+  fuzzer::SampleResponseProto response = RunSample(request);
+  EXPECT_FALSE(response.has_error()) << response.error();
+  EXPECT_THAT(ResultNames(response),
+              ElementsAre("evaluated unopt IR (interpreter)",
+                          "evaluated opt IR (interpreter)"));
+  EXPECT_THAT(response.verilog_text(), HasSubstr("module main("));
+  EXPECT_THAT(response.verilog_text(), Not(HasSubstr("logic")));
+  EXPECT_THAT(response.signature_text(), HasSubstr("pipeline"));
+
+  request.clear_codegen_args();
+  request.add_codegen_args("--use_system_verilog");
+  request.add_codegen_args("--generator=combinational");
+  response = RunSample(request);
+  EXPECT_FALSE(response.has_error()) << response.error();
+  EXPECT_THAT(response.signature_text(), HasSubstr("combinational"));
+}
+
+TEST(SampleServerTest, Errors) {
+  fuzzer::SampleRequestProto request = MakeRequest();
+  request.set_ir_text("package bogus\n\nfn main(");
+  EXPECT_THAT(RunSample(request).error(), HasSubstr("Parsing IR failed"));
+
+  request = MakeRequest();
+  request.add_args("bits[8]:1");
+  fuzzer::SampleResponseProto response = RunSample(request);
+  EXPECT_THAT(response.error(),
+              HasSubstr("Evaluating unoptimized IR with the interpreter "
+                        "failed"));
+  EXPECT_EQ(response.results_size(), 0);
+
+  request = MakeRequest();
+  request.set_optimize_ir(true);
+  request.set_codegen(true);
+  request.add_codegen_args("--flop_inputs=false");
+  response = RunSample(request);
+  EXPECT_THAT(response.error(),
+              HasSubstr("Unsupported codegen argument: --flop_inputs=false"));
+  // The results and the optimized IR of the stages which ran are returned.
+  EXPECT_EQ(response.results_size(), 2);
+  EXPECT_FALSE(response.opt_ir_text().empty());
+
+  request.set_codegen_args(0, "--pipeline_stages=many");
+  EXPECT_THAT(RunSample(request).error(),
+              HasSubstr("Invalid codegen argument: --pipeline_stages=many"));
+}
+
+TEST(SampleServerTest, Frames) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  XLS_ASSERT_OK(WriteFrame(fds[1], "hello"));
+  XLS_ASSERT_OK(WriteFrame(fds[1], ""));
+  XLS_ASSERT_OK(WriteFrame(fds[1], "xxx"));
+  ASSERT_EQ(write(fds[1], "\x05\x00\x00\x00" "ab", 6), 6);
+  close(fds[1]);
+  EXPECT_THAT(ReadFrame(fds[0]), IsOkAndHolds("hello"));
+  EXPECT_THAT(ReadFrame(fds[0]), IsOkAndHolds(""));
+  EXPECT_THAT(ReadFrame(fds[0]), IsOkAndHolds("xxx"));
+  EXPECT_THAT(ReadFrame(fds[0]),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Truncated sample frame")));
+  EXPECT_THAT(ReadFrame(fds[0]), StatusIs(absl::StatusCode::kNotFound));
+  close(fds[0]);
+}
+
+TEST(SampleServerTest, ServeSamples) {
+  int request_fds[2];
+  int response_fds[2];
+  ASSERT_EQ(pipe(request_fds), 0);
+  ASSERT_EQ(pipe(response_fds), 0);
+  fuzzer::SampleRequestProto request = MakeRequest();
+  XLS_ASSERT_OK(WriteFrame(request_fds[1], request.SerializeAsString()));
+  request.set_ir_text("bogus");
+  XLS_ASSERT_OK(WriteFrame(request_fds[1], request.SerializeAsString()));
+  close(request_fds[1]);
+
+  XLS_ASSERT_OK(ServeSamples(request_fds[0], response_fds[1]));
+  close(request_fds[0]);
+  close(response_fds[1]);
+
+  std::vector<fuzzer::SampleResponseProto> responses;
+  while (true) {
+    absl::StatusOr<std::string> frame = ReadFrame(response_fds[0]);
+    if (!frame.ok()) {
+      EXPECT_THAT(frame, StatusIs(absl::StatusCode::kNotFound));
+      break;
+    }
+    fuzzer::SampleResponseProto response;
+    ASSERT_TRUE(response.ParseFromString(frame.value()));
+    responses.push_back(response);
+  }
+  close(response_fds[0]);
+  ASSERT_EQ(responses.size(), 2);
+  EXPECT_FALSE(responses[0].has_error());
+  EXPECT_THAT(responses[0].results(0).values(),
+              ElementsAre("bits[8]:0x3", "bits[8]:0x2"));
+  EXPECT_THAT(responses[1].error(), HasSubstr("Parsing IR failed"));
+  EXPECT_THAT(responses[1].results(), IsEmpty());
+}
+
+}  // namespace
+}  // namespace xls
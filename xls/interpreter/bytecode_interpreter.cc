@@ -0,0 +1,1146 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/interpreter/bytecode_interpreter.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/math_util.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/interpreter/flat_ir_interpreter.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/keyword_args.h"
+#include "xls/ir/node_iterator.h"
+#include "xls/ir/nodes.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+namespace {
+
+// Instruction opcodes. Unless noted otherwise, "dst", "a", "b" and "c" are
+// word register numbers and results are masked with "mask" to the width of the
+// result.
+enum class Opcode : uint8 {
+  kMove,
+  kMoveImm,  // a: the value.
+  kAdd,
+  kSub,
+  kNeg,
+  kNot,
+  kAnd,
+  kOr,
+  kXor,
+  kUMul,
+  kSMul,  // width: bit count of a, c: bit count of b.
+  kShll,  // width: bit count of the result.
+  kShrl,
+  kShra,
+  kEq,
+  kNe,
+  kULt,
+  kULe,
+  kUGt,
+  kUGe,
+  kSLt,  // width: bit count of the operands.
+  kSLe,
+  kSGt,
+  kSGe,
+  kSignExt,     // width: bit count of a.
+  kShiftRight,  // b: the (immediate) shift amount.
+  kShiftOr,     // dst = dst << width | a.
+  kAndReduce,   // mask: mask of a.
+  kOrReduce,
+  kXorReduce,
+  kSelWord,        // a: selector, b: list of cases, c: default or -1.
+  kOneHotSelWord,  // a: selector, b: list of cases.
+
+  // Operations on the arena. Offsets in the arena are given as plain numbers
+  // and "width" is a bit count for words or a byte count otherwise.
+  kLoadWord,          // dst = load(a).
+  kStoreWord,         // store(dst, a).
+  kCopy,              // memcpy(dst, a, width).
+  kLoadWordIndexed,   // dst = load(a + min(b, c) * stride).
+  kCopyIndexed,       // memcpy(dst, a + min(b, c) * width, width).
+  kStoreWordIndexed,  // if b < c: store(dst + b * stride, a).
+  kCopyToIndexed,     // if b < c: memcpy(dst + b * width, a, width).
+  kSelMem,            // a: selector, b: list of case offsets, c: default.
+  kOneHotSelMem,      // a: selector, b: list of case offsets.
+
+  // Calls of other interpreters ("a" is the callee number).
+  kInvoke,      // b: list of argument offsets.
+  kMap,         // b: input offset, c: element count, mask: output size.
+  kCountedFor,  // b: list of {initial value, induction variable, induction
+                // variable width, trip count, stride, invariants...} offsets.
+
+  // Evaluation by IrInterpreter. a: whether the result is a word, b: list of
+  // operand locations as pairs of {is word, index}.
+  kFallback,
+};
+
+const char* OpcodeToString(Opcode op) {
+  switch (op) {
+    case Opcode::kMove:
+      return "move";
+    case Opcode::kMoveImm:
+      return "move_imm";
+    case Opcode::kAdd:
+      return "add";
+    case Opcode::kSub:
+      return "sub";
+    case Opcode::kNeg:
+      return "neg";
+    case Opcode::kNot:
+      return "not";
+    case Opcode::kAnd:
+      return "and";
+    case Opcode::kOr:
+      return "or";
+    case Opcode::kXor:
+      return "xor";
+    case Opcode::kUMul:
+      return "umul";
+    case Opcode::kSMul:
+      return "smul";
+    case Opcode::kShll:
+      return "shll";
+    case Opcode::kShrl:
+      return "shrl";
+    case Opcode::kShra:
+      return "shra";
+    case Opcode::kEq:
+      return "eq";
+    case Opcode::kNe:
+      return "ne";
+    case Opcode::kULt:
+      return "ult";
+    case Opcode::kULe:
+      return "ule";
+    case Opcode::kUGt:
+      return "ugt";
+    case Opcode::kUGe:
+      return "uge";
+    case Opcode::kSLt:
+      return "slt";
+    case Opcode::kSLe:
+      return "sle";
+    case Opcode::kSGt:
+      return "sgt";
+    case Opcode::kSGe:
+      return "sge";
+    case Opcode::kSignExt:
+      return "sign_ext";
+    case Opcode::kShiftRight:
+      return "shift_right";
+    case Opcode::kShiftOr:
+      return "shift_or";
+    case Opcode::kAndReduce:
+      return "and_reduce";
+    case Opcode::kOrReduce:
+      return "or_reduce";
+    case Opcode::kXorReduce:
+      return "xor_reduce";
+    case Opcode::kSelWord:
+      return "sel_word";
+    case Opcode::kOneHotSelWord:
+      return "one_hot_sel_word";
+    case Opcode::kLoadWord:
+      return "load_word";
+    case Opcode::kStoreWord:
+      return "store_word";
+    case Opcode::kCopy:
+      return "copy";
+    case Opcode::kLoadWordIndexed:
+      return "load_word_indexed";
+    case Opcode::kCopyIndexed:
+      return "copy_indexed";
+    case Opcode::kStoreWordIndexed:
+      return "store_word_indexed";
+    case Opcode::kCopyToIndexed:
+      return "copy_to_indexed";
+    case Opcode::kSelMem:
+      return "sel_mem";
+    case Opcode::kOneHotSelMem:
+      return "one_hot_sel_mem";
+    case Opcode::kInvoke:
+      return "invoke";
+    case Opcode::kMap:
+      return "map";
+    case Opcode::kCountedFor:
+      return "counted_for";
+    case Opcode::kFallback:
+      return "fallback";
+  }
+  return "<invalid>";
+}
+
+int64 BitsByteCount(int64 bit_count) {
+  return CeilOfRatio(bit_count, int64{8});
+}
+
+uint64 WordMask(int64 bit_count) {
+  return bit_count >= 64 ? ~uint64{0} : (uint64{1} << bit_count) - 1;
+}
+
+// Loads or stores a bits value of at most 64 bits in the flat layout. Assumes
+// a little-endian host, as does FlatIrInterpreter.
+uint64 LoadWord(const uint8* buffer, int64 bit_count) {
+  uint64 word = 0;
+  std::memcpy(&word, buffer, BitsByteCount(bit_count));
+  return word;
+}
+
+void StoreWord(uint64 word, int64 bit_count, uint8* buffer) {
+  std::memcpy(buffer, &word, BitsByteCount(bit_count));
+}
+
+int64 SignExtendWord(uint64 word, int64 bit_count) {
+  if (bit_count == 0) {
+    return 0;
+  }
+  int64 shift = 64 - bit_count;
+  return static_cast<int64>(word << shift) >> shift;
+}
+
+bool IsWordType(Type* type) {
+  return type->IsBits() && type->AsBitsOrDie()->bit_count() <= 64;
+}
+
+// Returns true if the node and all its operands are held in word registers.
+bool AllWords(Node* node) {
+  return IsWordType(node->GetType()) &&
+         std::all_of(node->operands().begin(), node->operands().end(),
+                     [](Node* n) { return IsWordType(n->GetType()); });
+}
+
+}  // namespace
+
+// Where a node's value lives: a word register, or an offset in the arena.
+struct BytecodeInterpreter::Location {
+  bool word;
+  int64 index;
+  // Bit count for words, byte count for values in the arena.
+  int64 size;
+};
+
+struct BytecodeInterpreter::Instruction {
+  Opcode op;
+  int64 dst;
+  int64 a;
+  int64 b;
+  int64 c;
+  int64 width;
+  uint64 mask;
+  // The node this instruction (partially) implements.
+  Node* node;
+};
+
+// Lowers a function to a program. Every node is assigned a location in
+// topological order, then has instructions emitted to compute it from its
+// operands' locations.
+class BytecodeInterpreter::Compiler {
+ public:
+  explicit Compiler(BytecodeInterpreter* interpreter)
+      : interpreter_(interpreter), function_(interpreter->function_) {}
+
+  absl::Status Compile();
+
+ private:
+  absl::Status CompileNode(Node* node);
+
+  // Emits the node as a word operation; returns false if there's no
+  // specialized instruction for it.
+  bool CompileWordNode(Node* node);
+  absl::Status CompileMemoryNode(Node* node);
+  absl::Status CompileCall(Node* node);
+  void CompileFallback(Node* node);
+
+  Location Allocate(Type* type) {
+    if (IsWordType(type)) {
+      return Location{true, register_count_++, type->AsBitsOrDie()->bit_count()};
+    }
+    int64 size = FlatIrInterpreter::GetTypeByteSize(type);
+    Location location{false, arena_size_, size};
+    arena_size_ += size;
+    return location;
+  }
+
+  int64 Reg(Node* node) const {
+    const Location& location = locations_.at(node);
+    XLS_CHECK(location.word) << node->ToString();
+    return location.index;
+  }
+
+  // Returns the arena offset of the node's value, spilling it from its
+  // register on first use if it lives in one.
+  int64 Offset(Node* node) {
+    const Location& location = locations_.at(node);
+    if (!location.word) {
+      return location.index;
+    }
+    auto it = spills_.find(node);
+    if (it != spills_.end()) {
+      return it->second;
+    }
+    int64 offset = arena_size_;
+    arena_size_ += BitsByteCount(location.size);
+    Emit(Opcode::kStoreWord, node, offset, location.index, 0, 0,
+         location.size);
+    spills_[node] = offset;
+    return offset;
+  }
+
+  int64 AddList(std::vector<int64> list) {
+    interpreter_->operand_lists_.push_back(std::move(list));
+    return interpreter_->operand_lists_.size() - 1;
+  }
+
+  void Emit(Opcode op, Node* node, int64 dst, int64 a = 0, int64 b = 0,
+            int64 c = 0, int64 width = 0, uint64 mask = 0) {
+    interpreter_->program_.push_back(
+        Instruction{op, dst, a, b, c, width, mask, node});
+  }
+
+  // Returns the index of the interpreter for the given callee, creating it if
+  // needed.
+  absl::StatusOr<int64> GetCallee(Function* callee);
+
+  // Whether the given array_update can modify its array operand in place.
+  bool CanUpdateInPlace(Node* update) const;
+  // Whether the node's value refers to its operand's storage in the arena.
+  bool IsMemoryAlias(Node* node) const {
+    return (node->Is<TupleIndex>() || node->op() == Op::kIdentity) &&
+           !locations_.at(node).word;
+  }
+
+  BytecodeInterpreter* interpreter_;
+  Function* function_;
+  absl::flat_hash_map<Node*, Location> locations_;
+  absl::flat_hash_map<Node*, int64> spills_;
+  absl::flat_hash_set<Node*> in_place_updates_;
+  absl::flat_hash_map<Function*, int64> callee_indices_;
+  int64 register_count_ = 0;
+  int64 arena_size_ = 0;
+};
+
+absl::Status BytecodeInterpreter::Compiler::Compile() {
+  std::vector<Literal*> literals;
+  for (Node* node : TopoSort(function_)) {
+    if (node->Is<Literal>()) {
+      locations_[node] = Allocate(node->GetType());
+      literals.push_back(node->As<Literal>());
+      continue;
+    }
+    if (node->Is<Param>()) {
+      locations_[node] = Allocate(node->GetType());
+      continue;
+    }
+    XLS_RETURN_IF_ERROR(CompileNode(node));
+  }
+
+  interpreter_->registers_.resize(register_count_);
+  interpreter_->arena_.resize(arena_size_);
+  for (Literal* literal : literals) {
+    const Location& location = locations_.at(literal);
+    if (location.word) {
+      interpreter_->registers_[location.index] =
+          literal->value().bits().ToUint64().value();
+    } else {
+      FlatIrInterpreter::BlitValueToBuffer(
+          literal->value(), literal->GetType(),
+          interpreter_->arena_.data() + location.index);
+    }
+  }
+  for (Param* param : function_->params()) {
+    interpreter_->param_locations_.push_back(locations_.at(param));
+  }
+  interpreter_->return_location_ =
+      absl::make_unique<Location>(locations_.at(function_->return_value()));
+  return absl::OkStatus();
+}
+
+bool BytecodeInterpreter::Compiler::CanUpdateInPlace(Node* update) const {
+  // As in FlatIrInterpreter: no-one else may observe the operand afterwards,
+  // so it mustn't be a literal (which persist across runs), the return value or
+  // shared with another node, and all its other users must already have been
+  // compiled (i.e., be earlier in the program) and have copied what they need.
+  Node* array = update->operand(0);
+  if (array->Is<Literal>() || array == function_->return_value() ||
+      IsMemoryAlias(array)) {
+    return false;
+  }
+  return std::all_of(
+      array->users().begin(), array->users().end(), [&](Node* user) {
+        return user == update ||
+               (locations_.contains(user) && !IsMemoryAlias(user) &&
+                !in_place_updates_.contains(user));
+      });
+}
+
+absl::Status BytecodeInterpreter::Compiler::CompileNode(Node* node) {
+  Type* type = node->GetType();
+  if (type->IsToken()) {
+    // Tokens carry no data.
+    locations_[node] = Location{false, arena_size_, 0};
+    return absl::OkStatus();
+  }
+  if (node->op() == Op::kIdentity) {
+    Location operand_location = locations_.at(node->operand(0));
+    locations_[node] = operand_location;
+    return absl::OkStatus();
+  }
+  if (node->Is<TupleIndex>()) {
+    TupleType* tuple_type = node->operand(0)->GetType()->AsTupleOrDie();
+    int64 offset = locations_.at(node->operand(0)).index;
+    for (int64 i = 0; i < node->As<TupleIndex>()->index(); ++i) {
+      offset += FlatIrInterpreter::GetTypeByteSize(tuple_type->element_type(i));
+    }
+    if (!IsWordType(type)) {
+      // Refer directly to the element within the tuple.
+      locations_[node] =
+          Location{false, offset, FlatIrInterpreter::GetTypeByteSize(type)};
+      return absl::OkStatus();
+    }
+    locations_[node] = Allocate(type);
+    Emit(Opcode::kLoadWord, node, Reg(node), offset, 0, 0,
+         type->AsBitsOrDie()->bit_count());
+    return absl::OkStatus();
+  }
+  if (node->Is<ArrayUpdate>() && IsWordType(node->operand(1)->GetType()) &&
+      CanUpdateInPlace(node)) {
+    Location array_location = locations_.at(node->operand(0));
+    locations_[node] = array_location;
+    in_place_updates_.insert(node);
+  } else {
+    locations_[node] = Allocate(type);
+  }
+
+  if (node->Is<Invoke>() || node->Is<Map>() || node->Is<CountedFor>()) {
+    return CompileCall(node);
+  }
+  if (IsWordType(type) && CompileWordNode(node)) {
+    return absl::OkStatus();
+  }
+  return CompileMemoryNode(node);
+}
+
+bool BytecodeInterpreter::Compiler::CompileWordNode(Node* node) {
+  const int64 dst = Reg(node);
+  const int64 width = node->BitCountOrDie();
+  const uint64 mask = WordMask(width);
+  auto binary = [&](Opcode op, int64 op_width = 0) {
+    Emit(op, node, dst, Reg(node->operand(0)), Reg(node->operand(1)), 0,
+         op_width, mask);
+    return true;
+  };
+  auto unary = [&](Opcode op, int64 op_width = 0) {
+    Emit(op, node, dst, Reg(node->operand(0)), 0, 0, op_width, mask);
+    return true;
+  };
+  auto nary = [&](Opcode op) {
+    if (node->operand_count() == 1) {
+      unary(Opcode::kMove);
+    } else {
+      binary(op);
+    }
+    for (int64 i = 2; i < node->operand_count(); ++i) {
+      Emit(op, node, dst, dst, Reg(node->operand(i)), 0, 0, mask);
+    }
+  };
+
+  switch (node->op()) {
+    case Op::kSel: {
+      if (!IsWordType(node->operand(0)->GetType())) {
+        return false;
+      }
+      Select* sel = node->As<Select>();
+      std::vector<int64> cases;
+      for (Node* c : sel->cases()) {
+        cases.push_back(Reg(c));
+      }
+      Emit(Opcode::kSelWord, node, dst, Reg(sel->selector()),
+           AddList(std::move(cases)),
+           sel->default_value().has_value() ? Reg(*sel->default_value()) : -1);
+      return true;
+    }
+    case Op::kOneHotSel: {
+      if (!IsWordType(node->operand(0)->GetType())) {
+        return false;
+      }
+      OneHotSelect* sel = node->As<OneHotSelect>();
+      std::vector<int64> cases;
+      for (Node* c : sel->cases()) {
+        cases.push_back(Reg(c));
+      }
+      Emit(Opcode::kOneHotSelWord, node, dst, Reg(sel->selector()),
+           AddList(std::move(cases)));
+      return true;
+    }
+    default:
+      break;
+  }
+
+  if (!AllWords(node)) {
+    return false;
+  }
+  switch (node->op()) {
+    case Op::kAdd:
+      return binary(Opcode::kAdd);
+    case Op::kSub:
+      return binary(Opcode::kSub);
+    case Op::kNeg:
+      return unary(Opcode::kNeg);
+    case Op::kNot:
+      return unary(Opcode::kNot);
+    case Op::kAnd:
+      nary(Opcode::kAnd);
+      return true;
+    case Op::kOr:
+      nary(Opcode::kOr);
+      return true;
+    case Op::kXor:
+      nary(Opcode::kXor);
+      return true;
+    case Op::kNand:
+      nary(Opcode::kAnd);
+      Emit(Opcode::kNot, node, dst, dst, 0, 0, 0, mask);
+      return true;
+    case Op::kNor:
+      nary(Opcode::kOr);
+      Emit(Opcode::kNot, node, dst, dst, 0, 0, 0, mask);
+      return true;
+    case Op::kUMul:
+      // The low bits of the product only depend on the low bits of the
+      // operands, so wrapping 64-bit arithmetic gives the (truncated) result.
+      return binary(Opcode::kUMul);
+    case Op::kSMul:
+      Emit(Opcode::kSMul, node, dst, Reg(node->operand(0)),
+           Reg(node->operand(1)), node->operand(1)->BitCountOrDie(),
+           node->operand(0)->BitCountOrDie(), mask);
+      return true;
+    case Op::kShll:
+      return binary(Opcode::kShll, width);
+    case Op::kShrl:
+      return binary(Opcode::kShrl, width);
+    case Op::kShra:
+      return binary(Opcode::kShra, width);
+    case Op::kEq:
+      return binary(Opcode::kEq);
+    case Op::kNe:
+      return binary(Opcode::kNe);
+    case Op::kULt:
+      return binary(Opcode::kULt);
+    case Op::kULe:
+      return binary(Opcode::kULe);
+    case Op::kUGt:
+      return binary(Opcode::kUGt);
+    case Op::kUGe:
+      return binary(Opcode::kUGe);
+    case Op::kSLt:
+      return binary(Opcode::kSLt, node->operand(0)->BitCountOrDie());
+    case Op::kSLe:
+      return binary(Opcode::kSLe, node->operand(0)->BitCountOrDie());
+    case Op::kSGt:
+      return binary(Opcode::kSGt, node->operand(0)->BitCountOrDie());
+    case Op::kSGe:
+      return binary(Opcode::kSGe, node->operand(0)->BitCountOrDie());
+    case Op::kZeroExt:
+      return unary(Opcode::kMove);
+    case Op::kSignExt:
+      return unary(Opcode::kSignExt, node->operand(0)->BitCountOrDie());
+    case Op::kBitSlice: {
+      int64 start = node->As<BitSlice>()->start();
+      if (start >= 64) {
+        Emit(Opcode::kMoveImm, node, dst, 0);
+      } else {
+        Emit(Opcode::kShiftRight, node, dst, Reg(node->operand(0)), start, 0,
+             0, mask);
+      }
+      return true;
+    }
+    case Op::kConcat: {
+      // Operand zero is the most significant.
+      unary(Opcode::kMove);
+      for (int64 i = 1; i < node->operand_count(); ++i) {
+        Emit(Opcode::kShiftOr, node, dst, Reg(node->operand(i)), 0, 0,
+             node->operand(i)->BitCountOrDie());
+      }
+      return true;
+    }
+    case Op::kAndReduce:
+      Emit(Opcode::kAndReduce, node, dst, Reg(node->operand(0)), 0, 0, 0,
+           WordMask(node->operand(0)->BitCountOrDie()));
+      return true;
+    case Op::kOrReduce:
+      return unary(Opcode::kOrReduce);
+    case Op::kXorReduce:
+      return unary(Opcode::kXorReduce);
+    default:
+      return false;
+  }
+}
+
+absl::Status BytecodeInterpreter::Compiler::CompileMemoryNode(Node* node) {
+  const Location& location = locations_.at(node);
+  // Emits code to store the operand at the given offset.
+  auto store_operand = [&](Node* operand, int64 offset) {
+    const Location& operand_location = locations_.at(operand);
+    if (operand_location.word) {
+      Emit(Opcode::kStoreWord, node, offset, operand_location.index, 0, 0,
+           operand_location.size);
+    } else if (operand_location.size > 0) {
+      Emit(Opcode::kCopy, node, offset, operand_location.index, 0, 0,
+           operand_location.size);
+    }
+  };
+
+  switch (node->op()) {
+    case Op::kTuple:
+    case Op::kArray:
+    case Op::kArrayConcat: {
+      if (location.word) {
+        break;
+      }
+      int64 offset = location.index;
+      for (Node* operand : node->operands()) {
+        store_operand(operand, offset);
+        offset += FlatIrInterpreter::GetTypeByteSize(operand->GetType());
+      }
+      return absl::OkStatus();
+    }
+    case Op::kSel: {
+      if (location.word || !IsWordType(node->operand(0)->GetType())) {
+        break;
+      }
+      Select* sel = node->As<Select>();
+      std::vector<int64> cases;
+      for (Node* c : sel->cases()) {
+        cases.push_back(Offset(c));
+      }
+      int64 default_offset = sel->default_value().has_value()
+                                 ? Offset(*sel->default_value())
+                                 : -1;
+      Emit(Opcode::kSelMem, node, location.index, Reg(sel->selector()),
+           AddList(std::move(cases)), default_offset, location.size);
+      return absl::OkStatus();
+    }
+    case Op::kOneHotSel: {
+      if (location.word || !IsWordType(node->operand(0)->GetType())) {
+        break;
+      }
+      OneHotSelect* sel = node->As<OneHotSelect>();
+      std::vector<int64> cases;
+      for (Node* c : sel->cases()) {
+        cases.push_back(Offset(c));
+      }
+      Emit(Opcode::kOneHotSelMem, node, location.index, Reg(sel->selector()),
+           AddList(std::move(cases)), 0, location.size);
+      return absl::OkStatus();
+    }
+    case Op::kArrayIndex: {
+      if (!IsWordType(node->operand(1)->GetType())) {
+        break;
+      }
+      // Out-of-bounds accesses are clamped to the highest index, as in
+      // IrInterpreter.
+      ArrayType* array_type = node->operand(0)->GetType()->AsArrayOrDie();
+      int64 array = locations_.at(node->operand(0)).index;
+      int64 index = Reg(node->operand(1));
+      if (location.word) {
+        Emit(Opcode::kLoadWordIndexed, node, location.index, array, index,
+             array_type->size() - 1, location.size);
+      } else {
+        Emit(Opcode::kCopyIndexed, node, location.index, array, index,
+             array_type->size() - 1, location.size);
+      }
+      return absl::OkStatus();
+    }
+    case Op::kArrayUpdate: {
+      if (!IsWordType(node->operand(1)->GetType())) {
+        break;
+      }
+      if (!in_place_updates_.contains(node)) {
+        store_operand(node->operand(0), location.index);
+      }
+      // Out-of-bounds updates have no effect.
+      ArrayType* array_type = node->GetType()->AsArrayOrDie();
+      const Location& value = locations_.at(node->operand(2));
+      int64 index = Reg(node->operand(1));
+      if (value.word) {
+        Emit(Opcode::kStoreWordIndexed, node, location.index, value.index,
+             index, array_type->size(), value.size);
+      } else {
+        Emit(Opcode::kCopyToIndexed, node, location.index, value.index, index,
+             array_type->size(), value.size);
+      }
+      return absl::OkStatus();
+    }
+    default:
+      break;
+  }
+  CompileFallback(node);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<int64> BytecodeInterpreter::Compiler::GetCallee(
+    Function* callee) {
+  auto it = callee_indices_.find(callee);
+  if (it != callee_indices_.end()) {
+    return it->second;
+  }
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<BytecodeInterpreter> interpreter,
+                       BytecodeInterpreter::Create(callee));
+  interpreter_->callees_.push_back(std::move(interpreter));
+  int64 index = interpreter_->callees_.size() - 1;
+  callee_indices_[callee] = index;
+  return index;
+}
+
+absl::Status BytecodeInterpreter::Compiler::CompileCall(Node* node) {
+  const Location location = locations_.at(node);
+  // Callees write their results to the arena, so word results are passed
+  // through a temporary.
+  int64 result_offset = location.index;
+  if (location.word) {
+    result_offset = arena_size_;
+    arena_size_ += BitsByteCount(location.size);
+  }
+
+  if (node->Is<Invoke>()) {
+    XLS_ASSIGN_OR_RETURN(int64 callee,
+                         GetCallee(node->As<Invoke>()->to_apply()));
+    std::vector<int64> args;
+    for (Node* operand : node->operands()) {
+      args.push_back(Offset(operand));
+    }
+    Emit(Opcode::kInvoke, node, result_offset, callee,
+         AddList(std::move(args)));
+  } else if (node->Is<Map>()) {
+    Map* map = node->As<Map>();
+    XLS_ASSIGN_OR_RETURN(int64 callee, GetCallee(map->to_apply()));
+    ArrayType* input_type = map->operand(0)->GetType()->AsArrayOrDie();
+    Emit(Opcode::kMap, node, result_offset, callee, Offset(map->operand(0)),
+         input_type->size(),
+         FlatIrInterpreter::GetTypeByteSize(input_type->element_type()),
+         FlatIrInterpreter::GetTypeByteSize(
+             map->GetType()->AsArrayOrDie()->element_type()));
+  } else {
+    CountedFor* counted_for = node->As<CountedFor>();
+    XLS_ASSIGN_OR_RETURN(int64 callee, GetCallee(counted_for->body()));
+    int64 iv_width = counted_for->body()->param(0)->BitCountOrDie();
+    int64 iv_offset = arena_size_;
+    arena_size_ += BitsByteCount(iv_width);
+    std::vector<int64> list = {Offset(counted_for->initial_value()),
+                               iv_offset,
+                               iv_width,
+                               counted_for->trip_count(),
+                               counted_for->stride()};
+    for (Node* invariant : counted_for->invariant_args()) {
+      list.push_back(Offset(invariant));
+    }
+    Emit(Opcode::kCountedFor, node, result_offset, callee,
+         AddList(std::move(list)), 0,
+         FlatIrInterpreter::GetTypeByteSize(node->GetType()));
+  }
+
+  if (location.word) {
+    Emit(Opcode::kLoadWord, node, location.index, result_offset, 0, 0,
+         location.size);
+  }
+  return absl::OkStatus();
+}
+
+void BytecodeInterpreter::Compiler::CompileFallback(Node* node) {
+  const Location& location = locations_.at(node);
+  std::vector<int64> operands;
+  for (Node* operand : node->operands()) {
+    const Location& operand_location = locations_.at(operand);
+    operands.push_back(operand_location.word);
+    operands.push_back(operand_location.index);
+  }
+  Emit(Opcode::kFallback, node, location.index, location.word,
+       AddList(std::move(operands)));
+}
+
+BytecodeInterpreter::BytecodeInterpreter(Function* function)
+    : function_(function) {}
+
+BytecodeInterpreter::~BytecodeInterpreter() = default;
+
+/* static */
+absl::StatusOr<std::unique_ptr<BytecodeInterpreter>>
+BytecodeInterpreter::Create(Function* function) {
+  auto interpreter = absl::WrapUnique(new BytecodeInterpreter(function));
+  Compiler compiler(interpreter.get());
+  XLS_RETURN_IF_ERROR(compiler.Compile());
+  XLS_VLOG(3) << "Bytecode for function " << function->name() << ":\n"
+              << interpreter->ToString();
+  return std::move(interpreter);
+}
+
+/* static */
+absl::StatusOr<Value> BytecodeInterpreter::Run(Function* function,
+                                               absl::Span<const Value> args) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<BytecodeInterpreter> interpreter,
+                       Create(function));
+  return interpreter->Run(args);
+}
+
+/* static */
+absl::StatusOr<Value> BytecodeInterpreter::RunKwargs(
+    Function* function, const absl::flat_hash_map<std::string, Value>& args) {
+  XLS_ASSIGN_OR_RETURN(std::vector<Value> positional_args,
+                       KeywordArgsToPositional(*function, args));
+  return Run(function, positional_args);
+}
+
+absl::StatusOr<Value> BytecodeInterpreter::Run(absl::Span<const Value> args) {
+  XLS_VLOG(3) << "Interpreting function " << function_->name();
+  if (args.size() != function_->params().size()) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Function %s wants %d arguments, got %d.", function_->name(),
+        function_->params().size(), args.size()));
+  }
+  for (int64 argno = 0; argno < args.size(); ++argno) {
+    Type* param_type = function_->param(argno)->GetType();
+    Type* value_type = function_->package()->GetTypeForValue(args[argno]);
+    if (value_type != param_type) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Got argument %s for parameter %d which is not of type %s",
+          args[argno].ToString(), argno, param_type->ToString()));
+    }
+    const Location& location = param_locations_[argno];
+    if (location.word) {
+      registers_[location.index] = args[argno].bits().ToUint64().value();
+    } else {
+      FlatIrInterpreter::BlitValueToBuffer(args[argno], param_type,
+                                           arena_.data() + location.index);
+    }
+  }
+  XLS_RETURN_IF_ERROR(Execute());
+  Value result =
+      return_location_->word
+          ? Value(UBits(registers_[return_location_->index],
+                        return_location_->size))
+          : FlatIrInterpreter::UnpackBuffer(
+                function_->return_value()->GetType(),
+                arena_.data() + return_location_->index);
+  XLS_VLOG(2) << "Result = " << result;
+  return result;
+}
+
+absl::Status BytecodeInterpreter::RunWithBuffers(
+    absl::Span<const uint8* const> args, uint8* result) {
+  XLS_RET_CHECK_EQ(args.size(), param_locations_.size());
+  for (int64 i = 0; i < args.size(); ++i) {
+    const Location& location = param_locations_[i];
+    if (location.word) {
+      registers_[location.index] = LoadWord(args[i], location.size);
+    } else {
+      std::memcpy(arena_.data() + location.index, args[i], location.size);
+    }
+  }
+  XLS_RETURN_IF_ERROR(Execute());
+  if (return_location_->word) {
+    StoreWord(registers_[return_location_->index], return_location_->size,
+              result);
+  } else {
+    std::memcpy(result, arena_.data() + return_location_->index,
+                return_location_->size);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status BytecodeInterpreter::Execute() {
+  uint64* r = registers_.data();
+  uint8* m = arena_.data();
+  for (const Instruction& inst : program_) {
+    switch (inst.op) {
+      case Opcode::kMove:
+        r[inst.dst] = r[inst.a];
+        break;
+      case Opcode::kMoveImm:
+        r[inst.dst] = inst.a;
+        break;
+      case Opcode::kAdd:
+        r[inst.dst] = (r[inst.a] + r[inst.b]) & inst.mask;
+        break;
+      case Opcode::kSub:
+        r[inst.dst] = (r[inst.a] - r[inst.b]) & inst.mask;
+        break;
+      case Opcode::kNeg:
+        r[inst.dst] = -r[inst.a] & inst.mask;
+        break;
+      case Opcode::kNot:
+        r[inst.dst] = ~r[inst.a] & inst.mask;
+        break;
+      case Opcode::kAnd:
+        r[inst.dst] = r[inst.a] & r[inst.b];
+        break;
+      case Opcode::kOr:
+        r[inst.dst] = r[inst.a] | r[inst.b];
+        break;
+      case Opcode::kXor:
+        r[inst.dst] = r[inst.a] ^ r[inst.b];
+        break;
+      case Opcode::kUMul:
+        r[inst.dst] = (r[inst.a] * r[inst.b]) & inst.mask;
+        break;
+      case Opcode::kSMul:
+        r[inst.dst] =
+            (static_cast<uint64>(SignExtendWord(r[inst.a], inst.width)) *
+             static_cast<uint64>(SignExtendWord(r[inst.b], inst.c))) &
+            inst.mask;
+        break;
+      case Opcode::kShll:
+        r[inst.dst] =
+            r[inst.b] >= inst.width ? 0 : (r[inst.a] << r[inst.b]) & inst.mask;
+        break;
+      case Opcode::kShrl:
+        r[inst.dst] = r[inst.b] >= inst.width ? 0 : r[inst.a] >> r[inst.b];
+        break;
+      case Opcode::kShra:
+        // Shifting a sign-extended value by 63 fills with the sign bit, so the
+        // amount needn't be clamped to the width.
+        r[inst.dst] = static_cast<uint64>(
+                          SignExtendWord(r[inst.a], inst.width) >>
+                          std::min<uint64>(r[inst.b], 63)) &
+                      inst.mask;
+        break;
+      case Opcode::kEq:
+        r[inst.dst] = r[inst.a] == r[inst.b];
+        break;
+      case Opcode::kNe:
+        r[inst.dst] = r[inst.a] != r[inst.b];
+        break;
+      case Opcode::kULt:
+        r[inst.dst] = r[inst.a] < r[inst.b];
+        break;
+      case Opcode::kULe:
+        r[inst.dst] = r[inst.a] <= r[inst.b];
+        break;
+      case Opcode::kUGt:
+        r[inst.dst] = r[inst.a] > r[inst.b];
+        break;
+      case Opcode::kUGe:
+        r[inst.dst] = r[inst.a] >= r[inst.b];
+        break;
+      case Opcode::kSLt:
+        r[inst.dst] = SignExtendWord(r[inst.a], inst.width) <
+                      SignExtendWord(r[inst.b], inst.width);
+        break;
+      case Opcode::kSLe:
+        r[inst.dst] = SignExtendWord(r[inst.a], inst.width) <=
+                      SignExtendWord(r[inst.b], inst.width);
+        break;
+      case Opcode::kSGt:
+        r[inst.dst] = SignExtendWord(r[inst.a], inst.width) >
+                      SignExtendWord(r[inst.b], inst.width);
+        break;
+      case Opcode::kSGe:
+        r[inst.dst] = SignExtendWord(r[inst.a], inst.width) >=
+                      SignExtendWord(r[inst.b], inst.width);
+        break;
+      case Opcode::kSignExt:
+        r[inst.dst] =
+            static_cast<uint64>(SignExtendWord(r[inst.a], inst.width)) &
+            inst.mask;
+        break;
+      case Opcode::kShiftRight:
+        r[inst.dst] = (r[inst.a] >> inst.b) & inst.mask;
+        break;
+      case Opcode::kShiftOr:
+        r[inst.dst] = (inst.width >= 64 ? 0 : r[inst.dst] << inst.width) |
+                      r[inst.a];
+        break;
+      case Opcode::kAndReduce:
+        r[inst.dst] = r[inst.a] == inst.mask;
+        break;
+      case Opcode::kOrReduce:
+        r[inst.dst] = r[inst.a] != 0;
+        break;
+      case Opcode::kXorReduce:
+        r[inst.dst] = __builtin_popcountll(r[inst.a]) & 1;
+        break;
+      case Opcode::kSelWord: {
+        const std::vector<int64>& cases = operand_lists_[inst.b];
+        uint64 selector = r[inst.a];
+        r[inst.dst] =
+            selector < cases.size() ? r[cases[selector]] : r[inst.c];
+        break;
+      }
+      case Opcode::kOneHotSelWord: {
+        const std::vector<int64>& cases = operand_lists_[inst.b];
+        uint64 selector = r[inst.a];
+        uint64 result = 0;
+        for (int64 i = 0; i < cases.size(); ++i) {
+          if ((selector >> i) & 1) {
+            result |= r[cases[i]];
+          }
+        }
+        r[inst.dst] = result;
+        break;
+      }
+      case Opcode::kLoadWord:
+        r[inst.dst] = LoadWord(m + inst.a, inst.width);
+        break;
+      case Opcode::kStoreWord:
+        StoreWord(r[inst.a], inst.width, m + inst.dst);
+        break;
+      case Opcode::kCopy:
+        std::memcpy(m + inst.dst, m + inst.a, inst.width);
+        break;
+      case Opcode::kLoadWordIndexed: {
+        uint64 index = std::min<uint64>(r[inst.b], inst.c);
+        r[inst.dst] = LoadWord(m + inst.a + index * BitsByteCount(inst.width),
+                               inst.width);
+        break;
+      }
+      case Opcode::kCopyIndexed: {
+        uint64 index = std::min<uint64>(r[inst.b], inst.c);
+        std::memcpy(m + inst.dst, m + inst.a + index * inst.width, inst.width);
+        break;
+      }
+      case Opcode::kStoreWordIndexed:
+        if (r[inst.b] < inst.c) {
+          StoreWord(r[inst.a], inst.width,
+                    m + inst.dst + r[inst.b] * BitsByteCount(inst.width));
+        }
+        break;
+      case Opcode::kCopyToIndexed:
+        if (r[inst.b] < inst.c) {
+          std::memcpy(m + inst.dst + r[inst.b] * inst.width, m + inst.a,
+                      inst.width);
+        }
+        break;
+      case Opcode::kSelMem: {
+        const std::vector<int64>& cases = operand_lists_[inst.b];
+        uint64 selector = r[inst.a];
+        int64 source = selector < cases.size() ? cases[selector] : inst.c;
+        XLS_RET_CHECK_GE(source, 0);
+        std::memcpy(m + inst.dst, m + source, inst.width);
+        break;
+      }
+      case Opcode::kOneHotSelMem: {
+        // Unused bits in the layout are zero, so the OR can be done bytewise
+        // across the entire value.
+        const std::vector<int64>& cases = operand_lists_[inst.b];
+        uint64 selector = r[inst.a];
+        uint8* result = m + inst.dst;
+        std::memset(result, 0, inst.width);
+        for (int64 i = 0; i < cases.size(); ++i) {
+          if ((selector >> i) & 1) {
+            const uint8* input = m + cases[i];
+            for (int64 j = 0; j < inst.width; ++j) {
+              result[j] |= input[j];
+            }
+          }
+        }
+        break;
+      }
+      case Opcode::kInvoke: {
+        absl::InlinedVector<const uint8*, 8> args;
+        for (int64 offset : operand_lists_[inst.b]) {
+          args.push_back(m + offset);
+        }
+        XLS_RETURN_IF_ERROR(
+            callees_[inst.a]->RunWithBuffers(args, m + inst.dst));
+        break;
+      }
+      case Opcode::kMap: {
+        BytecodeInterpreter* callee = callees_[inst.a].get();
+        for (int64 i = 0; i < inst.c; ++i) {
+          const uint8* args[] = {m + inst.b + i * inst.width};
+          XLS_RETURN_IF_ERROR(
+              callee->RunWithBuffers(args, m + inst.dst + i * inst.mask));
+        }
+        break;
+      }
+      case Opcode::kCountedFor: {
+        // The loop state lives in the result's storage, and is passed to the
+        // body and overwritten by its result on each iteration.
+        BytecodeInterpreter* callee = callees_[inst.a].get();
+        const std::vector<int64>& list = operand_lists_[inst.b];
+        uint8* state = m + inst.dst;
+        uint8* induction_variable = m + list[1];
+        int64 iv_width = std::min<int64>(list[2], 64);
+        std::memcpy(state, m + list[0], inst.width);
+        absl::InlinedVector<const uint8*, 8> args = {induction_variable,
+                                                     state};
+        for (int64 i = 5; i < list.size(); ++i) {
+          args.push_back(m + list[i]);
+        }
+        for (int64 i = 0, iv = 0; i < list[3]; ++i, iv += list[4]) {
+          StoreWord(iv & WordMask(iv_width), iv_width, induction_variable);
+          XLS_RETURN_IF_ERROR(callee->RunWithBuffers(args, state));
+        }
+        break;
+      }
+      case Opcode::kFallback: {
+        Node* node = inst.node;
+        const std::vector<int64>& operands = operand_lists_[inst.b];
+        std::vector<Value> operand_values;
+        operand_values.reserve(node->operand_count());
+        for (int64 i = 0; i < node->operand_count(); ++i) {
+          Type* type = node->operand(i)->GetType();
+          int64 index = operands[2 * i + 1];
+          operand_values.push_back(
+              operands[2 * i]
+                  ? Value(UBits(r[index], type->AsBitsOrDie()->bit_count()))
+                  : FlatIrInterpreter::UnpackBuffer(type, m + index));
+        }
+        std::vector<const Value*> operand_ptrs;
+        for (const Value& value : operand_values) {
+          operand_ptrs.push_back(&value);
+        }
+        XLS_ASSIGN_OR_RETURN(Value result,
+                             IrInterpreter::EvaluateNode(node, operand_ptrs));
+        if (inst.a) {
+          r[inst.dst] = result.bits().ToUint64().value();
+        } else {
+          FlatIrInterpreter::BlitValueToBuffer(result, node->GetType(),
+                                               m + inst.dst);
+        }
+        break;
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+std::string BytecodeInterpreter::ToString() const {
+  std::vector<std::string> lines;
+  for (int64 i = 0; i < program_.size(); ++i) {
+    const Instruction& inst = program_[i];
+    std::string line =
+        absl::StrFormat("%4d: %-18s dst=%d a=%d b=%d c=%d width=%d", i,
+                        OpcodeToString(inst.op), inst.dst, inst.a, inst.b,
+                        inst.c, inst.width);
+    if (inst.node != nullptr) {
+      absl::StrAppend(&line, "  // ", inst.node->GetName());
+    }
+    lines.push_back(line);
+  }
+  return absl::StrJoin(lines, "\n");
+}
+
+}  // namespace xls
@@ -0,0 +1,108 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_INTERPRETER_BYTECODE_INTERPRETER_H_
+#define XLS_INTERPRETER_BYTECODE_INTERPRETER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/common/integral_types.h"
+#include "xls/ir/function.h"
+#include "xls/ir/value.h"
+
+namespace xls {
+
+// An IR evaluator which lowers a function, once, into a linear program for a
+// simple register machine, then executes that program as often as needed.
+// Intended for cases where the per-call overhead of IrInterpreter is too high
+// but the compilation cost of LlvmIrJit can't be amortized (e.g., many small
+// functions each evaluated a handful of times).
+//
+// The machine has two kinds of storage:
+//  * Word registers, holding bits values of at most 64 bits. Almost all
+//    operations on such values are single instructions operating directly on
+//    uint64s.
+//  * A byte arena holding tuples, arrays and wider bits values in the flat
+//    layout used by FlatIrInterpreter. These are manipulated with byte copies;
+//    tuple elements are referred to in place, and array_update writes in place
+//    when no other node can observe its operand afterwards.
+// Operations without a specialized instruction (wide arithmetic, division,
+// encode, etc.) are evaluated by IrInterpreter::EvaluateNode() on Values.
+// Invoked, mapped and loop body functions are compiled to their own programs.
+//
+// BytecodeInterpreters are thread-compatible, but not thread-safe.
+class BytecodeInterpreter {
+ public:
+  static absl::StatusOr<std::unique_ptr<BytecodeInterpreter>> Create(
+      Function* function);
+
+  ~BytecodeInterpreter();
+
+  BytecodeInterpreter(const BytecodeInterpreter&) = delete;
+  BytecodeInterpreter operator=(const BytecodeInterpreter&) = delete;
+
+  // Convenience wrappers which compile the function for a single run, with the
+  // same interfaces as IrInterpreter's.
+  static absl::StatusOr<Value> Run(Function* function,
+                                   absl::Span<const Value> args);
+  static absl::StatusOr<Value> RunKwargs(
+      Function* function, const absl::flat_hash_map<std::string, Value>& args);
+
+  // Evaluates the function with the given arguments.
+  absl::StatusOr<Value> Run(absl::Span<const Value> args);
+
+  // Evaluates the function with arguments and result in FlatIrInterpreter's
+  // flat layout (see FlatIrInterpreter::RunWithBuffers()).
+  absl::Status RunWithBuffers(absl::Span<const uint8* const> args,
+                              uint8* result);
+
+  // Returns a human-readable listing of the program.
+  std::string ToString() const;
+
+  Function* function() const { return function_; }
+
+ private:
+  struct Instruction;
+  struct Location;
+  class Compiler;
+
+  explicit BytecodeInterpreter(Function* function);
+
+  absl::Status Execute();
+
+  Function* function_;
+  std::vector<Instruction> program_;
+
+  // Registers and arena. Literals are materialized into these on creation and
+  // never overwritten.
+  std::vector<uint64> registers_;
+  std::vector<uint8> arena_;
+
+  std::vector<Location> param_locations_;
+  std::unique_ptr<Location> return_location_;
+
+  // Out-of-line operands for instructions which need more than a few.
+  std::vector<std::vector<int64>> operand_lists_;
+  std::vector<std::unique_ptr<BytecodeInterpreter>> callees_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_INTERPRETER_BYTECODE_INTERPRETER_H_
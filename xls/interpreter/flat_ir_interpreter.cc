@@ -0,0 +1,645 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/interpreter/flat_ir_interpreter.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/math_util.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/keyword_args.h"
+#include "xls/ir/node_iterator.h"
+#include "xls/ir/nodes.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+namespace {
+
+int64 BitsByteCount(int64 bit_count) {
+  return CeilOfRatio(bit_count, int64{8});
+}
+
+uint64 WordMask(int64 bit_count) {
+  return bit_count >= 64 ? ~uint64{0} : (uint64{1} << bit_count) - 1;
+}
+
+// Loads or stores a bits value of at most 64 bits. Assumes a little-endian
+// host, as does the JIT.
+uint64 LoadWord(const uint8* buffer, int64 bit_count) {
+  uint64 word = 0;
+  std::memcpy(&word, buffer, BitsByteCount(bit_count));
+  return word;
+}
+
+void StoreWord(uint64 word, int64 bit_count, uint8* buffer) {
+  word &= WordMask(bit_count);
+  std::memcpy(buffer, &word, BitsByteCount(bit_count));
+}
+
+int64 SignExtendWord(uint64 word, int64 bit_count) {
+  if (bit_count == 0) {
+    return 0;
+  }
+  int64 shift = 64 - bit_count;
+  return static_cast<int64>(word << shift) >> shift;
+}
+
+bool IsNarrowBits(Type* type) {
+  return type->IsBits() && type->AsBitsOrDie()->bit_count() <= 64;
+}
+
+// Returns true if the node and all its operands are bits types of at most 64
+// bits.
+bool AllNarrowBits(Node* node) {
+  if (!IsNarrowBits(node->GetType())) {
+    return false;
+  }
+  return std::all_of(node->operands().begin(), node->operands().end(),
+                     [](Node* n) { return IsNarrowBits(n->GetType()); });
+}
+
+// Returns true if the node can be evaluated directly on the flat layout
+// (rather than via IrInterpreter).
+bool CanExecuteNatively(Node* node) {
+  switch (node->op()) {
+    case Op::kAdd:
+    case Op::kSub:
+    case Op::kNeg:
+    case Op::kNot:
+    case Op::kAnd:
+    case Op::kOr:
+    case Op::kXor:
+    case Op::kNand:
+    case Op::kNor:
+    case Op::kShll:
+    case Op::kShrl:
+    case Op::kShra:
+    case Op::kEq:
+    case Op::kNe:
+    case Op::kULt:
+    case Op::kULe:
+    case Op::kUGt:
+    case Op::kUGe:
+    case Op::kSLt:
+    case Op::kSLe:
+    case Op::kSGt:
+    case Op::kSGe:
+    case Op::kZeroExt:
+    case Op::kSignExt:
+    case Op::kBitSlice:
+    case Op::kConcat:
+    case Op::kAndReduce:
+    case Op::kOrReduce:
+    case Op::kXorReduce:
+    case Op::kUMul:
+    case Op::kSMul:
+      return AllNarrowBits(node);
+    case Op::kSel:
+    case Op::kOneHotSel:
+      // The selector must fit in a word.
+      return IsNarrowBits(node->operand(0)->GetType());
+    case Op::kArrayIndex:
+    case Op::kArrayUpdate:
+      // As must the index.
+      return IsNarrowBits(node->operand(1)->GetType());
+    case Op::kTuple:
+    case Op::kArray:
+    case Op::kArrayConcat:
+    case Op::kInvoke:
+    case Op::kMap:
+    case Op::kCountedFor:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns true if the node's value is stored in (part of) its operand's
+// storage rather than its own.
+bool IsAlias(Node* node) {
+  return node->Is<TupleIndex>() || node->op() == Op::kIdentity;
+}
+
+}  // namespace
+
+/* static */
+absl::StatusOr<std::unique_ptr<FlatIrInterpreter>> FlatIrInterpreter::Create(
+    Function* function) {
+  auto interpreter = absl::WrapUnique(new FlatIrInterpreter(function));
+  XLS_RETURN_IF_ERROR(interpreter->Build());
+  return std::move(interpreter);
+}
+
+/* static */
+absl::StatusOr<Value> FlatIrInterpreter::Run(Function* function,
+                                             absl::Span<const Value> args) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<FlatIrInterpreter> interpreter,
+                       Create(function));
+  return interpreter->Run(args);
+}
+
+/* static */
+absl::StatusOr<Value> FlatIrInterpreter::RunKwargs(
+    Function* function, const absl::flat_hash_map<std::string, Value>& args) {
+  XLS_ASSIGN_OR_RETURN(std::vector<Value> positional_args,
+                       KeywordArgsToPositional(*function, args));
+  return Run(function, positional_args);
+}
+
+/* static */
+int64 FlatIrInterpreter::GetTypeByteSize(Type* type) {
+  switch (type->kind()) {
+    case TypeKind::kBits:
+      return BitsByteCount(type->AsBitsOrDie()->bit_count());
+    case TypeKind::kTuple: {
+      int64 size = 0;
+      for (Type* element_type : type->AsTupleOrDie()->element_types()) {
+        size += GetTypeByteSize(element_type);
+      }
+      return size;
+    }
+    case TypeKind::kArray:
+      return type->AsArrayOrDie()->size() *
+             GetTypeByteSize(type->AsArrayOrDie()->element_type());
+    case TypeKind::kToken:
+      return 0;
+  }
+  XLS_LOG(FATAL) << "Invalid type kind: " << type->ToString();
+}
+
+/* static */
+void FlatIrInterpreter::BlitValueToBuffer(const Value& value, Type* type,
+                                          uint8* buffer) {
+  if (type->IsBits()) {
+    const Bits& bits = value.bits();
+    if (bits.bit_count() <= 64) {
+      StoreWord(bits.ToUint64().value(), bits.bit_count(), buffer);
+    } else {
+      bits.ToBytes(absl::MakeSpan(buffer, BitsByteCount(bits.bit_count())),
+                   /*big_endian=*/false);
+    }
+    return;
+  }
+  if (type->IsTuple() || type->IsArray()) {
+    for (int64 i = 0; i < value.size(); ++i) {
+      Type* element_type = type->IsTuple()
+                               ? type->AsTupleOrDie()->element_type(i)
+                               : type->AsArrayOrDie()->element_type();
+      BlitValueToBuffer(value.element(i), element_type, buffer);
+      buffer += GetTypeByteSize(element_type);
+    }
+  }
+}
+
+/* static */
+Value FlatIrInterpreter::UnpackBuffer(Type* type, const uint8* buffer) {
+  switch (type->kind()) {
+    case TypeKind::kBits: {
+      int64 bit_count = type->AsBitsOrDie()->bit_count();
+      if (bit_count <= 64) {
+        return Value(UBits(LoadWord(buffer, bit_count), bit_count));
+      }
+      // Bits::FromBytes wants the most significant byte first.
+      std::vector<uint8> bytes(buffer, buffer + BitsByteCount(bit_count));
+      std::reverse(bytes.begin(), bytes.end());
+      return Value(Bits::FromBytes(bytes, bit_count));
+    }
+    case TypeKind::kTuple: {
+      std::vector<Value> elements;
+      for (Type* element_type : type->AsTupleOrDie()->element_types()) {
+        elements.push_back(UnpackBuffer(element_type, buffer));
+        buffer += GetTypeByteSize(element_type);
+      }
+      return Value::TupleOwned(std::move(elements));
+    }
+    case TypeKind::kArray: {
+      Type* element_type = type->AsArrayOrDie()->element_type();
+      std::vector<Value> elements;
+      for (int64 i = 0; i < type->AsArrayOrDie()->size(); ++i) {
+        elements.push_back(UnpackBuffer(element_type, buffer));
+        buffer += GetTypeByteSize(element_type);
+      }
+      return Value::ArrayOrDie(elements);
+    }
+    case TypeKind::kToken:
+      return Value::Token();
+  }
+  XLS_LOG(FATAL) << "Invalid type kind: " << type->ToString();
+}
+
+absl::Status FlatIrInterpreter::Build() {
+  absl::flat_hash_map<Node*, int64> offsets;
+  std::vector<Literal*> literals;
+  absl::flat_hash_set<Node*> in_place_updates;
+  // An array_update can write into its array operand's storage if no-one else
+  // can observe the operand afterwards: it isn't a literal (which persist
+  // across runs) or the return value, its storage isn't shared with another
+  // node, and all its other users have already been evaluated (i.e., appear
+  // earlier in the topological order) and copied what they need.
+  auto can_update_in_place = [&](Node* update) {
+    Node* array = update->operand(0);
+    if (array->Is<Literal>() || array == function_->return_value() ||
+        IsAlias(array)) {
+      return false;
+    }
+    return std::all_of(
+        array->users().begin(), array->users().end(), [&](Node* user) {
+          return user == update ||
+                 (offsets.contains(user) && !IsAlias(user) &&
+                  !in_place_updates.contains(user));
+        });
+  };
+  int64 arena_size = 0;
+  for (Node* node : TopoSort(function_)) {
+    int64 offset;
+    bool in_place = false;
+    if (node->Is<TupleIndex>()) {
+      // Refer directly to the element within the tuple operand.
+      TupleType* tuple_type = node->operand(0)->GetType()->AsTupleOrDie();
+      offset = offsets.at(node->operand(0));
+      for (int64 i = 0; i < node->As<TupleIndex>()->index(); ++i) {
+        offset += GetTypeByteSize(tuple_type->element_type(i));
+      }
+    } else if (node->op() == Op::kIdentity) {
+      offset = offsets.at(node->operand(0));
+    } else if (node->Is<ArrayUpdate>() && can_update_in_place(node)) {
+      offset = offsets.at(node->operand(0));
+      in_place = true;
+      in_place_updates.insert(node);
+    } else {
+      offset = arena_size;
+      arena_size += GetTypeByteSize(node->GetType());
+    }
+    offsets[node] = offset;
+
+    if (node->Is<Literal>()) {
+      literals.push_back(node->As<Literal>());
+      continue;
+    }
+    if (node->Is<Param>() || IsAlias(node) || node->GetType()->IsToken()) {
+      continue;
+    }
+
+    Step step;
+    step.node = node;
+    step.offset = offset;
+    for (Node* operand : node->operands()) {
+      step.operand_offsets.push_back(offsets.at(operand));
+    }
+    step.native = CanExecuteNatively(node);
+    step.in_place = in_place;
+    step.callee = nullptr;
+    Function* callee = nullptr;
+    if (node->Is<Invoke>()) {
+      callee = node->As<Invoke>()->to_apply();
+    } else if (node->Is<Map>()) {
+      callee = node->As<Map>()->to_apply();
+    } else if (node->Is<CountedFor>()) {
+      callee = node->As<CountedFor>()->body();
+    }
+    if (callee != nullptr) {
+      auto it = callees_.find(callee);
+      if (it == callees_.end()) {
+        XLS_ASSIGN_OR_RETURN(std::unique_ptr<FlatIrInterpreter> interpreter,
+                             Create(callee));
+        it = callees_.insert({callee, std::move(interpreter)}).first;
+      }
+      step.callee = it->second.get();
+    }
+    steps_.push_back(std::move(step));
+  }
+
+  arena_.resize(arena_size);
+  for (Literal* literal : literals) {
+    BlitValueToBuffer(literal->value(), literal->GetType(),
+                      arena_.data() + offsets.at(literal));
+  }
+  for (Param* param : function_->params()) {
+    param_offsets_.push_back(offsets.at(param));
+  }
+  return_offset_ = offsets.at(function_->return_value());
+  return_size_ = GetTypeByteSize(function_->return_value()->GetType());
+  return absl::OkStatus();
+}
+
+absl::StatusOr<Value> FlatIrInterpreter::Run(absl::Span<const Value> args) {
+  XLS_VLOG(3) << "Interpreting function " << function_->name();
+  if (args.size() != function_->params().size()) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Function %s wants %d arguments, got %d.", function_->name(),
+        function_->params().size(), args.size()));
+  }
+  for (int64 argno = 0; argno < args.size(); ++argno) {
+    Type* param_type = function_->param(argno)->GetType();
+    Type* value_type = function_->package()->GetTypeForValue(args[argno]);
+    if (value_type != param_type) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Got argument %s for parameter %d which is not of type %s",
+          args[argno].ToString(), argno, param_type->ToString()));
+    }
+    BlitValueToBuffer(args[argno], param_type,
+                      arena_.data() + param_offsets_[argno]);
+  }
+  for (const Step& step : steps_) {
+    XLS_RETURN_IF_ERROR(Execute(step));
+  }
+  Value result = UnpackBuffer(function_->return_value()->GetType(),
+                              arena_.data() + return_offset_);
+  XLS_VLOG(2) << "Result = " << result;
+  return result;
+}
+
+absl::Status FlatIrInterpreter::RunWithBuffers(
+    absl::Span<const uint8* const> args, uint8* result) {
+  XLS_RET_CHECK_EQ(args.size(), param_offsets_.size());
+  for (int64 i = 0; i < args.size(); ++i) {
+    std::memcpy(arena_.data() + param_offsets_[i], args[i],
+                GetTypeByteSize(function_->param(i)->GetType()));
+  }
+  for (const Step& step : steps_) {
+    XLS_RETURN_IF_ERROR(Execute(step));
+  }
+  std::memcpy(result, arena_.data() + return_offset_, return_size_);
+  return absl::OkStatus();
+}
+
+uint64 FlatIrInterpreter::LoadBoundedIndex(const Step& step, int64 operand_no,
+                                           uint64 upper_limit) const {
+  uint64 index =
+      LoadWord(arena_.data() + step.operand_offsets[operand_no],
+               step.node->operand(operand_no)->BitCountOrDie());
+  return std::min(index, upper_limit);
+}
+
+absl::Status FlatIrInterpreter::Execute(const Step& step) {
+  if (!step.native) {
+    return ExecuteFallback(step);
+  }
+
+  Node* node = step.node;
+  uint8* result = arena_.data() + step.offset;
+  auto operand_ptr = [&](int64 i) {
+    return arena_.data() + step.operand_offsets[i];
+  };
+  // Accessors for narrow bits operands and results.
+  auto load = [&](int64 i) {
+    return LoadWord(operand_ptr(i), node->operand(i)->BitCountOrDie());
+  };
+  auto load_signed = [&](int64 i) {
+    return SignExtendWord(load(i), node->operand(i)->BitCountOrDie());
+  };
+  auto store = [&](uint64 value) {
+    StoreWord(value, node->BitCountOrDie(), result);
+    return absl::OkStatus();
+  };
+  auto nary = [&](auto fn) {
+    uint64 accum = load(0);
+    for (int64 i = 1; i < node->operand_count(); ++i) {
+      accum = fn(accum, load(i));
+    }
+    return accum;
+  };
+  int64 result_size = GetTypeByteSize(node->GetType());
+
+  switch (node->op()) {
+    case Op::kAdd:
+      return store(load(0) + load(1));
+    case Op::kSub:
+      return store(load(0) - load(1));
+    case Op::kNeg:
+      return store(-load(0));
+    case Op::kNot:
+      return store(~load(0));
+    case Op::kAnd:
+      return store(nary([](uint64 a, uint64 b) { return a & b; }));
+    case Op::kOr:
+      return store(nary([](uint64 a, uint64 b) { return a | b; }));
+    case Op::kXor:
+      return store(nary([](uint64 a, uint64 b) { return a ^ b; }));
+    case Op::kNand:
+      return store(~nary([](uint64 a, uint64 b) { return a & b; }));
+    case Op::kNor:
+      return store(~nary([](uint64 a, uint64 b) { return a | b; }));
+    case Op::kShll:
+    case Op::kShrl:
+    case Op::kShra: {
+      const int64 width = node->BitCountOrDie();
+      uint64 amount = load(1);
+      if (node->op() == Op::kShra) {
+        // Shifting a sign-extended value by 63 fills with the sign bit, so the
+        // amount needn't be clamped to the width.
+        return store(static_cast<uint64>(load_signed(0) >>
+                                         std::min<uint64>(amount, 63)));
+      }
+      if (amount >= width) {
+        return store(0);
+      }
+      return store(node->op() == Op::kShll ? load(0) << amount
+                                           : load(0) >> amount);
+    }
+    case Op::kEq:
+      return store(load(0) == load(1));
+    case Op::kNe:
+      return store(load(0) != load(1));
+    case Op::kULt:
+      return store(load(0) < load(1));
+    case Op::kULe:
+      return store(load(0) <= load(1));
+    case Op::kUGt:
+      return store(load(0) > load(1));
+    case Op::kUGe:
+      return store(load(0) >= load(1));
+    case Op::kSLt:
+      return store(load_signed(0) < load_signed(1));
+    case Op::kSLe:
+      return store(load_signed(0) <= load_signed(1));
+    case Op::kSGt:
+      return store(load_signed(0) > load_signed(1));
+    case Op::kSGe:
+      return store(load_signed(0) >= load_signed(1));
+    case Op::kZeroExt:
+      return store(load(0));
+    case Op::kSignExt:
+      return store(static_cast<uint64>(load_signed(0)));
+    case Op::kBitSlice: {
+      int64 start = node->As<BitSlice>()->start();
+      return store(start >= 64 ? 0 : load(0) >> start);
+    }
+    case Op::kConcat: {
+      // Operand zero is the most significant.
+      uint64 accum = 0;
+      for (int64 i = 0; i < node->operand_count(); ++i) {
+        int64 width = node->operand(i)->BitCountOrDie();
+        accum = (width >= 64 ? 0 : accum << width) | load(i);
+      }
+      return store(accum);
+    }
+    case Op::kAndReduce:
+      return store(load(0) == WordMask(node->operand(0)->BitCountOrDie()));
+    case Op::kOrReduce:
+      return store(load(0) != 0);
+    case Op::kXorReduce:
+      return store(__builtin_popcountll(load(0)) & 1);
+    case Op::kUMul:
+      // The low bits of the product only depend on the low bits of the
+      // operands, so wrapping 64-bit arithmetic gives the (truncated) result.
+      return store(load(0) * load(1));
+    case Op::kSMul:
+      return store(static_cast<uint64>(load_signed(0)) *
+                   static_cast<uint64>(load_signed(1)));
+    case Op::kSel: {
+      Select* sel = node->As<Select>();
+      uint64 selector = load(0);
+      int64 operand_no = selector >= sel->cases().size()
+                             ? node->operand_count() - 1
+                             : 1 + selector;
+      XLS_RET_CHECK(selector < sel->cases().size() ||
+                    sel->default_value().has_value());
+      std::memcpy(result, operand_ptr(operand_no), result_size);
+      return absl::OkStatus();
+    }
+    case Op::kOneHotSel: {
+      // Unused bits in the layout are zero, so the OR can be done bytewise
+      // across the entire value.
+      uint64 selector = load(0);
+      std::memset(result, 0, result_size);
+      for (int64 i = 1; i < node->operand_count(); ++i) {
+        if ((selector >> (i - 1)) & 1) {
+          const uint8* input = operand_ptr(i);
+          for (int64 j = 0; j < result_size; ++j) {
+            result[j] |= input[j];
+          }
+        }
+      }
+      return absl::OkStatus();
+    }
+    case Op::kTuple:
+    case Op::kArray:
+    case Op::kArrayConcat: {
+      uint8* output = result;
+      for (int64 i = 0; i < node->operand_count(); ++i) {
+        int64 size = GetTypeByteSize(node->operand(i)->GetType());
+        std::memcpy(output, operand_ptr(i), size);
+        output += size;
+      }
+      return absl::OkStatus();
+    }
+    case Op::kArrayIndex: {
+      // Out-of-bounds accesses are clamped to the highest index, as in
+      // IrInterpreter.
+      ArrayType* array_type = node->operand(0)->GetType()->AsArrayOrDie();
+      uint64 index = LoadBoundedIndex(step, 1, array_type->size() - 1);
+      std::memcpy(result, operand_ptr(0) + index * result_size, result_size);
+      return absl::OkStatus();
+    }
+    case Op::kArrayUpdate: {
+      ArrayType* array_type = node->GetType()->AsArrayOrDie();
+      if (!step.in_place) {
+        std::memcpy(result, operand_ptr(0), result_size);
+      }
+      // Out-of-bounds updates have no effect.
+      uint64 index = LoadBoundedIndex(step, 1, array_type->size());
+      if (index < array_type->size()) {
+        int64 element_size = GetTypeByteSize(array_type->element_type());
+        std::memcpy(result + index * element_size, operand_ptr(2),
+                    element_size);
+      }
+      return absl::OkStatus();
+    }
+    case Op::kInvoke:
+      return ExecuteInvoke(step);
+    case Op::kMap:
+      return ExecuteMap(step);
+    case Op::kCountedFor:
+      return ExecuteCountedFor(step);
+    default:
+      return ExecuteFallback(step);
+  }
+}
+
+absl::Status FlatIrInterpreter::ExecuteFallback(const Step& step) {
+  Node* node = step.node;
+  std::vector<Value> operand_values;
+  operand_values.reserve(node->operand_count());
+  for (int64 i = 0; i < node->operand_count(); ++i) {
+    operand_values.push_back(
+        UnpackBuffer(node->operand(i)->GetType(),
+                     arena_.data() + step.operand_offsets[i]));
+  }
+  std::vector<const Value*> operand_ptrs;
+  for (const Value& value : operand_values) {
+    operand_ptrs.push_back(&value);
+  }
+  XLS_ASSIGN_OR_RETURN(Value result,
+                       IrInterpreter::EvaluateNode(node, operand_ptrs));
+  BlitValueToBuffer(result, node->GetType(), arena_.data() + step.offset);
+  return absl::OkStatus();
+}
+
+absl::Status FlatIrInterpreter::ExecuteInvoke(const Step& step) {
+  absl::InlinedVector<const uint8*, 8> args;
+  for (int64 offset : step.operand_offsets) {
+    args.push_back(arena_.data() + offset);
+  }
+  return step.callee->RunWithBuffers(args, arena_.data() + step.offset);
+}
+
+absl::Status FlatIrInterpreter::ExecuteMap(const Step& step) {
+  Map* map = step.node->As<Map>();
+  int64 input_size = GetTypeByteSize(
+      map->operand(0)->GetType()->AsArrayOrDie()->element_type());
+  int64 output_size =
+      GetTypeByteSize(map->GetType()->AsArrayOrDie()->element_type());
+  const uint8* input = arena_.data() + step.operand_offsets[0];
+  uint8* output = arena_.data() + step.offset;
+  for (int64 i = 0; i < map->GetType()->AsArrayOrDie()->size(); ++i) {
+    const uint8* args[] = {input + i * input_size};
+    XLS_RETURN_IF_ERROR(
+        step.callee->RunWithBuffers(args, output + i * output_size));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status FlatIrInterpreter::ExecuteCountedFor(const Step& step) {
+  CountedFor* counted_for = step.node->As<CountedFor>();
+  // The loop state lives in the node's own storage, and is passed to the body
+  // and overwritten by its result on each iteration.
+  uint8* state = arena_.data() + step.offset;
+  std::memcpy(state, arena_.data() + step.operand_offsets[0],
+              GetTypeByteSize(counted_for->GetType()));
+
+  int64 iv_width = counted_for->body()->param(0)->BitCountOrDie();
+  absl::InlinedVector<uint8, 8> induction_variable(BitsByteCount(iv_width), 0);
+  absl::InlinedVector<const uint8*, 8> args = {induction_variable.data(),
+                                               state};
+  for (int64 i = 1; i < counted_for->operand_count(); ++i) {
+    args.push_back(arena_.data() + step.operand_offsets[i]);
+  }
+  for (int64 i = 0, iv = 0; i < counted_for->trip_count();
+       ++i, iv += counted_for->stride()) {
+    StoreWord(iv, std::min<int64>(iv_width, 64), induction_variable.data());
+    XLS_RETURN_IF_ERROR(step.callee->RunWithBuffers(args, state));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace xls
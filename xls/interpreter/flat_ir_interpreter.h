@@ -0,0 +1,138 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_INTERPRETER_FLAT_IR_INTERPRETER_H_
+#define XLS_INTERPRETER_FLAT_IR_INTERPRETER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/common/integral_types.h"
+#include "xls/ir/function.h"
+#include "xls/ir/type.h"
+#include "xls/ir/value.h"
+
+namespace xls {
+
+// An IR interpreter which, unlike IrInterpreter, doesn't represent node values
+// as Values.
+//
+// On creation, the function is flattened into a list of evaluation steps (in
+// topological order) and every node is assigned a fixed slot in a single
+// arena of bytes. Values are stored in the arena in a flat layout, similar to
+// that used by ValueView and the JIT but without alignment padding: a bits
+// value occupies ceil(bit_count / 8) bytes, least-significant byte first, with
+// any unused high bits zero; tuples and arrays are their elements laid out
+// consecutively. Evaluation then allocates nothing for the common cases:
+//  * Bits operations up to 64 bits wide are performed on machine words.
+//  * Tuples, arrays, selects, etc. are byte copies; tuple_index and identity
+//    nodes simply refer to their operand's storage.
+//  * array_update modifies its operand in place when no other node can observe
+//    the operand afterwards (e.g., it is the operand's only user).
+// Remaining operations (wide arithmetic, division, encode, etc.) convert their
+// operands to Values and are evaluated as in IrInterpreter.
+//
+// The arena persists across Run() calls, so a FlatIrInterpreter is best
+// created once per function and reused. FlatIrInterpreters are
+// thread-compatible, but not thread-safe.
+class FlatIrInterpreter {
+ public:
+  static absl::StatusOr<std::unique_ptr<FlatIrInterpreter>> Create(
+      Function* function);
+
+  FlatIrInterpreter(const FlatIrInterpreter&) = delete;
+  FlatIrInterpreter operator=(const FlatIrInterpreter&) = delete;
+
+  // Convenience wrappers which create an interpreter for a single run, with
+  // the same interfaces as IrInterpreter's.
+  static absl::StatusOr<Value> Run(Function* function,
+                                   absl::Span<const Value> args);
+  static absl::StatusOr<Value> RunKwargs(
+      Function* function, const absl::flat_hash_map<std::string, Value>& args);
+
+  // Evaluates the function with the given arguments.
+  absl::StatusOr<Value> Run(absl::Span<const Value> args);
+
+  // Evaluates the function with arguments and result in the flat layout
+  // described above. "args[i]" must point to GetTypeByteSize() bytes of the
+  // i-th parameter's type, and "result" to the same for the return type. The
+  // result may overlap the arguments.
+  absl::Status RunWithBuffers(absl::Span<const uint8* const> args,
+                              uint8* result);
+
+  // Returns the size in bytes of the flat layout of the given type.
+  static int64 GetTypeByteSize(Type* type);
+
+  // Converts a Value of the given type to or from the flat layout.
+  static void BlitValueToBuffer(const Value& value, Type* type, uint8* buffer);
+  static Value UnpackBuffer(Type* type, const uint8* buffer);
+
+  Function* function() const { return function_; }
+
+ private:
+  // The evaluation of a single node.
+  struct Step {
+    Node* node;
+    // Offset of the node's value in the arena.
+    int64 offset;
+    // Offsets of the operands' values in the arena.
+    std::vector<int64> operand_offsets;
+    // Whether the node can be evaluated directly on the flat layout, rather
+    // than by IrInterpreter.
+    bool native;
+    // Whether this array_update writes into its operand's storage.
+    bool in_place;
+    // For nodes which call a function (invoke, map and counted_for), the
+    // interpreter for the callee.
+    FlatIrInterpreter* callee;
+  };
+
+  explicit FlatIrInterpreter(Function* function) : function_(function) {}
+
+  // Assigns slots, builds the steps and creates interpreters for callees.
+  absl::Status Build();
+
+  absl::Status Execute(const Step& step);
+
+  // Evaluates the step's node via IrInterpreter::EvaluateNode().
+  absl::Status ExecuteFallback(const Step& step);
+
+  absl::Status ExecuteCountedFor(const Step& step);
+  absl::Status ExecuteMap(const Step& step);
+  absl::Status ExecuteInvoke(const Step& step);
+
+  // Returns the node's index operand (an unsigned value), clamped to
+  // "upper_limit".
+  uint64 LoadBoundedIndex(const Step& step, int64 operand_no,
+                          uint64 upper_limit) const;
+
+  Function* function_;
+  std::vector<uint8> arena_;
+  std::vector<Step> steps_;
+  // Arena offsets of the function's parameters and return value.
+  std::vector<int64> param_offsets_;
+  int64 return_offset_;
+  int64 return_size_;
+
+  absl::flat_hash_map<Function*, std::unique_ptr<FlatIrInterpreter>> callees_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_INTERPRETER_FLAT_IR_INTERPRETER_H_
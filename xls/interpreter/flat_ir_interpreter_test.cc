@@ -0,0 +1,144 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/interpreter/flat_ir_interpreter.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/interpreter/ir_evaluator_test.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+
+INSTANTIATE_TEST_SUITE_P(
+    FlatIrInterpreterTest, IrEvaluatorTest,
+    testing::Values(IrEvaluatorTestParam(
+        [](Function* function, const std::vector<Value>& args) {
+          return FlatIrInterpreter::Run(function, args);
+        },
+        [](Function* function,
+           const absl::flat_hash_map<std::string, Value>& kwargs) {
+          return FlatIrInterpreter::RunKwargs(function, kwargs);
+        })));
+
+// Fixture for FlatIrInterpreter-only tests (i.e., those that aren't common to
+// all IR evaluators).
+class FlatIrInterpreterOnlyTest : public IrTestBase {};
+
+TEST_F(FlatIrInterpreterOnlyTest, FlatLayoutRoundTrip) {
+  Package package("my_package");
+  Value value = Value::Tuple(
+      {Value(UBits(0x1ff, 9)), Value::Token(),
+       Value::ArrayOrDie({Value(SBits(-1, 70)), Value(UBits(0x1234, 70))}),
+       Value(UBits(0, 0))});
+  Type* type = package.GetTypeForValue(value);
+  EXPECT_EQ(FlatIrInterpreter::GetTypeByteSize(type), 2 + 0 + 9 * 2 + 0);
+
+  std::vector<uint8> buffer(FlatIrInterpreter::GetTypeByteSize(type));
+  FlatIrInterpreter::BlitValueToBuffer(value, type, buffer.data());
+  // Bits are stored least-significant byte first, with unused bits zero.
+  EXPECT_EQ(buffer[0], 0xff);
+  EXPECT_EQ(buffer[1], 0x01);
+  EXPECT_EQ(buffer[10], 0x3f);
+  EXPECT_EQ(FlatIrInterpreter::UnpackBuffer(type, buffer.data()), value);
+}
+
+// An array_update whose operand has another user must not modify the operand.
+TEST_F(FlatIrInterpreterOnlyTest, ArrayUpdateOfSharedOperand) {
+  Package package("my_package");
+  std::string fn_text = R"(
+    fn f(a: bits[8][3], i: bits[2], x: bits[8]) -> (bits[8][3], bits[8][3]) {
+      array_update.4: bits[8][3] = array_update(a, i, x)
+      array_update.5: bits[8][3] = array_update(array_update.4, i, x)
+      literal.6: bits[2] = literal(value=0)
+      array_update.7: bits[8][3] = array_update(a, literal.6, x)
+      ret tuple.8: (bits[8][3], bits[8][3]) = tuple(array_update.5, array_update.7)
+    }
+    )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(fn_text, &package));
+
+  Value a = Value::UBitsArray({1, 2, 3}, 8).value();
+  std::vector<Value> args = {a, Value(UBits(2, 2)), Value(UBits(42, 8))};
+  XLS_ASSERT_OK_AND_ASSIGN(Value expected, IrInterpreter::Run(function, args));
+  XLS_ASSERT_OK_AND_ASSIGN(auto interpreter,
+                           FlatIrInterpreter::Create(function));
+  EXPECT_THAT(interpreter->Run(args), IsOkAndHolds(expected));
+}
+
+// Literals are materialized once, so must not be modified by in-place updates
+// or the next run sees a different value.
+TEST_F(FlatIrInterpreterOnlyTest, RepeatedRunsWithLiteralArray) {
+  Package package("my_package");
+  std::string fn_text = R"(
+    fn f(i: bits[32], x: bits[8]) -> bits[8][4] {
+      literal.3: bits[8][4] = literal(value=[1, 2, 3, 4])
+      ret array_update.4: bits[8][4] = array_update(literal.3, i, x)
+    }
+    )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(fn_text, &package));
+  XLS_ASSERT_OK_AND_ASSIGN(auto interpreter,
+                           FlatIrInterpreter::Create(function));
+  EXPECT_THAT(interpreter->Run({Value(UBits(0, 32)), Value(UBits(9, 8))}),
+              IsOkAndHolds(Value::UBitsArray({9, 2, 3, 4}, 8).value()));
+  EXPECT_THAT(interpreter->Run({Value(UBits(3, 32)), Value(UBits(7, 8))}),
+              IsOkAndHolds(Value::UBitsArray({1, 2, 3, 7}, 8).value()));
+  // Out of bounds updates have no effect.
+  EXPECT_THAT(interpreter->Run({Value(UBits(100, 32)), Value(UBits(7, 8))}),
+              IsOkAndHolds(Value::UBitsArray({1, 2, 3, 4}, 8).value()));
+}
+
+// A loop updating an array element by element, the case in-place updates are
+// intended for.
+TEST_F(FlatIrInterpreterOnlyTest, CountedForArrayUpdates) {
+  Package package("my_package");
+  std::string program = R"(
+package my_package
+
+fn body(i: bits[4], accum: bits[16][8], x: bits[16]) -> bits[16][8] {
+  array_index.4: bits[16] = array_index(accum, i)
+  add.5: bits[16] = add(array_index.4, x)
+  zero_ext.6: bits[16] = zero_ext(i, new_bit_count=16)
+  umul.7: bits[16] = umul(add.5, zero_ext.6)
+  ret array_update.8: bits[16][8] = array_update(accum, i, umul.7)
+}
+
+fn main(a: bits[16][8], x: bits[16]) -> bits[16][8] {
+  ret counted_for.3: bits[16][8] = counted_for(a, trip_count=8, stride=1, body=body, invariant_args=[x])
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> p,
+                           Parser::ParsePackage(program));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * main, p->GetFunction("main"));
+  std::vector<Value> args = {
+      Value::UBitsArray({1, 2, 3, 4, 5, 6, 7, 8}, 16).value(),
+      Value(UBits(1000, 16))};
+  XLS_ASSERT_OK_AND_ASSIGN(Value expected, IrInterpreter::Run(main, args));
+  XLS_ASSERT_OK_AND_ASSIGN(auto interpreter, FlatIrInterpreter::Create(main));
+  for (int64 i = 0; i < 3; ++i) {
+    EXPECT_THAT(interpreter->Run(args), IsOkAndHolds(expected));
+  }
+}
+
+}  // namespace
+}  // namespace xls
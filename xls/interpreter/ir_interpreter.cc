@@ -589,9 +589,6 @@ absl::Status IrInterpreter::SetUint64Result(Node* node, uint64 result) {
 absl::Status IrInterpreter::SetBitsResult(Node* node, const Bits& result) {
   XLS_RET_CHECK(node->GetType()->IsBits());
   XLS_RET_CHECK_EQ(node->BitCountOrDie(), result.bit_count());
-  if (stats_ != nullptr) {
-    stats_->NoteNodeBits(node->ToString(), result);
-  }
   return SetValueResult(node, Value(result));
 }
 
@@ -605,6 +602,9 @@ absl::Status IrInterpreter::SetValueResult(Node* node, Value result) {
   XLS_VLOG(3) << absl::StreamFormat("Result of %s: %s", node->ToString(),
                                     result.ToString());
   XLS_RET_CHECK(!node_values_.contains(node));
+  if (stats_ != nullptr && result.IsBits()) {
+    stats_->NoteNodeBits(node, result.bits());
+  }
   node_values_[node] = result;
   return absl::OkStatus();
 }
@@ -14,22 +14,122 @@
 
 #include "xls/interpreter/ir_interpreter_stats.h"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "xls/common/logging/logging.h"
+
 namespace xls {
+namespace {
+
+std::atomic<int64> next_stats_id{0};
+
+}  // namespace
+
+InterpreterStats::InterpreterStats() : id_(next_stats_id.fetch_add(1)) {}
+
+void InterpreterStats::Shard::NoteNodeBits(const Node* node,
+                                           const Bits& bits) {
+  auto [it, inserted] = value_profile.try_emplace(node->id());
+  NodeProfile& profile = it->second;
+  if (inserted) {
+    profile.node = node;
+    profile.lattice = ternary_ops::BitsToTernary(bits);
+    profile.known_bit_count = bits.bit_count();
+    return;
+  }
+  // Meets the observed "bits" value against the seen-so-far lattice of values
+  // -- e.g. if the seen-so-far value is 0 and "bits" contains a 1 in that bit
+  // position, the value will go to "bottom" (unknown = X). Once all bits are
+  // unknown, there is nothing left to learn.
+  XLS_CHECK_EQ(bits.bit_count(), profile.lattice.size());
+  for (int64 i = 0; i < bits.bit_count() && profile.known_bit_count > 0;
+       ++i) {
+    TernaryValue& value = profile.lattice[i];
+    if (value != TernaryValue::kUnknown &&
+        (value == TernaryValue::kKnownOne) != bits.Get(i)) {
+      value = TernaryValue::kUnknown;
+      --profile.known_bit_count;
+    }
+  }
+}
+
+InterpreterStats::Shard* InterpreterStats::LookUpShard() {
+  // A thread can alternate between several stats objects, so it remembers its
+  // shard of each rather than creating a new one on each switch. The shards
+  // are held weakly so that they are freed with their stats; the entries of
+  // destroyed stats are dropped whenever the thread adds a new entry, which
+  // keeps the map from growing with every stats object the thread has used.
+  thread_local absl::flat_hash_map<int64, std::weak_ptr<Shard>> thread_shards;
+  auto it = thread_shards.find(id_);
+  if (it != thread_shards.end()) {
+    // These stats are alive (this is one of their methods), so their shard is.
+    return it->second.lock().get();
+  }
+  absl::erase_if(thread_shards,
+                 [](const auto& entry) { return entry.second.expired(); });
+  absl::MutexLock lock(&mutex_);
+  shards_.push_back(std::make_shared<Shard>());
+  thread_shards[id_] = shards_.back();
+  return shards_.back().get();
+}
+
+absl::flat_hash_map<int64, InterpreterStats::NodeProfile>
+InterpreterStats::MergeValueProfiles() const {
+  absl::flat_hash_map<int64, NodeProfile> merged;
+  for (const std::shared_ptr<Shard>& shard : shards_) {
+    for (const auto& [id, profile] : shard->value_profile) {
+      auto [it, inserted] = merged.insert({id, profile});
+      if (!inserted) {
+        it->second.lattice =
+            ternary_ops::Equals(it->second.lattice, profile.lattice);
+      }
+    }
+  }
+  return merged;
+}
+
+ValueProfile InterpreterStats::GetValueProfile() const {
+  absl::MutexLock lock(&mutex_);
+  ValueProfile result;
+  for (auto& [id, profile] : MergeValueProfiles()) {
+    result[id] = std::move(profile.lattice);
+  }
+  return result;
+}
 
 std::string InterpreterStats::ToNodeReport() const {
-  std::string result;
-  for (const auto& item : value_profile_) {
-    if (ternary_ops::AllUnknown(item.second.value())) {
-      continue;
+  absl::flat_hash_map<int64, NodeProfile> merged = MergeValueProfiles();
+  std::vector<const NodeProfile*> profiles;
+  for (const auto& item : merged) {
+    if (!ternary_ops::AllUnknown(item.second.lattice)) {
+      profiles.push_back(&item.second);
     }
-    absl::StrAppendFormat(&result, " %s: %s\n", item.first,
-                          ToString(item.second.value()));
+  }
+  std::sort(profiles.begin(), profiles.end(),
+            [](const NodeProfile* a, const NodeProfile* b) {
+              return a->node->id() < b->node->id();
+            });
+  std::string result;
+  for (const NodeProfile* profile : profiles) {
+    absl::StrAppendFormat(&result, " %s: %s\n", profile->node->ToString(),
+                          ToString(profile->lattice));
   }
   return result;
 }
 
 std::string InterpreterStats::ToReport() const {
   absl::MutexLock lock(&mutex_);
+  int64 all_shlls = 0;
+  int64 zero_shlls = 0;
+  int64 overlarge_shlls = 0;
+  for (const std::shared_ptr<Shard>& shard : shards_) {
+    all_shlls += shard->all_shlls;
+    zero_shlls += shard->zero_shlls;
+    overlarge_shlls += shard->overlarge_shlls;
+  }
+  int64 in_range_shlls = all_shlls - overlarge_shlls - zero_shlls;
   auto percent = [](int64 value, int64 all) -> double {
     if (all == 0) {
       return 100.0;
@@ -43,9 +143,9 @@ shll:       %d
  overlarge: %d (%.2f%%)
  in-range:  %d (%.2f%%)
 )",
-             all_shlls_, zero_shlls_, percent(zero_shlls_, all_shlls_),
-             overlarge_shlls_, percent(overlarge_shlls_, all_shlls_),
-             in_range_shlls(), percent(in_range_shlls(), all_shlls_)) +
+             all_shlls, zero_shlls, percent(zero_shlls, all_shlls),
+             overlarge_shlls, percent(overlarge_shlls, all_shlls),
+             in_range_shlls, percent(in_range_shlls, all_shlls)) +
          ToNodeReport();
 }
 
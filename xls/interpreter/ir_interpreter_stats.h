@@ -15,77 +15,110 @@
 #ifndef XLS_IR_IR_INTERPRETER_STATS_H_
 #define XLS_IR_IR_INTERPRETER_STATS_H_
 
+#include <memory>
+#include <vector>
+
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_format.h"
 #include "absl/synchronization/mutex.h"
-#include "absl/types/optional.h"
 #include "xls/common/integral_types.h"
+#include "xls/ir/bits.h"
 #include "xls/ir/node.h"
 #include "xls/ir/ternary.h"
 
 namespace xls {
 
+// The bits of each node's value that were the same in every evaluation, keyed
+// by node id. A node that was never evaluated has no entry.
+using ValueProfile = absl::flat_hash_map<int64, TernaryVector>;
+
 // Note: as of now this is more of a "performance counter" dumb-struct sort of
 // class, where the determination of when/where to note things is inline in the
 // IR interpreter itself.
+//
+// Each thread noting stats gets its own shard of counters, so noting takes no
+// locks and threads interpreting concurrently don't contend. The shards are
+// merged when the stats are read, which must not happen concurrently with
+// noting.
 class InterpreterStats {
  public:
+  InterpreterStats();
+
   void NoteShllAmountForBitCount(int64 amount, int64 bit_count) {
-    absl::MutexLock lock(&mutex_);
-    all_shlls_ += 1;
-    overlarge_shlls_ += amount >= bit_count;
-    zero_shlls_ += amount == 0;
+    Shard* shard = GetShard();
+    shard->all_shlls += 1;
+    shard->overlarge_shlls += amount >= bit_count;
+    shard->zero_shlls += amount == 0;
   }
 
   // Notes the bits result for a given node (as determined by the interpreter)
   // -- the values that have consistent bits are recorded via the "Meet"
   // operator.
-  void NoteNodeBits(std::string node_string, const Bits& bits) {
-    absl::MutexLock lock(&mutex_);
-    auto& lattice = value_profile_[node_string];
-    Meet(bits, &lattice);
+  void NoteNodeBits(const Node* node, const Bits& bits) {
+    GetShard()->NoteNodeBits(node, bits);
   }
 
+  // Returns the value profile of all the nodes noted so far.
+  ValueProfile GetValueProfile() const;
+
   // Returns a multi-line report string suitable for, e.g. XLS_LOG_LINES'ing.
+  // The noted nodes must still exist.
   std::string ToReport() const;
 
  private:
-  int64 in_range_shlls() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
-    return all_shlls_ - overlarge_shlls_ - zero_shlls_;
-  }
+  // The observations of a single node's value.
+  struct NodeProfile {
+    const Node* node;
+
+    // Known bits are those that had the same value in every observation;
+    // kUnknown is "bottom" in the lattice (conflicting info).
+    TernaryVector lattice;
+    int64 known_bit_count;
+  };
 
-  // Meets the observed "bits" value against the seen-so-far "lattice" of values
-  // -- e.g. if the seen-so-far value is 0 and "bits" contains a 1 in that bit
-  // position, the value will go to "bottom" (unknown = X).
-  //
-  // A nullopt in the lattice means no value has yet been observed for the given
-  // node.
-  void Meet(const Bits& bits, absl::optional<TernaryVector>* lattice) {
-    if (lattice->has_value()) {
-      XLS_CHECK_EQ(bits.bit_count(), lattice->value().size());
-      *lattice = ternary_ops::Equals(ternary_ops::BitsToTernary(bits),
-                                     lattice->value());
-    } else {
-      *lattice = ternary_ops::BitsToTernary(bits);
+  struct Shard {
+    void NoteNodeBits(const Node* node, const Bits& bits);
+
+    absl::flat_hash_map<int64, NodeProfile> value_profile;
+    int64 overlarge_shlls = 0;
+    int64 zero_shlls = 0;
+    int64 all_shlls = 0;
+  };
+
+  // Returns the calling thread's shard, creating it on first use.
+  Shard* GetShard() {
+    struct CachedShard {
+      int64 stats_id = -1;
+      Shard* shard = nullptr;
+    };
+    thread_local CachedShard cached;
+    if (cached.stats_id != id_) {
+      cached = CachedShard{id_, LookUpShard()};
     }
+    return cached.shard;
   }
 
+  // The slow path of GetShard(), for the first use of these stats by a thread
+  // since it last used another InterpreterStats.
+  Shard* LookUpShard();
+
+  // Returns the value profile with each node's observations merged across
+  // shards.
+  absl::flat_hash_map<int64, NodeProfile> MergeValueProfiles() const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   // Returns a string that represents the nodes with consistent bit values.
   std::string ToNodeReport() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
-  mutable absl::Mutex mutex_;
+  // Uniquely identifies this object for the thread-local shard caches (unlike
+  // its address, which may be reused).
+  const int64 id_;
 
-  // When absl::nullopt, the value is "top" in the lattice (i.e. no info is
-  // available).
-  //
-  // When the ternary value is present, kUnknown is "bottom" in the lattice
-  // (conflicting info).
-  absl::flat_hash_map<std::string, absl::optional<TernaryVector>> value_profile_
-      ABSL_GUARDED_BY(mutex_);
-  int64 overlarge_shlls_ ABSL_GUARDED_BY(mutex_) = 0;
-  int64 zero_shlls_ ABSL_GUARDED_BY(mutex_) = 0;
-  int64 all_shlls_ ABSL_GUARDED_BY(mutex_) = 0;
+  mutable absl::Mutex mutex_;
+  // The shards are owned here; threads only hold weak references to them so
+  // they are released with these stats.
+  std::vector<std::shared_ptr<Shard>> shards_ ABSL_GUARDED_BY(mutex_);
 };
 
 }  // namespace xls
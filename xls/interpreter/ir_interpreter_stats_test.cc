@@ -0,0 +1,130 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/interpreter/ir_interpreter_stats.h"
+
+#include <thread>  // NOLINT
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_test_base.h"
+
+namespace xls {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::Pair;
+using ::testing::UnorderedElementsAre;
+
+class InterpreterStatsTest : public IrTestBase {};
+
+TEST_F(InterpreterStatsTest, MergesThreadShards) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(4));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  // Each thread sees x with bit 3 clear and bit 2 set; bits 1 and 0 differ
+  // between threads but not within one.
+  InterpreterStats stats;
+  std::vector<std::thread> threads;
+  for (int64 i = 0; i < 4; ++i) {
+    threads.emplace_back([&, i]() {
+      for (int64 j = 0; j < 1000; ++j) {
+        stats.NoteNodeBits(x.node(), UBits(0b0100 | i, 4));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_THAT(stats.GetValueProfile(),
+              UnorderedElementsAre(Pair(
+                  x.node()->id(), TernaryVector{TernaryValue::kUnknown,
+                                                TernaryValue::kUnknown,
+                                                TernaryValue::kKnownOne,
+                                                TernaryValue::kKnownZero})));
+  EXPECT_THAT(stats.ToReport(), HasSubstr("x: bits[4] = param(x): 0b01XX"));
+  EXPECT_EQ(f->return_value(), x.node());
+}
+
+TEST_F(InterpreterStatsTest, InterpreterProfilesAllBitsNodes) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(8));
+  BValue y = fb.Param("y", p->GetBitsType(8));
+  BValue sum = fb.Add(x, y);
+  fb.Tuple({sum, x});
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  InterpreterStats stats;
+  XLS_ASSERT_OK(
+      IrInterpreter::Run(f, {Value(UBits(1, 8)), Value(UBits(2, 8))}, &stats)
+          .status());
+  XLS_ASSERT_OK(
+      IrInterpreter::Run(f, {Value(UBits(3, 8)), Value(UBits(2, 8))}, &stats)
+          .status());
+
+  ValueProfile profile = stats.GetValueProfile();
+  // The tuple isn't bits, so it isn't profiled.
+  EXPECT_EQ(profile.size(), 3);
+  EXPECT_EQ(ToString(profile.at(x.node()->id())), "0b0000_00X1");
+  EXPECT_EQ(ToString(profile.at(y.node()->id())), "0b0000_0010");
+  EXPECT_EQ(ToString(profile.at(sum.node()->id())), "0b0000_0XX1");
+}
+
+TEST_F(InterpreterStatsTest, AlternatingStatsObjects) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(1));
+  XLS_ASSERT_OK(fb.Build().status());
+
+  InterpreterStats zeros;
+  InterpreterStats ones;
+  for (int64 i = 0; i < 10; ++i) {
+    zeros.NoteNodeBits(x.node(), UBits(0, 1));
+    ones.NoteNodeBits(x.node(), UBits(1, 1));
+  }
+  EXPECT_EQ(zeros.GetValueProfile().at(x.node()->id()),
+            TernaryVector{TernaryValue::kKnownZero});
+  EXPECT_EQ(ones.GetValueProfile().at(x.node()->id()),
+            TernaryVector{TernaryValue::kKnownOne});
+}
+
+TEST_F(InterpreterStatsTest, ShortLivedStatsObjects) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(1));
+  XLS_ASSERT_OK(fb.Build().status());
+
+  // Stats objects destroyed while the thread keeps noting into another one
+  // release their shards.
+  InterpreterStats ones;
+  for (int64 i = 0; i < 1000; ++i) {
+    InterpreterStats zeros;
+    zeros.NoteNodeBits(x.node(), UBits(0, 1));
+    ones.NoteNodeBits(x.node(), UBits(1, 1));
+    EXPECT_EQ(zeros.GetValueProfile().at(x.node()->id()),
+              TernaryVector{TernaryValue::kKnownZero});
+  }
+  EXPECT_EQ(ones.GetValueProfile().at(x.node()->id()),
+            TernaryVector{TernaryValue::kKnownOne});
+}
+
+}  // namespace
+}  // namespace xls
@@ -0,0 +1,85 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_INTERPRETER_PROC_EVALUATOR_TEST_H_
+#define XLS_INTERPRETER_PROC_EVALUATOR_TEST_H_
+
+#include <functional>
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "absl/status/statusor.h"
+#include "xls/interpreter/channel_queue.h"
+#include "xls/interpreter/proc_interpreter.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/ir/proc.h"
+
+namespace xls {
+
+// Interface of the evaluators of a single proc (ProcInterpreter, ProcJit)
+// exercised by ProcEvaluatorTest.
+class ProcEvaluator {
+ public:
+  virtual ~ProcEvaluator() = default;
+
+  virtual absl::StatusOr<ProcInterpreter::RunResult>
+  RunIterationUntilCompleteOrBlocked() = 0;
+  virtual bool IsIterationComplete() const = 0;
+};
+
+// Wraps a concrete proc evaluator such as ProcInterpreter or ProcJit in the
+// ProcEvaluator interface.
+template <typename ProcRunnerT>
+class ProcEvaluatorAdapter : public ProcEvaluator {
+ public:
+  explicit ProcEvaluatorAdapter(std::unique_ptr<ProcRunnerT> runner)
+      : runner_(std::move(runner)) {}
+
+  absl::StatusOr<ProcInterpreter::RunResult>
+  RunIterationUntilCompleteOrBlocked() override {
+    return runner_->RunIterationUntilCompleteOrBlocked();
+  }
+  bool IsIterationComplete() const override {
+    return runner_->IsIterationComplete();
+  }
+
+ private:
+  std::unique_ptr<ProcRunnerT> runner_;
+};
+
+// Simple holder struct to contain the per-evaluator data needed to run these
+// tests.
+struct ProcEvaluatorTestParam {
+  // Function which creates an evaluator for the given proc communicating via
+  // the queues of the given manager.
+  using CreateEvaluatorFnT =
+      std::function<absl::StatusOr<std::unique_ptr<ProcEvaluator>>(
+          Proc* proc, ChannelQueueManager* queue_manager)>;
+
+  explicit ProcEvaluatorTestParam(CreateEvaluatorFnT create_evaluator_in)
+      : create_evaluator(std::move(create_evaluator_in)) {}
+
+  CreateEvaluatorFnT create_evaluator;
+};
+
+// Public face of the suite of tests to run against proc evaluators
+// (ProcInterpreter, ProcJit). Users should instantiate with an
+// INSTANTIATE_TEST_SUITE_P macro; see proc_jit_test.cc for an example.
+class ProcEvaluatorTest
+    : public IrTestBase,
+      public testing::WithParamInterface<ProcEvaluatorTestParam> {};
+
+}  // namespace xls
+
+#endif  // XLS_INTERPRETER_PROC_EVALUATOR_TEST_H_
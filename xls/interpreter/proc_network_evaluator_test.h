@@ -0,0 +1,85 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_INTERPRETER_PROC_NETWORK_EVALUATOR_TEST_H_
+#define XLS_INTERPRETER_PROC_NETWORK_EVALUATOR_TEST_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "xls/interpreter/channel_queue.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/ir/package.h"
+
+namespace xls {
+
+// Interface of the evaluators of a network of procs (ProcNetworkInterpreter,
+// ProcNetworkJit) exercised by ProcNetworkEvaluatorTest.
+class ProcNetworkEvaluator {
+ public:
+  virtual ~ProcNetworkEvaluator() = default;
+
+  virtual absl::Status Tick() = 0;
+  virtual ChannelQueueManager& queue_manager() = 0;
+};
+
+// Wraps a concrete proc network evaluator such as ProcNetworkInterpreter or
+// ProcNetworkJit in the ProcNetworkEvaluator interface.
+template <typename ProcNetworkT>
+class ProcNetworkEvaluatorAdapter : public ProcNetworkEvaluator {
+ public:
+  explicit ProcNetworkEvaluatorAdapter(std::unique_ptr<ProcNetworkT> network)
+      : network_(std::move(network)) {}
+
+  absl::Status Tick() override { return network_->Tick(); }
+  ChannelQueueManager& queue_manager() override {
+    return network_->queue_manager();
+  }
+
+ private:
+  std::unique_ptr<ProcNetworkT> network_;
+};
+
+// Simple holder struct to contain the per-evaluator data needed to run these
+// tests.
+struct ProcNetworkEvaluatorTestParam {
+  // Function which creates an evaluator for all procs in the given package.
+  // rx_only_queues contains a queue for each receive-only channel in the
+  // package.
+  using CreateEvaluatorFnT =
+      std::function<absl::StatusOr<std::unique_ptr<ProcNetworkEvaluator>>(
+          Package* package,
+          std::vector<std::unique_ptr<RxOnlyChannelQueue>>&& rx_only_queues)>;
+
+  explicit ProcNetworkEvaluatorTestParam(
+      CreateEvaluatorFnT create_evaluator_in)
+      : create_evaluator(std::move(create_evaluator_in)) {}
+
+  CreateEvaluatorFnT create_evaluator;
+};
+
+// Public face of the suite of tests to run against proc network evaluators
+// (ProcNetworkInterpreter, ProcNetworkJit). Users should instantiate with an
+// INSTANTIATE_TEST_SUITE_P macro; see proc_network_jit_test.cc for an example.
+class ProcNetworkEvaluatorTest
+    : public IrTestBase,
+      public testing::WithParamInterface<ProcNetworkEvaluatorTestParam> {};
+
+}  // namespace xls
+
+#endif  // XLS_INTERPRETER_PROC_NETWORK_EVALUATOR_TEST_H_
@@ -0,0 +1,88 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_INTERPRETER_PROC_NETWORK_TICK_H_
+#define XLS_INTERPRETER_PROC_NETWORK_TICK_H_
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/types/span.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/interpreter/proc_interpreter.h"
+#include "xls/ir/channel.h"
+
+namespace xls {
+
+// Executes (up to) a single iteration of each of the given procs as described
+// in ProcNetworkInterpreter::Tick(). ProcRunnerT is the per-proc evaluator,
+// e.g. ProcInterpreter or ProcJit, and must provide:
+//
+//   absl::StatusOr<ProcInterpreter::RunResult>
+//   RunIterationUntilCompleteOrBlocked();
+//
+// Returns an error if no progress can be made due to a deadlock.
+template <typename ProcRunnerT>
+absl::Status TickProcNetwork(
+    absl::Span<const std::unique_ptr<ProcRunnerT>> procs) {
+  absl::flat_hash_set<ProcRunnerT*> completed_procs;
+  absl::flat_hash_set<Channel*> blocked_channels;
+  bool global_progress_made = false;
+  bool progress_made_this_loop = true;
+  while (progress_made_this_loop) {
+    progress_made_this_loop = false;
+    blocked_channels.clear();
+    for (const std::unique_ptr<ProcRunnerT>& proc : procs) {
+      if (completed_procs.contains(proc.get())) {
+        continue;
+      }
+      XLS_ASSIGN_OR_RETURN(ProcInterpreter::RunResult result,
+                           proc->RunIterationUntilCompleteOrBlocked());
+
+      progress_made_this_loop |= result.progress_made;
+      if (result.iteration_complete) {
+        completed_procs.insert(proc.get());
+      }
+      blocked_channels.insert(result.blocked_channels.begin(),
+                              result.blocked_channels.end());
+    }
+    global_progress_made |= progress_made_this_loop;
+  }
+  if (!global_progress_made) {
+    // Not a single instruction executed on any proc. This is necessarily a
+    // deadlock. Sort blocked channels by channel id so the return message is
+    // stable.
+    std::vector<Channel*> blocked_vec(blocked_channels.begin(),
+                                      blocked_channels.end());
+    std::sort(blocked_vec.begin(), blocked_vec.end(),
+              [](Channel* a, Channel* b) { return a->id() < b->id(); });
+    return absl::InternalError(absl::StrFormat(
+        "Proc network is deadlocked. Blocked channels: %s",
+        absl::StrJoin(blocked_vec, ", ", [](std::string* out, Channel* ch) {
+          return absl::StrAppend(out, ch->name());
+        })));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace xls
+
+#endif  // XLS_INTERPRETER_PROC_NETWORK_TICK_H_
@@ -35,6 +35,17 @@ namespace xls {
   return Bits(std::move(bitmap));
 }
 
+/* static */ Bits Bits::FromWords(absl::Span<const uint64> words,
+                                  int64 bit_count) {
+  XLS_CHECK_GE(bit_count, 0);
+  InlineBitmap bitmap(bit_count);
+  int64 word_count = std::min<int64>(words.size(), bitmap.word_count());
+  for (int64 i = 0; i < word_count; ++i) {
+    bitmap.SetWord(i, words[i]);
+  }
+  return Bits(std::move(bitmap));
+}
+
 /* static */ int64 Bits::MinBitCountSigned(int64 value) {
   if (value == 0) {
     return 0;
@@ -107,18 +118,19 @@ bool Bits::IsOne() const { return PopCount() == 1 && Get(0); }
 
 int64 Bits::PopCount() const {
   int64 count = 0;
-  for (int64 i = 0; i < bit_count(); ++i) {
-    if (Get(i)) {
-      ++count;
-    }
+  for (int64 i = 0; i < bitmap_.word_count(); ++i) {
+    count += __builtin_popcountll(bitmap_.GetWord(i));
   }
   return count;
 }
 
 int64 Bits::CountLeadingZeros() const {
-  for (int64 i = 0; i < bit_count(); ++i) {
-    if (Get(bit_count() - 1 - i)) {
-      return i;
+  // The bits of the last word above bit_count() are zero.
+  for (int64 i = bitmap_.word_count() - 1; i >= 0; --i) {
+    uint64 word = bitmap_.GetWord(i);
+    if (word != 0) {
+      int64 msb_index = i * 64 + 63 - __builtin_clzll(word);
+      return bit_count() - 1 - msb_index;
     }
   }
   return bit_count();
@@ -134,9 +146,10 @@ int64 Bits::CountLeadingOnes() const {
 }
 
 int64 Bits::CountTrailingZeros() const {
-  for (int64 i = 0; i < bit_count(); ++i) {
-    if (Get(i)) {
-      return i;
+  for (int64 i = 0; i < bitmap_.word_count(); ++i) {
+    uint64 word = bitmap_.GetWord(i);
+    if (word != 0) {
+      return i * 64 + __builtin_ctzll(word);
     }
   }
   return bit_count();
@@ -180,8 +193,14 @@ bool Bits::FitsInInt64() const { return FitsInNBitsSigned(64); }
 
 bool Bits::FitsInNBitsUnsigned(int64 n) const {
   // All bits at and above bit 'n' must be zero.
-  for (int64 i = n; i < bit_count(); ++i) {
-    if (Get(i)) {
+  if (n >= bit_count()) {
+    return true;
+  }
+  if ((bitmap_.GetWord(n / 64) >> (n % 64)) != 0) {
+    return false;
+  }
+  for (int64 i = n / 64 + 1; i < bitmap_.word_count(); ++i) {
+    if (bitmap_.GetWord(i) != 0) {
       return false;
     }
   }
@@ -244,10 +263,16 @@ Bits Bits::Slice(int64 start, int64 width) const {
   XLS_CHECK_LE(start + width, bit_count())
       << "start: " << start << " width: " << width;
   Bits result(width);
-  for (int64 i = 0; i < width; ++i) {
-    if (Get(start + i)) {
-      result.bitmap_.Set(i, true);
+  // Assemble each word of the result from the (at most two) source words it
+  // straddles.
+  const int64 shift = start % 64;
+  for (int64 i = 0; i < result.bitmap_.word_count(); ++i) {
+    int64 wordno = start / 64 + i;
+    uint64 word = bitmap_.GetWord(wordno) >> shift;
+    if (shift != 0 && wordno + 1 < bitmap_.word_count()) {
+      word |= bitmap_.GetWord(wordno + 1) << (64 - shift);
     }
+    result.bitmap_.SetWord(i, word);
   }
   return result;
 }
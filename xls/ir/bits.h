@@ -19,6 +19,7 @@
 #include <cmath>
 #include <numeric>
 #include <string>
+#include <utility>
 
 #include "absl/base/casts.h"
 #include "absl/status/statusor.h"
@@ -79,6 +80,12 @@ class Bits {
   // are ignored.
   static Bits FromBytes(absl::Span<const uint8> bytes, int64 bit_count);
 
+  // Constructs a Bits object from a vector of 64-bit words in little endian
+  // order where word zero holds the least significant bits. Words beyond
+  // those given are taken to be zero, and any bits beyond 'bit_count' in
+  // 'words' are ignored.
+  static Bits FromWords(absl::Span<const uint64> words, int64 bit_count);
+
   // Note: we flatten into the pushbuffer with the MSb pushed first.
   void FlattenTo(BitPushBuffer* buffer) const {
     for (int64 i = 0; i < bit_count(); ++i) {
@@ -227,6 +234,11 @@ class Bits {
   bool operator==(const Bits& other) const { return bitmap_ == other.bitmap_; }
   bool operator!=(const Bits& other) const { return !(*this == other); }
 
+  template <typename H>
+  friend H AbslHashValue(H h, const Bits& bits) {
+    return H::combine(std::move(h), bits.bitmap_);
+  }
+
   // Slices a range of bits from the Bits object. 'start' is the first index in
   // the slice. 'start' is zero-indexed with zero being the LSb (same indexing
   // as Get/Set). 'width' is the number of bits to slice out and is the
@@ -273,8 +285,17 @@ class BitsRope {
   //
   // So b.Get(0) is now at result.Get(2).
   void push_back(const Bits& bits) {
-    for (int64 i = 0; i < bits.bit_count(); ++i) {
-      bitmap_.Set(index_ + i, bits.Get(i));
+    // OR each word into place; the bits beyond index_ are still zero.
+    const int64 wordno = index_ / 64;
+    const int64 shift = index_ % 64;
+    for (int64 i = 0; i < bits.bitmap_.word_count(); ++i) {
+      uint64 word = bits.bitmap_.GetWord(i);
+      bitmap_.SetWord(wordno + i,
+                      bitmap_.GetWord(wordno + i) | (word << shift));
+      if (shift != 0 && wordno + i + 1 < bitmap_.word_count()) {
+        bitmap_.SetWord(wordno + i + 1, bitmap_.GetWord(wordno + i + 1) |
+                                            (word >> (64 - shift)));
+      }
     }
     index_ += bits.bit_count();
   }
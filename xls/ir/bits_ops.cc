@@ -14,27 +14,310 @@
 
 #include "xls/ir/bits_ops.h"
 
+#include <algorithm>
+#include <utility>
 #include <vector>
 
+#include "absl/container/inlined_vector.h"
+#include "absl/numeric/int128.h"
 #include "xls/common/logging/logging.h"
-#include "xls/ir/big_int.h"
+#include "xls/common/math_util.h"
 
 namespace xls {
 namespace bits_ops {
 namespace {
 
-// Converts the given bits value to signed value of the given bit count. Uses
-// truncation or sign-extension to narrow/widen the value.
-Bits TruncateOrSignExtend(const Bits& bits, int64 bit_count) {
-  if (bits.bit_count() == bit_count) {
-    return bits;
-  } else if (bits.bit_count() < bit_count) {
-    return SignExtend(bits, bit_count);
-  } else {
-    return bits.Slice(0, bit_count);
+// Operations on operands of up to this many bits are performed on native
+// 128-bit integers.
+constexpr int64 kMaxNativeBitCount = 128;
+
+// Returns the value of the given bits object zero-extended to 128 bits.
+absl::uint128 ToUint128(const Bits& bits) {
+  XLS_DCHECK_LE(bits.bit_count(), kMaxNativeBitCount);
+  uint64 low = bits.WordToUint64(0).value();
+  uint64 high = bits.bit_count() > 64 ? bits.WordToUint64(1).value() : 0;
+  return absl::MakeUint128(high, low);
+}
+
+// Returns the value of the given bits object sign-extended to 128 bits.
+absl::uint128 SignExtendToUint128(const Bits& bits) {
+  absl::uint128 value = ToUint128(bits);
+  if (bits.msb() && bits.bit_count() < 128) {
+    value |= ~absl::uint128(0) << bits.bit_count();
+  }
+  return value;
+}
+
+// Returns the low "bit_count" bits of the given value.
+Bits FromUint128(absl::uint128 value, int64 bit_count) {
+  XLS_DCHECK_LE(bit_count, kMaxNativeBitCount);
+  if (bit_count <= 64) {
+    return UBits(absl::Uint128Low64(value) & Mask(bit_count), bit_count);
+  }
+  BitsRope rope(bit_count);
+  rope.push_back(UBits(absl::Uint128Low64(value), 64));
+  rope.push_back(UBits(absl::Uint128High64(value) & Mask(bit_count - 64),
+                       bit_count - 64));
+  return rope.Build();
+}
+
+// Returns whether both operands can be operated upon natively.
+bool AreNative(const Bits& lhs, const Bits& rhs) {
+  return lhs.bit_count() <= kMaxNativeBitCount &&
+         rhs.bit_count() <= kMaxNativeBitCount;
+}
+
+// The little-endian 64-bit words of a value too wide for native arithmetic.
+// Operations on such values are performed a word at a time.
+using Words = absl::InlinedVector<uint64, 4>;
+
+int64 WordCount(int64 bit_count) { return CeilOfRatio(bit_count, int64{64}); }
+
+// Returns the value of the given bits object as "word_count" words, zero- or
+// sign-extended (or truncated) as necessary.
+Words ToWords(const Bits& bits, int64 word_count, bool sign_extend = false) {
+  const bool fill = sign_extend && bits.msb();
+  Words words(word_count, fill ? -1ULL : 0);
+  const int64 bits_word_count = WordCount(bits.bit_count());
+  for (int64 i = 0; i < std::min(word_count, bits_word_count); ++i) {
+    words[i] = bits.WordToUint64(i).value();
+  }
+  const int64 remainder = bits.bit_count() % 64;
+  if (fill && remainder != 0 && bits_word_count <= word_count) {
+    words[bits_word_count - 1] |= ~Mask(remainder);
+  }
+  return words;
+}
+
+// Adds "src" into "dst", which must be at least as long, and returns the
+// carry out of the most significant word.
+uint64 AddInto(absl::Span<uint64> dst, absl::Span<const uint64> src) {
+  uint64 carry = 0;
+  for (int64 i = 0; i < dst.size(); ++i) {
+    if (i >= src.size() && carry == 0) {
+      break;
+    }
+    absl::uint128 sum =
+        absl::uint128(dst[i]) + (i < src.size() ? src[i] : 0) + carry;
+    dst[i] = absl::Uint128Low64(sum);
+    carry = absl::Uint128High64(sum);
+  }
+  return carry;
+}
+
+// Subtracts "src" from "dst", which must be at least as long, and returns the
+// borrow out of the most significant word.
+uint64 SubtractFrom(absl::Span<uint64> dst, absl::Span<const uint64> src) {
+  uint64 borrow = 0;
+  for (int64 i = 0; i < dst.size(); ++i) {
+    if (i >= src.size() && borrow == 0) {
+      break;
+    }
+    uint64 subtrahend = i < src.size() ? src[i] : 0;
+    uint64 difference = dst[i] - subtrahend - borrow;
+    borrow = dst[i] < subtrahend || (dst[i] == subtrahend && borrow != 0);
+    dst[i] = difference;
+  }
+  return borrow;
+}
+
+// Negates the two's complement value in place.
+void NegateWords(absl::Span<uint64> words) {
+  uint64 carry = 1;
+  for (uint64& word : words) {
+    absl::uint128 sum = absl::uint128(~word) + carry;
+    word = absl::Uint128Low64(sum);
+    carry = absl::Uint128High64(sum);
+  }
+}
+
+// Operands of at least this many words are multiplied with Karatsuba's
+// algorithm rather than schoolbook multiplication.
+constexpr int64 kKaratsubaThresholdWords = 32;
+
+// Adds the product of "a" and "b" into "result", which has a.size() + b.size()
+// words and is zero on entry.
+void MultiplyWords(absl::Span<const uint64> a, absl::Span<const uint64> b,
+                   absl::Span<uint64> result) {
+  XLS_DCHECK_EQ(result.size(), a.size() + b.size());
+  if (a.size() != b.size() || a.size() < kKaratsubaThresholdWords) {
+    for (int64 i = 0; i < a.size(); ++i) {
+      uint64 carry = 0;
+      for (int64 j = 0; j < b.size(); ++j) {
+        // Cannot overflow: (2^64 - 1)^2 + 2 * (2^64 - 1) == 2^128 - 1.
+        absl::uint128 product =
+            absl::uint128(a[i]) * b[j] + result[i + j] + carry;
+        result[i + j] = absl::Uint128Low64(product);
+        carry = absl::Uint128High64(product);
+      }
+      result[i + b.size()] = carry;
+    }
+    return;
+  }
+
+  // With a = a1 * B^h + a0 and b = b1 * B^h + b0 the product is
+  //   z2 * B^2h + z1 * B^h + z0
+  // where z2 = a1 * b1, z0 = a0 * b0 and z1 = (a0 + a1) * (b0 + b1) - z2 - z0.
+  const int64 n = a.size();
+  const int64 h = n / 2;
+  MultiplyWords(a.subspan(0, h), b.subspan(0, h), result.subspan(0, 2 * h));
+  MultiplyWords(a.subspan(h), b.subspan(h), result.subspan(2 * h));
+  Words a_sum(a.begin() + h, a.end());
+  Words b_sum(b.begin() + h, b.end());
+  a_sum.push_back(AddInto(absl::MakeSpan(a_sum).subspan(0, n - h),
+                          a.subspan(0, h)));
+  b_sum.push_back(AddInto(absl::MakeSpan(b_sum).subspan(0, n - h),
+                          b.subspan(0, h)));
+  Words z1(2 * (n - h + 1), 0);
+  MultiplyWords(a_sum, b_sum, absl::MakeSpan(z1));
+  SubtractFrom(absl::MakeSpan(z1), result.subspan(0, 2 * h));
+  SubtractFrom(absl::MakeSpan(z1), result.subspan(2 * h));
+  // z1 is less than B^(2n - h) so its top words are zero.
+  while (z1.size() > result.size() - h) {
+    XLS_DCHECK_EQ(z1.back(), 0);
+    z1.pop_back();
+  }
+  AddInto(result.subspan(h), z1);
+}
+
+// Divides "dividend" by the nonzero "divisor" using Knuth's Algorithm D (The
+// Art of Computer Programming Vol. 2, Section 4.3.1) on 32-bit digits. Returns
+// the quotient and remainder with as many words as the dividend and divisor
+// respectively.
+std::pair<Words, Words> DivideWords(absl::Span<const uint64> dividend,
+                                    absl::Span<const uint64> divisor) {
+  auto to_digits = [](absl::Span<const uint64> words) {
+    std::vector<uint32> digits;
+    for (uint64 word : words) {
+      digits.push_back(static_cast<uint32>(word));
+      digits.push_back(static_cast<uint32>(word >> 32));
+    }
+    while (!digits.empty() && digits.back() == 0) {
+      digits.pop_back();
+    }
+    return digits;
+  };
+  auto to_words = [](absl::Span<const uint32> digits, int64 word_count) {
+    Words words(word_count, 0);
+    for (int64 i = 0; i < digits.size(); ++i) {
+      words[i / 2] |= static_cast<uint64>(digits[i]) << (32 * (i % 2));
+    }
+    return words;
+  };
+  const std::vector<uint32> u = to_digits(dividend);
+  const std::vector<uint32> v = to_digits(divisor);
+  const int64 m = u.size();
+  const int64 n = v.size();
+  XLS_CHECK_GT(n, 0) << "Division by zero";
+  if (m < n) {
+    return {Words(dividend.size(), 0), to_words(u, divisor.size())};
+  }
+
+  std::vector<uint32> q(m - n + 1, 0);
+  if (n == 1) {
+    uint64 remainder = 0;
+    for (int64 j = m - 1; j >= 0; --j) {
+      uint64 current = (remainder << 32) | u[j];
+      q[j] = current / v[0];
+      remainder = current % v[0];
+    }
+    return {to_words(q, dividend.size()),
+            to_words({static_cast<uint32>(remainder)}, divisor.size())};
+  }
+
+  // Normalize so the most significant digit of the divisor has its most
+  // significant bit set, which bounds the error of the quotient digit
+  // estimates below.
+  const int s = __builtin_clz(v[n - 1]);
+  std::vector<uint32> vn(n);
+  for (int64 i = n - 1; i > 0; --i) {
+    vn[i] = (v[i] << s) | (static_cast<uint64>(v[i - 1]) >> (32 - s));
+  }
+  vn[0] = v[0] << s;
+  std::vector<uint32> un(m + 1);
+  un[m] = static_cast<uint64>(u[m - 1]) >> (32 - s);
+  for (int64 i = m - 1; i > 0; --i) {
+    un[i] = (u[i] << s) | (static_cast<uint64>(u[i - 1]) >> (32 - s));
+  }
+  un[0] = u[0] << s;
+
+  constexpr uint64 kBase = 1ULL << 32;
+  for (int64 j = m - n; j >= 0; --j) {
+    // Estimate the quotient digit from the top two digits of the remainder;
+    // the estimate is at most two too large.
+    uint64 numerator = (static_cast<uint64>(un[j + n]) << 32) | un[j + n - 1];
+    uint64 qhat = numerator / vn[n - 1];
+    uint64 rhat = numerator % vn[n - 1];
+    while (qhat >= kBase ||
+           qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])) {
+      --qhat;
+      rhat += vn[n - 1];
+      if (rhat >= kBase) {
+        break;
+      }
+    }
+
+    // Multiply and subtract.
+    int64 borrow = 0;
+    int64 t;
+    for (int64 i = 0; i < n; ++i) {
+      uint64 product = qhat * vn[i];
+      t = un[i + j] - borrow - static_cast<int64>(product & 0xffffffff);
+      un[i + j] = static_cast<uint32>(t);
+      borrow = static_cast<int64>(product >> 32) - (t >> 32);
+    }
+    t = un[j + n] - borrow;
+    un[j + n] = static_cast<uint32>(t);
+
+    q[j] = qhat;
+    if (t < 0) {
+      // The estimate was one too large; add the divisor back.
+      --q[j];
+      uint64 carry = 0;
+      for (int64 i = 0; i < n; ++i) {
+        uint64 sum = static_cast<uint64>(un[i + j]) + vn[i] + carry;
+        un[i + j] = static_cast<uint32>(sum);
+        carry = sum >> 32;
+      }
+      un[j + n] += carry;
+    }
+  }
+
+  // Denormalize the remainder.
+  std::vector<uint32> r(n);
+  for (int64 i = 0; i < n; ++i) {
+    r[i] = (un[i] >> s) | static_cast<uint32>(
+                              static_cast<uint64>(un[i + 1]) << (32 - s));
+  }
+  return {to_words(q, dividend.size()), to_words(r, divisor.size())};
+}
+
+// Returns -1, 0 or 1 as "lhs" is less than, equal to or greater than "rhs",
+// interpreted as unsigned or two's complement values.
+int64 Compare(const Bits& lhs, const Bits& rhs, bool is_signed) {
+  const int64 word_count =
+      std::max(WordCount(lhs.bit_count()), WordCount(rhs.bit_count()));
+  if (word_count == 0) {
+    return 0;
+  }
+  Words lhs_words = ToWords(lhs, word_count, /*sign_extend=*/is_signed);
+  Words rhs_words = ToWords(rhs, word_count, /*sign_extend=*/is_signed);
+  if (is_signed && lhs.msb() != rhs.msb()) {
+    return lhs.msb() ? -1 : 1;
   }
+  // Values of the same sign compare the same as unsigned values.
+  for (int64 i = word_count - 1; i >= 0; --i) {
+    if (lhs_words[i] != rhs_words[i]) {
+      return lhs_words[i] < rhs_words[i] ? -1 : 1;
+    }
+  }
+  return 0;
 }
 
+// Returns the magnitude of the two's complement value as an unsigned value of
+// the same width.
+Bits Magnitude(const Bits& bits) { return bits.msb() ? Negate(bits) : bits; }
+
 }  // namespace
 
 Bits And(const Bits& lhs, const Bits& rhs) {
@@ -43,12 +326,16 @@ Bits And(const Bits& lhs, const Bits& rhs) {
     return UBits(lhs.ToUint64().value() & rhs.ToUint64().value(),
                  lhs.bit_count());
   }
-  std::vector<uint8> bytes = lhs.ToBytes();
-  std::vector<uint8> rhs_bytes = rhs.ToBytes();
-  for (int64 i = 0; i < bytes.size(); ++i) {
-    bytes[i] = bytes[i] & rhs_bytes[i];
+  if (lhs.bit_count() <= kMaxNativeBitCount) {
+    return FromUint128(ToUint128(lhs) & ToUint128(rhs), lhs.bit_count());
   }
-  return Bits::FromBytes(bytes, lhs.bit_count());
+  const int64 word_count = WordCount(lhs.bit_count());
+  Words lhs_words = ToWords(lhs, word_count);
+  Words rhs_words = ToWords(rhs, word_count);
+  for (int64 i = 0; i < word_count; ++i) {
+    lhs_words[i] = lhs_words[i] & rhs_words[i];
+  }
+  return Bits::FromWords(lhs_words, lhs.bit_count());
 }
 
 Bits NaryAnd(absl::Span<const Bits> operands) {
@@ -67,12 +354,16 @@ Bits Or(const Bits& lhs, const Bits& rhs) {
     uint64 result = (lhs_int | rhs_int);
     return UBits(result, lhs.bit_count());
   }
-  std::vector<uint8> bytes = lhs.ToBytes();
-  std::vector<uint8> rhs_bytes = rhs.ToBytes();
-  for (int64 i = 0; i < bytes.size(); ++i) {
-    bytes[i] = bytes[i] | rhs_bytes[i];
+  if (lhs.bit_count() <= kMaxNativeBitCount) {
+    return FromUint128(ToUint128(lhs) | ToUint128(rhs), lhs.bit_count());
+  }
+  const int64 word_count = WordCount(lhs.bit_count());
+  Words lhs_words = ToWords(lhs, word_count);
+  Words rhs_words = ToWords(rhs, word_count);
+  for (int64 i = 0; i < word_count; ++i) {
+    lhs_words[i] = lhs_words[i] | rhs_words[i];
   }
-  return Bits::FromBytes(bytes, lhs.bit_count());
+  return Bits::FromWords(lhs_words, lhs.bit_count());
 }
 
 Bits NaryOr(absl::Span<const Bits> operands) {
@@ -91,12 +382,16 @@ Bits Xor(const Bits& lhs, const Bits& rhs) {
     uint64 result = (lhs_int ^ rhs_int);
     return UBits(result, lhs.bit_count());
   }
-  std::vector<uint8> bytes = lhs.ToBytes();
-  std::vector<uint8> rhs_bytes = rhs.ToBytes();
-  for (int64 i = 0; i < bytes.size(); ++i) {
-    bytes[i] = bytes[i] ^ rhs_bytes[i];
+  if (lhs.bit_count() <= kMaxNativeBitCount) {
+    return FromUint128(ToUint128(lhs) ^ ToUint128(rhs), lhs.bit_count());
   }
-  return Bits::FromBytes(bytes, lhs.bit_count());
+  const int64 word_count = WordCount(lhs.bit_count());
+  Words lhs_words = ToWords(lhs, word_count);
+  Words rhs_words = ToWords(rhs, word_count);
+  for (int64 i = 0; i < word_count; ++i) {
+    lhs_words[i] = lhs_words[i] ^ rhs_words[i];
+  }
+  return Bits::FromWords(lhs_words, lhs.bit_count());
 }
 
 Bits NaryXor(absl::Span<const Bits> operands) {
@@ -114,12 +409,16 @@ Bits Nand(const Bits& lhs, const Bits& rhs) {
                      Mask(lhs.bit_count()),
                  lhs.bit_count());
   }
-  std::vector<uint8> bytes = lhs.ToBytes();
-  std::vector<uint8> rhs_bytes = rhs.ToBytes();
-  for (int64 i = 0; i < bytes.size(); ++i) {
-    bytes[i] = ~(bytes[i] & rhs_bytes[i]);
+  if (lhs.bit_count() <= kMaxNativeBitCount) {
+    return FromUint128(~(ToUint128(lhs) & ToUint128(rhs)), lhs.bit_count());
+  }
+  const int64 word_count = WordCount(lhs.bit_count());
+  Words lhs_words = ToWords(lhs, word_count);
+  Words rhs_words = ToWords(rhs, word_count);
+  for (int64 i = 0; i < word_count; ++i) {
+    lhs_words[i] = ~(lhs_words[i] & rhs_words[i]);
   }
-  return Bits::FromBytes(bytes, lhs.bit_count());
+  return Bits::FromWords(lhs_words, lhs.bit_count());
 }
 
 Bits NaryNand(absl::Span<const Bits> operands) {
@@ -137,12 +436,16 @@ Bits Nor(const Bits& lhs, const Bits& rhs) {
                      Mask(lhs.bit_count()),
                  lhs.bit_count());
   }
-  std::vector<uint8> bytes = lhs.ToBytes();
-  std::vector<uint8> rhs_bytes = rhs.ToBytes();
-  for (int64 i = 0; i < bytes.size(); ++i) {
-    bytes[i] = ~(bytes[i] | rhs_bytes[i]);
+  if (lhs.bit_count() <= kMaxNativeBitCount) {
+    return FromUint128(~(ToUint128(lhs) | ToUint128(rhs)), lhs.bit_count());
   }
-  return Bits::FromBytes(bytes, lhs.bit_count());
+  const int64 word_count = WordCount(lhs.bit_count());
+  Words lhs_words = ToWords(lhs, word_count);
+  Words rhs_words = ToWords(rhs, word_count);
+  for (int64 i = 0; i < word_count; ++i) {
+    lhs_words[i] = ~(lhs_words[i] | rhs_words[i]);
+  }
+  return Bits::FromWords(lhs_words, lhs.bit_count());
 }
 
 Bits NaryNor(absl::Span<const Bits> operands) {
@@ -158,11 +461,14 @@ Bits Not(const Bits& bits) {
     return UBits((~bits.ToUint64().value()) & Mask(bits.bit_count()),
                  bits.bit_count());
   }
-  std::vector<uint8> bytes = bits.ToBytes();
-  for (uint8& byte : bytes) {
-    byte = ~byte;
+  if (bits.bit_count() <= kMaxNativeBitCount) {
+    return FromUint128(~ToUint128(bits), bits.bit_count());
+  }
+  Words words = ToWords(bits, WordCount(bits.bit_count()));
+  for (uint64& word : words) {
+    word = ~word;
   }
-  return Bits::FromBytes(bytes, bits.bit_count());
+  return Bits::FromWords(words, bits.bit_count());
 }
 
 Bits AndReduce(const Bits& operand) {
@@ -188,10 +494,13 @@ Bits Add(const Bits& lhs, const Bits& rhs) {
     uint64 result = (lhs_int + rhs_int) & Mask(lhs.bit_count());
     return UBits(result, lhs.bit_count());
   }
-
-  Bits sum = BigInt::Add(BigInt::MakeSigned(lhs), BigInt::MakeSigned(rhs))
-                 .ToSignedBits();
-  return TruncateOrSignExtend(sum, lhs.bit_count());
+  if (lhs.bit_count() <= kMaxNativeBitCount) {
+    return FromUint128(ToUint128(lhs) + ToUint128(rhs), lhs.bit_count());
+  }
+  const int64 word_count = WordCount(lhs.bit_count());
+  Words sum = ToWords(lhs, word_count);
+  AddInto(absl::MakeSpan(sum), ToWords(rhs, word_count));
+  return Bits::FromWords(sum, lhs.bit_count());
 }
 
 Bits Sub(const Bits& lhs, const Bits& rhs) {
@@ -202,9 +511,13 @@ Bits Sub(const Bits& lhs, const Bits& rhs) {
     uint64 result = (lhs_int - rhs_int) & Mask(lhs.bit_count());
     return UBits(result, lhs.bit_count());
   }
-  Bits diff = BigInt::Sub(BigInt::MakeSigned(lhs), BigInt::MakeSigned(rhs))
-                  .ToSignedBits();
-  return TruncateOrSignExtend(diff, lhs.bit_count());
+  if (lhs.bit_count() <= kMaxNativeBitCount) {
+    return FromUint128(ToUint128(lhs) - ToUint128(rhs), lhs.bit_count());
+  }
+  const int64 word_count = WordCount(lhs.bit_count());
+  Words difference = ToWords(lhs, word_count);
+  SubtractFrom(absl::MakeSpan(difference), ToWords(rhs, word_count));
+  return Bits::FromWords(difference, lhs.bit_count());
 }
 
 Bits Mul(const Bits& lhs, const Bits& rhs) {
@@ -216,12 +529,8 @@ Bits Mul(const Bits& lhs, const Bits& rhs) {
     return UBits(result, lhs.bit_count());
   }
 
-  BigInt product =
-      BigInt::Mul(BigInt::MakeSigned(SignExtend(lhs, lhs.bit_count())),
-                  BigInt::MakeSigned(SignExtend(rhs, lhs.bit_count())));
-  return product.ToSignedBitsWithBitCount(lhs.bit_count() * 2)
-      .value()
-      .Slice(0, lhs.bit_count());
+  // The low half of the product is the same signed or unsigned.
+  return UMul(lhs, rhs).Slice(0, lhs.bit_count());
 }
 
 Bits SMul(const Bits& lhs, const Bits& rhs) {
@@ -232,10 +541,16 @@ Bits SMul(const Bits& lhs, const Bits& rhs) {
     int64 result = lhs_int * rhs_int;
     return SBits(result, result_width);
   }
+  if (result_width <= kMaxNativeBitCount) {
+    // The product fits in the result width so the modular product is exact.
+    return FromUint128(SignExtendToUint128(lhs) * SignExtendToUint128(rhs),
+                       result_width);
+  }
 
-  BigInt product =
-      BigInt::Mul(BigInt::MakeSigned(lhs), BigInt::MakeSigned(rhs));
-  return product.ToSignedBitsWithBitCount(result_width).value();
+  // Multiply the magnitudes; the magnitude of the product fits in the result
+  // width.
+  Bits product = UMul(Magnitude(lhs), Magnitude(rhs));
+  return lhs.msb() != rhs.msb() ? Negate(product) : product;
 }
 
 Bits UMul(const Bits& lhs, const Bits& rhs) {
@@ -246,10 +561,15 @@ Bits UMul(const Bits& lhs, const Bits& rhs) {
     uint64 result = lhs_int * rhs_int;
     return UBits(result, result_width);
   }
+  if (result_width <= kMaxNativeBitCount) {
+    return FromUint128(ToUint128(lhs) * ToUint128(rhs), result_width);
+  }
 
-  BigInt product =
-      BigInt::Mul(BigInt::MakeUnsigned(lhs), BigInt::MakeUnsigned(rhs));
-  return product.ToUnsignedBitsWithBitCount(result_width).value();
+  Words lhs_words = ToWords(lhs, WordCount(lhs.bit_count()));
+  Words rhs_words = ToWords(rhs, WordCount(rhs.bit_count()));
+  Words product(lhs_words.size() + rhs_words.size(), 0);
+  MultiplyWords(lhs_words, rhs_words, absl::MakeSpan(product));
+  return Bits::FromWords(product, result_width);
 }
 
 Bits UDiv(const Bits& lhs, const Bits& rhs) {
@@ -257,9 +577,13 @@ Bits UDiv(const Bits& lhs, const Bits& rhs) {
   if (rhs.IsZero()) {
     return Bits::AllOnes(lhs.bit_count());
   }
-  BigInt quotient =
-      BigInt::Div(BigInt::MakeUnsigned(lhs), BigInt::MakeUnsigned(rhs));
-  return ZeroExtend(quotient.ToUnsignedBits(), lhs.bit_count());
+  if (lhs.bit_count() <= kMaxNativeBitCount) {
+    return FromUint128(ToUint128(lhs) / ToUint128(rhs), lhs.bit_count());
+  }
+  const int64 word_count = WordCount(lhs.bit_count());
+  return Bits::FromWords(
+      DivideWords(ToWords(lhs, word_count), ToWords(rhs, word_count)).first,
+      lhs.bit_count());
 }
 
 Bits UMod(const Bits& lhs, const Bits& rhs) {
@@ -267,9 +591,13 @@ Bits UMod(const Bits& lhs, const Bits& rhs) {
   if (rhs.IsZero()) {
     return Bits(lhs.bit_count());
   }
-  BigInt modulo =
-      BigInt::Mod(BigInt::MakeUnsigned(lhs), BigInt::MakeUnsigned(rhs));
-  return ZeroExtend(modulo.ToUnsignedBits(), lhs.bit_count());
+  if (lhs.bit_count() <= kMaxNativeBitCount) {
+    return FromUint128(ToUint128(lhs) % ToUint128(rhs), lhs.bit_count());
+  }
+  const int64 word_count = WordCount(lhs.bit_count());
+  return Bits::FromWords(
+      DivideWords(ToWords(lhs, word_count), ToWords(rhs, word_count)).second,
+      lhs.bit_count());
 }
 
 Bits SDiv(const Bits& lhs, const Bits& rhs) {
@@ -288,9 +616,17 @@ Bits SDiv(const Bits& lhs, const Bits& rhs) {
       return ZeroExtend(Bits::AllOnes(lhs.bit_count() - 1), lhs.bit_count());
     }
   }
-  BigInt quotient =
-      BigInt::Div(BigInt::MakeSigned(lhs), BigInt::MakeSigned(rhs));
-  return TruncateOrSignExtend(quotient.ToSignedBits(), lhs.bit_count());
+  if (lhs.bit_count() <= 64) {
+    // In 128 bits the quotient of the most negative value and -1 does not
+    // overflow.
+    absl::int128 quotient = absl::int128(lhs.ToInt64().value()) /
+                            absl::int128(rhs.ToInt64().value());
+    return FromUint128(absl::uint128(quotient), lhs.bit_count());
+  }
+  // Divide the magnitudes. The quotient of the most negative value and -1
+  // wraps around to the most negative value.
+  Bits quotient = UDiv(Magnitude(lhs), Magnitude(rhs));
+  return lhs.msb() != rhs.msb() ? Negate(quotient) : quotient;
 }
 
 Bits SMod(const Bits& lhs, const Bits& rhs) {
@@ -298,12 +634,20 @@ Bits SMod(const Bits& lhs, const Bits& rhs) {
   if (rhs.IsZero()) {
     return Bits(lhs.bit_count());
   }
-  BigInt modulo = BigInt::Mod(BigInt::MakeSigned(lhs), BigInt::MakeSigned(rhs));
-  return TruncateOrSignExtend(modulo.ToSignedBits(), lhs.bit_count());
+  if (lhs.bit_count() <= 64) {
+    absl::int128 modulo = absl::int128(lhs.ToInt64().value()) %
+                          absl::int128(rhs.ToInt64().value());
+    return FromUint128(absl::uint128(modulo), lhs.bit_count());
+  }
+  Bits modulo = UMod(Magnitude(lhs), Magnitude(rhs));
+  return lhs.msb() ? Negate(modulo) : modulo;
 }
 
 bool UEqual(const Bits& lhs, const Bits& rhs) {
-  return BigInt::MakeUnsigned(lhs) == BigInt::MakeUnsigned(rhs);
+  if (AreNative(lhs, rhs)) {
+    return ToUint128(lhs) == ToUint128(rhs);
+  }
+  return Compare(lhs, rhs, /*is_signed=*/false) == 0;
 }
 
 bool UEqual(const Bits& lhs, int64 rhs) {
@@ -320,12 +664,17 @@ bool UGreaterThan(const Bits& lhs, const Bits& rhs) {
 }
 
 bool ULessThanOrEqual(const Bits& lhs, const Bits& rhs) {
-  return UEqual(lhs, rhs) ||
-         BigInt::LessThan(BigInt::MakeUnsigned(lhs), BigInt::MakeUnsigned(rhs));
+  if (AreNative(lhs, rhs)) {
+    return ToUint128(lhs) <= ToUint128(rhs);
+  }
+  return Compare(lhs, rhs, /*is_signed=*/false) <= 0;
 }
 
 bool ULessThan(const Bits& lhs, const Bits& rhs) {
-  return BigInt::LessThan(BigInt::MakeUnsigned(lhs), BigInt::MakeUnsigned(rhs));
+  if (AreNative(lhs, rhs)) {
+    return ToUint128(lhs) < ToUint128(rhs);
+  }
+  return Compare(lhs, rhs, /*is_signed=*/false) < 0;
 }
 
 bool UGreaterThanOrEqual(const Bits& lhs, int64 rhs) {
@@ -349,7 +698,10 @@ bool ULessThan(const Bits& lhs, int64 rhs) {
 }
 
 bool SEqual(const Bits& lhs, const Bits& rhs) {
-  return BigInt::MakeSigned(lhs) == BigInt::MakeSigned(rhs);
+  if (AreNative(lhs, rhs)) {
+    return SignExtendToUint128(lhs) == SignExtendToUint128(rhs);
+  }
+  return Compare(lhs, rhs, /*is_signed=*/true) == 0;
 }
 
 bool SEqual(const Bits& lhs, int64 rhs) { return SEqual(lhs, SBits(rhs, 64)); }
@@ -370,7 +722,13 @@ bool SLessThan(const Bits& lhs, const Bits& rhs) {
   if (lhs.bit_count() <= 64 && rhs.bit_count() <= 64) {
     return lhs.ToInt64().value() < rhs.ToInt64().value();
   }
-  return BigInt::LessThan(BigInt::MakeSigned(lhs), BigInt::MakeSigned(rhs));
+  if (AreNative(lhs, rhs)) {
+    // Flipping the sign bits maps two's complement order to unsigned order.
+    const absl::uint128 kSignBit = absl::MakeUint128(1ULL << 63, 0);
+    return (SignExtendToUint128(lhs) ^ kSignBit) <
+           (SignExtendToUint128(rhs) ^ kSignBit);
+  }
+  return Compare(lhs, rhs, /*is_signed=*/true) < 0;
 }
 
 bool SGreaterThanOrEqual(const Bits& lhs, int64 rhs) {
@@ -392,12 +750,18 @@ bool SLessThan(const Bits& lhs, int64 rhs) {
 Bits ZeroExtend(const Bits& bits, int64 new_bit_count) {
   XLS_CHECK_GE(new_bit_count, 0);
   XLS_CHECK_GE(new_bit_count, bits.bit_count());
+  if (new_bit_count <= 64) {
+    return UBits(bits.ToUint64().value(), new_bit_count);
+  }
   return Concat({UBits(0, new_bit_count - bits.bit_count()), bits});
 }
 
 Bits SignExtend(const Bits& bits, int64 new_bit_count) {
   XLS_CHECK_GE(new_bit_count, 0);
   XLS_CHECK_GE(new_bit_count, bits.bit_count());
+  if (new_bit_count <= 64) {
+    return SBits(bits.ToInt64().value(), new_bit_count);
+  }
   const int64 ext_width = new_bit_count - bits.bit_count();
   return Concat(
       {bits.msb() ? Bits::AllOnes(ext_width) : Bits(ext_width), bits});
@@ -422,13 +786,22 @@ Bits Negate(const Bits& bits) {
     return UBits((-bits.ToInt64().value()) & Mask(bits.bit_count()),
                  bits.bit_count());
   }
-  Bits negated = BigInt::Negate(BigInt::MakeSigned(bits)).ToSignedBits();
-  return TruncateOrSignExtend(negated, bits.bit_count());
+  if (bits.bit_count() <= kMaxNativeBitCount) {
+    return FromUint128(-ToUint128(bits), bits.bit_count());
+  }
+  Words words = ToWords(bits, WordCount(bits.bit_count()));
+  NegateWords(absl::MakeSpan(words));
+  return Bits::FromWords(words, bits.bit_count());
 }
 
 Bits ShiftLeftLogical(const Bits& bits, int64 shift_amount) {
   XLS_CHECK_GE(shift_amount, 0);
   shift_amount = std::min(shift_amount, bits.bit_count());
+  if (bits.bit_count() <= 64) {
+    uint64 value = shift_amount == 64 ? 0
+                                      : bits.ToUint64().value() << shift_amount;
+    return UBits(value & Mask(bits.bit_count()), bits.bit_count());
+  }
   return Concat(
       {bits.Slice(0, bits.bit_count() - shift_amount), UBits(0, shift_amount)});
 }
@@ -436,6 +809,11 @@ Bits ShiftLeftLogical(const Bits& bits, int64 shift_amount) {
 Bits ShiftRightLogical(const Bits& bits, int64 shift_amount) {
   XLS_CHECK_GE(shift_amount, 0);
   shift_amount = std::min(shift_amount, bits.bit_count());
+  if (bits.bit_count() <= 64) {
+    uint64 value = shift_amount == 64 ? 0
+                                      : bits.ToUint64().value() >> shift_amount;
+    return UBits(value, bits.bit_count());
+  }
   return Concat({UBits(0, shift_amount),
                  bits.Slice(shift_amount, bits.bit_count() - shift_amount)});
 }
@@ -443,6 +821,11 @@ Bits ShiftRightLogical(const Bits& bits, int64 shift_amount) {
 Bits ShiftRightArith(const Bits& bits, int64 shift_amount) {
   XLS_CHECK_GE(shift_amount, 0);
   shift_amount = std::min(shift_amount, bits.bit_count());
+  if (bits.bit_count() <= 64) {
+    // The arithmetic shift of the sign-extended value fits in the width.
+    int64 value = bits.ToInt64().value() >> std::min(shift_amount, int64{63});
+    return SBits(value, bits.bit_count());
+  }
   return Concat(
       {bits.msb() ? Bits::AllOnes(shift_amount) : UBits(0, shift_amount),
        bits.Slice(shift_amount, bits.bit_count() - shift_amount)});
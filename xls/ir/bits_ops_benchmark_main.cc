@@ -0,0 +1,189 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/integral_types.h"
+#include "xls/common/logging/logging.h"
+#include "xls/ir/bits.h"
+#include "xls/ir/bits_ops.h"
+
+const char* kUsage = R"(
+Times the operations in bits_ops on random operands of a range of widths and
+prints the average time per operation in nanoseconds. Usage:
+
+   bits_ops_benchmark_main
+   bits_ops_benchmark_main --widths=8,64,128 --min_run_time=100ms
+)";
+
+ABSL_FLAG(std::vector<std::string>, widths,
+          std::vector<std::string>(
+              {"1", "8", "32", "64", "65", "100", "128", "256", "1024",
+               "4096"}),
+          "Comma-separated list of operand widths to benchmark.");
+ABSL_FLAG(int64, operand_sets, 256,
+          "Number of pairs of random operands to cycle through.");
+ABSL_FLAG(absl::Duration, min_run_time, absl::Milliseconds(50),
+          "Minimum time to run each operation for at each width.");
+
+namespace xls {
+namespace {
+
+struct Operation {
+  std::string name;
+  std::function<Bits(const Bits&, const Bits&)> run;
+};
+
+std::vector<Operation> GetOperations() {
+  return {
+      {"and", [](const Bits& a, const Bits& b) { return bits_ops::And(a, b); }},
+      {"not", [](const Bits& a, const Bits& b) { return bits_ops::Not(a); }},
+      {"add", [](const Bits& a, const Bits& b) { return bits_ops::Add(a, b); }},
+      {"sub", [](const Bits& a, const Bits& b) { return bits_ops::Sub(a, b); }},
+      {"umul",
+       [](const Bits& a, const Bits& b) { return bits_ops::UMul(a, b); }},
+      {"smul",
+       [](const Bits& a, const Bits& b) { return bits_ops::SMul(a, b); }},
+      {"udiv",
+       [](const Bits& a, const Bits& b) { return bits_ops::UDiv(a, b); }},
+      {"sdiv",
+       [](const Bits& a, const Bits& b) { return bits_ops::SDiv(a, b); }},
+      {"umod",
+       [](const Bits& a, const Bits& b) { return bits_ops::UMod(a, b); }},
+      {"udiv_half",
+       [](const Bits& a, const Bits& b) {
+         // A divisor of half the width, giving a quotient of many digits.
+         return bits_ops::UDiv(
+             a, bits_ops::ShiftRightLogical(b, b.bit_count() / 2));
+       }},
+      {"ult",
+       [](const Bits& a, const Bits& b) {
+         return UBits(bits_ops::ULessThan(a, b), 1);
+       }},
+      {"slt",
+       [](const Bits& a, const Bits& b) {
+         return UBits(bits_ops::SLessThan(a, b), 1);
+       }},
+      {"eq",
+       [](const Bits& a, const Bits& b) {
+         return UBits(bits_ops::UEqual(a, b), 1);
+       }},
+      {"concat",
+       [](const Bits& a, const Bits& b) { return bits_ops::Concat({a, b}); }},
+      {"slice",
+       [](const Bits& a, const Bits& b) {
+         return a.Slice(a.bit_count() / 4, a.bit_count() / 2);
+       }},
+      {"shll",
+       [](const Bits& a, const Bits& b) {
+         return bits_ops::ShiftLeftLogical(a, a.bit_count() / 3);
+       }},
+      {"shra",
+       [](const Bits& a, const Bits& b) {
+         return bits_ops::ShiftRightArith(a, a.bit_count() / 3);
+       }},
+      {"sign_ext",
+       [](const Bits& a, const Bits& b) {
+         return bits_ops::SignExtend(a, a.bit_count() + 7);
+       }},
+  };
+}
+
+Bits RandomBits(int64 bit_count, std::minstd_rand* engine) {
+  std::uniform_int_distribution<int> distribution(0, 255);
+  std::vector<uint8> bytes(CeilOfRatio(bit_count, int64{8}));
+  for (uint8& byte : bytes) {
+    byte = distribution(*engine);
+  }
+  return Bits::FromBytes(bytes, bit_count);
+}
+
+// Returns the average time in nanoseconds of the operation over the operands.
+double TimeOperation(const Operation& operation,
+                     absl::Span<const std::pair<Bits, Bits>> operands) {
+  const absl::Duration min_run_time = absl::GetFlag(FLAGS_min_run_time);
+  int64 calls = 0;
+  int64 checksum = 0;
+  absl::Time start = absl::Now();
+  absl::Duration run_time;
+  do {
+    for (const auto& [lhs, rhs] : operands) {
+      checksum += operation.run(lhs, rhs).bit_count();
+    }
+    calls += operands.size();
+    run_time = absl::Now() - start;
+  } while (run_time < min_run_time);
+  XLS_CHECK_GE(checksum, 0);
+  return absl::ToDoubleNanoseconds(run_time) / calls;
+}
+
+void RealMain() {
+  std::vector<int64> widths;
+  for (const std::string& width_str : absl::GetFlag(FLAGS_widths)) {
+    int64 width;
+    XLS_QCHECK(absl::SimpleAtoi(width_str, &width) && width > 0)
+        << "Invalid width: " << width_str;
+    widths.push_back(width);
+  }
+  std::vector<Operation> operations = GetOperations();
+
+  std::cout << absl::StreamFormat("%-10s", "ns/op");
+  for (int64 width : widths) {
+    std::cout << absl::StreamFormat(" %8d", width);
+  }
+  std::cout << std::endl;
+
+  std::minstd_rand engine;
+  std::vector<std::vector<std::pair<Bits, Bits>>> operands(widths.size());
+  for (int64 i = 0; i < widths.size(); ++i) {
+    for (int64 j = 0; j < absl::GetFlag(FLAGS_operand_sets); ++j) {
+      Bits lhs = RandomBits(widths[i], &engine);
+      Bits rhs = RandomBits(widths[i], &engine);
+      operands[i].push_back({lhs, rhs});
+    }
+  }
+  for (const Operation& operation : operations) {
+    std::cout << absl::StreamFormat("%-10s", operation.name);
+    for (int64 i = 0; i < widths.size(); ++i) {
+      std::cout << absl::StreamFormat(" %8.1f",
+                                      TimeOperation(operation, operands[i]))
+                << std::flush;
+    }
+    std::cout << std::endl;
+  }
+}
+
+}  // namespace
+}  // namespace xls
+
+int main(int argc, char** argv) {
+  std::vector<absl::string_view> positional_arguments =
+      xls::InitXls(kUsage, argc, argv);
+  XLS_QCHECK(positional_arguments.empty())
+      << "Unexpected positional arguments: "
+      << absl::StrJoin(positional_arguments, ", ");
+  xls::RealMain();
+  return EXIT_SUCCESS;
+}
@@ -14,10 +14,14 @@
 
 #include "xls/ir/bits_ops.h"
 
+#include <random>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/strings/str_format.h"
 #include "xls/common/math_util.h"
 #include "xls/common/status/matchers.h"
+#include "xls/ir/big_int.h"
 #include "xls/ir/number_parser.h"
 #include "xls/ir/value.h"
 
@@ -730,5 +734,184 @@ TEST(BitsOpsTest, ReductionOps) {
   EXPECT_EQ(bits_ops::XorReduce(UBits(127, 128)), UBits(1, 1));
 }
 
+// Returns a Bits of the given bit count with random contents.
+Bits RandomBits(int64 bit_count, std::minstd_rand* engine) {
+  std::uniform_int_distribution<int> distribution(0, 255);
+  std::vector<uint8> bytes(CeilOfRatio(bit_count, int64{8}));
+  for (uint8& byte : bytes) {
+    byte = distribution(*engine);
+  }
+  return Bits::FromBytes(bytes, bit_count);
+}
+
+TEST(BitsOpsTest, NativeWidthsMatchBigIntWidths) {
+  // Operations on values of up to 128 bits are performed natively. Check them
+  // against the same operations on the values extended to a width which is
+  // handled with BigInts.
+  constexpr int64 kWide = 200;
+  std::minstd_rand engine;
+  for (int64 width : {1, 7, 32, 63, 64, 65, 100, 127, 128}) {
+    for (int64 i = 0; i < 64; ++i) {
+      Bits a = RandomBits(width, &engine);
+      Bits b = RandomBits(width, &engine);
+      Bits a_zext = bits_ops::ZeroExtend(a, kWide);
+      Bits b_zext = bits_ops::ZeroExtend(b, kWide);
+      Bits a_sext = bits_ops::SignExtend(a, kWide);
+      Bits b_sext = bits_ops::SignExtend(b, kWide);
+      SCOPED_TRACE(absl::StrFormat("a: %s, b: %s", a.ToString(), b.ToString()));
+
+      EXPECT_EQ(bits_ops::And(a, b),
+                bits_ops::And(a_zext, b_zext).Slice(0, width));
+      EXPECT_EQ(bits_ops::Nor(a, b),
+                bits_ops::Nor(a_zext, b_zext).Slice(0, width));
+      EXPECT_EQ(bits_ops::Not(a), bits_ops::Not(a_zext).Slice(0, width));
+      EXPECT_EQ(bits_ops::Add(a, b),
+                bits_ops::Add(a_zext, b_zext).Slice(0, width));
+      EXPECT_EQ(bits_ops::Sub(a, b),
+                bits_ops::Sub(a_zext, b_zext).Slice(0, width));
+      EXPECT_EQ(bits_ops::Negate(a), bits_ops::Negate(a_sext).Slice(0, width));
+      EXPECT_EQ(bits_ops::UMul(a, b),
+                bits_ops::UMul(a_zext, b_zext).Slice(0, 2 * width));
+      EXPECT_EQ(bits_ops::SMul(a, b),
+                bits_ops::SMul(a_sext, b_sext).Slice(0, 2 * width));
+      EXPECT_EQ(bits_ops::UDiv(a, b),
+                bits_ops::UDiv(a_zext, b_zext).Slice(0, width));
+      EXPECT_EQ(bits_ops::UMod(a, b),
+                bits_ops::UMod(a_zext, b_zext).Slice(0, width));
+      if (!b.IsZero()) {
+        // The quotient of the most negative value and -1 wraps around in
+        // both.
+        EXPECT_EQ(bits_ops::SDiv(a, b),
+                  bits_ops::SDiv(a_sext, b_sext).Slice(0, width));
+        EXPECT_EQ(bits_ops::SMod(a, b),
+                  bits_ops::SMod(a_sext, b_sext).Slice(0, width));
+      }
+      EXPECT_EQ(bits_ops::UEqual(a, b), bits_ops::UEqual(a_zext, b_zext));
+      EXPECT_EQ(bits_ops::UEqual(a, a_zext), true);
+      EXPECT_EQ(bits_ops::ULessThan(a, b), bits_ops::ULessThan(a_zext, b_zext));
+      EXPECT_EQ(bits_ops::ULessThanOrEqual(a, b),
+                bits_ops::ULessThanOrEqual(a_zext, b_zext));
+      EXPECT_EQ(bits_ops::SEqual(a, b), bits_ops::SEqual(a_sext, b_sext));
+      EXPECT_EQ(bits_ops::SLessThan(a, b), bits_ops::SLessThan(a_sext, b_sext));
+      EXPECT_EQ(bits_ops::SLessThan(a, b_sext),
+                bits_ops::SLessThan(a_sext, b_sext));
+
+      int64 shift_amount = i % (width + 1);
+      EXPECT_EQ(bits_ops::ShiftLeftLogical(a, shift_amount),
+                bits_ops::ShiftLeftLogical(a_zext, shift_amount)
+                    .Slice(0, width));
+      EXPECT_EQ(bits_ops::ShiftRightLogical(a, shift_amount),
+                bits_ops::ShiftRightLogical(a_zext, shift_amount)
+                    .Slice(0, width));
+      EXPECT_EQ(bits_ops::ShiftRightArith(a, shift_amount),
+                bits_ops::ShiftRightArith(a_sext, shift_amount)
+                    .Slice(0, width));
+      EXPECT_EQ(bits_ops::SignExtend(a, width + 3),
+                bits_ops::Concat({a.msb() ? Bits::AllOnes(3) : Bits(3), a}));
+      EXPECT_EQ(bits_ops::ZeroExtend(a, width + 3),
+                bits_ops::Concat({Bits(3), a}));
+    }
+  }
+}
+
+TEST(BitsOpsTest, WideOperationsMatchBigInt) {
+  // Widths beyond the native widths, including ones which use Karatsuba
+  // multiplication.
+  std::minstd_rand engine;
+  for (int64 width : {129, 192, 255, 256, 1000, 2048, 3001, 4096}) {
+    for (int64 i = 0; i < 16; ++i) {
+      Bits a = RandomBits(width, &engine);
+      // Vary the magnitude of the divisor to cover divisors of one to many
+      // digits.
+      Bits b = bits_ops::ShiftRightLogical(RandomBits(width, &engine),
+                                           (i * 257) % width);
+      if (i % 2 == 1) {
+        b = bits_ops::Negate(b);
+      }
+      SCOPED_TRACE(absl::StrFormat("a: %s, b: %s", a.ToString(), b.ToString()));
+      BigInt a_unsigned = BigInt::MakeUnsigned(a);
+      BigInt b_unsigned = BigInt::MakeUnsigned(b);
+      BigInt a_signed = BigInt::MakeSigned(a);
+      BigInt b_signed = BigInt::MakeSigned(b);
+
+      EXPECT_EQ(bits_ops::Add(a, b),
+                BigInt::Add(a_unsigned, b_unsigned)
+                    .ToUnsignedBitsWithBitCount(width + 1)
+                    .value()
+                    .Slice(0, width));
+      EXPECT_EQ(bits_ops::Sub(a, b),
+                BigInt::Sub(a_unsigned, b_unsigned)
+                    .ToSignedBitsWithBitCount(width + 1)
+                    .value()
+                    .Slice(0, width));
+      EXPECT_EQ(bits_ops::Negate(a), BigInt::Negate(a_signed)
+                                         .ToSignedBitsWithBitCount(width + 1)
+                                         .value()
+                                         .Slice(0, width));
+      EXPECT_EQ(bits_ops::UMul(a, b),
+                BigInt::Mul(a_unsigned, b_unsigned)
+                    .ToUnsignedBitsWithBitCount(2 * width)
+                    .value());
+      EXPECT_EQ(bits_ops::SMul(a, b),
+                BigInt::Mul(a_signed, b_signed)
+                    .ToSignedBitsWithBitCount(2 * width)
+                    .value());
+      EXPECT_EQ(bits_ops::UMul(a, b.Slice(0, width / 3)),
+                BigInt::Mul(a_unsigned, BigInt::MakeUnsigned(b.Slice(
+                                            0, width / 3)))
+                    .ToUnsignedBitsWithBitCount(width + width / 3)
+                    .value());
+      if (!b.IsZero()) {
+        EXPECT_EQ(bits_ops::UDiv(a, b), BigInt::Div(a_unsigned, b_unsigned)
+                                            .ToUnsignedBitsWithBitCount(width)
+                                            .value());
+        EXPECT_EQ(bits_ops::UMod(a, b), BigInt::Mod(a_unsigned, b_unsigned)
+                                            .ToUnsignedBitsWithBitCount(width)
+                                            .value());
+        EXPECT_EQ(bits_ops::SDiv(a, b), BigInt::Div(a_signed, b_signed)
+                                            .ToSignedBitsWithBitCount(width + 1)
+                                            .value()
+                                            .Slice(0, width));
+        EXPECT_EQ(bits_ops::SMod(a, b), BigInt::Mod(a_signed, b_signed)
+                                            .ToSignedBitsWithBitCount(width)
+                                            .value());
+      }
+      EXPECT_EQ(bits_ops::UEqual(a, b), a_unsigned == b_unsigned);
+      EXPECT_TRUE(bits_ops::UEqual(a, bits_ops::ZeroExtend(a, width + 100)));
+      EXPECT_EQ(bits_ops::ULessThan(a, b),
+                BigInt::LessThan(a_unsigned, b_unsigned));
+      EXPECT_EQ(bits_ops::SLessThan(a, b),
+                BigInt::LessThan(a_signed, b_signed));
+      BigInt b_slice_signed = BigInt::MakeSigned(b.Slice(0, 100));
+      EXPECT_EQ(bits_ops::SLessThan(a, b.Slice(0, 100)),
+                BigInt::LessThan(a_signed, b_slice_signed));
+      EXPECT_TRUE(bits_ops::SEqual(a, bits_ops::SignExtend(a, width + 100)));
+      EXPECT_EQ(bits_ops::Nand(a, b), bits_ops::Not(bits_ops::And(a, b)));
+      EXPECT_EQ(bits_ops::Xor(a, b),
+                bits_ops::And(bits_ops::Or(a, b), bits_ops::Nand(a, b)));
+    }
+  }
+}
+
+TEST(BitsOpsTest, WideDivisionAddBack) {
+  // A division in which the first estimate of a quotient digit is one too large
+  // even after the correction from the second digit of the divisor (from
+  // Hacker's Delight, adapted to 32-bit digits).
+  Bits dividend = bits_ops::Concat(
+      {UBits(0, 128), UBits(0x7fffffff80000000ULL, 64), UBits(0, 64)});
+  Bits divisor = bits_ops::Concat(
+      {UBits(0, 128), UBits(0x80000000ULL, 64), UBits(1, 64)});
+  BigInt dividend_big = BigInt::MakeUnsigned(dividend);
+  BigInt divisor_big = BigInt::MakeUnsigned(divisor);
+  EXPECT_EQ(bits_ops::UDiv(dividend, divisor),
+            BigInt::Div(dividend_big, divisor_big)
+                .ToUnsignedBitsWithBitCount(256)
+                .value());
+  EXPECT_EQ(bits_ops::UMod(dividend, divisor),
+            BigInt::Mod(dividend_big, divisor_big)
+                .ToUnsignedBitsWithBitCount(256)
+                .value());
+}
+
 }  // namespace
 }  // namespace xls
@@ -563,6 +563,48 @@ TEST(BitsTest, Slice) {
             "0b1_0001_0000_0101_0001");
 }
 
+TEST(BitsTest, WordOperationsMatchBitOperations) {
+  // The word-at-a-time implementations against bit-at-a-time references, on
+  // values straddling word boundaries.
+  for (int64 bit_count : {0, 1, 63, 64, 65, 127, 128, 129, 200}) {
+    for (Bits bits : {Bits(bit_count), Bits::AllOnes(bit_count),
+                      PrimeBits(bit_count), SBits(-2, bit_count + 2)}) {
+      int64 pop_count = 0;
+      for (bool bit : bits.ToBitVector()) {
+        pop_count += bit;
+      }
+      EXPECT_EQ(bits.PopCount(), pop_count) << bits;
+      int64 leading_zeros = 0;
+      while (leading_zeros < bits.bit_count() &&
+             !bits.GetFromMsb(leading_zeros)) {
+        ++leading_zeros;
+      }
+      EXPECT_EQ(bits.CountLeadingZeros(), leading_zeros) << bits;
+      int64 trailing_zeros = 0;
+      while (trailing_zeros < bits.bit_count() && !bits.Get(trailing_zeros)) {
+        ++trailing_zeros;
+      }
+      EXPECT_EQ(bits.CountTrailingZeros(), trailing_zeros) << bits;
+      EXPECT_EQ(bits.FitsInNBitsUnsigned(70),
+                bits.bit_count() - leading_zeros <= 70)
+          << bits;
+
+      for (int64 start : {0, 1, 63, 64, 65}) {
+        for (int64 width : {0, 1, 64, 65, 100}) {
+          if (start + width > bits.bit_count()) {
+            continue;
+          }
+          Bits slice = bits.Slice(start, width);
+          for (int64 i = 0; i < width; ++i) {
+            EXPECT_EQ(slice.Get(i), bits.Get(start + i))
+                << bits << " slice " << start << " " << width;
+          }
+        }
+      }
+    }
+  }
+}
+
 TEST(BitsTest, ValueTest) {
   Value b0 = Value(UBits(2, 4));
   EXPECT_EQ(b0.bits(), UBits(2, 4));
@@ -152,20 +152,25 @@ absl::Status Function::Accept(DfsVisitor* visitor) {
   return absl::OkStatus();
 }
 
-absl::StatusOr<Function*> Function::Clone(absl::string_view new_name) const {
-  absl::flat_hash_map<Node*, Node*> original_to_clone;
+absl::StatusOr<Function*> Function::Clone(
+    absl::string_view new_name,
+    absl::flat_hash_map<Node*, Node*>* original_to_clone) const {
+  absl::flat_hash_map<Node*, Node*> local_original_to_clone;
+  if (original_to_clone == nullptr) {
+    original_to_clone = &local_original_to_clone;
+  }
   Function* cloned_function =
       package()->AddFunction(absl::make_unique<Function>(new_name, package()));
   for (Node* node : TopoSort(const_cast<Function*>(this))) {
     std::vector<Node*> cloned_operands;
     for (Node* operand : node->operands()) {
-      cloned_operands.push_back(original_to_clone.at(operand));
+      cloned_operands.push_back(original_to_clone->at(operand));
     }
-    XLS_ASSIGN_OR_RETURN(original_to_clone[node],
+    XLS_ASSIGN_OR_RETURN((*original_to_clone)[node],
                          node->Clone(cloned_operands, cloned_function));
   }
-  XLS_RETURN_IF_ERROR(
-      cloned_function->set_return_value(original_to_clone.at(return_value())));
+  XLS_RETURN_IF_ERROR(cloned_function->set_return_value(
+      original_to_clone->at(return_value())));
   return cloned_function;
 }
 
@@ -135,8 +135,11 @@ class Function {
   absl::Status Accept(DfsVisitor* visitor);
 
   // Creates a clone of the function with the new name 'new_name'. Function is
-  // owned by the same package.
-  absl::StatusOr<Function*> Clone(absl::string_view new_name) const;
+  // owned by the same package. If 'original_to_clone' is non-null, it is set to
+  // the mapping from each node of this function to its clone.
+  absl::StatusOr<Function*> Clone(
+      absl::string_view new_name,
+      absl::flat_hash_map<Node*, Node*>* original_to_clone = nullptr) const;
 
   // Returns true if analysis indicates that this function always produces the
   // same value as 'other' when run with the same arguments. The analysis is
@@ -0,0 +1,106 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/ir/ir_binary_format.h"
+
+#include <limits>
+
+#include "absl/status/status.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/status/status_macros.h"
+
+namespace xls {
+
+bool HasBinaryIrFileExtension(absl::string_view path) {
+  return absl::EndsWith(path, kBinaryIrFileExtension);
+}
+
+void BinaryIrWriter::WriteUnsigned(uint64 value) {
+  while (value >= 0x80) {
+    out_->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out_->push_back(static_cast<char>(value));
+}
+
+void BinaryIrWriter::WriteSigned(int64 value) {
+  WriteUnsigned((static_cast<uint64>(value) << 1) ^
+                static_cast<uint64>(value >> 63));
+}
+
+absl::StatusOr<uint64> BinaryIrReader::ReadUnsigned() {
+  uint64 result = 0;
+  for (int64 shift = 0; shift < 64; shift += 7) {
+    if (offset_ >= data_.size()) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Unexpected end of binary IR at offset %d", offset_));
+    }
+    uint8 byte = static_cast<uint8>(data_[offset_++]);
+    result |= static_cast<uint64>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return result;
+    }
+  }
+  return absl::InvalidArgumentError(
+      absl::StrFormat("Invalid varint in binary IR at offset %d", offset_));
+}
+
+absl::StatusOr<int64> BinaryIrReader::ReadSigned() {
+  XLS_ASSIGN_OR_RETURN(uint64 value, ReadUnsigned());
+  return static_cast<int64>(value >> 1) ^ -static_cast<int64>(value & 1);
+}
+
+absl::StatusOr<int64> BinaryIrReader::ReadCount() {
+  XLS_ASSIGN_OR_RETURN(uint64 value, ReadUnsigned());
+  if (value > std::numeric_limits<int64>::max()) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Value %d out of range in binary IR at offset %d", value, offset_));
+  }
+  return static_cast<int64>(value);
+}
+
+absl::StatusOr<int64> BinaryIrReader::ReadIndex(int64 limit,
+                                                absl::string_view what) {
+  XLS_ASSIGN_OR_RETURN(uint64 value, ReadUnsigned());
+  if (value >= limit) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Invalid %s %d (limit %d) in binary IR at offset %d", what, value,
+        limit, offset_));
+  }
+  return static_cast<int64>(value);
+}
+
+absl::StatusOr<absl::string_view> BinaryIrReader::ReadBytes(int64 count) {
+  if (count < 0 || count > data_.size() - offset_) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Unexpected end of binary IR reading %d bytes at offset %d", count,
+        offset_));
+  }
+  absl::string_view bytes = data_.substr(offset_, count);
+  offset_ += count;
+  return bytes;
+}
+
+absl::StatusOr<absl::string_view> BinaryIrReader::ReadString() {
+  XLS_ASSIGN_OR_RETURN(uint64 size, ReadUnsigned());
+  if (size > data_.size() - offset_) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Unexpected end of binary IR reading %d bytes at offset %d", size,
+        offset_));
+  }
+  return ReadBytes(size);
+}
+
+}  // namespace xls
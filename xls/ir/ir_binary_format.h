@@ -0,0 +1,139 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Encoding primitives of the binary IR package format written by
+// Package::Serialize and read by Parser::ParseBinaryPackage.
+//
+// A binary package is the magic kBinaryIrMagic followed by a sequence of
+// unsigned LEB128 varints (signed values are zigzag encoded), length-prefixed
+// strings and raw bytes:
+//
+//   header    := version package_name has_entry [entry]
+//   package   := header strings next_node_id filenames types channels
+//                functions
+//   strings   := count string*          (referred to by index below)
+//   filenames := count string_index*    (filename of fileno 0, 1, ...)
+//   types     := count type*            (types refer to earlier types)
+//   type      := kBits bit_count | kTuple count type_index*
+//              | kArray size type_index | kToken
+//   channels  := count (name id kind data_count (name type_index)*
+//                       metadata_proto_bytes)*
+//   functions := count (kind name [init_value] param_count
+//                       (name type_index id loc)* node_count node*
+//                       return_value_index_plus_one)*
+//   node      := op_name type_index id loc operand_count operand_delta*
+//                attributes
+//
+// Functions are written before the procs, each before any function which
+// invokes it. The params of a function occupy its first node indices and the
+// remaining nodes are written in topological order. Operands are written as
+// the (positive) distance back from the node to the operand. Ops are written
+// by name so the format does not depend on the numbering of the Op enum.
+// Literal values are written recursively with Bits values as big endian
+// bytes. Because the data is only read sequentially, strings and literal
+// bytes may be consumed directly from a memory-mapped file.
+
+#ifndef XLS_IR_IR_BINARY_FORMAT_H_
+#define XLS_IR_IR_BINARY_FORMAT_H_
+
+#include <string>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "xls/common/integral_types.h"
+
+namespace xls {
+
+// The first bytes of every binary IR package. The leading byte cannot begin IR
+// text so text and binary packages are distinguished by their contents.
+constexpr absl::string_view kBinaryIrMagic("\x89XLSIRB\n", 8);
+
+// The version of the format written by Package::Serialize. Readers reject
+// other versions.
+constexpr int64 kBinaryIrVersion = 1;
+
+// Conventional file extension of binary IR files. Tools write binary IR when
+// given an output path with this extension.
+constexpr char kBinaryIrFileExtension[] = ".irb";
+
+// Tags of the types and values in a binary package.
+enum class BinaryIrTypeTag : uint8 { kBits = 0, kTuple, kArray, kToken };
+enum class BinaryIrValueTag : uint8 { kBits = 0, kTuple, kArray, kToken };
+
+// Returns true if 'data' starts with kBinaryIrMagic.
+inline bool IsBinaryIr(absl::string_view data) {
+  return data.substr(0, kBinaryIrMagic.size()) == kBinaryIrMagic;
+}
+
+// Returns true if 'path' has the binary IR file extension.
+bool HasBinaryIrFileExtension(absl::string_view path);
+
+// Appends the binary encoding of integers and strings to a string.
+class BinaryIrWriter {
+ public:
+  explicit BinaryIrWriter(std::string* out) : out_(out) {}
+
+  void WriteUnsigned(uint64 value);
+  void WriteSigned(int64 value);
+
+  // Writes the bytes without a length prefix.
+  void WriteBytes(absl::string_view bytes) {
+    out_->append(bytes.data(), bytes.size());
+  }
+
+  // Writes the length of the string followed by its bytes.
+  void WriteString(absl::string_view s) {
+    WriteUnsigned(s.size());
+    WriteBytes(s);
+  }
+
+  std::string* out() const { return out_; }
+
+ private:
+  std::string* out_;
+};
+
+// Reads values written by BinaryIrWriter from a buffer. Returns an
+// InvalidArgument error if the buffer is truncated or malformed. Strings and
+// bytes refer into the buffer.
+class BinaryIrReader {
+ public:
+  explicit BinaryIrReader(absl::string_view data) : data_(data) {}
+
+  absl::StatusOr<uint64> ReadUnsigned();
+  absl::StatusOr<int64> ReadSigned();
+
+  // Reads an unsigned value which must fit in an int64, e.g. a bit count or a
+  // node id.
+  absl::StatusOr<int64> ReadCount();
+
+  // Reads an unsigned value which must be less than 'limit', e.g. an index
+  // into a table with 'limit' entries. 'what' names the value in errors.
+  absl::StatusOr<int64> ReadIndex(int64 limit, absl::string_view what);
+
+  absl::StatusOr<absl::string_view> ReadBytes(int64 count);
+  absl::StatusOr<absl::string_view> ReadString();
+
+  // Returns the number of bytes consumed so far.
+  int64 offset() const { return offset_; }
+  bool AtEnd() const { return offset_ == data_.size(); }
+
+ private:
+  absl::string_view data_;
+  int64 offset_ = 0;
+};
+
+}  // namespace xls
+
+#endif  // XLS_IR_IR_BINARY_FORMAT_H_
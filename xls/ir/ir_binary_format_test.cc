@@ -0,0 +1,142 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/ir/ir_binary_format.h"
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "xls/common/integral_types.h"
+#include "xls/common/status/matchers.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+using ::testing::HasSubstr;
+
+TEST(IrBinaryFormatTest, UnsignedRoundTrip) {
+  const std::vector<uint64> values = {
+      0, 1, 0x7f, 0x80, 0x3fff, 0x4000, 12345678,
+      std::numeric_limits<uint64>::max()};
+  std::string out;
+  BinaryIrWriter writer(&out);
+  for (uint64 value : values) {
+    writer.WriteUnsigned(value);
+  }
+  BinaryIrReader reader(out);
+  for (uint64 value : values) {
+    EXPECT_THAT(reader.ReadUnsigned(), IsOkAndHolds(value));
+  }
+  EXPECT_TRUE(reader.AtEnd());
+}
+
+TEST(IrBinaryFormatTest, UnsignedEncoding) {
+  std::string out;
+  BinaryIrWriter writer(&out);
+  writer.WriteUnsigned(0x7f);
+  EXPECT_EQ(out, "\x7f");
+  out.clear();
+  writer.WriteUnsigned(300);
+  EXPECT_EQ(out, "\xac\x02");
+}
+
+TEST(IrBinaryFormatTest, SignedRoundTrip) {
+  const std::vector<int64> values = {0,
+                                     1,
+                                     -1,
+                                     63,
+                                     -64,
+                                     64,
+                                     -65,
+                                     std::numeric_limits<int64>::max(),
+                                     std::numeric_limits<int64>::min()};
+  std::string out;
+  BinaryIrWriter writer(&out);
+  for (int64 value : values) {
+    writer.WriteSigned(value);
+  }
+  // Small magnitudes of either sign are encoded in a single byte.
+  EXPECT_EQ(out.substr(0, 4), std::string("\x00\x02\x01\x7e", 4));
+  BinaryIrReader reader(out);
+  for (int64 value : values) {
+    EXPECT_THAT(reader.ReadSigned(), IsOkAndHolds(value));
+  }
+  EXPECT_TRUE(reader.AtEnd());
+}
+
+TEST(IrBinaryFormatTest, Strings) {
+  std::string out;
+  BinaryIrWriter writer(&out);
+  writer.WriteString("foo");
+  writer.WriteString("");
+  writer.WriteBytes("bar");
+  BinaryIrReader reader(out);
+  EXPECT_THAT(reader.ReadString(), IsOkAndHolds("foo"));
+  EXPECT_THAT(reader.ReadString(), IsOkAndHolds(""));
+  EXPECT_THAT(reader.ReadBytes(3), IsOkAndHolds("bar"));
+  EXPECT_EQ(reader.offset(), out.size());
+  EXPECT_TRUE(reader.AtEnd());
+}
+
+TEST(IrBinaryFormatTest, Truncated) {
+  EXPECT_THAT(BinaryIrReader("").ReadUnsigned(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unexpected end of binary IR")));
+  EXPECT_THAT(BinaryIrReader("\x80\x80").ReadUnsigned(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unexpected end of binary IR")));
+  EXPECT_THAT(BinaryIrReader("\x05" "abc").ReadString(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unexpected end of binary IR")));
+  EXPECT_THAT(BinaryIrReader("abc").ReadBytes(4),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unexpected end of binary IR")));
+  // A varint longer than ten bytes is malformed.
+  EXPECT_THAT(BinaryIrReader(std::string(11, '\xff')).ReadUnsigned(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Invalid varint")));
+}
+
+TEST(IrBinaryFormatTest, Limits) {
+  std::string out;
+  BinaryIrWriter writer(&out);
+  writer.WriteUnsigned(2);
+  writer.WriteUnsigned(3);
+  writer.WriteUnsigned(std::numeric_limits<uint64>::max());
+  BinaryIrReader reader(out);
+  EXPECT_THAT(reader.ReadIndex(3, "thing"), IsOkAndHolds(2));
+  EXPECT_THAT(reader.ReadIndex(3, "thing"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Invalid thing 3 (limit 3)")));
+  EXPECT_THAT(reader.ReadCount(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("out of range")));
+}
+
+TEST(IrBinaryFormatTest, Magic) {
+  EXPECT_TRUE(IsBinaryIr(std::string(kBinaryIrMagic) + "stuff"));
+  EXPECT_FALSE(IsBinaryIr(kBinaryIrMagic.substr(0, 4)));
+  EXPECT_FALSE(IsBinaryIr("package foo"));
+  EXPECT_TRUE(HasBinaryIrFileExtension("/tmp/foo.opt.irb"));
+  EXPECT_FALSE(HasBinaryIrFileExtension("/tmp/foo.opt.ir"));
+}
+
+}  // namespace
+}  // namespace xls
@@ -14,14 +14,21 @@
 
 #include "xls/ir/ir_parser.h"
 
+#include <deque>
+#include <limits>
+#include <thread>
+
 #include "google/protobuf/text_format.h"
 #include "absl/status/status.h"
-#include "absl/strings/str_split.h"
+#include "absl/strings/numbers.h"
+#include "absl/synchronization/mutex.h"
+#include "xls/common/file/memory_mapped_file.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/common/visitor.h"
 #include "xls/ir/bits_ops.h"
 #include "xls/ir/channel.pb.h"
+#include "xls/ir/ir_binary_format.h"
 #include "xls/ir/node.h"
 #include "xls/ir/nodes.h"
 #include "xls/ir/number_parser.h"
@@ -195,7 +202,7 @@ class ArgParser {
                 absl::StrFormat("Invalid keyword @ %s: %s",
                                 name.pos().ToHumanString(), name.value()));
           }
-          seen_keywords.insert(name.value());
+          seen_keywords.insert(std::string(name.value()));
         } else {
           if (!name_to_bvalue_.contains(name.value())) {
             return absl::InvalidArgumentError(absl::StrFormat(
@@ -287,7 +294,7 @@ absl::StatusOr<std::string> Parser::ParseIdentifierString(TokenPos* pos) {
   if (pos != nullptr) {
     *pos = token.pos();
   }
-  return token.value();
+  return std::string(token.value());
 }
 
 absl::StatusOr<BValue> Parser::ParseIdentifierValue(
@@ -479,7 +486,8 @@ namespace {
 
 // GetLocalNode finds function-local BValues by name.
 absl::StatusOr<Node*> GetLocalNode(
-    std::string name, absl::flat_hash_map<std::string, BValue>* name_to_value) {
+    absl::string_view name,
+    absl::flat_hash_map<std::string, BValue>* name_to_value) {
   auto it = name_to_value->find(name);
   if (it == name_to_value->end()) {
     return absl::InvalidArgumentError(absl::StrFormat(
@@ -556,7 +564,7 @@ absl::StatusOr<BValue> Parser::ParseFunctionBody(
             arg_parser.AddKeywordArg<std::string>("to_apply");
         XLS_ASSIGN_OR_RETURN(operands, arg_parser.Run(/*arity=*/1));
         XLS_ASSIGN_OR_RETURN(Function * to_apply,
-                             package->GetFunction(*to_apply_name));
+                             GetInvokedFunction(package, *to_apply_name));
         bvalue = fb->Map(operands[0], to_apply, *loc);
         break;
       }
@@ -584,7 +592,8 @@ absl::StatusOr<BValue> Parser::ParseFunctionBody(
             arg_parser.AddOptionalKeywordArg<std::vector<BValue>>(
                 "invariant_args", /*default_value=*/{});
         XLS_ASSIGN_OR_RETURN(operands, arg_parser.Run(/*arity=*/1));
-        XLS_ASSIGN_OR_RETURN(Function * body, package->GetFunction(*body_name));
+        XLS_ASSIGN_OR_RETURN(Function * body,
+                             GetInvokedFunction(package, *body_name));
         bvalue = fb->CountedFor(operands[0], *trip_count, *stride, body,
                                 *invariant_args, *loc);
         break;
@@ -709,7 +718,7 @@ absl::StatusOr<BValue> Parser::ParseFunctionBody(
             arg_parser.AddKeywordArg<std::string>("to_apply");
         XLS_ASSIGN_OR_RETURN(operands, arg_parser.Run(ArgParser::kVariadic));
         XLS_ASSIGN_OR_RETURN(Function * to_apply,
-                             package->GetFunction(*to_apply_name));
+                             GetInvokedFunction(package, *to_apply_name));
         bvalue = fb->Invoke(operands, to_apply, *loc);
         break;
       }
@@ -850,15 +859,16 @@ absl::StatusOr<BValue> Parser::ParseFunctionBody(
 
     last_created = bvalue;
 
-    // If the name in the IR dump suggested an ID, we use it directly.
+    // If the name in the IR dump suggested an ID, we use it directly. The ID
+    // is the part of the name after the last '.', if any.
     auto get_suggested_id =
         [](absl::string_view name) -> absl::optional<int64> {
-      std::vector<absl::string_view> pieces = absl::StrSplit(name, '.');
-      if (pieces.empty()) {
-        return absl::nullopt;
+      size_t last_dot = name.rfind('.');
+      if (last_dot != absl::string_view::npos) {
+        name.remove_prefix(last_dot + 1);
       }
       int64 result;
-      if (absl::SimpleAtoi(pieces.back(), &result)) {
+      if (absl::SimpleAtoi(name, &result)) {
         return result;
       }
       return absl::nullopt;
@@ -868,6 +878,9 @@ absl::StatusOr<BValue> Parser::ParseFunctionBody(
       if (absl::optional<int64> suggested_id =
               get_suggested_id(output_name.value())) {
         last_created.node()->set_id(suggested_id.value());
+        if (suggested_id_nodes_ != nullptr) {
+          suggested_id_nodes_->insert(last_created.node());
+        }
       }
     }
 
@@ -1004,10 +1017,11 @@ absl::StatusOr<std::string> Parser::ParsePackageName() {
   XLS_ASSIGN_OR_RETURN(
       Token package_name,
       scanner_.PopTokenOrError(LexicalTokenType::kIdent, "package name"));
-  return package_name.value();
+  return std::string(package_name.value());
 }
 
-absl::StatusOr<Function*> Parser::ParseFunction(Package* package) {
+absl::StatusOr<std::pair<std::unique_ptr<FunctionBuilder>, BValue>>
+Parser::ParseFunctionDefinition(Package* package) {
   if (AtEof()) {
     return absl::InvalidArgumentError("Could not parse function; at EOF.");
   }
@@ -1029,14 +1043,20 @@ absl::StatusOr<Function*> Parser::ParseFunction(Package* package) {
         return_value.node()->GetType()->ToString(),
         function_data.second->ToString()));
   }
+  return std::make_pair(std::move(function_data.first), return_value);
+}
+
+absl::StatusOr<Function*> Parser::ParseFunction(Package* package) {
+  XLS_ASSIGN_OR_RETURN(auto definition, ParseFunctionDefinition(package));
 
   // TODO(leary): 2019-02-19 Could be an empty function body, need to decide
   // what to do for those. Accept that the return value can be null and handle
   // everywhere?
-  return fb->BuildWithReturnValue(return_value);
+  return definition.first->BuildWithReturnValue(definition.second);
 }
 
-absl::StatusOr<Proc*> Parser::ParseProc(Package* package) {
+absl::StatusOr<std::pair<std::unique_ptr<ProcBuilder>, BValue>>
+Parser::ParseProcDefinition(Package* package) {
   if (AtEof()) {
     return absl::InvalidArgumentError("Could not parse proc; at EOF.");
   }
@@ -1056,8 +1076,25 @@ absl::StatusOr<Proc*> Parser::ParseProc(Package* package) {
         return_value.node()->GetType()->ToString(),
         pb->proc()->ReturnType()->ToString()));
   }
+  return std::make_pair(std::move(pb), return_value);
+}
 
-  return pb->BuildWithReturnValue(return_value);
+absl::StatusOr<Proc*> Parser::ParseProc(Package* package) {
+  XLS_ASSIGN_OR_RETURN(auto definition, ParseProcDefinition(package));
+  return definition.first->BuildWithReturnValue(definition.second);
+}
+
+absl::StatusOr<Function*> Parser::GetInvokedFunction(Package* package,
+                                                     absl::string_view name) {
+  if (invoked_functions_ == nullptr) {
+    return package->GetFunction(name);
+  }
+  auto it = invoked_functions_->find(name);
+  if (it == invoked_functions_->end()) {
+    return absl::NotFoundError(
+        absl::StrFormat("Function \"%s\" is not defined before use", name));
+  }
+  return it->second;
 }
 
 absl::StatusOr<Channel*> Parser::ParseChannel(Package* package) {
@@ -1093,7 +1130,7 @@ absl::StatusOr<Channel*> Parser::ParseChannel(Package* package) {
       // Data element: "<name>: <type>"
       XLS_RETURN_IF_ERROR(scanner_.DropTokenOrError(LexicalTokenType::kColon));
       XLS_ASSIGN_OR_RETURN(Type * type, ParseType(package));
-      data_elements.push_back(DataElement{field_name.value(), type});
+      data_elements.push_back(DataElement{std::string(field_name.value()), type});
     } else if (scanner_.TryDropToken(LexicalTokenType::kEquals)) {
       // Attribute: "<name>=<value>"
       if (field_name.value() == "id") {
@@ -1121,8 +1158,8 @@ absl::StatusOr<Channel*> Parser::ParseChannel(Package* package) {
             Token metadata_token,
             scanner_.PopTokenOrError(LexicalTokenType::kQuotedString));
         ChannelMetadataProto proto;
-        bool success =
-            google::protobuf::TextFormat::ParseFromString(metadata_token.value(), &proto);
+        bool success = google::protobuf::TextFormat::ParseFromString(
+            std::string(metadata_token.value()), &proto);
         if (!success) {
           return absl::InvalidArgumentError(
               absl::StrFormat("Invalid channel metadata @ %s",
@@ -1184,6 +1221,816 @@ absl::StatusOr<FunctionType*> Parser::ParseFunctionType(Package* package) {
   return package->GetFunctionType(parameter_types, return_type);
 }
 
+absl::Status Parser::ParsePackageItems(Package* package,
+                                       absl::string_view filename) {
+  while (!AtEof()) {
+    XLS_ASSIGN_OR_RETURN(Token peek, scanner_.PeekToken());
+    if (peek.type() == LexicalTokenType::kKeyword && peek.value() == "fn") {
+      XLS_RETURN_IF_ERROR(ParseFunction(package).status()) << "@ " << filename;
+      continue;
+    }
+    if (peek.type() == LexicalTokenType::kKeyword && peek.value() == "proc") {
+      XLS_RETURN_IF_ERROR(ParseProc(package).status()) << "@ " << filename;
+      continue;
+    }
+    if (peek.type() == LexicalTokenType::kKeyword && peek.value() == "chan") {
+      XLS_RETURN_IF_ERROR(ParseChannel(package).status()) << "@ " << filename;
+      continue;
+    }
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Expected fn, proc, or chan definition, got %s @ %s",
+                        peek.value(), peek.pos().ToHumanString()));
+  }
+  return absl::OkStatus();
+}
+
+namespace {
+
+// A function or proc definition parsed by
+// Parser::ParsePackageItemsConcurrently.
+struct Definition {
+  bool is_proc;
+
+  // The tokens of the definition, from the 'fn' or 'proc' keyword to the
+  // closing brace.
+  int64 token_start;
+  int64 token_limit;
+
+  // Indices of the (preceding) definitions of the functions invoked by this
+  // definition, indexed by function name.
+  absl::flat_hash_map<std::string, int64> invoked;
+
+  // Indices of the definitions which invoke this function, and the number of
+  // functions invoked by this definition which are not yet parsed.
+  std::vector<int64> invokers;
+  int64 unparsed_invoked_count = 0;
+
+  // The result of parsing the definition.
+  std::unique_ptr<FunctionBuilder> function_builder;
+  std::unique_ptr<ProcBuilder> proc_builder;
+  Function* function = nullptr;
+  BValue return_value;
+  absl::flat_hash_set<Node*> suggested_id_nodes;
+};
+
+}  // namespace
+
+absl::Status Parser::ParsePackageItemsConcurrently(Package* package,
+                                                   int64 thread_count) {
+  // Channels are created immediately. Function and proc definitions are
+  // delimited by their closing brace (bodies contain no braces) and scanned
+  // for the names of the functions they invoke. Invoked functions must be
+  // defined earlier in the package, as with sequential parsing.
+  const int64 first_node_id = package->next_node_id();
+  std::vector<Definition> definitions;
+  absl::flat_hash_map<std::string, int64> function_definitions;
+  bool seen_proc = false;
+  while (!AtEof()) {
+    const Token& keyword = scanner_.PeekTokenOrDie();
+    if (keyword.type() == LexicalTokenType::kKeyword &&
+        keyword.value() == "chan") {
+      // Procs must not refer to channels defined after them.
+      XLS_RET_CHECK(!seen_proc) << "Channel defined after a proc";
+      XLS_RETURN_IF_ERROR(ParseChannel(package).status());
+      continue;
+    }
+    Definition definition;
+    definition.token_start = scanner_.token_index();
+    if (scanner_.TryDropKeyword("proc")) {
+      definition.is_proc = true;
+      seen_proc = true;
+    } else {
+      XLS_RETURN_IF_ERROR(scanner_.DropKeywordOrError("fn"));
+      definition.is_proc = false;
+    }
+    XLS_ASSIGN_OR_RETURN(Token name,
+                         scanner_.PopTokenOrError(LexicalTokenType::kIdent));
+    while (true) {
+      XLS_ASSIGN_OR_RETURN(Token token, scanner_.PopTokenOrError());
+      if (token.type() == LexicalTokenType::kCurlClose) {
+        break;
+      }
+      if (token.type() == LexicalTokenType::kIdent &&
+          (token.value() == "to_apply" || token.value() == "body") &&
+          scanner_.TryDropToken(LexicalTokenType::kEquals) &&
+          scanner_.PeekTokenIs(LexicalTokenType::kIdent)) {
+        absl::string_view invoked_name = scanner_.PopToken().value();
+        auto it = function_definitions.find(invoked_name);
+        if (it == function_definitions.end()) {
+          return absl::NotFoundError(absl::StrFormat(
+              "Function \"%s\" is not defined before use", invoked_name));
+        }
+        definition.invoked.emplace(invoked_name, it->second);
+      }
+    }
+    definition.token_limit = scanner_.token_index();
+    if (!definition.is_proc) {
+      // As with Package::GetFunction, the first function with a given name is
+      // the one invoked.
+      function_definitions.emplace(name.value(), definitions.size());
+    }
+    definitions.push_back(std::move(definition));
+  }
+
+  std::deque<int64> ready;
+  for (int64 i = 0; i < definitions.size(); ++i) {
+    absl::flat_hash_set<int64> invoked_indices;
+    for (const auto& pair : definitions[i].invoked) {
+      if (invoked_indices.insert(pair.second).second) {
+        definitions[pair.second].invokers.push_back(i);
+      }
+    }
+    definitions[i].unparsed_invoked_count = invoked_indices.size();
+    if (invoked_indices.empty()) {
+      ready.push_back(i);
+    }
+  }
+
+  // Parses the definition with the given index. All functions it invokes must
+  // have been parsed.
+  auto parse_definition = [&](Definition* definition) -> absl::Status {
+    absl::flat_hash_map<std::string, Function*> invoked_functions;
+    for (const auto& pair : definition->invoked) {
+      invoked_functions[pair.first] = definitions[pair.second].function;
+    }
+    Parser parser(
+        scanner_.Subrange(definition->token_start, definition->token_limit));
+    parser.invoked_functions_ = &invoked_functions;
+    parser.suggested_id_nodes_ = &definition->suggested_id_nodes;
+    if (definition->is_proc) {
+      XLS_ASSIGN_OR_RETURN(auto parsed, parser.ParseProcDefinition(package));
+      definition->proc_builder = std::move(parsed.first);
+      definition->function = definition->proc_builder->function();
+      definition->return_value = parsed.second;
+    } else {
+      XLS_ASSIGN_OR_RETURN(auto parsed,
+                           parser.ParseFunctionDefinition(package));
+      definition->function_builder = std::move(parsed.first);
+      definition->function = definition->function_builder->function();
+      definition->return_value = parsed.second;
+    }
+    XLS_RET_CHECK(parser.AtEof());
+    XLS_RET_CHECK(definition->return_value.valid());
+    // Invokers of the function need its return type.
+    return definition->function->set_return_value(
+        definition->return_value.node());
+  };
+
+  absl::Mutex mutex;
+  absl::CondVar wake;
+  int64 unparsed_count = definitions.size();
+  absl::Status status;
+  auto worker = [&]() {
+    while (true) {
+      Definition* definition;
+      {
+        absl::MutexLock lock(&mutex);
+        while (ready.empty() && unparsed_count > 0 && status.ok()) {
+          wake.Wait(&mutex);
+        }
+        if (ready.empty() || !status.ok()) {
+          return;
+        }
+        definition = &definitions[ready.front()];
+        ready.pop_front();
+      }
+      absl::Status parse_status = parse_definition(definition);
+
+      absl::MutexLock lock(&mutex);
+      --unparsed_count;
+      if (!parse_status.ok()) {
+        status.Update(parse_status);
+      } else {
+        for (int64 invoker : definition->invokers) {
+          if (--definitions[invoker].unparsed_invoked_count == 0) {
+            ready.push_back(invoker);
+          }
+        }
+      }
+      wake.SignalAll();
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int64 i = 0; i < std::min<int64>(thread_count, definitions.size());
+       ++i) {
+    threads.emplace_back(worker);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  XLS_RETURN_IF_ERROR(status);
+
+  // Add the functions and procs to the package in the order of their
+  // definitions and assign the ids sequential parsing would have: nodes are
+  // numbered in the order of their creation unless the IR text suggests an id.
+  int64 next_node_id = first_node_id;
+  for (Definition& definition : definitions) {
+    if (definition.is_proc) {
+      XLS_RETURN_IF_ERROR(definition.proc_builder
+                              ->BuildWithReturnValue(definition.return_value)
+                              .status());
+    } else {
+      XLS_RETURN_IF_ERROR(definition.function_builder
+                              ->BuildWithReturnValue(definition.return_value)
+                              .status());
+    }
+    for (Node* node : definition.function->nodes()) {
+      if (!definition.suggested_id_nodes.contains(node)) {
+        node->set_id(next_node_id);
+      }
+      ++next_node_id;
+    }
+  }
+  package->set_next_node_id(next_node_id);
+  return absl::OkStatus();
+}
+
+namespace {
+
+// Reads the channels and functions of a binary package (see
+// ir_binary_format.h) into a package. Nodes are constructed with the function
+// builders, as in the text parser, so malformed input results in an error.
+class BinaryPackageParser {
+ public:
+  BinaryPackageParser(BinaryIrReader* reader, Package* package)
+      : reader_(reader), package_(package) {}
+
+  absl::Status Parse() {
+    XLS_ASSIGN_OR_RETURN(uint64 string_count, reader_->ReadUnsigned());
+    for (uint64 i = 0; i < string_count; ++i) {
+      XLS_ASSIGN_OR_RETURN(absl::string_view s, reader_->ReadString());
+      strings_.push_back(s);
+    }
+    ops_.resize(strings_.size());
+
+    XLS_ASSIGN_OR_RETURN(int64 next_node_id, reader_->ReadCount());
+    XLS_ASSIGN_OR_RETURN(uint64 filename_count, reader_->ReadUnsigned());
+    for (uint64 i = 0; i < filename_count; ++i) {
+      XLS_ASSIGN_OR_RETURN(absl::string_view filename, ReadStringRef());
+      if (package_->GetOrCreateFileno(filename) != Fileno(i)) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Duplicate filename \"%s\" in binary IR", filename));
+      }
+    }
+
+    XLS_ASSIGN_OR_RETURN(uint64 type_count, reader_->ReadUnsigned());
+    for (uint64 i = 0; i < type_count; ++i) {
+      XLS_ASSIGN_OR_RETURN(Type * type, ReadType());
+      types_.push_back(type);
+    }
+
+    XLS_ASSIGN_OR_RETURN(uint64 channel_count, reader_->ReadUnsigned());
+    for (uint64 i = 0; i < channel_count; ++i) {
+      XLS_RETURN_IF_ERROR(ReadChannel());
+    }
+
+    XLS_ASSIGN_OR_RETURN(uint64 function_count, reader_->ReadUnsigned());
+    for (uint64 i = 0; i < function_count; ++i) {
+      XLS_ASSIGN_OR_RETURN(Function * function, ReadFunction());
+      functions_.push_back(function);
+    }
+    if (!reader_->AtEnd()) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Unexpected data at offset %d after binary IR package",
+          reader_->offset()));
+    }
+
+    int64 max_id_seen = -1;
+    for (Function* function : functions_) {
+      for (Node* node : function->nodes()) {
+        max_id_seen = std::max(max_id_seen, node->id());
+      }
+    }
+    package_->set_next_node_id(
+        std::max(next_node_id, max_id_seen + 1));
+    return absl::OkStatus();
+  }
+
+ private:
+  absl::StatusOr<absl::string_view> ReadStringRef() {
+    XLS_ASSIGN_OR_RETURN(int64 index,
+                         reader_->ReadIndex(strings_.size(), "string index"));
+    return strings_[index];
+  }
+
+  absl::StatusOr<Type*> ReadTypeRef() {
+    XLS_ASSIGN_OR_RETURN(int64 index,
+                         reader_->ReadIndex(types_.size(), "type index"));
+    return types_[index];
+  }
+
+  absl::StatusOr<Op> ReadOp() {
+    XLS_ASSIGN_OR_RETURN(int64 index,
+                         reader_->ReadIndex(strings_.size(), "op name"));
+    if (!ops_[index].has_value()) {
+      XLS_ASSIGN_OR_RETURN(ops_[index], StringToOp(strings_[index]));
+    }
+    return *ops_[index];
+  }
+
+  absl::StatusOr<Type*> ReadType() {
+    XLS_ASSIGN_OR_RETURN(
+        int64 tag,
+        reader_->ReadIndex(static_cast<int64>(BinaryIrTypeTag::kToken) + 1,
+                           "type tag"));
+    switch (static_cast<BinaryIrTypeTag>(tag)) {
+      case BinaryIrTypeTag::kBits: {
+        XLS_ASSIGN_OR_RETURN(int64 bit_count, reader_->ReadCount());
+        return package_->GetBitsType(bit_count);
+      }
+      case BinaryIrTypeTag::kTuple: {
+        XLS_ASSIGN_OR_RETURN(int64 size, reader_->ReadCount());
+        std::vector<Type*> elements;
+        for (uint64 i = 0; i < size; ++i) {
+          XLS_ASSIGN_OR_RETURN(Type * element, ReadTypeRef());
+          elements.push_back(element);
+        }
+        return package_->GetTupleType(elements);
+      }
+      case BinaryIrTypeTag::kArray: {
+        XLS_ASSIGN_OR_RETURN(int64 size, reader_->ReadCount());
+        XLS_ASSIGN_OR_RETURN(Type * element, ReadTypeRef());
+        return package_->GetArrayType(size, element);
+      }
+      case BinaryIrTypeTag::kToken:
+        break;
+    }
+    return package_->GetTokenType();
+  }
+
+  absl::StatusOr<Value> ReadValue() {
+    XLS_ASSIGN_OR_RETURN(
+        int64 tag,
+        reader_->ReadIndex(static_cast<int64>(BinaryIrValueTag::kToken) + 1,
+                           "value tag"));
+    switch (static_cast<BinaryIrValueTag>(tag)) {
+      case BinaryIrValueTag::kBits: {
+        XLS_ASSIGN_OR_RETURN(int64 bit_count, reader_->ReadCount());
+        XLS_ASSIGN_OR_RETURN(
+            absl::string_view bytes,
+            reader_->ReadBytes(bit_count / 8 + (bit_count % 8 != 0)));
+        return Value(Bits::FromBytes(
+            absl::MakeSpan(reinterpret_cast<const uint8*>(bytes.data()),
+                           bytes.size()),
+            bit_count));
+      }
+      case BinaryIrValueTag::kTuple:
+      case BinaryIrValueTag::kArray: {
+        XLS_ASSIGN_OR_RETURN(int64 size, reader_->ReadCount());
+        std::vector<Value> elements;
+        for (uint64 i = 0; i < size; ++i) {
+          XLS_ASSIGN_OR_RETURN(Value element, ReadValue());
+          elements.push_back(std::move(element));
+        }
+        if (static_cast<BinaryIrValueTag>(tag) == BinaryIrValueTag::kTuple) {
+          return Value::TupleOwned(std::move(elements));
+        }
+        return Value::Array(elements);
+      }
+      case BinaryIrValueTag::kToken:
+        break;
+    }
+    return Value::Token();
+  }
+
+  absl::StatusOr<absl::optional<SourceLocation>> ReadLoc() {
+    XLS_ASSIGN_OR_RETURN(uint64 has_loc, reader_->ReadUnsigned());
+    if (!has_loc) {
+      return absl::nullopt;
+    }
+    XLS_ASSIGN_OR_RETURN(int64 fileno, reader_->ReadSigned());
+    XLS_ASSIGN_OR_RETURN(int64 lineno, reader_->ReadSigned());
+    XLS_ASSIGN_OR_RETURN(int64 colno, reader_->ReadSigned());
+    return SourceLocation(Fileno(fileno), Lineno(lineno), Colno(colno));
+  }
+
+  absl::StatusOr<Function*> ReadFunctionRef() {
+    XLS_ASSIGN_OR_RETURN(
+        int64 index, reader_->ReadIndex(functions_.size(), "function index"));
+    return functions_[index];
+  }
+
+  absl::Status ReadChannel() {
+    XLS_ASSIGN_OR_RETURN(absl::string_view name, ReadStringRef());
+    XLS_ASSIGN_OR_RETURN(int64 id, reader_->ReadSigned());
+    XLS_ASSIGN_OR_RETURN(absl::string_view kind_name, ReadStringRef());
+    XLS_ASSIGN_OR_RETURN(ChannelKind kind, StringToChannelKind(kind_name));
+    XLS_ASSIGN_OR_RETURN(uint64 data_element_count, reader_->ReadUnsigned());
+    std::vector<DataElement> data_elements;
+    for (uint64 i = 0; i < data_element_count; ++i) {
+      XLS_ASSIGN_OR_RETURN(absl::string_view element_name, ReadStringRef());
+      XLS_ASSIGN_OR_RETURN(Type * type, ReadTypeRef());
+      data_elements.push_back(DataElement{std::string(element_name), type});
+    }
+    XLS_ASSIGN_OR_RETURN(absl::string_view metadata_bytes,
+                         reader_->ReadString());
+    ChannelMetadataProto metadata;
+    if (!metadata.ParseFromArray(metadata_bytes.data(),
+                                 metadata_bytes.size())) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Invalid metadata of channel %s", name));
+    }
+    return package_
+        ->CreateChannelWithId(name, id, kind, data_elements, metadata)
+        .status();
+  }
+
+  absl::StatusOr<Function*> ReadFunction() {
+    XLS_ASSIGN_OR_RETURN(uint64 is_proc, reader_->ReadUnsigned());
+    XLS_ASSIGN_OR_RETURN(absl::string_view name, ReadStringRef());
+    Value init_value;
+    if (is_proc) {
+      XLS_ASSIGN_OR_RETURN(init_value, ReadValue());
+    }
+
+    struct ParamData {
+      absl::string_view name;
+      Type* type;
+      int64 id;
+      absl::optional<SourceLocation> loc;
+    };
+    XLS_ASSIGN_OR_RETURN(uint64 param_count, reader_->ReadUnsigned());
+    std::vector<ParamData> params;
+    for (uint64 i = 0; i < param_count; ++i) {
+      ParamData param;
+      XLS_ASSIGN_OR_RETURN(param.name, ReadStringRef());
+      XLS_ASSIGN_OR_RETURN(param.type, ReadTypeRef());
+      XLS_ASSIGN_OR_RETURN(param.id, reader_->ReadCount());
+      XLS_ASSIGN_OR_RETURN(param.loc, ReadLoc());
+      params.push_back(param);
+    }
+
+    std::unique_ptr<FunctionBuilder> function_builder;
+    std::unique_ptr<ProcBuilder> proc_builder;
+    BuilderBase* builder;
+    std::vector<BValue> nodes;
+    if (is_proc) {
+      if (params.size() != 2) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Proc %s must have two params", name));
+      }
+      proc_builder = absl::make_unique<ProcBuilder>(
+          name, init_value, params[0].name, params[1].name, package_);
+      builder = proc_builder.get();
+      nodes = {proc_builder->GetStateParam(), proc_builder->GetTokenParam()};
+    } else {
+      function_builder = absl::make_unique<FunctionBuilder>(name, package_);
+      builder = function_builder.get();
+      for (const ParamData& param : params) {
+        nodes.push_back(builder->Param(param.name, param.type, param.loc));
+      }
+    }
+    // A param or node which could not be constructed is invalid and the
+    // builder reports the reason when building the function. Building stops at
+    // the first such value as the builder does not accept invalid operands.
+    auto build = [&](BValue return_value) -> absl::StatusOr<Function*> {
+      if (is_proc) {
+        return proc_builder->BuildWithReturnValue(return_value);
+      }
+      return function_builder->BuildWithReturnValue(return_value);
+    };
+    for (int64 i = 0; i < params.size(); ++i) {
+      if (!nodes[i].valid()) {
+        return build(nodes[i]);
+      }
+      if (nodes[i].GetType() != params[i].type) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Param %s of %s has type %s, expected %s", params[i].name, name,
+            nodes[i].GetType()->ToString(), params[i].type->ToString()));
+      }
+      nodes[i].node()->set_id(params[i].id);
+    }
+
+    XLS_ASSIGN_OR_RETURN(uint64 node_count, reader_->ReadUnsigned());
+    for (uint64 i = 0; i < node_count; ++i) {
+      XLS_ASSIGN_OR_RETURN(BValue node, ReadNode(builder, nodes));
+      if (!node.valid()) {
+        return build(node);
+      }
+      nodes.push_back(node);
+    }
+    XLS_ASSIGN_OR_RETURN(
+        int64 return_index,
+        reader_->ReadIndex(nodes.size() + 1, "return value index"));
+    if (return_index == 0) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Function %s has no return value", name));
+    }
+    return build(nodes[return_index - 1]);
+  }
+
+  absl::StatusOr<BValue> ReadNode(BuilderBase* fb,
+                                  absl::Span<const BValue> nodes) {
+    XLS_ASSIGN_OR_RETURN(Op op, ReadOp());
+    XLS_ASSIGN_OR_RETURN(Type * type, ReadTypeRef());
+    XLS_ASSIGN_OR_RETURN(int64 id, reader_->ReadCount());
+    XLS_ASSIGN_OR_RETURN(absl::optional<SourceLocation> loc, ReadLoc());
+    XLS_ASSIGN_OR_RETURN(uint64 operand_count, reader_->ReadUnsigned());
+    std::vector<BValue> operands;
+    for (uint64 i = 0; i < operand_count; ++i) {
+      XLS_ASSIGN_OR_RETURN(int64 distance,
+                           reader_->ReadIndex(nodes.size() + 1, "operand"));
+      if (distance == 0) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Node %s.%d refers to itself as an operand", OpToString(op), id));
+      }
+      operands.push_back(nodes[nodes.size() - distance]);
+    }
+
+    auto expect_operands = [&](int64 min_count,
+                               int64 max_count) -> absl::Status {
+      if (operands.size() < min_count || operands.size() > max_count) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Node %s.%d has %d operands", OpToString(op), id,
+                            operands.size()));
+      }
+      return absl::OkStatus();
+    };
+    auto expect_operand_count = [&](int64 count) {
+      return expect_operands(count, count);
+    };
+    constexpr int64 kVariadic = std::numeric_limits<int64>::max();
+    auto get_channel = [&]() -> absl::StatusOr<Channel*> {
+      XLS_ASSIGN_OR_RETURN(int64 channel_id, reader_->ReadSigned());
+      return package_->GetChannel(channel_id);
+    };
+    auto operand_type_is = [&](int64 operand_no, TypeKind kind) {
+      return operands[operand_no].GetType()->kind() == kind;
+    };
+
+    BValue bvalue;
+    switch (op) {
+      case Op::kParam:
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Param %d in function body", id));
+      case Op::kLiteral: {
+        XLS_ASSIGN_OR_RETURN(Value value, ReadValue());
+        XLS_RETURN_IF_ERROR(expect_operand_count(0));
+        bvalue = fb->Literal(value, loc);
+        break;
+      }
+      case Op::kBitSlice: {
+        XLS_ASSIGN_OR_RETURN(int64 start, reader_->ReadCount());
+        XLS_ASSIGN_OR_RETURN(int64 width, reader_->ReadCount());
+        XLS_RETURN_IF_ERROR(expect_operand_count(1));
+        bvalue = fb->BitSlice(operands[0], start, width, loc);
+        break;
+      }
+      case Op::kDynamicBitSlice: {
+        XLS_ASSIGN_OR_RETURN(int64 width, reader_->ReadCount());
+        XLS_RETURN_IF_ERROR(expect_operand_count(2));
+        bvalue = fb->DynamicBitSlice(operands[0], operands[1], width, loc);
+        break;
+      }
+      case Op::kConcat:
+        for (int64 i = 0; i < operands.size(); ++i) {
+          if (!operand_type_is(i, TypeKind::kBits)) {
+            return absl::InvalidArgumentError(absl::StrFormat(
+                "Operand %d of concat.%d is not bits", i, id));
+          }
+        }
+        bvalue = fb->Concat(operands, loc);
+        break;
+      case Op::kMap: {
+        XLS_ASSIGN_OR_RETURN(Function * to_apply, ReadFunctionRef());
+        XLS_RETURN_IF_ERROR(expect_operand_count(1));
+        if (!operand_type_is(0, TypeKind::kArray)) {
+          return absl::InvalidArgumentError(
+              absl::StrFormat("Operand of map.%d is not an array", id));
+        }
+        bvalue = fb->Map(operands[0], to_apply, loc);
+        break;
+      }
+      case Op::kInvoke: {
+        XLS_ASSIGN_OR_RETURN(Function * to_apply, ReadFunctionRef());
+        bvalue = fb->Invoke(operands, to_apply, loc);
+        break;
+      }
+      case Op::kCountedFor: {
+        XLS_ASSIGN_OR_RETURN(int64 trip_count, reader_->ReadSigned());
+        XLS_ASSIGN_OR_RETURN(int64 stride, reader_->ReadSigned());
+        XLS_ASSIGN_OR_RETURN(Function * body, ReadFunctionRef());
+        XLS_RETURN_IF_ERROR(expect_operands(1, kVariadic));
+        bvalue = fb->CountedFor(operands[0], trip_count, stride, body,
+                                absl::MakeSpan(operands).subspan(1), loc);
+        break;
+      }
+      case Op::kOneHot: {
+        XLS_ASSIGN_OR_RETURN(uint64 msb_prio, reader_->ReadUnsigned());
+        XLS_RETURN_IF_ERROR(expect_operand_count(1));
+        if (!operand_type_is(0, TypeKind::kBits)) {
+          return absl::InvalidArgumentError(
+              absl::StrFormat("Operand of one_hot.%d is not bits", id));
+        }
+        bvalue = fb->OneHot(operands[0],
+                            msb_prio ? LsbOrMsb::kMsb : LsbOrMsb::kLsb, loc);
+        break;
+      }
+      case Op::kOneHotSel:
+        XLS_RETURN_IF_ERROR(expect_operands(2, kVariadic));
+        bvalue = fb->OneHotSelect(operands[0],
+                                  absl::MakeSpan(operands).subspan(1), loc);
+        break;
+      case Op::kSel: {
+        XLS_ASSIGN_OR_RETURN(uint64 has_default, reader_->ReadUnsigned());
+        XLS_RETURN_IF_ERROR(expect_operands(has_default ? 3 : 2, kVariadic));
+        absl::optional<BValue> default_value;
+        if (has_default) {
+          default_value = operands.back();
+          operands.pop_back();
+        }
+        bvalue = fb->Select(operands[0], absl::MakeSpan(operands).subspan(1),
+                            default_value, loc);
+        break;
+      }
+      case Op::kTuple:
+        bvalue = fb->Tuple(operands, loc);
+        break;
+      case Op::kAfterAll:
+        bvalue = fb->AfterAll(operands, loc);
+        break;
+      case Op::kArray:
+        if (!type->IsArray()) {
+          return absl::InvalidArgumentError(
+              absl::StrFormat("Expected array type of array.%d", id));
+        }
+        bvalue = fb->Array(operands, type->AsArrayOrDie()->element_type(), loc);
+        break;
+      case Op::kTupleIndex: {
+        XLS_ASSIGN_OR_RETURN(int64 index, reader_->ReadCount());
+        XLS_RETURN_IF_ERROR(expect_operand_count(1));
+        if (!operand_type_is(0, TypeKind::kTuple)) {
+          return absl::InvalidArgumentError(absl::StrFormat(
+              "Operand of tuple_index.%d is not a tuple", id));
+        }
+        if (index >= operands[0].GetType()->AsTupleOrDie()->size()) {
+          return absl::InvalidArgumentError(absl::StrFormat(
+              "Index of tuple_index.%d is out of bounds", id));
+        }
+        bvalue = fb->TupleIndex(operands[0], index, loc);
+        break;
+      }
+      case Op::kArrayIndex:
+        XLS_RETURN_IF_ERROR(expect_operand_count(2));
+        if (!operand_type_is(0, TypeKind::kArray)) {
+          return absl::InvalidArgumentError(absl::StrFormat(
+              "Operand of array_index.%d is not an array", id));
+        }
+        bvalue = fb->ArrayIndex(operands[0], operands[1], loc);
+        break;
+      case Op::kArrayUpdate:
+        XLS_RETURN_IF_ERROR(expect_operand_count(3));
+        if (!operand_type_is(0, TypeKind::kArray) ||
+            operands[2].GetType() !=
+                operands[0].GetType()->AsArrayOrDie()->element_type()) {
+          return absl::InvalidArgumentError(absl::StrFormat(
+              "Invalid operand types of array_update.%d", id));
+        }
+        bvalue = fb->ArrayUpdate(operands[0], operands[1], operands[2], loc);
+        break;
+      case Op::kArrayConcat:
+        if (!type->IsArray()) {
+          return absl::InvalidArgumentError(
+              absl::StrFormat("Expected array type of array_concat.%d", id));
+        }
+        XLS_RETURN_IF_ERROR(expect_operands(1, kVariadic));
+        bvalue = fb->ArrayConcat(operands, loc);
+        break;
+      case Op::kZeroExt:
+      case Op::kSignExt: {
+        XLS_ASSIGN_OR_RETURN(int64 new_bit_count, reader_->ReadCount());
+        XLS_RETURN_IF_ERROR(expect_operand_count(1));
+        bvalue = op == Op::kZeroExt
+                     ? fb->ZeroExtend(operands[0], new_bit_count, loc)
+                     : fb->SignExtend(operands[0], new_bit_count, loc);
+        break;
+      }
+      case Op::kEncode:
+        XLS_RETURN_IF_ERROR(expect_operand_count(1));
+        if (!operand_type_is(0, TypeKind::kBits)) {
+          return absl::InvalidArgumentError(
+              absl::StrFormat("Operand of encode.%d is not bits", id));
+        }
+        bvalue = fb->Encode(operands[0], loc);
+        break;
+      case Op::kDecode: {
+        XLS_ASSIGN_OR_RETURN(int64 width, reader_->ReadCount());
+        XLS_RETURN_IF_ERROR(expect_operand_count(1));
+        bvalue = fb->Decode(operands[0], width, loc);
+        break;
+      }
+      case Op::kSMul:
+      case Op::kUMul:
+        XLS_RETURN_IF_ERROR(expect_operand_count(2));
+        if (!type->IsBits()) {
+          return absl::InvalidArgumentError(absl::StrFormat(
+              "Expected bits type of %s.%d", OpToString(op), id));
+        }
+        bvalue = fb->AddArithOp(op, operands[0], operands[1],
+                                type->AsBitsOrDie()->bit_count(), loc);
+        break;
+      case Op::kReceive: {
+        XLS_ASSIGN_OR_RETURN(Channel * channel, get_channel());
+        XLS_RETURN_IF_ERROR(expect_operand_count(1));
+        bvalue = fb->Receive(channel, operands[0], loc);
+        break;
+      }
+      case Op::kReceiveIf: {
+        XLS_ASSIGN_OR_RETURN(Channel * channel, get_channel());
+        XLS_RETURN_IF_ERROR(expect_operand_count(2));
+        bvalue = fb->ReceiveIf(channel, operands[0], operands[1], loc);
+        break;
+      }
+      case Op::kSend: {
+        XLS_ASSIGN_OR_RETURN(Channel * channel, get_channel());
+        XLS_RETURN_IF_ERROR(expect_operands(1, kVariadic));
+        bvalue = fb->Send(channel, operands[0],
+                          absl::MakeSpan(operands).subspan(1), loc);
+        break;
+      }
+      case Op::kSendIf: {
+        XLS_ASSIGN_OR_RETURN(Channel * channel, get_channel());
+        XLS_RETURN_IF_ERROR(expect_operands(2, kVariadic));
+        bvalue = fb->SendIf(channel, operands[0], operands[1],
+                            absl::MakeSpan(operands).subspan(2), loc);
+        break;
+      }
+      default:
+        if (IsOpClass<BinOp>(op) || IsOpClass<CompareOp>(op)) {
+          XLS_RETURN_IF_ERROR(expect_operand_count(2));
+          bvalue = IsOpClass<BinOp>(op)
+                       ? fb->AddBinOp(op, operands[0], operands[1], loc)
+                       : fb->AddCompareOp(op, operands[0], operands[1], loc);
+        } else if (IsOpClass<UnOp>(op) || IsOpClass<BitwiseReductionOp>(op)) {
+          XLS_RETURN_IF_ERROR(expect_operand_count(1));
+          bvalue = IsOpClass<UnOp>(op)
+                       ? fb->AddUnOp(op, operands[0], loc)
+                       : fb->AddBitwiseReductionOp(op, operands[0], loc);
+        } else if (IsOpClass<NaryOp>(op)) {
+          XLS_RETURN_IF_ERROR(expect_operands(1, kVariadic));
+          bvalue = fb->AddNaryOp(op, operands, loc);
+        } else {
+          return absl::InvalidArgumentError(absl::StrFormat(
+              "Invalid operation in binary IR: \"%s\"", OpToString(op)));
+        }
+    }
+
+    if (bvalue.valid()) {
+      if (bvalue.GetType() != type) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Node %s.%d has type %s, expected %s", OpToString(op), id,
+            bvalue.GetType()->ToString(), type->ToString()));
+      }
+      bvalue.node()->set_id(id);
+    }
+    return bvalue;
+  }
+
+  BinaryIrReader* reader_;
+  Package* package_;
+
+  // The string table of the package. The strings refer into the input.
+  std::vector<absl::string_view> strings_;
+
+  // The op named by each entry of the string table, filled in on first use.
+  std::vector<absl::optional<Op>> ops_;
+
+  std::vector<Type*> types_;
+  std::vector<Function*> functions_;
+};
+
+}  // namespace
+
+/* static */
+absl::StatusOr<std::pair<std::string, absl::optional<std::string>>>
+Parser::ParseBinaryPackageHeader(BinaryIrReader* reader) {
+  XLS_ASSIGN_OR_RETURN(absl::string_view magic,
+                       reader->ReadBytes(kBinaryIrMagic.size()));
+  if (magic != kBinaryIrMagic) {
+    return absl::InvalidArgumentError("Input is not a binary IR package");
+  }
+  XLS_ASSIGN_OR_RETURN(uint64 version, reader->ReadUnsigned());
+  if (version != kBinaryIrVersion) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Unsupported binary IR version %d (expected %d)",
+                        version, kBinaryIrVersion));
+  }
+  XLS_ASSIGN_OR_RETURN(absl::string_view name, reader->ReadString());
+  XLS_ASSIGN_OR_RETURN(uint64 has_entry, reader->ReadUnsigned());
+  absl::optional<std::string> entry;
+  if (has_entry) {
+    XLS_ASSIGN_OR_RETURN(absl::string_view entry_name, reader->ReadString());
+    entry = std::string(entry_name);
+  }
+  return std::make_pair(std::string(name), entry);
+}
+
+/* static */
+absl::Status Parser::ParseBinaryPackageItems(BinaryIrReader* reader,
+                                             Package* package) {
+  return BinaryPackageParser(reader, package).Parse();
+}
+
 /* static */ absl::StatusOr<FunctionType*> Parser::ParseFunctionType(
     absl::string_view input_string, Package* package) {
   XLS_ASSIGN_OR_RETURN(auto scanner, Scanner::Create(input_string));
@@ -1262,6 +2109,28 @@ absl::StatusOr<std::unique_ptr<Package>> Parser::ParsePackageWithEntry(
   return package;
 }
 
+/* static */
+absl::StatusOr<std::unique_ptr<Package>> Parser::ParsePackageFile(
+    absl::string_view path, absl::optional<absl::string_view> entry,
+    int64 thread_count) {
+  XLS_ASSIGN_OR_RETURN(MemoryMappedFile file,
+                       MemoryMappedFile::Open(std::string(path)));
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                       ParseDerivedPackageNoVerify<Package>(
+                           file.contents(), path, entry, thread_count));
+  XLS_RETURN_IF_ERROR(VerifyAndSwapError(package.get()));
+  return package;
+}
+
+/* static */
+absl::StatusOr<std::unique_ptr<Package>> Parser::ParseBinaryPackage(
+    absl::string_view data, absl::optional<absl::string_view> entry) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                       ParseDerivedBinaryPackageNoVerify<Package>(data, entry));
+  XLS_RETURN_IF_ERROR(VerifyAndSwapError(package.get()));
+  return package;
+}
+
 /* static */
 absl::StatusOr<std::unique_ptr<Package>> Parser::ParsePackageNoVerify(
     absl::string_view input_string, absl::optional<absl::string_view> filename,
@@ -26,12 +26,15 @@
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/ir/channel.h"
 #include "xls/ir/function.h"
 #include "xls/ir/function_builder.h"
+#include "xls/ir/ir_binary_format.h"
 #include "xls/ir/ir_scanner.h"
 #include "xls/ir/node.h"
 #include "xls/ir/nodes.h"
@@ -45,7 +48,9 @@ class ArgParser;
 
 class Parser {
  public:
-  // Parses the given input string as a package.
+  // Parses the given input string as a package. The package parsing functions
+  // also accept packages in the binary IR format (see ir_binary_format.h),
+  // which are recognized by their leading kBinaryIrMagic.
   static absl::StatusOr<std::unique_ptr<Package>> ParsePackage(
       absl::string_view input_string,
       absl::optional<absl::string_view> filename = absl::nullopt);
@@ -56,6 +61,20 @@ class Parser {
       absl::string_view input_string, absl::string_view entry,
       absl::optional<absl::string_view> filename = absl::nullopt);
 
+  // Parses the IR file at the given path as a package, optionally setting the
+  // entry function. The file is memory mapped and its tokens refer directly
+  // into the mapping. See ParseDerivedPackageNoVerify for 'thread_count'.
+  static absl::StatusOr<std::unique_ptr<Package>> ParsePackageFile(
+      absl::string_view path,
+      absl::optional<absl::string_view> entry = absl::nullopt,
+      int64 thread_count = 1);
+
+  // Parses a package in the binary IR format written by Package::Serialize. If
+  // 'entry' is given it replaces the entry function recorded in the package.
+  static absl::StatusOr<std::unique_ptr<Package>> ParseBinaryPackage(
+      absl::string_view data,
+      absl::optional<absl::string_view> entry = absl::nullopt);
+
   // Parse the input_string as a function into the given package.
   static absl::StatusOr<Function*> ParseFunction(absl::string_view input_string,
                                                  Package* package);
@@ -85,10 +104,26 @@ class Parser {
 
   // As above but creates a package of type PackageT where PackageT must be
   // type derived from Package.
+  //
+  // If 'thread_count' is greater than one, the functions and procs of the
+  // package are parsed concurrently on up to that many threads: a function is
+  // parsed once the functions it invokes have been parsed. The resulting
+  // package (including node ids) is the same as with sequential parsing. If
+  // concurrent parsing fails, the package is parsed again sequentially so
+  // errors are reported identically.
   template <typename PackageT>
   static absl::StatusOr<std::unique_ptr<PackageT>> ParseDerivedPackageNoVerify(
       absl::string_view input_string,
       absl::optional<absl::string_view> filename = absl::nullopt,
+      absl::optional<absl::string_view> entry = absl::nullopt,
+      int64 thread_count = 1);
+
+  // As ParseBinaryPackage but skips verification and creates a package of type
+  // PackageT.
+  template <typename PackageT>
+  static absl::StatusOr<std::unique_ptr<PackageT>>
+  ParseDerivedBinaryPackageNoVerify(
+      absl::string_view data,
       absl::optional<absl::string_view> entry = absl::nullopt);
 
   // Parses a literal value that should be of type "expected_type" and returns
@@ -115,6 +150,41 @@ class Parser {
   // Parse a proc starting at the current scanner position.
   absl::StatusOr<Proc*> ParseProc(Package* package);
 
+  // As ParseFunction and ParseProc but without building the function (proc),
+  // i.e., without adding it to the package. Returns the builder and the return
+  // value of the function (proc).
+  absl::StatusOr<std::pair<std::unique_ptr<FunctionBuilder>, BValue>>
+  ParseFunctionDefinition(Package* package);
+  absl::StatusOr<std::pair<std::unique_ptr<ProcBuilder>, BValue>>
+  ParseProcDefinition(Package* package);
+
+  // Parses the function, proc and channel definitions following the package
+  // name. Errors are annotated with the given filename.
+  absl::Status ParsePackageItems(Package* package, absl::string_view filename);
+
+  // As ParsePackageItems but parses the function and proc definitions on up to
+  // 'thread_count' threads. Returns an error if parsing fails or if the
+  // package is not amenable to concurrent parsing (e.g., a function invokes a
+  // function which is not defined before it). Errors are not meant to be
+  // reported to the user; instead the package should be parsed again
+  // sequentially.
+  absl::Status ParsePackageItemsConcurrently(Package* package,
+                                             int64 thread_count);
+
+  // Reads the header of a binary package and returns the package name and
+  // entry function.
+  static absl::StatusOr<std::pair<std::string, absl::optional<std::string>>>
+  ParseBinaryPackageHeader(BinaryIrReader* reader);
+
+  // Reads the remainder of a binary package into 'package'.
+  static absl::Status ParseBinaryPackageItems(BinaryIrReader* reader,
+                                              Package* package);
+
+  // Returns the function with the given name invoked by the function being
+  // parsed.
+  absl::StatusOr<Function*> GetInvokedFunction(Package* package,
+                                               absl::string_view name);
+
   // Parse a proc starting at the current scanner position.
   absl::StatusOr<Channel*> ParseChannel(Package* package);
 
@@ -210,41 +280,45 @@ class Parser {
   bool AtEof() const { return scanner_.AtEof(); }
 
   Scanner scanner_;
+
+  // If non-null, the functions which may be invoked by the function being
+  // parsed, indexed by name. Otherwise invoked functions are looked up in the
+  // package.
+  const absl::flat_hash_map<std::string, Function*>* invoked_functions_ =
+      nullptr;
+
+  // If non-null, nodes whose ids are suggested by their names in the IR text
+  // are added to this set.
+  absl::flat_hash_set<Node*>* suggested_id_nodes_ = nullptr;
 };
 
 /* static */
 template <typename PackageT>
 absl::StatusOr<std::unique_ptr<PackageT>> Parser::ParseDerivedPackageNoVerify(
     absl::string_view input_string, absl::optional<absl::string_view> filename,
-    absl::optional<absl::string_view> entry) {
+    absl::optional<absl::string_view> entry, int64 thread_count) {
+  if (IsBinaryIr(input_string)) {
+    return ParseDerivedBinaryPackageNoVerify<PackageT>(input_string, entry);
+  }
   XLS_ASSIGN_OR_RETURN(auto scanner, Scanner::Create(input_string));
   Parser parser(std::move(scanner));
 
   XLS_ASSIGN_OR_RETURN(std::string package_name, parser.ParsePackageName());
 
   auto package = absl::make_unique<PackageT>(package_name, entry);
-  std::string filename_str =
-      (filename.has_value() ? std::string(filename.value()) : "<unknown file>");
-  while (!parser.AtEof()) {
-    XLS_ASSIGN_OR_RETURN(Token peek, parser.scanner_.PeekToken());
-    if (peek.type() == LexicalTokenType::kKeyword && peek.value() == "fn") {
-      XLS_RETURN_IF_ERROR(parser.ParseFunction(package.get()).status())
-          << "@ " << filename_str;
-      continue;
-    }
-    if (peek.type() == LexicalTokenType::kKeyword && peek.value() == "proc") {
-      XLS_RETURN_IF_ERROR(parser.ParseProc(package.get()).status())
-          << "@ " << filename_str;
-      continue;
-    }
-    if (peek.type() == LexicalTokenType::kKeyword && peek.value() == "chan") {
-      XLS_RETURN_IF_ERROR(parser.ParseChannel(package.get()).status())
-          << "@ " << filename_str;
-      continue;
+  bool parsed = false;
+  if (thread_count > 1) {
+    Parser concurrent_parser = parser;
+    parsed = concurrent_parser
+                 .ParsePackageItemsConcurrently(package.get(), thread_count)
+                 .ok();
+    if (!parsed) {
+      package = absl::make_unique<PackageT>(package_name, entry);
     }
-    return absl::InvalidArgumentError(
-        absl::StrFormat("Expected fn, proc, or chan definition, got %s @ %s",
-                        peek.value(), peek.pos().ToHumanString()));
+  }
+  if (!parsed) {
+    XLS_RETURN_IF_ERROR(parser.ParsePackageItems(
+        package.get(), filename.value_or("<unknown file>")));
   }
 
   // Ensure that, if there were explicit node ID hints in the input IR text,
@@ -264,6 +338,27 @@ absl::StatusOr<std::unique_ptr<PackageT>> Parser::ParseDerivedPackageNoVerify(
   return package;
 }
 
+/* static */
+template <typename PackageT>
+absl::StatusOr<std::unique_ptr<PackageT>>
+Parser::ParseDerivedBinaryPackageNoVerify(
+    absl::string_view data, absl::optional<absl::string_view> entry) {
+  BinaryIrReader reader(data);
+  XLS_ASSIGN_OR_RETURN(auto header, ParseBinaryPackageHeader(&reader));
+  absl::optional<absl::string_view> package_entry = entry;
+  if (!package_entry.has_value() && header.second.has_value()) {
+    package_entry = *header.second;
+  }
+  auto package = absl::make_unique<PackageT>(header.first, package_entry);
+  XLS_RETURN_IF_ERROR(ParseBinaryPackageItems(&reader, package.get()));
+
+  // Verify the given entry function exists in the package.
+  if (entry.has_value()) {
+    XLS_RETURN_IF_ERROR(package->GetFunction(*entry).status());
+  }
+  return package;
+}
+
 }  // namespace xls
 
 #endif  // XLS_IR_IR_PARSER_H_
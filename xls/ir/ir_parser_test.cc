@@ -14,12 +14,17 @@
 
 #include "xls/ir/ir_parser.h"
 
+#include <algorithm>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/status/status.h"
 #include "absl/strings/substitute.h"
+#include "xls/common/file/temp_file.h"
 #include "xls/common/status/matchers.h"
 #include "xls/ir/bits_ops.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_binary_format.h"
 #include "xls/ir/number_parser.h"
 
 namespace xls {
@@ -1941,4 +1946,398 @@ fn f(x: bits[4], y: bits[4][1]) -> bits[4][1] {
                        HasSubstr("Decode argument must be of Bits type")));
 }
 
+// Parses the given package text sequentially and concurrently and verifies the
+// resulting packages are the same, including node ids.
+void ExpectConcurrentParseMatchesSequential(absl::string_view text) {
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<Package> sequential,
+      Parser::ParseDerivedPackageNoVerify<Package>(text));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<Package> concurrent,
+      Parser::ParseDerivedPackageNoVerify<Package>(
+          text, /*filename=*/absl::nullopt, /*entry=*/absl::nullopt,
+          /*thread_count=*/4));
+  EXPECT_EQ(concurrent->DumpIr(), sequential->DumpIr());
+  EXPECT_EQ(concurrent->next_node_id(), sequential->next_node_id());
+  std::vector<Function*> sequential_functions =
+      sequential->GetFunctionsAndProcs();
+  std::vector<Function*> concurrent_functions =
+      concurrent->GetFunctionsAndProcs();
+  ASSERT_EQ(concurrent_functions.size(), sequential_functions.size());
+  for (int64 i = 0; i < sequential_functions.size(); ++i) {
+    std::vector<int64> sequential_ids;
+    for (Node* node : sequential_functions[i]->nodes()) {
+      sequential_ids.push_back(node->id());
+    }
+    std::vector<int64> concurrent_ids;
+    for (Node* node : concurrent_functions[i]->nodes()) {
+      concurrent_ids.push_back(node->id());
+    }
+    EXPECT_EQ(concurrent_ids, sequential_ids)
+        << sequential_functions[i]->name();
+  }
+}
+
+TEST(IrParserTest, ParsePackageConcurrently) {
+  std::string program = R"(
+package test
+
+chan ch(data: bits[32], id=0, kind=send_receive, metadata="""module_port { flopped: true }""")
+
+fn square(x: bits[32]) -> bits[32] {
+  ret umul.1: bits[32] = umul(x, x)
+}
+
+fn body(i: bits[32], accum: bits[32]) -> bits[32] {
+  ret add.3: bits[32] = add(i, accum)
+}
+
+fn unrelated(a: bits[8], b: bits[8]) -> bits[8] {
+  sum: bits[8] = add(a, b)
+  ret and.5: bits[8] = and(sum, a)
+}
+
+fn main(x: bits[32], y: bits[32][4]) -> (bits[32], bits[32][4]) {
+  squared: bits[32] = invoke(x, to_apply=square)
+  map.7: bits[32][4] = map(y, to_apply=square)
+  loop: bits[32] = counted_for(squared, trip_count=4, body=body)
+  ret tuple.9: (bits[32], bits[32][4]) = tuple(loop, map.7)
+}
+
+proc my_proc(my_state: bits[32], my_token: token, init=42) {
+  send.20: token = send(my_token, data=[my_state], channel_id=0)
+  receive.21: (token, bits[32]) = receive(send.20, channel_id=0)
+  tuple_index.22: token = tuple_index(receive.21, index=0)
+  squared: bits[32] = invoke(my_state, to_apply=square)
+  ret tuple.24: (bits[32], token) = tuple(squared, tuple_index.22)
+}
+)";
+  ExpectConcurrentParseMatchesSequential(program);
+}
+
+TEST(IrParserTest, ParseManyFunctionsConcurrently) {
+  // A chain of functions each invoking the previous one, interleaved with
+  // independent functions. Node names without ids get ids by creation order.
+  std::string program = "package test\n";
+  for (int64 i = 0; i < 50; ++i) {
+    absl::StrAppendFormat(&program, R"(
+fn leaf_%d(x: bits[16]) -> bits[16] {
+  a: bits[16] = not(x)
+  ret b: bits[16] = neg(a)
+}
+)",
+                          i);
+    if (i == 0) {
+      absl::StrAppendFormat(&program, R"(
+fn chain_0(x: bits[16]) -> bits[16] {
+  ret id.%d: bits[16] = identity(x)
+}
+)",
+                            1000);
+    } else {
+      absl::StrAppendFormat(&program, R"(
+fn chain_%d(x: bits[16]) -> bits[16] {
+  c: bits[16] = invoke(x, to_apply=chain_%d)
+  ret d: bits[16] = invoke(c, to_apply=leaf_%d)
+}
+)",
+                            i, i - 1, i);
+    }
+  }
+  ExpectConcurrentParseMatchesSequential(program);
+}
+
+TEST(IrParserTest, ConcurrentParseErrorsMatchSequential) {
+  // The function is invoked before it is defined.
+  std::string program = R"(
+package test
+
+fn main(x: bits[32]) -> bits[32] {
+  ret invoke.1: bits[32] = invoke(x, to_apply=square)
+}
+
+fn square(x: bits[32]) -> bits[32] {
+  ret umul.2: bits[32] = umul(x, x)
+}
+)";
+  absl::Status sequential_status =
+      Parser::ParseDerivedPackageNoVerify<Package>(program).status();
+  EXPECT_THAT(sequential_status, StatusIs(absl::StatusCode::kNotFound,
+                                          HasSubstr("square")));
+  EXPECT_EQ(Parser::ParseDerivedPackageNoVerify<Package>(
+                program, /*filename=*/absl::nullopt, /*entry=*/absl::nullopt,
+                /*thread_count=*/4)
+                .status(),
+            sequential_status);
+
+  // A malformed function body.
+  program = R"(
+package test
+
+fn f(x: bits[32]) -> bits[32] {
+  ret add.1: bits[32] = add(x, y)
+}
+)";
+  sequential_status =
+      Parser::ParseDerivedPackageNoVerify<Package>(program).status();
+  EXPECT_THAT(sequential_status,
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("not previously defined")));
+  EXPECT_EQ(Parser::ParseDerivedPackageNoVerify<Package>(
+                program, /*filename=*/absl::nullopt, /*entry=*/absl::nullopt,
+                /*thread_count=*/4)
+                .status(),
+            sequential_status);
+}
+
+TEST(IrParserTest, ParsePackageFile) {
+  std::string program = R"(package test
+
+fn square(x: bits[32]) -> bits[32] {
+  ret umul.1: bits[32] = umul(x, x)
+}
+
+fn main(x: bits[32]) -> bits[32] {
+  ret invoke.3: bits[32] = invoke(x, to_apply=square)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(TempFile temp_file,
+                           TempFile::CreateWithContent(program));
+  for (int64 thread_count : {1, 2}) {
+    XLS_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<Package> package,
+        Parser::ParsePackageFile(temp_file.path().string(), "main",
+                                 thread_count));
+    EXPECT_EQ(package->DumpIr(), program);
+    XLS_ASSERT_OK_AND_ASSIGN(Function * entry, package->EntryFunction());
+    EXPECT_EQ(entry->name(), "main");
+  }
+  EXPECT_THAT(Parser::ParsePackageFile("/does/not/exist.ir").status(),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+// Serializes the package parsed from the given text in the binary format and
+// verifies that parsing the binary package reconstructs it exactly.
+void ExpectBinaryRoundTrip(absl::string_view text) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(text));
+  std::string binary = package->Serialize();
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> parsed,
+                           Parser::ParseBinaryPackage(binary));
+  EXPECT_EQ(parsed->DumpIr(), package->DumpIr());
+  EXPECT_EQ(parsed->next_node_id(), package->next_node_id());
+  std::vector<Function*> functions = package->GetFunctionsAndProcs();
+  std::vector<Function*> parsed_functions = parsed->GetFunctionsAndProcs();
+  ASSERT_EQ(parsed_functions.size(), functions.size());
+  for (int64 i = 0; i < functions.size(); ++i) {
+    std::vector<int64> ids;
+    for (Node* node : functions[i]->nodes()) {
+      ids.push_back(node->id());
+    }
+    std::vector<int64> parsed_ids;
+    for (Node* node : parsed_functions[i]->nodes()) {
+      parsed_ids.push_back(node->id());
+    }
+    // Nodes are written in topological order which may differ from the order
+    // of the original node list.
+    std::sort(ids.begin(), ids.end());
+    std::sort(parsed_ids.begin(), parsed_ids.end());
+    EXPECT_EQ(parsed_ids, ids) << functions[i]->name();
+  }
+  EXPECT_EQ(parsed->Serialize(), binary);
+}
+
+TEST(IrParserTest, BinaryRoundTripAllOps) {
+  std::string program = R"(
+package test
+
+fn square(x: bits[32]) -> bits[32] {
+  ret umul.1: bits[32] = umul(x, x)
+}
+
+fn body(i: bits[32], accum: bits[32], inv: bits[32]) -> bits[32] {
+  add.3: bits[32] = add(i, accum, pos=0,3,4)
+  ret xor.4: bits[32] = xor(add.3, inv)
+}
+
+fn main(x: bits[32], y: bits[32][4], p: bits[2], t: (bits[8], bits[200])) -> (bits[32], bits[32][4], bits[2000]) {
+  invoke.10: bits[32] = invoke(x, to_apply=square, pos=1,2,3)
+  map.11: bits[32][4] = map(y, to_apply=square)
+  counted_for.12: bits[32] = counted_for(invoke.10, trip_count=4, stride=2, body=body, invariant_args=[x])
+  literal.13: bits[2000] = literal(value=0x123456789abcdef0123456789abcdef0123456789abcdef)
+  literal.14: (bits[8], bits[1][2]) = literal(value=(0xff, [0, 1]))
+  bit_slice.15: bits[3] = bit_slice(x, start=4, width=3)
+  dynamic_bit_slice.16: bits[5] = dynamic_bit_slice(x, p, width=5)
+  concat.17: bits[40] = concat(x, bit_slice.15, dynamic_bit_slice.16)
+  one_hot.18: bits[3] = one_hot(p, lsb_prio=true)
+  one_hot.19: bits[3] = one_hot(p, lsb_prio=false)
+  one_hot_sel.20: bits[32] = one_hot_sel(p, cases=[x, counted_for.12])
+  sel.21: bits[32] = sel(p, cases=[x, invoke.10, x, counted_for.12])
+  sel.22: bits[32] = sel(p, cases=[x], default=invoke.10)
+  tuple_index.23: bits[200] = tuple_index(t, index=1)
+  array_index.24: bits[32] = array_index(y, p)
+  array_update.25: bits[32][4] = array_update(map.11, p, sel.22)
+  array.26: bits[32][2] = array(sel.21, one_hot_sel.20)
+  array_concat.27: bits[32][6] = array_concat(array.26, array_update.25)
+  sign_ext.28: bits[64] = sign_ext(x, new_bit_count=64)
+  zero_ext.29: bits[64] = zero_ext(x, new_bit_count=64)
+  encode.30: bits[2] = encode(one_hot.18)
+  decode.31: bits[4] = decode(p, width=4)
+  smul.32: bits[64] = smul(x, x)
+  not.33: bits[32] = not(x)
+  neg.34: bits[32] = neg(not.33)
+  and_reduce.35: bits[1] = and_reduce(x)
+  ult.36: bits[1] = ult(x, invoke.10)
+  nand.37: bits[1] = nand(and_reduce.35, ult.36, and_reduce.35)
+  shrl.38: bits[32] = shrl(x, p)
+  identity.39: bits[32] = identity(neg.34)
+  reverse.40: bits[32] = reverse(identity.39)
+  tuple.41: (bits[1], bits[64], bits[64], bits[2], bits[4], bits[32], bits[32][6], bits[3], bits[40], bits[3]) = tuple(nand.37, sign_ext.28, zero_ext.29, encode.30, decode.31, shrl.38, array_concat.27, one_hot.19, concat.17, bit_slice.15)
+  tuple_index.42: bits[64] = tuple_index(tuple.41, index=1)
+  ret tuple.43: (bits[32], bits[32][4], bits[2000]) = tuple(reverse.40, array_update.25, literal.13)
+}
+)";
+  ExpectBinaryRoundTrip(program);
+}
+
+TEST(IrParserTest, BinaryRoundTripProcs) {
+  std::string program = R"(
+package test
+
+chan hbo(junk: bits[32], garbage: bits[1], id=0, kind=receive_only,
+            metadata="module_port { flopped: true }")
+chan mtv(stuff: bits[32], zzz: bits[1], id=1, kind=send_only,
+            metadata="module_port { flopped: false }")
+chan loop(data: bits[32], id=5, kind=send_receive, metadata="")
+
+proc my_proc(my_state: bits[32], my_token: token, init=42) {
+  literal.1: bits[1] = literal(value=1)
+  receive_if.2: (token, bits[32], bits[1]) = receive_if(my_token, literal.1, channel_id=0)
+  tuple_index.3: token = tuple_index(receive_if.2, index=0)
+  tuple_index.4: bits[32] = tuple_index(receive_if.2, index=1)
+  tuple_index.5: bits[1] = tuple_index(receive_if.2, index=2)
+  send_if.6: token = send_if(tuple_index.3, literal.1, data=[tuple_index.4, tuple_index.5], channel_id=1)
+  send.7: token = send(send_if.6, data=[my_state], channel_id=5)
+  receive.8: (token, bits[32]) = receive(send.7, channel_id=5)
+  tuple_index.9: token = tuple_index(receive.8, index=0)
+  after_all.10: token = after_all(tuple_index.9, send_if.6)
+  ret tuple.11: (bits[32], token) = tuple(my_state, after_all.10)
+}
+
+proc other(st: (bits[8], bits[2][2]), tok: token, init=(3, [1, 2])) {
+  ret tuple.20: ((bits[8], bits[2][2]), token) = tuple(st, tok)
+}
+)";
+  ExpectBinaryRoundTrip(program);
+}
+
+TEST(IrParserTest, BinaryPackageKeepsWhatTextLoses) {
+  Package package("test", /*entry=*/"f");
+  SourceLocation loc = package.AddSourceLocation("foo.x", Lineno(7), Colno(2));
+  FunctionBuilder fb("f", &package);
+  BValue x = fb.Param("x", package.GetBitsType(8), loc);
+  BValue y = fb.Param("y", package.GetBitsType(8));
+  XLS_ASSERT_OK(fb.BuildWithReturnValue(fb.Add(x, y)).status());
+  package.set_next_node_id(100);
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> parsed,
+                           Parser::ParseBinaryPackage(package.Serialize()));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * entry, parsed->EntryFunction());
+  EXPECT_EQ(entry->name(), "f");
+  EXPECT_EQ(parsed->next_node_id(), 100);
+  EXPECT_EQ(entry->param(0)->id(), x.node()->id());
+  EXPECT_EQ(entry->param(1)->id(), y.node()->id());
+  ASSERT_TRUE(entry->param(0)->loc().has_value());
+  EXPECT_EQ(parsed->SourceLocationToString(*entry->param(0)->loc()),
+            "foo.x:7");
+
+  // The entry function may be overridden.
+  EXPECT_THAT(
+      Parser::ParseBinaryPackage(package.Serialize(), "g").status(),
+      StatusIs(absl::StatusCode::kNotFound, HasSubstr("g")));
+}
+
+TEST(IrParserTest, ParsePackageAcceptsBinary) {
+  std::string program = R"(package test
+
+fn square(x: bits[32]) -> bits[32] {
+  ret umul.1: bits[32] = umul(x, x)
+}
+
+fn main(x: bits[32]) -> bits[32] {
+  ret invoke.3: bits[32] = invoke(x, to_apply=square)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(program));
+  std::string binary = package->Serialize();
+  EXPECT_TRUE(IsBinaryIr(binary));
+  EXPECT_FALSE(IsBinaryIr(program));
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> parsed,
+                           Parser::ParsePackage(binary));
+  EXPECT_EQ(parsed->DumpIr(), program);
+  XLS_ASSERT_OK_AND_ASSIGN(parsed,
+                           Parser::ParsePackageWithEntry(binary, "square"));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * entry, parsed->EntryFunction());
+  EXPECT_EQ(entry->name(), "square");
+
+  XLS_ASSERT_OK_AND_ASSIGN(TempFile temp_file,
+                           TempFile::CreateWithContent(binary));
+  XLS_ASSERT_OK_AND_ASSIGN(
+      parsed, Parser::ParsePackageFile(temp_file.path().string(), "main"));
+  EXPECT_EQ(parsed->DumpIr(), program);
+}
+
+TEST(IrParserTest, MalformedBinaryPackage) {
+  std::string program = R"(
+package test
+
+chan ch(data: bits[32], id=0, kind=send_only, metadata="")
+
+fn f(x: bits[32], y: (bits[32], bits[1][3])) -> bits[32] {
+  literal.3: bits[32] = literal(value=7)
+  tuple_index.4: bits[32] = tuple_index(y, index=0)
+  ret add.5: bits[32] = add(literal.3, tuple_index.4, pos=0,1,2)
+}
+
+proc p(s: bits[32], t: token, init=1) {
+  send.10: token = send(t, data=[s], channel_id=0)
+  ret tuple.11: (bits[32], token) = tuple(s, send.10)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(program));
+  std::string binary = package->Serialize();
+
+  // Every truncation of the package is rejected.
+  for (int64 size = kBinaryIrMagic.size(); size < binary.size(); ++size) {
+    EXPECT_THAT(Parser::ParseBinaryPackage(binary.substr(0, size)).status(),
+                StatusIs(absl::StatusCode::kInvalidArgument))
+        << size;
+  }
+  EXPECT_THAT(Parser::ParseBinaryPackage(binary + "x").status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unexpected data")));
+  EXPECT_THAT(Parser::ParseBinaryPackage("package test").status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("not a binary IR package")));
+
+  std::string wrong_version = binary;
+  wrong_version[kBinaryIrMagic.size()] = 100;
+  EXPECT_THAT(Parser::ParseBinaryPackage(wrong_version).status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Unsupported binary IR version 100")));
+
+  // Corrupting any single byte results in an error or in some other package,
+  // but never in a crash.
+  for (int64 i = kBinaryIrMagic.size(); i < binary.size(); ++i) {
+    for (uint8 value : {0, 1, 2, 0x7f, 0x80, 0xff}) {
+      std::string corrupted = binary;
+      corrupted[i] = static_cast<char>(value);
+      Parser::ParseBinaryPackage(corrupted).status().IgnoreError();
+    }
+  }
+}
+
 }  // namespace xls
@@ -211,8 +211,8 @@ class Tokenizer {
   // starting at the current index. Current index is updated to one past the
   // last matching character. min_chars is the minimum number of characters
   // which are unconditionally captured.
-  absl::string_view CaptureWhile(std::function<bool(char)> test_f,
-                                 int64 min_chars = 0) {
+  template <typename TestT>
+  absl::string_view CaptureWhile(TestT test_f, int64 min_chars = 0) {
     int64 start = index();
     while (!EndOfString() &&
            ((index() < min_chars + start) || test_f(current()))) {
@@ -345,7 +345,10 @@ class Tokenizer {
   }
 
   // Returns the character at the current index.
-  char current() const { return str_.at(index_); }
+  char current() const {
+    XLS_DCHECK(!EndOfString());
+    return str_[index_];
+  }
 
   // Returns the character at the current index + 1, or nullopt if current index
   // + 1 is beyond the end of the string.
@@ -384,15 +387,17 @@ absl::StatusOr<std::vector<Token>> TokenizeString(absl::string_view str) {
 }
 
 absl::StatusOr<Scanner> Scanner::Create(absl::string_view text) {
-  XLS_ASSIGN_OR_RETURN(auto tokens, TokenizeString(text));
-  return Scanner(std::move(tokens));
+  XLS_ASSIGN_OR_RETURN(std::vector<Token> tokens, TokenizeString(text));
+  const int64 token_count = tokens.size();
+  return Scanner(std::make_shared<const std::vector<Token>>(std::move(tokens)),
+                 /*start=*/0, /*limit=*/token_count);
 }
 
 absl::StatusOr<Token> Scanner::PeekToken() const {
   if (AtEof()) {
     return absl::InvalidArgumentError("Expected token, but found EOF.");
   }
-  return tokens_[token_idx_];
+  return PeekTokenOrDie();
 }
 
 absl::StatusOr<Token> Scanner::PopTokenOrError(absl::string_view context) {
@@ -15,11 +15,13 @@
 #ifndef XLS_IR_IR_SCANNER_H_
 #define XLS_IR_IR_SCANNER_H_
 
+#include <memory>
 #include <string>
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "xls/common/integral_types.h"
 #include "xls/common/logging/logging.h"
 #include "xls/ir/bits.h"
@@ -58,6 +60,8 @@ struct TokenPos {
   std::string ToHumanString() const;
 };
 
+// A token of IR text. The value of the token refers into the scanned text (it is
+// not copied) so the text must outlive the token.
 class Token {
  public:
   // Returns the (singleton) set of keyword strings.
@@ -88,7 +92,7 @@ class Token {
       : type_(type), value_(value), pos_({lineno, colno}) {}
 
   LexicalTokenType type() const { return type_; }
-  const std::string& value() const { return value_; }
+  absl::string_view value() const { return value_; }
   const TokenPos& pos() const { return pos_; }
 
   // Returns the token as a (u)int64 value. Token must be a literal. The
@@ -112,7 +116,7 @@ class Token {
 
  private:
   LexicalTokenType type_;
-  std::string value_;
+  absl::string_view value_;
   TokenPos pos_;
 };
 
@@ -124,13 +128,27 @@ inline std::ostream& operator<<(std::ostream& os, const Token& token) {
 // Tokenizes the given string and returns the tokens. It maintains precise
 // source location information.  Right now this is a eager implementation - it
 // tokenizes the whole input. This can be easily changed later to a more demand
-// driven tokenization.
+// driven tokenization. The token values refer into 'str'.
 absl::StatusOr<std::vector<Token>> TokenizeString(absl::string_view str);
 
+// A cursor over the tokens of a string. The tokens refer into the scanned text,
+// which must outlive the scanner. Copies of a scanner (and scanners returned by
+// Subrange) share the underlying tokens.
 class Scanner {
  public:
   static absl::StatusOr<Scanner> Create(absl::string_view text);
 
+  // Returns a scanner over the tokens with indices in [start, limit) (as
+  // returned by token_index()) of the underlying token stream.
+  Scanner Subrange(int64 start, int64 limit) const {
+    XLS_CHECK_LE(start, limit);
+    XLS_CHECK_LE(limit, tokens_->size());
+    return Scanner(tokens_, start, limit);
+  }
+
+  // Returns the index of the current token in the underlying token stream.
+  int64 token_index() const { return token_idx_; }
+
   // Peeks at the next token in the token stream, or returns an error if we're
   // at EOF and no more tokens are available.
   absl::StatusOr<Token> PeekToken() const;
@@ -138,7 +156,7 @@ class Scanner {
   // Return the current token.
   const Token& PeekTokenOrDie() const {
     XLS_CHECK(!AtEof());
-    return tokens_[token_idx_];
+    return (*tokens_)[token_idx_];
   }
 
   // Helper that makes sure we don't peek past EOF.
@@ -148,8 +166,10 @@ class Scanner {
 
   // Pop the current token, advance token pointer to next token.
   Token PopToken() {
-    XLS_VLOG(3) << "Popping token: " << tokens_[token_idx_];
-    return tokens_.at(token_idx_++);
+    const Token& token = PeekTokenOrDie();
+    XLS_VLOG(3) << "Popping token: " << token;
+    ++token_idx_;
+    return token;
   }
 
   // Same as PopToken() but returns a status error if we are at EOF (in which
@@ -191,13 +211,16 @@ class Scanner {
   absl::Status DropKeywordOrError(absl::string_view keyword);
 
   // Check if more tokens are available.
-  bool AtEof() const { return token_idx_ >= tokens_.size(); }
+  bool AtEof() const { return token_idx_ >= token_limit_; }
 
  private:
-  explicit Scanner(std::vector<Token> tokens) : tokens_(tokens) {}
+  Scanner(std::shared_ptr<const std::vector<Token>> tokens, int64 start,
+          int64 limit)
+      : tokens_(std::move(tokens)), token_idx_(start), token_limit_(limit) {}
 
-  int64 token_idx_ = 0;
-  std::vector<Token> tokens_;
+  std::shared_ptr<const std::vector<Token>> tokens_;
+  int64 token_idx_;
+  int64 token_limit_;
 };
 
 }  // namespace xls
@@ -32,7 +32,7 @@ using testing::HasSubstr;
 std::vector<std::string> TokensToStrings(absl::Span<const Token> tokens) {
   std::vector<std::string> strs;
   for (const Token& token : tokens) {
-    strs.push_back(token.value());
+    strs.push_back(std::string(token.value()));
   }
   return strs;
 }
@@ -176,5 +176,30 @@ TEST(IrScannerTest, UnterminatedTripleQuotedStrings) {
                HasSubstr("Unterminated quoted string starting at 1:1")));
 }
 
+TEST(IrScannerTest, TokenValuesReferIntoText) {
+  const std::string text = "fn foo \"bar\"";
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<Token> tokens, TokenizeString(text));
+  ASSERT_EQ(tokens.size(), 3);
+  EXPECT_EQ(tokens[1].value().data(), text.data() + 3);
+  EXPECT_EQ(tokens[2].value().data(), text.data() + 8);
+}
+
+TEST(IrScannerTest, Subrange) {
+  XLS_ASSERT_OK_AND_ASSIGN(Scanner scanner, Scanner::Create("a b c d"));
+  scanner.DropTokenOrDie();
+  EXPECT_EQ(scanner.token_index(), 1);
+
+  Scanner subrange = scanner.Subrange(1, 3);
+  EXPECT_EQ(subrange.token_index(), 1);
+  EXPECT_EQ(subrange.PopToken().value(), "b");
+  EXPECT_EQ(subrange.PopToken().value(), "c");
+  EXPECT_TRUE(subrange.AtEof());
+  EXPECT_THAT(subrange.PeekToken(),
+              StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("EOF")));
+
+  // The original scanner is unaffected.
+  EXPECT_EQ(scanner.PopToken().value(), "b");
+}
+
 }  // namespace
 }  // namespace xls
@@ -68,9 +68,14 @@ absl::Status Node::AddNodeToFunctionAndReplace(
 void Node::AddUser(Node* user) {
   auto insert_result = users_set_.insert(user);
   if (insert_result.second) {
-    users_.push_back(user);
-    // Keep the users sequence sorted by ordinal for stability.
-    absl::c_sort(users_, [](Node* a, Node* b) { return a->id() < b->id(); });
+    // Keep the users sequence sorted by ordinal for stability. Inserting in
+    // place rather than re-sorting keeps adding many users to a single node
+    // (e.g., when commoning literals) from being quadratic.
+    users_.insert(absl::c_upper_bound(users_, user,
+                                      [](Node* a, Node* b) {
+                                        return a->id() < b->id();
+                                      }),
+                  user);
   }
 }
 
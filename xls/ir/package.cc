@@ -16,12 +16,15 @@
 
 #include <utility>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/common/strong_int.h"
 #include "xls/ir/function.h"
+#include "xls/ir/ir_binary_format.h"
+#include "xls/ir/node_iterator.h"
 #include "xls/ir/proc.h"
 #include "xls/ir/type.h"
 #include "xls/ir/value.h"
@@ -182,6 +185,7 @@ std::string Package::SourceLocationToString(const SourceLocation loc) {
 }
 
 BitsType* Package::GetBitsType(int64 bit_count) {
+  absl::MutexLock lock(&type_mutex_);
   if (bit_count_to_type_.find(bit_count) != bit_count_to_type_.end()) {
     return &bit_count_to_type_.at(bit_count);
   }
@@ -193,10 +197,11 @@ BitsType* Package::GetBitsType(int64 bit_count) {
 
 ArrayType* Package::GetArrayType(int64 size, Type* element_type) {
   ArrayKey key{size, element_type};
+  absl::MutexLock lock(&type_mutex_);
   if (array_types_.find(key) != array_types_.end()) {
     return &array_types_.at(key);
   }
-  XLS_CHECK(IsOwnedType(element_type))
+  XLS_CHECK(owned_types_.find(element_type) != owned_types_.end())
       << "Type is not owned by package: " << *element_type;
   auto it = array_types_.emplace(key, ArrayType(size, element_type));
   ArrayType* new_type = &(it.first->second);
@@ -206,11 +211,12 @@ ArrayType* Package::GetArrayType(int64 size, Type* element_type) {
 
 TupleType* Package::GetTupleType(absl::Span<Type* const> element_types) {
   TypeVec key(element_types.begin(), element_types.end());
+  absl::MutexLock lock(&type_mutex_);
   if (tuple_types_.find(key) != tuple_types_.end()) {
     return &tuple_types_.at(key);
   }
   for (const Type* element_type : element_types) {
-    XLS_CHECK(IsOwnedType(element_type))
+    XLS_CHECK(owned_types_.find(element_type) != owned_types_.end())
         << "Type is not owned by package: " << *element_type;
   }
   auto it = tuple_types_.emplace(key, TupleType(element_types));
@@ -224,11 +230,12 @@ TokenType* Package::GetTokenType() { return &token_type_; }
 FunctionType* Package::GetFunctionType(absl::Span<Type* const> args_types,
                                        Type* return_type) {
   std::string key = FunctionType(args_types, return_type).ToString();
+  absl::MutexLock lock(&type_mutex_);
   if (function_types_.find(key) != function_types_.end()) {
     return &function_types_.at(key);
   }
   for (Type* t : args_types) {
-    XLS_CHECK(IsOwnedType(t))
+    XLS_CHECK(owned_types_.find(t) != owned_types_.end())
         << "Parameter type is not owned by package: " << t->ToString();
   }
   auto it = function_types_.emplace(key, FunctionType(args_types, return_type));
@@ -370,6 +377,315 @@ std::string Package::DumpIr() const {
   return out;
 }
 
+namespace {
+
+// Writes the channels and functions of a package in the binary IR format. The
+// strings and types referred to are collected into tables which are emitted
+// ahead of the channels and functions by Finish.
+class PackageSerializer {
+ public:
+  PackageSerializer() : types_writer_(&types_), items_writer_(&items_) {}
+
+  int64 StringIndex(absl::string_view s) {
+    auto it = string_indices_.find(s);
+    if (it != string_indices_.end()) {
+      return it->second;
+    }
+    strings_.push_back(std::string(s));
+    string_indices_[strings_.back()] = strings_.size() - 1;
+    return strings_.size() - 1;
+  }
+
+  int64 TypeIndex(const Type* type) {
+    auto it = type_indices_.find(type);
+    if (it != type_indices_.end()) {
+      return it->second;
+    }
+    // Element types are written first so the type table can be read in order.
+    switch (type->kind()) {
+      case TypeKind::kBits:
+        types_writer_.WriteUnsigned(static_cast<uint8>(BinaryIrTypeTag::kBits));
+        types_writer_.WriteUnsigned(type->AsBitsOrDie()->bit_count());
+        break;
+      case TypeKind::kTuple: {
+        std::vector<int64> elements;
+        for (const Type* element : type->AsTupleOrDie()->element_types()) {
+          elements.push_back(TypeIndex(element));
+        }
+        types_writer_.WriteUnsigned(
+            static_cast<uint8>(BinaryIrTypeTag::kTuple));
+        types_writer_.WriteUnsigned(elements.size());
+        for (int64 element : elements) {
+          types_writer_.WriteUnsigned(element);
+        }
+        break;
+      }
+      case TypeKind::kArray: {
+        int64 element = TypeIndex(type->AsArrayOrDie()->element_type());
+        types_writer_.WriteUnsigned(
+            static_cast<uint8>(BinaryIrTypeTag::kArray));
+        types_writer_.WriteUnsigned(type->AsArrayOrDie()->size());
+        types_writer_.WriteUnsigned(element);
+        break;
+      }
+      case TypeKind::kToken:
+        types_writer_.WriteUnsigned(
+            static_cast<uint8>(BinaryIrTypeTag::kToken));
+        break;
+    }
+    int64 index = type_indices_.size();
+    type_indices_[type] = index;
+    return index;
+  }
+
+  void WriteValue(const Value& value) {
+    switch (value.kind()) {
+      case ValueKind::kBits: {
+        const Bits& bits = value.bits();
+        items_writer_.WriteUnsigned(
+            static_cast<uint8>(BinaryIrValueTag::kBits));
+        items_writer_.WriteUnsigned(bits.bit_count());
+        std::string* out = items_writer_.out();
+        int64 offset = out->size();
+        out->resize(offset + (bits.bit_count() + 7) / 8);
+        bits.ToBytes(absl::MakeSpan(
+            reinterpret_cast<uint8*>(&(*out)[offset]), out->size() - offset));
+        break;
+      }
+      case ValueKind::kTuple:
+      case ValueKind::kArray:
+        items_writer_.WriteUnsigned(static_cast<uint8>(
+            value.kind() == ValueKind::kTuple ? BinaryIrValueTag::kTuple
+                                              : BinaryIrValueTag::kArray));
+        items_writer_.WriteUnsigned(value.size());
+        for (const Value& element : value.elements()) {
+          WriteValue(element);
+        }
+        break;
+      case ValueKind::kToken:
+        items_writer_.WriteUnsigned(
+            static_cast<uint8>(BinaryIrValueTag::kToken));
+        break;
+      default:
+        XLS_LOG(FATAL) << "Cannot serialize value: " << value;
+    }
+  }
+
+  void WriteLoc(const absl::optional<SourceLocation>& loc) {
+    items_writer_.WriteUnsigned(loc.has_value());
+    if (loc.has_value()) {
+      items_writer_.WriteSigned(loc->fileno().value());
+      items_writer_.WriteSigned(loc->lineno().value());
+      items_writer_.WriteSigned(loc->colno().value());
+    }
+  }
+
+  void WriteChannel(const Channel* channel) {
+    items_writer_.WriteUnsigned(StringIndex(channel->name()));
+    items_writer_.WriteSigned(channel->id());
+    items_writer_.WriteUnsigned(
+        StringIndex(ChannelKindToString(channel->kind())));
+    items_writer_.WriteUnsigned(channel->data_elements().size());
+    for (const DataElement& element : channel->data_elements()) {
+      items_writer_.WriteUnsigned(StringIndex(element.name));
+      items_writer_.WriteUnsigned(TypeIndex(element.type));
+    }
+    items_writer_.WriteString(channel->metadata().SerializeAsString());
+  }
+
+  // Writes the given function (or proc) after any functions it invokes which
+  // have not been written yet.
+  void WriteFunction(Function* function) {
+    if (function_indices_.contains(function)) {
+      return;
+    }
+    std::vector<Node*> body;
+    for (Node* node : TopoSort(function)) {
+      if (node->Is<Param>()) {
+        continue;
+      }
+      if (node->Is<Invoke>()) {
+        WriteFunction(node->As<Invoke>()->to_apply());
+      } else if (node->Is<Map>()) {
+        WriteFunction(node->As<Map>()->to_apply());
+      } else if (node->Is<CountedFor>()) {
+        WriteFunction(node->As<CountedFor>()->body());
+      }
+      body.push_back(node);
+    }
+
+    const Proc* proc = dynamic_cast<const Proc*>(function);
+    items_writer_.WriteUnsigned(proc != nullptr);
+    items_writer_.WriteUnsigned(StringIndex(function->name()));
+    if (proc != nullptr) {
+      WriteValue(proc->InitValue());
+    }
+    absl::flat_hash_map<Node*, int64> node_indices;
+    items_writer_.WriteUnsigned(function->params().size());
+    for (Param* param : function->params()) {
+      items_writer_.WriteUnsigned(StringIndex(param->name()));
+      items_writer_.WriteUnsigned(TypeIndex(param->GetType()));
+      items_writer_.WriteUnsigned(param->id());
+      WriteLoc(param->loc());
+      node_indices[param] = node_indices.size();
+    }
+    items_writer_.WriteUnsigned(body.size());
+    for (Node* node : body) {
+      int64 index = node_indices.size();
+      items_writer_.WriteUnsigned(StringIndex(OpToString(node->op())));
+      items_writer_.WriteUnsigned(TypeIndex(node->GetType()));
+      items_writer_.WriteUnsigned(node->id());
+      WriteLoc(node->loc());
+      items_writer_.WriteUnsigned(node->operand_count());
+      for (Node* operand : node->operands()) {
+        items_writer_.WriteUnsigned(index - node_indices.at(operand));
+      }
+      WriteAttributes(node);
+      node_indices[node] = index;
+    }
+    items_writer_.WriteUnsigned(function->return_value() == nullptr
+                                    ? 0
+                                    : node_indices.at(
+                                          function->return_value()) +
+                                          1);
+    int64 function_index = function_indices_.size();
+    function_indices_[function] = function_index;
+  }
+
+  // Returns the binary package with the given header fields.
+  std::string Finish(absl::string_view name,
+                     const absl::optional<std::string>& entry,
+                     int64 next_node_id,
+                     absl::Span<const std::string> filenames) {
+    std::vector<int64> filename_indices;
+    for (const std::string& filename : filenames) {
+      filename_indices.push_back(StringIndex(filename));
+    }
+
+    std::string out(kBinaryIrMagic);
+    BinaryIrWriter writer(&out);
+    writer.WriteUnsigned(kBinaryIrVersion);
+    writer.WriteString(name);
+    writer.WriteUnsigned(entry.has_value());
+    if (entry.has_value()) {
+      writer.WriteString(*entry);
+    }
+    writer.WriteUnsigned(strings_.size());
+    for (const std::string& s : strings_) {
+      writer.WriteString(s);
+    }
+    writer.WriteUnsigned(next_node_id);
+    writer.WriteUnsigned(filename_indices.size());
+    for (int64 index : filename_indices) {
+      writer.WriteUnsigned(index);
+    }
+    writer.WriteUnsigned(type_indices_.size());
+    writer.WriteBytes(types_);
+    writer.WriteBytes(items_);
+    return out;
+  }
+
+  BinaryIrWriter* items_writer() { return &items_writer_; }
+
+ private:
+  // Writes the attributes of the node which are not implied by its type and
+  // operands.
+  void WriteAttributes(Node* node) {
+    switch (node->op()) {
+      case Op::kLiteral:
+        WriteValue(node->As<Literal>()->value());
+        break;
+      case Op::kBitSlice:
+        items_writer_.WriteUnsigned(node->As<BitSlice>()->start());
+        items_writer_.WriteUnsigned(node->As<BitSlice>()->width());
+        break;
+      case Op::kDynamicBitSlice:
+        items_writer_.WriteUnsigned(node->As<DynamicBitSlice>()->width());
+        break;
+      case Op::kCountedFor:
+        items_writer_.WriteSigned(node->As<CountedFor>()->trip_count());
+        items_writer_.WriteSigned(node->As<CountedFor>()->stride());
+        items_writer_.WriteUnsigned(
+            function_indices_.at(node->As<CountedFor>()->body()));
+        break;
+      case Op::kMap:
+        items_writer_.WriteUnsigned(
+            function_indices_.at(node->As<Map>()->to_apply()));
+        break;
+      case Op::kInvoke:
+        items_writer_.WriteUnsigned(
+            function_indices_.at(node->As<Invoke>()->to_apply()));
+        break;
+      case Op::kTupleIndex:
+        items_writer_.WriteUnsigned(node->As<TupleIndex>()->index());
+        break;
+      case Op::kOneHot:
+        items_writer_.WriteUnsigned(node->As<OneHot>()->priority() ==
+                                    LsbOrMsb::kMsb);
+        break;
+      case Op::kSel:
+        items_writer_.WriteUnsigned(
+            node->As<Select>()->default_value().has_value());
+        break;
+      case Op::kSignExt:
+      case Op::kZeroExt:
+        items_writer_.WriteUnsigned(node->As<ExtendOp>()->new_bit_count());
+        break;
+      case Op::kDecode:
+        items_writer_.WriteUnsigned(node->As<Decode>()->width());
+        break;
+      case Op::kReceive:
+        items_writer_.WriteSigned(node->As<Receive>()->channel_id());
+        break;
+      case Op::kReceiveIf:
+        items_writer_.WriteSigned(node->As<ReceiveIf>()->channel_id());
+        break;
+      case Op::kSend:
+        items_writer_.WriteSigned(node->As<Send>()->channel_id());
+        break;
+      case Op::kSendIf:
+        items_writer_.WriteSigned(node->As<SendIf>()->channel_id());
+        break;
+      default:
+        break;
+    }
+  }
+
+  std::vector<std::string> strings_;
+  absl::flat_hash_map<std::string, int64> string_indices_;
+
+  std::string types_;
+  BinaryIrWriter types_writer_;
+  absl::flat_hash_map<const Type*, int64> type_indices_;
+
+  // The channels and functions.
+  std::string items_;
+  BinaryIrWriter items_writer_;
+  absl::flat_hash_map<const Function*, int64> function_indices_;
+};
+
+}  // namespace
+
+std::string Package::Serialize() const {
+  PackageSerializer serializer;
+  BinaryIrWriter* writer = serializer.items_writer();
+  writer->WriteUnsigned(channels().size());
+  for (const Channel* channel : channels()) {
+    serializer.WriteChannel(channel);
+  }
+  std::vector<Function*> functions = GetFunctionsAndProcs();
+  writer->WriteUnsigned(functions.size());
+  for (Function* function : functions) {
+    serializer.WriteFunction(function);
+  }
+
+  std::vector<std::string> filenames(fileno_to_filename_.size());
+  for (const auto& pair : fileno_to_filename_) {
+    filenames[pair.first.value()] = pair.second;
+  }
+  return serializer.Finish(name(), entry_, next_node_id(), filenames);
+}
+
 std::ostream& operator<<(std::ostream& os, const Package& package) {
   os << package.DumpIr();
   return os;
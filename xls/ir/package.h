@@ -15,6 +15,7 @@
 #ifndef XLS_IR_PACKAGE_H_
 #define XLS_IR_PACKAGE_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -25,6 +26,7 @@
 #include "absl/container/node_hash_map.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "xls/common/integral_types.h"
 #include "xls/ir/channel.h"
 #include "xls/ir/channel.pb.h"
@@ -52,13 +54,19 @@ class Package {
 
   // Returns whether the given type is one of the types owned by this package.
   bool IsOwnedType(const Type* type) {
+    absl::MutexLock lock(&type_mutex_);
     return owned_types_.find(type) != owned_types_.end();
   }
   bool IsOwnedFunctionType(const FunctionType* function_type) {
+    absl::MutexLock lock(&type_mutex_);
     return owned_function_types_.find(function_type) !=
            owned_function_types_.end();
   }
 
+  // The type accessors below, and node ID allocation, are thread-safe so that
+  // separate functions of the package may be transformed concurrently (see
+  // PassOptions::function_pass_threads). Other mutating methods are not.
+
   BitsType* GetBitsType(int64 bit_count);
   ArrayType* GetArrayType(int64 size, Type* element_type);
   TupleType* GetTupleType(absl::Span<Type* const> element_types);
@@ -116,7 +124,7 @@ class Package {
 
   // Retrieves the next node ID to assign to a node in the package and
   // increments the next node counter. For use in node construction.
-  int64 GetNextNodeId() { return next_node_id_++; }
+  int64 GetNextNodeId() { return next_node_id_.fetch_add(1); }
 
   // Adds a file to the file-number table and returns its corresponding number.
   // If it already exists, returns the existing file-number entry.
@@ -152,12 +160,18 @@ class Package {
   // Dumps the IR in a parsable text format.
   std::string DumpIr() const;
 
+  // Serializes the package in the binary IR format (see ir_binary_format.h)
+  // which is parsed by Parser::ParseBinaryPackage. Unlike the text format the
+  // binary format also preserves the entry function, the ids of params, the
+  // next node id and the filenames of source locations.
+  std::string Serialize() const;
+
   std::vector<std::string> GetFunctionNames() const;
 
-  int64 next_node_id() const { return next_node_id_; }
+  int64 next_node_id() const { return next_node_id_.load(); }
 
   // Intended for use by the parser when node ids are suggested by the IR text.
-  void set_next_node_id(int64 value) { next_node_id_ = value; }
+  void set_next_node_id(int64 value) { next_node_id_.store(value); }
 
   // Create a channel. A unique channel ID will be automatically
   // allocated. Channels are used with send/receive nodes in communicate between
@@ -206,11 +220,14 @@ class Package {
   std::string name_;
 
   // Ordinal to assign to the next node created in this package.
-  int64 next_node_id_ = 1;
+  std::atomic<int64> next_node_id_{1};
 
   std::vector<std::unique_ptr<Function>> functions_;
   std::vector<std::unique_ptr<Proc>> procs_;
 
+  // Guards the owned types and the maps from which they are looked up.
+  absl::Mutex type_mutex_;
+
   // Set of owned types in this package.
   UnorderedSet<const Type*> owned_types_;
 
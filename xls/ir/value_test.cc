@@ -16,6 +16,7 @@
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/hash/hash_testing.h"
 #include "xls/common/status/matchers.h"
 #include "xls/ir/bits.h"
 #include "xls/ir/package.h"
@@ -330,4 +331,22 @@ TEST(ValueTest, XBitsArrayWrongSizes) {
               HasSubstr("elements of arrays should have consistent size."));
 }
 
+TEST(ValueTest, Hash) {
+  EXPECT_TRUE(absl::VerifyTypeImplementsAbslHashCorrectly({
+      Value(UBits(0, 0)),
+      Value(UBits(0, 1)),
+      Value(UBits(1, 1)),
+      Value(UBits(42, 8)),
+      Value(UBits(42, 64)),
+      Value(UBits(42, 65)),
+      Value(Bits::AllOnes(200)),
+      Value::Tuple({}),
+      Value::Tuple({Value(UBits(42, 8))}),
+      Value::Tuple({Value(UBits(42, 8)), Value(UBits(1, 1))}),
+      Value::ArrayOrDie({Value(UBits(42, 8))}),
+      Value::ArrayOrDie({Value(UBits(42, 8)), Value(UBits(43, 8))}),
+      Value::Token(),
+  }));
+}
+
 }  // namespace xls
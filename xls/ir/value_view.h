@@ -485,6 +485,41 @@ class PackedTupleView {
   };
 };
 
+// Writes the low "bit_count" bits of "value" into the packed buffer starting
+// at bit "bit_offset". The destination bits must be zero. Used to copy native
+// values whose layout differs from the packed layout (e.g., an array of 5-bit
+// values held as uint8s) into a packed buffer.
+inline void PackBits(uint64 value, int64 bit_offset, int64 bit_count,
+                     uint8* buffer) {
+  while (bit_count > 0) {
+    int64 byte = bit_offset / kCharBit;
+    int64 shift = bit_offset % kCharBit;
+    int64 chunk = std::min(bit_count, kCharBit - shift);
+    buffer[byte] |= (value & Mask(chunk)) << shift;
+    value >>= chunk;
+    bit_offset += chunk;
+    bit_count -= chunk;
+  }
+}
+
+// Returns the "bit_count" bits of the packed buffer starting at bit
+// "bit_offset". The inverse of PackBits().
+inline uint64 UnpackBits(const uint8* buffer, int64 bit_offset,
+                         int64 bit_count) {
+  uint64 value = 0;
+  int64 value_offset = 0;
+  while (value_offset < bit_count) {
+    int64 byte = bit_offset / kCharBit;
+    int64 shift = bit_offset % kCharBit;
+    int64 chunk = std::min(bit_count - value_offset, kCharBit - shift);
+    value |= static_cast<uint64>((buffer[byte] >> shift) & Mask(chunk))
+             << value_offset;
+    bit_offset += chunk;
+    value_offset += chunk;
+  }
+  return value;
+}
+
 }  // namespace xls
 
 #endif  // XLS_IR_VALUE_VIEW_H_
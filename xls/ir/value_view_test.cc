@@ -273,5 +273,26 @@ TEST(PackedTupleViewTest, ExtractsSimpleUnaligned) {
   EXPECT_EQ(sfd_data, value.element(2).bits().ToUint64().value());
 }
 
+TEST(PackBitsTest, RoundTrips) {
+  // Pack 5-bit values at every offset and read them back.
+  constexpr int64 kElementBits = 5;
+  constexpr int64 kElements = 13;
+  std::vector<uint8> buffer(CeilOfRatio(kElementBits * kElements, kCharBit), 0);
+  for (int i = 0; i < kElements; i++) {
+    PackBits(i * 7 + 3, i * kElementBits, kElementBits, buffer.data());
+  }
+  for (int i = 0; i < kElements; i++) {
+    EXPECT_EQ(UnpackBits(buffer.data(), i * kElementBits, kElementBits),
+              (i * 7 + 3) & Mask(kElementBits));
+  }
+
+  // Wide values spanning many bytes at an unaligned offset.
+  std::vector<uint8> wide(10, 0);
+  PackBits(0xfedcba9876543210ull, 3, 64, wide.data());
+  EXPECT_EQ(UnpackBits(wide.data(), 3, 64), 0xfedcba9876543210ull);
+  EXPECT_EQ(wide[0], 0x80);
+  EXPECT_EQ(UnpackBits(wide.data(), 0, 3), 0);
+}
+
 }  // namespace
 }  // namespace xls
@@ -0,0 +1,86 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests that the native std::array interfaces of generated JIT wrappers agree
+// with their Value-based interfaces. add16 takes and returns arrays whose
+// native layout is the packed layout; transpose5 takes and returns a
+// multi-dimensional array of elements narrower than their native storage,
+// which is packed and unpacked by the wrapper.
+
+#include <array>
+#include <random>
+
+#include "gtest/gtest.h"
+#include "xls/common/integral_types.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/value.h"
+#include "xls/jit/add16_jit_wrapper.h"
+#include "xls/jit/transpose5_jit_wrapper.h"
+
+namespace xls {
+namespace {
+
+constexpr int64 kIterations = 256;
+
+// The native types of bits[16][2] and bits[5][2][2].
+using Bits16Array2 = std::array<uint16, 2>;
+using Bits5Array2x2 = std::array<std::array<uint8, 2>, 2>;
+
+Value ToValue(const Bits16Array2& array) {
+  return Value::UBitsArray({array[0], array[1]}, 16).value();
+}
+
+Value ToValue(const Bits5Array2x2& array) {
+  return Value::UBits2DArray({{array[0][0], array[0][1]},
+                              {array[1][0], array[1][1]}},
+                             5)
+      .value();
+}
+
+TEST(ArrayJitWrapperTest, NativeLayoutArrays) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Add16> wrapper, Add16::Create());
+  std::minstd_rand engine;
+  std::uniform_int_distribution<uint16> distribution;
+  for (int64 i = 0; i < kIterations; ++i) {
+    Bits16Array2 a = {distribution(engine), distribution(engine)};
+    Bits16Array2 b = {distribution(engine), distribution(engine)};
+    XLS_ASSERT_OK_AND_ASSIGN(Bits16Array2 native_result, wrapper->Run(a, b));
+    XLS_ASSERT_OK_AND_ASSIGN(Value value_result,
+                             wrapper->Run(ToValue(a), ToValue(b)));
+    EXPECT_EQ(ToValue(native_result), value_result);
+  }
+}
+
+TEST(ArrayJitWrapperTest, PackedMultiDimensionalArrays) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Transpose5> wrapper,
+                           Transpose5::Create());
+  std::minstd_rand engine;
+  std::uniform_int_distribution<uint16> distribution;
+  for (int64 i = 0; i < kIterations; ++i) {
+    Bits5Array2x2 x;
+    for (auto& row : x) {
+      for (uint8& element : row) {
+        element = distribution(engine) & 0x1f;
+      }
+    }
+    Bits16Array2 y = {distribution(engine), distribution(engine)};
+    XLS_ASSERT_OK_AND_ASSIGN(Bits5Array2x2 native_result, wrapper->Run(x, y));
+    XLS_ASSERT_OK_AND_ASSIGN(Value value_result,
+                             wrapper->Run(ToValue(x), ToValue(y)));
+    EXPECT_EQ(ToValue(native_result), value_result);
+  }
+}
+
+}  // namespace
+}  // namespace xls
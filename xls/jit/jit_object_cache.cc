@@ -0,0 +1,190 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/jit_object_cache.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <system_error>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/SHA1.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+
+namespace xls {
+namespace {
+
+constexpr char kObjectExtension[] = ".o";
+
+}  // namespace
+
+/* static */
+absl::StatusOr<std::unique_ptr<JitObjectCache>> JitObjectCache::Create(
+    const std::filesystem::path& directory, int64 max_size_bytes) {
+  if (max_size_bytes <= 0) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "JIT object cache size limit must be positive, was %d",
+        max_size_bytes));
+  }
+  XLS_RETURN_IF_ERROR(RecursivelyCreateDir(directory));
+  return absl::WrapUnique(new JitObjectCache(directory, max_size_bytes));
+}
+
+/* static */
+std::string JitObjectCache::ComputeKey(absl::string_view llvm_ir_text,
+                                       int64 opt_level,
+                                       absl::string_view target) {
+  // The LLVM version is included as it determines the generated code as much as
+  // the input does. Components are length-prefixed to keep them unambiguous.
+  std::string opt_level_str = absl::StrCat(opt_level);
+  std::string data;
+  for (absl::string_view component :
+       {absl::string_view(LLVM_VERSION_STRING), target,
+        absl::string_view(opt_level_str), llvm_ir_text}) {
+    absl::StrAppend(&data, component.size(), ":", component);
+  }
+  auto digest = llvm::SHA1::hash(llvm::ArrayRef<uint8_t>(
+      reinterpret_cast<const uint8_t*>(data.data()), data.size()));
+  return absl::BytesToHexString(absl::string_view(
+      reinterpret_cast<const char*>(digest.data()), digest.size()));
+}
+
+std::filesystem::path JitObjectCache::ObjectPath(absl::string_view key) const {
+  return directory_ / absl::StrCat(key, kObjectExtension);
+}
+
+std::unique_ptr<llvm::MemoryBuffer> JitObjectCache::Lookup(
+    absl::string_view key) {
+  std::filesystem::path path = ObjectPath(key);
+  absl::StatusOr<std::string> contents = GetFileContents(path);
+  absl::MutexLock lock(&mutex_);
+  if (!contents.ok()) {
+    XLS_VLOG(2) << "JIT object cache miss: " << key;
+    ++misses_;
+    return nullptr;
+  }
+  XLS_VLOG(2) << "JIT object cache hit: " << key;
+  ++hits_;
+
+  // Refresh the modification time, which serves as the last-use time for
+  // eviction. Failure (e.g., the file was just evicted by another process)
+  // is harmless.
+  std::error_code ec;
+  std::filesystem::last_write_time(
+      path, std::filesystem::file_time_type::clock::now(), ec);
+  return llvm::MemoryBuffer::getMemBufferCopy(
+      llvm::StringRef(contents->data(), contents->size()),
+      llvm::StringRef(key.data(), key.size()));
+}
+
+absl::Status JitObjectCache::Store(absl::string_view key,
+                                   absl::string_view object) {
+  if (object.size() > max_size_bytes_) {
+    XLS_VLOG(2) << absl::StreamFormat(
+        "Not caching %d-byte JIT object %s; exceeds cache size limit",
+        object.size(), key);
+    return absl::OkStatus();
+  }
+
+  absl::MutexLock lock(&mutex_);
+  // Write to a private temporary file then rename it into place, so readers
+  // (in this or other processes) never see a partially-written object.
+  std::filesystem::path temp_path =
+      directory_ / absl::StrFormat("%s.%d.%d.tmp", key, getpid(),
+                                   store_count_++);
+  XLS_RETURN_IF_ERROR(SetFileContents(temp_path, object));
+  std::error_code ec;
+  std::filesystem::rename(temp_path, ObjectPath(key), ec);
+  if (ec) {
+    std::filesystem::remove(temp_path, ec);
+    return absl::InternalError(
+        absl::StrFormat("Unable to store JIT object %s in %s: %s", key,
+                        directory_.string(), ec.message()));
+  }
+  return Evict();
+}
+
+absl::Status JitObjectCache::Evict() {
+  struct Entry {
+    std::filesystem::path path;
+    std::filesystem::file_time_type last_use;
+    int64 size;
+  };
+  std::vector<Entry> entries;
+  int64 total_size = 0;
+  XLS_ASSIGN_OR_RETURN(std::vector<std::filesystem::path> paths,
+                       GetDirectoryEntries(directory_));
+  for (const std::filesystem::path& path : paths) {
+    if (path.extension() != kObjectExtension) {
+      continue;
+    }
+    // Entries may concurrently disappear; those are simply skipped.
+    std::error_code ec;
+    Entry entry{path, std::filesystem::last_write_time(path, ec), 0};
+    if (ec) {
+      continue;
+    }
+    entry.size = std::filesystem::file_size(path, ec);
+    if (ec) {
+      continue;
+    }
+    total_size += entry.size;
+    entries.push_back(std::move(entry));
+  }
+  if (total_size <= max_size_bytes_) {
+    return absl::OkStatus();
+  }
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry& a, const Entry& b) {
+              return a.last_use < b.last_use;
+            });
+  for (const Entry& entry : entries) {
+    if (total_size <= max_size_bytes_) {
+      break;
+    }
+    std::error_code ec;
+    std::filesystem::remove(entry.path, ec);
+    XLS_VLOG(2) << "Evicted JIT object " << entry.path;
+    total_size -= entry.size;
+    ++evictions_;
+  }
+  return absl::OkStatus();
+}
+
+int64 JitObjectCache::hits() const {
+  absl::MutexLock lock(&mutex_);
+  return hits_;
+}
+
+int64 JitObjectCache::misses() const {
+  absl::MutexLock lock(&mutex_);
+  return misses_;
+}
+
+int64 JitObjectCache::evictions() const {
+  absl::MutexLock lock(&mutex_);
+  return evictions_;
+}
+
+}  // namespace xls
@@ -0,0 +1,100 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_JIT_JIT_OBJECT_CACHE_H_
+#define XLS_JIT_JIT_OBJECT_CACHE_H_
+
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "xls/common/integral_types.h"
+
+namespace xls {
+
+// Persistent, content-addressed store of JIT-compiled object files.
+//
+// Optimizing and generating code for a large function dominates the cost of
+// creating an LlvmIrJit; with a cache, a function which has been compiled
+// before (in this or any previous process) is instead loaded from disk as a
+// relocatable object. Objects are keyed by a hash of everything which affects
+// code generation (see ComputeKey()) and stored one file per key in a single
+// directory, which may be shared by concurrent processes.
+//
+// The total size of the directory is bounded: when storing an object pushes it
+// over the limit, the least-recently used objects are deleted.
+//
+// JitObjectCaches are thread-safe.
+class JitObjectCache {
+ public:
+  static constexpr int64 kDefaultMaxSizeBytes = int64{1} << 30;
+
+  // Returns a cache backed by the given directory, which is created if
+  // necessary.
+  static absl::StatusOr<std::unique_ptr<JitObjectCache>> Create(
+      const std::filesystem::path& directory,
+      int64 max_size_bytes = kDefaultMaxSizeBytes);
+
+  // Returns the cache key for an object compiled from the given unoptimized
+  // LLVM IR text with the given settings. Keying on the LLVM IR rather than
+  // the XLS IR it was generated from means changes to the lowering of XLS IR
+  // don't reuse stale objects. "target" should describe the target machine:
+  // its triple, CPU and features.
+  static std::string ComputeKey(absl::string_view llvm_ir_text,
+                                int64 opt_level, absl::string_view target);
+
+  // Returns the object stored under the given key, or nullptr if there is none.
+  // Counts as a hit or miss, respectively.
+  std::unique_ptr<llvm::MemoryBuffer> Lookup(absl::string_view key);
+
+  // Stores the given object under the given key, replacing any existing entry,
+  // then evicts objects as necessary to respect the size limit.
+  absl::Status Store(absl::string_view key, absl::string_view object);
+
+  int64 hits() const;
+  int64 misses() const;
+  int64 evictions() const;
+
+  const std::filesystem::path& directory() const { return directory_; }
+  int64 max_size_bytes() const { return max_size_bytes_; }
+
+ private:
+  JitObjectCache(const std::filesystem::path& directory, int64 max_size_bytes)
+      : directory_(directory), max_size_bytes_(max_size_bytes) {}
+
+  std::filesystem::path ObjectPath(absl::string_view key) const;
+
+  // Deletes least-recently used objects until the directory fits in
+  // max_size_bytes_.
+  absl::Status Evict() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const std::filesystem::path directory_;
+  const int64 max_size_bytes_;
+
+  mutable absl::Mutex mutex_;
+  int64 hits_ ABSL_GUARDED_BY(mutex_) = 0;
+  int64 misses_ ABSL_GUARDED_BY(mutex_) = 0;
+  int64 evictions_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Used to give each in-flight store a unique temporary file.
+  int64 store_count_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace xls
+
+#endif  // XLS_JIT_JIT_OBJECT_CACHE_H_
@@ -0,0 +1,152 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/jit_object_cache.h"
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <filesystem>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/file/temp_directory.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/package.h"
+#include "xls/jit/llvm_ir_jit.h"
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+
+std::string BufferContents(const llvm::MemoryBuffer& buffer) {
+  return std::string(buffer.getBufferStart(), buffer.getBufferSize());
+}
+
+TEST(JitObjectCacheTest, KeysDependOnAllInputs) {
+  std::string key = JitObjectCache::ComputeKey("fn f()", 3, "x86_64");
+  EXPECT_EQ(key, JitObjectCache::ComputeKey("fn f()", 3, "x86_64"));
+  EXPECT_NE(key, JitObjectCache::ComputeKey("fn g()", 3, "x86_64"));
+  EXPECT_NE(key, JitObjectCache::ComputeKey("fn f()", 2, "x86_64"));
+  EXPECT_NE(key, JitObjectCache::ComputeKey("fn f()", 3, "aarch64"));
+}
+
+TEST(JitObjectCacheTest, StoreAndLookup) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  XLS_ASSERT_OK_AND_ASSIGN(auto cache,
+                           JitObjectCache::Create(temp_dir.path() / "cache"));
+
+  EXPECT_EQ(cache->Lookup("abc"), nullptr);
+  XLS_ASSERT_OK(cache->Store("abc", "some object"));
+  std::unique_ptr<llvm::MemoryBuffer> object = cache->Lookup("abc");
+  ASSERT_NE(object, nullptr);
+  EXPECT_EQ(BufferContents(*object), "some object");
+  EXPECT_EQ(cache->hits(), 1);
+  EXPECT_EQ(cache->misses(), 1);
+
+  // Objects persist across cache instances.
+  XLS_ASSERT_OK_AND_ASSIGN(auto other_cache,
+                           JitObjectCache::Create(temp_dir.path() / "cache"));
+  object = other_cache->Lookup("abc");
+  ASSERT_NE(object, nullptr);
+  EXPECT_EQ(BufferContents(*object), "some object");
+}
+
+TEST(JitObjectCacheTest, EvictsLeastRecentlyUsed) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  XLS_ASSERT_OK_AND_ASSIGN(auto cache, JitObjectCache::Create(
+                                           temp_dir.path(), /*max_size_bytes=*/
+                                           25));
+  XLS_ASSERT_OK(cache->Store("a", "0123456789"));
+  XLS_ASSERT_OK(cache->Store("b", "0123456789"));
+  // Backdate the objects so that recency doesn't depend on the timestamp
+  // granularity of the filesystem: "a" is older than "b" until it is used.
+  auto now = std::filesystem::file_time_type::clock::now();
+  std::filesystem::last_write_time(temp_dir.path() / "a.o",
+                                   now - std::chrono::hours(2));
+  std::filesystem::last_write_time(temp_dir.path() / "b.o",
+                                   now - std::chrono::hours(1));
+  // Use "a" so that "b" is the least recently used.
+  ASSERT_NE(cache->Lookup("a"), nullptr);
+  XLS_ASSERT_OK(cache->Store("c", "0123456789"));
+
+  EXPECT_EQ(cache->evictions(), 1);
+  EXPECT_NE(cache->Lookup("a"), nullptr);
+  EXPECT_EQ(cache->Lookup("b"), nullptr);
+  EXPECT_NE(cache->Lookup("c"), nullptr);
+
+  // Objects which could never fit aren't stored.
+  XLS_ASSERT_OK(cache->Store("d", std::string(100, 'x')));
+  EXPECT_EQ(cache->Lookup("d"), nullptr);
+  EXPECT_NE(cache->Lookup("c"), nullptr);
+}
+
+TEST(JitObjectCacheTest, InvalidSize) {
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  EXPECT_THAT(JitObjectCache::Create(temp_dir.path(), 0),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(JitObjectCacheTest, JitUsesCache) {
+  const std::string kIr = R"(
+package cached
+
+fn square(x: bits[32]) -> bits[32] {
+  ret umul.2: bits[32] = umul(x, x)
+}
+
+fn f(x: bits[32], y: bits[32]) -> bits[32] {
+  invoke.3: bits[32] = invoke(x, to_apply=square)
+  ret add.4: bits[32] = add(invoke.3, y)
+}
+)";
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  XLS_ASSERT_OK_AND_ASSIGN(auto cache, JitObjectCache::Create(temp_dir.path()));
+
+  std::vector<Value> args = {Value(UBits(7, 32)), Value(UBits(1, 32))};
+  for (int64 i = 0; i < 2; ++i) {
+    XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                             Parser::ParsePackage(kIr));
+    XLS_ASSERT_OK_AND_ASSIGN(Function * f, package->GetFunction("f"));
+    XLS_ASSERT_OK_AND_ASSIGN(auto jit,
+                             LlvmIrJit::Create(f, /*opt_level=*/3, cache.get()));
+    EXPECT_THAT(jit->Run(args), IsOkAndHolds(Value(UBits(50, 32))));
+    EXPECT_EQ(cache->hits(), i);
+    EXPECT_EQ(cache->misses(), 1);
+  }
+
+  // A change to a callee changes the key.
+  std::string modified_ir = kIr;
+  modified_ir.replace(modified_ir.find("umul(x, x)"), 10, "add(x, x)");
+  modified_ir.replace(modified_ir.find("umul.2"), 6, "add.2");
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(modified_ir));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, package->GetFunction("f"));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit,
+                           LlvmIrJit::Create(f, /*opt_level=*/3, cache.get()));
+  EXPECT_THAT(jit->Run(args), IsOkAndHolds(Value(UBits(15, 32))));
+  EXPECT_EQ(cache->misses(), 2);
+
+  // The batched and packed entry points come from the cached object, too.
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::vector<Value> results,
+      jit->RunBatched(std::vector<std::vector<Value>>{args, args}));
+  EXPECT_THAT(results, testing::ElementsAre(Value(UBits(15, 32)),
+                                            Value(UBits(15, 32))));
+}
+
+}  // namespace
+}  // namespace xls
@@ -13,8 +13,13 @@
 // limitations under the License.
 #include "xls/jit/jit_wrapper_generator.h"
 
+#include <functional>
+#include <string>
+
 #include "absl/strings/str_replace.h"
 #include "absl/strings/substitute.h"
+#include "xls/common/bits_util.h"
+#include "xls/common/math_util.h"
 #include "xls/common/status/ret_check.h"
 
 namespace xls {
@@ -93,29 +98,9 @@ std::string PackedTypeString(const Type& type) {
   }
 }
 
-// Emits the code necessary to convert a u32/i32 value to its corresponding
-// packed view.
-std::string ConvertUint(const std::string& name, const Type& type) {
-  XLS_CHECK(type.IsBits());
-
-  return absl::StrFormat(
-      "PackedBitsView<%d> %s_view(reinterpret_cast<uint8*>(&%s), 0)",
-      type.GetFlatBitCount(), name, name);
-}
-
-// Emits the code necessary to convert a float value to its corresponding
-// packed view.
-std::string ConvertFloat(const std::string& name) {
-  return absl::StrCat(
-      "PackedTupleView<PackedBitsView<1>, PackedBitsView<8>, "
-      "PackedBitsView<23>> ",
-      name, "_view(reinterpret_cast<uint8*>(&", name, "), 0)");
-}
-
 // Determines if the input type matches some other/simpler data type, and if so,
-// returns it.
-// Does not currently match > 1 specialization; i.e., if there were two types
-// that could be specializations of a param.
+// returns it: unsigned integers for bits types of up to 64 bits, float for
+// tuples with the float layout, and std::arrays of either.
 absl::optional<std::string> MatchTypeSpecialization(const Type& type) {
   // No need at present for anything fancy. Cascading if/else works.
   std::string type_string;
@@ -125,24 +110,115 @@ absl::optional<std::string> MatchTypeSpecialization(const Type& type) {
     return type_string;
   } else if (MatchFloat(type)) {
     return "float";
+  } else if (type.IsArray()) {
+    const ArrayType* array_type = type.AsArrayOrDie();
+    absl::optional<std::string> element_string =
+        MatchTypeSpecialization(*array_type->element_type());
+    if (!element_string.has_value()) {
+      return absl::nullopt;
+    }
+    return absl::StrFormat("std::array<%s, %d>", element_string.value(),
+                           array_type->size());
   }
 
   return absl::nullopt;
 }
 
-// Simple matching "driver" for emitting logic to convert a simple type into an
-// XLS view.
-// Pretty bare-bones at present, but will be expanded depending on need.
-absl::optional<std::string> CreateConversion(const std::string& name,
-                                             const Type& type) {
-  std::string type_string;
-  if (MatchUint(type, &type_string)) {
-    return ConvertUint(name, type);
-  } else if (MatchFloat(type)) {
-    return ConvertFloat(name);
+// Returns true if values of the given specializable type exactly fill the
+// storage of their native type, e.g., bits[16] in a uint16.
+bool FillsNativeStorage(const Type& type) {
+  if (type.IsArray()) {
+    return FillsNativeStorage(*type.AsArrayOrDie()->element_type());
+  }
+  if (type.IsBits()) {
+    int64 bit_count = type.GetFlatBitCount();
+    return bit_count == 8 || bit_count == 16 || bit_count == 32 ||
+           bit_count == 64;
   }
+  // Float.
+  return true;
+}
 
-  return absl::nullopt;
+// Returns true if the packed layout of the given specializable type is the
+// in-memory layout of its native type, so a packed view can be placed directly
+// over the native value. This holds for all scalars, whose packed bits are the
+// low-order bits of the (little-endian) native integer, and for arrays whose
+// elements fill their native storage, as packed arrays hold element 0 in the
+// lowest-order bits.
+bool HasNativeLayout(const Type& type) {
+  return !type.IsArray() || FillsNativeStorage(type);
+}
+
+// Returns the code of nested loops over the leaf (bits) elements of the given
+// array type held in the native value "name". "body" returns the statement to
+// emit for each element given the element expression, its offset in the packed
+// layout (as an expression) and its bit count.
+std::string EmitLeafElementLoops(
+    absl::string_view name, const Type& type,
+    const std::function<std::string(const std::string&, const std::string&,
+                                    int64)>& body) {
+  std::string code;
+  std::string element(name);
+  std::string flat_index;
+  std::string indent = "  ";
+  const Type* leaf_type = &type;
+  int64 depth = 0;
+  while (leaf_type->IsArray()) {
+    const ArrayType* array_type = leaf_type->AsArrayOrDie();
+    std::string index = absl::StrCat("i", depth);
+    absl::StrAppendFormat(&code, "%sfor (int64 %s = 0; %s < %d; ++%s) {\n",
+                          indent, index, index, array_type->size(), index);
+    absl::StrAppend(&element, "[", index, "]");
+    flat_index = flat_index.empty()
+                     ? index
+                     : absl::StrFormat("(%s * %d + %s)", flat_index,
+                                       array_type->size(), index);
+    absl::StrAppend(&indent, "  ");
+    leaf_type = array_type->element_type();
+    ++depth;
+  }
+  int64 leaf_bits = leaf_type->GetFlatBitCount();
+  absl::StrAppend(
+      &code, indent,
+      body(element, absl::StrFormat("%s * %d", flat_index, leaf_bits),
+           leaf_bits),
+      "\n");
+  for (; depth > 0; --depth) {
+    indent.resize(indent.size() - 2);
+    absl::StrAppend(&code, indent, "}\n");
+  }
+  return code;
+}
+
+// Emits the code binding the packed view "<name>_view" to the native value
+// "name". Values with the native layout are viewed in place; others are copied
+// into a packed buffer on the stack.
+std::string ConvertToPackedView(const std::string& name, const Type& type) {
+  std::string view_type = PackedTypeString(type);
+  if (HasNativeLayout(type)) {
+    // Arrays are passed by const reference; the JIT doesn't write arguments.
+    std::string pointer =
+        type.IsArray()
+            ? absl::StrFormat(
+                  "const_cast<uint8*>(reinterpret_cast<const uint8*>(&%s))",
+                  name)
+            : absl::StrFormat("reinterpret_cast<uint8*>(&%s)", name);
+    return absl::StrFormat("  %s %s_view(%s, 0);\n", view_type, name, pointer);
+  }
+  std::string code =
+      absl::StrFormat("  uint8 %s_buffer[%d] = {0};\n", name,
+                      CeilOfRatio(type.GetFlatBitCount(), kCharBit));
+  absl::StrAppend(
+      &code, EmitLeafElementLoops(
+                 name, type,
+                 [&](const std::string& element, const std::string& offset,
+                     int64 bit_count) {
+                   return absl::StrFormat("PackBits(%s, %s, %d, %s_buffer);",
+                                          element, offset, bit_count, name);
+                 }));
+  absl::StrAppendFormat(&code, "  %s %s_view(%s_buffer, 0);\n", view_type,
+                        name, name);
+  return code;
 }
 
 // Currently, we only support specialized interfaces if all the params and
@@ -150,6 +226,11 @@ absl::optional<std::string> CreateConversion(const std::string& name,
 // To change this, we'd need to convert any non-specializable Values or
 // non-packed views into packed views.
 bool IsSpecializable(const Function& function) {
+  // Without params, the specialization would only differ from the Value-based
+  // Run() in its return type.
+  if (function.params().empty()) {
+    return false;
+  }
   for (const Param* param : function.params()) {
     const Type& param_type = *param->GetType();
     if (!MatchTypeSpecialization(param_type).has_value()) {
@@ -162,7 +243,7 @@ bool IsSpecializable(const Function& function) {
 }
 
 // Returns the specialized decl of the given function or an empty string, if not
-// applicable.
+// applicable. Scalars are passed by value and arrays by const reference.
 std::string CreateDeclSpecialization(const Function& function,
                                      std::string prepend_class_name = "") {
   if (!IsSpecializable(function)) {
@@ -175,7 +256,12 @@ std::string CreateDeclSpecialization(const Function& function,
   for (const Param* param : function.params()) {
     const Type& param_type = *param->GetType();
     std::string specialization = MatchTypeSpecialization(param_type).value();
-    params.push_back(absl::StrCat(specialization, " ", param->name()));
+    if (param_type.IsArray()) {
+      params.push_back(
+          absl::StrCat("const ", specialization, "& ", param->name()));
+    } else {
+      params.push_back(absl::StrCat(specialization, " ", param->name()));
+    }
   }
 
   const Type& return_type = *function.return_value()->GetType();
@@ -189,6 +275,10 @@ std::string CreateDeclSpecialization(const Function& function,
                          prepend_class_name, absl::StrJoin(params, ", "));
 }
 
+// Returns the implementation of the specialized Run(). It calls
+// RunWithPackedViews() directly on the native arguments and return value where
+// their layouts allow, and otherwise on packed copies on the stack, so it does
+// no heap allocation.
 std::string CreateImplSpecialization(const Function& function,
                                      absl::string_view class_name) {
   if (!IsSpecializable(function)) {
@@ -201,36 +291,50 @@ std::string CreateImplSpecialization(const Function& function,
   signature.pop_back();
 
   // Convert all "simple" types to their XLS equivalents.
-  std::vector<std::string> param_conversions;
+  std::string body;
   std::vector<std::string> param_names;
   for (const Param* param : function.params()) {
-    // As with decls, we know conversions for all elements are possible, so we
-    // can get values directly from the result absl::optionals.
-    std::string conversion =
-        CreateConversion(param->name(), *param->GetType()).value();
-    param_conversions.push_back(absl::StrCat("  ", conversion));
+    absl::StrAppend(&body,
+                    ConvertToPackedView(param->name(), *param->GetType()));
     param_names.push_back(absl::StrCat(param->name(), "_view"));
   }
+  param_names.push_back("return_value_view");
 
-  // Do the same for the return type - this requires allocating "buffer" space
+  // Do the same for the return type. The return value is zero-initialized as
+  // the JIT only writes the bytes holding the packed bits.
   const Type& return_type = *function.return_value()->GetType();
   std::string return_spec = MatchTypeSpecialization(return_type).value();
-  param_conversions.push_back(
-      absl::StrFormat("  %s return_value;\n"
-                      "#if __has_feature(memory_sanitizer)\n"
-                      "  __msan_unpoison(&return_value, sizeof(%s));\n"
-                      "#endif\n"
-                      "  %s",
-                      return_spec, return_spec,
-                      CreateConversion("return_value", return_type).value()));
-  param_names.push_back("return_value_view");
-  return absl::StrFormat(R"(%s {
-%s;
-  XLS_RETURN_IF_ERROR(jit_->RunWithPackedViews(%s));
-  return return_value;
-})",
-                         signature, absl::StrJoin(param_conversions, ";\n"),
-                         absl::StrJoin(param_names, ", "));
+  std::string run = absl::StrFormat(
+      "  XLS_RETURN_IF_ERROR(jit_->RunWithPackedViews(%s));\n",
+      absl::StrJoin(param_names, ", "));
+  if (HasNativeLayout(return_type)) {
+    absl::StrAppendFormat(
+        &body,
+        "  %s return_value{};\n"
+        "  %s return_value_view(reinterpret_cast<uint8*>(&return_value), 0);\n"
+        "%s",
+        return_spec, PackedTypeString(return_type), run);
+  } else {
+    absl::StrAppendFormat(
+        &body,
+        "  uint8 return_value_buffer[%d] = {0};\n"
+        "  %s return_value_view(return_value_buffer, 0);\n"
+        "%s"
+        "  %s return_value{};\n",
+        CeilOfRatio(return_type.GetFlatBitCount(), kCharBit),
+        PackedTypeString(return_type), run, return_spec);
+    absl::StrAppend(
+        &body,
+        EmitLeafElementLoops(
+            "return_value", return_type,
+            [](const std::string& element, const std::string& offset,
+               int64 bit_count) {
+              return absl::StrFormat(
+                  "%s = UnpackBits(return_value_buffer, %s, %d);", element,
+                  offset, bit_count);
+            }));
+  }
+  return absl::StrFormat("%s {\n%s  return return_value;\n}", signature, body);
 }
 
 }  // namespace
@@ -250,6 +354,7 @@ std::string GenerateWrapperHeader(const Function& function,
       R"(// Automatically-generated file! DO NOT EDIT!
 #ifndef $5
 #define $5
+#include <array>
 #include <memory>
 
 #include "absl/status/status.h"
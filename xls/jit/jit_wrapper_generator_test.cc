@@ -164,5 +164,66 @@ fn foo65(x: bits[65]) -> bits[65] {
   EXPECT_EQ(pos, std::string::npos);
 }
 
+TEST(JitWrapperGeneratorTest, GeneratesNativeArrays) {
+  constexpr const char kClassName[] = "MyClass";
+  const std::filesystem::path kHeaderPath =
+      "some/silly/genfiles/path/this_is_myclass.h";
+
+  const std::string program = R"(package p
+
+fn native(a: bits[16][2], x: bits[64], y: bits[8]) -> bits[32][2] {
+  bit_slice.4: bits[32] = bit_slice(x, start=0, width=32)
+  ret array.5: bits[32][2] = array(bit_slice.4, bit_slice.4)
+}
+
+fn nonnative(a: bits[5][2][2]) -> bits[5][2][2] {
+  ret identity.7: bits[5][2][2] = identity(a)
+}
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> p,
+                           Parser::ParsePackage(program));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, p->GetFunction("native"));
+  GeneratedJitWrapper generated = GenerateJitWrapper(
+      *f, kClassName, kHeaderPath, "some/silly/genfiles/path");
+  EXPECT_NE(generated.header.find(
+                "absl::StatusOr<std::array<uint32, 2>> Run(const "
+                "std::array<uint16, 2>& a, uint64 x, uint8 y);"),
+            std::string::npos);
+  // Arrays of native-width elements are passed to the JIT without copying.
+  EXPECT_EQ(generated.source.find("PackBits"), std::string::npos);
+  EXPECT_EQ(generated.source.find("UnpackBits"), std::string::npos);
+
+  // Elements narrower than their storage are (un)packed through a buffer.
+  XLS_ASSERT_OK_AND_ASSIGN(f, p->GetFunction("nonnative"));
+  generated = GenerateJitWrapper(*f, kClassName, kHeaderPath,
+                                 "some/silly/genfiles/path");
+  EXPECT_NE(generated.header.find(
+                "absl::StatusOr<std::array<std::array<uint8, 2>, 2>> "
+                "Run(const std::array<std::array<uint8, 2>, 2>& a);"),
+            std::string::npos);
+  EXPECT_NE(generated.source.find("PackBits"), std::string::npos);
+  EXPECT_NE(generated.source.find("UnpackBits"), std::string::npos);
+}
+
+TEST(JitWrapperGeneratorTest, NoSpecializationWithoutParams) {
+  constexpr const char kClassName[] = "MyClass";
+  const std::filesystem::path kHeaderPath =
+      "some/silly/genfiles/path/this_is_myclass.h";
+
+  const std::string program = R"(package p
+fn foo() -> bits[32] {
+  ret literal.1: bits[32] = literal(value=42)
+})";
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> p,
+                           Parser::ParsePackage(program));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, p->GetFunction("foo"));
+  GeneratedJitWrapper generated = GenerateJitWrapper(
+      *f, kClassName, kHeaderPath, "some/silly/genfiles/path");
+  // Only the Value-based Run() is generated; a native overload would clash.
+  EXPECT_EQ(generated.header.find("absl::StatusOr<uint32> Run()"),
+            std::string::npos);
+}
+
 }  // namespace
 }  // namespace xls
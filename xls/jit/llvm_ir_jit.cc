@@ -15,9 +15,11 @@
 #include "xls/jit/llvm_ir_jit.h"
 
 #include <cstddef>
+#include <functional>
 #include <memory>
 #include <random>
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/flags/flag.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
@@ -41,6 +43,7 @@
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
@@ -50,6 +53,7 @@
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "xls/codegen/vast.h"
 #include "xls/common/integral_types.h"
@@ -69,6 +73,215 @@ namespace {
 // Convenience alias for XLS type => LLVM type mapping used as a cache.
 using TypeCache = absl::flat_hash_map<const Type*, llvm::Type*>;
 
+// Entry points from JIT-compiled proc code into the JitChannelHandler. Flags
+// are passed as int64s to keep the calling convention trivial.
+int64 ReceiveTrampoline(JitChannelHandler* handler, Node* node,
+                        int64 operands_ready, int64 predicate, uint8* buffer) {
+  return handler->Receive(node, operands_ready != 0, predicate != 0, buffer)
+             ? 1
+             : 0;
+}
+
+void SendTrampoline(JitChannelHandler* handler, Node* node,
+                    int64 operands_ready, int64 predicate, const uint8* data) {
+  handler->Send(node, operands_ready != 0, predicate != 0, data);
+}
+
+// Packed values wider than this are unpacked and packed an element at a time
+// through memory, rather than as a single integer: shifting the whole integer
+// for each element takes time quadratic in its width to compile and run.
+constexpr int64 kMaxPackedRegisterBits = 64;
+
+// Emits a loop calling "body" with each index (an i64) in [0, count). Leaves
+// the builder at the end of the loop exit block.
+absl::Status EmitLoop(llvm::IRBuilder<>& builder, int64 count,
+                      const std::function<absl::Status(llvm::Value*)>& body) {
+  llvm::LLVMContext& context = builder.getContext();
+  llvm::Type* i64_type = llvm::Type::getInt64Ty(context);
+  llvm::Function* function = builder.GetInsertBlock()->getParent();
+  llvm::BasicBlock* preheader = builder.GetInsertBlock();
+  llvm::BasicBlock* loop_block = llvm::BasicBlock::Create(
+      context, "loop", function, /*InsertBefore=*/nullptr);
+  llvm::BasicBlock* exit_block = llvm::BasicBlock::Create(
+      context, "exit", function, /*InsertBefore=*/nullptr);
+  builder.CreateBr(loop_block);
+
+  builder.SetInsertPoint(loop_block);
+  llvm::PHINode* index = builder.CreatePHI(i64_type, 2);
+  index->addIncoming(llvm::ConstantInt::get(i64_type, 0), preheader);
+  XLS_RETURN_IF_ERROR(body(index));
+  // The body may itself contain loops, so the latch is the current block.
+  llvm::Value* next_index =
+      builder.CreateAdd(index, llvm::ConstantInt::get(i64_type, 1));
+  index->addIncoming(next_index, builder.GetInsertBlock());
+  llvm::Value* loop_again = builder.CreateICmpULT(
+      next_index, llvm::ConstantInt::get(i64_type, count));
+  builder.CreateCondBr(loop_again, loop_block, exit_block);
+  builder.SetInsertPoint(exit_block);
+  return absl::OkStatus();
+}
+
+// Returns a pointer to the smallest whole number of bytes of the packed buffer
+// "packed" (an i8*) covering "bit_count" bits at "bit_offset", as a pointer to
+// an integer of that many bytes, along with the offset of the bits within that
+// integer.
+std::pair<llvm::Value*, int64> GetPackedBitsPointer(llvm::IRBuilder<>& builder,
+                                                    llvm::Value* packed,
+                                                    int64 bit_offset,
+                                                    int64 bit_count) {
+  int64 shift = bit_offset % 8;
+  llvm::Type* span_type = llvm::IntegerType::get(
+      builder.getContext(), RoundUpToNearest(shift + bit_count, int64{8}));
+  llvm::Value* pointer = builder.CreateBitCast(
+      builder.CreateConstGEP1_64(builder.getInt8Ty(), packed, bit_offset / 8),
+      llvm::PointerType::get(span_type, /*AddressSpace=*/0));
+  return {pointer, shift};
+}
+
+// Returns whether the elements of the array at "bit_offset" bits into a packed
+// buffer all start on byte boundaries, so can be accessed in a loop.
+bool HasByteAlignedElements(ArrayType* array_type, int64 bit_offset) {
+  return bit_offset % 8 == 0 &&
+         array_type->element_type()->GetFlatBitCount() % 8 == 0;
+}
+
+// Unpacks the value of the given type at "bit_offset" bits into the packed
+// buffer "packed" (an i8*) into "buffer", which points to the value in the
+// native layout.
+absl::Status UnpackToBuffer(llvm::IRBuilder<>& builder, Type* type,
+                            llvm::Value* packed, int64 bit_offset,
+                            llvm::Value* buffer) {
+  switch (type->kind()) {
+    case TypeKind::kBits: {
+      llvm::Type* llvm_type = buffer->getType()->getPointerElementType();
+      int64 bit_count = type->GetFlatBitCount();
+      llvm::Value* value = llvm::ConstantInt::get(llvm_type, 0);
+      if (bit_count != 0) {
+        auto [pointer, shift] =
+            GetPackedBitsPointer(builder, packed, bit_offset, bit_count);
+        llvm::Value* span = builder.CreateAlignedLoad(
+            pointer->getType()->getPointerElementType(), pointer,
+            llvm::Align(1));
+        value = builder.CreateTrunc(builder.CreateLShr(span, shift), llvm_type);
+      }
+      builder.CreateStore(value, buffer);
+      return absl::OkStatus();
+    }
+    case TypeKind::kArray: {
+      ArrayType* array_type = type->AsArrayOrDie();
+      Type* element_type = array_type->element_type();
+      int64 element_bits = element_type->GetFlatBitCount();
+      if (HasByteAlignedElements(array_type, bit_offset)) {
+        return EmitLoop(builder, array_type->size(), [&](llvm::Value* index) {
+          llvm::Value* element_packed = builder.CreateGEP(
+              builder.CreateConstGEP1_64(builder.getInt8Ty(), packed,
+                                         bit_offset / 8),
+              builder.CreateMul(index, builder.getInt64(element_bits / 8)));
+          return UnpackToBuffer(
+              builder, element_type, element_packed, /*bit_offset=*/0,
+              builder.CreateGEP(buffer, {builder.getInt64(0), index}));
+        });
+      }
+      for (int64 i = 0; i < array_type->size(); ++i) {
+        XLS_RETURN_IF_ERROR(UnpackToBuffer(
+            builder, element_type, packed, bit_offset + i * element_bits,
+            builder.CreateGEP(buffer,
+                              {builder.getInt64(0), builder.getInt64(i)})));
+      }
+      return absl::OkStatus();
+    }
+    case TypeKind::kTuple: {
+      // Tuple elements are stored MSB -> LSB.
+      TupleType* tuple_type = type->AsTupleOrDie();
+      for (int64 i = tuple_type->size() - 1; i >= 0; --i) {
+        XLS_RETURN_IF_ERROR(UnpackToBuffer(
+            builder, tuple_type->element_type(i), packed, bit_offset,
+            builder.CreateGEP(buffer,
+                              {builder.getInt64(0), builder.getInt32(i)})));
+        bit_offset += tuple_type->element_type(i)->GetFlatBitCount();
+      }
+      return absl::OkStatus();
+    }
+    default:
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Unhandled type kind: ", TypeKindToString(type->kind())));
+  }
+}
+
+// The inverse of UnpackToBuffer(). Bits of the packed buffer outside the value
+// are preserved.
+absl::Status PackFromBuffer(llvm::IRBuilder<>& builder, Type* type,
+                            llvm::Value* buffer, llvm::Value* packed,
+                            int64 bit_offset) {
+  switch (type->kind()) {
+    case TypeKind::kBits: {
+      int64 bit_count = type->GetFlatBitCount();
+      if (bit_count == 0) {
+        return absl::OkStatus();
+      }
+      auto [pointer, shift] =
+          GetPackedBitsPointer(builder, packed, bit_offset, bit_count);
+      llvm::Type* span_type = pointer->getType()->getPointerElementType();
+      llvm::Value* span = builder.CreateZExt(
+          builder.CreateLoad(buffer->getType()->getPointerElementType(),
+                             buffer),
+          span_type);
+      if (span_type->getIntegerBitWidth() != bit_count) {
+        llvm::APInt mask = llvm::APInt::getBitsSet(
+            span_type->getIntegerBitWidth(), shift, shift + bit_count);
+        llvm::Value* original =
+            builder.CreateAlignedLoad(span_type, pointer, llvm::Align(1));
+        span = builder.CreateOr(
+            builder.CreateAnd(original,
+                              llvm::ConstantInt::get(span_type, ~mask)),
+            builder.CreateShl(span, shift));
+      }
+      builder.CreateAlignedStore(span, pointer, llvm::Align(1));
+      return absl::OkStatus();
+    }
+    case TypeKind::kArray: {
+      ArrayType* array_type = type->AsArrayOrDie();
+      Type* element_type = array_type->element_type();
+      int64 element_bits = element_type->GetFlatBitCount();
+      if (HasByteAlignedElements(array_type, bit_offset)) {
+        return EmitLoop(builder, array_type->size(), [&](llvm::Value* index) {
+          llvm::Value* element_packed = builder.CreateGEP(
+              builder.CreateConstGEP1_64(builder.getInt8Ty(), packed,
+                                         bit_offset / 8),
+              builder.CreateMul(index, builder.getInt64(element_bits / 8)));
+          return PackFromBuffer(
+              builder, element_type,
+              builder.CreateGEP(buffer, {builder.getInt64(0), index}),
+              element_packed, /*bit_offset=*/0);
+        });
+      }
+      for (int64 i = 0; i < array_type->size(); ++i) {
+        XLS_RETURN_IF_ERROR(PackFromBuffer(
+            builder, element_type,
+            builder.CreateGEP(buffer,
+                              {builder.getInt64(0), builder.getInt64(i)}),
+            packed, bit_offset + i * element_bits));
+      }
+      return absl::OkStatus();
+    }
+    case TypeKind::kTuple: {
+      TupleType* tuple_type = type->AsTupleOrDie();
+      for (int64 i = tuple_type->size() - 1; i >= 0; --i) {
+        XLS_RETURN_IF_ERROR(PackFromBuffer(
+            builder, tuple_type->element_type(i),
+            builder.CreateGEP(buffer,
+                              {builder.getInt64(0), builder.getInt32(i)}),
+            packed, bit_offset));
+        bit_offset += tuple_type->element_type(i)->GetFlatBitCount();
+      }
+      return absl::OkStatus();
+    }
+    default:
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Unhandled element kind: ", TypeKindToString(type->kind())));
+  }
+}
+
 // Visitor to construct LLVM IR for each encountered XLS IR node. Based on
 // DfsVisitorWithDefault to highlight any unhandled IR nodes.
 class BuilderVisitor : public DfsVisitorWithDefault {
@@ -81,14 +294,17 @@ class BuilderVisitor : public DfsVisitorWithDefault {
                           absl::Span<Param* const> params,
                           absl::optional<Function*> llvm_entry_function,
                           LlvmTypeConverter* type_converter,
-                          bool generate_packed)
+                          bool generate_packed,
+                          JitChannelHandler* channel_handler = nullptr)
       : module_(module),
         context_(&module_->getContext()),
         builder_(builder),
         return_value_(nullptr),
+        return_node_(nullptr),
         type_converter_(type_converter),
         llvm_entry_function_(llvm_entry_function),
-        generate_packed_(generate_packed) {
+        generate_packed_(generate_packed),
+        channel_handler_(channel_handler) {
     for (int i = 0; i < params.size(); ++i) {
       int64 start = i == 0 ? 0 : arg_indices_[i - 1].second + 1;
       int64 end =
@@ -116,14 +332,8 @@ class BuilderVisitor : public DfsVisitorWithDefault {
 
   absl::Status HandleAfterAll(AfterAll* after_all) override {
     // AfterAll is only meaningful to the compiler and does not actually perform
-    // any computation. Furter, token types don't contain any data. A 0-element
-    // array is a convenient and low-overhead way to let the rest of the llvm
-    // infrastructure treat token like a normal data-type.
-    return StoreResult(
-        after_all,
-        llvm::ConstantArray::get(
-            llvm::ArrayType::get(llvm::IntegerType::get(*context_, 1), 0),
-            llvm::ArrayRef<llvm::Constant*>()));
+    // any computation.
+    return StoreResult(after_all, CreateToken());
   }
 
   absl::Status HandleArray(Array* array) override {
@@ -141,7 +351,6 @@ class BuilderVisitor : public DfsVisitorWithDefault {
 
   absl::Status HandleArrayIndex(ArrayIndex* index) override {
     // Get the pointer to the element of interest, then load it. Easy peasy.
-    llvm::Value* array = node_map_.at(index->operand(0));
     llvm::Value* index_value = node_map_.at(index->operand(1));
     int64 index_width = index_value->getType()->getIntegerBitWidth();
 
@@ -153,29 +362,35 @@ class BuilderVisitor : public DfsVisitorWithDefault {
             index_value, llvm::IntegerType::get(*context_, index_width + 1))};
 
     // Ideally, we'd use IRBuilder::CreateExtractValue here, but that requires
-    // constant indices. Since there's no other way to extract a value from an
-    // aggregate, we're left with storing the value in a temporary alloca and
-    // using that pointer to extract the value.
-    llvm::AllocaInst* alloca;
-    if (!array_storage_.contains(array)) {
-      alloca = builder_->CreateAlloca(array->getType());
-      builder_->CreateStore(array, alloca);
-      array_storage_[array] = alloca;
-    } else {
-      alloca = array_storage_[array];
-    }
-
-    llvm::Value* gep = builder_->CreateGEP(alloca, gep_indices);
+    // constant indices, so index into the array's buffer instead.
+    llvm::Value* gep =
+        builder_->CreateGEP(GetArrayBuffer(index->operand(0)), gep_indices);
     return StoreResult(index, builder_->CreateLoad(gep));
   }
 
   absl::Status HandleArrayUpdate(ArrayUpdate* update) override {
-    llvm::Value* original_array = node_map_.at(update->operand(0));
-    llvm::Type* array_type = original_array->getType();
+    Node* original_array = update->operand(0);
+    llvm::Type* array_type = node_map_.at(original_array)->getType();
     llvm::Value* index_value = node_map_.at(update->operand(1));
     llvm::Value* update_value = node_map_.at(update->operand(2));
-    llvm::AllocaInst* alloca = builder_->CreateAlloca(array_type);
-    builder_->CreateStore(original_array, alloca);
+
+    // If nothing else reads the original array, update its buffer in place,
+    // which makes a chain of updates O(1) each. Otherwise, copy it.
+    llvm::Value* buffer;
+    auto it = array_buffers_.find(original_array);
+    if (CanUpdateInPlace(original_array)) {
+      buffer = it->second.pointer;
+    } else {
+      buffer = CreateEntryBlockAlloca(array_type);
+      if (it != array_buffers_.end()) {
+        builder_->CreateMemCpy(
+            buffer, llvm::MaybeAlign(0), it->second.pointer,
+            llvm::MaybeAlign(0),
+            type_converter_->GetTypeByteSize(*update->GetType()));
+      } else {
+        builder_->CreateStore(node_map_.at(original_array), buffer);
+      }
+    }
 
     // We must compare the index to the size of the array. Both arguments
     // for this comparison must have the same bitwidth, so we will cast the
@@ -203,22 +418,14 @@ class BuilderVisitor : public DfsVisitorWithDefault {
         builder_->CreateZExt(
             bounds_safe_index_value,
             llvm::IntegerType::get(*context_, index_bitwidth + 1))};
-    llvm::Value* gep = builder_->CreateGEP(alloca, gep_indices);
+    llvm::Value* gep = builder_->CreateGEP(buffer, gep_indices);
     llvm::Value* original_element_value = builder_->CreateLoad(gep);
     llvm::Value* bounds_safe_update_value = builder_->CreateSelect(
         index_inbounds, update_value, original_element_value);
     builder_->CreateStore(bounds_safe_update_value, gep);
+    array_buffers_[update] = {buffer, /*writable=*/true};
 
-    llvm::Value* update_array = builder_->CreateLoad(array_type, alloca);
-    // Record allocated memory for updated array.
-    if (array_storage_.contains(update_array)) {
-      return absl::InternalError(absl::StrFormat(
-          "Newly created update array %s was already allocated memory somehow.",
-          update->ToString()));
-    }
-    array_storage_[update_array] = alloca;
-
-    return StoreResult(update, update_array);
+    return StoreResult(update, GetArrayValue(update, buffer));
   }
 
   absl::Status HandleArrayConcat(ArrayConcat* concat) override {
@@ -335,16 +542,49 @@ class BuilderVisitor : public DfsVisitorWithDefault {
     for (int i = 0; i < counted_for->invariant_args().size(); i++) {
       args[i + 2] = node_map_.at(counted_for->invariant_args()[i]);
     }
-    args[1] = node_map_.at(counted_for->initial_value());
-
-    llvm::Type* function_type = function->getType()->getPointerElementType();
-    for (int i = 0; i < counted_for->trip_count(); ++i) {
-      args[0] = llvm::ConstantInt::get(function_type->getFunctionParamType(0),
-                                       i * counted_for->stride());
-      args[1] = builder_->CreateCall(function, {args});
+    llvm::Value* initial_value = node_map_.at(counted_for->initial_value());
+    if (counted_for->trip_count() == 0) {
+      return StoreResult(counted_for, initial_value);
     }
 
-    return StoreResult(counted_for, args[1]);
+    // Emit a loop calling the body once per iteration, with the loop carry in
+    // a phi, rather than a call per iteration: the latter makes the size of
+    // the LLVM IR (and the optimization time) proportional to the trip count.
+    // LLVM unrolls the loop itself where that is profitable.
+    llvm::Type* index_type =
+        function->getType()->getPointerElementType()->getFunctionParamType(0);
+    llvm::Type* i64_type = llvm::Type::getInt64Ty(*context_);
+    llvm::BasicBlock* preheader = builder_->GetInsertBlock();
+    llvm::BasicBlock* loop_block =
+        CreateBasicBlock(absl::StrCat(counted_for->GetName(), "_loop"));
+    llvm::BasicBlock* exit_block =
+        CreateBasicBlock(absl::StrCat(counted_for->GetName(), "_exit"));
+    builder_->CreateBr(loop_block);
+
+    builder_->SetInsertPoint(loop_block);
+    llvm::PHINode* iteration = builder_->CreatePHI(i64_type, 2);
+    iteration->addIncoming(llvm::ConstantInt::get(i64_type, 0), preheader);
+    llvm::PHINode* loop_carry =
+        builder_->CreatePHI(initial_value->getType(), 2);
+    loop_carry->addIncoming(initial_value, preheader);
+    args[0] = builder_->CreateZExtOrTrunc(
+        builder_->CreateMul(
+            iteration, llvm::ConstantInt::get(i64_type, counted_for->stride())),
+        index_type);
+    args[1] = loop_carry;
+    llvm::Value* body_result = builder_->CreateCall(function, args);
+    llvm::Value* next_iteration =
+        builder_->CreateAdd(iteration, llvm::ConstantInt::get(i64_type, 1));
+    iteration->addIncoming(next_iteration, loop_block);
+    loop_carry->addIncoming(body_result, loop_block);
+    builder_->CreateCondBr(
+        builder_->CreateICmpULT(
+            next_iteration,
+            llvm::ConstantInt::get(i64_type, counted_for->trip_count())),
+        loop_block, exit_block);
+
+    builder_->SetInsertPoint(exit_block);
+    return StoreResult(counted_for, body_result);
   }
 
   absl::Status HandleDecode(Decode* decode) override {
@@ -400,7 +640,17 @@ class BuilderVisitor : public DfsVisitorWithDefault {
   }
 
   absl::Status HandleIdentity(UnOp* identity) override {
-    return StoreResult(identity, node_map_.at(identity->operand(0)));
+    llvm::Value* value = node_map_.at(identity->operand(0));
+    auto it = array_buffers_.find(identity->operand(0));
+    if (it != array_buffers_.end()) {
+      ArrayBuffer buffer = {it->second.pointer,
+                            CanUpdateInPlace(identity->operand(0))};
+      array_buffers_[identity] = buffer;
+      if (llvm::isa<llvm::UndefValue>(value)) {
+        value = GetArrayValue(identity, buffer.pointer);
+      }
+    }
+    return StoreResult(identity, value);
   }
 
   absl::Status HandleInvoke(Invoke* invoke) override {
@@ -433,17 +683,48 @@ class BuilderVisitor : public DfsVisitorWithDefault {
     llvm::Type* input_type = input->getType();
     llvm::FunctionType* function_type = llvm::cast<llvm::FunctionType>(
         to_apply->getType()->getPointerElementType());
-
-    llvm::Value* result = CreateTypedZeroValue(llvm::ArrayType::get(
-        function_type->getReturnType(), input_type->getArrayNumElements()));
-
-    for (uint32 i = 0; i < input_type->getArrayNumElements(); ++i) {
-      llvm::Value* iter_input = builder_->CreateExtractValue(input, {i});
-      llvm::Value* iter_result = builder_->CreateCall(to_apply, iter_input);
-      result = builder_->CreateInsertValue(result, iter_result, {i});
+    llvm::Type* result_type = llvm::ArrayType::get(
+        function_type->getReturnType(), input_type->getArrayNumElements());
+    if (input_type->getArrayNumElements() == 0) {
+      return StoreResult(map, CreateTypedZeroValue(result_type));
     }
 
-    return StoreResult(map, result);
+    // As with counted_for, emit a loop over the elements rather than a call
+    // per element. The elements are indexed dynamically, so the input and
+    // result go through stack buffers, which LLVM promotes to registers again
+    // if it unrolls the loop.
+    llvm::AllocaInst* input_buffer = CreateEntryBlockAlloca(input_type);
+    builder_->CreateStore(input, input_buffer);
+    llvm::AllocaInst* result_buffer = CreateEntryBlockAlloca(result_type);
+
+    llvm::Type* i64_type = llvm::Type::getInt64Ty(*context_);
+    llvm::Value* zero = llvm::ConstantInt::get(i64_type, 0);
+    llvm::BasicBlock* preheader = builder_->GetInsertBlock();
+    llvm::BasicBlock* loop_block =
+        CreateBasicBlock(absl::StrCat(map->GetName(), "_loop"));
+    llvm::BasicBlock* exit_block =
+        CreateBasicBlock(absl::StrCat(map->GetName(), "_exit"));
+    builder_->CreateBr(loop_block);
+
+    builder_->SetInsertPoint(loop_block);
+    llvm::PHINode* index = builder_->CreatePHI(i64_type, 2);
+    index->addIncoming(zero, preheader);
+    llvm::Value* iter_input =
+        builder_->CreateLoad(builder_->CreateGEP(input_buffer, {zero, index}));
+    llvm::Value* iter_result = builder_->CreateCall(to_apply, iter_input);
+    builder_->CreateStore(iter_result,
+                          builder_->CreateGEP(result_buffer, {zero, index}));
+    llvm::Value* next_index =
+        builder_->CreateAdd(index, llvm::ConstantInt::get(i64_type, 1));
+    index->addIncoming(next_index, loop_block);
+    builder_->CreateCondBr(
+        builder_->CreateICmpULT(
+            next_index, llvm::ConstantInt::get(
+                            i64_type, input_type->getArrayNumElements())),
+        loop_block, exit_block);
+
+    builder_->SetInsertPoint(exit_block);
+    return StoreResult(map, builder_->CreateLoad(result_buffer));
   }
 
   absl::Status HandleSMul(ArithOp* mul) override { return HandleArithOp(mul); }
@@ -622,10 +903,13 @@ class BuilderVisitor : public DfsVisitorWithDefault {
         builder_->CreateLoad(gep->getType()->getPointerElementType(), gep);
     llvm::Value* cast = builder_->CreateBitCast(load, llvm_arg_ptr_type);
 
-    // Load 2: Get the data at that pointer's destination.
-    load = builder_->CreateLoad(arg_type, cast);
-
-    return StoreResult(param, load);
+    // Load 2: Get the data at that pointer's destination. Arrays are instead
+    // accessed in place in the argument buffer where possible.
+    if (param->GetType()->IsArray()) {
+      array_buffers_[param] = {cast, /*writable=*/false};
+      return StoreResult(param, GetArrayValue(param, cast));
+    }
+    return StoreResult(param, builder_->CreateLoad(arg_type, cast));
   }
 
   absl::Status HandlePackedParam(Param* param) {
@@ -651,6 +935,19 @@ class BuilderVisitor : public DfsVisitorWithDefault {
     // The GEP gives a pointer to a u8*; so 'load' is a i8. Cast it to its full
     // width so we can load the whole thing.
     llvm::LoadInst* load = builder_->CreateLoad(gep);
+    if (param->GetType()->GetFlatBitCount() > kMaxPackedRegisterBits) {
+      // Unpack wide values through memory. Arrays are then used straight from
+      // the buffer, which is owned by the param.
+      llvm::AllocaInst* buffer = CreateEntryBlockAlloca(
+          type_converter_->ConvertToLlvmType(*param->GetType()));
+      XLS_RETURN_IF_ERROR(UnpackToBuffer(*builder_, param->GetType(), load,
+                                         /*bit_offset=*/0, buffer));
+      if (param->GetType()->IsArray()) {
+        array_buffers_[param] = {buffer, /*writable=*/true};
+        return StoreResult(param, GetArrayValue(param, buffer));
+      }
+      return StoreResult(param, builder_->CreateLoad(buffer));
+    }
     llvm::Type* packed_arg_type =
         llvm::IntegerType::get(*context_, param->GetType()->GetFlatBitCount());
     llvm::Value* cast = builder_->CreateBitCast(
@@ -714,6 +1011,15 @@ class BuilderVisitor : public DfsVisitorWithDefault {
     }
   }
 
+  absl::Status HandleReceive(Receive* receive) override {
+    return HandleReceiveInternal(receive, /*predicate=*/nullptr);
+  }
+
+  absl::Status HandleReceiveIf(ReceiveIf* receive_if) override {
+    return HandleReceiveInternal(receive_if,
+                                 node_map_.at(receive_if->predicate()));
+  }
+
   absl::Status HandleReverse(UnOp* reverse) override {
     llvm::Value* input = node_map_.at(reverse->operand(0));
     llvm::Function* reverse_fn = llvm::Intrinsic::getDeclaration(
@@ -745,6 +1051,16 @@ class BuilderVisitor : public DfsVisitorWithDefault {
     return StoreResult(sel, llvm_sel);
   }
 
+  absl::Status HandleSend(Send* send) override {
+    return HandleSendInternal(send, send->data_operands(),
+                              /*predicate=*/nullptr);
+  }
+
+  absl::Status HandleSendIf(SendIf* send_if) override {
+    return HandleSendInternal(send_if, send_if->data_operands(),
+                              node_map_.at(send_if->predicate()));
+  }
+
   absl::Status HandleSGe(CompareOp* ge) override {
     llvm::Value* lhs = node_map_.at(ge->operand(0));
     llvm::Value* rhs = node_map_.at(ge->operand(1));
@@ -864,7 +1180,118 @@ class BuilderVisitor : public DfsVisitorWithDefault {
 
   llvm::Value* return_value() { return return_value_; }
 
+  // Returns a pointer to memory holding the return value if it is an array
+  // which is held in a buffer, or nullptr otherwise.
+  llvm::Value* return_buffer() {
+    auto it = array_buffers_.find(return_node_);
+    return it == array_buffers_.end() ? nullptr : it->second.pointer;
+  }
+
  private:
+  // Lowers a receive[_if] to a call into the channel handler, which writes the
+  // received (token, data...) tuple into a stack buffer. "predicate" is null
+  // for unconditional receives.
+  absl::Status HandleReceiveInternal(Node* node, llvm::Value* predicate) {
+    XLS_RETURN_IF_ERROR(CheckChannelHandler(node));
+    llvm::Type* result_type =
+        type_converter_->ConvertToLlvmType(*node->GetType());
+    // Zero the buffer so a blocked receive yields a well-defined (if unused)
+    // value.
+    llvm::AllocaInst* buffer = CreateEntryBlockAlloca(result_type);
+    builder_->CreateStore(CreateTypedZeroValue(result_type), buffer);
+
+    llvm::Value* operands_ready = OperandsReady(node);
+    llvm::Value* received = CallChannelHandler(
+        reinterpret_cast<uint64>(&ReceiveTrampoline), node, operands_ready,
+        predicate, buffer, llvm::Type::getInt64Ty(*context_));
+    XLS_RETURN_IF_ERROR(StoreResult(node, builder_->CreateLoad(buffer)));
+
+    // Nothing downstream of this receive can execute unless it completed.
+    node_ready_[node] = builder_->CreateICmpNE(
+        received, llvm::ConstantInt::get(received->getType(), 0));
+    return absl::OkStatus();
+  }
+
+  // Lowers a send[_if] to a call into the channel handler, passing the data
+  // operands as a tuple in a stack buffer.
+  absl::Status HandleSendInternal(Node* node,
+                                  absl::Span<Node* const> data_operands,
+                                  llvm::Value* predicate) {
+    XLS_RETURN_IF_ERROR(CheckChannelHandler(node));
+    std::vector<Type*> data_types;
+    for (Node* operand : data_operands) {
+      data_types.push_back(operand->GetType());
+    }
+    llvm::Type* data_type = type_converter_->ConvertToLlvmType(
+        *node->function()->package()->GetTupleType(data_types));
+    llvm::Value* data = CreateTypedZeroValue(data_type);
+    for (uint32 i = 0; i < data_operands.size(); ++i) {
+      data = builder_->CreateInsertValue(data, node_map_.at(data_operands[i]),
+                                         {i});
+    }
+    llvm::AllocaInst* buffer = CreateEntryBlockAlloca(data_type);
+    builder_->CreateStore(data, buffer);
+
+    CallChannelHandler(reinterpret_cast<uint64>(&SendTrampoline), node,
+                       OperandsReady(node), predicate, buffer,
+                       llvm::Type::getVoidTy(*context_));
+    return StoreResult(node, CreateToken());
+  }
+
+  absl::Status CheckChannelHandler(Node* node) {
+    if (channel_handler_ == nullptr) {
+      return absl::UnimplementedError(absl::StrCat(
+          "Channel operations are only supported when compiling procs: ",
+          node->ToString()));
+    }
+    return absl::OkStatus();
+  }
+
+  // Emits a call to the given trampoline (see ReceiveTrampoline and
+  // SendTrampoline) with the handler and node pointers baked in as constants.
+  llvm::Value* CallChannelHandler(uint64 trampoline, Node* node,
+                                  llvm::Value* operands_ready,
+                                  llvm::Value* predicate, llvm::Value* buffer,
+                                  llvm::Type* return_type) {
+    llvm::Type* i64_type = llvm::Type::getInt64Ty(*context_);
+    llvm::Type* i8_ptr_type = llvm::Type::getInt8PtrTy(*context_);
+    auto pointer_constant = [&](uint64 address, llvm::Type* type) {
+      return llvm::ConstantExpr::getIntToPtr(
+          llvm::ConstantInt::get(i64_type, address), type);
+    };
+
+    llvm::FunctionType* function_type = llvm::FunctionType::get(
+        return_type,
+        {i8_ptr_type, i8_ptr_type, i64_type, i64_type, i8_ptr_type},
+        /*isVarArg=*/false);
+    llvm::Value* predicate_arg =
+        predicate == nullptr ? llvm::ConstantInt::get(i64_type, 1)
+                             : builder_->CreateZExt(predicate, i64_type);
+    return builder_->CreateCall(
+        function_type,
+        pointer_constant(trampoline, function_type->getPointerTo()),
+        {pointer_constant(reinterpret_cast<uint64>(channel_handler_),
+                          i8_ptr_type),
+         pointer_constant(reinterpret_cast<uint64>(node), i8_ptr_type),
+         builder_->CreateZExt(operands_ready, i64_type), predicate_arg,
+         builder_->CreateBitCast(buffer, i8_ptr_type)});
+  }
+
+  // Returns an i1 which is true iff every receive in the transitive operand
+  // cone of "node" completed in this invocation.
+  llvm::Value* OperandsReady(Node* node) {
+    llvm::Value* ready = builder_->getTrue();
+    for (Node* operand : node->operands()) {
+      llvm::Value* operand_ready = node_ready_.at(operand);
+      if (operand_ready != builder_->getTrue()) {
+        ready = ready == builder_->getTrue()
+                    ? operand_ready
+                    : builder_->CreateAnd(ready, operand_ready);
+      }
+    }
+    return ready;
+  }
+
   absl::Status HandleArithOp(ArithOp* arith_op) {
     bool is_signed;
     switch (arith_op->op()) {
@@ -1029,6 +1456,15 @@ class BuilderVisitor : public DfsVisitorWithDefault {
                                             : builder_->CreateURem(lhs, rhs));
   }
 
+  // Token types don't contain any data. A 0-element array is a convenient and
+  // low-overhead way to let the rest of the llvm infrastructure treat token
+  // like a normal data-type.
+  llvm::Constant* CreateToken() {
+    return llvm::ConstantArray::get(
+        llvm::ArrayType::get(llvm::IntegerType::get(*context_, 1), 0),
+        llvm::ArrayRef<llvm::Constant*>());
+  }
+
   llvm::Constant* CreateTypedZeroValue(llvm::Type* type) {
     if (type->isIntegerTy()) {
       return llvm::ConstantInt::get(type, 0);
@@ -1050,6 +1486,77 @@ class BuilderVisitor : public DfsVisitorWithDefault {
                                      elements);
   }
 
+  // Returns a new basic block at the end of the function being built.
+  llvm::BasicBlock* CreateBasicBlock(absl::string_view name) {
+    return llvm::BasicBlock::Create(
+        *context_, verilog::SanitizeIdentifier(name),
+        builder_->GetInsertBlock()->getParent(), /*InsertBefore=*/nullptr);
+  }
+
+  // Creates a stack buffer in the entry block of the function being built.
+  // Once loops split the function into multiple blocks, allocas elsewhere are
+  // not promoted to registers by LLVM.
+  llvm::AllocaInst* CreateEntryBlockAlloca(llvm::Type* type) {
+    llvm::BasicBlock& entry_block =
+        builder_->GetInsertBlock()->getParent()->getEntryBlock();
+    llvm::IRBuilder<> entry_builder(&entry_block, entry_block.begin());
+    return entry_builder.CreateAlloca(type);
+  }
+
+  // Returns a pointer to memory holding the value of the array node. Literal
+  // arrays, such as lookup tables, are placed in constant globals rather than
+  // being copied to the stack on each call.
+  llvm::Value* GetArrayBuffer(Node* array) {
+    auto it = array_buffers_.find(array);
+    if (it != array_buffers_.end()) {
+      return it->second.pointer;
+    }
+    llvm::Value* value = node_map_.at(array);
+    if (auto* constant = llvm::dyn_cast<llvm::Constant>(value)) {
+      auto* global = new llvm::GlobalVariable(
+          *module_, value->getType(), /*isConstant=*/true,
+          llvm::GlobalValue::PrivateLinkage, constant,
+          verilog::SanitizeIdentifier(array->GetName()));
+      array_buffers_[array] = {global, /*writable=*/false};
+      return global;
+    }
+    llvm::AllocaInst* alloca = CreateEntryBlockAlloca(value->getType());
+    builder_->CreateStore(value, alloca);
+    array_buffers_[array] = {alloca, /*writable=*/true};
+    return alloca;
+  }
+
+  // Returns the aggregate value of the array node held in "buffer". Only
+  // users other than array_index, array_update and identity need the value
+  // itself, so if there are none the (possibly large) load is not emitted and
+  // undef is returned.
+  llvm::Value* GetArrayValue(Node* array, llvm::Value* buffer) {
+    llvm::Type* array_type = buffer->getType()->getPointerElementType();
+    // The entry function copies an array return value out of its buffer.
+    bool value_used = array->function()->return_value() == array &&
+                      (!llvm_entry_function_.has_value() ||
+                       array->function() != *llvm_entry_function_);
+    for (Node* user : array->users()) {
+      // The array cannot also be the index or update value of these users.
+      value_used |= user->op() != Op::kIdentity &&
+                    user->op() != Op::kArrayIndex &&
+                    user->op() != Op::kArrayUpdate;
+    }
+    if (!value_used) {
+      return llvm::UndefValue::get(array_type);
+    }
+    return builder_->CreateLoad(array_type, buffer);
+  }
+
+  // Returns whether the buffer of the array node may be updated in place by
+  // its user: the node owns the buffer and nothing else reads it.
+  bool CanUpdateInPlace(Node* array) {
+    auto it = array_buffers_.find(array);
+    return it != array_buffers_.end() && it->second.writable &&
+           array->users().size() == 1 &&
+           array->function()->return_value() != array;
+  }
+
   llvm::Value* CreateAggregateOr(llvm::Value* lhs, llvm::Value* rhs) {
     llvm::Type* arg_type = lhs->getType();
     if (arg_type->isIntegerTy()) {
@@ -1156,9 +1663,13 @@ class BuilderVisitor : public DfsVisitorWithDefault {
     XLS_RET_CHECK(!node_map_.contains(node));
     value->setName(verilog::SanitizeIdentifier(node->GetName()));
     if (node->function()->return_value() == node) {
+      return_node_ = node;
       return_value_ = value;
     }
     node_map_[node] = value;
+    if (channel_handler_ != nullptr) {
+      node_ready_[node] = OperandsReady(node);
+    }
 
     return absl::OkStatus();
   }
@@ -1172,16 +1683,24 @@ class BuilderVisitor : public DfsVisitorWithDefault {
   std::vector<std::pair<int64, int64>> arg_indices_;
 
   // The last value constructed during this traversal - represents the return
-  // from calculation.
+  // from calculation - and the node it was constructed for.
   llvm::Value* return_value_;
+  Node* return_node_;
 
   // Maps an XLS Node to the resulting LLVM Value.
   absl::flat_hash_map<Node*, llvm::Value*> node_map_;
 
-  // Holds storage for array indexing ops. Since we need to dump arrays to
-  // storage to extract elements (i.e., for GEPs), it makes sense to only create
-  // and store the array once.
-  absl::flat_hash_map<llvm::Value*, llvm::AllocaInst*> array_storage_;
+  // Memory holding the value of an array node, through which array_index and
+  // array_update access elements without going through the aggregate value.
+  // Buffers are created on first use, by an array_update, or for arrays passed
+  // in by the caller.
+  struct ArrayBuffer {
+    llvm::Value* pointer;
+    // Whether the buffer belongs to the node, so may be updated in place once
+    // no other node reads it. Argument buffers and constants are read-only.
+    bool writable;
+  };
+  absl::flat_hash_map<Node*, ArrayBuffer> array_buffers_;
 
   LlvmTypeConverter* type_converter_;
 
@@ -1192,6 +1711,13 @@ class BuilderVisitor : public DfsVisitorWithDefault {
   // True if this builder should generate packed parameter loads (as in the
   // header comment for LlvmIrJit::RunWithPackedViews()).
   bool generate_packed_;
+
+  // Target of send and receive nodes; null unless compiling a proc.
+  JitChannelHandler* channel_handler_;
+
+  // When compiling a proc, maps each node to an i1 indicating whether every
+  // receive it (transitively) depends upon completed.
+  absl::flat_hash_map<Node*, llvm::Value*> node_ready_;
 };
 
 absl::once_flag once;
@@ -1204,10 +1730,23 @@ void OnceInit() {
 }  // namespace
 
 absl::StatusOr<std::unique_ptr<LlvmIrJit>> LlvmIrJit::Create(
-    Function* xls_function, int64 opt_level) {
+    Function* xls_function, int64 opt_level, JitObjectCache* object_cache) {
   absl::call_once(once, OnceInit);
 
-  auto jit = absl::WrapUnique(new LlvmIrJit(xls_function, opt_level));
+  auto jit = absl::WrapUnique(new LlvmIrJit(
+      xls_function, opt_level, /*channel_handler=*/nullptr, object_cache));
+  XLS_RETURN_IF_ERROR(jit->Init());
+  XLS_RETURN_IF_ERROR(jit->Compile());
+  return jit;
+}
+
+absl::StatusOr<std::unique_ptr<LlvmIrJit>> LlvmIrJit::CreateProc(
+    Proc* proc, JitChannelHandler* channel_handler, int64 opt_level) {
+  XLS_RET_CHECK(channel_handler != nullptr);
+  absl::call_once(once, OnceInit);
+
+  auto jit =
+      absl::WrapUnique(new LlvmIrJit(proc, opt_level, channel_handler));
   XLS_RETURN_IF_ERROR(jit->Init());
   XLS_RETURN_IF_ERROR(jit->Compile());
   return jit;
@@ -1218,10 +1757,19 @@ absl::Status LlvmIrJit::Compile() {
   auto module = std::make_unique<llvm::Module>("the_module", *bare_context);
   module->setDataLayout(data_layout_);
   XLS_RETURN_IF_ERROR(CompileFunction(module.get()));
-  XLS_RETURN_IF_ERROR(CompilePackedViewFunction(module.get()));
-  llvm::Error error = transform_layer_->add(
-      dylib_, llvm::orc::ThreadSafeModule(std::move(module), context_));
-  if (error) {
+  // Packed views and batching aren't offered for procs, whose state is owned by
+  // the caller.
+  if (channel_handler_ == nullptr) {
+    XLS_RETURN_IF_ERROR(CompileBatchedFunction(module.get()));
+    XLS_RETURN_IF_ERROR(CompilePackedViewFunction(module.get()));
+  }
+  // Compiled procs embed host addresses (see CallChannelHandler()), so can't
+  // be reused across processes.
+  if (object_cache_ != nullptr && channel_handler_ == nullptr) {
+    XLS_RETURN_IF_ERROR(AddCachedObject(std::move(module)));
+  } else if (llvm::Error error = transform_layer_->add(
+                 dylib_,
+                 llvm::orc::ThreadSafeModule(std::move(module), context_))) {
     return absl::UnknownError(absl::StrFormat(
         "Error compiling converted IR: %s", llvm::toString(std::move(error))));
   }
@@ -1242,6 +1790,13 @@ absl::Status LlvmIrJit::Compile() {
       "%s::%s", xls_function_->package()->name(), xls_function_->name());
   XLS_ASSIGN_OR_RETURN(auto fn_address, load_symbol(function_name));
   invoker_ = reinterpret_cast<JitFunctionType>(fn_address);
+  if (channel_handler_ != nullptr) {
+    return absl::OkStatus();
+  }
+
+  XLS_ASSIGN_OR_RETURN(fn_address,
+                       load_symbol(absl::StrCat(function_name, "_batched")));
+  batched_invoker_ = reinterpret_cast<BatchedJitFunctionType>(fn_address);
 
   absl::StrAppend(&function_name, "_packed");
   XLS_ASSIGN_OR_RETURN(fn_address, load_symbol(function_name));
@@ -1250,7 +1805,9 @@ absl::Status LlvmIrJit::Compile() {
   return absl::OkStatus();
 }
 
-LlvmIrJit::LlvmIrJit(Function* xls_function, int64 opt_level)
+LlvmIrJit::LlvmIrJit(Function* xls_function, int64 opt_level,
+                     JitChannelHandler* channel_handler,
+                     JitObjectCache* object_cache)
     : context_(std::make_unique<llvm::LLVMContext>()),
       object_layer_(
           execution_session_,
@@ -1260,28 +1817,80 @@ LlvmIrJit::LlvmIrJit(Function* xls_function, int64 opt_level)
       xls_function_(xls_function),
       xls_function_type_(xls_function_->GetType()),
       opt_level_(opt_level),
-      invoker_(nullptr) {}
+      channel_handler_(channel_handler),
+      object_cache_(object_cache),
+      invoker_(nullptr),
+      packed_invoker_(nullptr),
+      batched_invoker_(nullptr) {}
+
+absl::Status LlvmIrJit::AddCachedObject(std::unique_ptr<llvm::Module> module) {
+  // The unoptimized module captures both the XLS IR of the function (and its
+  // callees) and how it is lowered to LLVM IR.
+  std::string key = JitObjectCache::ComputeKey(
+      ir_runtime_->DumpToString(*module), opt_level_,
+      absl::StrFormat("%s %s %s", target_machine_->getTargetTriple().str(),
+                      target_machine_->getTargetCPU().str(),
+                      target_machine_->getTargetFeatureString().str()));
+  std::unique_ptr<llvm::MemoryBuffer> object = object_cache_->Lookup(key);
+  if (object == nullptr) {
+    OptimizeModule(module.get());
+    llvm::orc::SimpleCompiler compiler(*target_machine_);
+    auto error_or_object = compiler(*module);
+    if (!error_or_object) {
+      return absl::UnknownError(
+          absl::StrFormat("Error compiling converted IR: %s",
+                          llvm::toString(error_or_object.takeError())));
+    }
+    object = std::move(error_or_object.get());
+    // Failing to populate the cache only costs time later, so isn't an error.
+    absl::Status status = object_cache_->Store(
+        key, absl::string_view(object->getBufferStart(),
+                               object->getBufferSize()));
+    if (!status.ok()) {
+      XLS_LOG(WARNING) << "Unable to cache JIT object: " << status;
+    }
+  }
+
+  if (llvm::Error error = object_layer_.add(dylib_, std::move(object))) {
+    return absl::UnknownError(absl::StrFormat(
+        "Error loading compiled object: %s", llvm::toString(std::move(error))));
+  }
+  return absl::OkStatus();
+}
 
 llvm::Expected<llvm::orc::ThreadSafeModule> LlvmIrJit::Optimizer(
     llvm::orc::ThreadSafeModule module,
     const llvm::orc::MaterializationResponsibility& responsibility) {
-  llvm::Module* bare_module = module.getModuleUnlocked();
+  OptimizeModule(module.getModuleUnlocked());
+  return module;
+}
 
+void LlvmIrJit::OptimizeModule(llvm::Module* bare_module) {
   XLS_VLOG(2) << "Unoptimized module IR:";
   XLS_VLOG(2).NoPrefix() << ir_runtime_->DumpToString(*bare_module);
 
   llvm::TargetLibraryInfoImpl library_info(target_machine_->getTargetTriple());
   llvm::PassManagerBuilder builder;
   builder.OptLevel = opt_level_;
+  // Inlining lets the batched entry point (see CompileBatchedFunction()) be
+  // optimized - and vectorized across samples - as a single loop.
+  builder.Inliner = llvm::createFunctionInliningPass(
+      opt_level_, /*SizeOptLevel=*/0, /*DisableInlineHotCallSite=*/false);
+  builder.LoopVectorize = opt_level_ >= 2;
+  builder.SLPVectorize = opt_level_ >= 2;
   builder.LibraryInfo =
       new llvm::TargetLibraryInfoImpl(target_machine_->getTargetTriple());
 
+  // Target information must be registered before the passes are populated, as
+  // otherwise (e.g.) the vectorizers see a target without vector registers.
   llvm::legacy::PassManager module_pass_manager;
-  builder.populateModulePassManager(module_pass_manager);
   module_pass_manager.add(llvm::createTargetTransformInfoWrapperPass(
       target_machine_->getTargetIRAnalysis()));
+  builder.populateModulePassManager(module_pass_manager);
 
   llvm::legacy::FunctionPassManager function_pass_manager(bare_module);
+  function_pass_manager.add(llvm::createTargetTransformInfoWrapperPass(
+      target_machine_->getTargetIRAnalysis()));
   builder.populateFunctionPassManager(function_pass_manager);
   function_pass_manager.doInitialization();
   for (auto& function : *bare_module) {
@@ -1310,7 +1919,6 @@ llvm::Expected<llvm::orc::ThreadSafeModule> LlvmIrJit::Optimizer(
     XLS_VLOG(3) << "Generated ASM:";
     XLS_VLOG_LINES(3, std::string(stream_buffer.begin(), stream_buffer.end()));
   }
-  return module;
 }
 
 absl::Status LlvmIrJit::Init() {
@@ -1400,7 +2008,7 @@ absl::Status LlvmIrJit::CompileFunction(llvm::Module* module) {
   llvm::IRBuilder<> builder(basic_block);
   BuilderVisitor visitor(module, &builder, xls_function_->params(),
                          xls_function_, type_converter_.get(),
-                         /*generate_packed=*/false);
+                         /*generate_packed=*/false, channel_handler_);
   XLS_RETURN_IF_ERROR(xls_function_->Accept(&visitor));
   llvm::Value* return_value = visitor.return_value();
   if (return_value == nullptr) {
@@ -1408,8 +2016,12 @@ absl::Status LlvmIrJit::CompileFunction(llvm::Module* module) {
         "Function had no (or an unsupported) return value specification!");
   }
 
-  // Store the result to the output pointer.
+  // Store the result to the output pointer. Arrays held in a buffer are
+  // copied from it directly.
   return_type_bytes_ = type_converter_->GetTypeByteSize(*return_type);
+  if (visitor.return_buffer() != nullptr) {
+    return_value = visitor.return_buffer();
+  }
   if (return_value->getType()->isPointerTy()) {
     llvm::Type* pointee_type = return_value->getType()->getPointerElementType();
     if (pointee_type != llvm_return_type) {
@@ -1434,6 +2046,92 @@ absl::Status LlvmIrJit::CompileFunction(llvm::Module* module) {
   return absl::OkStatus();
 }
 
+absl::Status LlvmIrJit::CompileBatchedFunction(llvm::Module* module) {
+  llvm::LLVMContext* bare_context = context_.getContext();
+  llvm::Type* i8_ptr_type = llvm::Type::getInt8PtrTy(*bare_context);
+  llvm::Type* i64_type = llvm::Type::getInt64Ty(*bare_context);
+  int64 param_count = xls_function_type_->parameter_count();
+
+  Package* xls_package = xls_function_->package();
+  std::string function_name =
+      absl::StrFormat("%s::%s", xls_package->name(), xls_function_->name());
+  llvm::Function* single_function = module->getFunction(function_name);
+  XLS_RET_CHECK(single_function != nullptr);
+
+  // Signature: (i8* const* inputs, i8* outputs, i64 count).
+  llvm::ArrayType* arg_array_type =
+      llvm::ArrayType::get(i8_ptr_type, param_count);
+  llvm::FunctionType* function_type = llvm::FunctionType::get(
+      llvm::Type::getVoidTy(*bare_context),
+      {llvm::PointerType::get(arg_array_type, /*AddressSpace=*/0), i8_ptr_type,
+       i64_type},
+      /*isVarArg=*/false);
+  llvm::Function* llvm_function = llvm::cast<llvm::Function>(
+      module
+          ->getOrInsertFunction(absl::StrCat(function_name, "_batched"),
+                                function_type)
+          .getCallee());
+  llvm::Argument* inputs = llvm_function->getArg(0);
+  llvm::Argument* outputs = llvm_function->getArg(1);
+  llvm::Argument* count = llvm_function->getArg(2);
+
+  auto* entry_block = llvm::BasicBlock::Create(*bare_context, "entry",
+                                               llvm_function,
+                                               /*InsertBefore=*/nullptr);
+  auto* loop_block = llvm::BasicBlock::Create(*bare_context, "loop",
+                                              llvm_function,
+                                              /*InsertBefore=*/nullptr);
+  auto* exit_block = llvm::BasicBlock::Create(*bare_context, "exit",
+                                              llvm_function,
+                                              /*InsertBefore=*/nullptr);
+
+  // The single-sample function takes an array of pointers to its arguments;
+  // for each sample, point those at the sample's slot in each argument array.
+  // After inlining, LLVM sees straight-line loads and stores at a fixed stride
+  // per iteration, which it can vectorize.
+  llvm::IRBuilder<> builder(entry_block);
+  llvm::Value* arg_pointers = builder.CreateAlloca(arg_array_type);
+  std::vector<llvm::Value*> arg_bases;
+  for (int64 i = 0; i < param_count; ++i) {
+    llvm::Value* gep = builder.CreateGEP(
+        inputs, {llvm::ConstantInt::get(i64_type, 0),
+                 llvm::ConstantInt::get(i64_type, i)});
+    arg_bases.push_back(builder.CreateLoad(i8_ptr_type, gep));
+  }
+  builder.CreateCondBr(
+      builder.CreateICmpSGT(count, llvm::ConstantInt::get(i64_type, 0)),
+      loop_block, exit_block);
+
+  builder.SetInsertPoint(loop_block);
+  llvm::PHINode* index = builder.CreatePHI(i64_type, 2);
+  index->addIncoming(llvm::ConstantInt::get(i64_type, 0), entry_block);
+  for (int64 i = 0; i < param_count; ++i) {
+    llvm::Value* offset = builder.CreateMul(
+        index, llvm::ConstantInt::get(i64_type, arg_type_bytes_[i]));
+    llvm::Value* arg = builder.CreateGEP(arg_bases[i], offset);
+    builder.CreateStore(
+        arg, builder.CreateGEP(arg_pointers,
+                               {llvm::ConstantInt::get(i64_type, 0),
+                                llvm::ConstantInt::get(i64_type, i)}));
+  }
+  llvm::Value* output = builder.CreateGEP(
+      outputs, builder.CreateMul(
+                   index, llvm::ConstantInt::get(i64_type, return_type_bytes_)));
+  builder.CreateCall(
+      single_function,
+      {arg_pointers,
+       builder.CreateBitCast(output, single_function->getArg(1)->getType())});
+  llvm::Value* next_index =
+      builder.CreateAdd(index, llvm::ConstantInt::get(i64_type, 1));
+  index->addIncoming(next_index, loop_block);
+  builder.CreateCondBr(builder.CreateICmpSLT(next_index, count), loop_block,
+                       exit_block);
+
+  builder.SetInsertPoint(exit_block);
+  builder.CreateRetVoid();
+  return absl::OkStatus();
+}
+
 absl::StatusOr<Value> LlvmIrJit::Run(absl::Span<const Value> args) {
   absl::Span<Param* const> params = xls_function_->params();
   if (args.size() != params.size()) {
@@ -1496,6 +2194,74 @@ absl::Status LlvmIrJit::RunWithViews(absl::Span<const uint8*> args,
   return absl::OkStatus();
 }
 
+absl::Status LlvmIrJit::RunBatched(absl::Span<const uint8* const> arg_buffers,
+                                   absl::Span<uint8> result_buffer,
+                                   int64 count) {
+  if (batched_invoker_ == nullptr) {
+    return absl::UnimplementedError("Batched execution is not available.");
+  }
+  if (arg_buffers.size() != xls_function_->params().size()) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Arg list has the wrong size: %d vs expected %d.",
+                        arg_buffers.size(), xls_function_->params().size()));
+  }
+  if (result_buffer.size() < count * return_type_bytes_) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Result buffer too small - must be at least %d bytes!",
+        count * return_type_bytes_));
+  }
+
+  batched_invoker_(arg_buffers.data(), result_buffer.data(), count);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<Value>> LlvmIrJit::RunBatched(
+    absl::Span<const std::vector<Value>> argsets) {
+  absl::Span<Param* const> params = xls_function_->params();
+  const int64 count = argsets.size();
+  std::vector<std::vector<uint8>> arg_arrays(params.size());
+  for (int64 i = 0; i < params.size(); ++i) {
+    arg_arrays[i].resize(count * arg_type_bytes_[i]);
+  }
+  for (int64 sample = 0; sample < count; ++sample) {
+    const std::vector<Value>& args = argsets[sample];
+    if (args.size() != params.size()) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Arg list %d has the wrong size: %d vs expected %d.", sample,
+          args.size(), params.size()));
+    }
+    for (int64 i = 0; i < params.size(); ++i) {
+      if (!ValueConformsToType(args[i], params[i]->GetType())) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Got argument %s for parameter %d which is not of type %s",
+            args[i].ToString(), i, params[i]->GetType()->ToString()));
+      }
+      ir_runtime_->BlitValueToBuffer(
+          args[i], *params[i]->GetType(),
+          absl::MakeSpan(arg_arrays[i].data() + sample * arg_type_bytes_[i],
+                         arg_type_bytes_[i]));
+    }
+  }
+
+  std::vector<const uint8*> arg_buffers;
+  arg_buffers.reserve(params.size());
+  for (const std::vector<uint8>& arg_array : arg_arrays) {
+    arg_buffers.push_back(arg_array.data());
+  }
+  std::vector<uint8> result_buffer(count * return_type_bytes_);
+  XLS_RETURN_IF_ERROR(
+      RunBatched(arg_buffers, absl::MakeSpan(result_buffer), count));
+
+  std::vector<Value> results;
+  results.reserve(count);
+  for (int64 sample = 0; sample < count; ++sample) {
+    results.push_back(ir_runtime_->UnpackBuffer(
+        result_buffer.data() + sample * return_type_bytes_,
+        xls_function_type_->return_type()));
+  }
+  return results;
+}
+
 absl::StatusOr<Value> CreateAndRun(Function* xls_function,
                                    absl::Span<const Value> args) {
   XLS_ASSIGN_OR_RETURN(auto jit, LlvmIrJit::Create(xls_function));
@@ -1505,19 +2271,33 @@ absl::StatusOr<Value> CreateAndRun(Function* xls_function,
 
 absl::StatusOr<std::pair<std::vector<std::vector<Value>>, std::vector<Value>>>
 CreateAndQuickCheck(Function* xls_function, int64 seed, int64 num_tests) {
+  // Samples are evaluated in batches; results past the first falsifying sample
+  // in a batch are discarded so the output is the same as if they were run one
+  // at a time.
+  constexpr int64 kBatchSize = 256;
   XLS_ASSIGN_OR_RETURN(auto jit, LlvmIrJit::Create(xls_function));
   std::vector<Value> results;
   std::vector<std::vector<Value>> argsets;
   std::minstd_rand rng_engine(seed);
 
-  for (int i = 0; i < num_tests; i++) {
-    argsets.push_back(RandomFunctionArguments(xls_function, &rng_engine));
-    XLS_ASSIGN_OR_RETURN(auto result, jit->Run(argsets[i]));
-    results.push_back(result);
-    if (result.IsAllZeros())
-      // We were able to falsify the xls_function (predicate), bail out early
-      // and present this evidence.
-      break;
+  while (argsets.size() < num_tests) {
+    int64 batch_size = std::min<int64>(kBatchSize, num_tests - argsets.size());
+    std::vector<std::vector<Value>> batch_argsets;
+    for (int64 i = 0; i < batch_size; ++i) {
+      batch_argsets.push_back(
+          RandomFunctionArguments(xls_function, &rng_engine));
+    }
+    XLS_ASSIGN_OR_RETURN(std::vector<Value> batch_results,
+                         jit->RunBatched(batch_argsets));
+    for (int64 i = 0; i < batch_size; ++i) {
+      argsets.push_back(std::move(batch_argsets[i]));
+      results.push_back(std::move(batch_results[i]));
+      if (results.back().IsAllZeros()) {
+        // We were able to falsify the xls_function (predicate), bail out early
+        // and present this evidence.
+        return std::make_pair(argsets, results);
+      }
+    }
   }
 
   return std::make_pair(argsets, results);
@@ -1571,7 +2351,25 @@ absl::Status LlvmIrJit::CompilePackedViewFunction(llvm::Module* module) {
         "Function had no (or an unsupported) return value specification!");
   }
 
-  if (return_width != 0) {
+  // Wide values are packed through memory, from the array buffer holding the
+  // return value if there is one.
+  llvm::Value* return_buffer = visitor.return_buffer();
+  if (return_width > kMaxPackedRegisterBits) {
+    if (return_buffer == nullptr) {
+      llvm::IRBuilder<> entry_builder(basic_block, basic_block->begin());
+      return_buffer = entry_builder.CreateAlloca(return_value->getType());
+      builder.CreateStore(return_value, return_buffer);
+    }
+    XLS_RETURN_IF_ERROR(PackFromBuffer(
+        builder, xls_function_type_->return_type(), return_buffer,
+        builder.CreateBitCast(
+            llvm_function->getArg(llvm_function->arg_size() - 1),
+            llvm::Type::getInt8PtrTy(*bare_context)),
+        /*bit_offset=*/0));
+  } else if (return_width != 0) {
+    if (return_buffer != nullptr) {
+      return_value = builder.CreateLoad(return_buffer);
+    }
     // Declare the return argument as an iX, and pack the actual data as such an
     // integer.
     llvm::Value* packed_return = llvm::ConstantInt::get(
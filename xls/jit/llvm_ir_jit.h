@@ -30,21 +30,57 @@
 #include "xls/common/status/status_macros.h"
 #include "xls/ir/function.h"
 #include "xls/ir/package.h"
+#include "xls/ir/proc.h"
 #include "xls/ir/value.h"
 #include "xls/ir/value_view.h"
+#include "xls/jit/jit_object_cache.h"
 #include "xls/jit/llvm_ir_runtime.h"
 #include "xls/jit/llvm_type_converter.h"
 
 namespace xls {
 
+// Interface through which JIT-compiled procs perform channel operations. Each
+// send and receive node in a proc is lowered to a call to one of the methods
+// below, identified by the node itself. Calls are made in a topological order
+// of the proc's nodes.
+class JitChannelHandler {
+ public:
+  virtual ~JitChannelHandler() = default;
+
+  // Called for each receive or receive_if node. "operands_ready" is false if
+  // some receive upstream of this node (in the same proc iteration) did not
+  // produce data, in which case this receive cannot execute either.
+  // "predicate" is the receive_if predicate (always true for receive). Returns
+  // true if the receive completed, in which case the node's result -
+  // (token, data...) - must have been written to "buffer" in the LLVM layout of
+  // the node's type.
+  virtual bool Receive(Node* node, bool operands_ready, bool predicate,
+                       uint8* buffer) = 0;
+
+  // Called for each send or send_if node. "data" holds a tuple of the node's
+  // data operands in LLVM layout. Arguments are as for Receive().
+  virtual void Send(Node* node, bool operands_ready, bool predicate,
+                    const uint8* data) = 0;
+};
+
 // This class provides a facility to execute XLS functions (on the host) by
 // converting it to LLVM IR, compiling it, and finally executing it.
 class LlvmIrJit {
  public:
   // Returns an object containing a host-compiled version of the specified XLS
-  // function.
+  // function. If "object_cache" is non-null, the compiled code is loaded from
+  // it when present, and stored to it otherwise; it must outlive this call.
   static absl::StatusOr<std::unique_ptr<LlvmIrJit>> Create(
-      Function* xls_function, int64 opt_level = 3);
+      Function* xls_function, int64 opt_level = 3,
+      JitObjectCache* object_cache = nullptr);
+
+  // Returns an object containing a host-compiled version of the specified
+  // proc. The proc's state and token are the compiled function's two arguments
+  // and its (next state, token) tuple is the return value; all channel
+  // operations are delegated to "channel_handler", which must outlive the
+  // returned object.
+  static absl::StatusOr<std::unique_ptr<LlvmIrJit>> CreateProc(
+      Proc* proc, JitChannelHandler* channel_handler, int64 opt_level = 3);
 
   // Executes the compiled function with the specified arguments.
   absl::StatusOr<Value> Run(absl::Span<const Value> args);
@@ -65,6 +101,22 @@ class LlvmIrJit {
   absl::Status RunWithViews(absl::Span<const uint8*> args,
                             absl::Span<uint8> result_buffer);
 
+  // Executes the compiled function on "count" independent sets of arguments in
+  // a single call. Arguments are laid out structure-of-arrays: arg_buffers[i]
+  // points to "count" consecutive values of parameter i, each occupying
+  // GetArgTypeSize(i) bytes. Results are likewise written as "count"
+  // consecutive values of GetReturnTypeSize() bytes each.
+  //
+  // The batch loop is part of the compiled code, so the per-sample call and
+  // marshaling overhead of RunWithViews() is avoided and LLVM is free to
+  // vectorize the computation across samples.
+  absl::Status RunBatched(absl::Span<const uint8* const> arg_buffers,
+                          absl::Span<uint8> result_buffer, int64 count);
+
+  // As above, but with the argument sets and results as Values.
+  absl::StatusOr<std::vector<Value>> RunBatched(
+      absl::Span<const std::vector<Value>> argsets);
+
   // Similar to RunWithViews(), except the arguments here are _packed_views_ -
   // views whose data elements are tightly packed, with no padding bits or bytes
   // between them. The function return value is specified as the last arg - its
@@ -102,8 +154,13 @@ class LlvmIrJit {
   int64 GetArgTypeSize(int arg_index) { return arg_type_bytes_[arg_index]; }
   int64 GetReturnTypeSize() { return return_type_bytes_; }
 
+  LlvmIrRuntime* runtime() { return ir_runtime_.get(); }
+  LlvmTypeConverter* type_converter() { return type_converter_.get(); }
+
  private:
-  explicit LlvmIrJit(Function* xls_function, int64 opt_level);
+  explicit LlvmIrJit(Function* xls_function, int64 opt_level,
+                     JitChannelHandler* channel_handler = nullptr,
+                     JitObjectCache* object_cache = nullptr);
 
   // Performs non-trivial initialization (i.e., that which can fail).
   absl::Status Init();
@@ -114,6 +171,11 @@ class LlvmIrJit {
   // Compiles the input function to host code, accepting byte-aligned inputs.
   absl::Status CompileFunction(llvm::Module* module);
 
+  // Compiles a wrapper around the function emitted by CompileFunction() which
+  // loops over a batch of structure-of-arrays laid out samples (see
+  // RunBatched()).
+  absl::Status CompileBatchedFunction(llvm::Module* module);
+
   // Compiles the input function as above, but with the addition of accepting
   // packed view input - each input and the output args have their fields
   // closely packed, without any padding bits or bytes between them.
@@ -134,6 +196,13 @@ class LlvmIrJit {
                                            llvm::Value* buffer,
                                            int64 bit_offset);
 
+  // Loads the object code for "module" from object_cache_, or optimizes and
+  // compiles it then stores it there, and adds the result to the JIT.
+  absl::Status AddCachedObject(std::unique_ptr<llvm::Module> module);
+
+  // Runs the LLVM optimization pipeline over the module.
+  void OptimizeModule(llvm::Module* module);
+
   llvm::Expected<llvm::orc::ThreadSafeModule> Optimizer(
       llvm::orc::ThreadSafeModule module,
       const llvm::orc::MaterializationResponsibility& responsibility);
@@ -167,6 +236,13 @@ class LlvmIrJit {
   FunctionType* xls_function_type_;
   int64 opt_level_;
 
+  // Non-null only when compiling a proc.
+  JitChannelHandler* channel_handler_;
+
+  // If non-null, the persistent store of compiled objects. Only used during
+  // creation.
+  JitObjectCache* object_cache_;
+
   // Size of the function's args or return type as flat bytes.
   std::vector<int64> arg_type_bytes_;
   int64 return_type_bytes_;
@@ -185,6 +261,11 @@ class LlvmIrJit {
   using PackedJitFunctionType = void (*)(const uint8* const* inputs,
                                          uint8* output);
   PackedJitFunctionType packed_invoker_;
+
+  // The batched entry point; see RunBatched().
+  using BatchedJitFunctionType = void (*)(const uint8* const* inputs,
+                                          uint8* outputs, int64 count);
+  BatchedJitFunctionType batched_invoker_;
 };
 
 // JIT-compiles the given xls_function and invokes it with args, returning the
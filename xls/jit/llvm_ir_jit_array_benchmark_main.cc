@@ -0,0 +1,231 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/integral_types.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/package.h"
+#include "xls/ir/value_helpers.h"
+#include "xls/jit/llvm_ir_jit.h"
+
+const char* kUsage = R"(
+Times JIT compilation and execution of array-heavy functions over a range of
+array sizes:
+
+  update_chain: a chain of array updates, each of the previous update.
+  swap:         array indices and updates of the same array, which prevents
+                updating it in place.
+  lookup:       array indices into a literal lookup table.
+
+Usage:
+
+   llvm_ir_jit_array_benchmark_main
+   llvm_ir_jit_array_benchmark_main --sizes=1024,65536 --opt_level=1
+)";
+
+ABSL_FLAG(std::vector<std::string>, sizes,
+          std::vector<std::string>({"16", "256", "1024", "4096"}),
+          "Comma-separated list of array sizes to benchmark.");
+ABSL_FLAG(int64, updates, 16,
+          "Number of array updates (or indices) in each function.");
+ABSL_FLAG(int64, opt_level, 3, "LLVM optimization level to compile at.");
+ABSL_FLAG(absl::Duration, min_run_time, absl::Milliseconds(200),
+          "Minimum time to run each compiled function for.");
+
+namespace xls {
+namespace {
+
+// Returns the offset from the index argument of the i-th access. The index
+// argument is size / 3 so the accesses are in bounds.
+int64 Offset(int64 i, int64 size) {
+  return i * 7919 % std::max(int64{1}, size / 2);
+}
+
+std::string UpdateChainIr(int64 size, int64 updates) {
+  std::string body;
+  std::string array = "a";
+  for (int64 i = 0; i < updates; ++i) {
+    absl::StrAppendFormat(&body,
+                          "  offset%d: bits[32] = literal(value=%d)\n"
+                          "  index%d: bits[32] = add(i, offset%d)\n"
+                          "  value%d: bits[32] = add(x, offset%d)\n"
+                          "  update%d: bits[32][%d] = array_update(%s, "
+                          "index%d, value%d)\n",
+                          i, Offset(i, size), i, i, i, i, i, size, array, i,
+                          i);
+    array = absl::StrCat("update", i);
+  }
+  return absl::StrFormat(
+      "package update_chain\n\n"
+      "fn main(a: bits[32][%d], i: bits[32], x: bits[32]) -> bits[32][%d] {\n"
+      "%s  ret result: bits[32][%d] = identity(%s)\n}\n",
+      size, size, body, size, array);
+}
+
+std::string SwapIr(int64 size, int64 updates) {
+  std::string body;
+  std::string array = "a";
+  for (int64 i = 0; i < updates; ++i) {
+    absl::StrAppendFormat(
+        &body,
+        "  offset%d: bits[32] = literal(value=%d)\n"
+        "  index%d: bits[32] = add(i, offset%d)\n"
+        "  lhs%d: bits[32] = array_index(%s, index%d)\n"
+        "  rhs%d: bits[32] = array_index(%s, x)\n"
+        "  swap_lhs%d: bits[32][%d] = array_update(%s, index%d, rhs%d)\n"
+        "  swap%d: bits[32][%d] = array_update(swap_lhs%d, x, lhs%d)\n",
+        i, Offset(i, size), i, i, i, array, i, i, array, i, size, array, i, i,
+        i, size, i, i);
+    array = absl::StrCat("swap", i);
+  }
+  return absl::StrFormat(
+      "package swap\n\n"
+      "fn main(a: bits[32][%d], i: bits[32], x: bits[32]) -> bits[32][%d] {\n"
+      "%s  ret result: bits[32][%d] = identity(%s)\n}\n",
+      size, size, body, size, array);
+}
+
+std::string LookupIr(int64 size, int64 lookups) {
+  std::vector<std::string> table;
+  for (int64 i = 0; i < size; ++i) {
+    table.push_back(absl::StrCat((i * 2654435761) & 0xffffffff));
+  }
+  std::string body = absl::StrFormat(
+      "  table: bits[32][%d] = literal(value=[%s])\n"
+      "  sum_init: bits[32] = literal(value=0)\n",
+      size, absl::StrJoin(table, ", "));
+  std::string sum = "sum_init";
+  for (int64 i = 0; i < lookups; ++i) {
+    absl::StrAppendFormat(&body,
+                          "  offset%d: bits[32] = literal(value=%d)\n"
+                          "  index%d: bits[32] = add(i, offset%d)\n"
+                          "  entry%d: bits[32] = array_index(table, index%d)\n"
+                          "  sum%d: bits[32] = add(%s, entry%d)\n",
+                          i, Offset(i, size), i, i, i, i, i, sum, i);
+    sum = absl::StrCat("sum", i);
+  }
+  return absl::StrFormat(
+      "package lookup\n\n"
+      "fn main(a: bits[32][%d], i: bits[32], x: bits[32]) -> bits[32] {\n"
+      "%s  ret result: bits[32] = identity(%s)\n}\n",
+      size, body, sum);
+}
+
+absl::Status BenchmarkFunction(absl::string_view name, int64 size,
+                               const std::string& ir_text) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                       Parser::ParsePackage(ir_text));
+  XLS_ASSIGN_OR_RETURN(Function * function, package->GetFunction("main"));
+
+  absl::Time start = absl::Now();
+  XLS_ASSIGN_OR_RETURN(
+      std::unique_ptr<LlvmIrJit> jit,
+      LlvmIrJit::Create(function, absl::GetFlag(FLAGS_opt_level)));
+  absl::Duration compile_time = absl::Now() - start;
+
+  // Keep the indices in bounds, but not known to the compiler.
+  std::minstd_rand engine;
+  std::vector<Value> args = RandomFunctionArguments(function, &engine);
+  args[1] = Value(UBits(size / 3, 32));
+  args[2] = Value(UBits(size / 2, 32));
+  XLS_ASSIGN_OR_RETURN(Value expected, IrInterpreter::Run(function, args));
+  XLS_ASSIGN_OR_RETURN(Value result, jit->Run(args));
+  if (result != expected) {
+    return absl::InternalError(absl::StrFormat(
+        "%s: JIT result differs from interpreter result", name));
+  }
+
+  // Time calls on buffers in the native layout so that conversion to and from
+  // Values is not included.
+  std::vector<std::vector<uint8>> arg_storage;
+  std::vector<const uint8*> arg_buffers;
+  for (int64 i = 0; i < args.size(); ++i) {
+    arg_storage.push_back(std::vector<uint8>(jit->GetArgTypeSize(i)));
+    jit->runtime()->BlitValueToBuffer(args[i], *function->param(i)->GetType(),
+                                      absl::MakeSpan(arg_storage.back()));
+    arg_buffers.push_back(arg_storage.back().data());
+  }
+  std::vector<uint8> result_buffer(jit->GetReturnTypeSize());
+  const absl::Duration min_run_time = absl::GetFlag(FLAGS_min_run_time);
+  int64 calls = 0;
+  absl::Duration run_time;
+  start = absl::Now();
+  do {
+    XLS_RETURN_IF_ERROR(jit->RunWithViews(absl::MakeSpan(arg_buffers),
+                                          absl::MakeSpan(result_buffer)));
+    ++calls;
+    run_time = absl::Now() - start;
+  } while (run_time < min_run_time);
+
+  std::cout << absl::StreamFormat("%-14s %8d %12.1f %14.1f\n", name, size,
+                                  absl::ToDoubleMilliseconds(compile_time),
+                                  absl::ToDoubleNanoseconds(run_time) / calls);
+  return absl::OkStatus();
+}
+
+absl::Status RealMain() {
+  std::vector<int64> sizes;
+  for (const std::string& size_str : absl::GetFlag(FLAGS_sizes)) {
+    int64 size;
+    XLS_QCHECK(absl::SimpleAtoi(size_str, &size) && size > 0)
+        << "Invalid size: " << size_str;
+    sizes.push_back(size);
+  }
+  const int64 updates = absl::GetFlag(FLAGS_updates);
+
+  std::cout << absl::StreamFormat("%-14s %8s %12s %14s\n", "function", "size",
+                                  "compile (ms)", "run (ns/call)");
+  for (int64 size : sizes) {
+    XLS_RETURN_IF_ERROR(
+        BenchmarkFunction("update_chain", size, UpdateChainIr(size, updates)));
+  }
+  for (int64 size : sizes) {
+    XLS_RETURN_IF_ERROR(
+        BenchmarkFunction("swap", size, SwapIr(size, updates)));
+  }
+  for (int64 size : sizes) {
+    XLS_RETURN_IF_ERROR(
+        BenchmarkFunction("lookup", size, LookupIr(size, updates)));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace xls
+
+int main(int argc, char** argv) {
+  std::vector<absl::string_view> positional_arguments =
+      xls::InitXls(kUsage, argc, argv);
+  XLS_QCHECK(positional_arguments.empty())
+      << "Unexpected positional arguments: "
+      << absl::StrJoin(positional_arguments, ", ");
+  XLS_QCHECK_OK(xls::RealMain());
+  return EXIT_SUCCESS;
+}
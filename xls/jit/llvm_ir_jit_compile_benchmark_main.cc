@@ -0,0 +1,139 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/integral_types.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/package.h"
+#include "xls/jit/llvm_ir_jit.h"
+
+const char* kUsage = R"(
+Times JIT compilation of a function consisting of a counted_for loop (a bitwise
+CRC-32 step) over a range of trip counts, and the time per call of the compiled
+function. Usage:
+
+   llvm_ir_jit_compile_benchmark_main
+   llvm_ir_jit_compile_benchmark_main --trip_counts=8,4096 --opt_level=1
+)";
+
+ABSL_FLAG(std::vector<std::string>, trip_counts,
+          std::vector<std::string>({"1", "8", "64", "512", "4096"}),
+          "Comma-separated list of loop trip counts to benchmark.");
+ABSL_FLAG(int64, opt_level, 3, "LLVM optimization level to compile at.");
+ABSL_FLAG(absl::Duration, min_run_time, absl::Milliseconds(200),
+          "Minimum time to run the compiled function for.");
+
+namespace xls {
+namespace {
+
+// Returns the IR of a package whose entry function computes "trip_count"
+// steps of a bitwise CRC-32 in a counted_for loop.
+std::string CrcLoopIr(int64 trip_count) {
+  return absl::StrFormat(R"(
+package crc_loop
+
+fn body(i: bits[32], crc: bits[32], poly: bits[32]) -> bits[32] {
+  one: bits[32] = literal(value=1)
+  lsb: bits[32] = and(crc, one)
+  shifted: bits[32] = shrl(crc, one)
+  mask: bits[32] = neg(lsb)
+  masked_poly: bits[32] = and(mask, poly)
+  next: bits[32] = xor(shifted, masked_poly)
+  ret result: bits[32] = xor(next, i)
+}
+
+fn main(x: bits[32], poly: bits[32]) -> bits[32] {
+  ret crc: bits[32] = counted_for(x, trip_count=%d, stride=1, body=body, invariant_args=[poly])
+}
+)",
+                         trip_count);
+}
+
+absl::Status BenchmarkTripCount(int64 trip_count) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                       Parser::ParsePackage(CrcLoopIr(trip_count)));
+  XLS_ASSIGN_OR_RETURN(Function * function, package->GetFunction("main"));
+
+  absl::Time start = absl::Now();
+  XLS_ASSIGN_OR_RETURN(
+      std::unique_ptr<LlvmIrJit> jit,
+      LlvmIrJit::Create(function, absl::GetFlag(FLAGS_opt_level)));
+  absl::Duration compile_time = absl::Now() - start;
+
+  std::vector<Value> args = {Value(UBits(0xffffffff, 32)),
+                             Value(UBits(0xedb88320, 32))};
+  XLS_ASSIGN_OR_RETURN(Value expected, IrInterpreter::Run(function, args));
+  XLS_ASSIGN_OR_RETURN(Value result, jit->Run(args));
+  if (result != expected) {
+    return absl::InternalError(absl::StrFormat(
+        "JIT result differs from interpreter result: %s vs %s",
+        result.ToString(), expected.ToString()));
+  }
+
+  const absl::Duration min_run_time = absl::GetFlag(FLAGS_min_run_time);
+  int64 calls = 0;
+  absl::Duration run_time;
+  start = absl::Now();
+  do {
+    XLS_RETURN_IF_ERROR(jit->Run(args).status());
+    ++calls;
+    run_time = absl::Now() - start;
+  } while (run_time < min_run_time);
+
+  std::cout << absl::StreamFormat("%10d %12.1f %14.1f\n", trip_count,
+                                  absl::ToDoubleMilliseconds(compile_time),
+                                  absl::ToDoubleNanoseconds(run_time) / calls);
+  return absl::OkStatus();
+}
+
+absl::Status RealMain() {
+  std::cout << absl::StreamFormat("%10s %12s %14s\n", "trip_count",
+                                  "compile (ms)", "run (ns/call)");
+  for (const std::string& trip_count_str :
+       absl::GetFlag(FLAGS_trip_counts)) {
+    int64 trip_count;
+    XLS_QCHECK(absl::SimpleAtoi(trip_count_str, &trip_count) &&
+               trip_count >= 0)
+        << "Invalid trip count: " << trip_count_str;
+    XLS_RETURN_IF_ERROR(BenchmarkTripCount(trip_count));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace xls
+
+int main(int argc, char** argv) {
+  std::vector<absl::string_view> positional_arguments =
+      xls::InitXls(kUsage, argc, argv);
+  XLS_QCHECK(positional_arguments.empty())
+      << "Unexpected positional arguments: "
+      << absl::StrJoin(positional_arguments, ", ");
+  XLS_QCHECK_OK(xls::RealMain());
+  return EXIT_SUCCESS;
+}
@@ -182,6 +182,81 @@ TEST(LlvmIrJitTest, Seeding) {
   EXPECT_EQ(results1, results2);
 }
 
+// Verifies that batched execution matches evaluating each sample separately,
+// for both bits and aggregate types.
+TEST(LlvmIrJitTest, RunBatched) {
+  Package package("my_package");
+  std::string ir_text = R"(
+  fn f(x: bits[17], y: (bits[3], bits[64])) -> (bits[17], bits[64]) {
+    y0: bits[3] = tuple_index(y, index=0)
+    y1: bits[64] = tuple_index(y, index=1)
+    y0_ext: bits[17] = zero_ext(y0, new_bit_count=17)
+    sum: bits[17] = add(x, y0_ext)
+    prod: bits[64] = umul(y1, y1)
+    ret result: (bits[17], bits[64]) = tuple(sum, prod)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, LlvmIrJit::Create(function));
+
+  std::minstd_rand bitgen;
+  for (int64 count : {0, 1, 7, 100}) {
+    std::vector<std::vector<Value>> argsets;
+    for (int64 i = 0; i < count; ++i) {
+      argsets.push_back(RandomFunctionArguments(function, &bitgen));
+    }
+    XLS_ASSERT_OK_AND_ASSIGN(std::vector<Value> results,
+                             jit->RunBatched(argsets));
+    ASSERT_EQ(results.size(), count);
+    for (int64 i = 0; i < count; ++i) {
+      EXPECT_THAT(jit->Run(argsets[i]), IsOkAndHolds(results[i]))
+          << "sample " << i;
+    }
+  }
+}
+
+TEST(LlvmIrJitTest, RunBatchedWithBuffers) {
+  Package package("my_package");
+  std::string ir_text = R"(
+  fn f(x: bits[32], y: bits[32]) -> bits[32] {
+    ret add.1: bits[32] = add(x, y)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, LlvmIrJit::Create(function));
+  ASSERT_EQ(jit->GetArgTypeSize(0), sizeof(uint32));
+  ASSERT_EQ(jit->GetReturnTypeSize(), sizeof(uint32));
+
+  constexpr int64 kCount = 1000;
+  std::vector<uint32> x(kCount);
+  std::vector<uint32> y(kCount);
+  std::vector<uint32> result(kCount);
+  for (int64 i = 0; i < kCount; ++i) {
+    x[i] = i * 0x10001;
+    y[i] = 0xffffffff - i;
+  }
+  std::vector<const uint8*> args = {reinterpret_cast<const uint8*>(x.data()),
+                                    reinterpret_cast<const uint8*>(y.data())};
+  XLS_ASSERT_OK(jit->RunBatched(
+      args,
+      absl::MakeSpan(reinterpret_cast<uint8*>(result.data()),
+                     kCount * sizeof(uint32)),
+      kCount));
+  for (int64 i = 0; i < kCount; ++i) {
+    EXPECT_EQ(result[i], x[i] + y[i]) << "sample " << i;
+  }
+
+  // The result buffer must hold every sample.
+  EXPECT_THAT(jit->RunBatched(args,
+                              absl::MakeSpan(reinterpret_cast<uint8*>(
+                                                 result.data()),
+                                             sizeof(uint32)),
+                              kCount),
+              status_testing::StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 // Very basic smoke test for packed types.
 TEST(LlvmIrJitTest, PackedSmoke) {
   Package package("my_package");
@@ -371,6 +446,9 @@ TEST(LlvmIrJitTest, PackedArrays) {
   XLS_ASSERT_OK((TestSimpleArray<4, 4>(bitgen)));
   XLS_ASSERT_OK((TestSimpleArray<4, 15>(bitgen)));
   XLS_ASSERT_OK((TestSimpleArray<113, 33>(bitgen)));
+  // Byte-aligned elements, which are unpacked and packed in a loop.
+  XLS_ASSERT_OK((TestSimpleArray<8, 100>(bitgen)));
+  XLS_ASSERT_OK((TestSimpleArray<32, 1024>(bitgen)));
 }
 
 // Creates a simple function to perform a tuple update.
@@ -533,5 +611,147 @@ TEST(LlvmIrJitTest, ArrayConcatArrayOfArrays) {
   EXPECT_THAT(jit->Run(args), IsOkAndHolds(ret));
 }
 
+// Loops are lowered to LLVM loops rather than one call per iteration, so large
+// trip counts compile quickly.
+TEST(LlvmIrJitTest, CountedForLargeTripCount) {
+  std::string ir_text = R"(
+  package large_trip_count
+
+  fn body(i: bits[32], accum: bits[32], k: bits[32]) -> bits[32] {
+    umul.4: bits[32] = umul(i, k)
+    ret add.5: bits[32] = add(accum, umul.4)
+  }
+
+  fn main(x: bits[32], k: bits[32]) -> bits[32] {
+    ret counted_for.3: bits[32] = counted_for(x, trip_count=4096, stride=3, body=body, invariant_args=[k])
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(ir_text));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function, package->GetFunction("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, LlvmIrJit::Create(function));
+  // x + k * 3 * (0 + 1 + ... + 4095)
+  std::vector<Value> args = {Value(UBits(7, 32)), Value(UBits(5, 32))};
+  EXPECT_THAT(jit->Run(args),
+              IsOkAndHolds(Value(UBits(7 + 5 * 3 * (4095 * 4096 / 2), 32))));
+}
+
+TEST(LlvmIrJitTest, CountedForZeroTripCount) {
+  std::string ir_text = R"(
+  package zero_trip_count
+
+  fn body(i: bits[4], accum: bits[8]) -> bits[8] {
+    ret not.3: bits[8] = not(accum)
+  }
+
+  fn main(x: bits[8]) -> bits[8] {
+    ret counted_for.2: bits[8] = counted_for(x, trip_count=0, stride=1, body=body)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(ir_text));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function, package->GetFunction("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, LlvmIrJit::Create(function));
+  std::vector<Value> args = {Value(UBits(42, 8))};
+  EXPECT_THAT(jit->Run(args), IsOkAndHolds(Value(UBits(42, 8))));
+}
+
+TEST(LlvmIrJitTest, MapLargeArray) {
+  std::string ir_text = R"(
+  package large_map
+
+  fn square(x: bits[16]) -> bits[16] {
+    ret umul.2: bits[16] = umul(x, x)
+  }
+
+  fn main(a: bits[16][1000]) -> bits[16][1000] {
+    ret map.3: bits[16][1000] = map(a, to_apply=square)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(ir_text));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function, package->GetFunction("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, LlvmIrJit::Create(function));
+  std::vector<uint64> input;
+  std::vector<uint64> expected;
+  for (uint64 i = 0; i < 1000; ++i) {
+    input.push_back(i);
+    expected.push_back((i * i) & 0xffff);
+  }
+  XLS_ASSERT_OK_AND_ASSIGN(Value input_value, Value::UBitsArray(input, 16));
+  XLS_ASSERT_OK_AND_ASSIGN(Value expected_value,
+                           Value::UBitsArray(expected, 16));
+  std::vector<Value> args = {input_value};
+  EXPECT_THAT(jit->Run(args), IsOkAndHolds(expected_value));
+}
+
+// Chains of array updates are performed in place where the original array has
+// no other users, so check that values which are still live are not clobbered.
+TEST(LlvmIrJitTest, ArrayUpdateChains) {
+  Package package("my_package");
+  std::string ir_text = R"(
+  fn f(a: bits[8][4], i: bits[2], x: bits[8]) -> (bits[8][4], bits[8], bits[8][4], bits[8][4]) {
+    zero: bits[2] = literal(value=0)
+    one: bits[2] = literal(value=1)
+    three: bits[8] = literal(value=3)
+    u1: bits[8][4] = array_update(a, zero, x)
+    u2: bits[8][4] = array_update(u1, one, x)
+    u3: bits[8][4] = array_update(u2, i, x)
+    before: bits[8] = array_index(u3, zero)
+    u4: bits[8][4] = array_update(u3, zero, three)
+    u5: bits[8][4] = array_update(u4, one, three)
+    ret result: (bits[8][4], bits[8], bits[8][4], bits[8][4]) = tuple(a, before, u3, u5)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, LlvmIrJit::Create(function));
+
+  XLS_ASSERT_OK_AND_ASSIGN(Value a, Value::UBitsArray({1, 2, 3, 4}, 8));
+  XLS_ASSERT_OK_AND_ASSIGN(Value u3, Value::UBitsArray({9, 9, 3, 9}, 8));
+  XLS_ASSERT_OK_AND_ASSIGN(Value u5, Value::UBitsArray({3, 3, 3, 9}, 8));
+  std::vector<Value> args = {a, Value(UBits(3, 2)), Value(UBits(9, 8))};
+  EXPECT_THAT(jit->Run(args),
+              IsOkAndHolds(Value::Tuple({a, Value(UBits(9, 8)), u3, u5})));
+}
+
+TEST(LlvmIrJitTest, ArrayUpdateOfParamReturned) {
+  Package package("my_package");
+  std::string ir_text = R"(
+  fn f(a: bits[32][3], i: bits[32]) -> bits[32][3] {
+    u1: bits[32][3] = array_update(a, i, i)
+    ret u2: bits[32][3] = array_update(u1, i, i)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, LlvmIrJit::Create(function));
+
+  XLS_ASSERT_OK_AND_ASSIGN(Value a, Value::UBitsArray({1, 2, 3}, 32));
+  XLS_ASSERT_OK_AND_ASSIGN(Value expected, Value::UBitsArray({1, 2, 2}, 32));
+  std::vector<Value> args = {a, Value(UBits(2, 32))};
+  EXPECT_THAT(jit->Run(args), IsOkAndHolds(expected));
+  // Out of bounds updates leave the array unchanged.
+  args = {a, Value(UBits(3, 32))};
+  EXPECT_THAT(jit->Run(args), IsOkAndHolds(a));
+}
+
+TEST(LlvmIrJitTest, LookupTable) {
+  Package package("my_package");
+  std::string ir_text = R"(
+  fn f(i: bits[3], j: bits[3]) -> bits[16] {
+    table: bits[16][8] = literal(value=[1, 1, 2, 3, 5, 8, 13, 21])
+    x: bits[16] = array_index(table, i)
+    y: bits[16] = array_index(table, j)
+    ret sum: bits[16] = add(x, y)
+  }
+  )";
+  XLS_ASSERT_OK_AND_ASSIGN(Function * function,
+                           Parser::ParseFunction(ir_text, &package));
+  XLS_ASSERT_OK_AND_ASSIGN(auto jit, LlvmIrJit::Create(function));
+  std::vector<Value> args = {Value(UBits(7, 3)), Value(UBits(4, 3))};
+  EXPECT_THAT(jit->Run(args), IsOkAndHolds(Value(UBits(26, 16))));
+}
+
 }  // namespace
 }  // namespace xls
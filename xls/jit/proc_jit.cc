@@ -0,0 +1,209 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/proc_jit.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/nodes.h"
+#include "xls/ir/value_helpers.h"
+
+namespace xls {
+
+/* static */
+absl::StatusOr<std::unique_ptr<ProcJit>> ProcJit::Create(
+    Proc* proc, ChannelQueueManager* queue_manager, int64 opt_level) {
+  auto proc_jit = absl::WrapUnique(new ProcJit(proc));
+  XLS_ASSIGN_OR_RETURN(proc_jit->jit_,
+                       LlvmIrJit::CreateProc(proc, proc_jit.get(), opt_level));
+  LlvmTypeConverter* type_converter = proc_jit->jit_->type_converter();
+
+  // Note that the node classes must be namespace-qualified here as they are
+  // hidden by the JitChannelHandler methods of the same names.
+  for (Node* node : proc->nodes()) {
+    ChannelOp op;
+    int64 channel_id;
+    if (node->Is<xls::Receive>()) {
+      channel_id = node->As<xls::Receive>()->channel_id();
+      op.type = node->GetType();
+    } else if (node->Is<xls::ReceiveIf>()) {
+      channel_id = node->As<xls::ReceiveIf>()->channel_id();
+      op.type = node->GetType();
+    } else if (node->Is<xls::Send>() || node->Is<xls::SendIf>()) {
+      absl::Span<Node* const> data_operands;
+      if (node->Is<xls::Send>()) {
+        channel_id = node->As<xls::Send>()->channel_id();
+        data_operands = node->As<xls::Send>()->data_operands();
+      } else {
+        channel_id = node->As<xls::SendIf>()->channel_id();
+        data_operands = node->As<xls::SendIf>()->data_operands();
+      }
+      std::vector<Type*> data_types;
+      for (Node* operand : data_operands) {
+        data_types.push_back(operand->GetType());
+      }
+      op.type = proc->package()->GetTupleType(data_types);
+    } else {
+      continue;
+    }
+    XLS_ASSIGN_OR_RETURN(op.queue, queue_manager->GetQueueById(channel_id));
+    op.done = false;
+    if (node->Is<xls::Receive>() || node->Is<xls::ReceiveIf>()) {
+      op.result.resize(type_converter->GetTypeByteSize(*op.type));
+    }
+    proc_jit->channel_ops_[node] = std::move(op);
+  }
+
+  // Keep the buffers non-empty (even for empty-tuple state) so the compiled
+  // code is never handed a null pointer.
+  proc_jit->state_buffer_.resize(
+      std::max<int64>(proc_jit->jit_->GetArgTypeSize(0), 1));
+  proc_jit->result_buffer_.resize(
+      std::max<int64>(proc_jit->jit_->GetReturnTypeSize(), 1));
+  proc_jit->jit_->runtime()->BlitValueToBuffer(
+      proc->InitValue(), *proc->StateType(),
+      absl::MakeSpan(proc_jit->state_buffer_));
+  return std::move(proc_jit);
+}
+
+Value ProcJit::GetState() const {
+  return jit_->runtime()->UnpackBuffer(state_buffer_.data(),
+                                       proc_->StateType());
+}
+
+absl::StatusOr<ProcInterpreter::RunResult>
+ProcJit::RunIterationUntilCompleteOrBlocked() {
+  XLS_VLOG(3) << absl::StreamFormat(
+      "%s iteration %d of proc %s",
+      (IsIterationComplete() ? "Running" : "Resuming"), current_iteration_,
+      proc_->name());
+
+  // Starting a new iteration always makes progress (at the very least, the
+  // proc's parameters are "executed"), matching the interpreter.
+  progress_made_ = iteration_complete_;
+  if (iteration_complete_) {
+    for (auto& pair : channel_ops_) {
+      pair.second.done = false;
+    }
+  }
+  blocked_ = false;
+  blocked_channels_.clear();
+  status_ = absl::OkStatus();
+
+  // Tokens carry no data, so any address will do for the token argument.
+  uint8 token;
+  const uint8* args[] = {state_buffer_.data(), &token};
+  XLS_RETURN_IF_ERROR(
+      jit_->RunWithViews(absl::MakeSpan(args), absl::MakeSpan(result_buffer_)));
+  XLS_RETURN_IF_ERROR(status_);
+
+  iteration_complete_ = !blocked_;
+  if (iteration_complete_) {
+    // The next state is element 0 of the returned (state, token) tuple, which
+    // always sits at offset zero.
+    std::copy(result_buffer_.begin(),
+              result_buffer_.begin() + jit_->GetArgTypeSize(0),
+              state_buffer_.begin());
+    ++current_iteration_;
+  }
+
+  ProcInterpreter::RunResult result{.iteration_complete = iteration_complete_,
+                                    .progress_made = progress_made_,
+                                    .blocked_channels = blocked_channels_};
+  std::sort(result.blocked_channels.begin(), result.blocked_channels.end(),
+            [](Channel* a, Channel* b) { return a->id() < b->id(); });
+
+  XLS_VLOG(3) << absl::StreamFormat("Proc %s run result: %s", proc_->name(),
+                                    result.ToString());
+  return result;
+}
+
+bool ProcJit::Receive(Node* node, bool operands_ready, bool predicate,
+                      uint8* buffer) {
+  ChannelOp& op = channel_ops_.at(node);
+  if (op.done) {
+    std::memcpy(buffer, op.result.data(), op.result.size());
+    return true;
+  }
+  if (!operands_ready || !status_.ok()) {
+    blocked_ = true;
+    return false;
+  }
+
+  // If the predicate of a receive_if is false, nothing is dequeued and the data
+  // values are zero.
+  std::fill(op.result.begin(), op.result.end(), 0);
+  if (predicate) {
+    if (op.queue->empty()) {
+      XLS_VLOG(4) << absl::StreamFormat(
+          "Receive node %s blocked on channel with ID %d", node->GetName(),
+          op.queue->channel()->id());
+      blocked_ = true;
+      blocked_channels_.push_back(op.queue->channel());
+      return false;
+    }
+    absl::StatusOr<ChannelData> data = op.queue->Dequeue();
+    if (!data.ok()) {
+      status_ = data.status();
+      blocked_ = true;
+      return false;
+    }
+    // Return value of a receive is a tuple containing:
+    //   (token, data-element-0, data-element-1, ... , data-element-n)
+    std::vector<Value> tuple_values;
+    tuple_values.push_back(Value::Token());
+    for (Value& value : data.value()) {
+      tuple_values.push_back(std::move(value));
+    }
+    Value tuple = Value::TupleOwned(std::move(tuple_values));
+    if (!ValueConformsToType(tuple, op.type)) {
+      status_ = absl::InvalidArgumentError(absl::StrFormat(
+          "Data received on channel %s does not match type of node %s: %s",
+          op.queue->channel()->name(), node->GetName(), tuple.ToString()));
+      blocked_ = true;
+      return false;
+    }
+    jit_->runtime()->BlitValueToBuffer(tuple, *op.type,
+                                       absl::MakeSpan(op.result));
+  }
+
+  op.done = true;
+  progress_made_ = true;
+  std::memcpy(buffer, op.result.data(), op.result.size());
+  return true;
+}
+
+void ProcJit::Send(Node* node, bool operands_ready, bool predicate,
+                   const uint8* data) {
+  ChannelOp& op = channel_ops_.at(node);
+  if (op.done || !operands_ready || !status_.ok()) {
+    return;
+  }
+  op.done = true;
+  progress_made_ = true;
+  if (!predicate) {
+    return;
+  }
+
+  Value tuple = jit_->runtime()->UnpackBuffer(data, op.type);
+  ChannelData to_send(tuple.elements().begin(), tuple.elements().end());
+  status_ = op.queue->Enqueue(to_send);
+}
+
+}  // namespace xls
@@ -0,0 +1,110 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_JIT_PROC_JIT_H_
+#define XLS_JIT_PROC_JIT_H_
+
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "xls/common/integral_types.h"
+#include "xls/interpreter/channel_queue.h"
+#include "xls/interpreter/proc_interpreter.h"
+#include "xls/ir/proc.h"
+#include "xls/ir/value.h"
+#include "xls/jit/llvm_ir_jit.h"
+
+namespace xls {
+
+// Host-compiled counterpart of ProcInterpreter: executes a single proc an
+// iteration at a time, communicating via ChannelQueues.
+//
+// The proc is compiled once into a native function computing the next state.
+// Send and receive nodes call back into this object, which performs the queue
+// operations. Because compiled code can't be suspended part way through, a
+// blocked iteration is resumed by re-running the whole function: receives and
+// sends which already completed in the current iteration are replayed from
+// (or suppressed by) per-node records kept here, so each channel operation
+// takes effect exactly once per iteration, as in the interpreter.
+//
+// ProcJits are thread-compatible, but not thread-safe.
+class ProcJit : private JitChannelHandler {
+ public:
+  static absl::StatusOr<std::unique_ptr<ProcJit>> Create(
+      Proc* proc, ChannelQueueManager* queue_manager, int64 opt_level = 3);
+
+  ProcJit(const ProcJit&) = delete;
+  ProcJit operator=(const ProcJit&) = delete;
+
+  // Runs the proc until the iteration is complete or execution is blocked on a
+  // receive operation. Has the same semantics as
+  // ProcInterpreter::RunIterationUntilCompleteOrBlocked().
+  absl::StatusOr<ProcInterpreter::RunResult>
+  RunIterationUntilCompleteOrBlocked();
+
+  // Whether the previous call to RunIterationUntilCompleteOrBlocked completed
+  // an iteration of the proc.
+  bool IsIterationComplete() const { return iteration_complete_; }
+
+  // Returns the current value of the proc state.
+  Value GetState() const;
+
+  Proc* proc() const { return proc_; }
+
+ private:
+  // Bookkeeping for a single send or receive node.
+  struct ChannelOp {
+    ChannelQueue* queue;
+    // For receives, the node's (token, data...) type; for sends, a tuple of the
+    // data operand types.
+    Type* type;
+    // Whether the operation has taken effect in the current iteration.
+    bool done;
+    // For receives, the result written by the completed operation, in LLVM
+    // layout; replayed when the iteration is resumed.
+    std::vector<uint8> result;
+  };
+
+  explicit ProcJit(Proc* proc) : proc_(proc) {}
+
+  bool Receive(Node* node, bool operands_ready, bool predicate,
+               uint8* buffer) override;
+  void Send(Node* node, bool operands_ready, bool predicate,
+            const uint8* data) override;
+
+  Proc* proc_;
+  std::unique_ptr<LlvmIrJit> jit_;
+
+  absl::flat_hash_map<Node*, ChannelOp> channel_ops_;
+
+  // The state and the (next state, token) result, in LLVM layout.
+  std::vector<uint8> state_buffer_;
+  std::vector<uint8> result_buffer_;
+
+  int64 current_iteration_ = 0;
+  bool iteration_complete_ = true;
+
+  // Scratch state for a single invocation of the compiled function.
+  bool progress_made_;
+  bool blocked_;
+  std::vector<Channel*> blocked_channels_;
+  absl::Status status_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_JIT_PROC_JIT_H_
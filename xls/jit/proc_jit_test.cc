@@ -0,0 +1,36 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/proc_jit.h"
+
+#include "absl/memory/memory.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/interpreter/proc_evaluator_test.h"
+
+namespace xls {
+namespace {
+
+INSTANTIATE_TEST_SUITE_P(
+    ProcJitTest, ProcEvaluatorTest,
+    testing::Values(ProcEvaluatorTestParam(
+        [](Proc* proc, ChannelQueueManager* queue_manager)
+            -> absl::StatusOr<std::unique_ptr<ProcEvaluator>> {
+          XLS_ASSIGN_OR_RETURN(std::unique_ptr<ProcJit> jit,
+                               ProcJit::Create(proc, queue_manager));
+          return absl::make_unique<ProcEvaluatorAdapter<ProcJit>>(
+              std::move(jit));
+        })));
+
+}  // namespace
+}  // namespace xls
@@ -0,0 +1,47 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/jit/proc_network_jit.h"
+
+#include "absl/memory/memory.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/interpreter/proc_network_tick.h"
+
+namespace xls {
+
+/* static */
+absl::StatusOr<std::unique_ptr<ProcNetworkJit>> ProcNetworkJit::Create(
+    Package* package,
+    std::vector<std::unique_ptr<RxOnlyChannelQueue>>&& rx_only_queues,
+    int64 opt_level) {
+  XLS_ASSIGN_OR_RETURN(
+      std::unique_ptr<ChannelQueueManager> queue_manager,
+      ChannelQueueManager::Create(std::move(rx_only_queues), package));
+
+  auto network =
+      absl::WrapUnique(new ProcNetworkJit(package, std::move(queue_manager)));
+  for (auto& proc : package->procs()) {
+    XLS_ASSIGN_OR_RETURN(
+        std::unique_ptr<ProcJit> proc_jit,
+        ProcJit::Create(proc.get(), &network->queue_manager(), opt_level));
+    network->proc_jits_.push_back(std::move(proc_jit));
+  }
+  return std::move(network);
+}
+
+absl::Status ProcNetworkJit::Tick() {
+  return TickProcNetwork<ProcJit>(proc_jits_);
+}
+
+}  // namespace xls
@@ -0,0 +1,63 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_JIT_PROC_NETWORK_JIT_H_
+#define XLS_JIT_PROC_NETWORK_JIT_H_
+
+#include <memory>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "xls/interpreter/channel_queue.h"
+#include "xls/ir/package.h"
+#include "xls/jit/proc_jit.h"
+
+namespace xls {
+
+// Executes a network of procs using host-compiled code. A drop-in replacement
+// for ProcNetworkInterpreter: every proc in the package is compiled with a
+// ProcJit and ticked in the same round-robin fashion, with all interproc
+// communication handled via channel queues. ProcNetworkJits are
+// thread-compatible, but not thread-safe.
+class ProcNetworkJit {
+ public:
+  // Creates and returns a JIT for the given package. rx_only_queues must
+  // contain a queue for each receive-only channel in the package.
+  static absl::StatusOr<std::unique_ptr<ProcNetworkJit>> Create(
+      Package* package,
+      std::vector<std::unique_ptr<RxOnlyChannelQueue>>&& rx_only_queues,
+      int64 opt_level = 3);
+
+  // Execute (up to) a single iteration of every proc in the package. Has the
+  // same semantics as ProcNetworkInterpreter::Tick(), including returning an
+  // error if no progress can be made due to a deadlock.
+  absl::Status Tick();
+
+  ChannelQueueManager& queue_manager() { return *queue_manager_; }
+
+ private:
+  ProcNetworkJit(Package* package,
+                 std::unique_ptr<ChannelQueueManager>&& queue_manager)
+      : package_(package), queue_manager_(std::move(queue_manager)) {}
+
+  Package* package_;
+  std::unique_ptr<ChannelQueueManager> queue_manager_;
+
+  // The compiled procs, one for each proc in the package.
+  std::vector<std::unique_ptr<ProcJit>> proc_jits_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_JIT_PROC_NETWORK_JIT_H_
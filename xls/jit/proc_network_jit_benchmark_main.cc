@@ -0,0 +1,222 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/integral_types.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/interpreter/channel_queue.h"
+#include "xls/interpreter/proc_network_interpreter.h"
+#include "xls/ir/channel.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/package.h"
+#include "xls/ir/value.h"
+#include "xls/jit/proc_network_jit.h"
+
+const char* kUsage = R"(
+Times Tick() of a proc network evaluated with ProcNetworkInterpreter and with
+ProcNetworkJit. The network is an iota proc feeding a chain of accumulator
+procs; the number of accumulators is varied. Usage:
+
+   proc_network_jit_benchmark_main
+   proc_network_jit_benchmark_main --num_stages=1,64 --min_run_time=1s
+)";
+
+ABSL_FLAG(std::vector<std::string>, num_stages,
+          std::vector<std::string>({"1", "4", "16", "64"}),
+          "Comma-separated list of numbers of accumulator procs to benchmark.");
+ABSL_FLAG(absl::Duration, min_run_time, absl::Milliseconds(200),
+          "Minimum time to tick each network for.");
+
+namespace xls {
+namespace {
+
+// The number of ticks whose outputs are compared between the interpreter and
+// the JIT before timing.
+constexpr int64 kCheckedTicks = 16;
+
+// A package containing the benchmarked network and its output channel.
+struct ProcNetwork {
+  std::unique_ptr<Package> package;
+  Channel* output;
+};
+
+// Creates a network of an iota proc sending 1, 2, 3, ... followed by
+// 'num_stages' procs, each of which receives a value, adds its square to a
+// running sum and sends the sum to the next proc. The last proc sends on the
+// send-only output channel.
+absl::StatusOr<ProcNetwork> CreateNetwork(int64 num_stages) {
+  auto package = absl::make_unique<Package>("accumulator_chain");
+  std::vector<Channel*> channels;
+  for (int64 i = 0; i <= num_stages; ++i) {
+    XLS_ASSIGN_OR_RETURN(
+        Channel * channel,
+        package->CreateChannel(
+            absl::StrCat("ch", i),
+            i == num_stages ? ChannelKind::kSendOnly
+                            : ChannelKind::kSendReceive,
+            {DataElement{"data", package->GetBitsType(32)}},
+            ChannelMetadataProto()));
+    channels.push_back(channel);
+  }
+
+  ProcBuilder iota("iota", /*init_value=*/Value(UBits(1, 32)),
+                   /*state_name=*/"st", /*token_name=*/"tok", package.get());
+  BValue iota_send =
+      iota.Send(channels[0], iota.GetTokenParam(), {iota.GetStateParam()});
+  XLS_RETURN_IF_ERROR(
+      iota.BuildWithReturnValue(
+              iota.Tuple({iota.Add(iota.GetStateParam(),
+                                   iota.Literal(UBits(1, 32))),
+                          iota_send}))
+          .status());
+
+  for (int64 i = 0; i < num_stages; ++i) {
+    ProcBuilder pb(absl::StrCat("accum", i),
+                   /*init_value=*/Value(UBits(0, 32)), /*state_name=*/"st",
+                   /*token_name=*/"tok", package.get());
+    BValue receive = pb.Receive(channels[i], pb.GetTokenParam());
+    BValue input = pb.TupleIndex(receive, 1);
+    BValue sum = pb.Add(pb.GetStateParam(), pb.UMul(input, input));
+    BValue send =
+        pb.Send(channels[i + 1], pb.TupleIndex(receive, 0), {sum});
+    XLS_RETURN_IF_ERROR(
+        pb.BuildWithReturnValue(pb.Tuple({sum, send})).status());
+  }
+  return ProcNetwork{std::move(package), channels.back()};
+}
+
+// Ticks the network 'num_ticks' times and returns the values sent on the
+// output channel.
+template <typename NetworkT>
+absl::StatusOr<std::vector<Value>> TickAndCollect(NetworkT* network,
+                                                  Channel* output,
+                                                  int64 num_ticks) {
+  ChannelQueue& queue = network->queue_manager().GetQueue(output);
+  std::vector<Value> values;
+  for (int64 i = 0; i < num_ticks; ++i) {
+    XLS_RETURN_IF_ERROR(network->Tick());
+    while (!queue.empty()) {
+      XLS_ASSIGN_OR_RETURN(std::vector<Value> data, queue.Dequeue());
+      values.push_back(Value::Tuple(data));
+    }
+  }
+  return values;
+}
+
+// Returns the average time per Tick() of the network, ticking it for at
+// least --min_run_time.
+template <typename NetworkT>
+absl::StatusOr<absl::Duration> TimeTicks(NetworkT* network, Channel* output) {
+  ChannelQueue& queue = network->queue_manager().GetQueue(output);
+  const absl::Duration min_run_time = absl::GetFlag(FLAGS_min_run_time);
+  int64 ticks = 0;
+  absl::Duration run_time;
+  absl::Time start = absl::Now();
+  do {
+    XLS_RETURN_IF_ERROR(network->Tick());
+    // Drain the output so the queue does not grow without bound.
+    while (!queue.empty()) {
+      XLS_RETURN_IF_ERROR(queue.Dequeue().status());
+    }
+    ++ticks;
+    run_time = absl::Now() - start;
+  } while (run_time < min_run_time);
+  return run_time / ticks;
+}
+
+absl::Status BenchmarkNumStages(int64 num_stages) {
+  XLS_ASSIGN_OR_RETURN(ProcNetwork network, CreateNetwork(num_stages));
+
+  XLS_ASSIGN_OR_RETURN(
+      std::unique_ptr<ProcNetworkInterpreter> interpreter,
+      ProcNetworkInterpreter::Create(network.package.get(),
+                                     /*rx_only_queues=*/{}));
+  absl::Time start = absl::Now();
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<ProcNetworkJit> jit,
+                       ProcNetworkJit::Create(network.package.get(),
+                                              /*rx_only_queues=*/{}));
+  absl::Duration compile_time = absl::Now() - start;
+
+  XLS_ASSIGN_OR_RETURN(
+      std::vector<Value> expected,
+      TickAndCollect(interpreter.get(), network.output, kCheckedTicks));
+  XLS_ASSIGN_OR_RETURN(
+      std::vector<Value> actual,
+      TickAndCollect(jit.get(), network.output, kCheckedTicks));
+  if (actual != expected) {
+    auto format_value = [](std::string* out, const Value& value) {
+      absl::StrAppend(out, value.ToString());
+    };
+    return absl::InternalError(absl::StrFormat(
+        "JIT outputs differ from interpreter outputs: [%s] vs [%s]",
+        absl::StrJoin(actual, ", ", format_value),
+        absl::StrJoin(expected, ", ", format_value)));
+  }
+
+  XLS_ASSIGN_OR_RETURN(absl::Duration interpreter_tick,
+                       TimeTicks(interpreter.get(), network.output));
+  XLS_ASSIGN_OR_RETURN(absl::Duration jit_tick,
+                       TimeTicks(jit.get(), network.output));
+  std::cout << absl::StreamFormat(
+      "%10d %12.1f %21.2f %14.2f %8.1fx\n", num_stages,
+      absl::ToDoubleMilliseconds(compile_time),
+      absl::ToDoubleMicroseconds(interpreter_tick),
+      absl::ToDoubleMicroseconds(jit_tick),
+      absl::FDivDuration(interpreter_tick, jit_tick));
+  return absl::OkStatus();
+}
+
+absl::Status RealMain() {
+  std::cout << absl::StreamFormat("%10s %12s %21s %14s %9s\n", "num_stages",
+                                  "compile (ms)", "interpreter (us/tick)",
+                                  "jit (us/tick)", "speedup");
+  for (const std::string& num_stages_str : absl::GetFlag(FLAGS_num_stages)) {
+    int64 num_stages;
+    XLS_QCHECK(absl::SimpleAtoi(num_stages_str, &num_stages) &&
+               num_stages >= 1)
+        << "Invalid number of stages: " << num_stages_str;
+    XLS_RETURN_IF_ERROR(BenchmarkNumStages(num_stages));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace xls
+
+int main(int argc, char** argv) {
+  std::vector<absl::string_view> positional_arguments =
+      xls::InitXls(kUsage, argc, argv);
+  XLS_QCHECK(positional_arguments.empty())
+      << "Unexpected positional arguments: "
+      << absl::StrJoin(positional_arguments, ", ");
+  XLS_QCHECK_OK(xls::RealMain());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Micro-benchmark of the per-call latency of the interfaces of the generated
+// JIT wrappers for the 2x32 floating-point modules: the Value-based Run(), the
+// packed-view Run() and the native float Run().
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "absl/base/casts.h"
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/integral_types.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/value.h"
+#include "xls/ir/value_helpers.h"
+#include "xls/ir/value_view_helpers.h"
+#include "xls/modules/fpadd_2x32_jit_wrapper.h"
+#include "xls/modules/fpmul_2x32_jit_wrapper.h"
+
+ABSL_FLAG(int64, argument_sets, 1024,
+          "Number of pairs of random floats to cycle through.");
+ABSL_FLAG(absl::Duration, min_run_time, absl::Milliseconds(500),
+          "Minimum time to run each interface for.");
+
+namespace xls {
+namespace {
+
+// Times "run" over "count" arguments, cycling until --min_run_time has passed,
+// and prints the per-call latency.
+void TimeInterface(absl::string_view name, int64 count,
+                   const std::function<void(int64)>& run) {
+  const absl::Duration min_run_time = absl::GetFlag(FLAGS_min_run_time);
+  int64 calls = 0;
+  absl::Time start = absl::Now();
+  absl::Duration run_time;
+  do {
+    for (int64 i = 0; i < count; ++i) {
+      run(i);
+    }
+    calls += count;
+    run_time = absl::Now() - start;
+  } while (run_time < min_run_time);
+  std::cout << absl::StreamFormat("  %-12s %10.1fns per call  (%d calls)\n",
+                                  name,
+                                  absl::ToDoubleNanoseconds(run_time) / calls,
+                                  calls);
+}
+
+template <typename WrapperT>
+absl::Status BenchmarkWrapper(absl::string_view name) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<WrapperT> wrapper, WrapperT::Create());
+
+  const int64 count = absl::GetFlag(FLAGS_argument_sets);
+  std::minstd_rand engine;
+  std::uniform_int_distribution<uint32> distribution;
+  std::vector<float> lhs;
+  std::vector<float> rhs;
+  std::vector<Value> lhs_values;
+  std::vector<Value> rhs_values;
+  for (int64 i = 0; i < count; ++i) {
+    lhs.push_back(absl::bit_cast<float>(distribution(engine)));
+    rhs.push_back(absl::bit_cast<float>(distribution(engine)));
+    lhs_values.push_back(F32ToTuple(lhs.back()));
+    rhs_values.push_back(F32ToTuple(rhs.back()));
+  }
+
+  // Check that the interfaces agree (bitwise, so NaNs compare equal).
+  for (int64 i = 0; i < count; ++i) {
+    XLS_ASSIGN_OR_RETURN(Value value_result,
+                         wrapper->Run(lhs_values[i], rhs_values[i]));
+    XLS_ASSIGN_OR_RETURN(float value_float, TupleToF32(value_result));
+    float x = lhs[i];
+    float y = rhs[i];
+    float packed_result;
+    XLS_RETURN_IF_ERROR(
+        wrapper->Run(PackedF32TupleView(reinterpret_cast<uint8*>(&x), 0),
+                     PackedF32TupleView(reinterpret_cast<uint8*>(&y), 0),
+                     PackedF32TupleView(
+                         reinterpret_cast<uint8*>(&packed_result), 0)));
+    XLS_ASSIGN_OR_RETURN(float native_result, wrapper->Run(lhs[i], rhs[i]));
+    uint32 expected = absl::bit_cast<uint32>(value_float);
+    if (absl::bit_cast<uint32>(packed_result) != expected ||
+        absl::bit_cast<uint32>(native_result) != expected) {
+      return absl::InternalError(absl::StrFormat(
+          "%s(%g, %g): results differ: Value %g, packed view %g, native %g",
+          name, lhs[i], rhs[i], value_float, packed_result, native_result));
+    }
+  }
+
+  std::cout << name << std::endl;
+  // The arguments are converted to Values ahead of time, so this measures
+  // only the call itself.
+  TimeInterface("Value", count, [&](int64 i) {
+    XLS_CHECK_OK(wrapper->Run(lhs_values[i], rhs_values[i]).status());
+  });
+  TimeInterface("PackedView", count, [&](int64 i) {
+    float x = lhs[i];
+    float y = rhs[i];
+    float result;
+    XLS_CHECK_OK(wrapper->Run(
+        PackedF32TupleView(reinterpret_cast<uint8*>(&x), 0),
+        PackedF32TupleView(reinterpret_cast<uint8*>(&y), 0),
+        PackedF32TupleView(reinterpret_cast<uint8*>(&result), 0)));
+  });
+  TimeInterface("float", count, [&](int64 i) {
+    XLS_CHECK_OK(wrapper->Run(lhs[i], rhs[i]).status());
+  });
+  return absl::OkStatus();
+}
+
+absl::Status RealMain() {
+  XLS_RETURN_IF_ERROR(BenchmarkWrapper<Fpadd2x32>("fpadd_2x32"));
+  return BenchmarkWrapper<Fpmul2x32>("fpmul_2x32");
+}
+
+}  // namespace
+}  // namespace xls
+
+int main(int argc, char** argv) {
+  xls::InitXls(argv[0], argc, argv);
+  XLS_QCHECK_OK(xls::RealMain());
+  return 0;
+}
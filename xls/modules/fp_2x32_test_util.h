@@ -0,0 +1,88 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Helpers shared by the random-sampling tests of the DSLX 2x32 floating-point
+// modules (fpadd_2x32_test, fpmul_2x32_test).
+
+#ifndef XLS_MODULES_FP_2X32_TEST_UTIL_H_
+#define XLS_MODULES_FP_2X32_TEST_UTIL_H_
+
+#include <tuple>
+#include <vector>
+
+#include "absl/base/casts.h"
+#include "absl/types/span.h"
+#include "xls/common/integral_types.h"
+#include "xls/common/logging/logging.h"
+#include "xls/jit/llvm_ir_jit.h"
+
+namespace xls {
+
+using Float2x32 = std::tuple<float, float>;
+
+// The JIT's native layout of the (sign, exponent, fraction) tuple of an F32, as
+// used by its batched entry point.
+struct NativeF32 {
+  uint8 sign;
+  uint8 exponent;
+  uint32 fraction;
+};
+
+inline NativeF32 ToNativeF32(float value) {
+  uint32 bits = absl::bit_cast<uint32>(value);
+  return NativeF32{static_cast<uint8>(bits >> 31),
+                   static_cast<uint8>(bits >> 23), bits & 0x7fffff};
+}
+
+inline float FromNativeF32(const NativeF32& value) {
+  return absl::bit_cast<float>(static_cast<uint32>(value.sign) << 31 |
+                               static_cast<uint32>(value.exponent) << 23 |
+                               value.fraction);
+}
+
+// Computes the results of a chunk of inputs in a single call to the batched
+// entry point of the JIT of 'jit_wrapper', which is the generated wrapper of a
+// function taking two F32s and returning an F32 (e.g. Fpadd2x32).
+template <typename JitWrapperT>
+void ComputeActualBatched(JitWrapperT* jit_wrapper,
+                          absl::Span<const Float2x32> inputs,
+                          absl::Span<float> results) {
+  LlvmIrJit* jit = jit_wrapper->jit();
+  XLS_CHECK_EQ(jit->GetArgTypeSize(0), sizeof(NativeF32));
+  XLS_CHECK_EQ(jit->GetReturnTypeSize(), sizeof(NativeF32));
+  thread_local std::vector<NativeF32> x;
+  thread_local std::vector<NativeF32> y;
+  thread_local std::vector<NativeF32> z;
+  x.resize(inputs.size());
+  y.resize(inputs.size());
+  z.resize(inputs.size());
+  for (int64 i = 0; i < inputs.size(); ++i) {
+    x[i] = ToNativeF32(std::get<0>(inputs[i]));
+    y[i] = ToNativeF32(std::get<1>(inputs[i]));
+  }
+  const uint8* args[] = {reinterpret_cast<const uint8*>(x.data()),
+                         reinterpret_cast<const uint8*>(y.data())};
+  XLS_CHECK_OK(jit->RunBatched(
+      args,
+      absl::MakeSpan(reinterpret_cast<uint8*>(z.data()),
+                     z.size() * sizeof(NativeF32)),
+      inputs.size()));
+  for (int64 i = 0; i < inputs.size(); ++i) {
+    results[i] = FromNativeF32(z[i]);
+  }
+}
+
+}  // namespace xls
+
+#endif  // XLS_MODULES_FP_2X32_TEST_UTIL_H_
@@ -16,6 +16,7 @@
 #include <cmath>
 #include <tuple>
 
+#include "absl/base/casts.h"
 #include "absl/random/random.h"
 #include "absl/status/status.h"
 #include "xls/common/file/get_runfile_path.h"
@@ -24,6 +25,7 @@
 #include "xls/common/status/status_macros.h"
 #include "xls/ir/value_helpers.h"
 #include "xls/ir/value_view_helpers.h"
+#include "xls/modules/fp_2x32_test_util.h"
 #include "xls/modules/fpmul_2x32_jit_wrapper.h"
 #include "xls/tools/testbench.h"
 
@@ -31,14 +33,15 @@ ABSL_FLAG(bool, use_opt_ir, true, "Use optimized IR.");
 ABSL_FLAG(int, num_threads, 0,
           "Number of threads to use. Set to 0 to use all.");
 ABSL_FLAG(int64, num_samples, 1024 * 1024, "Number of random samples to test.");
+ABSL_FLAG(bool, batched, false,
+          "Run the JIT on a chunk of samples at a time through its batched "
+          "entry point, rather than once per sample.");
 
 namespace xls {
 
 constexpr const char kOptIrPath[] = "xls/modules/fpmul_2x32.opt.ir";
 constexpr const char kIrPath[] = "xls/modules/fpmul_2x32.ir";
 
-using Float2x32 = std::tuple<float, float>;
-
 float FlushSubnormals(float value) {
   if (std::fpclassify(value) == FP_SUBNORMAL) {
     return 0;
@@ -83,7 +86,8 @@ bool CompareResults(float a, float b) {
          (ZeroOrSubnormal(a) && ZeroOrSubnormal(b));
 }
 
-absl::Status RealMain(bool use_opt_ir, uint64 num_samples, int num_threads) {
+absl::Status RealMain(bool use_opt_ir, uint64 num_samples, int num_threads,
+                      bool batched) {
   Testbench<Fpmul2x32, Float2x32, float> testbench(
       0, num_samples,
       /*max_failures=*/1, IndexToInput, ComputeExpected, ComputeActual,
@@ -91,6 +95,10 @@ absl::Status RealMain(bool use_opt_ir, uint64 num_samples, int num_threads) {
   if (num_threads != 0) {
     XLS_RETURN_IF_ERROR(testbench.SetNumThreads(num_threads));
   }
+  if (batched) {
+    XLS_RETURN_IF_ERROR(
+        testbench.SetComputeActualBatched(ComputeActualBatched<Fpmul2x32>));
+  }
   return testbench.Run();
 }
 
@@ -100,6 +108,7 @@ int main(int argc, char** argv) {
   xls::InitXls(argv[0], argc, argv);
   XLS_QCHECK_OK(xls::RealMain(absl::GetFlag(FLAGS_use_opt_ir),
                               absl::GetFlag(FLAGS_num_samples),
-                              absl::GetFlag(FLAGS_num_threads)));
+                              absl::GetFlag(FLAGS_num_threads),
+                              absl::GetFlag(FLAGS_batched)));
   return 0;
 }
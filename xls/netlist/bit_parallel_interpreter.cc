@@ -0,0 +1,433 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "xls/netlist/bit_parallel_interpreter.h"
+
+#include <deque>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+
+namespace xls {
+namespace netlist {
+namespace {
+
+// Cells whose state tables are lowered to sums of products are enumerated
+// exhaustively at compile time, so cap the number of inputs we'll accept.
+constexpr int64 kMaxStateTableInputs = 12;
+
+}  // namespace
+
+BitParallelInterpreter::BitParallelInterpreter(const rtl::Netlist* netlist,
+                                               const rtl::Module* module)
+    : netlist_(netlist), module_(module) {
+  values_.push_back(0);   // kZeroSlot
+  values_.push_back(~Word{0});  // kOneSlot
+}
+
+/* static */ absl::StatusOr<std::unique_ptr<BitParallelInterpreter>>
+BitParallelInterpreter::Create(const rtl::Netlist* netlist,
+                               const rtl::Module* module) {
+  auto interpreter =
+      absl::WrapUnique(new BitParallelInterpreter(netlist, module));
+
+  // The top-level inputs and outputs get slots up front so the caller-facing
+  // ordering is fixed regardless of how the module is levelized.
+  SlotMap slots;
+  for (const rtl::NetRef input : module->inputs()) {
+    int32 slot = interpreter->AllocateSlot();
+    slots[input] = slot;
+    interpreter->input_slots_.push_back(slot);
+  }
+  for (const rtl::NetRef output : module->outputs()) {
+    auto it = slots.find(output);
+    int32 slot;
+    if (it == slots.end()) {
+      slot = interpreter->AllocateSlot();
+      slots[output] = slot;
+    } else {
+      slot = it->second;
+    }
+    interpreter->output_slots_.push_back(slot);
+  }
+  XLS_RETURN_IF_ERROR(interpreter->CompileModule(module, std::move(slots)));
+  XLS_RET_CHECK_EQ(interpreter->stack_depth_, 0);
+  interpreter->stack_.resize(interpreter->max_stack_depth_);
+
+  XLS_VLOG(1) << absl::StreamFormat(
+      "Compiled module %s: %d slots, %d ops, max stack depth %d.",
+      module->name(), interpreter->slot_count(), interpreter->op_count(),
+      interpreter->max_stack_depth_);
+  return std::move(interpreter);
+}
+
+int32 BitParallelInterpreter::AllocateSlot() {
+  values_.push_back(0);
+  return values_.size() - 1;
+}
+
+void BitParallelInterpreter::Emit(OpCode code, int32 slot) {
+  ops_.push_back(Op{code, slot});
+  switch (code) {
+    case OpCode::kPushSlot:
+    case OpCode::kPushZero:
+    case OpCode::kPushOne:
+      ++stack_depth_;
+      break;
+    case OpCode::kAnd:
+    case OpCode::kOr:
+    case OpCode::kXor:
+    case OpCode::kStoreSlot:
+      --stack_depth_;
+      break;
+    case OpCode::kNot:
+      break;
+  }
+  max_stack_depth_ = std::max(max_stack_depth_, stack_depth_);
+}
+
+absl::StatusOr<const function::Ast*> BitParallelInterpreter::GetAst(
+    const std::string& function) {
+  auto it = ast_cache_.find(function);
+  if (it != ast_cache_.end()) {
+    return it->second.get();
+  }
+  XLS_ASSIGN_OR_RETURN(function::Ast ast,
+                       function::Parser::ParseFunction(function));
+  auto inserted = ast_cache_.insert(
+      {function, absl::make_unique<function::Ast>(std::move(ast))});
+  return inserted.first->second.get();
+}
+
+absl::Status BitParallelInterpreter::CompileModule(const rtl::Module* module,
+                                                   SlotMap slots) {
+  // Constant nets alias the shared constant slots; everything else not
+  // already bound by the caller gets its own storage.
+  XLS_ASSIGN_OR_RETURN(rtl::NetRef net_0, module->ResolveNumber(0));
+  XLS_ASSIGN_OR_RETURN(rtl::NetRef net_1, module->ResolveNumber(1));
+  slots[net_0] = kZeroSlot;
+  slots[net_1] = kOneSlot;
+  for (const auto& net : module->nets()) {
+    if (!slots.contains(net.get())) {
+      slots[net.get()] = AllocateSlot();
+    }
+  }
+
+  // Levelize the cells the same way Interpreter::InterpretModule walks them:
+  // a cell is emitted once all of its input nets have been produced.
+  absl::flat_hash_map<rtl::Cell*, absl::flat_hash_set<rtl::NetRef>> cell_inputs;
+  std::deque<rtl::NetRef> active_wires;
+  absl::flat_hash_set<rtl::NetRef> processed_wires;
+
+  auto compile_cell = [&](rtl::Cell* cell) -> absl::Status {
+    XLS_VLOG(2) << "Compiling cell: " << cell->name();
+    XLS_RETURN_IF_ERROR(CompileCell(*cell, slots));
+    for (const auto& output : cell->outputs()) {
+      processed_wires.insert(output.netref);
+      active_wires.push_back(output.netref);
+    }
+    return absl::OkStatus();
+  };
+
+  for (const auto& cell : module->cells()) {
+    if (cell->inputs().empty()) {
+      XLS_RETURN_IF_ERROR(compile_cell(cell.get()));
+    } else {
+      absl::flat_hash_set<rtl::NetRef> inputs;
+      for (const auto& input : cell->inputs()) {
+        inputs.insert(input.netref);
+      }
+      cell_inputs[cell.get()] = std::move(inputs);
+    }
+  }
+
+  for (const rtl::NetRef ref : module->inputs()) {
+    processed_wires.insert(ref);
+    active_wires.push_back(ref);
+  }
+  for (const rtl::NetRef ref : {net_0, net_1}) {
+    processed_wires.insert(ref);
+    active_wires.push_back(ref);
+  }
+
+  while (!active_wires.empty()) {
+    rtl::NetRef wire = active_wires.front();
+    active_wires.pop_front();
+    for (rtl::Cell* cell : wire->connected_cells()) {
+      auto it = cell_inputs.find(cell);
+      if (it == cell_inputs.end() || !it->second.contains(wire)) {
+        // Either this wire is driven by the cell, or the cell has already been
+        // satisfied by an earlier activation of this wire.
+        continue;
+      }
+      it->second.erase(wire);
+      if (it->second.empty()) {
+        XLS_RETURN_IF_ERROR(compile_cell(cell));
+      }
+    }
+  }
+
+  for (const auto& cell : module->cells()) {
+    for (const auto& output : cell->outputs()) {
+      if (!processed_wires.contains(output.netref)) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Netlist contains unconnected subgraphs and cannot be translated. "
+            "Example: cell %s, output %s.",
+            cell->name(), output.netref->name()));
+      }
+    }
+  }
+
+  return absl::OkStatus();
+}
+
+absl::Status BitParallelInterpreter::CompileCell(const rtl::Cell& cell,
+                                                 const SlotMap& slots) {
+  const CellLibraryEntry* entry = cell.cell_library_entry();
+  absl::StatusOr<const rtl::Module*> status_or_module =
+      netlist_->GetModule(entry->name());
+  if (status_or_module.ok()) {
+    // Inline the submodule: its input and output nets alias the slots of the
+    // nets connected to the corresponding pins of this cell.
+    const rtl::Module* module = status_or_module.value();
+    const std::vector<rtl::NetRef>& module_input_refs = module->inputs();
+    const absl::Span<const std::string> module_input_names =
+        module->AsCellLibraryEntry()->input_names();
+
+    SlotMap child_slots;
+    for (const auto& input : cell.inputs()) {
+      bool input_found = false;
+      for (int i = 0; i < module_input_names.size(); i++) {
+        if (module_input_names[i] == input.name) {
+          child_slots[module_input_refs[i]] = slots.at(input.netref);
+          input_found = true;
+          break;
+        }
+      }
+      XLS_RET_CHECK(input_found) << absl::StrFormat(
+          "Could not find input pin \"%s\" in module \"%s\", referenced in "
+          "cell \"%s\"!",
+          input.name, module->name(), cell.name());
+    }
+
+    for (const rtl::NetRef child_output : module->outputs()) {
+      bool output_found = false;
+      for (const auto& cell_output : cell.outputs()) {
+        if (child_output->name() == cell_output.name) {
+          child_slots[child_output] = slots.at(cell_output.netref);
+          output_found = true;
+          break;
+        }
+      }
+      XLS_RET_CHECK(output_found) << absl::StrFormat(
+          "Could not find cell output pin \"%s\" in cell \"%s\", referenced in "
+          "child module \"%s\"!",
+          child_output->name(), cell.name(), module->name());
+    }
+
+    return CompileModule(module, std::move(child_slots));
+  }
+
+  const auto& pins = entry->output_pin_to_function();
+  for (const auto& output : cell.outputs()) {
+    XLS_ASSIGN_OR_RETURN(const function::Ast* ast,
+                         GetAst(pins.at(output.name)));
+    XLS_RETURN_IF_ERROR(CompileFunction(cell, *ast, slots));
+    Emit(OpCode::kStoreSlot, slots.at(output.netref));
+  }
+
+  return absl::OkStatus();
+}
+
+absl::Status BitParallelInterpreter::CompileFunction(const rtl::Cell& cell,
+                                                     const function::Ast& ast,
+                                                     const SlotMap& slots) {
+  switch (ast.kind()) {
+    case function::Ast::Kind::kAnd:
+    case function::Ast::Kind::kOr:
+    case function::Ast::Kind::kXor: {
+      XLS_RETURN_IF_ERROR(CompileFunction(cell, ast.children()[0], slots));
+      XLS_RETURN_IF_ERROR(CompileFunction(cell, ast.children()[1], slots));
+      OpCode code = ast.kind() == function::Ast::Kind::kAnd  ? OpCode::kAnd
+                    : ast.kind() == function::Ast::Kind::kOr ? OpCode::kOr
+                                                             : OpCode::kXor;
+      Emit(code);
+      return absl::OkStatus();
+    }
+    case function::Ast::Kind::kIdentifier: {
+      for (const auto& input : cell.inputs()) {
+        if (input.name == ast.name()) {
+          Emit(OpCode::kPushSlot, slots.at(input.netref));
+          return absl::OkStatus();
+        }
+      }
+      for (const auto& internal : cell.internal_pins()) {
+        if (internal.name == ast.name()) {
+          return CompileStateTable(cell, internal.name, slots);
+        }
+      }
+      return absl::NotFoundError(
+          absl::StrFormat("Identifier \"%s\" not found in cell %s's inputs "
+                          "or internal signals.",
+                          ast.name(), cell.name()));
+    }
+    case function::Ast::Kind::kLiteralOne:
+      Emit(OpCode::kPushOne);
+      return absl::OkStatus();
+    case function::Ast::Kind::kLiteralZero:
+      Emit(OpCode::kPushZero);
+      return absl::OkStatus();
+    case function::Ast::Kind::kNot:
+      XLS_RETURN_IF_ERROR(CompileFunction(cell, ast.children()[0], slots));
+      Emit(OpCode::kNot);
+      return absl::OkStatus();
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unknown AST element type: ", ast.kind()));
+  }
+}
+
+absl::Status BitParallelInterpreter::CompileStateTable(
+    const rtl::Cell& cell, const std::string& pin_name, const SlotMap& slots) {
+  XLS_RET_CHECK(cell.cell_library_entry()->state_table());
+  const StateTable& state_table =
+      cell.cell_library_entry()->state_table().value();
+
+  absl::Span<const rtl::Cell::Pin> inputs = cell.inputs();
+  if (inputs.size() > kMaxStateTableInputs) {
+    return absl::UnimplementedError(absl::StrFormat(
+        "Cell %s has %d inputs; at most %d are supported for state tables.",
+        cell.name(), inputs.size(), kMaxStateTableInputs));
+  }
+
+  // Enumerate the table's truth table and emit one product term per minterm
+  // for which the signal is high.
+  Emit(OpCode::kPushZero);
+  StateTable::InputStimulus stimulus;
+  for (uint64 minterm = 0; minterm < (uint64{1} << inputs.size()); ++minterm) {
+    for (int64 i = 0; i < inputs.size(); ++i) {
+      stimulus[inputs[i].name] = (minterm >> i) & 1;
+    }
+    XLS_ASSIGN_OR_RETURN(bool value,
+                         state_table.GetSignalValue(stimulus, pin_name));
+    if (!value) {
+      continue;
+    }
+    Emit(OpCode::kPushOne);
+    for (int64 i = 0; i < inputs.size(); ++i) {
+      Emit(OpCode::kPushSlot, slots.at(inputs[i].netref));
+      if (((minterm >> i) & 1) == 0) {
+        Emit(OpCode::kNot);
+      }
+      Emit(OpCode::kAnd);
+    }
+    Emit(OpCode::kOr);
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<BitParallelInterpreter::Word>>
+BitParallelInterpreter::RunWords(absl::Span<const Word> inputs) {
+  XLS_RET_CHECK_EQ(inputs.size(), input_slots_.size());
+  for (int64 i = 0; i < inputs.size(); ++i) {
+    values_[input_slots_[i]] = inputs[i];
+  }
+
+  Word* values = values_.data();
+  Word* stack = stack_.data();
+  int64 top = -1;
+  for (const Op& op : ops_) {
+    switch (op.code) {
+      case OpCode::kPushSlot:
+        stack[++top] = values[op.slot];
+        break;
+      case OpCode::kPushZero:
+        stack[++top] = 0;
+        break;
+      case OpCode::kPushOne:
+        stack[++top] = ~Word{0};
+        break;
+      case OpCode::kAnd:
+        stack[top - 1] &= stack[top];
+        --top;
+        break;
+      case OpCode::kOr:
+        stack[top - 1] |= stack[top];
+        --top;
+        break;
+      case OpCode::kXor:
+        stack[top - 1] ^= stack[top];
+        --top;
+        break;
+      case OpCode::kNot:
+        stack[top] = ~stack[top];
+        break;
+      case OpCode::kStoreSlot:
+        values[op.slot] = stack[top--];
+        break;
+    }
+  }
+
+  std::vector<Word> outputs;
+  outputs.reserve(output_slots_.size());
+  for (int32 slot : output_slots_) {
+    outputs.push_back(values_[slot]);
+  }
+  return outputs;
+}
+
+absl::StatusOr<std::vector<Bits>> BitParallelInterpreter::RunBatch(
+    absl::Span<const Bits> inputs) {
+  const int64 input_count = input_slots_.size();
+  const int64 output_count = output_slots_.size();
+  std::vector<Bits> results;
+  results.reserve(inputs.size());
+
+  std::vector<Word> input_words(input_count);
+  for (int64 base = 0; base < inputs.size(); base += kLanesPerWord) {
+    const int64 lanes =
+        std::min<int64>(kLanesPerWord, inputs.size() - base);
+
+    // Transpose from one-Bits-per-vector to one-word-per-input.
+    std::fill(input_words.begin(), input_words.end(), 0);
+    for (int64 lane = 0; lane < lanes; ++lane) {
+      const Bits& vector = inputs[base + lane];
+      XLS_RET_CHECK_EQ(vector.bit_count(), input_count) << absl::StrFormat(
+          "Input vector %d has %d bits; module %s has %d inputs.", base + lane,
+          vector.bit_count(), module_->name(), input_count);
+      for (int64 i = 0; i < input_count; ++i) {
+        input_words[i] |= static_cast<Word>(vector.Get(i)) << lane;
+      }
+    }
+
+    XLS_ASSIGN_OR_RETURN(std::vector<Word> output_words,
+                         RunWords(input_words));
+
+    for (int64 lane = 0; lane < lanes; ++lane) {
+      BitsRope rope(output_count);
+      for (int64 i = 0; i < output_count; ++i) {
+        rope.push_back(((output_words[i] >> lane) & 1) != 0);
+      }
+      results.push_back(rope.Build());
+    }
+  }
+  return results;
+}
+
+}  // namespace netlist
+}  // namespace xls
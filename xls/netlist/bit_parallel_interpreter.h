@@ -0,0 +1,147 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef XLS_NETLIST_BIT_PARALLEL_INTERPRETER_H_
+#define XLS_NETLIST_BIT_PARALLEL_INTERPRETER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/common/integral_types.h"
+#include "xls/ir/bits.h"
+#include "xls/netlist/function_parser.h"
+#include "xls/netlist/netlist.h"
+
+namespace xls {
+namespace netlist {
+
+// Compiled, levelized evaluator for combinational netlists.
+//
+// Where Interpreter walks the netlist (and each cell's function AST) once per
+// input vector, BitParallelInterpreter does that work once, at Create() time:
+// the module (including any submodules, which are inlined) is topologically
+// sorted, every net is assigned a slot in a dense value array, and every cell
+// output function is lowered to a flat sequence of bitwise stack-machine ops.
+//
+// Each slot holds a Word in which bit i is the value of that net for input
+// vector i, so a single pass over the op sequence evaluates kLanesPerWord
+// vectors at once.
+class BitParallelInterpreter {
+ public:
+  using Word = uint64;
+  static constexpr int64 kLanesPerWord = 64;
+
+  // Compiles the given module of the netlist.
+  static absl::StatusOr<std::unique_ptr<BitParallelInterpreter>> Create(
+      const rtl::Netlist* netlist, const rtl::Module* module);
+
+  // Evaluates up to kLanesPerWord input vectors at once.
+  //  - inputs: One word per module input, in Module::inputs() order. Bit i of
+  //    each word holds that input's value in vector i.
+  // Returns one word per module output, in Module::outputs() order, laid out
+  // the same way.
+  absl::StatusOr<std::vector<Word>> RunWords(absl::Span<const Word> inputs);
+
+  // Evaluates an arbitrary number of input vectors. Bit i of each element of
+  // "inputs" is the value of Module::inputs()[i]; bit i of each returned
+  // element is the value of Module::outputs()[i].
+  absl::StatusOr<std::vector<Bits>> RunBatch(absl::Span<const Bits> inputs);
+
+  const rtl::Module* module() const { return module_; }
+
+  // Returns the number of value slots (nets across all inlined module
+  // instances) and the number of compiled ops, respectively.
+  int64 slot_count() const { return values_.size(); }
+  int64 op_count() const { return ops_.size(); }
+
+ private:
+  // The compiled program is a flat list of these, evaluated against a small
+  // value stack.
+  enum class OpCode : uint8 {
+    kPushSlot,
+    kPushZero,
+    kPushOne,
+    kAnd,
+    kOr,
+    kXor,
+    kNot,
+    kStoreSlot,
+  };
+  struct Op {
+    OpCode code;
+    // Slot index; only meaningful for kPushSlot and kStoreSlot.
+    int32 slot;
+  };
+
+  // Slots 0 and 1 always hold the all-zeros and all-ones words; every module
+  // instance's constant nets are mapped onto them.
+  static constexpr int32 kZeroSlot = 0;
+  static constexpr int32 kOneSlot = 1;
+
+  using SlotMap = absl::flat_hash_map<rtl::NetRef, int32>;
+
+  BitParallelInterpreter(const rtl::Netlist* netlist,
+                         const rtl::Module* module);
+
+  int32 AllocateSlot();
+
+  // Appends the ops to evaluate one instance of "module" to the program.
+  // "slots" holds any pre-assigned slots (e.g., a submodule's inputs and
+  // outputs, which alias nets in the instantiating module); all other nets in
+  // the module are given fresh slots.
+  absl::Status CompileModule(const rtl::Module* module, SlotMap slots);
+
+  absl::Status CompileCell(const rtl::Cell& cell, const SlotMap& slots);
+
+  absl::Status CompileFunction(const rtl::Cell& cell, const function::Ast& ast,
+                               const SlotMap& slots);
+
+  // Lowers a (combinational) state table lookup for the given internal pin to
+  // a sum of products over the cell's inputs.
+  absl::Status CompileStateTable(const rtl::Cell& cell,
+                                 const std::string& pin_name,
+                                 const SlotMap& slots);
+
+  // Returns the parsed AST for the given function string, parsing it on first
+  // use.
+  absl::StatusOr<const function::Ast*> GetAst(const std::string& function);
+
+  void Emit(OpCode code, int32 slot = 0);
+
+  const rtl::Netlist* netlist_;
+  const rtl::Module* module_;
+
+  std::vector<Op> ops_;
+  std::vector<Word> values_;
+  std::vector<Word> stack_;
+
+  // Stack depth at the current point of compilation, and the maximum depth
+  // reached by the program (used to size stack_).
+  int64 stack_depth_ = 0;
+  int64 max_stack_depth_ = 0;
+
+  std::vector<int32> input_slots_;
+  std::vector<int32> output_slots_;
+
+  absl::flat_hash_map<std::string, std::unique_ptr<function::Ast>> ast_cache_;
+};
+
+}  // namespace netlist
+}  // namespace xls
+
+#endif  // XLS_NETLIST_BIT_PARALLEL_INTERPRETER_H_
@@ -0,0 +1,226 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "xls/netlist/bit_parallel_interpreter.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/container/flat_hash_map.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/bits.h"
+#include "xls/netlist/fake_cell_library.h"
+#include "xls/netlist/interpreter.h"
+#include "xls/netlist/netlist.h"
+#include "xls/netlist/netlist_parser.h"
+
+namespace xls {
+namespace netlist {
+namespace {
+
+using status_testing::StatusIs;
+
+// Evaluates every possible input vector of the given module with both the
+// reference Interpreter and the BitParallelInterpreter and checks that they
+// agree.
+void ExpectMatchesInterpreter(rtl::Netlist* netlist,
+                              const rtl::Module* module) {
+  const int64 input_count = module->inputs().size();
+  ASSERT_LE(input_count, 16);
+
+  std::vector<Bits> vectors;
+  for (uint64 i = 0; i < (uint64{1} << input_count); ++i) {
+    vectors.push_back(UBits(i, input_count));
+  }
+
+  XLS_ASSERT_OK_AND_ASSIGN(auto bit_parallel,
+                           BitParallelInterpreter::Create(netlist, module));
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<Bits> results,
+                           bit_parallel->RunBatch(vectors));
+  ASSERT_EQ(results.size(), vectors.size());
+
+  Interpreter interpreter(netlist);
+  for (int64 v = 0; v < vectors.size(); ++v) {
+    absl::flat_hash_map<const rtl::NetRef, bool> inputs;
+    for (int64 i = 0; i < input_count; ++i) {
+      inputs[module->inputs()[i]] = vectors[v].Get(i);
+    }
+    using OutputT = absl::flat_hash_map<const rtl::NetRef, bool>;
+    XLS_ASSERT_OK_AND_ASSIGN(OutputT outputs,
+                             interpreter.InterpretModule(module, inputs));
+    for (int64 i = 0; i < module->outputs().size(); ++i) {
+      EXPECT_EQ(results[v].Get(i), outputs.at(module->outputs()[i]))
+          << "vector " << vectors[v] << ", output "
+          << module->outputs()[i]->name();
+    }
+  }
+}
+
+TEST(BitParallelInterpreterTest, Tree) {
+  std::string module_text = R"(
+module main (i0, i1, i2, i3, o0, o1);
+  input i0, i1, i2, i3;
+  output o0, o1;
+  wire and_o, or_o;
+
+  AND and0 ( .A(i0), .B(i1), .Z(and_o) );
+  OR or0 ( .A(i2), .B(i3), .Z(or_o) );
+  XOR xor0 ( .A(and_o), .B(or_o), .Z(o0) );
+  AOI21 aoi0 ( .A(i0), .B(or_o), .C(i3), .ZN(o1) );
+endmodule
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(CellLibrary cell_library, MakeFakeCellLibrary());
+  rtl::Scanner scanner(module_text);
+  XLS_ASSERT_OK_AND_ASSIGN(auto netlist,
+                           rtl::Parser::ParseNetlist(&cell_library, &scanner));
+  XLS_ASSERT_OK_AND_ASSIGN(const rtl::Module* module,
+                           netlist->GetModule("main"));
+  ExpectMatchesInterpreter(netlist.get(), module);
+}
+
+TEST(BitParallelInterpreterTest, RunWords) {
+  std::string module_text = R"(
+module main (a, b, o);
+  input a, b;
+  output o;
+
+  NAND nand0 ( .A(a), .B(b), .ZN(o) );
+endmodule
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(CellLibrary cell_library, MakeFakeCellLibrary());
+  rtl::Scanner scanner(module_text);
+  XLS_ASSERT_OK_AND_ASSIGN(auto netlist,
+                           rtl::Parser::ParseNetlist(&cell_library, &scanner));
+  XLS_ASSERT_OK_AND_ASSIGN(const rtl::Module* module,
+                           netlist->GetModule("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(auto interpreter,
+                           BitParallelInterpreter::Create(netlist.get(), module));
+
+  const uint64 a = 0xF0F0F0F0F0F0F0F0ULL;
+  const uint64 b = 0xFF00FF00FF00FF00ULL;
+  XLS_ASSERT_OK_AND_ASSIGN(std::vector<uint64> outputs,
+                           interpreter->RunWords({a, b}));
+  ASSERT_EQ(outputs.size(), 1);
+  EXPECT_EQ(outputs[0], ~(a & b));
+
+  EXPECT_THAT(interpreter->RunWords({a}),
+              StatusIs(absl::StatusCode::kInternal));
+}
+
+TEST(BitParallelInterpreterTest, Submodules) {
+  std::string module_text = R"(
+module submodule_0 (i2_0, i2_1, o2_0);
+  input i2_0, i2_1;
+  output o2_0;
+
+  AND and0( .A(i2_0), .B(i2_1), .Z(o2_0) );
+endmodule
+
+module submodule_1 (i2_2, i2_3, o2_1);
+  input i2_2, i2_3;
+  output o2_1;
+
+  OR or0( .A(i2_2), .B(i2_3), .Z(o2_1) );
+endmodule
+
+module submodule_2 (i1_0, i1_1, i1_2, i1_3, o1_0);
+  input i1_0, i1_1, i1_2, i1_3;
+  output o1_0;
+  wire res0, res1;
+
+  submodule_0 and0 ( .i2_0(i1_0), .i2_1(i1_1), .o2_0(res0) );
+  submodule_1 or0 ( .i2_2(i1_2), .i2_3(i1_3), .o2_1(res1) );
+  XOR xor0 ( .A(res0), .B(res1), .Z(o1_0) );
+endmodule
+
+module main (i0, i1, i2, i3, o0, o1);
+  input i0, i1, i2, i3;
+  output o0, o1;
+
+  submodule_2 bleh( .i1_0(i0), .i1_1(i1), .i1_2(i2), .i1_3(i3), .o1_0(o0) );
+  submodule_2 blah( .i1_0(i3), .i1_1(i2), .i1_2(i1), .i1_3(i0), .o1_0(o1) );
+endmodule
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(CellLibrary cell_library, MakeFakeCellLibrary());
+  rtl::Scanner scanner(module_text);
+  XLS_ASSERT_OK_AND_ASSIGN(auto netlist,
+                           rtl::Parser::ParseNetlist(&cell_library, &scanner));
+  XLS_ASSERT_OK_AND_ASSIGN(const rtl::Module* module,
+                           netlist->GetModule("main"));
+  ExpectMatchesInterpreter(netlist.get(), module);
+}
+
+TEST(BitParallelInterpreterTest, StateTables) {
+  std::string module_text = R"(
+module main(i0, i1, i2, i3, o0);
+  input i0, i1, i2, i3;
+  output o0;
+  wire and0_out, and1_out;
+
+  AND and0 ( .A(i0), .B(i1), .Z(and0_out) );
+  STATETABLE_AND and1 (.A(i2), .B(i3), .Z(and1_out) );
+  AND and2 ( .A(and0_out), .B(and1_out), .Z(o0) );
+endmodule
+  )";
+
+  XLS_ASSERT_OK_AND_ASSIGN(CellLibrary cell_library, MakeFakeCellLibrary());
+  rtl::Scanner scanner(module_text);
+  XLS_ASSERT_OK_AND_ASSIGN(auto netlist,
+                           rtl::Parser::ParseNetlist(&cell_library, &scanner));
+  XLS_ASSERT_OK_AND_ASSIGN(const rtl::Module* module,
+                           netlist->GetModule("main"));
+  ExpectMatchesInterpreter(netlist.get(), module);
+}
+
+// Verifies that batches which don't fill a whole word, and batches spanning
+// several words, are handled correctly.
+TEST(BitParallelInterpreterTest, PartialAndMultiWordBatches) {
+  std::string module_text = R"(
+module main (a, b, c, d, o);
+  input a, b, c, d;
+  output o;
+  wire n;
+
+  NOR4 nor0 ( .A(a), .B(b), .C(c), .D(d), .ZN(n) );
+  INV inv0 ( .A(n), .ZN(o) );
+endmodule
+)";
+
+  XLS_ASSERT_OK_AND_ASSIGN(CellLibrary cell_library, MakeFakeCellLibrary());
+  rtl::Scanner scanner(module_text);
+  XLS_ASSERT_OK_AND_ASSIGN(auto netlist,
+                           rtl::Parser::ParseNetlist(&cell_library, &scanner));
+  XLS_ASSERT_OK_AND_ASSIGN(const rtl::Module* module,
+                           netlist->GetModule("main"));
+  XLS_ASSERT_OK_AND_ASSIGN(auto interpreter,
+                           BitParallelInterpreter::Create(netlist.get(), module));
+
+  for (int64 count : {0, 1, 63, 64, 65, 200}) {
+    std::vector<Bits> vectors;
+    for (int64 i = 0; i < count; ++i) {
+      vectors.push_back(UBits(i % 16, 4));
+    }
+    XLS_ASSERT_OK_AND_ASSIGN(std::vector<Bits> results,
+                             interpreter->RunBatch(vectors));
+    ASSERT_EQ(results.size(), count);
+    for (int64 i = 0; i < count; ++i) {
+      EXPECT_EQ(results[i], UBits(i % 16 != 0, 1)) << "vector " << i;
+    }
+  }
+}
+
+}  // namespace
+}  // namespace netlist
+}  // namespace xls
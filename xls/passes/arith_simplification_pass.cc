@@ -18,7 +18,6 @@
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/ir/bits_ops.h"
-#include "xls/ir/node_iterator.h"
 #include "xls/ir/node_util.h"
 #include "xls/ir/nodes.h"
 #include "xls/ir/value_helpers.h"
@@ -583,15 +582,9 @@ absl::StatusOr<bool> MatchArithPatterns(Node* n) {
 
 }  // namespace
 
-absl::StatusOr<bool> ArithSimplificationPass::RunOnFunction(
-    Function* f, const PassOptions& options, PassResults* results) const {
-  bool modified = false;
-  bool local_modified = false;
-  for (Node* node : TopoSort(f)) {
-    XLS_ASSIGN_OR_RETURN(local_modified, MatchArithPatterns(node));
-    modified |= local_modified;
-  }
-  return modified;
+absl::StatusOr<bool> ArithSimplificationPass::RewriteNode(
+    Node* node, const PassOptions& options) const {
+  return MatchArithPatterns(node);
 }
 
 }  // namespace xls
@@ -16,22 +16,22 @@
 #define XLS_PASSES_ARITH_SIMPLIFICATION_PASS_H_
 
 #include "absl/status/statusor.h"
-#include "xls/ir/function.h"
-#include "xls/passes/passes.h"
+#include "xls/ir/node.h"
+#include "xls/passes/node_rewrite_pass.h"
 
 namespace xls {
 
 // class ArithSimplificationPass analyzes the IR and finds some
 // simple patterns it can simplify, e.g., things like mul by 1,
 // add of 0, etc.
-class ArithSimplificationPass : public FunctionPass {
+class ArithSimplificationPass : public NodeRewritePass {
  public:
   ArithSimplificationPass()
-      : FunctionPass("arith_simp", "Arithmetic Simplifications") {}
+      : NodeRewritePass("arith_simp", "Arithmetic Simplifications") {}
   ~ArithSimplificationPass() override {}
 
-  absl::StatusOr<bool> RunOnFunction(Function* f, const PassOptions& options,
-                                     PassResults* results) const override;
+  absl::StatusOr<bool> RewriteNode(Node* node,
+                                   const PassOptions& options) const override;
 };
 
 }  // namespace xls
@@ -16,7 +16,6 @@
 
 #include "xls/ir/bits_ops.h"
 #include "xls/ir/node.h"
-#include "xls/ir/node_iterator.h"
 #include "xls/ir/nodes.h"
 #include "xls/ir/type.h"
 #include "xls/ir/value_helpers.h"
@@ -88,25 +87,12 @@ absl::StatusOr<bool> SimplifyArrayIndex(ArrayIndex* node) {
 }
 }  // namespace
 
-absl::StatusOr<bool> ArraySimplificationPass::RunOnFunction(
-    Function* func, const PassOptions& options, PassResults* results) const {
-  XLS_VLOG(2) << "Running array simplifier on function " << func->name();
-  XLS_VLOG(3) << "Before:";
-  XLS_VLOG_LINES(3, func->DumpIr());
-
-  bool changed = false;
-  for (Node* node : TopoSort(func)) {
-    if (node->Is<ArrayIndex>()) {
-      XLS_ASSIGN_OR_RETURN(bool node_changed,
-                           SimplifyArrayIndex(node->As<ArrayIndex>()));
-      changed = changed | node_changed;
-    }
+absl::StatusOr<bool> ArraySimplificationPass::RewriteNode(
+    Node* node, const PassOptions& options) const {
+  if (node->Is<ArrayIndex>()) {
+    return SimplifyArrayIndex(node->As<ArrayIndex>());
   }
-
-  XLS_VLOG(3) << "After:";
-  XLS_VLOG_LINES(3, func->DumpIr());
-
-  return changed;
+  return false;
 }
 
 }  // namespace xls
@@ -16,20 +16,20 @@
 #define XLS_PASSES_ARRAY_SIMPLIFICATION_H_
 
 #include "absl/status/statusor.h"
-#include "xls/ir/function.h"
-#include "xls/passes/passes.h"
+#include "xls/ir/node.h"
+#include "xls/passes/node_rewrite_pass.h"
 
 namespace xls {
 
 // Pass which simplifies or eliminates some array-type operations such as
 // ArrayIndex.
-class ArraySimplificationPass : public FunctionPass {
+class ArraySimplificationPass : public NodeRewritePass {
  public:
   ArraySimplificationPass()
-      : FunctionPass("array_simp", "Array Simplification") {}
+      : NodeRewritePass("array_simp", "Array Simplification") {}
 
-  absl::StatusOr<bool> RunOnFunction(Function* f, const PassOptions& options,
-                                     PassResults* results) const override;
+  absl::StatusOr<bool> RewriteNode(Node* node,
+                                   const PassOptions& options) const override;
 };
 
 }  // namespace xls
@@ -44,6 +44,11 @@ namespace {
 // minterms in the computed expression exceed some limit. Any logical operation
 // performed with a TooManyMinterms value produces a TooManyMinterms value.
 struct TooManyMinterms {};
+
+// Number of BDD nodes at which the first garbage collection is performed while
+// constructing the BDD. Subsequent collections happen when the BDD has doubled
+// in size since the previous one.
+constexpr int64 kInitialGcThreshold = 1 << 16;
 using SaturatingBddNodeIndex = absl::variant<BddNodeIndex, TooManyMinterms>;
 using SaturatingBddNodeVector = std::vector<SaturatingBddNodeIndex>;
 
@@ -264,6 +269,7 @@ bool ShouldEvaluate(Node* node) {
 
   XLS_VLOG(3) << "BDD expressions:";
   absl::flat_hash_map<Node*, SaturatingBddNodeVector> values;
+  int64 gc_threshold = kInitialGcThreshold;
   for (Node* node : TopoSort(f)) {
     if (!node->GetType()->IsBits()) {
       continue;
@@ -302,6 +308,21 @@ bool ShouldEvaluate(Node* node) {
               absl::get<BddNodeIndex>(values.at(node)[i]),
               /*minterm_limit=*/15));
     }
+
+    // Intermediate expressions created while evaluating the nodes so far (e.g.,
+    // expressions which exceeded the minterm limit) are garbage; only the
+    // values of the nodes are needed from here on.
+    if (bdd_function->bdd().size() > gc_threshold) {
+      std::vector<BddNodeIndex> roots;
+      for (const auto& pair : values) {
+        for (const SaturatingBddNodeIndex& value : pair.second) {
+          roots.push_back(absl::get<BddNodeIndex>(value));
+        }
+      }
+      bdd_function->bdd().GarbageCollect(roots);
+      gc_threshold =
+          std::max(kInitialGcThreshold, 2 * bdd_function->bdd().size());
+    }
   }
 
   // Copy over the vector and BDD variables into the node map which is exposed
@@ -93,7 +93,7 @@ class BddQueryEngine : public QueryEngine {
   // the result of the query.
   bool ExceedsMintermLimit(BddNodeIndex node) const {
     return minterm_limit_ > 0 &&
-           bdd().GetNode(node).minterm_count > minterm_limit_;
+           bdd().minterm_count(node) > minterm_limit_;
   }
 
   // The maximum number of minterms in expression in the BDD before truncating.
@@ -18,7 +18,6 @@
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
-#include "xls/ir/node_iterator.h"
 
 namespace xls {
 
@@ -120,14 +119,9 @@ absl::StatusOr<bool> CanonicalizeNodes(Node* n, Function* f) {
   return false;
 }
 
-absl::StatusOr<bool> CanonicalizationPass::RunOnFunction(
-    Function* func, const PassOptions& options, PassResults* results) const {
-  bool changed = false;
-  for (Node* node : TopoSort(func)) {
-    XLS_ASSIGN_OR_RETURN(bool node_changed, CanonicalizeNodes(node, func));
-    changed = changed | node_changed;
-  }
-  return changed;
+absl::StatusOr<bool> CanonicalizationPass::RewriteNode(
+    Node* node, const PassOptions& options) const {
+  return CanonicalizeNodes(node, node->function());
 }
 
 }  // namespace xls
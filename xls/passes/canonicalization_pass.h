@@ -18,8 +18,8 @@
 #define XLS_PASSES_CANONICALIZATION_PASS_H_
 
 #include "absl/status/statusor.h"
-#include "xls/ir/function.h"
-#include "xls/passes/passes.h"
+#include "xls/ir/node.h"
+#include "xls/passes/node_rewrite_pass.h"
 
 namespace xls {
 
@@ -28,13 +28,14 @@ namespace xls {
 // between a node and a literal, the literal should only be the
 // 2nd operand. This preprocessing of the IR helps to simplify
 // later passes.
-class CanonicalizationPass : public FunctionPass {
+class CanonicalizationPass : public NodeRewritePass {
  public:
-  explicit CanonicalizationPass() : FunctionPass("canon", "Canonicalization") {}
+  explicit CanonicalizationPass()
+      : NodeRewritePass("canon", "Canonicalization") {}
   ~CanonicalizationPass() override {}
 
-  absl::StatusOr<bool> RunOnFunction(Function* f, const PassOptions& options,
-                                     PassResults* results) const override;
+  absl::StatusOr<bool> RewriteNode(Node* node,
+                                   const PassOptions& options) const override;
 };
 
 }  // namespace xls
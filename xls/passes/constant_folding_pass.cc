@@ -17,34 +17,23 @@
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/interpreter/ir_interpreter.h"
-#include "xls/ir/node_iterator.h"
 
 namespace xls {
 
-absl::StatusOr<bool> ConstantFoldingPass::RunOnFunction(
-    Function* f, const PassOptions& options, PassResults* results) const {
-  XLS_VLOG(2) << "Running constant folding on function " << f->name();
-  XLS_VLOG(3) << "Before:";
-  XLS_VLOG_LINES(3, f->DumpIr());
-  bool changed = false;
-  for (Node* node : TopoSort(f)) {
-    // TODO(meheff): 2019/6/26 Consider not folding loops with large trip counts
-    // to avoid hanging at compile time.
-    if (node->operand_count() > 0 &&
-        std::all_of(node->operands().begin(), node->operands().end(),
-                    [](Node* o) { return o->Is<Literal>(); })) {
-      XLS_VLOG(2) << "Folding: " << *node;
-      XLS_ASSIGN_OR_RETURN(
-          Value result, IrInterpreter::EvaluateNodeWithLiteralOperands(node));
-      XLS_RETURN_IF_ERROR(node->ReplaceUsesWithNew<Literal>(result).status());
-      changed = true;
-    }
+absl::StatusOr<bool> ConstantFoldingPass::RewriteNode(
+    Node* node, const PassOptions& options) const {
+  // TODO(meheff): 2019/6/26 Consider not folding loops with large trip counts
+  // to avoid hanging at compile time.
+  if (node->operand_count() > 0 &&
+      std::all_of(node->operands().begin(), node->operands().end(),
+                  [](Node* o) { return o->Is<Literal>(); })) {
+    XLS_VLOG(2) << "Folding: " << *node;
+    XLS_ASSIGN_OR_RETURN(Value result,
+                         IrInterpreter::EvaluateNodeWithLiteralOperands(node));
+    XLS_RETURN_IF_ERROR(node->ReplaceUsesWithNew<Literal>(result).status());
+    return true;
   }
-
-  XLS_VLOG(3) << "After:";
-  XLS_VLOG_LINES(3, f->DumpIr());
-
-  return changed;
+  return false;
 }
 
 }  // namespace xls
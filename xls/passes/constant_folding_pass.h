@@ -16,20 +16,23 @@
 #define XLS_PASSES_CONSTANT_FOLDING_PASS_H_
 
 #include "absl/status/statusor.h"
-#include "xls/ir/function.h"
-#include "xls/passes/passes.h"
+#include "xls/ir/node.h"
+#include "xls/passes/node_rewrite_pass.h"
 
 namespace xls {
 
 // Pass which performs constant folding. Every op with only literal operands is
 // replaced by a equivalent literal. Runs DCE after constant folding.
-class ConstantFoldingPass : public FunctionPass {
+class ConstantFoldingPass : public NodeRewritePass {
  public:
-  ConstantFoldingPass() : FunctionPass("const_fold", "Constant folding") {}
+  ConstantFoldingPass() : NodeRewritePass("const_fold", "Constant folding") {}
   ~ConstantFoldingPass() override {}
 
-  absl::StatusOr<bool> RunOnFunction(Function* f, const PassOptions& options,
-                                     PassResults* results) const override;
+  absl::StatusOr<bool> RewriteNode(Node* node,
+                                   const PassOptions& options) const override;
+
+  // Folding an invoke, map or counted_for interprets the called function.
+  bool IsFunctionLocal() const override { return false; }
 };
 
 }  // namespace xls
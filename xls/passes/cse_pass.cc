@@ -14,50 +14,118 @@
 
 #include "xls/passes/cse_pass.h"
 
+#include <algorithm>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/inlined_vector.h"
 #include "absl/hash/hash.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/ir/node_iterator.h"
+#include "xls/ir/nodes.h"
 
 namespace xls {
+namespace {
+
+// Returns whether the operands of 'a' and 'b' are the same, up to a
+// permutation if the op is commutative.
+bool SameOperands(const Node* a, const Node* b) {
+  if (a->operands() == b->operands()) {
+    return true;
+  }
+  if (!OpIsCommutative(a->op()) || a->operand_count() != b->operand_count()) {
+    return false;
+  }
+  if (a->operand_count() == 2) {
+    return a->operand(0) == b->operand(1) && a->operand(1) == b->operand(0);
+  }
+  absl::InlinedVector<Node*, 8> a_operands(a->operands().begin(),
+                                           a->operands().end());
+  absl::InlinedVector<Node*, 8> b_operands(b->operands().begin(),
+                                           b->operands().end());
+  std::sort(a_operands.begin(), a_operands.end());
+  std::sort(b_operands.begin(), b_operands.end());
+  return a_operands == b_operands;
+}
+
+// Key of the value-numbering table. Two keys are equal if the nodes compute
+// the same value: they have the same op, attributes and types (as determined
+// by Node::IsDefinitelyEqualTo) and the same operands. The hash covers the op,
+// the operands (in canonical order for commutative ops) and the attributes
+// which distinguish nodes with the same operands, such as literal values and
+// slice bounds. The type is not hashed as it is implied by the rest in nearly
+// all cases.
+struct ValueNumberKey {
+  Node* node;
+
+  bool operator==(const ValueNumberKey& other) const {
+    return SameOperands(node, other.node) &&
+           node->IsDefinitelyEqualTo(other.node);
+  }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const ValueNumberKey& key) {
+    Node* node = key.node;
+    h = H::combine(std::move(h), node->op(), node->operand_count());
+    if (OpIsCommutative(node->op())) {
+      // Combine the operands in an order-independent manner.
+      uint64 operand_hash = 0;
+      for (Node* operand : node->operands()) {
+        operand_hash += absl::Hash<int64>()(operand->id());
+      }
+      h = H::combine(std::move(h), operand_hash);
+    } else {
+      for (Node* operand : node->operands()) {
+        h = H::combine(std::move(h), operand->id());
+      }
+    }
+    switch (node->op()) {
+      case Op::kLiteral:
+        return H::combine(std::move(h), node->As<Literal>()->value());
+      case Op::kBitSlice:
+        return H::combine(std::move(h), node->As<BitSlice>()->start(),
+                          node->As<BitSlice>()->width());
+      case Op::kDynamicBitSlice:
+        return H::combine(std::move(h), node->As<DynamicBitSlice>()->width());
+      case Op::kSignExt:
+      case Op::kZeroExt:
+        return H::combine(std::move(h),
+                          node->As<ExtendOp>()->new_bit_count());
+      case Op::kTupleIndex:
+        return H::combine(std::move(h), node->As<TupleIndex>()->index());
+      case Op::kDecode:
+        return H::combine(std::move(h), node->As<Decode>()->width());
+      case Op::kOneHot:
+        return H::combine(std::move(h), node->As<OneHot>()->priority());
+      case Op::kCountedFor:
+        return H::combine(std::move(h), node->As<CountedFor>()->trip_count(),
+                          node->As<CountedFor>()->stride());
+      default:
+        return h;
+    }
+  }
+};
+
+}  // namespace
 
 absl::StatusOr<bool> CsePass::RunOnFunction(Function* f,
                                             const PassOptions& options,
                                             PassResults* results) const {
-  // To improve efficiency, bucket potentially common nodes together. The
-  // bucketing is done via an int64 hash value which is constructed from the
-  // op() of the node and the uid's of the node's operands.
-  auto hasher = absl::Hash<std::vector<int64>>();
-  auto node_hash = [&](Node* n) {
-    std::vector<int64> values_to_hash = {static_cast<int64>(n->op())};
-    for (Node* operand : n->operands()) {
-      values_to_hash.push_back(operand->id());
-    }
-    // If this is slow because of many literals, the Literal values could be
-    // combined into the hash. As is, all literals get the same hash value.
-    return hasher(values_to_hash);
-  };
+  // Single-pass global value numbering. Nodes are visited in topological order
+  // so the operands of each node have already been replaced by their
+  // representatives, which makes structurally equal expressions of any size
+  // have identical operands at each level.
   bool changed = false;
-  absl::flat_hash_map<int64, std::vector<Node*>> node_buckets;
-  node_buckets.reserve(f->node_count());
+  absl::flat_hash_set<ValueNumberKey> representatives;
+  representatives.reserve(f->node_count());
   for (Node* node : TopoSort(f)) {
-    int64 hash = node_hash(node);
-    if (!node_buckets.contains(hash)) {
-      node_buckets[hash].push_back(node);
+    // Parameters have unique names so are never equal to each other.
+    if (node->Is<Param>()) {
       continue;
     }
-    bool replaced = false;
-    for (Node* candidate : node_buckets.at(hash)) {
-      if (node->operands() == candidate->operands() &&
-          node->IsDefinitelyEqualTo(candidate)) {
-        XLS_ASSIGN_OR_RETURN(bool node_changed,
-                             node->ReplaceUsesWith(candidate));
-        changed |= node_changed;
-        replaced = true;
-        break;
-      }
-    }
-    if (!replaced) {
-      node_buckets[hash].push_back(node);
+    auto [it, inserted] = representatives.insert(ValueNumberKey{node});
+    if (!inserted) {
+      XLS_ASSIGN_OR_RETURN(bool node_changed, node->ReplaceUsesWith(it->node));
+      changed |= node_changed;
     }
   }
 
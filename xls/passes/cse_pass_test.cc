@@ -20,6 +20,7 @@
 #include "xls/common/status/matchers.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/ir/function.h"
+#include "xls/ir/function_builder.h"
 #include "xls/ir/ir_test_base.h"
 #include "xls/ir/package.h"
 #include "xls/passes/dce_pass.h"
@@ -175,5 +176,73 @@ fn main(x: bits[11]) -> (bits[11], bits[11], bits[11]) {
             entry->DumpIr());
 }
 
+TEST_F(CsePassTest, CommutativeOperands) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+     fn commutative(x: bits[8], y: bits[8], z: bits[8]) -> (bits[8], bits[8], bits[8], bits[8], bits[1], bits[1], bits[8], bits[8]) {
+        add.1: bits[8] = add(x, y)
+        add.2: bits[8] = add(y, x)
+        and.3: bits[8] = and(x, y, z)
+        and.4: bits[8] = and(z, x, y)
+        sub.5: bits[8] = sub(x, y)
+        sub.6: bits[8] = sub(y, x)
+        eq.7: bits[1] = eq(x, z)
+        eq.8: bits[1] = eq(z, x)
+        ret tuple.9: (bits[8], bits[8], bits[8], bits[8], bits[1], bits[1], bits[8], bits[8]) = tuple(add.1, add.2, and.3, and.4, eq.7, eq.8, sub.5, sub.6)
+     }
+  )",
+                                                       p.get()));
+  EXPECT_THAT(Run(f), IsOkAndHolds(true));
+  Node* ret = f->return_value();
+  EXPECT_EQ(ret->operand(0), ret->operand(1));
+  EXPECT_EQ(ret->operand(2), ret->operand(3));
+  EXPECT_EQ(ret->operand(4), ret->operand(5));
+  // Subtraction is not commutative.
+  EXPECT_NE(ret->operand(6), ret->operand(7));
+}
+
+TEST_F(CsePassTest, ManyLiterals) {
+  // Only literals with equal values (and types) are commoned.
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  std::vector<BValue> elements;
+  for (int64 i = 0; i < 100; ++i) {
+    elements.push_back(fb.Literal(UBits(i % 10, 8)));
+    elements.push_back(fb.Literal(UBits(i % 10, 16)));
+  }
+  elements.push_back(fb.Literal(Value::Tuple({Value(UBits(1, 8))})));
+  elements.push_back(fb.Literal(Value::Tuple({Value(UBits(1, 8))})));
+  elements.push_back(fb.Literal(Value::Tuple({Value(UBits(2, 8))})));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.BuildWithReturnValue(
+                                             fb.Tuple(elements)));
+  EXPECT_THAT(Run(f), IsOkAndHolds(true));
+  // Ten values of each of two widths, two distinct tuples and the return
+  // value.
+  EXPECT_EQ(f->node_count(), 23);
+}
+
+TEST_F(CsePassTest, SlicesAndExtensions) {
+  auto p = CreatePackage();
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, ParseFunction(R"(
+     fn slices(x: bits[8]) -> (bits[4], bits[4], bits[4], bits[16], bits[16], bits[16]) {
+        bit_slice.1: bits[4] = bit_slice(x, start=0, width=4)
+        bit_slice.2: bits[4] = bit_slice(x, start=4, width=4)
+        bit_slice.3: bits[4] = bit_slice(x, start=0, width=4)
+        zero_ext.4: bits[16] = zero_ext(x, new_bit_count=16)
+        sign_ext.5: bits[16] = sign_ext(x, new_bit_count=16)
+        zero_ext.6: bits[16] = zero_ext(x, new_bit_count=16)
+        ret tuple.7: (bits[4], bits[4], bits[4], bits[16], bits[16], bits[16]) = tuple(bit_slice.1, bit_slice.2, bit_slice.3, zero_ext.4, sign_ext.5, zero_ext.6)
+     }
+  )",
+                                                       p.get()));
+  EXPECT_THAT(Run(f), IsOkAndHolds(true));
+  Node* ret = f->return_value();
+  EXPECT_EQ(ret->operand(0), ret->operand(2));
+  EXPECT_NE(ret->operand(0), ret->operand(1));
+  EXPECT_EQ(ret->operand(3), ret->operand(5));
+  EXPECT_NE(ret->operand(3), ret->operand(4));
+  EXPECT_EQ(f->node_count(), 6);
+}
+
 }  // namespace
 }  // namespace xls
@@ -29,6 +29,9 @@ class MapInliningPass : public FunctionPass {
                                      const PassOptions& options,
                                      PassResults* results) const override;
 
+  // Creates invokes of the mapped functions, which inspects their signatures.
+  bool IsFunctionLocal() const override { return false; }
+
  private:
   // Replaces a single Map node with a CountedFor operation.
   absl::Status ReplaceMap(Map* map) const;
@@ -0,0 +1,176 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/passes/node_rewrite_pass.h"
+
+#include <algorithm>
+#include <deque>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/node_iterator.h"
+
+namespace xls {
+
+absl::StatusOr<bool> NodeRewritePass::RunOnFunction(
+    Function* f, const PassOptions& options, PassResults* results) const {
+  XLS_VLOG(2) << "Running " << long_name() << " on function " << f->name();
+  XLS_VLOG(3) << "Before:";
+  XLS_VLOG_LINES(3, f->DumpIr());
+
+  bool changed = false;
+  for (Node* node : TopoSort(f)) {
+    XLS_ASSIGN_OR_RETURN(bool node_changed, RewriteNode(node, options));
+    changed |= node_changed;
+  }
+
+  XLS_VLOG(3) << "After:";
+  XLS_VLOG_LINES(3, f->DumpIr());
+  return changed;
+}
+
+absl::StatusOr<bool> NodeRewriteDriverPass::RunOnFunction(
+    Function* f, const PassOptions& options, PassResults* results) const {
+  std::vector<const NodeRewritePass*> rules;
+  for (const auto& rule : rules_) {
+    if (std::find(options.skip_passes.begin(), options.skip_passes.end(),
+                  rule->short_name()) == options.skip_passes.end()) {
+      rules.push_back(rule.get());
+    }
+  }
+
+  XLS_VLOG(2) << "Running " << long_name() << " on function " << f->name();
+  XLS_VLOG(3) << "Before:";
+  XLS_VLOG_LINES(3, f->DumpIr());
+
+  // Nodes are removed from 'on_worklist' when popped or deleted, so entries of
+  // 'worklist' which aren't in 'on_worklist' are stale and skipped.
+  std::deque<Node*> worklist;
+  absl::flat_hash_set<Node*> on_worklist;
+  auto enqueue = [&](Node* node) {
+    if (on_worklist.insert(node).second) {
+      worklist.push_back(node);
+    }
+  };
+  for (Node* node : TopoSort(f)) {
+    enqueue(node);
+  }
+
+  bool changed = false;
+  int64 removed_count = 0;
+  absl::flat_hash_map<const NodeRewritePass*, int64> rewrite_counts;
+  std::vector<Node*> operands;
+  std::vector<Node*> users;
+  std::vector<Node*> new_nodes;
+  while (!worklist.empty()) {
+    Node* node = worklist.front();
+    worklist.pop_front();
+    if (on_worklist.erase(node) == 0) {
+      continue;
+    }
+
+    if (node->users().empty() && node != f->return_value() &&
+        !node->Is<Param>()) {
+      // The operands may now be dead or have become single-use, which some
+      // rules look for.
+      for (Node* operand : node->operands()) {
+        enqueue(operand);
+      }
+      XLS_RETURN_IF_ERROR(f->RemoveNode(node));
+      ++removed_count;
+      changed = true;
+      continue;
+    }
+
+    operands.assign(node->operands().begin(), node->operands().end());
+    users.assign(node->users().begin(), node->users().end());
+    const int64 first_new_id = f->package()->next_node_id();
+    const NodeRewritePass* applied_rule = nullptr;
+    for (const NodeRewritePass* rule : rules) {
+      XLS_ASSIGN_OR_RETURN(bool rewritten, rule->RewriteNode(node, options));
+      if (rewritten) {
+        applied_rule = rule;
+        break;
+      }
+    }
+    if (applied_rule == nullptr) {
+      continue;
+    }
+    XLS_VLOG(3) << absl::StreamFormat("Rule %s rewrote %s",
+                                      applied_rule->short_name(),
+                                      node->GetName());
+    ++rewrite_counts[applied_rule];
+    changed = true;
+
+    enqueue(node);
+    for (Node* operand : operands) {
+      enqueue(operand);
+    }
+    for (Node* user : users) {
+      enqueue(user);
+    }
+    // Live new nodes are reachable through the operands of the node, of its
+    // former users or of the return value. Only the (few) new nodes need to be
+    // walked to find them, as they have the highest IDs.
+    new_nodes.clear();
+    auto add_new_operands = [&](Node* n) {
+      for (Node* operand : n->operands()) {
+        if (operand->id() >= first_new_id && !on_worklist.contains(operand)) {
+          enqueue(operand);
+          new_nodes.push_back(operand);
+        }
+      }
+    };
+    add_new_operands(node);
+    for (Node* user : users) {
+      add_new_operands(user);
+    }
+    if (f->return_value()->id() >= first_new_id) {
+      enqueue(f->return_value());
+      new_nodes.push_back(f->return_value());
+    }
+    while (!new_nodes.empty()) {
+      Node* new_node = new_nodes.back();
+      new_nodes.pop_back();
+      add_new_operands(new_node);
+      // The existing operands of a new node have gained a user.
+      for (Node* operand : new_node->operands()) {
+        enqueue(operand);
+      }
+    }
+  }
+
+  for (const NodeRewritePass* rule : rules) {
+    XLS_VLOG(2) << absl::StreamFormat("Rule %s rewrote %d nodes",
+                                      rule->short_name(),
+                                      rewrite_counts[rule]);
+  }
+  XLS_VLOG(2) << "Removed " << removed_count << " dead nodes";
+
+  XLS_VLOG(3) << "After:";
+  XLS_VLOG_LINES(3, f->DumpIr());
+  return changed;
+}
+
+bool NodeRewriteDriverPass::IsFunctionLocal() const {
+  return std::all_of(rules_.begin(), rules_.end(),
+                     [](const std::unique_ptr<NodeRewritePass>& rule) {
+                       return rule->IsFunctionLocal();
+                     });
+}
+
+}  // namespace xls
@@ -0,0 +1,92 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_PASSES_NODE_REWRITE_PASS_H_
+#define XLS_PASSES_NODE_REWRITE_PASS_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "xls/ir/function.h"
+#include "xls/ir/node.h"
+#include "xls/passes/passes.h"
+
+namespace xls {
+
+// Abstract base class for function passes which are a local rewrite rule
+// applied to individual nodes. The derived class must define RewriteNode.
+//
+// Run on its own, the pass applies the rule to each node of the function once,
+// in topological order. Rules may also be added to a NodeRewriteDriverPass,
+// which applies several rules together and only revisits the nodes affected by
+// earlier rewrites.
+class NodeRewritePass : public FunctionPass {
+ public:
+  NodeRewritePass(absl::string_view short_name, absl::string_view long_name)
+      : FunctionPass(short_name, long_name) {}
+
+  // Tries to rewrite 'node'. Returns true if the IR was changed. A rule may
+  // modify 'node' itself, replace its uses (e.g., via ReplaceUsesWith) and add
+  // new nodes, but must not remove nodes or modify other existing nodes. The
+  // rule may inspect nodes other than the immediate operands and users of
+  // 'node', but changes to those aren't guaranteed to trigger a revisit by
+  // NodeRewriteDriverPass.
+  virtual absl::StatusOr<bool> RewriteNode(Node* node,
+                                           const PassOptions& options) const = 0;
+
+  absl::StatusOr<bool> RunOnFunction(Function* f, const PassOptions& options,
+                                     PassResults* results) const override;
+};
+
+// Applies a set of NodeRewritePass rules to a function until none of them
+// changes the IR, driven by a worklist. Initially every node is on the
+// worklist; each node is offered to the rules in the order they were added
+// until one rewrites it. After a rewrite only the node, its operands, its
+// former users and any newly created nodes are put back on the worklist,
+// rather than rescanning the whole function. Nodes left without users are
+// removed as they are encountered, so there is no need to interleave
+// DeadCodeEliminationPass between the rules.
+//
+// A rule whose short name is in PassOptions::skip_passes is not applied.
+class NodeRewriteDriverPass : public FunctionPass {
+ public:
+  NodeRewriteDriverPass()
+      : FunctionPass("rewrite", "Worklist-driven node rewriting") {}
+  ~NodeRewriteDriverPass() override {}
+
+  // Adds a rule to the driver. Arguments to method are the arguments to the
+  // rule's constructor. Returns a pointer to the newly constructed rule.
+  template <typename T, typename... Args>
+  T* Add(Args&&... args) {
+    auto* rule = new T(std::forward<Args>(args)...);
+    rules_.emplace_back(rule);
+    return rule;
+  }
+
+  absl::StatusOr<bool> RunOnFunction(Function* f, const PassOptions& options,
+                                     PassResults* results) const override;
+
+  // The driver is function-local only if all of its rules are.
+  bool IsFunctionLocal() const override;
+
+ private:
+  std::vector<std::unique_ptr<NodeRewritePass>> rules_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_PASSES_NODE_REWRITE_PASS_H_
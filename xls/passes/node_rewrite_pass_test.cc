@@ -0,0 +1,154 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/passes/node_rewrite_pass.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/ir/function.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_matcher.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/ir/package.h"
+#include "xls/passes/arith_simplification_pass.h"
+#include "xls/passes/canonicalization_pass.h"
+#include "xls/passes/constant_folding_pass.h"
+#include "xls/passes/tuple_simplification_pass.h"
+
+namespace m = ::xls::op_matchers;
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+
+class NodeRewriteDriverPassTest : public IrTestBase {
+ protected:
+  NodeRewriteDriverPassTest() {
+    driver_.Add<ConstantFoldingPass>();
+    driver_.Add<CanonicalizationPass>();
+    driver_.Add<ArithSimplificationPass>();
+    driver_.Add<TupleSimplificationPass>();
+  }
+
+  absl::StatusOr<bool> Run(Function* f,
+                           const PassOptions& options = PassOptions()) {
+    PassResults results;
+    return driver_.RunOnFunction(f, options, &results);
+  }
+
+  NodeRewriteDriverPass driver_;
+};
+
+TEST_F(NodeRewriteDriverPassTest, NoChange) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  fb.Add(fb.Param("x", p->GetBitsType(8)), fb.Param("y", p->GetBitsType(8)));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  EXPECT_THAT(Run(f), IsOkAndHolds(false));
+  EXPECT_EQ(f->node_count(), 3);
+}
+
+// Each rewrite enables the next: folding the add exposes a subtract of a
+// literal, which is canonicalized to an add of a negated literal, which is then
+// folded.
+TEST_F(NodeRewriteDriverPassTest, ChainOfRewrites) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(8));
+  fb.Subtract(x, fb.Add(fb.Literal(UBits(1, 8)), fb.Literal(UBits(2, 8))));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  EXPECT_THAT(Run(f), IsOkAndHolds(true));
+  EXPECT_THAT(f->return_value(), m::Add(m::Param("x"), m::Literal(253)));
+  // Intermediate nodes are removed.
+  EXPECT_EQ(f->node_count(), 3);
+}
+
+// The tuple_index is replaced by a literal zero, after which its user is an add
+// of zero and removed.
+TEST_F(NodeRewriteDriverPassTest, RewriteExposesUserRewrite) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(8));
+  BValue t = fb.Tuple({x, fb.Literal(UBits(0, 8))});
+  fb.Add(x, fb.TupleIndex(t, 1));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  EXPECT_THAT(Run(f), IsOkAndHolds(true));
+  EXPECT_THAT(f->return_value(), m::Param("x"));
+  EXPECT_EQ(f->node_count(), 1);
+}
+
+// A node is offered to the rules again after it is rewritten in place. Here
+// arith simplification only handles a zero on the right-hand side, which is
+// where canonicalization moves it.
+TEST_F(NodeRewriteDriverPassTest, RevisitsRewrittenNode) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(8));
+  fb.Add(fb.Literal(UBits(0, 8)), x);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  NodeRewriteDriverPass driver;
+  driver.Add<ArithSimplificationPass>();
+  driver.Add<CanonicalizationPass>();
+  PassResults results;
+  EXPECT_THAT(driver.RunOnFunction(f, PassOptions(), &results),
+              IsOkAndHolds(true));
+  EXPECT_THAT(f->return_value(), m::Param("x"));
+}
+
+TEST_F(NodeRewriteDriverPassTest, SkippedRule) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  fb.Add(fb.Literal(UBits(1, 8)), fb.Literal(UBits(2, 8)));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  PassOptions options;
+  options.skip_passes = {"const_fold"};
+  EXPECT_THAT(Run(f, options), IsOkAndHolds(false));
+  EXPECT_THAT(f->return_value(), m::Add(m::Literal(1), m::Literal(2)));
+
+  EXPECT_THAT(Run(f), IsOkAndHolds(true));
+  EXPECT_THAT(f->return_value(), m::Literal(3));
+  EXPECT_EQ(f->node_count(), 1);
+}
+
+// Run standalone, a rule visits each node once in topological order.
+TEST_F(NodeRewriteDriverPassTest, StandaloneRule) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(8));
+  fb.Add(fb.Literal(UBits(0, 8)), x);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+  PassResults results;
+  EXPECT_THAT(
+      ArithSimplificationPass().RunOnFunction(f, PassOptions(), &results),
+      IsOkAndHolds(false));
+  EXPECT_THAT(CanonicalizationPass().RunOnFunction(f, PassOptions(), &results),
+              IsOkAndHolds(true));
+  EXPECT_THAT(f->return_value(), m::Add(m::Param("x"), m::Literal(0)));
+}
+
+// Constant folding looks into called functions, so a driver using it can't run
+// on several functions at once.
+TEST_F(NodeRewriteDriverPassTest, FunctionLocal) {
+  NodeRewriteDriverPass local;
+  local.Add<ArithSimplificationPass>();
+  local.Add<CanonicalizationPass>();
+  EXPECT_TRUE(local.IsFunctionLocal());
+  EXPECT_FALSE(driver_.IsFunctionLocal());
+}
+
+}  // namespace
+}  // namespace xls
@@ -57,6 +57,12 @@ struct PassOptions {
   // both run_only_passes and skip_passes are present, then only passes which
   // are present in run_only_passes and not present in skip_passes will be run.
   std::vector<std::string> skip_passes;
+
+  // Maximum number of threads on which a function-scoped pass may process the
+  // functions of a package concurrently. Values of one or less run passes on
+  // one function at a time. With concurrent execution the result is the same
+  // up to node IDs, which depend on the order in which nodes are created.
+  int64 function_pass_threads = 1;
 };
 
 // An object containing information about the invocation of a pass (single call
@@ -68,7 +74,8 @@ struct PassInvocation {
   // Whether the IR was changed by the pass.
   bool ir_changed;
 
-  // The run duration of the pass.
+  // The run duration (wall time) of the pass. For function-scoped passes run
+  // with multiple threads this is less than the sum of the per-function times.
   absl::Duration run_duration;
 };
 
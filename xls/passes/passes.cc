@@ -14,6 +14,9 @@
 
 #include "xls/passes/passes.h"
 
+#include <atomic>
+#include <thread>
+
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "xls/common/status/status_macros.h"
@@ -22,11 +25,55 @@ namespace xls {
 
 absl::StatusOr<bool> FunctionPass::Run(Package* p, const PassOptions& options,
                                        PassResults* results) const {
-  bool changed = false;
+  const int64 function_count = p->functions().size();
+  const int64 thread_count =
+      std::min(options.function_pass_threads, function_count);
+  if (thread_count <= 1 || !IsFunctionLocal()) {
+    bool changed = false;
+    for (auto& f : p->functions()) {
+      XLS_ASSIGN_OR_RETURN(bool function_changed,
+                           RunOnFunction(f.get(), options, results));
+      changed |= function_changed;
+    }
+    return changed;
+  }
+
+  // Threads take the next unprocessed function until none remain. Each
+  // function gets its own results object, merged in function order afterwards
+  // so that the results (and any error) don't depend on thread scheduling.
+  std::vector<Function*> functions;
   for (auto& f : p->functions()) {
-    XLS_ASSIGN_OR_RETURN(bool function_changed,
-                         RunOnFunction(f.get(), options, results));
-    changed |= function_changed;
+    functions.push_back(f.get());
+  }
+  std::vector<absl::StatusOr<bool>> function_changed(function_count, false);
+  std::vector<PassResults> function_results(function_count);
+  std::atomic<int64> next_function{0};
+  std::atomic<bool> failed{false};
+  auto worker = [&]() {
+    for (int64 i = next_function++; i < function_count && !failed.load();
+         i = next_function++) {
+      function_changed[i] =
+          RunOnFunction(functions[i], options, &function_results[i]);
+      if (!function_changed[i].ok()) {
+        failed.store(true);
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int64 i = 0; i < thread_count; ++i) {
+    threads.emplace_back(worker);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  bool changed = false;
+  for (int64 i = 0; i < function_count; ++i) {
+    XLS_ASSIGN_OR_RETURN(bool this_changed, function_changed[i]);
+    changed |= this_changed;
+    results->invocations.insert(results->invocations.end(),
+                                function_results[i].invocations.begin(),
+                                function_results[i].invocations.end());
   }
   return changed;
 }
@@ -50,7 +50,15 @@ class FunctionPass : public Pass {
                                              const PassOptions& options,
                                              PassResults* results) const = 0;
 
-  // Iterates over each function in the package calling RunOnFunction.
+  // Returns whether RunOnFunction only inspects and modifies the function it is
+  // given, so may run on several functions of a package concurrently. Passes
+  // which look into other functions (e.g., the bodies of invoked functions)
+  // must return false, and are then run on one function at a time.
+  virtual bool IsFunctionLocal() const { return true; }
+
+  // Iterates over each function in the package calling RunOnFunction. If
+  // options.function_pass_threads is greater than one and the pass is
+  // function-local, functions are processed concurrently.
   absl::StatusOr<bool> Run(Package* p, const PassOptions& options,
                            PassResults* results) const override;
 };
@@ -16,6 +16,7 @@
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/str_format.h"
 #include "xls/common/casts.h"
 #include "xls/common/logging/logging.h"
@@ -26,6 +27,7 @@
 #include "xls/ir/function.h"
 #include "xls/ir/function_builder.h"
 #include "xls/ir/ir_parser.h"
+#include "xls/ir/nodes.h"
 #include "xls/ir/package.h"
 #include "xls/ir/type.h"
 
@@ -395,5 +397,81 @@ TEST(PassesTest, RunOnlyAndSkipPassesOption) {
   }
 }
 
+// Function pass which negates the return value of each function, creating new
+// nodes and types along the way. Fails on functions with the given name.
+class NegateReturnValuePass : public FunctionPass {
+ public:
+  explicit NegateReturnValuePass(absl::string_view fail_on = "")
+      : FunctionPass("negate", "Negate return value"), fail_on_(fail_on) {}
+
+  absl::StatusOr<bool> RunOnFunction(Function* f, const PassOptions& options,
+                                     PassResults* results) const override {
+    if (f->name() == fail_on_) {
+      return absl::InternalError(absl::StrCat("Failed on ", f->name()));
+    }
+    XLS_ASSIGN_OR_RETURN(
+        Node * neg,
+        f->MakeNode<UnOp>(absl::nullopt, f->return_value(), Op::kNeg));
+    // A dead node of a type which may not exist yet.
+    XLS_RETURN_IF_ERROR(
+        f->MakeNode<ExtendOp>(absl::nullopt, neg, neg->BitCountOrDie() + 100,
+                              Op::kZeroExt)
+            .status());
+    XLS_RETURN_IF_ERROR(f->set_return_value(neg));
+    return true;
+  }
+
+ private:
+  std::string fail_on_;
+};
+
+std::unique_ptr<Package> BuildManyFunctions(int64 function_count) {
+  auto p = absl::make_unique<Package>("many");
+  for (int64 i = 0; i < function_count; ++i) {
+    FunctionBuilder b(absl::StrFormat("f%d", i), p.get());
+    b.Add(b.Param("x", p->GetBitsType(i + 1)),
+          b.Literal(UBits(1, /*bit_count=*/i + 1)));
+    XLS_CHECK_OK(b.Build().status());
+  }
+  return p;
+}
+
+TEST(PassesTest, FunctionPassWithThreads) {
+  const int64 kFunctionCount = 64;
+  std::unique_ptr<Package> p = BuildManyFunctions(kFunctionCount);
+  CompoundPass top("top", "Top level pass manager");
+  top.Add<NegateReturnValuePass>();
+
+  PassOptions options;
+  options.function_pass_threads = 8;
+  PassResults results;
+  EXPECT_THAT(top.Run(p.get(), options, &results), IsOkAndHolds(true));
+  ASSERT_EQ(results.invocations.size(), 1);
+  EXPECT_EQ(results.invocations[0].pass_name, "negate");
+
+  // Every function was transformed, and node IDs are unique package-wide.
+  absl::flat_hash_set<int64> ids;
+  for (auto& f : p->functions()) {
+    EXPECT_EQ(f->return_value()->op(), Op::kNeg) << f->name();
+    for (Node* node : f->nodes()) {
+      EXPECT_TRUE(ids.insert(node->id()).second) << node->GetName();
+      EXPECT_TRUE(p->IsOwnedType(node->GetType())) << node->GetName();
+    }
+  }
+  EXPECT_EQ(ids.size(), 5 * kFunctionCount);
+}
+
+TEST(PassesTest, FunctionPassWithThreadsReturnsFirstError) {
+  std::unique_ptr<Package> p = BuildManyFunctions(16);
+  CompoundPass top("top", "Top level pass manager");
+  top.Add<NegateReturnValuePass>("f3");
+
+  PassOptions options;
+  options.function_pass_threads = 4;
+  PassResults results;
+  EXPECT_THAT(top.Run(p.get(), options, &results),
+              StatusIs(absl::StatusCode::kInternal, HasSubstr("Failed on f3")));
+}
+
 }  // namespace
 }  // namespace xls
@@ -0,0 +1,177 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/passes/profile_guided_narrowing_pass.h"
+
+#include "absl/container/inlined_vector.h"
+#include "absl/strings/str_cat.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/node_iterator.h"
+#include "xls/ir/nodes.h"
+
+namespace xls {
+
+namespace {
+
+// A node whose known bits are assumed to have the given values.
+struct Assumption {
+  Node* node;
+  TernaryVector value;
+};
+
+// Returns a Bits with the known bits of the ternary vector set to one if
+// "values" is false, or to their values if "values" is true.
+Bits KnownBits(const TernaryVector& ternary, bool values) {
+  absl::InlinedVector<bool, 64> bits(ternary.size());
+  for (int64 i = 0; i < ternary.size(); ++i) {
+    bits[i] = values ? ternary[i] == TernaryValue::kKnownOne
+                     : ternary_ops::IsKnown(ternary[i]);
+  }
+  return Bits(bits);
+}
+
+// Replaces all uses of the node with a concatenation of literals of its
+// assumed bits and slices of its other bits.
+absl::Status Speculate(Node* node, const TernaryVector& value) {
+  Function* f = node->function();
+  std::vector<Node*> users(node->users().begin(), node->users().end());
+  bool is_return_value = node == f->return_value();
+
+  // Build the concat operands from the most significant bit down, one per run
+  // of known or unknown bits.
+  std::vector<Node*> pieces;
+  int64 hi = value.size();
+  while (hi > 0) {
+    bool known = ternary_ops::IsKnown(value[hi - 1]);
+    int64 lo = hi - 1;
+    while (lo > 0 && ternary_ops::IsKnown(value[lo - 1]) == known) {
+      --lo;
+    }
+    Node* piece;
+    if (known) {
+      TernaryVector run(value.begin() + lo, value.begin() + hi);
+      XLS_ASSIGN_OR_RETURN(piece,
+                           f->MakeNode<Literal>(
+                               node->loc(), Value(KnownBits(run, true))));
+    } else {
+      XLS_ASSIGN_OR_RETURN(piece, f->MakeNode<BitSlice>(node->loc(), node,
+                                                        /*start=*/lo,
+                                                        /*width=*/hi - lo));
+    }
+    pieces.push_back(piece);
+    hi = lo;
+  }
+  Node* replacement = pieces.front();
+  if (pieces.size() > 1) {
+    XLS_ASSIGN_OR_RETURN(replacement,
+                         f->MakeNode<Concat>(node->loc(), pieces));
+  }
+
+  for (Node* user : users) {
+    XLS_RET_CHECK(user->ReplaceOperand(node, replacement));
+  }
+  if (is_return_value) {
+    XLS_RETURN_IF_ERROR(f->set_return_value(replacement));
+  }
+  return absl::OkStatus();
+}
+
+// Sets the return value of the function to whether all the assumptions hold.
+absl::Status BuildGuard(Function* f,
+                        absl::Span<const Assumption> assumptions) {
+  std::vector<Node*> checks;
+  for (const Assumption& assumption : assumptions) {
+    Node* node = assumption.node;
+    XLS_ASSIGN_OR_RETURN(
+        Node * mask,
+        f->MakeNode<Literal>(node->loc(),
+                             Value(KnownBits(assumption.value, false))));
+    XLS_ASSIGN_OR_RETURN(
+        Node * expected,
+        f->MakeNode<Literal>(node->loc(),
+                             Value(KnownBits(assumption.value, true))));
+    XLS_ASSIGN_OR_RETURN(
+        Node * masked,
+        f->MakeNode<NaryOp>(node->loc(), std::vector<Node*>{node, mask},
+                            Op::kAnd));
+    XLS_ASSIGN_OR_RETURN(
+        Node * check,
+        f->MakeNode<CompareOp>(node->loc(), masked, expected, Op::kEq));
+    checks.push_back(check);
+  }
+  Node* guard = checks.front();
+  if (checks.size() > 1) {
+    XLS_ASSIGN_OR_RETURN(guard, f->MakeNode<NaryOp>(absl::nullopt, checks,
+                                                    Op::kAnd));
+  }
+  return f->set_return_value(guard);
+}
+
+}  // namespace
+
+absl::StatusOr<bool> ProfileGuidedNarrowingPass::Run(
+    Package* p, const PassOptions& options, PassResults* results) const {
+  XLS_ASSIGN_OR_RETURN(Function * entry, p->EntryFunction());
+  std::string narrowed_name = absl::StrCat(entry->name(), "__narrowed");
+  std::string guard_name = absl::StrCat(entry->name(), "__guard");
+  if (p->GetFunction(narrowed_name).ok() || p->GetFunction(guard_name).ok()) {
+    // Already specialized.
+    return false;
+  }
+
+  std::vector<Assumption> assumptions;
+  for (Node* node : TopoSort(entry)) {
+    if (!node->GetType()->IsBits() || node->Is<Literal>() ||
+        (params_only_ && !node->Is<Param>())) {
+      continue;
+    }
+    auto it = profile_.find(node->id());
+    if (it == profile_.end() || ternary_ops::AllUnknown(it->second)) {
+      continue;
+    }
+    XLS_RET_CHECK_EQ(it->second.size(), node->BitCountOrDie())
+        << "Profile doesn't match node " << node->GetName();
+    assumptions.push_back(Assumption{node, it->second});
+  }
+  XLS_VLOG(2) << absl::StreamFormat(
+      "Speculating on the values of %d nodes of %s", assumptions.size(),
+      entry->name());
+  if (assumptions.empty()) {
+    return false;
+  }
+
+  absl::flat_hash_map<Node*, Node*> narrowed_nodes;
+  XLS_ASSIGN_OR_RETURN(Function * narrowed,
+                       entry->Clone(narrowed_name, &narrowed_nodes));
+  for (const Assumption& assumption : assumptions) {
+    XLS_RETURN_IF_ERROR(
+        Speculate(narrowed_nodes.at(assumption.node), assumption.value));
+  }
+  XLS_VLOG(3) << "Narrowed function:\n" << narrowed->DumpIr();
+
+  absl::flat_hash_map<Node*, Node*> guard_nodes;
+  XLS_ASSIGN_OR_RETURN(Function * guard,
+                       entry->Clone(guard_name, &guard_nodes));
+  std::vector<Assumption> guard_assumptions;
+  for (const Assumption& assumption : assumptions) {
+    guard_assumptions.push_back(
+        Assumption{guard_nodes.at(assumption.node), assumption.value});
+  }
+  XLS_RETURN_IF_ERROR(BuildGuard(guard, guard_assumptions));
+  return true;
+}
+
+}  // namespace xls
@@ -0,0 +1,61 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_PASSES_PROFILE_GUIDED_NARROWING_PASS_H_
+#define XLS_PASSES_PROFILE_GUIDED_NARROWING_PASS_H_
+
+#include "absl/status/statusor.h"
+#include "xls/interpreter/ir_interpreter_stats.h"
+#include "xls/ir/function.h"
+#include "xls/passes/passes.h"
+
+namespace xls {
+
+// Pass which speculatively specializes the entry function on a value profile,
+// typically recorded by the interpreter (see InterpreterStats) over a set of
+// training inputs: the bits of each node which were the same in every
+// training evaluation are assumed to always have that value.
+//
+// The entry function itself is left as is. Two functions are added:
+//
+//   <entry>__narrowed: the entry function with the assumed bits of each node
+//     replaced by literals, so later passes (constant folding, narrowing,
+//     etc.) can shrink the logic depending on them.
+//   <entry>__guard: returns a bits[1] which is one iff the assumptions hold
+//     for the given arguments, in which case <entry>__narrowed computes the
+//     same result as <entry>.
+//
+// If "params_only" is set, only the bits of parameters are assumed, so the
+// guard is a cheap check of the arguments. Otherwise the guard generally
+// recomputes much of the entry function.
+class ProfileGuidedNarrowingPass : public Pass {
+ public:
+  explicit ProfileGuidedNarrowingPass(ValueProfile profile,
+                                      bool params_only = false)
+      : Pass("profile_narrow", "Profile-guided speculative narrowing"),
+        profile_(std::move(profile)),
+        params_only_(params_only) {}
+  ~ProfileGuidedNarrowingPass() override {}
+
+  absl::StatusOr<bool> Run(Package* p, const PassOptions& options,
+                           PassResults* results) const override;
+
+ private:
+  ValueProfile profile_;
+  bool params_only_;
+};
+
+}  // namespace xls
+
+#endif  // XLS_PASSES_PROFILE_GUIDED_NARROWING_PASS_H_
@@ -0,0 +1,146 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/passes/profile_guided_narrowing_pass.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "xls/common/status/matchers.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/interpreter/ir_interpreter_stats.h"
+#include "xls/ir/function_builder.h"
+#include "xls/ir/ir_matcher.h"
+#include "xls/ir/ir_test_base.h"
+#include "xls/passes/pass_base.h"
+
+namespace m = ::xls::op_matchers;
+
+namespace xls {
+namespace {
+
+using status_testing::IsOkAndHolds;
+
+class ProfileGuidedNarrowingPassTest : public IrTestBase {
+ protected:
+  ProfileGuidedNarrowingPassTest() = default;
+
+  absl::StatusOr<bool> Run(Package* p, ValueProfile profile,
+                           bool params_only = false) {
+    PassResults results;
+    return ProfileGuidedNarrowingPass(std::move(profile), params_only)
+        .Run(p, PassOptions(), &results);
+  }
+
+  // Returns the value profile of the function over the given argument sets.
+  ValueProfile Train(Function* f, absl::Span<const std::vector<uint64>> args) {
+    InterpreterStats stats;
+    for (const std::vector<uint64>& arg_set : args) {
+      std::vector<Value> values;
+      for (int64 i = 0; i < arg_set.size(); ++i) {
+        values.push_back(
+            Value(UBits(arg_set[i], f->param(i)->BitCountOrDie())));
+      }
+      XLS_CHECK_OK(IrInterpreter::Run(f, values, &stats).status());
+    }
+    return stats.GetValueProfile();
+  }
+
+  // Returns the result of the function on the given arguments.
+  Value Eval(Function* f, absl::Span<const uint64> args) {
+    std::vector<Value> values;
+    for (int64 i = 0; i < args.size(); ++i) {
+      values.push_back(Value(UBits(args[i], f->param(i)->BitCountOrDie())));
+    }
+    return IrInterpreter::Run(f, values).value();
+  }
+};
+
+TEST_F(ProfileGuidedNarrowingPassTest, NarrowsSmallValues) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  fb.Add(fb.Param("x", p->GetBitsType(32)), fb.Param("y", p->GetBitsType(32)));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  // The training values are all less than 256, so the sum is less than 512.
+  ValueProfile profile = Train(f, {{0, 0}, {255, 255}, {17, 200}});
+  ASSERT_THAT(Run(p.get(), profile), IsOkAndHolds(true));
+
+  XLS_ASSERT_OK_AND_ASSIGN(Function * narrowed,
+                           p->GetFunction(f->name() + "__narrowed"));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * guard,
+                           p->GetFunction(f->name() + "__guard"));
+  EXPECT_THAT(narrowed->return_value(),
+              m::Concat(m::Literal(UBits(0, 23)),
+                        m::BitSlice(m::Add(), /*start=*/0, /*width=*/9)));
+  // The original function is untouched.
+  EXPECT_THAT(f->return_value(), m::Add(m::Param("x"), m::Param("y")));
+
+  EXPECT_EQ(Eval(guard, {3, 100}), Value(UBits(1, 1)));
+  EXPECT_EQ(Eval(narrowed, {3, 100}), Eval(f, {3, 100}));
+  EXPECT_EQ(Eval(guard, {256, 0}), Value(UBits(0, 1)));
+  EXPECT_EQ(Eval(guard, {0, 0x80000000}), Value(UBits(0, 1)));
+
+  // The pass doesn't specialize the function a second time.
+  EXPECT_THAT(Run(p.get(), profile), IsOkAndHolds(false));
+}
+
+TEST_F(ProfileGuidedNarrowingPassTest, KnownBitsInTheMiddle) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  BValue x = fb.Param("x", p->GetBitsType(8));
+  fb.Not(x);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  // Bits 2 to 5 of x are always 0b0110.
+  ValueProfile profile =
+      Train(f, {{0b00011000}, {0b11011011}, {0b01011001}, {0b10011010}});
+  ASSERT_THAT(Run(p.get(), profile, /*params_only=*/true),
+              IsOkAndHolds(true));
+
+  XLS_ASSERT_OK_AND_ASSIGN(Function * narrowed,
+                           p->GetFunction(f->name() + "__narrowed"));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * guard,
+                           p->GetFunction(f->name() + "__guard"));
+  // Only the parameter is specialized.
+  EXPECT_THAT(narrowed->return_value(),
+              m::Not(m::Concat(m::BitSlice(m::Param("x"), 6, 2),
+                               m::Literal(UBits(0b0110, 4)),
+                               m::BitSlice(m::Param("x"), 0, 2))));
+  EXPECT_THAT(guard->return_value(),
+              m::Eq(m::And(m::Param("x"), m::Literal(UBits(0b00111100, 8))),
+                    m::Literal(UBits(0b00011000, 8))));
+
+  for (uint64 x = 0; x < 256; ++x) {
+    if (Eval(guard, {x}) == Value(UBits(1, 1))) {
+      EXPECT_EQ(Eval(narrowed, {x}), Eval(f, {x})) << "x = " << x;
+    } else {
+      EXPECT_NE(x & 0b00111100, 0b00011000) << "x = " << x;
+    }
+  }
+}
+
+TEST_F(ProfileGuidedNarrowingPassTest, NothingKnown) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  fb.Not(fb.Param("x", p->GetBitsType(2)));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  ValueProfile profile = Train(f, {{0}, {3}});
+  EXPECT_THAT(Run(p.get(), profile), IsOkAndHolds(false));
+  EXPECT_THAT(Run(p.get(), ValueProfile()), IsOkAndHolds(false));
+  EXPECT_EQ(p->functions().size(), 1);
+}
+
+}  // namespace
+}  // namespace xls
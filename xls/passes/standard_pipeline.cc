@@ -34,6 +34,7 @@
 #include "xls/passes/literal_uncommoning_pass.h"
 #include "xls/passes/map_inlining_pass.h"
 #include "xls/passes/narrowing_pass.h"
+#include "xls/passes/node_rewrite_pass.h"
 #include "xls/passes/reassociation_pass.h"
 #include "xls/passes/select_simplification_pass.h"
 #include "xls/passes/strength_reduction_pass.h"
@@ -49,14 +50,17 @@ class SimplificationPass : public FixedPointCompoundPass {
  public:
   explicit SimplificationPass(bool split_ops)
       : FixedPointCompoundPass("simp", "Simplification") {
-    Add<ConstantFoldingPass>();
-    Add<DeadCodeEliminationPass>();
-    Add<CanonicalizationPass>();
-    Add<DeadCodeEliminationPass>();
+    // Local rewrites are applied together by a worklist-driven pass, which
+    // revisits only the nodes affected by each rewrite and removes dead nodes
+    // as it goes.
+    NodeRewriteDriverPass* rewrites = Add<NodeRewriteDriverPass>();
+    rewrites->Add<ConstantFoldingPass>();
+    rewrites->Add<CanonicalizationPass>();
+    rewrites->Add<ArithSimplificationPass>();
+    rewrites->Add<TupleSimplificationPass>();
+    rewrites->Add<ArraySimplificationPass>();
     Add<SelectSimplificationPass>(split_ops);
     Add<DeadCodeEliminationPass>();
-    Add<ArithSimplificationPass>();
-    Add<DeadCodeEliminationPass>();
     Add<ReassociationPass>();
     Add<DeadCodeEliminationPass>();
     Add<ConstantFoldingPass>();
@@ -65,12 +69,8 @@ class SimplificationPass : public FixedPointCompoundPass {
     Add<DeadCodeEliminationPass>();
     Add<ConcatSimplificationPass>();
     Add<DeadCodeEliminationPass>();
-    Add<TupleSimplificationPass>();
-    Add<DeadCodeEliminationPass>();
     Add<StrengthReductionPass>(split_ops);
     Add<DeadCodeEliminationPass>();
-    Add<ArraySimplificationPass>();
-    Add<DeadCodeEliminationPass>();
     Add<NarrowingPass>();
     Add<DeadCodeEliminationPass>();
     Add<BooleanSimplificationPass>();
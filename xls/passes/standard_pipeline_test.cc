@@ -271,6 +271,125 @@ TEST_F(StandardPipelineTest, LogicCombining) {
   EXPECT_THAT(f->return_value(), m::Param("x"));
 }
 
+// Running function-scoped passes on several threads gives the same result as
+// running them serially.
+TEST_F(StandardPipelineTest, FunctionPassThreads) {
+  const char kPackage[] = R"(
+package threads
+
+fn f0(x: bits[32], y: bits[32]) -> bits[32] {
+  literal.3: bits[32] = literal(value=0)
+  add.4: bits[32] = add(x, literal.3)
+  and.5: bits[32] = and(add.4, y)
+  ret or.6: bits[32] = or(and.5, add.4)
+}
+
+fn f1(x: bits[32], y: bits[32]) -> bits[32] {
+  literal.9: bits[32] = literal(value=16)
+  umul.10: bits[32] = umul(x, literal.9)
+  neg.11: bits[32] = neg(y)
+  neg.12: bits[32] = neg(neg.11)
+  ret sub.13: bits[32] = sub(umul.10, neg.12)
+}
+
+fn f2(x: bits[32], y: bits[32]) -> bits[32] {
+  not.16: bits[32] = not(y)
+  and.17: bits[32] = and(x, y)
+  and.18: bits[32] = and(x, not.16)
+  ret or.19: bits[32] = or(and.17, and.18)
+}
+
+fn main(x: bits[32], y: bits[32]) -> bits[32] {
+  invoke.22: bits[32] = invoke(x, y, to_apply=f0)
+  invoke.23: bits[32] = invoke(x, y, to_apply=f1)
+  invoke.24: bits[32] = invoke(x, y, to_apply=f2)
+  add.25: bits[32] = add(invoke.22, invoke.23)
+  ret add.26: bits[32] = add(add.25, invoke.24)
+}
+)";
+  auto run = [&](int64 threads) -> absl::StatusOr<std::unique_ptr<Package>> {
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> p,
+                         Parser::ParsePackage(kPackage));
+    PassOptions options;
+    options.function_pass_threads = threads;
+    PassResults results;
+    XLS_RETURN_IF_ERROR(
+        CreateStandardPassPipeline()->Run(p.get(), options, &results).status());
+    return std::move(p);
+  };
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> serial, run(1));
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> parallel, run(4));
+  XLS_ASSERT_OK_AND_ASSIGN(Function * serial_main, serial->EntryFunction());
+  XLS_ASSERT_OK_AND_ASSIGN(Function * parallel_main,
+                           parallel->EntryFunction());
+  EXPECT_EQ(parallel->functions().size(), serial->functions().size());
+  EXPECT_EQ(parallel_main->node_count(), serial_main->node_count());
+  EXPECT_EQ(parallel_main->return_value()->op(),
+            serial_main->return_value()->op());
+}
+
+// Constant folding an invoke, map or counted_for interprets the called
+// function, so it must not run while another thread is rewriting that function.
+// The callees are long chains of redundant operations so that simplifying them
+// takes a while.
+TEST_F(StandardPipelineTest, FunctionPassThreadsFoldCalls) {
+  const int64 kChainLength = 200;
+  int64 id = 0;
+  auto chain = [&](absl::string_view op, absl::string_view input) {
+    std::string body;
+    std::string prev(input);
+    for (int64 i = 0; i < kChainLength; ++i) {
+      std::string name = absl::StrFormat("%s.%d", op, ++id);
+      absl::StrAppendFormat(&body, "  %s: bits[32] = %s(%s)\n", name, op,
+                            prev);
+      prev = name;
+    }
+    return std::make_pair(body, prev);
+  };
+  auto [square_body, square_value] = chain("neg", "x");
+  auto [loop_body, loop_value] = chain("not", "i");
+  std::string package = absl::StrFormat(R"(
+package fold_calls
+
+fn square(x: bits[32]) -> bits[32] {
+%s  ret umul.%d: bits[32] = umul(%s, %s)
+}
+
+fn body(i: bits[32], acc: bits[32]) -> bits[32] {
+%s  ret add.%d: bits[32] = add(acc, %s)
+}
+
+fn main() -> (bits[32], bits[32][3], bits[32]) {
+  literal.%d: bits[32] = literal(value=7)
+  literal.%d: bits[32][3] = literal(value=[1, 2, 3])
+  literal.%d: bits[32] = literal(value=0)
+  invoke.%d: bits[32] = invoke(literal.%d, to_apply=square)
+  map.%d: bits[32][3] = map(literal.%d, to_apply=square)
+  counted_for.%d: bits[32] = counted_for(literal.%d, trip_count=4, stride=1, body=body)
+  ret tuple.%d: (bits[32], bits[32][3], bits[32]) = tuple(invoke.%d, map.%d, counted_for.%d)
+}
+)",
+      square_body, id + 1, square_value, square_value, loop_body, id + 2,
+      loop_value, id + 3, id + 4, id + 5, id + 6, id + 3, id + 7, id + 4,
+      id + 8, id + 5, id + 9, id + 6, id + 7, id + 8);
+
+  for (int64 threads : {1, 4}) {
+    XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> p,
+                             Parser::ParsePackage(package));
+    PassOptions options;
+    options.function_pass_threads = threads;
+    PassResults results;
+    XLS_ASSERT_OK(
+        CreateStandardPassPipeline()->Run(p.get(), options, &results).status());
+    XLS_ASSERT_OK_AND_ASSIGN(Function * main, p->GetFunction("main"));
+    EXPECT_THAT(main->return_value(),
+                m::Literal(Value::Tuple(
+                    {Value(UBits(49, 32)),
+                     Value::UBitsArray({1, 4, 9}, 32).value(),
+                     Value(UBits(6, 32))})))
+        << "threads: " << threads;
+  }
+}
 
 }  // namespace
 }  // namespace xls
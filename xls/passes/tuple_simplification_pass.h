@@ -16,21 +16,21 @@
 #define XLS_PASSES_TUPLE_SIMPLIFICATION_PASS_H_
 
 #include "absl/status/statusor.h"
-#include "xls/ir/function.h"
-#include "xls/passes/passes.h"
+#include "xls/ir/node.h"
+#include "xls/passes/node_rewrite_pass.h"
 
 namespace xls {
 
 // Pass which simplifies and eliminates tuples. Replaces a tuple instruction
 // followed by a tuple index instruction with the tuple element itself.
-class TupleSimplificationPass : public FunctionPass {
+class TupleSimplificationPass : public NodeRewritePass {
  public:
   TupleSimplificationPass()
-      : FunctionPass("tuple_simp", "Tuple simplification") {}
+      : NodeRewritePass("tuple_simp", "Tuple simplification") {}
   ~TupleSimplificationPass() override {}
 
-  absl::StatusOr<bool> RunOnFunction(Function* f, const PassOptions& options,
-                                     PassResults* results) const override;
+  absl::StatusOr<bool> RewriteNode(Node* node,
+                                   const PassOptions& options) const override;
 };
 
 }  // namespace xls
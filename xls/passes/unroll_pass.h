@@ -27,6 +27,9 @@ class UnrollPass : public FunctionPass {
 
   absl::StatusOr<bool> RunOnFunction(Function* f, const PassOptions& options,
                                      PassResults* results) const override;
+
+  // Copies the bodies of loops.
+  bool IsFunctionLocal() const override { return false; }
 };
 
 }  // namespace xls
@@ -14,6 +14,9 @@
 
 #include "xls/scheduling/pipeline_schedule.h"
 
+#include <functional>
+#include <queue>
+
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
@@ -21,6 +24,8 @@
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/data_structures/binary_search.h"
+#include "xls/data_structures/min_cost_flow.h"
+#include "xls/delay_model/caching_delay_estimator.h"
 #include "xls/ir/node_iterator.h"
 #include "xls/scheduling/function_partition.h"
 #include "xls/scheduling/schedule_bounds.h"
@@ -138,6 +143,152 @@ absl::StatusOr<ScheduleCycleMap> ScheduleToMinimizeRegisters(
   return cycle_map;
 }
 
+// Schedules the given function into a pipeline with the given clock period
+// such that the total number of flops in the pipeline is minimal. The problem
+// is formulated as an integer linear program over the cycle c[n] of each node
+// n in which every constraint is a difference constraint:
+//
+//   c[n] - c[o] >= 0            for each operand o of n
+//   c[b] - c[a] >= 1            if the longest path from a to b (inclusive)
+//                               exceeds the clock period
+//   lb[n] <= c[n] <= ub[n]      bounds from 'bounds'
+//
+// The objective is the sum over nodes of bit_count(n) * (L[n] - c[n]) where
+// L[n] is the cycle of the last use of n, modeled by an additional variable
+// constrained by L[n] - c[u] >= 0 for each user u (the return value is used in
+// the last stage). The constraint matrix is totally unimodular so the linear
+// program has an integral optimum. It is solved via its dual, which is a min
+// cost flow problem, and the cycles are read off the optimal node potentials.
+absl::StatusOr<ScheduleCycleMap> ScheduleToMinimizeRegistersSdc(
+    Function* f, int64 pipeline_stages, int64 clock_period_ps,
+    const DelayEstimator& delay_estimator, const sched::ScheduleBounds& bounds) {
+  XLS_VLOG(3) << "ScheduleToMinimizeRegistersSdc()";
+  XLS_VLOG(3) << "  pipeline stages = " << pipeline_stages;
+
+  auto topo_sort_it = TopoSort(f);
+  std::vector<Node*> topo_sort(topo_sort_it.begin(), topo_sort_it.end());
+  absl::flat_hash_map<Node*, int64> topo_index;
+  std::vector<int64> delays;
+  for (Node* node : topo_sort) {
+    topo_index[node] = delays.size();
+    XLS_ASSIGN_OR_RETURN(int64 delay,
+                         delay_estimator.GetOperationDelayInPs(node));
+    delays.push_back(delay);
+  }
+
+  // Variables are nodes of the flow network and the values of the variables
+  // are the potentials, measured relative to a reference node 'zero'. A
+  // constraint x[b] - x[a] >= d is an arc from a to b of cost -d. The supply of
+  // a node is the negated coefficient of its variable in the objective.
+  min_cost_flow::Network network;
+  const min_cost_flow::NodeId zero = network.AddNode();
+  std::vector<min_cost_flow::NodeId> cycle_vars;
+  for (int64 i = 0; i < topo_sort.size(); ++i) {
+    cycle_vars.push_back(network.AddNode());
+  }
+  auto add_constraint = [&](min_cost_flow::NodeId a, min_cost_flow::NodeId b,
+                            int64 d) { network.AddArc(a, b, -d); };
+  auto add_objective = [&](min_cost_flow::NodeId var, int64 coefficient) {
+    network.set_supply(var, network.supply(var) - coefficient);
+  };
+
+  for (int64 i = 0; i < topo_sort.size(); ++i) {
+    Node* node = topo_sort[i];
+    add_constraint(zero, cycle_vars[i], bounds.lb(node));
+    add_constraint(cycle_vars[i], zero, -bounds.ub(node));
+    for (Node* operand : node->operands()) {
+      add_constraint(cycle_vars[topo_index.at(operand)], cycle_vars[i], 0);
+    }
+  }
+
+  // Timing constraints. For each node 'a', walk its descendants in topological
+  // order tracking the longest path from the start of 'a'. The walk stops at
+  // nodes where the path exceeds the clock period as the constraints of their
+  // descendants are implied by dependency constraints.
+  int64 timing_constraint_count = 0;
+  std::vector<int64> path_delay(topo_sort.size(), -1);
+  std::vector<int64> visited;
+  std::priority_queue<int64, std::vector<int64>, std::greater<int64>> frontier;
+  for (int64 a = 0; a < topo_sort.size(); ++a) {
+    path_delay[a] = delays[a];
+    visited.push_back(a);
+    frontier.push(a);
+    while (!frontier.empty()) {
+      const int64 b = frontier.top();
+      frontier.pop();
+      if (path_delay[b] > clock_period_ps) {
+        XLS_RET_CHECK_NE(a, b) << absl::StreamFormat(
+            "Node %s has a delay of %dps which exceeds the clock period",
+            topo_sort[a]->GetName(), delays[a]);
+        add_constraint(cycle_vars[a], cycle_vars[b], 1);
+        ++timing_constraint_count;
+        continue;
+      }
+      for (Node* user : topo_sort[b]->users()) {
+        const int64 u = topo_index.at(user);
+        if (path_delay[u] == -1) {
+          visited.push_back(u);
+          frontier.push(u);
+        }
+        path_delay[u] = std::max(path_delay[u], path_delay[b] + delays[u]);
+      }
+    }
+    for (int64 v : visited) {
+      path_delay[v] = -1;
+    }
+    visited.clear();
+  }
+
+  // The objective. The lifetime of a node with a single use is expressed
+  // directly in terms of the cycle of the user.
+  for (int64 i = 0; i < topo_sort.size(); ++i) {
+    Node* node = topo_sort[i];
+    const int64 bit_count = node->GetType()->GetFlatBitCount();
+    std::vector<min_cost_flow::NodeId> uses;
+    std::vector<int64> use_offsets;
+    for (Node* user : node->users()) {
+      uses.push_back(cycle_vars[topo_index.at(user)]);
+      use_offsets.push_back(0);
+    }
+    if (node == f->return_value()) {
+      uses.push_back(zero);
+      use_offsets.push_back(pipeline_stages - 1);
+    }
+    if (bit_count == 0 || uses.empty()) {
+      continue;
+    }
+    add_objective(cycle_vars[i], -bit_count);
+    if (uses.size() == 1) {
+      add_objective(uses.front(), bit_count);
+      continue;
+    }
+    min_cost_flow::NodeId last_use = network.AddNode();
+    for (int64 j = 0; j < uses.size(); ++j) {
+      add_constraint(uses[j], last_use, use_offsets[j]);
+    }
+    add_objective(last_use, bit_count);
+  }
+  XLS_VLOG(3) << absl::StreamFormat(
+      "SDC: %d variables, %d constraints (%d timing)", network.node_count(),
+      network.arc_count(), timing_constraint_count);
+
+  XLS_ASSIGN_OR_RETURN(min_cost_flow::Flow flow,
+                       min_cost_flow::SolveMinCostFlow(network));
+  auto value = [&](min_cost_flow::NodeId var) {
+    return flow.potentials[static_cast<int64>(var)] -
+           flow.potentials[static_cast<int64>(zero)];
+  };
+  ScheduleCycleMap cycle_map;
+  for (int64 i = 0; i < topo_sort.size(); ++i) {
+    Node* node = topo_sort[i];
+    const int64 cycle = value(cycle_vars[i]);
+    XLS_RET_CHECK_GE(cycle, bounds.lb(node)) << node->GetName();
+    XLS_RET_CHECK_LE(cycle, bounds.ub(node)) << node->GetName();
+    cycle_map[node] = cycle;
+  }
+  return cycle_map;
+}
+
 // Returns the critical path of the function given a topological sort of its
 // nodes.
 absl::StatusOr<int64> FunctionCriticalPath(
@@ -320,6 +471,10 @@ std::vector<Node*> PipelineSchedule::GetLiveOutOfCycle(int64 c) const {
 /*static*/ absl::StatusOr<PipelineSchedule> PipelineSchedule::Run(
     Function* f, const DelayEstimator& delay_estimator,
     const SchedulingOptions& options) {
+  // The steps below query the delay of each node many times (e.g., on every
+  // probe of the clock period search), so memoize the delays by node signature.
+  CachingDelayEstimator caching_delay_estimator(delay_estimator);
+
   int64 clock_period_ps;
   if (options.clock_period_ps().has_value()) {
     clock_period_ps = *options.clock_period_ps();
@@ -341,12 +496,12 @@ std::vector<Node*> PipelineSchedule::GetLiveOutOfCycle(int64 c) const {
     // A pipeline length is specified, but no target clock period. Determine
     // the minimum clock period for which the function can be scheduled in the
     // given pipeline length.
-    XLS_ASSIGN_OR_RETURN(
-        clock_period_ps,
-        FindMinimumClockPeriod(f, *options.pipeline_stages(), delay_estimator));
+    XLS_ASSIGN_OR_RETURN(clock_period_ps,
+                         FindMinimumClockPeriod(f, *options.pipeline_stages(),
+                                                caching_delay_estimator));
   }
 
-  sched::ScheduleBounds bounds(f, clock_period_ps, delay_estimator);
+  sched::ScheduleBounds bounds(f, clock_period_ps, caching_delay_estimator);
   XLS_RETURN_IF_ERROR(bounds.PropagateLowerBounds());
 
   int64 max_ub;
@@ -363,9 +518,14 @@ std::vector<Node*> PipelineSchedule::GetLiveOutOfCycle(int64 c) const {
   XLS_RETURN_IF_ERROR(bounds.PropagateUpperBounds());
   ScheduleCycleMap cycle_map;
   if (options.strategy() == SchedulingStrategy::MINIMIZE_REGISTERS) {
-    XLS_ASSIGN_OR_RETURN(
-        cycle_map,
-        ScheduleToMinimizeRegisters(f, max_ub + 1, delay_estimator, &bounds));
+    XLS_ASSIGN_OR_RETURN(cycle_map, ScheduleToMinimizeRegisters(
+                                        f, max_ub + 1, caching_delay_estimator,
+                                        &bounds));
+  } else if (options.strategy() ==
+             SchedulingStrategy::MINIMIZE_REGISTERS_SDC) {
+    XLS_ASSIGN_OR_RETURN(cycle_map, ScheduleToMinimizeRegistersSdc(
+                                        f, max_ub + 1, clock_period_ps,
+                                        caching_delay_estimator, bounds));
   } else {
     XLS_RET_CHECK(options.strategy() == SchedulingStrategy::ASAP);
     XLS_RET_CHECK(!options.pipeline_stages().has_value());
@@ -375,11 +535,24 @@ std::vector<Node*> PipelineSchedule::GetLiveOutOfCycle(int64 c) const {
     }
   }
   auto schedule = PipelineSchedule(f, cycle_map, options.pipeline_stages());
-  XLS_RETURN_IF_ERROR(schedule.VerifyTiming(clock_period_ps, delay_estimator));
+  XLS_RETURN_IF_ERROR(
+      schedule.VerifyTiming(clock_period_ps, caching_delay_estimator));
+  XLS_VLOG(2) << "Delay estimator cache: "
+              << caching_delay_estimator.StatsToString();
   XLS_VLOG_LINES(3, "Schedule\n" + schedule.ToString());
   return schedule;
 }
 
+int64 PipelineSchedule::CountInteriorPipelineRegisters() const {
+  int64 registers = 0;
+  for (int64 c = 0; c < length() - 1; ++c) {
+    for (Node* node : GetLiveOutOfCycle(c)) {
+      registers += node->GetType()->GetFlatBitCount();
+    }
+  }
+  return registers;
+}
+
 std::string PipelineSchedule::ToString() const {
   absl::flat_hash_map<const Node*, int64> topo_pos;
   int64 pos = 0;
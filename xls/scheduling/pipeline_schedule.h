@@ -30,8 +30,15 @@ enum class SchedulingStrategy {
   // timing constraints.
   ASAP,
 
-  // Minimize the number of pipeline registers when scheduling.
-  MINIMIZE_REGISTERS
+  // Minimize the number of pipeline registers when scheduling. Uses a
+  // heuristic which splits the function at each cycle boundary with a min cut.
+  MINIMIZE_REGISTERS,
+
+  // Minimize the number of pipeline registers exactly. Dependency, timing and
+  // pipeline length constraints are expressed as a system of difference
+  // constraints (SDC) over the cycles of the nodes, and the total register bit
+  // count is minimized by solving the dual min cost flow problem.
+  MINIMIZE_REGISTERS_SDC
 };
 
 // Returns the list of ordering of cycles (pipeline stages) in which to compute
@@ -150,6 +157,10 @@ class PipelineSchedule {
   // of the pipeline.
   int64 length() const { return cycle_to_nodes_.size(); }
 
+  // Returns the number of bits of pipeline registers between the stages of the
+  // pipeline, not counting any flops at the input or output of the pipeline.
+  int64 CountInteriorPipelineRegisters() const;
+
   // Verifies various invariants of the schedule (each node scheduled exactly
   // once, node not scheduled before operands, etc.).
   absl::Status Verify() const;
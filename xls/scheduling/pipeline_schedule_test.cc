@@ -14,10 +14,13 @@
 
 #include "xls/scheduling/pipeline_schedule.h"
 
+#include <random>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
 #include "xls/common/status/matchers.h"
 #include "xls/delay_model/delay_estimator.h"
 #include "xls/ir/bits.h"
@@ -426,5 +429,134 @@ TEST_F(PipelineScheduleTest, SerializeAndDeserialize) {
   }
 }
 
+TEST_F(PipelineScheduleTest, SdcMinimizeRegisterBitslices) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  auto x = fb.Param("x", p->GetBitsType(32));
+  auto y = fb.Param("y", p->GetBitsType(32));
+  auto x_slice = fb.BitSlice(x, /*start=*/8, /*width=*/8);
+  auto y_slice = fb.BitSlice(y, /*start=*/8, /*width=*/8);
+  auto neg_neg_y = fb.Negate(fb.Negate(y));
+  fb.Concat({x, x_slice, y_slice, neg_neg_y});
+
+  XLS_ASSERT_OK_AND_ASSIGN(Function * f, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(
+          f, TestDelayEstimator(),
+          SchedulingOptions(SchedulingStrategy::MINIMIZE_REGISTERS_SDC)
+              .clock_period_ps(1)));
+
+  EXPECT_EQ(schedule.length(), 2);
+  EXPECT_THAT(schedule.nodes_in_cycle(0),
+              UnorderedElementsAre(m::Param("x"), m::Param("y"),
+                                   m::BitSlice(m::Param("y")), m::Neg()));
+  EXPECT_THAT(
+      schedule.nodes_in_cycle(1),
+      UnorderedElementsAre(m::BitSlice(m::Param("x")), m::Neg(), m::Concat()));
+  // 'x', the bit slice of 'y' and the negate.
+  EXPECT_EQ(schedule.CountInteriorPipelineRegisters(), 32 + 8 + 32);
+}
+
+TEST_F(PipelineScheduleTest, SdcLongPipelineLength) {
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  Type* u32 = p->GetBitsType(32);
+  auto x = fb.Param("x", u32);
+  auto bitslice = fb.BitSlice(x, /*start=*/7, /*width=*/20);
+  auto zext = fb.ZeroExtend(bitslice, /*new_bit_count=*/32);
+
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func, fb.Build());
+
+  XLS_ASSERT_OK_AND_ASSIGN(
+      PipelineSchedule schedule,
+      PipelineSchedule::Run(
+          func, TestDelayEstimator(),
+          SchedulingOptions(SchedulingStrategy::MINIMIZE_REGISTERS_SDC)
+              .pipeline_stages(100)));
+
+  EXPECT_EQ(schedule.length(), 100);
+  EXPECT_THAT(schedule.nodes_in_cycle(0),
+              UnorderedElementsAre(x.node(), bitslice.node()));
+  for (int64 i = 1; i < 99; ++i) {
+    EXPECT_THAT(schedule.nodes_in_cycle(i), UnorderedElementsAre());
+  }
+  EXPECT_THAT(schedule.nodes_in_cycle(99), UnorderedElementsAre(zext.node()));
+  EXPECT_EQ(schedule.CountInteriorPipelineRegisters(), 20 * 99);
+}
+
+TEST_F(PipelineScheduleTest, SdcNoWorseThanMinCut) {
+  // Build a function with a mix of operations of different widths and check
+  // that the exact schedule is valid and uses no more registers than the min
+  // cut heuristic.
+  auto p = CreatePackage();
+  FunctionBuilder fb(TestName(), p.get());
+  std::vector<BValue> values;
+  for (int64 i = 0; i < 4; ++i) {
+    values.push_back(
+        fb.Param(absl::StrFormat("p%d", i), p->GetBitsType(32)));
+  }
+  std::mt19937 gen;
+  for (int64 i = 0; i < 60; ++i) {
+    std::uniform_int_distribution<int64> operand_dis(0, values.size() - 1);
+    BValue a = values[operand_dis(gen)];
+    BValue b = values[operand_dis(gen)];
+    switch (std::uniform_int_distribution<int64>(0, 4)(gen)) {
+      case 0:
+        values.push_back(fb.Add(a, b));
+        break;
+      case 1:
+        values.push_back(fb.Negate(a));
+        break;
+      case 2:
+        values.push_back(fb.And(a, b));
+        break;
+      case 3:
+        // A narrow value which is widened again later.
+        values.push_back(fb.ZeroExtend(
+            fb.BitSlice(a, /*start=*/0, /*width=*/4), /*new_bit_count=*/32));
+        break;
+      default:
+        values.push_back(fb.Not(fb.Subtract(a, b)));
+        break;
+    }
+  }
+  fb.Concat(values);
+  XLS_ASSERT_OK_AND_ASSIGN(Function * func, fb.Build());
+
+  for (int64 clock_period_ps : {2, 3, 5}) {
+    for (int64 extra_stages : {0, 2}) {
+      XLS_ASSERT_OK_AND_ASSIGN(
+          PipelineSchedule asap,
+          PipelineSchedule::Run(
+              func, TestDelayEstimator(),
+              SchedulingOptions(SchedulingStrategy::ASAP)
+                  .clock_period_ps(clock_period_ps)));
+      const int64 pipeline_stages = asap.length() + extra_stages;
+      XLS_ASSERT_OK_AND_ASSIGN(
+          PipelineSchedule min_cut,
+          PipelineSchedule::Run(func, TestDelayEstimator(),
+                                SchedulingOptions()
+                                    .clock_period_ps(clock_period_ps)
+                                    .pipeline_stages(pipeline_stages)));
+      XLS_ASSERT_OK_AND_ASSIGN(
+          PipelineSchedule sdc,
+          PipelineSchedule::Run(
+              func, TestDelayEstimator(),
+              SchedulingOptions(SchedulingStrategy::MINIMIZE_REGISTERS_SDC)
+                  .clock_period_ps(clock_period_ps)
+                  .pipeline_stages(pipeline_stages)));
+      XLS_ASSERT_OK(sdc.Verify());
+      XLS_ASSERT_OK(sdc.VerifyTiming(clock_period_ps, TestDelayEstimator()));
+      EXPECT_EQ(sdc.length(), pipeline_stages);
+      EXPECT_LE(sdc.CountInteriorPipelineRegisters(),
+                min_cut.CountInteriorPipelineRegisters())
+          << "clock period " << clock_period_ps << ", " << pipeline_stages
+          << " stages";
+    }
+  }
+}
+
 }  // namespace
 }  // namespace xls
@@ -14,11 +14,21 @@
 
 #include "xls/solvers/z3_lec.h"
 
+#include <algorithm>
+#include <numeric>
+#include <thread>  // NOLINT
+
 #include "absl/base/internal/sysinfo.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/strip.h"
+#include "absl/time/clock.h"
 #include "xls/codegen/vast.h"
+#include "xls/common/file/filesystem.h"
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/ir/bits_ops.h"
@@ -30,6 +40,7 @@ namespace xls {
 namespace solvers {
 namespace z3 {
 
+using netlist::rtl::Cell;
 using netlist::rtl::Module;
 using netlist::rtl::Netlist;
 using netlist::rtl::NetRef;
@@ -50,8 +61,124 @@ std::vector<const Node*> SetToIdSortedVector(
   return nodes;
 }
 
+// Returns the number of cells in the fan-in cone of "ref", stopping at the
+// wires named in "terminals". NetlistTranslator::GetValueCone() expands the
+// cone into a tree, which grows exponentially on reconvergent logic, so this
+// walks it as a DAG instead.
+int64 NetlistConeSize(NetRef ref,
+                      const absl::flat_hash_set<std::string>& terminals) {
+  absl::flat_hash_set<const Cell*> cells;
+  absl::flat_hash_set<NetRef> seen = {ref};
+  std::vector<NetRef> worklist = {ref};
+  while (!worklist.empty()) {
+    NetRef net = worklist.back();
+    worklist.pop_back();
+    if (terminals.contains(net->name())) {
+      continue;
+    }
+    for (const Cell* cell : net->connected_cells()) {
+      bool drives_net =
+          std::any_of(cell->outputs().begin(), cell->outputs().end(),
+                      [&](const Cell::Pin& pin) { return pin.netref == net; });
+      if (!drives_net || !cells.insert(cell).second) {
+        continue;
+      }
+      for (const Cell::Pin& input : cell->inputs()) {
+        if (seen.insert(input.netref).second) {
+          worklist.push_back(input.netref);
+        }
+      }
+    }
+  }
+  return cells.size();
+}
+
+// Renames the let-bound variables in Z3's SMT-LIB output ("?x123", "$x45") in
+// order of first appearance. Z3 names them after AST ids, which depend on the
+// order in which a context created its nodes.
+std::string CanonicalizeLetNames(absl::string_view text) {
+  absl::flat_hash_map<std::string, std::string> names;
+  std::string result;
+  result.reserve(text.size());
+  int64 i = 0;
+  while (i < text.size()) {
+    bool token_start =
+        i == 0 || absl::ascii_isspace(text[i - 1]) || text[i - 1] == '(';
+    if (token_start && (text[i] == '?' || text[i] == '$') &&
+        i + 2 < text.size() && text[i + 1] == 'x' &&
+        absl::ascii_isdigit(text[i + 2])) {
+      int64 end = i + 2;
+      while (end < text.size() && absl::ascii_isdigit(text[end])) {
+        ++end;
+      }
+      std::string name(text.substr(i, end - i));
+      auto it = names.find(name);
+      if (it == names.end()) {
+        it = names.insert({name, absl::StrCat(text.substr(i, 2), names.size())})
+                 .first;
+      }
+      result.append(it->second);
+      i = end;
+    } else {
+      result.push_back(text[i++]);
+    }
+  }
+  return result;
+}
+
 }  // namespace
 
+bool LecConeCache::Contains(const std::string& key) const {
+  absl::MutexLock lock(&mutex_);
+  return proven_.contains(key);
+}
+
+void LecConeCache::Insert(std::string key) {
+  absl::MutexLock lock(&mutex_);
+  proven_.insert(std::move(key));
+}
+
+int64 LecConeCache::size() const {
+  absl::MutexLock lock(&mutex_);
+  return proven_.size();
+}
+
+absl::Status LecConeCache::Load(const std::filesystem::path& path) {
+  XLS_ASSIGN_OR_RETURN(std::string contents, GetFileContents(path));
+  absl::string_view remaining = contents;
+  absl::MutexLock lock(&mutex_);
+  while (!remaining.empty()) {
+    size_t length_end = remaining.find('\n');
+    int64 length;
+    if (length_end == absl::string_view::npos ||
+        !absl::SimpleAtoi(remaining.substr(0, length_end), &length) ||
+        length < 0 ||
+        static_cast<int64>(remaining.size() - length_end - 1) < length + 1 ||
+        remaining[length_end + 1 + length] != '\n') {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Malformed LEC cone cache: ", path.string()));
+    }
+    proven_.insert(std::string(remaining.substr(length_end + 1, length)));
+    remaining.remove_prefix(length_end + length + 2);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status LecConeCache::Save(const std::filesystem::path& path) const {
+  std::vector<std::string> keys;
+  {
+    absl::MutexLock lock(&mutex_);
+    keys.assign(proven_.begin(), proven_.end());
+  }
+  // Sort the keys so that the file doesn't depend on the hash order.
+  std::sort(keys.begin(), keys.end());
+  std::string contents;
+  for (const std::string& key : keys) {
+    absl::StrAppend(&contents, key.size(), "\n", key, "\n");
+  }
+  return SetFileContents(path, contents);
+}
+
 absl::StatusOr<std::unique_ptr<Lec>> Lec::Create(const LecParams& params) {
   auto lec = absl::WrapUnique<Lec>(
       new Lec(params.ir_package, params.ir_function, params.netlist,
@@ -121,9 +248,14 @@ absl::Status Lec::Init() {
         /*little_endian=*/true);
     XLS_ASSIGN_OR_RETURN(std::vector<Z3_ast> netlist_bits,
                          GetNetlistZ3ForIr(node));
+    XLS_ASSIGN_OR_RETURN(std::vector<NetRef> netrefs, GetOutputNetrefs(node));
     XLS_RET_CHECK(ir_bits.size() == netlist_bits.size());
+    XLS_RET_CHECK(netrefs.size() == netlist_bits.size());
 
     for (int i = 0; i < ir_bits.size(); i++) {
+      // The netlist wires run from the most significant bit down.
+      output_bits_.push_back(
+          {node, static_cast<int64>(ir_bits.size()) - 1 - i, netrefs[i]});
       if (netlist_bits[i] == nullptr) {
         XLS_VLOG(3) << "  Skipping " << node->GetName() << " IR output bit "
                     << i;
@@ -260,25 +392,218 @@ absl::Status Lec::AddConstraints(Function* constraints) {
   Z3_ast eq_node = Z3_mk_eq(ctx(), constraint_translator->GetReturnNode(),
                             Z3_mk_int(ctx(), 1, Z3_mk_bv_sort(ctx(), 1)));
   Z3_solver_assert(ctx(), solver_.value(), eq_node);
+  constraints_ = constraints;
+  constraint_nodes_.push_back(eq_node);
   return absl::OkStatus();
 }
 
 bool Lec::Run() {
   XLS_LOG(INFO) << "Beginning execution";
-  satisfiable_ = Z3_solver_check(ctx(), solver_.value()) == Z3_L_TRUE;
-  if (satisfiable_) {
+  satisfiable_ = Z3_solver_check(ctx(), solver_.value());
+  if (satisfiable_ == Z3_L_TRUE) {
     model_ = Z3_solver_get_model(ctx(), solver_.value());
     Z3_model_inc_ref(ctx(), model_.value());
   }
-  return !satisfiable_;
+  return satisfiable_ == Z3_L_FALSE;
+}
+
+absl::StatusOr<bool> Lec::RunParallel(int num_threads, LecConeCache* cache) {
+  XLS_RET_CHECK_GT(num_threads, 0);
+  XLS_LOG(INFO) << "Beginning execution on " << num_threads << " threads";
+
+  // Each output bit present in the netlist is a cone to check.
+  std::vector<int64> output_indices;
+  absl::flat_hash_map<const Node*, int64> ir_cone_sizes;
+  cone_results_.clear();
+  for (int64 i = 0; i < output_bits_.size(); ++i) {
+    const OutputBit& bit = output_bits_[i];
+    if (bit.netref == nullptr) {
+      continue;
+    }
+    auto it = ir_cone_sizes.find(bit.node);
+    if (it == ir_cone_sizes.end()) {
+      it = ir_cone_sizes.insert({bit.node, IrConeSize(bit.node)}).first;
+    }
+    output_indices.push_back(i);
+    LecConeResult result;
+    result.node = bit.node;
+    result.bit_index = bit.bit_index;
+    result.ir_cone_size = it->second;
+    result.netlist_cone_size =
+        NetlistConeSize(bit.netref, netlist_input_names_);
+    result.equivalent = false;
+    result.inconclusive = false;
+    result.cached = false;
+    result.solve_time = absl::ZeroDuration();
+    cone_results_.push_back(result);
+  }
+
+  // Check the largest cones first, so that one isn't left for last while the
+  // other threads sit idle.
+  std::vector<int64> order(cone_results_.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int64 a, int64 b) {
+    return cone_results_[a].netlist_cone_size >
+           cone_results_[b].netlist_cone_size;
+  });
+
+  // Z3 contexts can't be shared between threads, so each thread but this one
+  // creates its own copy of the problem.
+  std::atomic<int64> next_cone(0);
+  absl::Mutex mutex;
+  absl::Status status;
+  std::vector<std::thread> threads;
+  for (int64 i = 1; i < std::min<int64>(num_threads, order.size()); ++i) {
+    threads.emplace_back([&]() {
+      absl::StatusOr<std::unique_ptr<Lec>> worker = CreateWorker();
+      if (!worker.ok()) {
+        absl::MutexLock lock(&mutex);
+        status.Update(worker.status());
+        return;
+      }
+      worker.value()->SolveCones(output_indices, order, &next_cone, cache,
+                                 absl::MakeSpan(cone_results_));
+    });
+  }
+  SolveCones(output_indices, order, &next_cone, cache,
+             absl::MakeSpan(cone_results_));
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  XLS_RETURN_IF_ERROR(status);
+
+  if (model_) {
+    Z3_model_dec_ref(ctx(), model_.value());
+    model_ = absl::nullopt;
+  }
+  satisfiable_ = Z3_L_FALSE;
+  int64 failing = 0;
+  bool inconclusive = false;
+  while (failing < cone_results_.size() &&
+         (cone_results_[failing].equivalent ||
+          cone_results_[failing].inconclusive)) {
+    inconclusive |= cone_results_[failing].inconclusive;
+    ++failing;
+  }
+  if (failing == cone_results_.size()) {
+    // Without a mismatch there's no counterexample to reproduce.
+    if (inconclusive) {
+      satisfiable_ = Z3_L_UNDEF;
+      return false;
+    }
+    return true;
+  }
+
+  // Reproduce the first failing cone's counterexample in this context for
+  // ResultToString() and DumpIrTree().
+  Z3_solver_dec_ref(ctx(), solver_.value());
+  solver_ = CreateSolver(ctx(), /*num_threads=*/1);
+  for (Z3_ast constraint : constraint_nodes_) {
+    Z3_solver_assert(ctx(), solver_.value(), constraint);
+  }
+  Z3_solver_assert(ctx(), solver_.value(),
+                   ConeMiter(output_indices[failing]));
+  satisfiable_ = Z3_solver_check(ctx(), solver_.value());
+  if (satisfiable_ == Z3_L_TRUE) {
+    model_ = Z3_solver_get_model(ctx(), solver_.value());
+    Z3_model_inc_ref(ctx(), model_.value());
+  }
+  return false;
+}
+
+absl::StatusOr<std::unique_ptr<Lec>> Lec::CreateWorker() {
+  auto worker = absl::WrapUnique<Lec>(new Lec(ir_package_, ir_function_,
+                                              netlist_, netlist_module_name_,
+                                              schedule_, stage_));
+  XLS_RETURN_IF_ERROR(worker->Init());
+  if (constraints_ != nullptr) {
+    XLS_RETURN_IF_ERROR(worker->AddConstraints(constraints_));
+  }
+  XLS_RET_CHECK_EQ(worker->ir_outputs_.size(), ir_outputs_.size());
+  return worker;
+}
+
+void Lec::SolveCones(absl::Span<const int64> output_indices,
+                     absl::Span<const int64> order,
+                     std::atomic<int64>* next_cone, LecConeCache* cache,
+                     absl::Span<LecConeResult> results) {
+  for (int64 i = next_cone->fetch_add(1); i < order.size();
+       i = next_cone->fetch_add(1)) {
+    int64 output_index = output_indices[order[i]];
+    LecConeResult& result = results[order[i]];
+    absl::Time start = absl::Now();
+    std::string key;
+    if (cache != nullptr) {
+      key = ConeCacheKey(output_index);
+      result.cached = cache->Contains(key);
+    }
+    Z3_lbool satisfiable =
+        result.cached ? Z3_L_FALSE : SolveCone(output_index);
+    result.equivalent = satisfiable == Z3_L_FALSE;
+    result.inconclusive = satisfiable == Z3_L_UNDEF;
+    // Only proven cones are cached, so inconclusive ones are retried by later
+    // runs.
+    if (cache != nullptr && result.equivalent && !result.cached) {
+      cache->Insert(std::move(key));
+    }
+    result.solve_time = absl::Now() - start;
+    XLS_VLOG(2) << "Cone " << result.node->GetName() << "[" << result.bit_index
+                << "]: "
+                << (result.equivalent
+                        ? "equivalent"
+                        : (result.inconclusive ? "inconclusive" : "mismatch"))
+                << " in " << result.solve_time;
+  }
+}
+
+Z3_ast Lec::ConeMiter(int64 output_index) {
+  return Z3_mk_not(ctx(), Z3_mk_eq(ctx(), ir_outputs_[output_index],
+                                   netlist_outputs_[output_index]));
+}
+
+std::string Lec::ConeCacheKey(int64 output_index) {
+  // The SMT-LIB text shares common subexpressions, so it's linear in the size
+  // of the cone.
+  return CanonicalizeLetNames(Z3_benchmark_to_smtlib_string(
+      ctx(), /*name=*/"", /*logic=*/"", /*status=*/"", /*attributes=*/"",
+      constraint_nodes_.size(), constraint_nodes_.data(),
+      ConeMiter(output_index)));
+}
+
+Z3_lbool Lec::SolveCone(int64 output_index) {
+  Z3_solver solver = CreateSolver(ctx(), /*num_threads=*/1);
+  for (Z3_ast constraint : constraint_nodes_) {
+    Z3_solver_assert(ctx(), solver, constraint);
+  }
+  Z3_solver_assert(ctx(), solver, ConeMiter(output_index));
+  Z3_lbool satisfiable = Z3_solver_check(ctx(), solver);
+  Z3_solver_dec_ref(ctx(), solver);
+  return satisfiable;
+}
+
+int64 Lec::IrConeSize(const Node* node) {
+  absl::flat_hash_set<const Node*> seen = {node};
+  std::vector<const Node*> worklist = {node};
+  while (!worklist.empty()) {
+    const Node* cone_node = worklist.back();
+    worklist.pop_back();
+    if (input_mapping_.contains(cone_node)) {
+      continue;
+    }
+    for (const Node* operand : cone_node->operands()) {
+      if (seen.insert(operand).second) {
+        worklist.push_back(operand);
+      }
+    }
+  }
+  return seen.size();
 }
 
 std::string Lec::ResultToString() {
   std::vector<std::string> output;
-  output.push_back(SolverResultToString(ctx(), solver_.value(),
-                                        satisfiable_ ? Z3_L_TRUE : Z3_L_FALSE,
+  output.push_back(SolverResultToString(ctx(), solver_.value(), satisfiable_,
                                         /*hexify=*/true));
-  if (satisfiable_) {
+  if (satisfiable_ == Z3_L_TRUE) {
     for (const Node* node : ir_output_nodes_) {
       std::pair<std::string, std::string> outputs = GetComparisonStrings(node);
       std::string ir_string = outputs.first;
@@ -356,6 +681,7 @@ absl::flat_hash_map<std::string, Z3_ast> Lec::FlattenNetlistInputs() {
       // Then plop its output in.
       for (const auto& output : status_or_cell.value()->outputs()) {
         netlist_inputs[output.netref->name()] = bits[i];
+        netlist_input_names_.insert(output.netref->name());
       }
     }
   }
@@ -363,20 +689,31 @@ absl::flat_hash_map<std::string, Z3_ast> Lec::FlattenNetlistInputs() {
   return netlist_inputs;
 }
 
-absl::StatusOr<std::vector<Z3_ast>> Lec::GetNetlistZ3ForIr(const Node* node) {
-  std::vector<Z3_ast> netlist_output;
-
+absl::StatusOr<std::vector<NetRef>> Lec::GetOutputNetrefs(const Node* node) {
   XLS_ASSIGN_OR_RETURN(std::vector<NetRef> netrefs, GetIrNetrefs(node));
-  netlist_output.reserve(netrefs.size());
+  std::vector<NetRef> output_netrefs;
+  output_netrefs.reserve(netrefs.size());
   for (const auto& netref : netrefs) {
-    if (netref == nullptr) {
-      netlist_output.push_back(nullptr);
-    } else if (netref->name() == "output_valid") {
+    if (netref != nullptr && netref->name() == "output_valid") {
       // Drop output wires not part of the original signature.
       // TODO(rspringer): These special wires aren't necessarily fixed - they're
       // specified by codegen, and could change in the future. These need to be
       // properly handled (i.e., not hardcoded).
       continue;
+    }
+    output_netrefs.push_back(netref);
+  }
+  return output_netrefs;
+}
+
+absl::StatusOr<std::vector<Z3_ast>> Lec::GetNetlistZ3ForIr(const Node* node) {
+  std::vector<Z3_ast> netlist_output;
+
+  XLS_ASSIGN_OR_RETURN(std::vector<NetRef> netrefs, GetOutputNetrefs(node));
+  netlist_output.reserve(netrefs.size());
+  for (const auto& netref : netrefs) {
+    if (netref == nullptr) {
+      netlist_output.push_back(nullptr);
     } else {
       XLS_ASSIGN_OR_RETURN(Z3_ast z3_output,
                            netlist_translator_->GetTranslation(netref));
@@ -402,6 +739,11 @@ absl::Status Lec::CreateNetlistTranslator() {
 }
 
 void Lec::DumpIrTree() {
+  if (!model_.has_value()) {
+    std::cout << "No counterexample model; nothing to dump." << std::endl;
+    return;
+  }
+
   std::deque<const Node*> to_process;
   absl::flat_hash_set<const Node*> seen;
   for (const Node* node : ir_output_nodes_) {
@@ -15,11 +15,20 @@
 #ifndef XLS_SOLVERS_Z3_LEC_H_
 #define XLS_SOLVERS_Z3_LEC_H_
 
+#include <atomic>
+#include <filesystem>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "xls/common/integral_types.h"
 #include "xls/ir/package.h"
 #include "xls/netlist/netlist.h"
 #include "xls/scheduling/pipeline_schedule.h"
@@ -47,6 +56,51 @@ struct LecParams {
   std::string netlist_module_name;
 };
 
+// The set of output cones proven equivalent by Lec::RunParallel(), keyed by the
+// SMT-LIB text of each cone's miter (including any constraints). A cache may be
+// shared between Lec objects, e.g., those checking the stages of a pipeline, so
+// that identical cones are only proven once. A cache may also be saved to a
+// file and loaded by a later run. Thread-safe.
+class LecConeCache {
+ public:
+  bool Contains(const std::string& key) const;
+  void Insert(std::string key);
+  int64 size() const;
+
+  // Adds the keys of the cache saved at 'path' by Save().
+  absl::Status Load(const std::filesystem::path& path);
+
+  // Writes the keys of the cache to 'path'. Each key is written as its length
+  // in bytes on a line of its own followed by the key and a newline, as keys
+  // span multiple lines.
+  absl::Status Save(const std::filesystem::path& path) const;
+
+ private:
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_set<std::string> proven_ ABSL_GUARDED_BY(mutex_);
+};
+
+// The result of checking a single output bit in Lec::RunParallel().
+struct LecConeResult {
+  // The IR output node and the index of the bit within its flattened value, as
+  // numbered in the netlist's wire names.
+  const Node* node;
+  int64 bit_index;
+
+  // The number of IR nodes and netlist cells in the fan-in cone of the bit.
+  // The IR cone is that of the whole node, not just the bit.
+  int64 ir_cone_size;
+  int64 netlist_cone_size;
+
+  bool equivalent;
+  // True if the solver could neither prove nor refute the equivalence of the
+  // cone (Z3_L_UNDEF). Such a cone is neither equivalent nor a mismatch.
+  bool inconclusive;
+  // True if the cone was found in the cache rather than proven.
+  bool cached;
+  absl::Duration solve_time;
+};
+
 // Class for performing logical equivalence checks between a function specified
 // in XLS IR (perhaps converted from DSLX) and a netlist.
 class Lec {
@@ -72,10 +126,29 @@ class Lec {
   // Constraints can not be currently specified with per-stage evaluation.
   absl::Status AddConstraints(Function* constraints);
 
-  // Returns true of the netlist and IR are proved to be equivalent.
+  // Returns true of the netlist and IR are proved to be equivalent. Returns
+  // false on a mismatch or if the solver could not decide the check, which
+  // ResultToString() reports as an "undef" result.
   bool Run();
 
-  // Dumps all Z3 values corresponding to IR nodes in the input function.
+  // As Run(), but partitions the check into one miter per output bit, which
+  // only involves that bit's fan-in cone, and solves the cones on
+  // "num_threads" threads. Each thread translates the IR and netlist into its
+  // own Z3 context. Cones in "cache" (if non-null) are skipped, and newly
+  // proven cones are added to it; inconclusive cones are not. On a mismatch,
+  // the model of the first failing cone is kept for ResultToString() and
+  // DumpIrTree(). If no cone mismatches but some are inconclusive, the result
+  // is false and reported as "undef".
+  absl::StatusOr<bool> RunParallel(int num_threads,
+                                   LecConeCache* cache = nullptr);
+
+  // Returns the per-bit results of the last RunParallel(), in output order.
+  absl::Span<const LecConeResult> cone_results() const {
+    return cone_results_;
+  }
+
+  // Dumps all Z3 values corresponding to IR nodes in the input function. Only
+  // prints a note if there is no counterexample model to evaluate them in.
   void DumpIrTree();
 
   // Returns a textual description of the result.
@@ -91,6 +164,34 @@ class Lec {
   absl::Status CreateIrTranslator();
   absl::Status CreateNetlistTranslator();
 
+  // Creates a copy of this object (with any constraints) in a new Z3 context,
+  // for checking cones on another thread.
+  absl::StatusOr<std::unique_ptr<Lec>> CreateWorker();
+
+  // Claims cones via "next_cone" until none remain, checking each in this
+  // object's context and storing the result in "results". "output_indices"
+  // holds the index into ir_outputs_ of each result, and "order" the order in
+  // which to check them.
+  void SolveCones(absl::Span<const int64> output_indices,
+                  absl::Span<const int64> order, std::atomic<int64>* next_cone,
+                  LecConeCache* cache, absl::Span<LecConeResult> results);
+
+  // Returns the miter for the given output bit (an index into ir_outputs_):
+  // true iff the IR and netlist values of the bit differ.
+  Z3_ast ConeMiter(int64 output_index);
+
+  // Returns the LecConeCache key for the cone of the given output bit.
+  std::string ConeCacheKey(int64 output_index);
+
+  // Checks the miter of the given output bit: returns Z3_L_FALSE if the cone is
+  // proven equivalent, Z3_L_TRUE on a mismatch and Z3_L_UNDEF if the solver
+  // could not decide.
+  Z3_lbool SolveCone(int64 output_index);
+
+  // Returns the number of IR nodes in the fan-in cone of "node", stopping at
+  // the inputs in input_mapping_.
+  int64 IrConeSize(const Node* node);
+
   // Collects the XLS IR nodes that are inputs to this evaluation - either the
   // original function inputs for whole-function or first-stage equivalence
   // checks, or the stage inputs for all others.
@@ -122,6 +223,11 @@ class Lec {
   absl::StatusOr<std::vector<netlist::rtl::NetRef>> GetIrNetrefs(
       const Node* node);
 
+  // As above, but without the wires added by codegen (e.g., "output_valid"), so
+  // that the result lines up with the node's IR bits.
+  absl::StatusOr<std::vector<netlist::rtl::NetRef>> GetOutputNetrefs(
+      const Node* node);
+
   // Returns the name of the netlist wire corresponding to the input node.
   std::string NodeToNetlistName(const Node* node, absl::optional<int> bit_index,
                                 bool is_cell = true);
@@ -151,6 +257,25 @@ class Lec {
   std::vector<Z3_ast> ir_outputs_;
   std::vector<Z3_ast> netlist_outputs_;
 
+  // For each entry in ir_outputs_, the IR node and bit it came from, and the
+  // corresponding netlist wire (nullptr if absent from the netlist).
+  struct OutputBit {
+    const Node* node;
+    int64 bit_index;
+    netlist::rtl::NetRef netref;
+  };
+  std::vector<OutputBit> output_bits_;
+
+  // Names of the netlist wires bound to IR inputs.
+  absl::flat_hash_set<std::string> netlist_input_names_;
+
+  // The constraints function given to AddConstraints(), if any, and the
+  // resulting assertion.
+  Function* constraints_ = nullptr;
+  std::vector<Z3_ast> constraint_nodes_;
+
+  std::vector<LecConeResult> cone_results_;
+
   absl::optional<PipelineSchedule> schedule_;
   int stage_;
 
@@ -158,9 +283,9 @@ class Lec {
   // interface and use absl::optional to determine live-ness.
   absl::optional<Z3_solver> solver_;
 
-  // Satisfiable is equivalent to "model_.has_value()", but having an explicit
-  // value is more understandable.
-  bool satisfiable_;
+  // The result of the last check. model_ holds a counterexample iff it's
+  // Z3_L_TRUE.
+  Z3_lbool satisfiable_ = Z3_L_UNDEF;
   absl::optional<Z3_model> model_;
 };
 
@@ -16,6 +16,10 @@
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/temp_directory.h"
 #include "xls/common/status/matchers.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/netlist/cell_library.h"
@@ -29,6 +33,9 @@ namespace z3 {
 namespace {
 
 using netlist::rtl::Netlist;
+using status_testing::IsOkAndHolds;
+using status_testing::StatusIs;
+using ::testing::HasSubstr;
 
 absl::StatusOr<bool> Match(const std::string& ir_text,
                            const std::string& netlist_text, bool expect_equal) {
@@ -462,6 +469,231 @@ endmodule
   }
 }
 
+constexpr char kNotIr[] = R"(
+package p
+
+fn main(input: bits[4]) -> bits[4] {
+  ret not.2: bits[4] = not(input)
+}
+)";
+
+// The netlist for kNotIr, with bit "bad_bit" computed by an OR instead of an
+// inverter if it's non-negative.
+std::string NotNetlist(int bad_bit) {
+  std::string netlist = R"(
+module main ( clk, input_3_, input_2_, input_1_, input_0_, out_3_, out_2_, out_1_, out_0_);
+  input clk, input_3_, input_2_, input_1_, input_0_;
+  output out_3_, out_2_, out_1_, out_0_;
+  wire p0_input_3_, p0_input_2_, p0_input_1_, p0_input_0_,
+       p0_not_2_comb_3_, p0_not_2_comb_2_, p0_not_2_comb_1_, p0_not_2_comb_0_;
+)";
+  for (int i = 3; i >= 0; --i) {
+    absl::StrAppendFormat(&netlist,
+                          "  DFF p0_input_reg_%d_ ( .D(input_%d_), .CLK(clk), "
+                          ".Q(p0_input_%d_) );\n",
+                          i, i, i);
+  }
+  for (int i = 3; i >= 0; --i) {
+    if (i == bad_bit) {
+      absl::StrAppendFormat(&netlist,
+                            "  OR p0_not_2_%d_ ( .A(p0_input_%d_), "
+                            ".B(p0_input_%d_), .Z(p0_not_2_comb_%d_) );\n",
+                            i, i, i, i);
+    } else {
+      absl::StrAppendFormat(&netlist,
+                            "  INV p0_not_2_%d_ ( .A(p0_input_%d_), "
+                            ".ZN(p0_not_2_comb_%d_) );\n",
+                            i, i, i);
+    }
+  }
+  for (int i = 3; i >= 0; --i) {
+    absl::StrAppendFormat(&netlist,
+                          "  DFF p0_not_2_reg_%d_ (.D(p0_not_2_comb_%d_), "
+                          ".CLK(clk), .Q(out_%d_));\n",
+                          i, i, i);
+  }
+  absl::StrAppend(&netlist, "endmodule\n");
+  return netlist;
+}
+
+TEST(Z3LecTest, ParallelLec) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kNotIr));
+  XLS_ASSERT_OK_AND_ASSIGN(netlist::CellLibrary cell_library,
+                           netlist::MakeFakeCellLibrary());
+  std::string netlist_text = NotNetlist(/*bad_bit=*/-1);
+  netlist::rtl::Scanner scanner(netlist_text);
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<Netlist> netlist,
+      netlist::rtl::Parser::ParseNetlist(&cell_library, &scanner));
+
+  LecParams params;
+  XLS_ASSERT_OK_AND_ASSIGN(params.ir_function, package->EntryFunction());
+  params.ir_package = package.get();
+  params.netlist = netlist.get();
+  params.netlist_module_name = "main";
+
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Lec> lec, Lec::Create(params));
+  EXPECT_THAT(lec->RunParallel(/*num_threads=*/3), IsOkAndHolds(true));
+  ASSERT_EQ(lec->cone_results().size(), 4);
+  for (const LecConeResult& result : lec->cone_results()) {
+    EXPECT_TRUE(result.equivalent);
+    EXPECT_FALSE(result.cached);
+    EXPECT_EQ(result.node, params.ir_function->return_value());
+    // The IR cone is the not and its param; the netlist cone is an inverter
+    // and its output flop.
+    EXPECT_EQ(result.ir_cone_size, 2);
+    EXPECT_EQ(result.netlist_cone_size, 2);
+  }
+}
+
+TEST(Z3LecTest, ParallelLecFindsMismatch) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kNotIr));
+  XLS_ASSERT_OK_AND_ASSIGN(netlist::CellLibrary cell_library,
+                           netlist::MakeFakeCellLibrary());
+  std::string netlist_text = NotNetlist(/*bad_bit=*/1);
+  netlist::rtl::Scanner scanner(netlist_text);
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<Netlist> netlist,
+      netlist::rtl::Parser::ParseNetlist(&cell_library, &scanner));
+
+  LecParams params;
+  XLS_ASSERT_OK_AND_ASSIGN(params.ir_function, package->EntryFunction());
+  params.ir_package = package.get();
+  params.netlist = netlist.get();
+  params.netlist_module_name = "main";
+
+  for (int num_threads : {1, 4}) {
+    XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Lec> lec, Lec::Create(params));
+    EXPECT_THAT(lec->RunParallel(num_threads), IsOkAndHolds(false));
+    int64 mismatches = 0;
+    for (const LecConeResult& result : lec->cone_results()) {
+      mismatches += result.equivalent ? 0 : 1;
+    }
+    EXPECT_EQ(mismatches, 1);
+    // The counterexample is available in the Lec's own context.
+    EXPECT_THAT(lec->ResultToString(), HasSubstr("Output IR node"));
+  }
+}
+
+TEST(Z3LecTest, ParallelLecCachesProvenCones) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kNotIr));
+  XLS_ASSERT_OK_AND_ASSIGN(netlist::CellLibrary cell_library,
+                           netlist::MakeFakeCellLibrary());
+  std::string netlist_text = NotNetlist(/*bad_bit=*/2);
+  netlist::rtl::Scanner scanner(netlist_text);
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<Netlist> netlist,
+      netlist::rtl::Parser::ParseNetlist(&cell_library, &scanner));
+
+  LecParams params;
+  XLS_ASSERT_OK_AND_ASSIGN(params.ir_function, package->EntryFunction());
+  params.ir_package = package.get();
+  params.netlist = netlist.get();
+  params.netlist_module_name = "main";
+
+  LecConeCache cache;
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Lec> lec, Lec::Create(params));
+  EXPECT_THAT(lec->RunParallel(/*num_threads=*/2, &cache),
+              IsOkAndHolds(false));
+  EXPECT_EQ(cache.size(), 3);
+
+  // A second check of the same netlist only needs to solve the failing cone.
+  XLS_ASSERT_OK_AND_ASSIGN(lec, Lec::Create(params));
+  EXPECT_THAT(lec->RunParallel(/*num_threads=*/2, &cache),
+              IsOkAndHolds(false));
+  for (const LecConeResult& result : lec->cone_results()) {
+    EXPECT_EQ(result.cached, result.equivalent);
+  }
+  EXPECT_EQ(cache.size(), 3);
+}
+
+TEST(Z3LecTest, ParallelLecReportsInconclusiveCones) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kNotIr));
+  XLS_ASSERT_OK_AND_ASSIGN(netlist::CellLibrary cell_library,
+                           netlist::MakeFakeCellLibrary());
+  std::string netlist_text = NotNetlist(/*bad_bit=*/-1);
+  netlist::rtl::Scanner scanner(netlist_text);
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<Netlist> netlist,
+      netlist::rtl::Parser::ParseNetlist(&cell_library, &scanner));
+
+  LecParams params;
+  XLS_ASSERT_OK_AND_ASSIGN(params.ir_function, package->EntryFunction());
+  params.ir_package = package.get();
+  params.netlist = netlist.get();
+  params.netlist_module_name = "main";
+
+  // Starve the solver so that it gives up on every cone.
+  Z3_global_param_set("rlimit", "1");
+  LecConeCache cache;
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Lec> lec, Lec::Create(params));
+  absl::StatusOr<bool> equal = lec->RunParallel(/*num_threads=*/2, &cache);
+  Z3_global_param_reset_all();
+  EXPECT_THAT(equal, IsOkAndHolds(false));
+  ASSERT_EQ(lec->cone_results().size(), 4);
+  for (const LecConeResult& result : lec->cone_results()) {
+    EXPECT_FALSE(result.equivalent);
+    EXPECT_TRUE(result.inconclusive);
+  }
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_THAT(lec->ResultToString(), HasSubstr("satisfiable: undef"));
+}
+
+TEST(Z3LecTest, ConeCacheSurvivesSaveAndLoad) {
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Package> package,
+                           Parser::ParsePackage(kNotIr));
+  XLS_ASSERT_OK_AND_ASSIGN(netlist::CellLibrary cell_library,
+                           netlist::MakeFakeCellLibrary());
+  std::string netlist_text = NotNetlist(/*bad_bit=*/2);
+  netlist::rtl::Scanner scanner(netlist_text);
+  XLS_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<Netlist> netlist,
+      netlist::rtl::Parser::ParseNetlist(&cell_library, &scanner));
+
+  LecParams params;
+  XLS_ASSERT_OK_AND_ASSIGN(params.ir_function, package->EntryFunction());
+  params.ir_package = package.get();
+  params.netlist = netlist.get();
+  params.netlist_module_name = "main";
+
+  XLS_ASSERT_OK_AND_ASSIGN(TempDirectory temp_dir, TempDirectory::Create());
+  std::filesystem::path path = temp_dir.path() / "cone_cache";
+  {
+    LecConeCache cache;
+    XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Lec> lec, Lec::Create(params));
+    EXPECT_THAT(lec->RunParallel(/*num_threads=*/2, &cache),
+                IsOkAndHolds(false));
+    XLS_ASSERT_OK(cache.Save(path));
+  }
+
+  // The proven cones of the first run are cached in a fresh cache loaded from
+  // the file.
+  LecConeCache cache;
+  XLS_ASSERT_OK(cache.Load(path));
+  EXPECT_EQ(cache.size(), 3);
+  XLS_ASSERT_OK_AND_ASSIGN(std::unique_ptr<Lec> lec, Lec::Create(params));
+  EXPECT_THAT(lec->RunParallel(/*num_threads=*/2, &cache),
+              IsOkAndHolds(false));
+  for (const LecConeResult& result : lec->cone_results()) {
+    EXPECT_EQ(result.cached, result.equivalent);
+  }
+
+  // Saving and loading again is lossless.
+  XLS_ASSERT_OK_AND_ASSIGN(std::string contents, GetFileContents(path));
+  XLS_ASSERT_OK(cache.Save(path));
+  XLS_ASSERT_OK_AND_ASSIGN(std::string resaved_contents, GetFileContents(path));
+  EXPECT_EQ(resaved_contents, contents);
+
+  XLS_ASSERT_OK(SetFileContents(path, contents.substr(0, contents.size() / 2)));
+  EXPECT_THAT(LecConeCache().Load(path),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Malformed LEC cone cache")));
+}
+
 }  // namespace
 }  // namespace z3
 }  // namespace solvers
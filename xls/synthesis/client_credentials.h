@@ -0,0 +1,30 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef XLS_SYNTHESIS_CLIENT_CREDENTIALS_H_
+#define XLS_SYNTHESIS_CLIENT_CREDENTIALS_H_
+
+#include "grpcpp/security/credentials.h"
+
+namespace xls {
+namespace synthesis {
+
+// Returns the client credentials for the GRPC synthesis service. The C++
+// counterpart of client_credentials.py.
+std::shared_ptr<::grpc::ChannelCredentials> GetClientCredentials();
+
+}  // namespace synthesis
+}  // namespace xls
+
+#endif  // XLS_SYNTHESIS_CLIENT_CREDENTIALS_H_
@@ -16,12 +16,14 @@
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
 #include "absl/time/clock.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/init_xls.h"
 #include "xls/common/integral_types.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/data_structures/binary_decision_diagram.h"
 #include "xls/examples/sample_packages.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/package.h"
@@ -102,10 +104,22 @@ absl::Status RealMain(absl::string_view input_path) {
         BddFunction::Run(entry, absl::GetFlag(FLAGS_bdd_minterm_limit)));
     absl::Duration bdd_time = absl::Now() - start;
     total_time += bdd_time;
+    const BinaryDecisionDiagram& bdd = bdd_function->bdd();
+    BddStats stats = bdd.GetStats();
     std::cout << "BDD construction time: " << bdd_time << "\n";
-    std::cout << "BDD node count: " << bdd_function->bdd().size() << "\n";
-    std::cout << "BDD variable count: " << bdd_function->bdd().variable_count()
-              << "\n";
+    std::cout << "BDD node count: " << stats.node_count << "\n";
+    std::cout << "BDD peak node count: " << stats.peak_node_count << "\n";
+    std::cout << "BDD variable count: " << bdd.variable_count() << "\n";
+    std::cout << absl::StreamFormat("BDD memory usage: %.1f MiB\n",
+                                    stats.memory_bytes / (1024.0 * 1024.0));
+    std::cout << absl::StreamFormat(
+        "BDD if-then-else cache: %d entries, %d lookups, %.1f%% hits\n",
+        stats.ite_cache_size, stats.ite_cache_lookups,
+        stats.ite_cache_lookups == 0
+            ? 0.0
+            : 100.0 * stats.ite_cache_hits / stats.ite_cache_lookups);
+    std::cout << "BDD garbage collections: " << stats.gc_count << " (freed "
+              << stats.gc_freed_node_count << " nodes)\n";
 
     int64 number_bits = 0;
     for (Node* node : entry->nodes()) {
@@ -114,9 +128,14 @@ absl::Status RealMain(absl::string_view input_path) {
     std::cout << "Bits in graph: " << number_bits << "\n";
 
     int64 max_minterms = 0;
-    for (int64 i = 0; i < bdd_function->bdd().size(); ++i) {
-      max_minterms = std::max(
-          max_minterms, bdd_function->bdd().minterm_count(BddNodeIndex(i)));
+    for (Node* node : entry->nodes()) {
+      if (!node->GetType()->IsBits()) {
+        continue;
+      }
+      for (int64 i = 0; i < node->BitCountOrDie(); ++i) {
+        max_minterms = std::max(
+            max_minterms, bdd.minterm_count(bdd_function->GetBddNode(node, i)));
+      }
     }
     if (max_minterms == std::numeric_limits<int32>::max()) {
       std::cout << "Maximum minterms of any expression: INT32_MAX\n";
@@ -147,6 +166,7 @@ int main(int argc, char** argv) {
         argv[0], argv[0]);
   }
 
-  XLS_QCHECK_OK(xls::RealMain(positional_arguments[0]));
+  XLS_QCHECK_OK(xls::RealMain(
+      positional_arguments.empty() ? "" : positional_arguments[0]));
   return EXIT_SUCCESS;
 }
@@ -27,6 +27,7 @@
 #include "xls/common/math_util.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/delay_model/analyze_critical_path.h"
+#include "xls/delay_model/caching_delay_estimator.h"
 #include "xls/delay_model/delay_estimator.h"
 #include "xls/delay_model/delay_estimators.h"
 #include "xls/ir/ir_parser.h"
@@ -62,6 +63,9 @@ ABSL_FLAG(std::string, entry, "",
           "Entry function to use in lieu of the default.");
 ABSL_FLAG(std::string, delay_model, "",
           "Delay model name to use from registry.");
+ABSL_FLAG(int64, function_pass_threads, 1,
+          "Number of threads on which function-scoped optimization passes may "
+          "process different functions concurrently.");
 
 namespace xls {
 namespace {
@@ -100,9 +104,10 @@ absl::Status RunOptimizationAndPrintStats(Package* package) {
   std::unique_ptr<CompoundPass> pipeline = CreateStandardPassPipeline();
 
   absl::Time start = absl::Now();
+  PassOptions options;
+  options.function_pass_threads = absl::GetFlag(FLAGS_function_pass_threads);
   PassResults pass_results;
-  XLS_RETURN_IF_ERROR(
-      pipeline->Run(package, PassOptions(), &pass_results).status());
+  XLS_RETURN_IF_ERROR(pipeline->Run(package, options, &pass_results).status());
   absl::Duration total_time = absl::Now() - start;
   auto to_ms = [](absl::Duration d) { return d / absl::Milliseconds(1); };
   std::cout << absl::StreamFormat("Optimization time: %dms\n",
@@ -249,6 +254,41 @@ absl::StatusOr<PipelineSchedule> ScheduleAndPrintStats(
   return std::move(*scheduling_unit.schedule);
 }
 
+// Schedules the function with each of the register-minimizing scheduling
+// strategies and prints their run time and the resulting number of pipeline
+// register bits.
+absl::Status CompareSchedulingStrategies(
+    Function* f, const DelayEstimator& delay_estimator,
+    absl::optional<int64> clock_period_ps,
+    absl::optional<int64> pipeline_stages,
+    absl::optional<int64> clock_margin_percent) {
+  std::cout << "Scheduling strategies:\n";
+  for (auto strategy : {std::make_pair(SchedulingStrategy::MINIMIZE_REGISTERS,
+                                       "MINIMIZE_REGISTERS"),
+                        std::make_pair(SchedulingStrategy::MINIMIZE_REGISTERS_SDC,
+                                       "MINIMIZE_REGISTERS_SDC")}) {
+    SchedulingOptions options(strategy.first);
+    if (clock_period_ps.has_value()) {
+      options.clock_period_ps(*clock_period_ps);
+    }
+    if (pipeline_stages.has_value()) {
+      options.pipeline_stages(*pipeline_stages);
+    }
+    if (clock_margin_percent.has_value()) {
+      options.clock_margin_percent(*clock_margin_percent);
+    }
+    absl::Time start = absl::Now();
+    XLS_ASSIGN_OR_RETURN(PipelineSchedule schedule,
+                         PipelineSchedule::Run(f, delay_estimator, options));
+    absl::Duration total_time = absl::Now() - start;
+    std::cout << absl::StreamFormat(
+        "  %-24s time: %10.3fms  stages: %3d  pipeline register bits: %d\n",
+        strategy.second, absl::ToDoubleMilliseconds(total_time),
+        schedule.length(), schedule.CountInteriorPipelineRegisters());
+  }
+  return absl::OkStatus();
+}
+
 absl::Status PrintCodegenInfo(Function* f, const PipelineSchedule& schedule,
                               const BddQueryEngine& bdd_query_engine,
                               const DelayEstimator& delay_estimator,
@@ -375,7 +415,9 @@ absl::Status RealMain(absl::string_view path,
     XLS_ASSIGN_OR_RETURN(pdelay_estimator,
                          GetDelayEstimator(absl::GetFlag(FLAGS_delay_model)));
   }
-  const auto& delay_estimator = *pdelay_estimator;
+  // Delays are queried repeatedly for the same kinds of nodes by the critical
+  // path analysis and the schedulers below.
+  CachingDelayEstimator delay_estimator(*pdelay_estimator);
   XLS_RETURN_IF_ERROR(PrintCriticalPath(f, *query_engine, delay_estimator,
                                         effective_clock_period_ps));
 
@@ -386,7 +428,12 @@ absl::Status RealMain(absl::string_view path,
                               pipeline_stages, clock_margin_percent));
     XLS_RETURN_IF_ERROR(PrintCodegenInfo(f, schedule, *query_engine,
                                          delay_estimator, clock_period_ps));
+    XLS_RETURN_IF_ERROR(CompareSchedulingStrategies(
+        f, delay_estimator, clock_period_ps, pipeline_stages,
+        clock_margin_percent));
   }
+  std::cout << "Delay estimator cache: " << delay_estimator.StatsToString()
+            << "\n";
   return absl::OkStatus();
 }
 
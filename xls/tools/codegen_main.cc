@@ -12,13 +12,22 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+
 #include "absl/flags/flag.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "xls/codegen/combinational_generator.h"
+#include "xls/codegen/module_signature.h"
 #include "xls/codegen/module_signature.pb.h"
 #include "xls/codegen/pipeline_generator.h"
+#include "xls/codegen/vast.h"
+#include "xls/codegen/vast_sink.h"
+#include "xls/common/file/file_descriptor.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/init_xls.h"
 #include "xls/common/logging/logging.h"
@@ -63,6 +72,9 @@ ABSL_FLAG(
     "Specific output path for the module signature. If not specified then "
     "no module signature is generated.");
 ABSL_FLAG(std::string, entry, "", "Entry function for the package.");
+ABSL_FLAG(int64, parse_threads, 1,
+          "Number of threads on which the functions of the input IR are "
+          "parsed.");
 ABSL_FLAG(std::string, generator, "pipeline",
           "The generator to use when emitting the device function. Valid "
           "values: pipeline, combinational.");
@@ -111,9 +123,10 @@ namespace {
 absl::Status RealMain(absl::string_view ir_path, absl::string_view verilog_path,
                       absl::string_view signature_path,
                       absl::string_view schedule_path) {
-  XLS_ASSIGN_OR_RETURN(std::string ir_contents, GetFileContents(ir_path));
-  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> p,
-                       Parser::ParsePackage(ir_contents, ir_path));
+  XLS_ASSIGN_OR_RETURN(
+      std::unique_ptr<Package> p,
+      Parser::ParsePackageFile(ir_path, /*entry=*/absl::nullopt,
+                               absl::GetFlag(FLAGS_parse_threads)));
 
   Function* main;
   if (absl::GetFlag(FLAGS_entry).empty()) {
@@ -122,7 +135,10 @@ absl::Status RealMain(absl::string_view ir_path, absl::string_view verilog_path,
     XLS_ASSIGN_OR_RETURN(main, p->GetFunction(absl::GetFlag(FLAGS_entry)));
   }
 
-  verilog::ModuleGeneratorResult result;
+  // The module is built into 'file' and streamed from there into the output
+  // rather than first rendering the whole Verilog text into a string.
+  verilog::VerilogFile file;
+  verilog::ModuleSignature signature;
   if (absl::GetFlag(FLAGS_generator) == "pipeline") {
     XLS_QCHECK(absl::GetFlag(FLAGS_pipeline_stages) != 0 ||
                absl::GetFlag(FLAGS_clock_period_ps) != 0)
@@ -178,16 +194,17 @@ absl::Status RealMain(absl::string_view ir_path, absl::string_view verilog_path,
     }
 
     XLS_ASSIGN_OR_RETURN(
-        result, verilog::ToPipelineModuleText(*scheduling_unit.schedule, main,
-                                              pipeline_options));
+        signature, verilog::AddPipelineModule(*scheduling_unit.schedule, main,
+                                              pipeline_options, &file));
     if (!schedule_path.empty()) {
       XLS_RETURN_IF_ERROR(
           SetTextProtoFile(schedule_path, scheduling_unit.schedule->ToProto()));
     }
   } else if (absl::GetFlag(FLAGS_generator) == "combinational") {
-    XLS_ASSIGN_OR_RETURN(result,
-                         verilog::ToCombinationalModuleText(
-                             main, absl::GetFlag(FLAGS_use_system_verilog)));
+    XLS_ASSIGN_OR_RETURN(signature,
+                         verilog::AddCombinationalModule(
+                             main, absl::GetFlag(FLAGS_use_system_verilog),
+                             &file));
   } else {
     XLS_LOG(QFATAL) << absl::StreamFormat(
         "Invalid value for --generator: %s. Expected 'pipeline' or "
@@ -195,15 +212,22 @@ absl::Status RealMain(absl::string_view ir_path, absl::string_view verilog_path,
         absl::GetFlag(FLAGS_generator));
   }
   if (!signature_path.empty()) {
-    XLS_RETURN_IF_ERROR(
-        SetTextProtoFile(signature_path, result.signature.proto()));
+    XLS_RETURN_IF_ERROR(SetTextProtoFile(signature_path, signature.proto()));
   }
   if (verilog_path.empty()) {
-    std::cout << result.verilog_text;
-  } else {
-    XLS_RETURN_IF_ERROR(SetFileContents(verilog_path, result.verilog_text));
+    verilog::FileDescriptorSink sink(STDOUT_FILENO);
+    file.EmitTo(&sink);
+    return sink.Flush();
+  }
+  FileDescriptor fd(open(std::string(verilog_path).c_str(),
+                         O_WRONLY | O_CREAT | O_TRUNC, 0644));
+  if (fd.get() < 0) {
+    return absl::NotFoundError(
+        absl::StrFormat("Unable to open %s for writing", verilog_path));
   }
-  return absl::OkStatus();
+  verilog::FileDescriptorSink sink(fd.get());
+  file.EmitTo(&sink);
+  return sink.Flush();
 }
 
 }  // namespace
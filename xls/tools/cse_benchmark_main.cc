@@ -0,0 +1,221 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/integral_types.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/examples/sample_packages.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/package.h"
+#include "xls/ir/value_helpers.h"
+#include "xls/passes/cse_pass.h"
+#include "xls/passes/dce_pass.h"
+#include "xls/passes/inlining_pass.h"
+#include "xls/passes/unroll_pass.h"
+
+const char* kUsage = R"(
+Times the common subexpression elimination pass on the functions of an IR file
+or of a set of benchmarks. The unoptimized IR of the benchmarks is used. By
+default, loops are unrolled and invocations are inlined first, as in the
+optimization pipeline, which exposes the most redundancy. Usage:
+
+   cse_benchmark_main <ir_file>
+   cse_benchmark_main --benchmarks=sha256,crc32
+   cse_benchmark_main --benchmarks=all
+)";
+
+ABSL_FLAG(std::vector<std::string>, benchmarks, {},
+          "Comma-separated list of benchmarks to run CSE on.");
+ABSL_FLAG(bool, unroll, true,
+          "Unroll counted loops and inline invocations before running CSE.");
+ABSL_FLAG(absl::Duration, min_run_time, absl::Milliseconds(200),
+          "Minimum time to run CSE for on each package. The package is "
+          "re-parsed for each run.");
+ABSL_FLAG(int64, argument_sets, 16,
+          "Number of sets of random arguments with which to check that CSE "
+          "preserves the behavior of the entry function.");
+
+namespace xls {
+namespace {
+
+// Returns list of pairs of {name, IR text} for the specified benchmarks.
+absl::StatusOr<std::vector<std::pair<std::string, std::string>>> GetBenchmarks(
+    absl::Span<const std::string> benchmark_names) {
+  std::vector<std::pair<std::string, std::string>> packages;
+  std::vector<std::string> names;
+  if (benchmark_names.size() == 1 && benchmark_names.front() == "all") {
+    XLS_ASSIGN_OR_RETURN(names, sample_packages::GetBenchmarkNames());
+  } else {
+    names = std::vector<std::string>(benchmark_names.begin(),
+                                     benchmark_names.end());
+  }
+  for (const std::string& name : names) {
+    XLS_ASSIGN_OR_RETURN(
+        std::unique_ptr<Package> package,
+        sample_packages::GetBenchmark(name, /*optimized=*/false));
+    packages.push_back({name, package->DumpIr()});
+  }
+  return packages;
+}
+
+// Parses the package and prepares it for CSE.
+absl::StatusOr<std::unique_ptr<Package>> ParseAndPrepare(
+    absl::string_view ir_text) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                       Parser::ParsePackage(ir_text));
+  if (absl::GetFlag(FLAGS_unroll)) {
+    PassResults results;
+    // Unrolling turns loops into invocations of the loop body, so it comes
+    // first.
+    XLS_RETURN_IF_ERROR(
+        UnrollPass().Run(package.get(), PassOptions(), &results).status());
+    XLS_RETURN_IF_ERROR(
+        InliningPass().Run(package.get(), PassOptions(), &results).status());
+    XLS_RETURN_IF_ERROR(DeadCodeEliminationPass()
+                            .Run(package.get(), PassOptions(), &results)
+                            .status());
+  }
+  return package;
+}
+
+int64 NodeCount(Package* package) {
+  int64 count = 0;
+  for (auto& function : package->functions()) {
+    count += function->node_count();
+  }
+  return count;
+}
+
+absl::Status BenchmarkPackage(absl::string_view name,
+                              absl::string_view ir_text) {
+  XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                       ParseAndPrepare(ir_text));
+  // Use endl to flush cout so the banner appears before starting work on the
+  // benchmark.
+  std::cout << absl::StreamFormat("%s (%d functions, %d nodes)", name,
+                                  package->functions().size(),
+                                  NodeCount(package.get()))
+            << std::endl;
+
+  // Record the behavior of the entry function before CSE, if there is one.
+  Function* entry = package->EntryFunction().value_or(nullptr);
+  std::vector<std::vector<Value>> arg_sets;
+  std::vector<Value> expected;
+  if (entry != nullptr) {
+    std::minstd_rand engine;
+    for (int64 i = 0; i < absl::GetFlag(FLAGS_argument_sets); ++i) {
+      arg_sets.push_back(RandomFunctionArguments(entry, &engine));
+      XLS_ASSIGN_OR_RETURN(Value result,
+                           IrInterpreter::Run(entry, arg_sets.back()));
+      expected.push_back(result);
+    }
+  }
+
+  const absl::Duration min_run_time = absl::GetFlag(FLAGS_min_run_time);
+  absl::Duration run_time;
+  int64 runs = 0;
+  do {
+    PassResults results;
+    absl::Time start = absl::Now();
+    XLS_RETURN_IF_ERROR(
+        CsePass().Run(package.get(), PassOptions(), &results).status());
+    run_time += absl::Now() - start;
+    ++runs;
+    if (run_time < min_run_time) {
+      XLS_ASSIGN_OR_RETURN(package, ParseAndPrepare(ir_text));
+    }
+  } while (run_time < min_run_time);
+
+  PassResults results;
+  XLS_RETURN_IF_ERROR(DeadCodeEliminationPass()
+                          .Run(package.get(), PassOptions(), &results)
+                          .status());
+  if (entry != nullptr) {
+    XLS_ASSIGN_OR_RETURN(entry, package->EntryFunction());
+    for (int64 i = 0; i < arg_sets.size(); ++i) {
+      XLS_ASSIGN_OR_RETURN(Value result,
+                           IrInterpreter::Run(entry, arg_sets[i]));
+      if (result != expected[i]) {
+        return absl::InternalError(absl::StrFormat(
+            "Result after CSE differs from result before: %s vs %s",
+            result.ToString(), expected[i].ToString()));
+      }
+    }
+  }
+
+  std::cout << absl::StreamFormat(
+      "  cse: %10.3fms per run  (%d runs), %d nodes after cse and dce\n",
+      absl::ToDoubleMilliseconds(run_time) / runs, runs,
+      NodeCount(package.get()));
+  return absl::OkStatus();
+}
+
+absl::Status RealMain(absl::string_view input_path) {
+  std::vector<std::pair<std::string, std::string>> packages;
+  if (absl::GetFlag(FLAGS_benchmarks).empty()) {
+    XLS_QCHECK(!input_path.empty());
+    std::string path;
+    if (input_path == "-") {
+      path = "/dev/stdin";
+    } else {
+      path = std::string(input_path);
+    }
+    XLS_ASSIGN_OR_RETURN(std::string contents, GetFileContents(path));
+    packages.push_back({path, contents});
+  } else {
+    XLS_ASSIGN_OR_RETURN(packages,
+                         GetBenchmarks(absl::GetFlag(FLAGS_benchmarks)));
+  }
+
+  for (const auto& [name, ir_text] : packages) {
+    absl::Status status = BenchmarkPackage(name, ir_text);
+    if (!status.ok()) {
+      std::cout << "  Error: " << status << "\n";
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace xls
+
+int main(int argc, char** argv) {
+  std::vector<absl::string_view> positional_arguments =
+      xls::InitXls(kUsage, argc, argv);
+
+  if (positional_arguments.empty() && absl::GetFlag(FLAGS_benchmarks).empty()) {
+    XLS_LOG(QFATAL) << absl::StreamFormat(
+        "Expected invocation:\n  %s <path>\n  %s "
+        "--benchmarks=<benchmark-names>",
+        argv[0], argv[0]);
+  }
+
+  XLS_QCHECK_OK(xls::RealMain(
+      positional_arguments.empty() ? "" : positional_arguments[0]));
+  return EXIT_SUCCESS;
+}
@@ -27,10 +27,13 @@
 #include "xls/common/status/ret_check.h"
 #include "xls/common/status/status_macros.h"
 #include "xls/interpreter/ir_interpreter.h"
+#include "xls/interpreter/ir_interpreter_stats.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/value_helpers.h"
+#include "xls/jit/jit_object_cache.h"
 #include "xls/jit/llvm_ir_jit.h"
 #include "xls/passes/passes.h"
+#include "xls/passes/profile_guided_narrowing_pass.h"
 #include "xls/passes/standard_pipeline.h"
 
 const char kUsage[] = R"(
@@ -65,9 +68,19 @@ Evaluate IR after every optimization pass:
 
 Evaluate IR using the JIT and with the interpreter and compare the results:
   eval_ir_main --test_llvm_jit --random_inputs=100  IR_FILE
+
+Specialize IR on the bits which had the same value for every input of a
+training set. ENTRY__narrowed agrees with ENTRY on the inputs for which
+ENTRY__guard returns 1:
+  eval_ir_main --input_file=TRAINING_FILE \
+      --profile_narrowed_ir_path=NARROWED_IR_FILE IR_FILE
+  eval_ir_main --input_file=INPUT_FILE --entry=ENTRY__guard NARROWED_IR_FILE
 )";
 
 ABSL_FLAG(std::string, entry, "", "Entry function name to evaluate.");
+ABSL_FLAG(int64, parse_threads, 1,
+          "Number of threads on which the functions of the input IR are "
+          "parsed.");
 ABSL_FLAG(std::string, input, "",
           "The input to the function as a semicolon-separated list of typed "
           "values. For example: \"bits[32]:42; (bits[7]:0, bits[20]:4)\"");
@@ -101,6 +114,28 @@ ABSL_FLAG(bool, test_llvm_jit, false,
 ABSL_FLAG(int64, llvm_opt_level, 3,
           "The optimization level of the LLVM JIT. Valid values are from 0 (no "
           "optimizations) to 3 (maximum optimizations).");
+ABSL_FLAG(std::string, jit_object_cache_dir, "",
+          "If specified, compiled JIT code is cached in this directory and "
+          "reused by later invocations evaluating the same IR.");
+ABSL_FLAG(int64, jit_object_cache_max_bytes,
+          xls::JitObjectCache::kDefaultMaxSizeBytes,
+          "The maximum total size of the objects in --jit_object_cache_dir; "
+          "least-recently used objects are evicted beyond this.");
+ABSL_FLAG(bool, interpreter_stats, false,
+          "Evaluate the inputs with the interpreter (before any optimizations) "
+          "and print its statistics to stderr, e.g. the bits of each node "
+          "which had the same value for every input.");
+ABSL_FLAG(std::string, profile_narrowed_ir_path, "",
+          "If specified, record the value profile of the entry function by "
+          "evaluating the inputs with the interpreter, e.g. over a set of "
+          "training inputs, and write the package specialized on the profile "
+          "by ProfileGuidedNarrowingPass to this path. The entry function "
+          "is unchanged; <entry>__narrowed and <entry>__guard functions are "
+          "added.");
+ABSL_FLAG(bool, profile_params_only, false,
+          "With --profile_narrowed_ir_path, only assume the profiled bits of "
+          "parameters, so that <entry>__guard is a cheap check of the "
+          "arguments.");
 
 ABSL_FLAG(
     std::string, test_only_inject_jit_result, "",
@@ -124,18 +159,40 @@ std::string ArgsToString(absl::Span<const Value> args) {
   });
 }
 
+// Returns the JIT object cache specified by the flags, or nullptr if none was.
+absl::StatusOr<JitObjectCache*> GetJitObjectCache() {
+  static JitObjectCache* cache = nullptr;
+  if (cache == nullptr && !absl::GetFlag(FLAGS_jit_object_cache_dir).empty()) {
+    XLS_ASSIGN_OR_RETURN(
+        std::unique_ptr<JitObjectCache> new_cache,
+        JitObjectCache::Create(absl::GetFlag(FLAGS_jit_object_cache_dir),
+                               absl::GetFlag(FLAGS_jit_object_cache_max_bytes)));
+    cache = new_cache.release();
+  }
+  return cache;
+}
+
 // Evaluates the function with the given ArgSets. Returns an error if the result
 // does not match expectations (if any). 'actual_src' and 'expected_src' are
 // string descriptions of the sources of the actual results and expected
-// results, respectively. These strings are included in error messages.
+// results, respectively. These strings are included in error messages. If
+// 'stats' is non-null, the interpreter must be used and records its statistics
+// in it.
 absl::StatusOr<std::vector<Value>> Eval(
     Function* f, absl::Span<const ArgSet> arg_sets, bool use_jit,
     absl::string_view actual_src = "actual",
-    absl::string_view expected_src = "expected") {
+    absl::string_view expected_src = "expected",
+    InterpreterStats* stats = nullptr) {
+  XLS_RET_CHECK(stats == nullptr || !use_jit);
   std::unique_ptr<LlvmIrJit> jit;
   if (use_jit) {
-    XLS_ASSIGN_OR_RETURN(
-        jit, LlvmIrJit::Create(f, absl::GetFlag(FLAGS_llvm_opt_level)));
+    XLS_ASSIGN_OR_RETURN(JitObjectCache * cache, GetJitObjectCache());
+    XLS_ASSIGN_OR_RETURN(jit, LlvmIrJit::Create(
+                                  f, absl::GetFlag(FLAGS_llvm_opt_level), cache));
+    if (cache != nullptr) {
+      XLS_VLOG(1) << absl::StreamFormat("JIT object cache: %d hits, %d misses",
+                                        cache->hits(), cache->misses());
+    }
   }
 
   std::vector<Value> results;
@@ -149,7 +206,7 @@ absl::StatusOr<std::vector<Value>> Eval(
                                          FLAGS_test_only_inject_jit_result)));
       }
     } else {
-      XLS_ASSIGN_OR_RETURN(result, IrInterpreter::Run(f, arg_set.args));
+      XLS_ASSIGN_OR_RETURN(result, IrInterpreter::Run(f, arg_set.args, stats));
     }
     std::cout << result.ToString(FormatPreference::kHex) << std::endl;
 
@@ -217,14 +274,40 @@ absl::Status Run(Package* package, absl::Span<const ArgSet> arg_sets_in) {
   // Run the argsets through the IR before any optimizations. Write in the
   // results as the expected values if the expected value is not already
   // set. These expected values are used in any later evaluation after
-  // optimizations.
-  XLS_ASSIGN_OR_RETURN(std::vector<Value> results,
-                       Eval(f, arg_sets, absl::GetFlag(FLAGS_use_llvm_jit)));
+  // optimizations. Statistics are only recorded by the interpreter.
+  const std::string narrowed_ir_path =
+      absl::GetFlag(FLAGS_profile_narrowed_ir_path);
+  const bool record_stats =
+      absl::GetFlag(FLAGS_interpreter_stats) || !narrowed_ir_path.empty();
+  InterpreterStats stats;
+  XLS_ASSIGN_OR_RETURN(
+      std::vector<Value> results,
+      Eval(f, arg_sets, absl::GetFlag(FLAGS_use_llvm_jit) && !record_stats,
+           "actual", "expected", record_stats ? &stats : nullptr));
   for (int64 i = 0; i < arg_sets.size(); ++i) {
     if (!arg_sets[i].expected.has_value()) {
       arg_sets[i].expected = results[i];
     }
   }
+  if (absl::GetFlag(FLAGS_interpreter_stats)) {
+    std::cerr << stats.ToReport();
+  }
+  if (!narrowed_ir_path.empty()) {
+    // Narrow a copy of the package so the added functions do not take part in
+    // the optimization and evaluation below. The copy is made through the
+    // binary IR format, which preserves the node ids keying the profile.
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> narrowed_package,
+                         Parser::ParsePackage(package->Serialize()));
+    ProfileGuidedNarrowingPass narrowing(
+        stats.GetValueProfile(), absl::GetFlag(FLAGS_profile_params_only));
+    PassResults narrowing_results;
+    XLS_RETURN_IF_ERROR(narrowing
+                            .Run(narrowed_package.get(), PassOptions(),
+                                 &narrowing_results)
+                            .status());
+    XLS_RETURN_IF_ERROR(
+        SetFileContents(narrowed_ir_path, narrowed_package->DumpIr()));
+  }
 
   // Run optimizations (optionally) and check the results against expectations
   // (either expected result passed in on the command line or the result
@@ -264,15 +347,14 @@ absl::Status RealMain(absl::string_view input_path) {
   if (input_path == "-") {
     input_path = "/dev/stdin";
   }
-  XLS_ASSIGN_OR_RETURN(std::string contents, GetFileContents(input_path));
-  std::unique_ptr<Package> package;
-  if (absl::GetFlag(FLAGS_entry).empty()) {
-    XLS_ASSIGN_OR_RETURN(package, Parser::ParsePackage(contents, input_path));
-  } else {
-    XLS_ASSIGN_OR_RETURN(package,
-                         Parser::ParsePackageWithEntry(
-                             contents, absl::GetFlag(FLAGS_entry), input_path));
+  absl::optional<std::string> entry;
+  if (!absl::GetFlag(FLAGS_entry).empty()) {
+    entry = absl::GetFlag(FLAGS_entry);
   }
+  XLS_ASSIGN_OR_RETURN(
+      std::unique_ptr<Package> package,
+      Parser::ParsePackageFile(input_path, entry,
+                               absl::GetFlag(FLAGS_parse_threads)));
   XLS_ASSIGN_OR_RETURN(Function * f, package->EntryFunction());
 
   std::vector<ArgSet> arg_sets;
@@ -199,6 +199,46 @@ class EvalMainTest(absltest.TestCase):
     self.assertIn('Miscompare for input "bits[32]:0x42; bits[32]:0x123"',
                   comp.stderr.decode('utf-8'))
 
+  def test_interpreter_stats(self):
+    ir_file = self.create_tempfile(content=ADD_IR)
+    comp = subprocess.run([
+        EVAL_IR_MAIN_PATH, '--input=bits[32]:0x42; bits[32]:0x123',
+        '--interpreter_stats', ir_file.full_path
+    ],
+                          stdout=subprocess.PIPE,
+                          stderr=subprocess.PIPE,
+                          check=True)
+    self.assertEqual(comp.stdout.decode('utf-8').strip(), 'bits[32]:0x165')
+    self.assertIn('Interpreter stats report', comp.stderr.decode('utf-8'))
+
+  def test_profile_narrowed_ir(self):
+    ir_file = self.create_tempfile(content=ADD_IR)
+    training_file = self.create_tempfile(content='\n'.join(
+        ('bits[32]:0x1; bits[32]:0x10', 'bits[32]:0x3; bits[32]:0x10',
+         'bits[32]:0x5; bits[32]:0x10')))
+    narrowed_file = self.create_tempfile()
+    subprocess.check_call([
+        EVAL_IR_MAIN_PATH, '--input_file=' + training_file.full_path,
+        '--profile_narrowed_ir_path=' + narrowed_file.full_path,
+        ir_file.full_path
+    ])
+
+    # The narrowed function agrees with the original on the training inputs.
+    expected_file = self.create_tempfile(
+        content='bits[32]:0x11\nbits[32]:0x13\nbits[32]:0x15')
+    subprocess.check_call([
+        EVAL_IR_MAIN_PATH, '--input_file=' + training_file.full_path,
+        '--expected_file=' + expected_file.full_path, '--entry=foo__narrowed',
+        narrowed_file.full_path
+    ])
+
+    # Bit 3 of x was zero in training so the guard rejects 0x9.
+    result = subprocess.check_output([
+        EVAL_IR_MAIN_PATH, '--input=bits[32]:0x9; bits[32]:0x10',
+        '--entry=foo__guard', narrowed_file.full_path
+    ])
+    self.assertEqual(result.decode('utf-8').strip(), 'bits[1]:0x0')
+
 
 if __name__ == '__main__':
   test_base.main()
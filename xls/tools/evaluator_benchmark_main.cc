@@ -0,0 +1,232 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/integral_types.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/examples/sample_packages.h"
+#include "xls/interpreter/bytecode_interpreter.h"
+#include "xls/interpreter/flat_ir_interpreter.h"
+#include "xls/interpreter/ir_interpreter.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/package.h"
+#include "xls/ir/value_helpers.h"
+#include "xls/jit/llvm_ir_jit.h"
+
+const char* kUsage = R"(
+Compares the setup time and per-call run time of the IR evaluators
+(IrInterpreter, FlatIrInterpreter, BytecodeInterpreter and LlvmIrJit) on the
+entry function of an IR file or of a set of benchmarks. Usage:
+
+   evaluator_benchmark_main <ir_file>
+   evaluator_benchmark_main --benchmarks=sha256,crc32
+   evaluator_benchmark_main --benchmarks=all
+)";
+
+ABSL_FLAG(std::vector<std::string>, benchmarks, {},
+          "Comma-separated list of benchmarks to evaluate.");
+ABSL_FLAG(int64, argument_sets, 16,
+          "Number of sets of random arguments to evaluate with.");
+ABSL_FLAG(absl::Duration, min_run_time, absl::Milliseconds(200),
+          "Minimum time to run each evaluator for. Runs cycle through the "
+          "argument sets until this much time has passed.");
+ABSL_FLAG(int64, random_seed, 42, "Seed for argument generation.");
+
+namespace xls {
+namespace {
+
+// Return list of pairs of {name, Package} for the specified benchmarks.
+absl::StatusOr<std::vector<std::pair<std::string, std::unique_ptr<Package>>>>
+GetBenchmarks(absl::Span<const std::string> benchmark_names) {
+  std::vector<std::pair<std::string, std::unique_ptr<Package>>> packages;
+  std::vector<std::string> names;
+  if (benchmark_names.size() == 1 && benchmark_names.front() == "all") {
+    XLS_ASSIGN_OR_RETURN(names, sample_packages::GetBenchmarkNames());
+  } else {
+    names = std::vector<std::string>(benchmark_names.begin(),
+                                     benchmark_names.end());
+  }
+  for (const std::string& name : names) {
+    XLS_ASSIGN_OR_RETURN(
+        std::unique_ptr<Package> package,
+        sample_packages::GetBenchmark(name, /*optimized=*/true));
+    packages.push_back({name, std::move(package)});
+  }
+  return packages;
+}
+
+// An evaluator under test: "setup" prepares it for running the function
+// (e.g., compiles it), after which "run" may be called repeatedly.
+struct Evaluator {
+  std::string name;
+  std::function<absl::Status()> setup;
+  std::function<absl::StatusOr<Value>(absl::Span<const Value>)> run;
+};
+
+// Times the evaluator and checks its results against "expected". Prints a
+// line of the results table.
+absl::Status TimeEvaluator(Evaluator& evaluator,
+                           absl::Span<const std::vector<Value>> arg_sets,
+                           absl::Span<const Value> expected) {
+  absl::Time start = absl::Now();
+  XLS_RETURN_IF_ERROR(evaluator.setup());
+  absl::Duration setup_time = absl::Now() - start;
+
+  for (int64 i = 0; i < arg_sets.size(); ++i) {
+    XLS_ASSIGN_OR_RETURN(Value result, evaluator.run(arg_sets[i]));
+    if (result != expected[i]) {
+      return absl::InternalError(absl::StrFormat(
+          "%s result differs from IrInterpreter's: %s vs %s", evaluator.name,
+          result.ToString(), expected[i].ToString()));
+    }
+  }
+
+  const absl::Duration min_run_time = absl::GetFlag(FLAGS_min_run_time);
+  int64 runs = 0;
+  start = absl::Now();
+  absl::Duration run_time;
+  do {
+    for (const std::vector<Value>& args : arg_sets) {
+      XLS_RETURN_IF_ERROR(evaluator.run(args).status());
+    }
+    runs += arg_sets.size();
+    run_time = absl::Now() - start;
+  } while (run_time < min_run_time);
+
+  std::cout << absl::StreamFormat(
+      "  %-20s setup: %10.3fms  per call: %12.3fus  (%d calls)\n",
+      evaluator.name, absl::ToDoubleMilliseconds(setup_time),
+      absl::ToDoubleMicroseconds(run_time) / runs, runs);
+  return absl::OkStatus();
+}
+
+absl::Status BenchmarkFunction(Function* f) {
+  std::minstd_rand engine(absl::GetFlag(FLAGS_random_seed));
+  std::vector<std::vector<Value>> arg_sets;
+  for (int64 i = 0; i < absl::GetFlag(FLAGS_argument_sets); ++i) {
+    arg_sets.push_back(RandomFunctionArguments(f, &engine));
+  }
+  std::vector<Value> expected;
+  for (const std::vector<Value>& args : arg_sets) {
+    XLS_ASSIGN_OR_RETURN(Value result, IrInterpreter::Run(f, args));
+    expected.push_back(result);
+  }
+
+  std::unique_ptr<FlatIrInterpreter> flat_interpreter;
+  std::unique_ptr<BytecodeInterpreter> bytecode_interpreter;
+  std::unique_ptr<LlvmIrJit> jit;
+  std::vector<Evaluator> evaluators = {
+      {"IrInterpreter", [] { return absl::OkStatus(); },
+       [&](absl::Span<const Value> args) {
+         return IrInterpreter::Run(f, args);
+       }},
+      {"FlatIrInterpreter",
+       [&]() -> absl::Status {
+         XLS_ASSIGN_OR_RETURN(flat_interpreter, FlatIrInterpreter::Create(f));
+         return absl::OkStatus();
+       },
+       [&](absl::Span<const Value> args) {
+         return flat_interpreter->Run(args);
+       }},
+      {"BytecodeInterpreter",
+       [&]() -> absl::Status {
+         XLS_ASSIGN_OR_RETURN(bytecode_interpreter,
+                              BytecodeInterpreter::Create(f));
+         return absl::OkStatus();
+       },
+       [&](absl::Span<const Value> args) {
+         return bytecode_interpreter->Run(args);
+       }},
+      {"LlvmIrJit",
+       [&]() -> absl::Status {
+         XLS_ASSIGN_OR_RETURN(jit, LlvmIrJit::Create(f));
+         return absl::OkStatus();
+       },
+       [&](absl::Span<const Value> args) { return jit->Run(args); }},
+  };
+  for (Evaluator& evaluator : evaluators) {
+    XLS_RETURN_IF_ERROR(TimeEvaluator(evaluator, arg_sets, expected));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status RealMain(absl::string_view input_path) {
+  std::vector<std::pair<std::string, std::unique_ptr<Package>>> packages;
+  if (absl::GetFlag(FLAGS_benchmarks).empty()) {
+    XLS_QCHECK(!input_path.empty());
+    std::string path;
+    if (input_path == "-") {
+      path = "/dev/stdin";
+    } else {
+      path = std::string(input_path);
+    }
+    XLS_ASSIGN_OR_RETURN(std::string contents, GetFileContents(path));
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                         Parser::ParsePackage(contents, path));
+    packages.push_back({path, std::move(package)});
+  } else {
+    XLS_ASSIGN_OR_RETURN(packages,
+                         GetBenchmarks(absl::GetFlag(FLAGS_benchmarks)));
+  }
+
+  for (const auto& pair : packages) {
+    const std::string& name = pair.first;
+    const auto& package = pair.second;
+    XLS_ASSIGN_OR_RETURN(Function * entry, package->EntryFunction());
+    // Use endl to flush cout so the banner appears before starting work on the
+    // benchmark.
+    std::cout << absl::StreamFormat("%s (%d nodes)", name, entry->node_count())
+              << std::endl;
+    absl::Status status = BenchmarkFunction(entry);
+    if (!status.ok()) {
+      // Keep going; some benchmarks use features not supported by all
+      // evaluators.
+      std::cout << "  Error: " << status << "\n";
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace xls
+
+int main(int argc, char** argv) {
+  std::vector<absl::string_view> positional_arguments =
+      xls::InitXls(kUsage, argc, argv);
+
+  if (positional_arguments.empty() && absl::GetFlag(FLAGS_benchmarks).empty()) {
+    XLS_LOG(QFATAL) << absl::StreamFormat(
+        "Expected invocation:\n  %s <path>\n  %s "
+        "--benchmarks=<benchmark-names>",
+        argv[0], argv[0]);
+  }
+
+  XLS_QCHECK_OK(xls::RealMain(
+      positional_arguments.empty() ? "" : positional_arguments[0]));
+  return EXIT_SUCCESS;
+}
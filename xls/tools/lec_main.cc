@@ -14,12 +14,18 @@
 
 // Tool to prove or disprove logical equivalence of XLS IR and a netlist.
 
+#include <algorithm>
+#include <filesystem>
+
 #include "absl/base/internal/sysinfo.h"
 #include "absl/flags/flag.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/file/get_runfile_path.h"
 #include "xls/common/init_xls.h"
@@ -78,6 +84,21 @@ ABSL_FLAG(int32, stage, -1,
           "Pipeline stage to evaluate. Requires --schedule.\n"
           "If \"schedule\" is set, but this is not, then the entire module "
           "will be evaluated.");
+ABSL_FLAG(bool, partition_cones, false,
+          "Check the fan-in cone of each output bit separately, in parallel, "
+          "instead of all outputs in one problem, and print the time taken by "
+          "each cone.");
+ABSL_FLAG(int32, num_threads, 0,
+          "Number of threads to check cones on with --partition_cones. If 0, "
+          "one per CPU is used.");
+ABSL_FLAG(std::string, cone_cache, "",
+          "With --partition_cones, path of a file of cones already proven "
+          "equivalent. Cones found in it aren't proven again and the newly "
+          "proven cones are added to it. The file is created if it doesn't "
+          "exist. If unset, proven cones are only shared within this run.");
+ABSL_FLAG(int32, cone_report_limit, 20,
+          "With --partition_cones, the number of cones to report, slowest "
+          "first. If negative, all cones are reported.");
 
 namespace xls {
 namespace {
@@ -137,6 +158,49 @@ void DumpTree(Z3_context ctx, Z3_model model, IrTranslator* translator) {
   }
 }
 
+// Prints the results of a cone-partitioned check, slowest cone first.
+void PrintConeReport(absl::Span<const solvers::z3::LecConeResult> results,
+                     int limit) {
+  std::vector<const solvers::z3::LecConeResult*> sorted;
+  int64 num_cached = 0;
+  int64 num_mismatched = 0;
+  int64 num_inconclusive = 0;
+  absl::Duration total_time;
+  for (const solvers::z3::LecConeResult& result : results) {
+    sorted.push_back(&result);
+    num_cached += result.cached ? 1 : 0;
+    num_mismatched += result.equivalent || result.inconclusive ? 0 : 1;
+    num_inconclusive += result.inconclusive ? 1 : 0;
+    total_time += result.solve_time;
+  }
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const solvers::z3::LecConeResult* a,
+                      const solvers::z3::LecConeResult* b) {
+                     return a->solve_time > b->solve_time;
+                   });
+  if (limit >= 0 && limit < sorted.size()) {
+    sorted.resize(limit);
+  }
+
+  std::cout << absl::StreamFormat(
+      "%d cones: %d cached, %d mismatched, %d inconclusive; %.1f s total "
+      "solve time\n",
+      results.size(), num_cached, num_mismatched, num_inconclusive,
+      absl::ToDoubleSeconds(total_time));
+  std::cout << absl::StreamFormat("%12s %10s %10s  %-12s  %s\n", "time (ms)",
+                                  "IR nodes", "cells", "result", "output bit");
+  for (const solvers::z3::LecConeResult* result : sorted) {
+    std::cout << absl::StreamFormat(
+        "%12.1f %10d %10d  %-12s  %s[%d]\n",
+        absl::ToDoubleMilliseconds(result->solve_time), result->ir_cone_size,
+        result->netlist_cone_size,
+        result->equivalent
+            ? (result->cached ? "cached" : "equivalent")
+            : (result->inconclusive ? "INCONCLUSIVE" : "MISMATCH"),
+        result->node->GetName(), result->bit_index);
+  }
+}
+
 }  // namespace
 
 absl::Status RealMain(absl::string_view ir_path,
@@ -146,7 +210,10 @@ absl::Status RealMain(absl::string_view ir_path,
                       absl::string_view cell_proto_path,
                       absl::string_view netlist_path,
                       absl::string_view constraints_file,
-                      absl::string_view schedule_path, int stage) {
+                      absl::string_view schedule_path, int stage,
+                      bool partition_cones, int num_threads,
+                      const std::filesystem::path& cone_cache_path,
+                      int cone_report_limit) {
   solvers::z3::LecParams lec_params;
   XLS_ASSIGN_OR_RETURN(std::string ir_text, GetFileContents(ir_path));
   XLS_ASSIGN_OR_RETURN(auto package, Parser::ParsePackage(ir_text));
@@ -194,7 +261,23 @@ absl::Status RealMain(absl::string_view ir_path,
     XLS_RETURN_IF_ERROR(lec->AddConstraints(function));
   }
 
-  bool equal = lec->Run();
+  bool equal;
+  if (partition_cones) {
+    if (num_threads == 0) {
+      num_threads = absl::base_internal::NumCPUs();
+    }
+    solvers::z3::LecConeCache cache;
+    if (!cone_cache_path.empty() && FileExists(cone_cache_path).ok()) {
+      XLS_RETURN_IF_ERROR(cache.Load(cone_cache_path));
+    }
+    XLS_ASSIGN_OR_RETURN(equal, lec->RunParallel(num_threads, &cache));
+    if (!cone_cache_path.empty()) {
+      XLS_RETURN_IF_ERROR(cache.Save(cone_cache_path));
+    }
+    PrintConeReport(lec->cone_results(), cone_report_limit);
+  } else {
+    equal = lec->Run();
+  }
   std::cout << lec->ResultToString() << std::endl;
   if (!equal) {
     std::cout << std::endl << "IR/netlist value dump:" << std::endl;
@@ -226,10 +309,16 @@ int main(int argc, char* argv[]) {
   XLS_QCHECK(stage == -1 || !schedule_path.empty())
       << "--schedule_path must be specified with --stage.";
 
+  int num_threads = absl::GetFlag(FLAGS_num_threads);
+  XLS_QCHECK_GE(num_threads, 0) << "--num_threads must be non-negative.";
+
   XLS_QCHECK_OK(xls::RealMain(ir_path, absl::GetFlag(FLAGS_entry_function_name),
                               absl::GetFlag(FLAGS_netlist_module_name),
                               cell_lib_path, cell_proto_path, netlist_path,
                               absl::GetFlag(FLAGS_constraints_file),
-                              schedule_path, stage));
+                              schedule_path, stage,
+                              absl::GetFlag(FLAGS_partition_cones), num_threads,
+                              absl::GetFlag(FLAGS_cone_cache),
+                              absl::GetFlag(FLAGS_cone_report_limit)));
   return 0;
 }
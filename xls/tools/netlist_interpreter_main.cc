@@ -14,11 +14,22 @@
 
 // Driver for NetlistInterpreter: loads a netlist from disk, feeds Value input
 // (taken from the command line) into it, and prints the result.
+//
+// With --stimulus_file, instead evaluates every sample in the given file using
+// the bit-parallel netlist evaluator and streams one result per line.
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
 #include "xls/codegen/flattening.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/init_xls.h"
@@ -27,6 +38,7 @@
 #include "xls/ir/bits_ops.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/value.h"
+#include "xls/netlist/bit_parallel_interpreter.h"
 #include "xls/netlist/cell_library.h"
 #include "xls/netlist/function_extractor.h"
 #include "xls/netlist/interpreter.h"
@@ -48,6 +60,11 @@ ABSL_FLAG(std::string, input, "",
           "The input to the function as a semicolon-separated list of typed "
           "values. For example: \"bits[32]:42; (bits[7]:0, bits[20]:4)\". "
           "Values must be listed in the same order as the module inputs.");
+ABSL_FLAG(std::string, stimulus_file, "",
+          "Path to a file of input samples, one per line, each formatted as "
+          "for --input. All samples are evaluated in batches with the "
+          "bit-parallel evaluator and one result is printed per line. "
+          "Mutually exclusive with --input.");
 ABSL_FLAG(std::string, output_type, "",
           "Type of the value as an XLS-formatted string. If un-set, then the "
           "output will be printed as flat uninterpreted bits.");
@@ -77,11 +94,91 @@ absl::StatusOr<netlist::CellLibrary> GetCellLibrary(
   }
 }
 
+// Flattens a sample (a semicolon-separated list of typed values, in the same
+// order as the module inputs are declared by Module::inputs()) into a Bits
+// where bit i is the value of the i'th module input.
+absl::StatusOr<Bits> ParseSample(absl::Span<const std::string> inputs,
+                                 const netlist::rtl::Module* module) {
+  Bits input_bits;
+  for (const auto& input_string : inputs) {
+    XLS_ASSIGN_OR_RETURN(Value input, Parser::ParseTypedValue(input_string));
+    Bits flat_value = FlattenValueToBits(input);
+    input_bits = bits_ops::Concat({input_bits, flat_value});
+  }
+  input_bits = bits_ops::Reverse(input_bits);
+  XLS_RET_CHECK(module->inputs().size() == input_bits.bit_count());
+  return input_bits;
+}
+
+// Converts output bits (bit i holding the value of the i'th module output)
+// into a Value of the given type (or flat bits, if no type is given).
+absl::StatusOr<Value> OutputBitsToValue(const Bits& bits,
+                                        Type* output_type) {
+  Bits output_bits = bits_ops::Reverse(bits);
+  if (output_type != nullptr) {
+    return UnflattenBitsToValue(output_bits, output_type);
+  }
+  return Value(output_bits);
+}
+
+absl::Status RunBatch(const netlist::rtl::Netlist* netlist,
+                      const netlist::rtl::Module* module,
+                      const std::string& stimulus_path, Type* output_type) {
+  XLS_ASSIGN_OR_RETURN(
+      std::unique_ptr<netlist::BitParallelInterpreter> interpreter,
+      netlist::BitParallelInterpreter::Create(netlist, module));
+  std::ifstream stimulus(stimulus_path);
+  if (!stimulus.is_open()) {
+    return absl::NotFoundError(
+        absl::StrCat("Could not open stimulus file: ", stimulus_path));
+  }
+
+  // The file is read a line at a time and samples are evaluated (and their
+  // results printed) in chunks so that output streams as the file is processed
+  // and memory use stays bounded regardless of the size of the file.
+  constexpr int64 kSamplesPerChunk =
+      64 * netlist::BitParallelInterpreter::kLanesPerWord;
+  std::vector<Bits> samples;
+  samples.reserve(kSamplesPerChunk);
+  auto flush = [&]() -> absl::Status {
+    XLS_ASSIGN_OR_RETURN(std::vector<Bits> results,
+                         interpreter->RunBatch(samples));
+    for (const Bits& result : results) {
+      XLS_ASSIGN_OR_RETURN(Value output,
+                           OutputBitsToValue(result, output_type));
+      std::cout << output.ToString(FormatPreference::kHex) << "\n";
+    }
+    std::cout.flush();
+    samples.clear();
+    return absl::OkStatus();
+  };
+
+  std::string line_text;
+  while (std::getline(stimulus, line_text)) {
+    absl::string_view line = absl::StripAsciiWhitespace(line_text);
+    if (line.empty() || absl::StartsWith(line, "//")) {
+      continue;
+    }
+    std::vector<std::string> inputs = absl::StrSplit(line, ';');
+    XLS_ASSIGN_OR_RETURN(Bits sample, ParseSample(inputs, module));
+    samples.push_back(std::move(sample));
+    if (samples.size() == kSamplesPerChunk) {
+      XLS_RETURN_IF_ERROR(flush());
+    }
+  }
+  if (stimulus.bad()) {
+    return absl::InternalError(
+        absl::StrCat("Error reading stimulus file: ", stimulus_path));
+  }
+  return flush();
+}
+
 absl::Status RealMain(const std::string& netlist_path,
                       const std::string& cell_library_path,
                       const std::string& cell_library_proto_path,
                       const std::string& module_name,
                       absl::Span<const std::string> inputs,
+                      const std::string& stimulus_path,
                       const std::string& output_type_string,
                       absl::Span<const std::string> dump_cells) {
   XLS_ASSIGN_OR_RETURN(
@@ -94,20 +191,21 @@ absl::Status RealMain(const std::string& netlist_path,
                                          &cell_library, &scanner));
   XLS_ASSIGN_OR_RETURN(const auto* module, netlist->GetModule(module_name));
 
-  // Input values are listed in the same order as inputs are declared by
-  // Module::inputs().
-  Bits input_bits;
-  for (const auto& input_string : inputs) {
-    XLS_ASSIGN_OR_RETURN(Value input, Parser::ParseTypedValue(input_string));
-    Bits flat_value = FlattenValueToBits(input);
-    input_bits = bits_ops::Concat({input_bits, flat_value});
+  // This is a disposable package - it only exists to hold the type below.
+  Package package("foo");
+  Type* output_type = nullptr;
+  if (!output_type_string.empty()) {
+    XLS_ASSIGN_OR_RETURN(output_type,
+                         Parser::ParseType(output_type_string, &package));
   }
-  input_bits = bits_ops::Reverse(input_bits);
 
+  if (!stimulus_path.empty()) {
+    return RunBatch(netlist.get(), module, stimulus_path, output_type);
+  }
+
+  XLS_ASSIGN_OR_RETURN(Bits input_bits, ParseSample(inputs, module));
   absl::flat_hash_map<const netlist::rtl::NetRef, bool> input_nets;
   const std::vector<netlist::rtl::NetRef>& module_inputs = module->inputs();
-  XLS_RET_CHECK(module_inputs.size() == input_bits.bit_count());
-
   for (int i = 0; i < module->inputs().size(); i++) {
     input_nets[module_inputs[i]] = input_bits.Get(i);
   }
@@ -120,19 +218,8 @@ absl::Status RealMain(const std::string& netlist_path,
   for (const netlist::rtl::NetRef ref : module->outputs()) {
     rope.push_back(output_nets[ref]);
   }
-  Bits output_bits = bits_ops::Reverse(rope.Build());
-
-  Value output;
-  if (!output_type_string.empty()) {
-    // This is a disposable package - it only exists to hold the type below.
-    Package package("foo");
-    XLS_ASSIGN_OR_RETURN(Type * output_type,
-                         Parser::ParseType(output_type_string, &package));
-    XLS_ASSIGN_OR_RETURN(output,
-                         UnflattenBitsToValue(output_bits, output_type));
-  } else {
-    output = Value(output_bits);
-  }
+  XLS_ASSIGN_OR_RETURN(Value output,
+                       OutputBitsToValue(rope.Build(), output_type));
 
   std::cout << "Results: " << output.ToString(FormatPreference::kHex)
             << std::endl;
@@ -157,8 +244,13 @@ int main(int argc, char* argv[]) {
   XLS_QCHECK(!module_name.empty()) << "--module_name must be specified.";
 
   std::string input = absl::GetFlag(FLAGS_input);
-  XLS_QCHECK(!input.empty()) << "--input must be specified.";
-  std::vector<std::string> inputs = absl::StrSplit(input, ';');
+  std::string stimulus_path = absl::GetFlag(FLAGS_stimulus_file);
+  XLS_QCHECK(!input.empty() ^ !stimulus_path.empty())
+      << "One (and only one) of --input or --stimulus_file must be specified.";
+  std::vector<std::string> inputs;
+  if (!input.empty()) {
+    inputs = absl::StrSplit(input, ';');
+  }
 
   std::string dump_cells_str = absl::GetFlag(FLAGS_dump_cells);
   std::vector<std::string> dump_cells = absl::StrSplit(dump_cells_str, ',');
@@ -167,7 +259,7 @@ int main(int argc, char* argv[]) {
 
   XLS_QCHECK_OK(xls::RealMain(netlist_path, cell_library_path,
                               cell_library_proto_path, module_name, inputs,
-                              output_type, dump_cells));
+                              stimulus_path, output_type, dump_cells));
 
   return 0;
 }
@@ -20,6 +20,7 @@
 #include "xls/common/init_xls.h"
 #include "xls/common/logging/logging.h"
 #include "xls/common/status/status_macros.h"
+#include "xls/ir/ir_binary_format.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/package.h"
 #include "xls/passes/standard_pipeline.h"
@@ -35,6 +36,16 @@ ABSL_FLAG(std::vector<std::string>, skip_passes, {},
           "pass names are skipped. If both --run_only_passes and --skip_passes "
           "are specified only passes which are present in --run_only_passes "
           "and not present in --skip_passes will be run.");
+ABSL_FLAG(int64, function_pass_threads, 1,
+          "Number of threads on which function-scoped passes may process "
+          "different functions concurrently.");
+ABSL_FLAG(int64, parse_threads, 1,
+          "Number of threads on which the functions of the input IR are "
+          "parsed.");
+ABSL_FLAG(std::string, output_path, "",
+          "File to write the optimized IR to. The binary IR format is written "
+          "if the path has the extension .irb. If not specified the IR text is "
+          "written to stdout.");
 
 namespace xls {
 namespace {
@@ -43,15 +54,14 @@ absl::Status RealMain(absl::string_view input_path) {
   if (input_path == "-") {
     input_path = "/dev/stdin";
   }
-  XLS_ASSIGN_OR_RETURN(std::string contents, GetFileContents(input_path));
-  std::unique_ptr<Package> package;
-  if (absl::GetFlag(FLAGS_entry).empty()) {
-    XLS_ASSIGN_OR_RETURN(package, Parser::ParsePackage(contents, input_path));
-  } else {
-    XLS_ASSIGN_OR_RETURN(package,
-                         Parser::ParsePackageWithEntry(
-                             contents, absl::GetFlag(FLAGS_entry), input_path));
+  absl::optional<std::string> entry;
+  if (!absl::GetFlag(FLAGS_entry).empty()) {
+    entry = absl::GetFlag(FLAGS_entry);
   }
+  XLS_ASSIGN_OR_RETURN(
+      std::unique_ptr<Package> package,
+      Parser::ParsePackageFile(input_path, entry,
+                               absl::GetFlag(FLAGS_parse_threads)));
   std::unique_ptr<CompoundPass> pipeline = CreateStandardPassPipeline();
   PassOptions options;
   options.ir_dump_path = absl::GetFlag(FLAGS_ir_dump_path);
@@ -61,10 +71,17 @@ absl::Status RealMain(absl::string_view input_path) {
   if (!absl::GetFlag(FLAGS_skip_passes).empty()) {
     options.skip_passes = absl::GetFlag(FLAGS_skip_passes);
   }
+  options.function_pass_threads = absl::GetFlag(FLAGS_function_pass_threads);
   PassResults results;
   XLS_RETURN_IF_ERROR(pipeline->Run(package.get(), options, &results).status());
-  std::cout << package->DumpIr();
-  return absl::OkStatus();
+  const std::string output_path = absl::GetFlag(FLAGS_output_path);
+  if (output_path.empty()) {
+    std::cout << package->DumpIr();
+    return absl::OkStatus();
+  }
+  return SetFileContents(output_path, HasBinaryIrFileExtension(output_path)
+                                          ? package->Serialize()
+                                          : package->DumpIr());
 }
 
 }  // namespace
@@ -97,6 +97,29 @@ fn add_zero(x: bits[32]) -> bits[32] {
     # Skipping DFE should leave the dead function in the IR.
     self.assertIn('dead_function', optimized_ir)
 
+  def test_output_path(self):
+    ir_file = self.create_tempfile(content=ADD_ZERO_IR)
+    output_dir = self.create_tempdir()
+    text_path = output_dir.create_file('add_zero.opt.ir').full_path
+    binary_path = output_dir.create_file('add_zero.opt.irb').full_path
+
+    subprocess.check_call([
+        OPT_MAIN_PATH, '--output_path=' + text_path, ir_file.full_path
+    ])
+    with open(text_path) as f:
+      optimized_ir = f.read()
+    self.assertIn('ret param', optimized_ir)
+
+    # Binary IR is written for the .irb extension and is accepted as input.
+    subprocess.check_call([
+        OPT_MAIN_PATH, '--output_path=' + binary_path, ir_file.full_path
+    ])
+    with open(binary_path, 'rb') as f:
+      self.assertTrue(f.read().startswith(b'\x89XLSIRB\n'))
+    self.assertEqual(
+        subprocess.check_output([OPT_MAIN_PATH,
+                                 binary_path]).decode('utf-8'), optimized_ir)
+
 
 if __name__ == '__main__':
   test_base.main()
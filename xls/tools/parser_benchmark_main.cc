@@ -0,0 +1,147 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/file/memory_mapped_file.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/integral_types.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/ir_binary_format.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/ir_scanner.h"
+#include "xls/ir/package.h"
+
+const char* kUsage = R"(
+Measures the throughput of reading, tokenizing and parsing IR files. Parsing is
+measured with each of the given thread counts. The package is also serialized
+in the binary IR format and the time to parse it is measured. Usage:
+
+   parser_benchmark_main <ir_file>...
+   parser_benchmark_main --thread_counts=1,4,16 <ir_file>...
+)";
+
+ABSL_FLAG(std::vector<std::string>, thread_counts, {"1"},
+          "Comma-separated list of thread counts to parse with.");
+ABSL_FLAG(absl::Duration, min_run_time, absl::Seconds(1),
+          "Minimum time to run each measurement for.");
+
+namespace xls {
+namespace {
+
+// Runs 'f' repeatedly for at least --min_run_time and prints a line with the
+// time per run and the throughput given the size of the input.
+absl::Status Time(absl::string_view name, int64 input_size,
+                  const std::function<absl::Status()>& f) {
+  const absl::Duration min_run_time = absl::GetFlag(FLAGS_min_run_time);
+  int64 runs = 0;
+  absl::Time start = absl::Now();
+  absl::Duration run_time;
+  do {
+    XLS_RETURN_IF_ERROR(f());
+    ++runs;
+    run_time = absl::Now() - start;
+  } while (run_time < min_run_time);
+
+  const double seconds_per_run = absl::ToDoubleSeconds(run_time) / runs;
+  std::cout << absl::StreamFormat(
+      "  %-24s per run: %10.3fms  %8.1fMB/s  (%d runs)\n", name,
+      seconds_per_run * 1e3, input_size / seconds_per_run / 1e6, runs);
+  return absl::OkStatus();
+}
+
+absl::Status RealMain(absl::Span<const absl::string_view> paths) {
+  std::vector<int64> thread_counts;
+  for (const std::string& s : absl::GetFlag(FLAGS_thread_counts)) {
+    int64 thread_count;
+    XLS_QCHECK(absl::SimpleAtoi(s, &thread_count) && thread_count > 0)
+        << "Invalid thread count: " << s;
+    thread_counts.push_back(thread_count);
+  }
+
+  for (absl::string_view path : paths) {
+    XLS_ASSIGN_OR_RETURN(MemoryMappedFile file,
+                         MemoryMappedFile::Open(std::string(path)));
+    const absl::string_view contents = file.contents();
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                         Parser::ParsePackageNoVerify(contents));
+    const std::string binary = package->Serialize();
+    const std::string text =
+        IsBinaryIr(contents) ? package->DumpIr() : std::string(contents);
+    XLS_ASSIGN_OR_RETURN(std::vector<Token> tokens, TokenizeString(text));
+    // Use endl to flush cout so the banner appears before starting work on the
+    // file.
+    std::cout << absl::StreamFormat(
+                     "%s (%d bytes, %d tokens, %d functions, %d nodes, %d "
+                     "bytes as binary IR)",
+                     path, text.size(), tokens.size(),
+                     package->GetFunctionsAndProcs().size(),
+                     package->GetNodeCount(), binary.size())
+              << std::endl;
+    package.reset();
+
+    XLS_RETURN_IF_ERROR(Time("GetFileContents", contents.size(), [&]() {
+      return GetFileContents(std::string(path)).status();
+    }));
+    XLS_RETURN_IF_ERROR(Time("MemoryMappedFile::Open", contents.size(), [&]() {
+      return MemoryMappedFile::Open(std::string(path)).status();
+    }));
+    XLS_RETURN_IF_ERROR(Time("TokenizeString", text.size(), [&]() {
+      return TokenizeString(text).status();
+    }));
+    for (int64 thread_count : thread_counts) {
+      XLS_RETURN_IF_ERROR(
+          Time(absl::StrFormat("Parse (%d threads)", thread_count),
+               text.size(), [&]() {
+                 return Parser::ParseDerivedPackageNoVerify<Package>(
+                            text, path, /*entry=*/absl::nullopt,
+                            thread_count)
+                     .status();
+               }));
+    }
+    XLS_RETURN_IF_ERROR(Time("ParseBinaryPackage", binary.size(), [&]() {
+      return Parser::ParseDerivedBinaryPackageNoVerify<Package>(binary)
+          .status();
+    }));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace xls
+
+int main(int argc, char** argv) {
+  std::vector<absl::string_view> positional_arguments =
+      xls::InitXls(kUsage, argc, argv);
+
+  if (positional_arguments.empty()) {
+    XLS_LOG(QFATAL) << absl::StreamFormat("Expected invocation: %s <path>...",
+                                          argv[0]);
+  }
+
+  XLS_QCHECK_OK(xls::RealMain(positional_arguments));
+  return EXIT_SUCCESS;
+}
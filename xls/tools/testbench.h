@@ -21,6 +21,7 @@
 #include "absl/base/internal/sysinfo.h"
 #include "absl/status/status.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "xls/common/file/filesystem.h"
 #include "xls/common/integral_types.h"
 #include "xls/tools/testbench_thread.h"
@@ -34,10 +35,16 @@ namespace xls {
 // periodically printed to the terminal, as this class' primary use is for
 // exploring large test spaces.
 //
-// Presently, work is parititioned uniformly across threads at startup. This can
-// lead to work imbalance if certain areas of the input space execute faster
-// than others. More advanced strategies can be explored in the future if this
-// becomes a problem.
+// The input space is divided into fixed-size chunks, which threads claim from
+// per-thread work queues, stealing from each other once their own runs dry (see
+// ChunkQueues), so regions of the input space that are slow to evaluate don't
+// leave threads idle at the end. A throughput summary is printed at the end of
+// the run.
+//
+// By default, the module under test is called once per sample. If it is
+// cheap, the per-call overhead can dominate; SetComputeActualBatched() instead
+// computes the actual results a chunk at a time, e.g., through the JIT's
+// batched entry point (LlvmIrJit::RunBatched()).
 
 namespace internal {
 // Forward decl of common Testbench base class.
@@ -84,12 +91,13 @@ class Testbench
         create_shard_(create_shard),
         compute_expected_(compute_expected),
         compute_actual_(compute_actual) {
-    this->thread_create_fn_ = [this](uint64 start, uint64 end) {
+    this->thread_create_fn_ = [this](ChunkQueues* queues, int queue_index) {
       return std::make_unique<
           TestbenchThread<JitWrapperT, InputT, ResultT, ShardDataT>>(
-          &this->mutex_, &this->wake_me_, start, end, this->max_failures_,
-          this->index_to_input_, create_shard_, compute_expected_,
-          compute_actual_, this->compare_results_);
+          &this->mutex_, &this->wake_me_, queues, queue_index,
+          this->max_failures_, this->index_to_input_, create_shard_,
+          compute_expected_, compute_actual_, this->compute_actual_batched_,
+          this->compare_results_);
     };
   }
 
@@ -115,11 +123,12 @@ class Testbench<JitWrapperT, InputT, ResultT, ShardDataT,
             start, end, max_failures, index_to_input, compare_results),
         compute_expected_(compute_expected),
         compute_actual_(compute_actual) {
-    this->thread_create_fn_ = [this](uint64 start, uint64 end) {
+    this->thread_create_fn_ = [this](ChunkQueues* queues, int queue_index) {
       return std::make_unique<
           TestbenchThread<JitWrapperT, InputT, ResultT, ShardDataT>>(
-          &this->mutex_, &this->wake_me_, start, end, this->max_failures_,
-          this->index_to_input_, compute_expected_, compute_actual_,
+          &this->mutex_, &this->wake_me_, queues, queue_index,
+          this->max_failures_, this->index_to_input_, compute_expected_,
+          compute_actual_, this->compute_actual_batched_,
           this->compare_results_);
     };
   }
@@ -138,11 +147,15 @@ template <typename JitWrapperT, typename InputT, typename ResultT,
           typename ShardDataT>
 class TestbenchBase {
  public:
+  using ThreadT = TestbenchThread<JitWrapperT, InputT, ResultT, ShardDataT>;
+  using BatchedActualFn = typename ThreadT::BatchedActualFn;
+
   TestbenchBase(uint64 start, uint64 end, uint64 max_failures,
                 std::function<InputT(uint64)> index_to_input,
                 std::function<bool(ResultT, ResultT)> compare_results)
       : started_(false),
         num_threads_(absl::base_internal::NumCPUs()),
+        chunk_size_(kDefaultChunkSize),
         start_(start),
         end_(end),
         max_failures_(max_failures),
@@ -161,6 +174,35 @@ class TestbenchBase {
     return absl::OkStatus();
   }
 
+  // Sets the number of samples in each unit of work claimed by a thread. Must
+  // be called before Run().
+  absl::Status SetChunkSize(uint64 chunk_size) {
+    absl::MutexLock lock(&mutex_);
+    if (this->started_) {
+      return absl::FailedPreconditionError(
+          "Can't change the chunk size after starting execution.");
+    }
+    if (chunk_size == 0) {
+      return absl::InvalidArgumentError("Chunk size must be positive.");
+    }
+    chunk_size_ = chunk_size;
+    return absl::OkStatus();
+  }
+
+  // Computes the actual results with the given function, which is passed the
+  // inputs of a whole chunk and must fill in the corresponding results, rather
+  // than with the per-sample compute_actual function. Must be called before
+  // Run(). The function must be thread-safe.
+  absl::Status SetComputeActualBatched(BatchedActualFn compute_actual_batched) {
+    absl::MutexLock lock(&mutex_);
+    if (this->started_) {
+      return absl::FailedPreconditionError(
+          "Can't change the actual-result function after starting execution.");
+    }
+    compute_actual_batched_ = compute_actual_batched;
+    return absl::OkStatus();
+  }
+
   // Executes the test.
   absl::Status Run() {
     // Lock before spawning threads to prevent missing any early wakeup signals
@@ -168,24 +210,14 @@ class TestbenchBase {
     mutex_.Lock();
     started_ = true;
     start_time_ = absl::Now();
+    last_print_time_ = start_time_;
 
     // Set up all the workers.
-    uint64 chunk_size = (end_ - start_) / num_threads_;
-    uint64 chunk_remainder = (end_ - start_) % chunk_size;
-    uint64 first = 0;
-    uint64 last;
+    queues_ = std::make_unique<ChunkQueues>(start_, end_, chunk_size_,
+                                            num_threads_);
     for (int i = 0; i < num_threads_; i++) {
-      last = first + chunk_size;
-      // Distribute any remainder evenly amongst the threads.
-      if (chunk_remainder > 0) {
-        last++;
-        chunk_remainder--;
-      }
-
-      threads_.push_back(thread_create_fn_(first, last));
+      threads_.push_back(thread_create_fn_(queues_.get(), i));
       threads_.back()->Run();
-
-      first = last + 1;
     }
 
     // Now monitor them.
@@ -221,6 +253,8 @@ class TestbenchBase {
       threads_[i]->Join();
     }
 
+    PrintSummary();
+
     for (int i = 0; i < threads_.size(); i++) {
       if (threads_[i]->num_failures() != 0) {
         return absl::InternalError(
@@ -235,34 +269,25 @@ class TestbenchBase {
   // How many seconds to wait before printing status (at most).
   static constexpr absl::Duration kPrintInterval = absl::Seconds(5);
 
+  // The default number of samples per unit of work: large enough to amortize
+  // claiming it, small enough to balance load at the end of a run.
+  static constexpr uint64 kDefaultChunkSize = 4096;
+
   // Prints the current execution status across all threads.
   void PrintStatus() {
-    // Get the remainder-adjusted chunk size for this thread.
-    auto thread_chunk_size = [this](int thread_index) {
-      uint64 total_size = end_ - start_;
-      uint64 chunk_size = total_size / threads_.size();
-      uint64 remainder = total_size % chunk_size;
-      if (thread_index < remainder) {
-        chunk_size++;
-      }
-      return chunk_size;
-    };
-
-    // Ignore remainder issues here. It shouldn't matter much at all.
     absl::Time now = absl::Now();
     auto delta = now - start_time_;
     uint64 total_done = 0;
     for (int64 i = 0; i < threads_.size(); ++i) {
-      uint64 num_passes = threads_[i]->num_passes();
       uint64 num_failures = threads_[i]->num_failures();
-      uint64 thread_done = num_passes + num_failures;
-      uint64 chunk_size = thread_chunk_size(i);
+      uint64 thread_done = threads_[i]->num_passes() + num_failures;
       total_done += thread_done;
       std::cout << absl::StreamFormat(
-                       "thread %02d: %f%% @ %.1f us/sample :: failures %d", i,
-                       static_cast<double>(thread_done) / chunk_size * 100.0,
+                       "thread %02d: %d samples @ %.1f us/sample :: failures "
+                       "%d; steals %d",
+                       i, thread_done,
                        absl::ToDoubleMicroseconds(delta) / thread_done,
-                       num_failures)
+                       num_failures, queues_->num_steals(i))
                 << "\n";
     }
     double done_per_second = total_done / absl::ToDoubleSeconds(delta);
@@ -270,15 +295,38 @@ class TestbenchBase {
     auto estimate = absl::Seconds(remaining / done_per_second);
     double throughput_this_print =
         static_cast<double>(total_done - num_samples_processed_) /
-        ToInt64Seconds(kPrintInterval);
+        absl::ToDoubleSeconds(now - last_print_time_);
     std::cout << absl::StreamFormat(
-                     "--- ^ after %s elapsed; %.2f Misamples/s; estimate %s "
-                     "remaining ...",
+                     "--- ^ after %s elapsed; %.2f%% done; %.2f Misamples/s; "
+                     "estimate %s remaining ...",
                      absl::FormatDuration(delta),
+                     static_cast<double>(total_done) / (end_ - start_) * 100.0,
                      throughput_this_print / std::pow(2, 20),
                      absl::FormatDuration(estimate))
               << std::endl;
     num_samples_processed_ = total_done;
+    last_print_time_ = now;
+  }
+
+  // Prints the overall throughput of the run, in total and per thread.
+  void PrintSummary() {
+    absl::Duration delta = absl::Now() - start_time_;
+    uint64 total_done = 0;
+    uint64 total_steals = 0;
+    for (int64 i = 0; i < threads_.size(); ++i) {
+      total_done += threads_[i]->num_passes() + threads_[i]->num_failures();
+      total_steals += queues_->num_steals(i);
+    }
+    double per_second = total_done / absl::ToDoubleSeconds(delta);
+    std::cout << absl::StreamFormat(
+                     "=== %d samples in %s on %d threads (%s): %.3f "
+                     "Msamples/s, %.3f Msamples/s per thread; %d steals of "
+                     "%d-sample chunks",
+                     total_done, absl::FormatDuration(delta), threads_.size(),
+                     compute_actual_batched_ ? "batched" : "per-sample",
+                     per_second / 1e6, per_second / threads_.size() / 1e6,
+                     total_steals, queues_->chunk_size())
+              << std::endl;
   }
 
   // Requests that all running threads terminate (but doesn't Join() them).
@@ -290,16 +338,19 @@ class TestbenchBase {
 
   bool started_;
   int num_threads_;
+  uint64 chunk_size_;
   absl::Time start_time_;
+  absl::Time last_print_time_;
   uint64 start_;
   uint64 end_;
   uint64 max_failures_;
   uint64 num_samples_processed_;
   std::function<InputT(uint64)> index_to_input_;
   std::function<bool(ResultT, ResultT)> compare_results_;
+  BatchedActualFn compute_actual_batched_;
 
-  using ThreadT = TestbenchThread<JitWrapperT, InputT, ResultT, ShardDataT>;
-  std::function<std::unique_ptr<ThreadT>(uint64, uint64)> thread_create_fn_;
+  std::function<std::unique_ptr<ThreadT>(ChunkQueues*, int)> thread_create_fn_;
+  std::unique_ptr<ChunkQueues> queues_;
   std::vector<std::unique_ptr<ThreadT>> threads_;
 
   // The main thread sleeps while tests are running. As worker threads finish,
@@ -0,0 +1,179 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/tools/testbench.h"
+
+#include <atomic>
+#include <thread>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "xls/common/status/matchers.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/package.h"
+#include "xls/jit/llvm_ir_jit.h"
+
+namespace xls {
+namespace {
+
+// A hand-written JIT wrapper in the form of the generated ones, for a function
+// that adds one to its argument.
+class AddOne {
+ public:
+  static absl::StatusOr<std::unique_ptr<AddOne>> Create() {
+    XLS_ASSIGN_OR_RETURN(auto package, Parser::ParsePackage(R"(
+package add_one
+
+fn add_one(x: bits[32]) -> bits[32] {
+  one: bits[32] = literal(value=1)
+  ret result: bits[32] = add(x, one)
+}
+)"));
+    XLS_ASSIGN_OR_RETURN(Function * function,
+                         package->GetFunction("add_one"));
+    XLS_ASSIGN_OR_RETURN(auto jit, LlvmIrJit::Create(function));
+    return absl::WrapUnique(new AddOne(std::move(package), std::move(jit)));
+  }
+
+  LlvmIrJit* jit() { return jit_.get(); }
+
+  uint32 Run(uint32 x) {
+    std::vector<Value> args = {Value(UBits(x, 32))};
+    return jit_->Run(args).value().bits().ToUint64().value();
+  }
+
+ private:
+  AddOne(std::unique_ptr<Package> package, std::unique_ptr<LlvmIrJit> jit)
+      : package_(std::move(package)), jit_(std::move(jit)) {}
+
+  std::unique_ptr<Package> package_;
+  std::unique_ptr<LlvmIrJit> jit_;
+};
+
+uint32 IndexToInput(uint64 index) { return index; }
+
+uint32 ComputeActual(AddOne* wrapper, uint32 input) {
+  return wrapper->Run(input);
+}
+
+void ComputeActualBatched(AddOne* wrapper, absl::Span<const uint32> inputs,
+                          absl::Span<uint32> results) {
+  const uint8* args[] = {reinterpret_cast<const uint8*>(inputs.data())};
+  XLS_CHECK_OK(wrapper->jit()->RunBatched(
+      args,
+      absl::MakeSpan(reinterpret_cast<uint8*>(results.data()),
+                     results.size() * sizeof(uint32)),
+      inputs.size()));
+}
+
+bool CompareResults(uint32 a, uint32 b) { return a == b; }
+
+// Checks that every index in [start, end) is evaluated exactly once.
+void ExpectEachIndexOnce(uint64 start, uint64 end, int num_threads,
+                         uint64 chunk_size, bool batched) {
+  std::vector<std::atomic<int>> visits(end);
+  Testbench<AddOne, uint32, uint32> testbench(
+      start, end, /*max_failures=*/1, IndexToInput,
+      [&](uint32 input) {
+        visits[input]++;
+        return input + 1;
+      },
+      ComputeActual, CompareResults);
+  XLS_ASSERT_OK(testbench.SetNumThreads(num_threads));
+  XLS_ASSERT_OK(testbench.SetChunkSize(chunk_size));
+  if (batched) {
+    XLS_ASSERT_OK(testbench.SetComputeActualBatched(ComputeActualBatched));
+  }
+  XLS_ASSERT_OK(testbench.Run());
+  for (uint64 i = 0; i < end; ++i) {
+    EXPECT_EQ(visits[i].load(), i < start ? 0 : 1) << "index " << i;
+  }
+}
+
+TEST(TestbenchTest, EvaluatesEachIndexOnce) {
+  ExpectEachIndexOnce(0, 1000, /*num_threads=*/4, /*chunk_size=*/7,
+                      /*batched=*/false);
+  ExpectEachIndexOnce(3, 1000, /*num_threads=*/3, /*chunk_size=*/64,
+                      /*batched=*/false);
+  // More threads than chunks.
+  ExpectEachIndexOnce(0, 10, /*num_threads=*/8, /*chunk_size=*/4,
+                      /*batched=*/false);
+  ExpectEachIndexOnce(0, 0, /*num_threads=*/2, /*chunk_size=*/4,
+                      /*batched=*/false);
+}
+
+TEST(TestbenchTest, EvaluatesEachIndexOnceBatched) {
+  ExpectEachIndexOnce(0, 1000, /*num_threads=*/4, /*chunk_size=*/7,
+                      /*batched=*/true);
+  ExpectEachIndexOnce(5, 5000, /*num_threads=*/2, /*chunk_size=*/1024,
+                      /*batched=*/true);
+}
+
+TEST(TestbenchTest, SlowRegionIsShared) {
+  // All the slow samples start out in the first thread's queue; the other
+  // threads must steal them for the run to finish in reasonable time.
+  constexpr int kNumThreads = 4;
+  constexpr uint64 kNumSamples = 256;
+  absl::Mutex mutex;
+  absl::flat_hash_set<std::thread::id> slow_threads;
+  Testbench<AddOne, uint32, uint32> testbench(
+      0, kNumSamples, /*max_failures=*/1, IndexToInput,
+      [&](uint32 input) {
+        if (input < kNumSamples / kNumThreads) {
+          absl::SleepFor(absl::Milliseconds(5));
+          absl::MutexLock lock(&mutex);
+          slow_threads.insert(std::this_thread::get_id());
+        }
+        return input + 1;
+      },
+      ComputeActual, CompareResults);
+  XLS_ASSERT_OK(testbench.SetNumThreads(kNumThreads));
+  XLS_ASSERT_OK(testbench.SetChunkSize(1));
+  XLS_ASSERT_OK(testbench.Run());
+  EXPECT_GT(slow_threads.size(), 1);
+}
+
+TEST(TestbenchTest, ReportsMismatch) {
+  for (bool batched : {false, true}) {
+    Testbench<AddOne, uint32, uint32> testbench(
+        0, 1000, /*max_failures=*/1, IndexToInput,
+        [](uint32 input) { return input == 567 ? 0 : input + 1; },
+        ComputeActual, CompareResults);
+    XLS_ASSERT_OK(testbench.SetNumThreads(2));
+    XLS_ASSERT_OK(testbench.SetChunkSize(16));
+    if (batched) {
+      XLS_ASSERT_OK(testbench.SetComputeActualBatched(ComputeActualBatched));
+    }
+    EXPECT_FALSE(testbench.Run().ok());
+  }
+}
+
+TEST(TestbenchTest, SettingsFixedOnceStarted) {
+  Testbench<AddOne, uint32, uint32> testbench(
+      0, 10, /*max_failures=*/1, IndexToInput,
+      [](uint32 input) { return input + 1; }, ComputeActual, CompareResults);
+  EXPECT_FALSE(testbench.SetChunkSize(0).ok());
+  XLS_ASSERT_OK(testbench.Run());
+  EXPECT_FALSE(testbench.SetNumThreads(2).ok());
+  EXPECT_FALSE(testbench.SetChunkSize(4).ok());
+  EXPECT_FALSE(testbench.SetComputeActualBatched(ComputeActualBatched).ok());
+}
+
+}  // namespace
+}  // namespace xls
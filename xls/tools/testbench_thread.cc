@@ -0,0 +1,95 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "xls/tools/testbench_thread.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "xls/common/math_util.h"
+
+namespace xls {
+
+ChunkQueues::ChunkQueues(uint64 start, uint64 end, uint64 chunk_size,
+                         int num_queues)
+    : start_(start), end_(end), queues_(num_queues) {
+  XLS_CHECK_LE(start, end);
+  XLS_CHECK_GT(num_queues, 0);
+  // Chunk indices must fit in half of a queue's range word.
+  uint64 total = end - start;
+  chunk_size_ = std::max(
+      {chunk_size, uint64{1},
+       CeilOfRatio(total, uint64{std::numeric_limits<uint32>::max()})});
+  uint64 num_chunks = CeilOfRatio(total, chunk_size_);
+
+  // Start each queue with an even share of the chunks, spreading any remainder
+  // over the first queues.
+  uint64 per_queue = num_chunks / num_queues;
+  uint64 remainder = num_chunks % num_queues;
+  uint64 first = 0;
+  for (int i = 0; i < num_queues; ++i) {
+    uint64 last = first + per_queue + (i < remainder ? 1 : 0);
+    queues_[i].range.store(PackRange(first, last));
+    first = last;
+  }
+}
+
+bool ChunkQueues::Claim(int queue_index, uint64* first, uint64* last) {
+  uint64 chunk;
+  if (!ClaimOwn(queue_index, &chunk) && !Steal(queue_index, &chunk)) {
+    return false;
+  }
+  *first = start_ + chunk * chunk_size_;
+  *last = std::min(end_, *first + chunk_size_);
+  return true;
+}
+
+bool ChunkQueues::ClaimOwn(int queue_index, uint64* chunk) {
+  std::atomic<uint64>& range = queues_[queue_index].range;
+  uint64 current = range.load();
+  while (RangeFirst(current) < RangeLast(current)) {
+    if (range.compare_exchange_weak(
+            current, PackRange(RangeFirst(current) + 1, RangeLast(current)))) {
+      *chunk = RangeFirst(current);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ChunkQueues::Steal(int queue_index, uint64* chunk) {
+  for (int offset = 1; offset < queues_.size(); ++offset) {
+    std::atomic<uint64>& victim =
+        queues_[(queue_index + offset) % queues_.size()].range;
+    uint64 current = victim.load();
+    while (RangeFirst(current) < RangeLast(current)) {
+      uint64 first = RangeFirst(current);
+      uint64 last = RangeLast(current);
+      uint64 split = last - CeilOfRatio(last - first, uint64{2});
+      if (victim.compare_exchange_weak(current, PackRange(first, split))) {
+        // Our own queue is empty, and an empty queue is never stolen from, so
+        // nothing else can be writing it. The stolen chunks weren't in it
+        // before, so thieves can't mistake the new range for an old one.
+        *chunk = split;
+        queues_[queue_index].range.store(PackRange(split + 1, last));
+        queues_[queue_index].num_steals.fetch_add(1,
+                                                  std::memory_order_relaxed);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+}  // namespace xls
@@ -15,13 +15,17 @@
 #ifndef XLS_TOOLS_TESTBENCH_THREAD_H_
 #define XLS_TOOLS_TESTBENCH_THREAD_H_
 
+#include <atomic>
 #include <functional>
 #include <thread>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/strings/str_format.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "xls/common/integral_types.h"
 #include "xls/common/logging/logging.h"
 #include "xls/ir/ir_parser.h"
 #include "xls/ir/package.h"
@@ -29,6 +33,57 @@
 
 namespace xls {
 
+// The work queues of a set of TestbenchThreads. The index space [start, end)
+// is divided into fixed-size chunks, and each thread starts with a contiguous
+// run of them in its own queue. A thread claims chunks from the front of its
+// own queue; once that's empty, it steals the back half of the next non-empty
+// queue after its own. This keeps all threads busy until the end even when
+// some parts of the index space are much slower to evaluate than others.
+//
+// Each queue is a single atomic word holding the [first, last) range of chunk
+// indices left in it, so claiming and stealing are lock-free.
+class ChunkQueues {
+ public:
+  ChunkQueues(uint64 start, uint64 end, uint64 chunk_size, int num_queues);
+
+  // Claims the next chunk of work for the given queue's thread, stealing from
+  // another queue if its own is empty, and sets [*first, *last) to its index
+  // range. Returns false once all chunks have been claimed.
+  bool Claim(int queue_index, uint64* first, uint64* last);
+
+  // Returns the number of times the given queue's thread stole work.
+  uint64 num_steals(int queue_index) const {
+    return queues_[queue_index].num_steals.load(std::memory_order_relaxed);
+  }
+
+  uint64 chunk_size() const { return chunk_size_; }
+
+ private:
+  // Padded to a cache line so threads polling different queues don't contend.
+  struct alignas(64) Queue {
+    std::atomic<uint64> range{0};
+    std::atomic<uint64> num_steals{0};
+  };
+
+  static uint64 PackRange(uint64 first, uint64 last) {
+    return first << 32 | last;
+  }
+  static uint64 RangeFirst(uint64 range) { return range >> 32; }
+  static uint64 RangeLast(uint64 range) { return range & 0xffffffff; }
+
+  // Claims the first chunk of the given queue, if any.
+  bool ClaimOwn(int queue_index, uint64* chunk);
+
+  // Steals the back half of another queue, moving all of it but its first
+  // chunk into the (empty) queue at "queue_index".
+  bool Steal(int queue_index, uint64* chunk);
+
+  uint64 start_;
+  uint64 end_;
+  uint64 chunk_size_;
+  std::vector<Queue> queues_;
+};
+
 template <typename JitWrapperT, typename InputT, typename ResultT,
           typename ShardDataT>
 class TestbenchThreadBase;
@@ -49,6 +104,8 @@ class TestbenchThread
   // All specified functions must be thread-safe.
   //  - wake_parent_mutex: A mutex that protects:
   //  - wake_parent: A condvar to kick the parent when this thread has finished.
+  //  - queues, queue_index: The work queues shared by all threads, and the
+  //                         index of this thread's own queue.
   //  - max_failures: The number of failures that will cause us to bail out.
   //                  If 0, then there will be no limit.
   //  - index_to_input: A function that can convert an index to an input to the
@@ -56,17 +113,23 @@ class TestbenchThread
   //  - generate_expected: Given an input, generates the "expected" value.
   //  - generate_actual: Given an input, generates a value from the module
   //                     under test.
+  //  - generate_actual_batched: If non-null, used instead of generate_actual
+  //                             to generate the values for a chunk of inputs
+  //                             at a time.
   TestbenchThread(
       absl::Mutex* wake_parent_mutex, absl::CondVar* wake_parent,
-      uint64 start_index, uint64 end_index, uint64 max_failures,
+      ChunkQueues* queues, int queue_index, uint64 max_failures,
       std::function<InputT(uint64)> index_to_input,
       std::function<std::unique_ptr<ShardDataT>()> create_shard,
       std::function<ResultT(ShardDataT*, InputT)> generate_expected,
       std::function<ResultT(JitWrapperT*, ShardDataT*, InputT)> generate_actual,
+      std::function<void(JitWrapperT*, absl::Span<const InputT>,
+                         absl::Span<ResultT>)>
+          generate_actual_batched,
       std::function<bool(ResultT, ResultT)> compare_results)
       : TestbenchThreadBase<JitWrapperT, InputT, ResultT, ShardDataT>(
-            wake_parent_mutex, wake_parent, start_index, end_index,
-            max_failures, index_to_input, compare_results),
+            wake_parent_mutex, wake_parent, queues, queue_index, max_failures,
+            index_to_input, generate_actual_batched, compare_results),
         shard_data_(create_shard()),
         generate_expected_(generate_expected),
         generate_actual_(generate_actual) {
@@ -95,14 +158,17 @@ class TestbenchThread<
     : public TestbenchThreadBase<JitWrapperT, InputT, ResultT, ShardDataT> {
  public:
   TestbenchThread(absl::Mutex* wake_parent_mutex, absl::CondVar* wake_parent,
-                  uint64 start_index, uint64 end_index, uint64 max_failures,
+                  ChunkQueues* queues, int queue_index, uint64 max_failures,
                   std::function<InputT(uint64)> index_to_input,
                   std::function<ResultT(InputT)> generate_expected,
                   std::function<ResultT(JitWrapperT*, InputT)> generate_actual,
+                  std::function<void(JitWrapperT*, absl::Span<const InputT>,
+                                     absl::Span<ResultT>)>
+                      generate_actual_batched,
                   std::function<bool(ResultT, ResultT)> compare_results)
       : TestbenchThreadBase<JitWrapperT, InputT, ResultT, ShardDataT>(
-            wake_parent_mutex, wake_parent, start_index, end_index,
-            max_failures, index_to_input, compare_results),
+            wake_parent_mutex, wake_parent, queues, queue_index, max_failures,
+            index_to_input, generate_actual_batched, compare_results),
         generate_expected_(generate_expected),
         generate_actual_(generate_actual) {
     this->generate_expected_fn_ = [this](InputT& input) {
@@ -125,21 +191,26 @@ template <typename JitWrapperT, typename InputT, typename ResultT,
           typename ShardDataT>
 class TestbenchThreadBase {
  public:
+  using BatchedActualFn = std::function<void(
+      JitWrapperT*, absl::Span<const InputT>, absl::Span<ResultT>)>;
+
   TestbenchThreadBase(absl::Mutex* wake_parent_mutex,
-                      absl::CondVar* wake_parent, uint64 start_index,
-                      uint64 end_index, uint64 max_failures,
+                      absl::CondVar* wake_parent, ChunkQueues* queues,
+                      int queue_index, uint64 max_failures,
                       std::function<InputT(uint64)> index_to_input,
+                      BatchedActualFn generate_actual_batched,
                       std::function<bool(ResultT, ResultT)> compare_results)
       : wake_parent_mutex_(wake_parent_mutex),
         wake_parent_(wake_parent),
         cancelled_(false),
         running_(false),
-        start_index_(start_index),
-        end_index_(end_index),
+        queues_(queues),
+        queue_index_(queue_index),
         max_failures_(max_failures),
         num_passes_(0),
         num_failures_(0),
         index_to_input_(index_to_input),
+        generate_actual_batched_(generate_actual_batched),
         compare_results_(compare_results) {}
 
   // Starts the thread. Silently returns if it's already running.
@@ -164,32 +235,54 @@ class TestbenchThreadBase {
     jit_wrapper_ = std::move(status_or_wrapper.value());
 
     running_.store(true);
-    for (uint64 i = start_index_; i < end_index_; i++) {
-      // Don't check for cancelled on every iteration; it's a touch slow.
-      if (i % 128 == 0 && cancelled_.load()) {
+    // The counters are only written by this thread, so they're accumulated
+    // locally and published once per chunk.
+    uint64 num_passes = 0;
+    uint64 num_failures = 0;
+    std::vector<InputT> inputs;
+    std::vector<ResultT> actuals;
+    uint64 first;
+    uint64 last;
+    while (return_status.ok() && queues_->Claim(queue_index_, &first, &last)) {
+      if (cancelled_.load()) {
         return_status = absl::CancelledError("This thread was cancelled.");
         break;
       }
 
-      InputT input = index_to_input_(i);
-      ResultT expected = generate_expected_fn_(input);
-      ResultT actual = generate_actual_fn_(input);
-      if (!compare_results_(expected, actual)) {
-        num_failures_.store(num_failures_.load() + 1);
-        std::string error = absl::StrFormat(
-            "Value mismatch at index %d:\n"
-            "  Expected: 0x%x\n"
-            "  Actual  : 0x%x",
-            i, absl::bit_cast<uint32>(expected),
-            absl::bit_cast<uint32>(actual));
-        XLS_LOG(ERROR) << error;
-        if (max_failures_ <= num_failures_.load()) {
-          return_status = absl::InternalError(error);
-          break;
+      inputs.clear();
+      for (uint64 i = first; i < last; i++) {
+        inputs.push_back(index_to_input_(i));
+      }
+      if (generate_actual_batched_) {
+        actuals.resize(inputs.size());
+        generate_actual_batched_(jit_wrapper_.get(), inputs,
+                                 absl::MakeSpan(actuals));
+      }
+
+      for (uint64 i = 0; i < inputs.size(); i++) {
+        ResultT expected = generate_expected_fn_(inputs[i]);
+        ResultT actual = generate_actual_batched_
+                             ? actuals[i]
+                             : generate_actual_fn_(inputs[i]);
+        if (!compare_results_(expected, actual)) {
+          num_failures++;
+          std::string error = absl::StrFormat(
+              "Value mismatch at index %d:\n"
+              "  Expected: 0x%x\n"
+              "  Actual  : 0x%x",
+              first + i, absl::bit_cast<uint32>(expected),
+              absl::bit_cast<uint32>(actual));
+          XLS_LOG(ERROR) << error;
+          if (max_failures_ <= num_failures) {
+            return_status = absl::InternalError(error);
+            break;
+          }
+        } else {
+          num_passes++;
         }
-      } else {
-        num_passes_.store(num_passes_.load() + 1);
       }
+      num_passes_.store(num_passes, std::memory_order_relaxed);
+      num_failures_.store(num_failures, std::memory_order_relaxed);
     }
 
     running_.store(false);
@@ -211,9 +304,11 @@ class TestbenchThreadBase {
 
   bool running() { return running_.load(); }
 
-  uint64 num_failures() { return num_failures_.load(); }
+  uint64 num_failures() {
+    return num_failures_.load(std::memory_order_relaxed);
+  }
 
-  uint64 num_passes() { return num_passes_.load(); }
+  uint64 num_passes() { return num_passes_.load(std::memory_order_relaxed); }
 
   absl::Status status() {
     absl::MutexLock lock(&mutex_);
@@ -240,8 +335,9 @@ class TestbenchThreadBase {
   std::atomic<bool> cancelled_;
   std::atomic<bool> running_;
 
-  uint64 start_index_;
-  uint64 end_index_;
+  // Shared by all threads.
+  ChunkQueues* queues_;
+  int queue_index_;
 
   // Bookkeeping data.
   uint64 max_failures_;
@@ -251,6 +347,7 @@ class TestbenchThreadBase {
   std::function<InputT(uint64)> index_to_input_;
   std::function<ResultT(InputT&)> generate_expected_fn_;
   std::function<ResultT(InputT&)> generate_actual_fn_;
+  BatchedActualFn generate_actual_batched_;
   std::function<bool(ResultT, ResultT)> compare_results_;
 
   std::string ir_text_;
@@ -0,0 +1,200 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "xls/codegen/combinational_generator.h"
+#include "xls/codegen/vast.h"
+#include "xls/codegen/vast_sink.h"
+#include "xls/common/file/file_descriptor.h"
+#include "xls/common/file/filesystem.h"
+#include "xls/common/init_xls.h"
+#include "xls/common/integral_types.h"
+#include "xls/common/logging/logging.h"
+#include "xls/common/status/ret_check.h"
+#include "xls/common/status/status_macros.h"
+#include "xls/examples/sample_packages.h"
+#include "xls/ir/ir_parser.h"
+#include "xls/ir/package.h"
+
+const char* kUsage = R"(
+Measures the time to build the VAST of a combinational module generated from
+the entry function of an IR file (or of a set of benchmarks) and to emit it as
+Verilog text, both into a string and streamed into a file. Usage:
+
+   vast_emit_benchmark_main <ir_file>
+   vast_emit_benchmark_main --benchmarks=sha256,crc32
+   vast_emit_benchmark_main --benchmarks=all
+)";
+
+ABSL_FLAG(std::vector<std::string>, benchmarks, {},
+          "Comma-separated list of benchmarks to generate Verilog for.");
+ABSL_FLAG(bool, use_system_verilog, true,
+          "Whether to generate SystemVerilog or Verilog.");
+ABSL_FLAG(std::string, output_path, "/dev/null",
+          "File to stream the emitted Verilog into.");
+ABSL_FLAG(absl::Duration, min_run_time, absl::Milliseconds(200),
+          "Minimum time to run each emission method for.");
+
+namespace xls {
+namespace verilog {
+namespace {
+
+// Return list of pairs of {name, Package} for the specified benchmarks.
+absl::StatusOr<std::vector<std::pair<std::string, std::unique_ptr<Package>>>>
+GetBenchmarks(absl::Span<const std::string> benchmark_names) {
+  std::vector<std::pair<std::string, std::unique_ptr<Package>>> packages;
+  std::vector<std::string> names;
+  if (benchmark_names.size() == 1 && benchmark_names.front() == "all") {
+    XLS_ASSIGN_OR_RETURN(names, sample_packages::GetBenchmarkNames());
+  } else {
+    names = std::vector<std::string>(benchmark_names.begin(),
+                                     benchmark_names.end());
+  }
+  for (const std::string& name : names) {
+    XLS_ASSIGN_OR_RETURN(
+        std::unique_ptr<Package> package,
+        sample_packages::GetBenchmark(name, /*optimized=*/true));
+    packages.push_back({name, std::move(package)});
+  }
+  return packages;
+}
+
+// Runs 'emit' repeatedly for at least --min_run_time and prints a line with
+// the time per emission and the throughput given the emitted text size.
+absl::Status TimeEmission(absl::string_view name, int64 text_size,
+                          const std::function<absl::Status()>& emit) {
+  const absl::Duration min_run_time = absl::GetFlag(FLAGS_min_run_time);
+  int64 runs = 0;
+  absl::Time start = absl::Now();
+  absl::Duration run_time;
+  do {
+    XLS_RETURN_IF_ERROR(emit());
+    ++runs;
+    run_time = absl::Now() - start;
+  } while (run_time < min_run_time);
+
+  const double seconds_per_run = absl::ToDoubleSeconds(run_time) / runs;
+  std::cout << absl::StreamFormat(
+      "  %-20s per emit: %10.3fms  %8.1fMB/s  (%d runs)\n", name,
+      seconds_per_run * 1e3, text_size / seconds_per_run / 1e6, runs);
+  return absl::OkStatus();
+}
+
+absl::Status BenchmarkFunction(Function* f) {
+  VerilogFile file;
+  absl::Time start = absl::Now();
+  XLS_RETURN_IF_ERROR(
+      AddCombinationalModule(f, absl::GetFlag(FLAGS_use_system_verilog), &file)
+          .status());
+  absl::Duration build_time = absl::Now() - start;
+
+  const std::string text = file.Emit();
+  std::cout << absl::StreamFormat("  VAST build: %.3fms  Verilog: %d bytes\n",
+                                  absl::ToDoubleMilliseconds(build_time),
+                                  text.size());
+
+  XLS_RETURN_IF_ERROR(
+      TimeEmission("Emit (string)", text.size(), [&]() -> absl::Status {
+        std::string emitted = file.Emit();
+        XLS_RET_CHECK_EQ(emitted.size(), text.size());
+        return absl::OkStatus();
+      }));
+
+  const std::string output_path = absl::GetFlag(FLAGS_output_path);
+  XLS_RETURN_IF_ERROR(
+      TimeEmission("EmitTo (file)", text.size(), [&]() -> absl::Status {
+        FileDescriptor fd(
+            open(output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+        if (fd.get() < 0) {
+          return absl::NotFoundError(
+              absl::StrFormat("Unable to open %s for writing", output_path));
+        }
+        FileDescriptorSink sink(fd.get());
+        file.EmitTo(&sink);
+        return sink.Flush();
+      }));
+  return absl::OkStatus();
+}
+
+absl::Status RealMain(absl::string_view input_path) {
+  std::vector<std::pair<std::string, std::unique_ptr<Package>>> packages;
+  if (absl::GetFlag(FLAGS_benchmarks).empty()) {
+    XLS_QCHECK(!input_path.empty());
+    std::string path;
+    if (input_path == "-") {
+      path = "/dev/stdin";
+    } else {
+      path = std::string(input_path);
+    }
+    XLS_ASSIGN_OR_RETURN(std::string contents, GetFileContents(path));
+    XLS_ASSIGN_OR_RETURN(std::unique_ptr<Package> package,
+                         Parser::ParsePackage(contents, path));
+    packages.push_back({path, std::move(package)});
+  } else {
+    XLS_ASSIGN_OR_RETURN(packages,
+                         GetBenchmarks(absl::GetFlag(FLAGS_benchmarks)));
+  }
+
+  for (const auto& pair : packages) {
+    const std::string& name = pair.first;
+    const auto& package = pair.second;
+    XLS_ASSIGN_OR_RETURN(Function * entry, package->EntryFunction());
+    // Use endl to flush cout so the banner appears before starting work on the
+    // benchmark.
+    std::cout << absl::StreamFormat("%s (%d nodes)", name, entry->node_count())
+              << std::endl;
+    absl::Status status = BenchmarkFunction(entry);
+    if (!status.ok()) {
+      // Keep going; some benchmarks use features not supported by the
+      // combinational generator.
+      std::cout << "  Error: " << status << "\n";
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace verilog
+}  // namespace xls
+
+int main(int argc, char** argv) {
+  std::vector<absl::string_view> positional_arguments =
+      xls::InitXls(kUsage, argc, argv);
+
+  if (positional_arguments.empty() && absl::GetFlag(FLAGS_benchmarks).empty()) {
+    XLS_LOG(QFATAL) << absl::StreamFormat(
+        "Expected invocation:\n  %s <path>\n  %s "
+        "--benchmarks=<benchmark-names>",
+        argv[0], argv[0]);
+  }
+
+  XLS_QCHECK_OK(xls::verilog::RealMain(
+      positional_arguments.empty() ? "" : positional_arguments[0]));
+  return EXIT_SUCCESS;
+}